@@ -0,0 +1,256 @@
+/*
+ *  This example measures the performance of a board and prints a
+ *  standardized report over the serial port: GPIO toggle rates, SPI and
+ *  I2C block transfer speeds, user EEPROM flash commit latency and bus
+ *  send throughput. Run it on each board revision to get comparable
+ *  baseline numbers, and on two boards connected to the same bus to
+ *  exercise send/receive under real arbitration.
+ *
+ *  Every result is printed as one line "BENCH <name>: <value> <unit>"
+ *  so that the reports are easy to collect and diff.
+ *
+ *  The example also shows the library's instrumentation: the bus
+ *  statistics, the stack high water mark, and - when the library is
+ *  built with BUS_ISR_LATENCY or SB_TRACE - the ISR latency histogram
+ *  and the trace counters.
+ *
+ *  The example's port settings are 115200 baud, no parity, 1 stop bit.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/eib.h>
+#include <sblib/serial.h>
+#include <sblib/spi.h>
+#include <sblib/i2c.h>
+#include <sblib/ioports.h>
+#include <sblib/io_pin_names.h>
+#include <sblib/mem_usage.h>
+#include <sblib/trace.h>
+
+/*
+ * We use SPI port 0 for the SPI benchmark.
+ *
+ * Pinout:
+ *
+ * PIO0_2:  SSEL0
+ * PIO0_9:  MOSI0
+ * PIO2_11: SCK0
+ */
+SPI spi(SPI_PORT_0);
+
+// The pin for the GPIO toggle benchmark
+#define TOGGLE_PIN PIN_INFO
+
+// The I2C address probed by the I2C benchmark (an EEPROM, usually)
+#define I2C_BENCH_ADDR 0x50
+
+// The group address that the bus benchmark sends to
+#define BENCH_GROUP_ADDR 0x0801
+
+// The number of telegrams the bus benchmark sends
+#define BENCH_TELEGRAM_COUNT 50
+
+// The transfer buffer of the SPI and I2C benchmarks
+static byte benchData[256];
+
+
+/*
+ * Print one result line of the report.
+ *
+ * @param name - the name of the measurement.
+ * @param value - the measured value.
+ * @param unit - the unit of the value.
+ */
+static void report(const char* name, unsigned int value, const char* unit)
+{
+    serial.printlnAll("BENCH ", name, ": ", value, " ", unit);
+}
+
+/*
+ * Benchmark the GPIO toggle rate with digitalWrite() and with a
+ * pre-resolved PinHandle.
+ */
+static void benchGpio()
+{
+    PinHandle pin(TOGGLE_PIN);
+    unsigned long long start;
+    int i;
+
+    start = micros64();
+    for (i = 0; i < 10000; ++i)
+    {
+        digitalWrite(TOGGLE_PIN, true);
+        digitalWrite(TOGGLE_PIN, false);
+    }
+    report("gpio-toggle", 20000000 / (unsigned int) elapsedMicros(start), "ktoggle/s");
+
+    start = micros64();
+    for (i = 0; i < 10000; ++i)
+    {
+        pin.set();
+        pin.clear();
+    }
+    report("gpio-toggle-handle", 20000000 / (unsigned int) elapsedMicros(start), "ktoggle/s");
+}
+
+/*
+ * Benchmark a SPI block transfer of 256 bytes.
+ */
+static void benchSpi()
+{
+    unsigned long long start = micros64();
+    spi.transferBlock(benchData, 0, sizeof(benchData));
+    unsigned int usec = elapsedMicros(start);
+
+    report("spi-block-256", usec, "usec");
+    report("spi-speed", sizeof(benchData) * 1000 / usec, "kbyte/s");
+}
+
+/*
+ * Benchmark an I2C block write of 16 bytes. The benchmark is skipped
+ * when no device answers on I2C_BENCH_ADDR.
+ */
+static void benchI2c()
+{
+    I2C* i2c = I2C::Instance();
+    unsigned long long start = micros64();
+
+    if (i2c->Write(I2C_BENCH_ADDR, (const char*) benchData, 16))
+        report("i2c-write-16", (unsigned int) elapsedMicros(start), "usec");
+    else
+        serial.println("BENCH i2c-write-16: skipped (no device)");
+}
+
+/*
+ * Benchmark the latency of a user EEPROM flash commit: dirty one byte,
+ * then time writeUserEeprom(). This is the time the bus ISR has to
+ * survive with interrupts blocked by flash operations.
+ */
+static void benchFlashCommit()
+{
+    userEeprom[USER_EEPROM_START + USER_EEPROM_SIZE / 2]++;
+    userEeprom.modified();
+
+    unsigned long long start = micros64();
+    userEeprom.commitNow();
+    report("flash-commit", (unsigned int) elapsedMicros(start), "usec");
+}
+
+/*
+ * Benchmark the bus send throughput: send BENCH_TELEGRAM_COUNT group
+ * telegrams back to back and measure the time until the bus is idle
+ * again. With a second board on the bus the statistics below also show
+ * collisions and repeats under real arbitration.
+ */
+static void benchBus()
+{
+    static unsigned char sendTel[8];
+    unsigned long long start = micros64();
+
+    for (int i = 0; i < BENCH_TELEGRAM_COUNT; ++i)
+    {
+        sendTel[0] = 0xbc; // L_Data.req, no repeat, normal priority
+        // sendTelegram() sets our own address into sendTel[1+2]
+        sendTel[3] = BENCH_GROUP_ADDR >> 8;
+        sendTel[4] = BENCH_GROUP_ADDR & 0xff;
+        sendTel[5] = 0xe1; // group addressed, hop count 6, length 1
+        sendTel[6] = 0x00;
+        sendTel[7] = 0x80 | (i & 0x3f); // group write, 6 bit value
+
+        bus.sendTelegram(sendTel, 8);
+        while (bus.sendingTelegram())
+            ;
+    }
+    while (!bus.idle())
+        ;
+
+    unsigned int usec = elapsedMicros(start);
+    report("bus-send-50", usec / 1000, "msec");
+    report("bus-throughput", BENCH_TELEGRAM_COUNT * 1000000 / usec, "telegram/s");
+}
+
+/*
+ * Print the library's own instrumentation: bus statistics, stack usage
+ * and, when compiled in, the ISR latency histogram and trace counters.
+ */
+static void reportInstrumentation()
+{
+    const BusStats& stats = bus.statistics();
+
+    report("bus-rx", stats.rxTelegrams, "telegrams");
+    report("bus-tx", stats.txTelegrams, "telegrams");
+    report("bus-repeats", stats.repeats, "telegrams");
+    report("bus-collisions", stats.collisions, "collisions");
+    report("bus-checksum-errors", stats.checksumErrors, "errors");
+    report("stack-max-used", stackMaxUsed(), "bytes");
+
+#ifdef BUS_ISR_LATENCY
+    const BusIsrLatency& latency = bus.latencyStatistics();
+    if (latency.samples)
+    {
+        report("isr-latency-min", latency.min, "usec");
+        report("isr-latency-max", latency.max, "usec");
+        for (int bin = 0; bin < BUS_LATENCY_BINS; ++bin)
+            serial.printlnAll("BENCH isr-latency-bin", bin, ": ",
+                latency.bins[bin], " samples");
+    }
+#endif
+
+#ifdef SB_TRACE
+    serial.println("BENCH trace dump follows");
+    traceDrain(serial);
+    serial.println();
+#endif
+}
+
+/*
+ * Initialize the application.
+ */
+void setup()
+{
+    bcu.begin(2, 1, 1); // ABB, dummy something device
+    bcu.setOwnAddress(0x1187);
+
+    serial.begin(115200);
+    serial.println("Selfbus benchmark example");
+    serial.printlnAll("BENCH version: ", (unsigned int) SBLIB_VERSION);
+
+    pinMode(TOGGLE_PIN, OUTPUT);
+
+    pinMode(PIO0_2,  OUTPUT | SPI_SSEL);
+    pinMode(PIO0_9,  OUTPUT | SPI_MOSI);
+    pinMode(PIO2_11, OUTPUT | SPI_CLOCK);
+    spi.setClockDivider(8);
+    spi.begin();
+
+    for (unsigned int i = 0; i < sizeof(benchData); ++i)
+        benchData[i] = i;
+}
+
+/*
+ * The main processing loop: run the benchmark suite once per 10 seconds.
+ */
+void loop()
+{
+    static unsigned int lastRun = 0xffffffff;
+
+    if (elapsed(lastRun) < 10000 && lastRun != 0xffffffff)
+    {
+        waitForInterrupt();
+        return;
+    }
+    lastRun = millis();
+
+    serial.println("--- benchmark run ---");
+    benchGpio();
+    benchSpi();
+    benchI2c();
+    benchFlashCommit();
+    benchBus();
+    reportInstrumentation();
+}
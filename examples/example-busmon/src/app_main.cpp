@@ -11,6 +11,10 @@
 #include <sblib/eib.h>
 #include <sblib/serial.h>
 
+// The capture ring for the bus monitor mode. The interrupt handler records
+// every frame here, including corrupt frames and acknowledge bytes.
+static BusMonFrame monFrames[16];
+
 /*
  * Initialize the application.
  */
@@ -22,7 +26,9 @@ void setup()
     if (userRam.status & BCU_STATUS_TL)
         userRam.status ^= BCU_STATUS_TL | BCU_STATUS_PARITY;
 
-    serial.begin(19200);
+    bus.monitorBegin(monFrames, 16);
+
+    serial.begin(115200);
     serial.println("Selfbus Bus Monitor");
 
     pinMode(PIO2_6, OUTPUT);	// Info LED
@@ -34,28 +40,30 @@ void setup()
  */
 void loop()
 {
-	// static int receiveCount = -1;
-  // static int telLength = 0;
-  // static int  byteCount = 0;
-  // static unsigned char telegram[32];
-  // static unsigned char data;
+    BusMonFrame frame;
 
 	digitalWrite(PIO3_3, 1);
 
-	if (bus.telegramReceived())
+	while (bus.monitorRead(frame))
     {
-        for (int i = 0; i < bus.telegramLen; ++i)
+        serial.print(frame.time, DEC);
+        serial.print(frame.flags & BUS_MON_FRAME_VALID ? " + " : " - ");
+
+        for (int i = 0; i < frame.length; ++i)
         {
             if (i) serial.print(" ");
-            serial.print(bus.telegram[i], HEX, 2);
+            serial.print(frame.data[i], HEX, 2);
         }
         serial.println();
 
-        bus.discardReceivedTelegram();
-
         digitalWrite(PIO2_6, !digitalRead(PIO2_6));
     }
 
+    // Telegrams are still received normally; discard them as we only
+    // use the monitor ring.
+    if (bus.telegramReceived())
+        bus.discardReceivedTelegram();
+
     // Sleep until the next 1 msec timer interrupt occurs (or shorter)
     __WFI();
 }
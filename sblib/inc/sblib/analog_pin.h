@@ -42,6 +42,58 @@ void analogEnd();
  */
 int analogRead(int channel);
 
+/**
+ * Start a continuous scan of the specified analog channels. The AD converter
+ * is switched to burst mode and converts the channels round-robin in
+ * hardware; the results are collected in the AD conversion interrupt. Read
+ * the latest value of a channel with analogScanValue() - it never blocks.
+ *
+ * The scan claims the AD converter and its interrupt completely. Do not call
+ * analogRead() while the scan is running. Call analogBegin() once before
+ * using this function, and set the pins to analog input mode with
+ * pinMode(pin, ANALOG_INPUT).
+ *
+ * @param channelMask - the channels to scan as bit mask: bit 0 for AD0,
+ *                      bit 1 for AD1, ... bit 7 for AD7.
+ */
+void analogBeginScan(int channelMask);
+
+/**
+ * Stop the continuous scan that was started with analogBeginScan().
+ */
+void analogEndScan();
+
+/**
+ * Get the latest value of an analog channel that is converted by the
+ * continuous scan, see analogBeginScan(). This is a plain array access
+ * and never blocks.
+ *
+ * @param channel - the analog channel: AD0, AD1, ... AD7
+ * @return The latest converted value: 0..1023, or up to 0..8191 when
+ *         the channel is oversampled, see analogScanOversample().
+ */
+int analogScanValue(int channel);
+
+/**
+ * Enable oversampling and decimation for a channel of the continuous scan.
+ * The AD conversion interrupt accumulates the given number of conversions
+ * and decimates the sum, which suppresses conversion noise and gains one
+ * bit of effective resolution per 4x oversampling - without any cost in
+ * the main loop:
+ *
+ * ratio 4:  11 bit values (0..2047)
+ * ratio 16: 12 bit values (0..4095)
+ * ratio 64: 13 bit values (0..8191)
+ *
+ * analogScanValue() then returns the decimated value, updated every
+ * ratio conversions. Call with ratio 1 to switch back to plain 10 bit
+ * values. Can be called before or after analogBeginScan().
+ *
+ * @param channel - the analog channel: AD0, AD1, ... AD7
+ * @param ratio - the oversampling ratio: 1, 4, 16, or 64
+ */
+void analogScanOversample(int channel, int ratio);
+
 /**
  * Write an analog value to a pin.
  *
@@ -42,4 +42,37 @@ short indexOf(unsigned short val, const unsigned short* arr, short count);
  */
 short indexOf(byte val, const byte* arr, short count);
 
+/**
+ * Find a value in a sorted array of integers, with binary search.
+ * The array must be sorted in ascending order.
+ *
+ * @param val - the value to find.
+ * @param arr - the sorted array to search.
+ * @param count - the number of values in the array.
+ * @return The index of the value in the array, -1 if not found.
+ */
+short indexOfSorted(int val, const int* arr, short count);
+
+/**
+ * Find a value in a sorted array of short integers, with binary search.
+ * The array must be sorted in ascending order.
+ *
+ * @param val - the value to find.
+ * @param arr - the sorted array to search.
+ * @param count - the number of values in the array.
+ * @return The index of the value in the array, -1 if not found.
+ */
+short indexOfSorted(unsigned short val, const unsigned short* arr, short count);
+
+/**
+ * Find a value in a sorted array of bytes, with binary search.
+ * The array must be sorted in ascending order.
+ *
+ * @param val - the value to find.
+ * @param arr - the sorted array to search.
+ * @param count - the number of values in the array.
+ * @return The index of the value in the array, -1 if not found.
+ */
+short indexOfSorted(byte val, const byte* arr, short count);
+
 #endif /*sblib_arrays_h*/
@@ -101,6 +101,43 @@ unsigned int reverseByteOrder(unsigned int val);
  */
 unsigned short reverseByteOrder(unsigned short val);
 
+/**
+ * Load a 16 bit big-endian value from a byte buffer, e.g. a telegram
+ * field. The buffer does not need to be aligned - the Cortex-M0 cannot
+ * do unaligned word access, so the value is composed from the bytes.
+ *
+ * @param ptr - the bytes to load from.
+ * @return The loaded value.
+ */
+int loadBE16(const byte* ptr);
+
+/**
+ * Load a 32 bit big-endian value from a byte buffer. The buffer does
+ * not need to be aligned, see loadBE16().
+ *
+ * @param ptr - the bytes to load from.
+ * @return The loaded value.
+ */
+unsigned int loadBE32(const byte* ptr);
+
+/**
+ * Store a 16 bit value big-endian into a byte buffer, e.g. a telegram
+ * field. The buffer does not need to be aligned, see loadBE16().
+ *
+ * @param ptr - the bytes to store into.
+ * @param val - the value to store.
+ */
+void storeBE16(byte* ptr, int val);
+
+/**
+ * Store a 32 bit value big-endian into a byte buffer. The buffer does
+ * not need to be aligned, see loadBE16().
+ *
+ * @param ptr - the bytes to store into.
+ * @param val - the value to store.
+ */
+void storeBE32(byte* ptr, unsigned int val);
+
 
 //
 //  Inline functions
@@ -121,4 +158,28 @@ inline unsigned short reverseByteOrder(unsigned short val)
     return __REV16(val);
 }
 
+inline int loadBE16(const byte* ptr)
+{
+    return (ptr[0] << 8) | ptr[1];
+}
+
+inline unsigned int loadBE32(const byte* ptr)
+{
+    return (ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+}
+
+inline void storeBE16(byte* ptr, int val)
+{
+    ptr[0] = val >> 8;
+    ptr[1] = val;
+}
+
+inline void storeBE32(byte* ptr, unsigned int val)
+{
+    ptr[0] = val >> 24;
+    ptr[1] = val >> 16;
+    ptr[2] = val >> 8;
+    ptr[3] = val;
+}
+
 #endif /*sblib_bits_h*/
@@ -12,6 +12,20 @@
 
 #include <sblib/stream.h>
 
+/**
+ * The size of the internal read/write buffers of a BufferedStream, in
+ * bytes. Must be a power of two, so the ring indexes can be wrapped with a
+ * mask. The default of 64 suits most devices; a gateway that receives
+ * large bursts may need 512 while a small sensor node gets along with 16.
+ */
+#ifndef BUFFERED_STREAM_BUFFER_SIZE
+#define BUFFERED_STREAM_BUFFER_SIZE 64
+#endif
+
+#if BUFFERED_STREAM_BUFFER_SIZE & (BUFFERED_STREAM_BUFFER_SIZE - 1)
+#error "BUFFERED_STREAM_BUFFER_SIZE must be a power of two"
+#endif
+
 /**
  * A stream class that has a read and a write buffer.
  */
@@ -38,6 +52,38 @@ public:
      */
     virtual int available();
 
+    // Keep the inherited readBytes(buffer, length) overloads visible
+    using Stream::readBytes;
+
+    /**
+     * Read a block of bytes. The buffered bytes are copied out of the read
+     * ring with at most two memcpy segments per round instead of a virtual
+     * read() call per byte. Waits up to timeoutMs milliseconds for further
+     * bytes to arrive.
+     *
+     * @param buffer - the buffer to read into
+     * @param length - the number of bytes to read
+     * @param timeoutMs - the maximum number of milliseconds to wait
+     *
+     * @return The number of bytes read.
+     */
+    int readBytes(byte* buffer, int length, unsigned int timeoutMs);
+
+    /**
+     * Read bytes until the delimiter is read, the buffer is full or the
+     * timeout expires. The delimiter is consumed but not stored. The
+     * buffered bytes are copied out of the read ring in bulk instead of a
+     * virtual read() call per byte.
+     *
+     * @param delim - the delimiter character
+     * @param buffer - the buffer to read into
+     * @param maxLength - the maximum number of bytes to read
+     * @param timeoutMs - the maximum number of milliseconds to wait
+     *
+     * @return The number of bytes read, without the delimiter.
+     */
+    int readUntil(byte delim, byte* buffer, int maxLength, unsigned int timeoutMs);
+
     /**
      * Clear the read and write buffers.
      *
@@ -47,7 +93,7 @@ public:
 
     enum
     {
-        BUFFER_SIZE = 64,  //!< The size of the internal read/write buffers in bytes.
+        BUFFER_SIZE = BUFFERED_STREAM_BUFFER_SIZE,  //!< The size of the internal read/write buffers in bytes.
         BUFFER_SIZE_MASK = BUFFER_SIZE-1
     };
 
@@ -0,0 +1,40 @@
+/*
+ *  config.h - Central compile time configuration of the library.
+ *
+ *  The library compiles all subsystems by default. On the small parts
+ *  every KB of flash decides what features ship, and the linker's section
+ *  garbage collection cannot remove the hooks and static data that the
+ *  core modules keep for optional subsystems. The macros below compile
+ *  such subsystems out completely. Define them in the project settings
+ *  (-D...) of the application, like the BCU_TYPE selection.
+ *
+ *  SBLIB_NO_MEMMAPPER
+ *      Compile out the memory mapper support of the BCU: no MemMapper
+ *      can be attached, and the mapper fallback disappears from the
+ *      memory telegram dispatch. Saves the MemMapper code and its flash
+ *      page allocator.
+ *
+ *  SBLIB_NO_BUS_MONITOR
+ *      Compile out the bus monitor mode: the frame capture disappears
+ *      from the bus interrupt handler, along with the monitor ring API
+ *      and its buffers.
+ *
+ *  SBLIB_NO_PROPERTIES
+ *      Compile out the interface object properties (BCU2 and newer).
+ *      Devices that are not configured through property services save
+ *      the property tables and handlers.
+ *
+ *  The opt-in measurement facilities are configured the same way: see
+ *  BUS_ISR_LATENCY and BUS_RX_LATENCY in eib/bus.h, SB_TRACE in trace.h
+ *  and SB_PROFILE in profiler.h.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_config_h
+#define sblib_config_h
+
+#endif /*sblib_config_h*/
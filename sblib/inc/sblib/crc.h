@@ -0,0 +1,44 @@
+/*
+ *  crc.h - Checksum calculation.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_crc_h
+#define sblib_crc_h
+
+#include <sblib/types.h>
+
+/**
+ * Calculate the CRC-32 (IEEE 802.3) checksum of a data block. The checksum
+ * is calculated with a 256 entry lookup table in flash, one lookup per byte.
+ *
+ * The checksum can be calculated incrementally over multiple blocks by
+ * passing the checksum of the preceding blocks as crc.
+ *
+ * @param crc - the checksum of the preceding data, 0 for the first block
+ * @param data - the data to checksum
+ * @param count - the number of bytes to checksum
+ * @return The checksum of the data.
+ */
+unsigned int crc32(unsigned int crc, const byte* data, int count);
+
+/**
+ * Calculate the CRC16-CCITT checksum of a data block (polynomial 0x1021,
+ * not reflected). The checksum is calculated with a 256 entry lookup table
+ * in flash, one lookup per byte.
+ *
+ * The checksum can be calculated incrementally over multiple blocks by
+ * passing the checksum of the preceding blocks as crc.
+ *
+ * @param crc - the checksum of the preceding data, 0xffff for the first block
+ * @param data - the data to checksum
+ * @param count - the number of bytes to checksum
+ * @return The checksum of the data.
+ */
+unsigned short crc16Ccitt(unsigned short crc, const byte* data, int count);
+
+#endif /*sblib_crc_h*/
@@ -62,6 +62,77 @@ private:
 };
 
 
+/**
+ * A debouncer for a whole port of signals. Every bit of the input word is
+ * a separate channel, and all channels are debounced simultaneously with
+ * word-parallel counter logic (vertical counters) - debouncing 32 keys
+ * costs the same handful of cycles as debouncing one.
+ *
+ * A channel changes its stable state after 4 consecutive polls with the
+ * new value; the debounce time is therefore 4 times the poll interval,
+ * e.g. polling every 5 msec debounces over 20 msec.
+ *
+ * Example:
+ *
+ *     VectorDebouncer d;
+ *     ...
+ *     d.debounce(portRead(1, 0xff));          // called every 5 msec
+ *     unsigned int pressed = d.rising();      // keys that just went high
+ */
+class VectorDebouncer
+{
+public:
+    /**
+     * Create a vector debouncer.
+     */
+    VectorDebouncer();
+
+    /**
+     * Send the current port snapshot into the debouncer. A channel changes
+     * its stable state after 4 consecutive calls with the new value. Call
+     * this at a fixed poll interval.
+     *
+     * @param current - the current value of all channels, one bit each.
+     *
+     * @return The debounced value of all channels.
+     */
+    unsigned int debounce(unsigned int current);
+
+    /**
+     * @return The debounced value of all channels.
+     */
+    unsigned int value() const;
+
+    /**
+     * Set the debounced value of all channels without debouncing.
+     *
+     * @param newValue - the new debounced value.
+     */
+    void init(unsigned int newValue);
+
+    /**
+     * @return The channels whose debounced value became 1 in the last
+     *         debounce() call.
+     */
+    unsigned int rising() const;
+
+    /**
+     * @return The channels whose debounced value became 0 in the last
+     *         debounce() call.
+     */
+    unsigned int falling() const;
+
+    /**
+     * @return The channels whose debounced value changed in the last
+     *         debounce() call.
+     */
+    unsigned int changed() const;
+
+private:
+    unsigned int valid, cnt0, cnt1, edges;
+};
+
+
 //
 //  Inline functions
 //
@@ -82,4 +153,32 @@ inline int Debouncer::lastValue() const
     return last;
 }
 
+inline unsigned int VectorDebouncer::value() const
+{
+    return valid;
+}
+
+inline void VectorDebouncer::init(unsigned int newValue)
+{
+    valid = newValue;
+    cnt0 = 0;
+    cnt1 = 0;
+    edges = 0;
+}
+
+inline unsigned int VectorDebouncer::rising() const
+{
+    return edges & valid;
+}
+
+inline unsigned int VectorDebouncer::falling() const
+{
+    return edges & ~valid;
+}
+
+inline unsigned int VectorDebouncer::changed() const
+{
+    return edges;
+}
+
 #endif /*sblib_debounce_h*/
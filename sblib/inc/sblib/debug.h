@@ -19,7 +19,9 @@
  * is printed.
  *
  * Uses semihosting to send the print output to a window in the debugger
- * on the PC.
+ * on the PC. The output is line buffered: a full line is sent with a
+ * single semihosting call, which stops the ARM once per line instead of
+ * once per character. Call flush() to send a partial line.
  *
  * Example:
  * <p>
@@ -29,6 +31,19 @@
  */
 class Debug: public Print
 {
+public:
+    /**
+     * Create the debug output stream.
+     */
+    Debug();
+
+    /**
+     * Send the buffered output to the debugger, even when the line is
+     * not complete yet. Output is sent automatically on a newline and
+     * when the buffer is full.
+     */
+    void flush();
+
     /**
      * Write a number of bytes.
      *
@@ -47,6 +62,10 @@ class Debug: public Print
      * @return 1 if the byte was written, 0 if not.
      */
     virtual int write(byte ch);
+
+private:
+    byte buffer[128];   //!< The buffered output of the current line
+    int buffered;       //!< The number of buffered bytes
 };
 
 #endif /*sblib_debug_h*/
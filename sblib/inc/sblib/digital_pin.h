@@ -56,6 +56,67 @@ void pinEnableInterrupt(int pin);
  */
 void pinDisableInterrupt(int pin);
 
+/**
+ * Type of a direct-dispatch pin interrupt handler, see attachPinInterrupt().
+ * The handler is called from the port's interrupt vector. Keep it short,
+ * it runs in interrupt context.
+ */
+typedef void (*PinInterruptHandler)(void);
+
+/**
+ * The per-port handler table of the direct-dispatch pin interrupts. Do not
+ * access it directly, it is filled by attachPinInterrupt() and read by the
+ * PIN_INTERRUPT_HANDLER() macro.
+ */
+extern PinInterruptHandler pinInterruptHandlers[4];
+
+/**
+ * Attach a handler to the dedicated interrupt vector of the pin's port.
+ * The handler is dispatched with a single indirection - no scanning for
+ * the triggering pin - so the entry latency stays close to the raw
+ * interrupt latency, which matters for pulse counting. One handler per
+ * port: attaching a second pin of the same port replaces the handler, so
+ * give both pins the same handler and let it read the pins if needed.
+ *
+ * The port's interrupt vector must be instantiated once with the
+ * PIN_INTERRUPT_HANDLER() macro:
+ *
+ *     attachPinInterrupt(PIO1_4, countPulse, INTERRUPT_EDGE_RISING);
+ *     PIN_INTERRUPT_HANDLER(PIOINT1_IRQHandler, 1)
+ *
+ * The pin is configured as input, the interrupt priority of the port is
+ * set to ISR_PRIO_TIME_CRITICAL.
+ *
+ * @param pin - the pin: PIO0_0, PIO0_1, ... (see sblib/ioports.h)
+ * @param handler - the handler to call when the interrupt triggers
+ * @param mode - the trigger: a PinInterruptMode value, e.g.
+ *               INTERRUPT_EDGE_RISING
+ */
+void attachPinInterrupt(int pin, PinInterruptHandler handler, int mode);
+
+/**
+ * Detach the pin from its port's interrupt. The port's interrupt is
+ * disabled when no other pin of the port uses it.
+ *
+ * @param pin - the pin: PIO0_0, PIO0_1, ...
+ */
+void detachPinInterrupt(int pin);
+
+/**
+ * Create the interrupt vector of a GPIO port for the direct-dispatch pin
+ * interrupts, see attachPinInterrupt(). Use this macro once per port.
+ *
+ * @param handler - the name of the port's interrupt handler:
+ *                  PIOINT0_IRQHandler for port 0, PIOINT1_IRQHandler, ...
+ * @param portNum - the port number: 0..3
+ */
+#define PIN_INTERRUPT_HANDLER(handler, portNum) \
+    extern "C" void handler() \
+    { \
+        gpioPorts[portNum]->IC = 0xfff; \
+        pinInterruptHandlers[portNum](); \
+    }
+
 /**
  * Configure the mode of the pins of an I/O port.
  *
@@ -112,6 +173,40 @@ bool digitalRead(int pin);
  */
 void shiftOut(int dataPin, int clockPin, BitOrder bitOrder, byte val);
 
+/**
+ * Begin using shiftOut() on the given pin pair. When the pins map to the
+ * MOSI and SCK of an SSP port, the port is claimed and all shiftOut()
+ * calls for this pin pair are done by the SSP hardware, which shifts a
+ * byte in a couple of clock cycles instead of per-bit pin writes - LED
+ * driver and 7-segment chains refresh at a fraction of the CPU cost. On
+ * other pins shiftOut() keeps bit-banging as before.
+ *
+ * On the LPC11xx the pin pairs with hardware support are PIO0_9 with
+ * PIO0_10 / PIO2_11 / PIO0_6 (SSP0), and PIO2_3 / PIO1_9 with
+ * PIO2_1 / PIO3_2 (SSP1).
+ *
+ * @param dataPin - the data pin, e.g. PIO0_9
+ * @param clockPin - the clock pin, e.g. PIO0_6
+ * @return True if the pins are hardware backed now, false if shiftOut()
+ *         falls back to bit-banging.
+ */
+bool shiftOutBegin(int dataPin, int clockPin);
+
+/**
+ * Shift out a block of bytes, see shiftOut(). With hardware backed pins
+ * (see shiftOutBegin()) the bytes are streamed through the SSP FIFO
+ * back to back; the call returns when the last bit has been shifted, so
+ * a latch pin can be pulsed right after it.
+ *
+ * @param dataPin - the data pin to output the bytes to
+ * @param clockPin - the clock pin
+ * @param bitOrder - the bit order: LSBFIRST or MSBFIRST.
+ * @param data - the bytes to output.
+ * @param count - the number of bytes to output.
+ */
+void shiftOutBlock(int dataPin, int clockPin, BitOrder bitOrder,
+                   const byte* data, int count);
+
 /**
  * Read a byte from a digital pin. The byte is read bit by bit. The clock pin
  * pulses the reading. Please note that the clock pin is used as output and outputs
@@ -197,6 +292,11 @@ enum PinMode
      *
      * For example pin PIO1_8 captures to the capture register CR0 of the 16 bit timer #1
      * if activated.
+     *
+     * On noisy wiring combine with HYSTERESIS (and PULL_UP / PULL_DOWN as the
+     * signal requires) so that sub-threshold glitches are rejected in silicon
+     * instead of producing spurious captures. The LPC11xx timers have no
+     * digital capture filter beyond the pin hysteresis.
      */
     INPUT_CAPTURE = 0x2000,
 
@@ -216,7 +316,11 @@ enum PinMode
     PULL_DOWN = 0x08,
 
     /**
-     * Enable the input hysteresis.
+     * Enable the input hysteresis. The pin then switches with a Schmitt
+     * trigger characteristic, so noise below the hysteresis window is
+     * rejected in silicon before it can trigger an interrupt or a timer
+     * capture. Recommended for capture and counter inputs on noisy field
+     * wiring, e.g. pinMode(pin, INPUT_CAPTURE | HYSTERESIS).
      */
     HYSTERESIS = 0x20,
 
@@ -273,6 +377,12 @@ enum PinMode
      */
     SERIAL_TXD = OUTPUT | PINMODE_FUNC(PF_TXD),
 
+    /**
+     * Configure the pin as serial direction control output (RTS), used by
+     * the UART's RS-485 direction control, see Serial::enableDirectionControl().
+     */
+    SERIAL_DIR = OUTPUT | PINMODE_FUNC(PF_RTS),
+
     /**
      * Configure the pin as output for SPI clock (SCK) in SPI master mode or input
      * for SPI clock (SCK) in SPI slave mode. Shall be combined with OUTPUT or INPUT.
@@ -331,6 +441,180 @@ enum PinInterruptMode
 	INTERRUPT_ENABLED      = 0x1000,
 };
 
+/**
+ * A pre-resolved handle for a single digital pin. The pin number is decoded
+ * through the port/mask tables only once, when the handle is created; the
+ * handle stores the address of the pin's masked-access word (LPC11xx) so
+ * that write() and read() compile to a single store/load. Use it instead of
+ * digitalWrite()/digitalRead() in hot paths like matrix scanning:
+ *
+ * PinHandle row(PIO1_4);
+ * row.write(1);      // one store
+ * row.toggle();
+ *
+ * The handle only accesses the data register; configure the pin with
+ * pinMode() as usual before using it. Thanks to the masked GPIO region a
+ * write only affects this pin, so no read-modify-write of the whole port
+ * is involved.
+ */
+class PinHandle
+{
+public:
+    PinHandle() : addr(0), mask(0) {}
+
+    /**
+     * Create a handle for a digital pin.
+     *
+     * @param pin - the pin to resolve, e.g. PIO1_4
+     */
+    explicit PinHandle(int pin) { resolve(pin); }
+
+    /**
+     * Resolve the pin of the handle. This does the table lookup that
+     * digitalWrite() would otherwise do on every call.
+     *
+     * @param pin - the pin to resolve, e.g. PIO1_4
+     */
+    void resolve(int pin)
+    {
+#if defined (__LPC11XX__)
+        mask = digitalPinToBitMask(pin);
+        addr = &gpioPorts[digitalPinToPort(pin)]->MASKED_ACCESS[mask];
+#elif defined (__LPC11UXX__)
+        mask = 1;
+        addr = (volatile unsigned int*) &LPC_GPIO->B[digitalPinToPort(pin) * 32 + digitalPinToPinNum(pin)];
+#endif
+    }
+
+    /**
+     * Set the value of the pin: a single store.
+     *
+     * @param value - the value to write: true or false
+     */
+    ALWAYS_INLINE void write(bool value) { *addr = value ? mask : 0; }
+
+    /**
+     * @return The value of the pin: a single load.
+     */
+    ALWAYS_INLINE bool read() const { return *addr != 0; }
+
+    /**
+     * Set the pin high.
+     */
+    ALWAYS_INLINE void set() { *addr = mask; }
+
+    /**
+     * Set the pin low.
+     */
+    ALWAYS_INLINE void clear() { *addr = 0; }
+
+    /**
+     * Toggle the pin. The masked access only affects this pin, other pins
+     * of the port are untouched.
+     */
+    ALWAYS_INLINE void toggle() { *addr = *addr ^ mask; }
+
+private:
+    volatile unsigned int* addr; //!< The pin's data word (masked access)
+    unsigned int mask;           //!< The bit mask of the pin in *addr
+};
+
+/**
+ * A pre-resolved handle for a group of pins of one GPIO port, e.g. an 8 bit
+ * LCD data bus or a row of keypad lines. The port and pin mask are decoded
+ * once; afterwards write() updates all pins of the group with a single
+ * store into the LPC11xx masked GPIO region, so there is no per-pin decode
+ * and no read-modify-write race with interrupt handlers that use other
+ * pins of the same port. The value is shifted to the group's lowest pin,
+ * so an 8 bit bus on pins 4..11 is written with plain byte values:
+ *
+ * PortHandle lcdBus(2, 0x0ff0);   // PIO2_4 .. PIO2_11
+ * lcdBus.write(data);             // one store
+ *
+ * The handle keeps a shadow of the last written value, so the intended
+ * output state can be queried with lastWritten() without reading the pins
+ * back (useful for open-drain buses where the pin level may differ).
+ * Configure the pins with portMode() as usual before using the handle.
+ */
+class PortHandle
+{
+public:
+    PortHandle() : addr(0), mask(0), shift(0), shadow(0) {}
+
+    /**
+     * Create a handle for a group of pins of a GPIO port.
+     *
+     * @param portNum - the port number: 0..3
+     * @param pinMask - the mask of the pins that belong to the group
+     */
+    PortHandle(int portNum, unsigned int pinMask) { resolve(portNum, pinMask); }
+
+    /**
+     * Resolve the port and pin mask of the handle.
+     *
+     * @param portNum - the port number: 0..3
+     * @param pinMask - the mask of the pins that belong to the group
+     */
+    void resolve(int portNum, unsigned int pinMask)
+    {
+        mask = pinMask;
+        for (shift = 0; shift < 32 && !(pinMask & (1 << shift)); ++shift)
+            ;
+        shadow = 0;
+#if defined (__LPC11XX__)
+        addr = &gpioPorts[portNum]->MASKED_ACCESS[pinMask & 0xfff];
+#elif defined (__LPC11UXX__)
+        port = portNum;
+        addr = 0;
+#endif
+    }
+
+    /**
+     * Write a value to the pins of the group: a single store, pins of the
+     * port outside the group are untouched. The value is shifted to the
+     * group's lowest pin.
+     *
+     * @param value - the value to write, in group-local bit positions
+     */
+    ALWAYS_INLINE void write(unsigned int value)
+    {
+        shadow = value;
+#if defined (__LPC11XX__)
+        *addr = value << shift;
+#elif defined (__LPC11UXX__)
+        LPC_GPIO->MASK[port] = ~mask;
+        LPC_GPIO->MPIN[port] = value << shift;
+#endif
+    }
+
+    /**
+     * @return The value of the pins of the group, shifted to bit 0.
+     */
+    ALWAYS_INLINE unsigned int read() const
+    {
+#if defined (__LPC11XX__)
+        return *addr >> shift;
+#elif defined (__LPC11UXX__)
+        return (LPC_GPIO->PIN[port] & mask) >> shift;
+#endif
+    }
+
+    /**
+     * @return The last value passed to write(): the intended output state,
+     *         independent of the actual pin levels.
+     */
+    ALWAYS_INLINE unsigned int lastWritten() const { return shadow; }
+
+private:
+    volatile unsigned int* addr; //!< The group's word in the masked GPIO region
+#if defined (__LPC11UXX__)
+    int port;                    //!< The port number
+#endif
+    unsigned int mask;           //!< The pin mask of the group
+    int shift;                   //!< The bit position of the group's lowest pin
+    unsigned int shadow;         //!< The last written value
+};
+
 //
 //  Inline functions
 //
@@ -346,6 +630,32 @@ ALWAYS_INLINE bool digitalRead(int pin)
     return gpioPorts[digitalPinToPort(pin)]->MASKED_ACCESS[digitalPinToBitMask(pin)] != 0;
 }
 
+/**
+ * Write a value to multiple pins of a port at once, using the masked GPIO
+ * region: a single store, pins outside the mask are untouched. For
+ * pre-resolved repeated access see PortHandle.
+ *
+ * @param portNum - the port number: 0..3
+ * @param pinMask - the mask of the pins to write
+ * @param value - the value to write, in port bit positions
+ */
+ALWAYS_INLINE void portWrite(int portNum, unsigned int pinMask, unsigned int value)
+{
+    gpioPorts[portNum]->MASKED_ACCESS[pinMask & 0xfff] = value;
+}
+
+/**
+ * Read multiple pins of a port at once.
+ *
+ * @param portNum - the port number: 0..3
+ * @param pinMask - the mask of the pins to read
+ * @return The value of the masked pins, in port bit positions.
+ */
+ALWAYS_INLINE unsigned int portRead(int portNum, unsigned int pinMask)
+{
+    return gpioPorts[portNum]->MASKED_ACCESS[pinMask & 0xfff];
+}
+
 ALWAYS_INLINE void pinEnableInterrupt(int pin)
 {
     LPC_GPIO_TypeDef* port = gpioPorts[digitalPinToPort(pin)];
@@ -373,6 +683,33 @@ ALWAYS_INLINE bool digitalRead(int pin)
     return LPC_GPIO->B[digitalPinToPort(pin) * 32 + digitalPinToPinNum(pin)] != 0;
 }
 
+/**
+ * Write a value to multiple pins of a port at once, using the GPIO port
+ * mask register: pins outside the mask are untouched. For pre-resolved
+ * repeated access see PortHandle.
+ *
+ * @param portNum - the port number: 0..1
+ * @param pinMask - the mask of the pins to write
+ * @param value - the value to write, in port bit positions
+ */
+ALWAYS_INLINE void portWrite(int portNum, unsigned int pinMask, unsigned int value)
+{
+    LPC_GPIO->MASK[portNum] = ~pinMask;
+    LPC_GPIO->MPIN[portNum] = value;
+}
+
+/**
+ * Read multiple pins of a port at once.
+ *
+ * @param portNum - the port number: 0..1
+ * @param pinMask - the mask of the pins to read
+ * @return The value of the masked pins, in port bit positions.
+ */
+ALWAYS_INLINE unsigned int portRead(int portNum, unsigned int pinMask)
+{
+    return LPC_GPIO->PIN[portNum] & pinMask;
+}
+
 #endif
 
 #endif /*sblib_digital_pin_h*/
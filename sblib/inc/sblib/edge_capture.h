@@ -0,0 +1,192 @@
+/*
+ *  edge_capture.h - Multi-channel edge timestamp capture engine.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_edge_capture_h
+#define sblib_edge_capture_h
+
+#include <sblib/timer.h>
+
+class Timer;
+
+/**
+ * The maximum number of capture channels.
+ */
+#ifndef EDGE_CAPTURE_CHANNELS
+# define EDGE_CAPTURE_CHANNELS 8
+#endif
+
+/**
+ * The size of the event ring. Must be a power of two.
+ */
+#ifndef EDGE_CAPTURE_RING_SIZE
+# define EDGE_CAPTURE_RING_SIZE 32
+#endif
+
+#if EDGE_CAPTURE_RING_SIZE & (EDGE_CAPTURE_RING_SIZE - 1)
+# error EDGE_CAPTURE_RING_SIZE must be a power of two
+#endif
+
+/**
+ * A captured edge: the channel, the pin level after the edge, and the
+ * timestamp from the capture timer (microseconds).
+ */
+struct EdgeCaptureEvent
+{
+    byte channel;        //!< The channel index from addChannel()
+    byte level;          //!< The pin level after the edge: 0 or 1
+    unsigned int time;   //!< The timestamp in usec (wraps with the timer)
+};
+
+/**
+ * An edge timestamp capture engine for multiple pins, e.g. S0 energy meter
+ * impulses and fan tachometers. Every registered pin is routed through its
+ * GPIO port interrupt into a shared timestamped event ring that is consumed
+ * asynchronously with readEvent() - no polling loops, and narrow pulses are
+ * not missed. When the ring is full, events are dropped and counted per
+ * channel (overflowCount()). Noisy inputs can enable the pin hysteresis
+ * and a per-channel glitch filter, see addChannel() and setGlitchFilter().
+ *
+ * The timestamps come from a timer that the engine claims completely and
+ * runs free with 1 usec resolution. The port interrupt handlers must be
+ * connected with the EDGE_CAPTURE_INTERRUPT_HANDLER() macro, one per GPIO
+ * port that has capture pins:
+ *
+ * EdgeCapture capture;
+ * capture.begin(timer32_0);
+ * int s0 = capture.addChannel(PIO1_4, INTERRUPT_EDGE_FALLING);
+ * int tacho = capture.addChannel(PIO2_5, INTERRUPT_EDGE_BOTH);
+ * capture.enableInterrupts();
+ * EDGE_CAPTURE_INTERRUPT_HANDLER(PIOINT1_IRQHandler, capture, 1)
+ * EDGE_CAPTURE_INTERRUPT_HANDLER(PIOINT2_IRQHandler, capture, 2)
+ */
+class EdgeCapture
+{
+public:
+    EdgeCapture();
+
+    /**
+     * Begin using the capture engine. The timer is claimed completely and
+     * runs free with 1 usec resolution.
+     *
+     * @param aTimer - the timestamp timer, e.g. timer32_0. Prefer a 32 bit
+     *                 timer: a 16 bit timer wraps every 65.5 msec, which
+     *                 only the relative times of dense event streams can
+     *                 tolerate.
+     */
+    void begin(Timer& aTimer);
+
+    /**
+     * Add a capture channel. The pin is configured as interrupt input.
+     *
+     * @param pin - the pin to capture, e.g. PIO1_4
+     * @param mode - the edges to capture: INTERRUPT_EDGE_FALLING,
+     *               INTERRUPT_EDGE_RISING, or INTERRUPT_EDGE_BOTH
+     * @param pinFlags - additional pin configuration: PULL_UP, PULL_DOWN,
+     *                   HYSTERESIS, combined with "|". HYSTERESIS rejects
+     *                   sub-threshold noise in silicon, before it costs an
+     *                   interrupt - recommended for noisy field wiring
+     *                   (default: 0).
+     * @return The channel index, or -1 if all channels are in use.
+     */
+    int addChannel(int pin, int mode, int pinFlags = 0);
+
+    /**
+     * Set the glitch filter of a channel. An edge that follows another
+     * edge of the channel within the filter time is discarded in the
+     * interrupt handler and counted (filteredCount()), so noise bursts do
+     * not flood the event ring and the downstream processing. The filter
+     * runs after the interrupt, so it limits the event rate, not the
+     * interrupt rate; use the HYSTERESIS pin flag to reject sub-threshold
+     * noise before it interrupts at all.
+     *
+     * @param channel - the channel index from addChannel()
+     * @param usec - the minimum time between two edges in usec, 0 to
+     *               disable the filter (the default). Must be shorter
+     *               than the narrowest real pulse of the signal.
+     */
+    void setGlitchFilter(int channel, unsigned int usec);
+
+    /**
+     * Enable the port interrupts of all added channels. Call once after
+     * the last addChannel().
+     */
+    void enableInterrupts();
+
+    /**
+     * Get the next captured event, if any.
+     *
+     * @param event - the event is written here
+     * @return True if an event was fetched, false if the ring is empty.
+     */
+    bool readEvent(EdgeCaptureEvent& event);
+
+    /**
+     * @return The number of events waiting in the ring.
+     */
+    int pending() const;
+
+    /**
+     * The number of events of a channel that were dropped because the
+     * event ring was full.
+     *
+     * @param channel - the channel index from addChannel()
+     * @return The number of dropped events.
+     */
+    unsigned int overflowCount(int channel) const;
+
+    /**
+     * The number of edges of a channel that the glitch filter discarded,
+     * see setGlitchFilter().
+     *
+     * @param channel - the channel index from addChannel()
+     * @return The number of discarded edges.
+     */
+    unsigned int filteredCount(int channel) const;
+
+    /**
+     * The interrupt handler of a GPIO port. Do not call this directly,
+     * use the EDGE_CAPTURE_INTERRUPT_HANDLER() macro.
+     *
+     * @param portNum - the GPIO port number: 0..3
+     */
+    void portInterruptHandler(int portNum);
+
+protected:
+    // One capture channel
+    struct Channel
+    {
+        byte portNum;              //!< The GPIO port of the pin
+        unsigned short mask;       //!< The bit mask of the pin
+        unsigned int overflows;    //!< Events dropped on ring overflow
+        unsigned int filterTime;   //!< The glitch filter time in usec, 0 if off
+        unsigned int lastTime;     //!< The timestamp of the last edge, for the filter
+        unsigned int filtered;     //!< Edges discarded by the glitch filter
+    };
+
+    Timer* timer;                  //!< The timestamp timer
+    Channel channels[EDGE_CAPTURE_CHANNELS];
+    byte channelCount;             //!< The number of used channels
+
+    EdgeCaptureEvent ring[EDGE_CAPTURE_RING_SIZE];
+    volatile byte head;            //!< The ring index of the next event to write
+    volatile byte tail;            //!< The ring index of the next event to read
+};
+
+/**
+ * Create an interrupt handler for a GPIO port of an edge capture engine.
+ * Use this macro once per GPIO port that has capture pins.
+ *
+ * @param handler - the name of the interrupt handler, e.g. PIOINT1_IRQHandler
+ * @param captureObj - the EdgeCapture object
+ * @param portNum - the GPIO port number of the handler: 0..3
+ */
+#define EDGE_CAPTURE_INTERRUPT_HANDLER(handler, captureObj, portNum) \
+    extern "C" void handler() { captureObj.portInterruptHandler(portNum); }
+
+#endif /*sblib_edge_capture_h*/
@@ -55,4 +55,92 @@ byte* addrTable();
  */
 byte* assocTable();
 
+/**
+ * The number of address table entries that the sorted address index can
+ * hold. Address tables with more entries are searched linearly.
+ */
+#ifndef ADDR_INDEX_SIZE
+#define ADDR_INDEX_SIZE 128
+#endif
+
+/**
+ * The number of association table entries that the sorted association index
+ * can hold. Association tables with more entries are scanned linearly.
+ */
+#ifndef ASSOC_INDEX_SIZE
+#define ASSOC_INDEX_SIZE 254
+#endif
+
+/**
+ * Sorted index over the association table: the positions of the association
+ * table entries, ordered by their address table index. Built by
+ * updateGroupAddrFilter().
+ */
+extern byte assocIndexSorted[ASSOC_INDEX_SIZE];
+
+/**
+ * The number of entries in assocIndexSorted[], 0 if the association table
+ * was too large for the index and must be scanned linearly.
+ */
+extern volatile int assocIndexCount;
+
+/**
+ * The number of com-objects that the sending address index can hold.
+ * Objects beyond the index resolve their address by scanning the
+ * association table.
+ */
+#ifndef SEND_ADDR_INDEX_SIZE
+#define SEND_ADDR_INDEX_SIZE 64
+#endif
+
+/**
+ * Get the group address that is used for sending a read-value or a
+ * write-value telegram of a com-object: the address of the object's first
+ * association. The per-object index makes this a table lookup.
+ *
+ * @param objno - the ID of the communication object.
+ * @return The group address, 0 if the object has no association.
+ */
+int addrForSendObject(int objno);
+
+/**
+ * Find the first association of an address table index, using the sorted
+ * association index. The associations of the index follow in
+ * assocIndexSorted[] in address table order.
+ *
+ * @param addrIndex - the address table index to find.
+ * @return The position of the first association in assocIndexSorted[],
+ *         -1 if there is none.
+ */
+int firstAssocOfAddr(int addrIndex);
+
+/**
+ * Bitmap for fast group address filtering in the bus interrupt handler.
+ * Bit (addrHigh ^ addrLow) is set for every group address in the address
+ * table. A clear bit means the address is definitely not in the table, a
+ * set bit means it may be (false positives are resolved by indexOfAddr).
+ */
+extern byte groupAddrFilter[32];
+
+/**
+ * Rebuild groupAddrFilter[] and the sorted address and association indexes
+ * from the tables. Called by bcu.begin() and after the tables were changed
+ * by memory write telegrams.
+ */
+void updateGroupAddrFilter();
+
+/**
+ * Test a group address against the filter bitmap. This is cheap enough to
+ * be called from the bus interrupt handler for every received telegram.
+ *
+ * @param addr - the group address to test.
+ * @return False if the address is not in the address table, true if it
+ *         may be in the table.
+ */
+inline bool filterGroupAddr(int addr)
+{
+    int hash = ((addr >> 8) ^ addr) & 255;
+    return groupAddrFilter[hash >> 3] & (1 << (hash & 7));
+}
+
 #endif /*sblib_addr_tables_h*/
@@ -10,20 +10,54 @@
 #ifndef sblib_bcu_h
 #define sblib_bcu_h
 
+#include <sblib/config.h>
 #include <sblib/types.h>
 #include <sblib/eib/bus.h>
 #include <sblib/eib/bcu_type.h>
 #include <sblib/eib/properties.h>
 #include <sblib/eib/user_memory.h>
 #include <sblib/utils.h>
+#ifndef SBLIB_NO_MEMMAPPER
 #include <sblib/mem_mapper.h>
+#endif
 
 
 // Rename the method begin_BCU() of the class BCU to indicate the BCU type. If you get a
 // link error then the library's BCU_TYPE is different from the application's BCU_TYPE.
 #define begin_BCU  CPP_CONCAT_EXPAND(begin_,BCU_NAME)
 
+/**
+ * The number of connection-oriented data telegrams that may be accepted
+ * before a cumulative T_ACK is sent. With a stop-and-wait sender like ETS
+ * the ACK is still sent immediately after each telegram; the window only
+ * takes effect when a sender pipelines telegrams.
+ */
+#ifndef BCU_TL_WINDOW
+#define BCU_TL_WINDOW 4
+#endif
+
+/**
+ * The maximum number of address ranges of the memory telegram dispatch
+ * table, see BCU::addMemoryRange().
+ */
+#ifndef BCU_MEM_RANGES
+#define BCU_MEM_RANGES 8
+#endif
+
+/**
+ * The handlers of one address range of the memory read/write telegrams,
+ * see BCU::addMemoryRange().
+ */
+struct MemoryRange
+{
+    unsigned short start;  //!< The first address of the range
+    unsigned short end;    //!< The last address of the range (inclusive)
+    void (*read)(int address, byte* data, int count);  //!< Read handler, 0 if not readable
+    void (*write)(int address, byte* data, int count); //!< Write handler, 0 if not writable
+};
+
 class BCU;
+class FirmwareUpdate;
 
 /**
  * The EIB bus coupling unit.
@@ -94,6 +128,20 @@ public:
     void setProgPinInverted(int prgPinInv) {
         progPinInv=prgPinInv;
     }
+    /**
+     * Spread the initial transmissions after a restart over a random
+     * hold-off window, seeded from the physical address, followed by a
+     * ramped release of the queued group telegrams. When the bus voltage
+     * recovers, every device of the line restarts at the same moment;
+     * without the stagger their initial status telegrams thrash in
+     * collisions. Must be called before the begin method; 0 disables
+     * the stagger (the default).
+     *
+     * @param windowMs - the width of the stagger window in msec
+     */
+    void setTransmitStagger(int windowMs) {
+        staggerWindow=windowMs;
+    }
     /**
      * End using the EIB bus coupling unit.
      */
@@ -157,11 +205,40 @@ public:
 
     int connectedTo();
 
+#ifndef SBLIB_NO_MEMMAPPER
     /**
      * Allow an user provided memory mapper to store parameter data via memory write / read
      * @param mapper - a pointer to an instance of a MemMapper object
      */
     void setMemMapper(MemMapper *mapper);
+#endif
+
+    /**
+     * Register a firmware updater that receives an update image through
+     * its memory window. Call after FirmwareUpdate::setMemoryWindow(), so
+     * the window is known when it is entered into the dispatch table.
+     *
+     * @param updater - a pointer to the firmware updater, 0 to remove it
+     */
+    void setFirmwareUpdate(FirmwareUpdate *updater);
+
+    /**
+     * Register an address range for the memory read/write telegrams. The
+     * ranges are kept sorted and a memory telegram resolves its address by
+     * binary search, so registering more ranges does not lengthen the
+     * per-telegram address chain. The library registers its own ranges
+     * (user RAM, user EEPROM, ...) in bcu.begin(); call this afterwards.
+     *
+     * @param start - the first address of the range
+     * @param end - the last address of the range (inclusive)
+     * @param readFn - the read handler, 0 if the range is not readable
+     * @param writeFn - the write handler, 0 if the range is not writable
+     * @return True if the range was registered, false if the table is full
+     *         or the range overlaps an already registered one.
+     */
+    bool addMemoryRange(int start, int end,
+        void (*readFn)(int address, byte* data, int count),
+        void (*writeFn)(int address, byte* data, int count));
 
     /**
      * A buffer for sending telegrams. This buffer is considered library private
@@ -225,15 +302,57 @@ protected:
     void begin_BCU(int manufacturer, int deviceType, int version);
 
 private:
+    /**
+     * Rebuild the memory telegram dispatch table with the library's own
+     * address ranges and the firmware updater's window.
+     */
+    void initMemoryRanges();
+
+    /**
+     * Find the registered address range of a memory telegram address.
+     *
+     * @param address - the memory address
+     * @return The range, 0 if the address belongs to no registered range.
+     */
+    const MemoryRange* findMemoryRange(int address) const;
+
+    // Read/write handlers of the firmware updater's window range
+    static void readFwUpdateRange(int address, byte* data, int count);
+    static void writeFwUpdateRange(int address, byte* data, int count);
+
+    /**
+     * Test if the transmit stagger releases a group telegram. True when
+     * the stagger is inactive; during the ramp each release re-arms the
+     * gate with a shrinking gap.
+     */
+    bool staggerReleased();
+
     Debouncer progButtonDebouncer; //!< The debouncer for the programming mode button.
+    unsigned int progButtonPollTime; //!< System time when the programming button was last sampled.
     bool enabled;                  //!< The BCU is enabled. Set by bcu.begin().
     byte sendCtrlTelegram[8];      //!< A short buffer for connection control telegrams.
     int  connectedAddr;            //!< Remote address of the connected partner.
     int  connectedSeqNo;           //!< Sequence number for connected data telegrams.
+    int  connectedRcvSeqNo;        //!< Expected sequence number of the next received data telegram.
+    int  pendingAckSeqNo;          //!< Sequence number of the last accepted, not yet acknowledged telegram.
+    int  pendingAckCount;          //!< Number of accepted data telegrams waiting for a T_ACK.
     unsigned int connectedTime;    //!< System time of the last connected telegram.
     bool incConnectedSeqNo;        //!< True if the sequence number shall be incremented on ACK.
     int lastAckSeqNo;              //!< Last acknowledged sequence number
+    byte lastTel[Bus::TELEGRAM_SIZE]; //!< Bytes 1..n of the last processed telegram, for repeat suppression
+    int lastTelLen;                //!< Length of the last processed telegram, 0 if none
+    unsigned int lastTelTime;      //!< System time when the last telegram was processed
+    byte lastResponse[Bus::TELEGRAM_SIZE]; //!< Copy of the last response telegram, for retransmits
+    int lastResponseSeqNo;         //!< Sequence number that lastResponse answered, -1 if none
+#ifndef SBLIB_NO_MEMMAPPER
     MemMapper *memMapper;          //!< Link to memMapper
+#endif
+    FirmwareUpdate *firmwareUpdate; //!< Link to the firmware updater
+    MemoryRange memRanges[BCU_MEM_RANGES]; //!< The memory telegram dispatch table, sorted by start address
+    int memRangeCount;             //!< The number of registered ranges
+    unsigned int staggerWindow;    //!< Width of the startup transmit stagger window (msec), 0: disabled
+    unsigned int staggerNext;      //!< System time when the stagger releases the next group telegram
+    unsigned int staggerInterval;  //!< Current gap of the ramped release (msec), 0: ramp finished
 };
 
 
@@ -299,10 +418,12 @@ inline int BCU::connectedTo()
     return connectedAddr;
 }
 
+#ifndef SBLIB_NO_MEMMAPPER
 inline void BCU::setMemMapper(MemMapper *mapper)
 {
     memMapper = mapper;
 }
+#endif
 
 #ifndef INSIDE_BCU_CPP
 #   undef begin_BCU
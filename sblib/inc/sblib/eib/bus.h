@@ -10,6 +10,7 @@
 #ifndef sblib_bus_h
 #define sblib_bus_h
 
+#include <sblib/config.h>
 #include <sblib/core.h>
 #include <sblib/eib/bcu_type.h>
 
@@ -19,6 +20,17 @@
 #include <sblib/serial.h>
 #endif
 
+// measure the latency between capture events and the interrupt handler
+// entry, see Bus::latencyStatistics()
+//#define BUS_ISR_LATENCY
+
+// measure how long received telegrams sit in the receive ring before the
+// application dispatches them, see Bus::rxLatencyStatistics()
+//#define BUS_RX_LATENCY
+
+/** The number of histogram bins of the latency measurements */
+#define BUS_LATENCY_BINS 8
+
 class Bus;
 
 /**
@@ -26,6 +38,69 @@ class Bus;
  */
 extern Bus bus;
 
+/**
+ * Statistics counters of the bus, updated by the bus interrupt handler.
+ * The counters are free running; telegram rates can be derived by sampling
+ * the counters periodically from the application.
+ */
+struct BusStats
+{
+    unsigned int rxTelegrams;    //!< Valid telegrams received
+    unsigned int txTelegrams;    //!< Telegrams sent (including unacknowledged ones)
+    unsigned int repeats;        //!< Telegram transmissions that were repeats
+    unsigned int collisions;     //!< Collisions detected while sending
+    unsigned int nackAcks;       //!< NACK acknowledgments received for sent telegrams
+    unsigned int busyAcks;       //!< BUSY acknowledgments received for sent telegrams
+    unsigned int checksumErrors; //!< Received frames with parity or checksum errors
+    unsigned int rxOverruns;     //!< Received telegrams dropped: receive ring full
+    unsigned int rxFiltered;     //!< Received telegrams dropped early: addressed to another device
+};
+
+#ifdef BUS_ISR_LATENCY
+
+/**
+ * ISR latency self measurement, updated by the bus interrupt handler when
+ * BUS_ISR_LATENCY is defined. The latency is the time in usec between a
+ * capture event on the bus and the handler reading the timer - what flash
+ * writes, SPI transfers or other interrupts delayed the handler by.
+ *
+ * bins[n] counts latencies from 2^n to 2^(n+1)-1 usec, bins[0] also
+ * counts 0 and the last bin is open ended. min is ~0 until the first
+ * sample was taken.
+ */
+struct BusIsrLatency
+{
+    unsigned int min;            //!< The lowest latency seen, in usec
+    unsigned int max;            //!< The highest latency seen, in usec
+    unsigned int samples;        //!< The number of capture events measured
+    unsigned int bins[BUS_LATENCY_BINS]; //!< The latency histogram
+};
+
+#endif /*BUS_ISR_LATENCY*/
+
+#ifdef BUS_RX_LATENCY
+
+/**
+ * RX dispatch latency measurement, updated when the telegram dispatcher
+ * starts processing bus.telegram[] and BUS_RX_LATENCY is defined. The
+ * latency is the time in usec between the completion of a received frame
+ * in the bus interrupt handler and its dispatch from the main loop - the
+ * key number for sizing the receive ring and spotting sluggish devices.
+ *
+ * bins[n] counts latencies from 2^n to 2^(n+1)-1 usec, bins[0] also
+ * counts 0 and the last bin is open ended. min is ~0 until the first
+ * sample was taken.
+ */
+struct BusRxLatency
+{
+    unsigned int min;            //!< The lowest latency seen, in usec
+    unsigned int max;            //!< The highest latency seen, in usec
+    unsigned int samples;        //!< The number of dispatched telegrams measured
+    unsigned int bins[BUS_LATENCY_BINS]; //!< The latency histogram
+};
+
+#endif /*BUS_RX_LATENCY*/
+
 
 /**
  * Bus short acknowledgment frame: acknowledged
@@ -48,10 +123,41 @@ extern Bus bus;
  */
 #define SB_BUS_NACK_BUSY 0x00
 
+/**
+ * Telegram repeat flag in byte #0 of the telegram: 1=not repeated, 0=repeated
+ */
+#define SB_TEL_REPEAT_FLAG 0x20
+
 
 // The size of the telegram buffer in bytes
 #define SB_TELEGRAM_SIZE 24
 
+/**
+ * The number of buffers in the telegram receive ring. Telegrams that arrive
+ * while the application is still processing bus.telegram[] are stored in the
+ * ring instead of being dropped. Must be at least 2.
+ */
+#ifndef BUS_RX_BUFFER_COUNT
+#define BUS_RX_BUFFER_COUNT 4
+#endif
+
+/**
+ * The number of telegrams that can be queued for sending, in addition to the
+ * telegram that is currently being sent. The queue is ordered by the KNX
+ * priority in the control byte: system, alarm, high, low.
+ */
+#ifndef BUS_TX_QUEUE_SIZE
+#define BUS_TX_QUEUE_SIZE 8
+#endif
+
+/**
+ * The number of telegram buffers in the send pool that can be acquired with
+ * acquireTelegram().
+ */
+#ifndef BUS_TX_POOL_SIZE
+#define BUS_TX_POOL_SIZE 4
+#endif
+
 /**
  * The telegram that is currently being sent.
  */
@@ -76,6 +182,70 @@ extern unsigned char sendAck;
 #define sb_prog_mode_active() (sbUserRam->status & 1)
 
 
+/**
+ * One frame captured in bus monitor mode: a complete telegram, a corrupt
+ * frame or a single acknowledge byte, together with a timestamp.
+ */
+struct BusMonFrame
+{
+    unsigned int time;           //!< Capture timestamp in microseconds
+    byte length;                 //!< The number of bytes in data[]
+    byte flags;                  //!< Frame flags, see BUS_MON_FRAME_*
+    byte data[SB_TELEGRAM_SIZE]; //!< The raw frame bytes
+};
+
+/**
+ * Bus monitor frame flag: the frame has valid parity and checksum
+ */
+#define BUS_MON_FRAME_VALID 0x01
+
+/**
+ * Bus monitor frame flag: a collision occurred during the frame
+ */
+#define BUS_MON_FRAME_COLLISION 0x02
+
+#ifdef DUMP_TELEGRAMS
+
+/**
+ * The number of records in the telegram trace ring. Must be a power of two.
+ */
+#ifndef TEL_TRACE_RECORDS
+#define TEL_TRACE_RECORDS 8
+#endif
+
+/**
+ * One record of the telegram trace ring: a sent or received telegram with a
+ * timestamp. The bus code appends binary records and bcu.loop() formats and
+ * prints them over the serial port, so no printing happens in the time
+ * critical context.
+ */
+struct TelTraceRecord
+{
+    unsigned int time;           //!< Trace timestamp in microseconds
+    byte direction;              //!< 0 for a received, 1 for a sent telegram
+    byte length;                 //!< The number of bytes in data[]
+    byte data[SB_TELEGRAM_SIZE]; //!< The raw telegram bytes
+};
+
+extern TelTraceRecord telTrace[TEL_TRACE_RECORDS];
+extern volatile int telTraceHead;   //!< The next record to print
+extern volatile int telTraceTail;   //!< The next free record
+extern volatile unsigned int telTraceDropped; //!< Records lost on ring overflow
+
+/**
+ * Append a telegram to the trace ring. The record is dropped and counted
+ * when the ring is full. Call with interrupts disabled when not calling
+ * from the bus interrupt handler.
+ *
+ * @param direction - 0 for a received, 1 for a sent telegram
+ * @param data - the raw telegram bytes
+ * @param length - the number of telegram bytes
+ */
+void traceTelegram(int direction, const byte* data, int length);
+
+#endif /* DUMP_TELEGRAMS */
+
+
 /**
  * Low level class for EIB bus access.
  *
@@ -125,11 +295,90 @@ public:
      * Send a telegram. The checksum byte will be added at the end of telegram[].
      * Ensure that there is at least one byte space at the end of telegram[].
      *
+     * The telegram is queued for sending. Queued telegrams are sent ordered by
+     * the KNX priority of their control byte. If the queue is full this method
+     * blocks until a queue slot becomes free.
+     *
      * @param telegram - the telegram to be sent.
      * @param length - the length of the telegram in sbSendTelegram[], without the checksum
      */
     void sendTelegram(unsigned char* telegram, unsigned short length);
 
+    /**
+     * Acquire a telegram buffer from the send pool. The application can
+     * format the buffer and queue it with queueTelegram() while earlier
+     * telegrams are still on the wire, without waiting for
+     * sendingTelegram() to become false. The buffer is returned to the
+     * pool automatically when sending is done.
+     *
+     * @return The telegram buffer, 0 if all pool buffers are in use.
+     */
+    byte* acquireTelegram();
+
+    /**
+     * Queue a telegram that was acquired with acquireTelegram() for
+     * sending. The checksum byte is added at the end of the telegram, as
+     * with sendTelegram(). The buffer must not be touched by the
+     * application after this call.
+     *
+     * @param telegram - the telegram to be sent.
+     * @param length - the length of the telegram, without the checksum.
+     */
+    void queueTelegram(byte* telegram, unsigned short length);
+
+    /**
+     * Replace part of a telegram that is still waiting in the send queue.
+     * If the buffer is still queued and its destination address matches,
+     * the given bytes are copied into the telegram and the checksum is
+     * recalculated. Used to coalesce rapid value changes into the telegram
+     * that is already queued, instead of queueing another one.
+     *
+     * @param telegram - the queued telegram buffer.
+     * @param destAddr - the expected destination address, as a guard
+     *                   against the buffer having been reused meanwhile.
+     * @param data - the bytes to copy into the telegram.
+     * @param offset - the offset in the telegram to copy to.
+     * @param count - the number of bytes to copy.
+     * @return True if the queued telegram was updated, false if it already
+     *         left the queue.
+     */
+    bool updateQueuedTelegram(byte* telegram, int destAddr, const byte* data, int offset, int count);
+
+    /**
+     * Send a telegram that is already fully prepared: the sender address and
+     * the checksum byte are taken as-is and the length is derived from the
+     * telegram itself. Used by line couplers to forward telegrams without
+     * rewriting the sender address.
+     *
+     * @param telegram - the telegram to be sent, including the checksum.
+     * @param owner - the bus whose receive ring owns the buffer, or 0. If
+     *                set, the buffer is returned to the owner when sending
+     *                is done.
+     */
+    void sendPreparedTelegram(unsigned char* telegram, Bus* owner);
+
+    /**
+     * Forward the received telegram to another bus line without copying it:
+     * the receive ring buffer itself is queued for sending on the
+     * destination bus and is only reused after the destination has sent it.
+     * The received telegram is discarded on this bus.
+     *
+     * @param dest - the bus to forward the telegram to.
+     * @return True if the telegram was forwarded, false if there is no
+     *         received telegram.
+     */
+    bool forwardReceivedTelegram(Bus& dest);
+
+    /**
+     * Return a receive ring buffer that was lent out by
+     * forwardReceivedTelegram(), or a send pool buffer that was acquired
+     * with acquireTelegram(). Called by the destination bus when it is
+     * done sending the telegram.
+     *
+     * @param telegram - the buffer to release.
+     */
+    void releaseForwardedBuffer(byte* telegram);
+
     /**
      * This method is called by the timer interrupt handler.
      * Consider it to be a private method and do not call it.
@@ -168,6 +417,98 @@ public:
      */
     void maxSendTries(int tries);
 
+    /**
+     * Set the inter telegram gaps in bit times. The gap is the pause the
+     * send path inserts before its own transmission, counted from the end
+     * of the previous frame; the spec minimum is 50 bit times, and the
+     * BUSY backoff is 150 bit times. Different situations get their own
+     * gap, so the common case - the telegram was acknowledged and the
+     * next one is waiting - does not pay the pause of the worst case:
+     *
+     * @param freeBus - after foreign traffic or our own unacknowledged
+     *                  frame. Default: 50.
+     * @param afterAck - after the ACK of our telegram, before the next
+     *                   queued telegram. Default: 50.
+     * @param afterNack - before the repeat after a NACK. Default: 50.
+     * @param afterBusy - before the repeat after a BUSY, the remote asked
+     *                    for a backoff. Default: 150.
+     *
+     * The defaults are spec-minimal; raise individual gaps for
+     * certification margins with conservative test equipment.
+     */
+    void setInterFrameGaps(int freeBus, int afterAck, int afterNack,
+        int afterBusy);
+
+    /**
+     * Get the bus statistics counters.
+     */
+    const BusStats& statistics() const;
+
+    /**
+     * Reset all bus statistics counters to zero.
+     */
+    void clearStatistics();
+
+#ifdef BUS_ISR_LATENCY
+    /**
+     * Get the ISR latency measurement. See BusIsrLatency for the
+     * semantics of the counters and bins.
+     */
+    const BusIsrLatency& latencyStatistics() const;
+
+    /**
+     * Reset the ISR latency measurement.
+     */
+    void clearLatencyStatistics();
+#endif
+
+#ifdef BUS_RX_LATENCY
+    /**
+     * Record the dispatch latency of the telegram in bus.telegram[]: the
+     * time it sat in the receive ring between frame completion and now.
+     * Called by the telegram dispatcher when it starts processing.
+     */
+    void recordRxLatency();
+
+    /**
+     * Get the RX dispatch latency measurement. See BusRxLatency for the
+     * semantics of the counters and bins.
+     */
+    const BusRxLatency& rxLatencyStatistics() const;
+
+    /**
+     * Reset the RX dispatch latency measurement.
+     */
+    void clearRxLatencyStatistics();
+#endif
+
+#ifndef SBLIB_NO_BUS_MONITOR
+    /**
+     * Enable bus monitor capture mode. The interrupt handler then records
+     * every frame seen on the bus - valid telegrams, corrupt frames and
+     * acknowledge bytes - with a microsecond timestamp into the supplied
+     * ring of frames. Capturing is independent of normal telegram
+     * processing and does not copy telegram payloads twice.
+     *
+     * @param frames - the frame ring to capture into.
+     * @param count - the number of frames in the ring.
+     */
+    void monitorBegin(BusMonFrame* frames, int count);
+
+    /**
+     * Disable bus monitor capture mode.
+     */
+    void monitorEnd();
+
+    /**
+     * Read the oldest captured frame from the monitor ring.
+     *
+     * @param frame - the frame is copied here.
+     * @return True if a frame was read, false if the ring is empty.
+     */
+    bool monitorRead(BusMonFrame& frame);
+#endif /*!SBLIB_NO_BUS_MONITOR*/
+
     /** The state of the telegram sending/receiving */
     enum State
     {
@@ -189,9 +530,10 @@ public:
     };
 
     /**
-     * The received telegram.
+     * The received telegram. Points to the oldest not yet processed buffer
+     * of the receive ring.
      */
-    byte telegram[TELEGRAM_SIZE];
+    byte* telegram;
 
     /**
      * The total length of the received telegram in telegram[].
@@ -209,6 +551,15 @@ private:
      */
     void sendNextTelegram();
 
+    /**
+     * Queue a telegram for sending, ordered by KNX priority, and start
+     * sending if the bus is idle.
+     *
+     * @param telegram - the telegram to queue, with valid checksum.
+     * @param owner - the bus that owns the buffer, or 0.
+     */
+    void enqueueTelegram(unsigned char* telegram, Bus* owner);
+
     /**
      * Prepare the telegram for sending. Set the sender address to our own
      * address, and calculate the checksum of the telegram.
@@ -242,18 +593,74 @@ private:
     volatile State state;                 //!< The state of the lib's telegram sending/receiving
     volatile int sendTries;               //!< The number of repeats when sending a telegram
     volatile int sendTriesMax;            //!< The maximum number of repeats when sending a telegram. Default: 3
+    unsigned short gapFreeBus;   //!< Send gap after foreign traffic, in usec
+    unsigned short gapAfterAck;  //!< Send gap after the ACK of our telegram, in usec
+    unsigned short gapAfterNack; //!< Send gap before the repeat after a NACK, in usec
+    unsigned short gapAfterBusy; //!< Send gap before the repeat after a BUSY, in usec
     int nextByteIndex;           //!< The number of the next byte in the telegram
 
     int currentByte;             //!< The current byte that is received/sent, including the parity bit
+    byte rxBuffer[BUS_RX_BUFFER_COUNT][TELEGRAM_SIZE]; //!< The ring of receive telegram buffers
+    byte txPool[BUS_TX_POOL_SIZE][TELEGRAM_SIZE]; //!< The pool of send telegram buffers
+    volatile byte txPoolBusy[BUS_TX_POOL_SIZE];   //!< Send pool buffer state: 0=free, 1=in use
+    byte rxOverflow[TELEGRAM_SIZE]; //!< Receive buffer used when the ring is full
+#ifdef BUS_RX_LATENCY
+    volatile unsigned int rxTime[BUS_RX_BUFFER_COUNT]; //!< Frame completion time per ring buffer, in usec
+    BusRxLatency rxLatency;      //!< The RX dispatch latency measurement
+#endif
+    volatile short rxLen[BUS_RX_BUFFER_COUNT]; //!< Telegram length per ring buffer: 0=free, -1=lent out
+    volatile int rxHead;         //!< The ring buffer that the interrupt handler fills next
+    volatile int rxTail;         //!< The oldest ring buffer that the application has not yet processed
+    byte* rxTelegram;            //!< The ring buffer that is currently being received into
     int sendTelegramLen;         //!< The size of the to be sent telegram in bytes (including the checksum).
     volatile byte *sendCurTelegram;       //!< The telegram that is currently being sent.
-    volatile byte *sendNextTel;           //!< The telegram to be sent after sbSendTelegram is done.
+    volatile byte *sendQueue[BUS_TX_QUEUE_SIZE]; //!< The queued telegrams, ordered by KNX priority
+    Bus* sendQueueOwner[BUS_TX_QUEUE_SIZE]; //!< Owner bus per queued telegram, 0 if not forwarded
+    volatile int sendQueueCount;          //!< The number of telegrams in sendQueue[]
+    Bus* sendCurOwner;                    //!< Owner bus of the telegram being sent, 0 if not forwarded
     int bitMask;
+#ifndef SBLIB_NO_BUS_MONITOR
+    /**
+     * Capture the just received frame into the bus monitor ring.
+     *
+     * @param valid - true if the frame had valid parity and checksum
+     */
+    void captureMonitorFrame(bool valid);
+#endif
+
+    /**
+     * Decide during reception whether the incoming telegram is addressed to
+     * us and shall be acknowledged. Called as soon as the destination
+     * address and flags byte have arrived, so the ACK is pre-armed when the
+     * last byte closes.
+     */
+    void prepareAck();
+
+    /**
+     * Early destination pre-filter. Called as soon as the destination
+     * address word is complete, one byte before prepareAck(). A telegram
+     * that matches neither our physical address nor the group address
+     * filter cannot be for us no matter what the address type flag says,
+     * so the remaining bytes skip the parity, checksum and buffer work.
+     */
+    void earlyAddressFilter();
+
+    BusStats stats;              //!< The bus statistics counters
+#ifdef BUS_ISR_LATENCY
+    BusIsrLatency latency;       //!< The ISR latency measurement
+#endif
+#ifndef SBLIB_NO_BUS_MONITOR
+    BusMonFrame* monFrames;      //!< The bus monitor frame ring, 0 if monitoring is disabled
+    int monCount;                //!< The number of frames in monFrames[]
+    volatile int monHead;        //!< The monitor ring frame that the ISR writes next
+    volatile int monTail;        //!< The oldest unread monitor ring frame
+#endif
     int bitTime;                 // The bit-time within a byte when receiving
-    int parity;                  // Parity bit of the current byte
     int valid;                   // 1 if parity is valid for all bits of the telegram
     int checksum;                // Checksum of the telegram: 0 if valid at end of telegram
     bool collision;              // A collision occurred
+    volatile bool preProcessTel; // The incoming telegram is for us, decided during reception
+    volatile bool rxDropped;     // The incoming telegram is for another device, skip the byte work
 };
 
 
@@ -291,7 +698,7 @@ inline bool Bus::idle() const
 
 inline int Bus::ownAddress() const
 {
-    return bus.ownAddr;
+    return ownAddr;
 }
 
 inline void Bus::maxSendTries(int tries)
@@ -299,6 +706,25 @@ inline void Bus::maxSendTries(int tries)
     sendTriesMax = tries;
 }
 
+inline const BusStats& Bus::statistics() const
+{
+    return stats;
+}
+
+#ifdef BUS_ISR_LATENCY
+inline const BusIsrLatency& Bus::latencyStatistics() const
+{
+    return latency;
+}
+#endif
+
+#ifdef BUS_RX_LATENCY
+inline const BusRxLatency& Bus::rxLatencyStatistics() const
+{
+    return rxLatency;
+}
+#endif
+
 inline bool Bus::sendingTelegram() const
 {
     return sendCurTelegram != 0;
@@ -311,7 +737,22 @@ inline bool Bus::telegramReceived() const
 
 inline void Bus::discardReceivedTelegram()
 {
+    noInterrupts();
     telegramLen = 0;
+
+    if (rxLen[rxTail] > 0)  // Advance the ring if the telegram came from it
+    {
+        rxLen[rxTail] = 0;
+        if (++rxTail == BUS_RX_BUFFER_COUNT)
+            rxTail = 0;
+
+        if (rxLen[rxTail] > 0)  // Publish the next pending telegram, if any
+        {
+            telegram = rxBuffer[rxTail];
+            telegramLen = rxLen[rxTail];
+        }
+    }
+    interrupts();
 }
 
 inline void Bus::end()
@@ -128,6 +128,17 @@ void objectWriteFloat(int objno, int value);
  */
 void objectWritten(int objno);
 
+/**
+ * Tell the library that the value of a communication object was stored
+ * directly, bypassing objectWrite(). The cached read response is
+ * invalidated and the given flags are raised, unless the new value could
+ * be coalesced into an already queued telegram.
+ *
+ * @param objno - the ID of the communication object.
+ * @param flags - the flags to add (e.g. COMFLAG_TRANSREQ).
+ */
+void objectValueStored(int objno, int flags);
+
 /**
  * Set the value of a communication object and mark the communication object
  * as updated. This does not trigger a write-group-value telegram.
@@ -168,6 +179,117 @@ void objectUpdateFloat(int objno, int value);
  */
 void setObjectValue(int objno, unsigned int value);
 
+/**
+ * Set the handler that is called when a communication object was updated
+ * by a write or response telegram from the bus.
+ *
+ * The handler is called from processGroupTelegram(), i.e. in the context
+ * of bcu.loop(), with the ID of the updated object. With a handler the
+ * application no longer needs to poll nextUpdatedObject() in its loop;
+ * the update flags are still maintained, so both can be combined.
+ *
+ * @param handler - the handler to call, 0 to remove the handler.
+ */
+void setObjectUpdateHandler(void (*handler)(int objno));
+
+/**
+ * Test if any communication object is waiting to be transmitted. This is
+ * a few word compares and can be polled cheaply, e.g. to decide if the
+ * device may sleep.
+ *
+ * @return True if a transmission request is pending.
+ */
+bool objectTransmitPending();
+
+/**
+ * Write the values of multiple communication objects at once. All values
+ * are updated and marked for sending, and the transmit scanner is primed
+ * once, so the burst streams out back-to-back through the send queue.
+ *
+ * @param objnos - the IDs of the communication objects.
+ * @param values - the new values of the communication objects.
+ * @param count - the number of communication objects.
+ */
+void objectWriteMultiple(const int* objnos, const unsigned int* values, int count);
+
+/**
+ * Write a part of a communication object's value, e.g. one chunk of a
+ * 14 byte DPT16 status text. The write-group-value telegram is only
+ * triggered by the chunk that completes the value, i.e. when
+ * offset + len reaches objectSize(objno); earlier chunks just update
+ * the value bytes.
+ *
+ * @param objno - the ID of the communication object.
+ * @param offset - the offset in the communication object's value.
+ * @param data - the bytes to write.
+ * @param len - the number of bytes to write.
+ */
+void objectWritePartial(int objno, int offset, const byte* data, int len);
+
+/**
+ * Enable or disable transmit coalescing for a communication object.
+ *
+ * When enabled and objectWrite() is called while the object's previous
+ * write telegram is still waiting in the send queue, the new value is
+ * patched into the queued telegram instead of producing an extra one.
+ * This reduces bus load when an object is rewritten faster than the bus
+ * drains (e.g. dimming loops), and the last value always wins.
+ *
+ * Only objects with an ID below OBJ_CACHE_SIZE can be coalesced.
+ *
+ * @param objno - the ID of the communication object.
+ * @param enable - true to coalesce writes of the object.
+ */
+void objectCoalesce(int objno, bool enable);
+
+/**
+ * The number of com-objects that can have a telegram rate limit at the
+ * same time.
+ */
+#ifndef OBJ_RATE_LIMITS
+#define OBJ_RATE_LIMITS 8
+#endif
+
+/**
+ * Limit the rate of group telegrams that a communication object sends.
+ *
+ * The limit is a token bucket: the object may send bursts of up to burst
+ * telegrams, and earns telPerSecond new telegrams per second. While the
+ * bucket is empty the transmission request stays pending and the value can
+ * still be overwritten, so bursty updates are spread out and the last
+ * value always wins - the same pending-value semantics as objectCoalesce().
+ *
+ * @param objno - the ID of the communication object.
+ * @param telPerSecond - the sustained telegram rate, 0 removes the limit.
+ * @param burst - the maximum telegram burst (at least 1).
+ */
+void objectRateLimit(int objno, int telPerSecond, int burst);
+
+/**
+ * The number of com-objects that can be sent cyclically at the same
+ * time.
+ */
+#ifndef OBJ_CYCLIC_SENDS
+#define OBJ_CYCLIC_SENDS 8
+#endif
+
+/**
+ * Send a communication object cyclically, e.g. a heartbeat or a periodic
+ * sensor value. Every interval the object is marked as written, as if
+ * objectWritten() was called - the current value goes out without the
+ * application keeping its own Timeout. The intervals are typically ETS
+ * parameters read from the userEeprom.
+ *
+ * The first transmission of each object is phase staggered over its
+ * interval, so the cyclic objects of a device do not all queue in the
+ * same loop pass and flood the send queue.
+ *
+ * @param objno - the ID of the communication object.
+ * @param intervalMs - the send interval in milliseconds, 0 stops the
+ *                     cyclic sending of the object.
+ */
+void objectSendCyclic(int objno, unsigned int intervalMs);
+
 /**
  * Get the ID of the next communication object that was updated
  * over the bus by a write-value-request telegram.
@@ -176,6 +298,68 @@ void setObjectValue(int objno, unsigned int value);
  */
 int nextUpdatedObject();
 
+/**
+ * Add one or more flags to the flags of a communication object. This does
+ * not clear any flag of the communication object.
+ *
+ * @param objno - the ID of the communication object.
+ * @param flags - the flags to add (e.g. COMFLAG_UPDATE).
+ */
+void addObjectFlags(int objno, int flags);
+
+/**
+ * Add flags to a group of 8 communication objects in one go. The group
+ * starts at firstObjno, which must be a multiple of 8; bit N of objnoMask
+ * selects the object firstObjno+N. All selected objects get the same flags
+ * added, word-parallel over the 4 bit flag nibbles instead of one
+ * shift/mask pass per object.
+ *
+ * @param firstObjno - the ID of the first object of the group, a multiple of 8.
+ * @param objnoMask - the objects to change, one bit per object.
+ * @param flags - the flags to add (e.g. COMFLAG_TRANSREQ).
+ */
+void addObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags);
+
+/**
+ * Clear flags of a group of 8 communication objects in one go, the
+ * counterpart of addObjectFlagsMasked().
+ *
+ * @param firstObjno - the ID of the first object of the group, a multiple of 8.
+ * @param objnoMask - the objects to change, one bit per object.
+ * @param flags - the flags to clear (e.g. COMFLAG_UPDATE).
+ */
+void clearObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags);
+
+/**
+ * Test the flags of a group of 8 communication objects in one go.
+ *
+ * @param firstObjno - the ID of the first object of the group, a multiple of 8.
+ * @param objnoMask - the objects to test, one bit per object.
+ * @param flags - the flags to test for.
+ * @return A mask with bit N set if the object firstObjno+N has any of the
+ *         given flags set.
+ */
+unsigned int testObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags);
+
+/**
+ * Clear the transmission status of all communication objects, e.g. after
+ * a bus reset when queued transmit requests have become stale. Processes
+ * the flags table in groups of 8 objects instead of per object.
+ */
+void clearTransmitFlags();
+
+/**
+ * Collect all communication objects that were updated over the bus into a
+ * bit set and clear their update flags, as a bulk alternative to calling
+ * nextUpdatedObject() per object. Bit N of snapshot[N / 32] is set if the
+ * object N was updated.
+ *
+ * @param snapshot - the array to fill, one bit per object. Must hold at
+ *                   least (objectCount() + 31) / 32 words.
+ * @return The number of words written to snapshot.
+ */
+int snapshotUpdatedObjects(unsigned int* snapshot);
+
 /**
  * Get the type of a communication object.
  *
@@ -211,6 +395,48 @@ const ComConfig& objectConfig(int objno);
  */
 void processGroupTelegram(int addr, int apci);
 
+/**
+ * The number of com-objects whose value pointer and size are precomputed
+ * by updateObjectCache(). Objects beyond the cache are resolved through
+ * the config table on every access.
+ */
+#ifndef OBJ_CACHE_SIZE
+#define OBJ_CACHE_SIZE 64
+#endif
+
+/**
+ * Rebuild the precomputed per-object value pointers and sizes, and the
+ * cached flags table pointer, from the config table. Called by bcu.begin()
+ * and after the config tables were changed by memory write telegrams.
+ */
+void updateObjectCache();
+
+/**
+ * A precomposed response telegram for a group value read request.
+ *
+ * @see enableGroupReadCache()
+ */
+struct GroupReadResponse
+{
+    byte length;                    //!< The telegram length, 0 if the entry is invalid
+    byte data[Bus::TELEGRAM_SIZE];  //!< The composed response telegram
+};
+
+/**
+ * Enable the cache for group value read responses. When enabled, the response
+ * telegram for a read request is composed once and reused until the value of
+ * the communication object changes. Devices that get read-polled by
+ * visualizations then answer with a single queue push instead of assembling
+ * the telegram on every request.
+ *
+ * The cache holds one entry per communication object. Objects with an ID
+ * beyond the last entry are answered without the cache, as before.
+ *
+ * @param cache - the cache entries, one per communication object.
+ * @param count - the number of cache entries.
+ */
+void enableGroupReadCache(GroupReadResponse* cache, int count);
+
 /**
  * Get the communication object configuration table ("COMMS" table). This is the table
  * with the flags that are configured by ETS (not the RAM status flags).
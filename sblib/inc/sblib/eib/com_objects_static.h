@@ -0,0 +1,201 @@
+/*
+ *  com_objects_static.h - Compile time communication object definitions.
+ *
+ *  For firmware with a fixed object layout the com-objects can be
+ *  described at compile time, in addition to the ETS generated tables.
+ *  The COM_OBJECT() macro declares the type and user RAM offset of an
+ *  object - the same values that the ETS product database configures -
+ *  and obj<objno>() returns a typed accessor whose value access
+ *  compiles to direct loads and stores, without the runtime table
+ *  lookups.
+ *
+ *  Example:
+ *
+ *  COM_OBJECT(0, BIT_1, 0x56)   // the switch object, at userRam 0x56
+ *  COM_OBJECT(1, BYTE_2, 0x57)  // the temperature object
+ *
+ *  obj<1>().write(2101);
+ *  if (obj<0>().read()) ...
+ *
+ *  The declarations must match the ETS tables: programming the device
+ *  with different settings leaves the typed accessors on the wrong
+ *  location. Only objects with their value in the user RAM can be
+ *  declared this way.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_com_objects_static_h
+#define sblib_com_objects_static_h
+
+#include <sblib/eib/com_objects.h>
+#include <sblib/eib/user_memory.h>
+
+/**
+ * The value size of a com-object type in bytes, as a compile time
+ * constant. The sizes match objectSize().
+ */
+template<int objtype>
+struct ComObjectTypeSize
+{
+    enum
+    {
+        size = objtype <= BYTE_1 ? 1
+             : objtype <= BYTE_4 ? objtype - 6
+             : objtype == DATA_6 ? 6
+             : objtype == DATA_8 ? 8
+             : objtype == DATA_10 ? 10
+             : objtype == MAXDATA ? 14
+             : 15
+    };
+};
+
+/**
+ * The compile time definition of a com-object. The COM_OBJECT() macro
+ * creates one specialization per object - accessing an object that was
+ * not declared does not compile.
+ */
+template<int objno> struct ComObjectDef;
+
+/**
+ * Declare a com-object at compile time.
+ *
+ * @param objno - the ID of the communication object.
+ * @param objtype - the object type (see enum ComType).
+ * @param ramOffset - the offset of the object's value in the user RAM.
+ */
+#define COM_OBJECT(objno, objtype, ramOffset) \
+    template<> struct ComObjectDef<objno> \
+    { \
+        enum { type = (objtype), offset = (ramOffset) }; \
+    };
+
+/**
+ * A typed accessor for a com-object that was declared with
+ * COM_OBJECT(). The object ID, value offset and size are template
+ * constants, so the value access compiles to direct loads and stores.
+ * Use obj<objno>() to get the accessor.
+ */
+template<int objno>
+class TypedComObject
+{
+public:
+    enum
+    {
+        type = ComObjectDef<objno>::type,      //!< The object type, see enum ComType
+        offset = ComObjectDef<objno>::offset,  //!< The value offset in the user RAM
+        size = ComObjectTypeSize<ComObjectDef<objno>::type>::size  //!< The value size in bytes
+    };
+
+    /**
+     * Get a pointer to the value bytes of the com-object.
+     *
+     * @return The pointer to the value.
+     */
+    byte* valuePtr() const
+    {
+        return userRamData + offset;
+    }
+
+    /**
+     * Get the numeric value of the com-object. For objects of type
+     * 1 bit up to 4 bytes.
+     *
+     * @return The value of the com-object.
+     */
+    unsigned int read() const
+    {
+        const byte* ptr = userRamData + offset;
+        unsigned int value = ptr[0];
+
+        if (size > 1) value |= ptr[1] << 8;
+        if (size > 2) value |= ptr[2] << 16;
+        if (size > 3) value |= (unsigned int) ptr[3] << 24;
+
+        return value;
+    }
+
+    /**
+     * Set the value of the com-object and mark it for sending a
+     * write-group-value telegram. For objects of type 1 bit up to
+     * 4 bytes.
+     *
+     * @param value - the new value of the com-object.
+     */
+    void write(unsigned int value)
+    {
+        store(value);
+        valueStored(COMFLAG_TRANSREQ);
+    }
+
+    /**
+     * Set the value of a com-object that is larger than 4 bytes and
+     * mark it for sending a write-group-value telegram.
+     *
+     * @param value - the new value of the com-object, size bytes.
+     */
+    void write(const byte* value)
+    {
+        byte* ptr = userRamData + offset;
+
+        for (int i = 0; i < (int) size; ++i)
+            ptr[i] = value[i];
+
+        valueStored(COMFLAG_TRANSREQ);
+    }
+
+    /**
+     * Set the value of the com-object without triggering the sending
+     * of a write-group-value telegram.
+     *
+     * @param value - the new value of the com-object.
+     */
+    void update(unsigned int value)
+    {
+        store(value);
+        valueStored(COMFLAG_UPDATE);
+    }
+
+    /**
+     * Request the read of the com-object from the bus.
+     *
+     * @see requestObjectRead(int)
+     */
+    void requestRead()
+    {
+        requestObjectRead(objno);
+    }
+
+private:
+    void store(unsigned int value)
+    {
+        byte* ptr = userRamData + offset;
+
+        ptr[0] = value;
+        if (size > 1) ptr[1] = value >> 8;
+        if (size > 2) ptr[2] = value >> 16;
+        if (size > 3) ptr[3] = value >> 24;
+    }
+
+    void valueStored(int flags)
+    {
+        objectValueStored(objno, flags);
+    }
+};
+
+/**
+ * Get the typed accessor of a com-object that was declared with
+ * COM_OBJECT().
+ *
+ * @return The typed accessor of the com-object.
+ */
+template<int objno>
+inline TypedComObject<objno> obj()
+{
+    return TypedComObject<objno>();
+}
+
+#endif /*sblib_com_objects_static_h*/
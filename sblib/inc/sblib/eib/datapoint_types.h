@@ -36,5 +36,25 @@ unsigned short dptToFloat(int value);
  */
 int dptFromFloat(unsigned short dptValue);
 
+/**
+ * Convert an array of int values to 2 byte floats (DPT9/EIS5),
+ * e.g. for multi-channel sensors that convert all channels per
+ * measurement cycle.
+ *
+ * @param values - the values to convert.
+ * @param dptValues - the array that receives the 2 byte floats.
+ * @param count - the number of values to convert.
+ */
+void dptToFloatArray(const int* values, unsigned short* dptValues, int count);
+
+/**
+ * Convert an array of 2 byte floats (DPT9/EIS5) to int values.
+ *
+ * @param dptValues - the 2 byte floats to convert.
+ * @param values - the array that receives the values.
+ * @param count - the number of values to convert.
+ */
+void dptFromFloatArray(const unsigned short* dptValues, int* values, int count);
+
 
 #endif /*sblib_datapoint_types_h*/
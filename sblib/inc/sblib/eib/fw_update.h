@@ -0,0 +1,227 @@
+/*
+ *  fw_update.h - Firmware update over the bus into an inactive flash bank.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_fw_update_h
+#define sblib_fw_update_h
+
+#include <sblib/platform.h>
+#include <sblib/types.h>
+
+/**
+ * The magic word of an activated firmware image descriptor: "SBFW".
+ */
+#define FW_DESCRIPTOR_MAGIC 0x57464253
+
+/**
+ * The commands of the firmware update memory window, see
+ * FirmwareUpdate::setMemoryWindow().
+ */
+enum FwUpdateCommand
+{
+    FW_CMD_BEGIN = 1,    //!< start an update, the argument is the image size
+    FW_CMD_FINISH = 2,   //!< end the stream, the argument is the image CRC-32
+    FW_CMD_ACTIVATE = 3  //!< write the descriptor of the verified image
+};
+
+/**
+ * The states of a firmware update, see FirmwareUpdate::state().
+ */
+enum FwUpdateState
+{
+    FW_IDLE,       //!< no update is in progress
+    FW_RECEIVING,  //!< an update is in progress, image data is expected
+    FW_VERIFIED,   //!< the image is complete and its CRC matched
+    FW_FAILED      //!< the update failed: CRC mismatch or stream error
+};
+
+/**
+ * The descriptor of an activated firmware image. It occupies the last
+ * flash page of the bank; the boot side compares it against the image
+ * before switching banks, so a half-written image is never started.
+ */
+struct FwDescriptor
+{
+    unsigned int magic;  //!< FW_DESCRIPTOR_MAGIC when the image is activated
+    unsigned int size;   //!< The size of the image in bytes
+    unsigned int crc;    //!< The CRC-32 of the image
+};
+
+/**
+ * Receives a firmware image over the bus into an inactive flash bank.
+ *
+ * The image streams in through the connection-oriented transport as
+ * ordinary memory write telegrams - batched into full flash pages, so
+ * one flash program operation covers many telegrams instead of one
+ * each. After the complete image is received, its CRC-32 is verified
+ * against the flash contents and activation programs the image
+ * descriptor into the last page of the bank. The actual bank switch
+ * happens at reboot: the boot side calls validImage() and only starts
+ * an image whose descriptor and CRC match, so the switch is atomic -
+ * a device with a broken transfer keeps running the old firmware.
+ *
+ * Example:
+ *
+ *     FirmwareUpdate fwUpdate(FLASH_BASE_ADDRESS + 0x4000, 0x3000);
+ *
+ *     void setup()
+ *     {
+ *         fwUpdate.setMemoryWindow(0x9000);
+ *         bcu.setFirmwareUpdate(&fwUpdate);
+ *         ...
+ *     }
+ *
+ * The updater tool then streams through the memory window: a
+ * FW_CMD_BEGIN write to the window base, the image data as memory
+ * writes into the data area, FW_CMD_FINISH with the CRC and
+ * FW_CMD_ACTIVATE, followed by a restart telegram.
+ */
+class FirmwareUpdate
+{
+public:
+    /**
+     * Create an updater for an inactive flash bank. The last flash page
+     * of the bank is reserved for the image descriptor.
+     *
+     * @param bankAddress - the start of the bank, on a sector boundary.
+     * @param bankSize - the size of the bank in bytes, a multiple of
+     *                   the sector size.
+     */
+    FirmwareUpdate(byte* bankAddress, unsigned int bankSize);
+
+    /**
+     * Start an update: erase the bank and expect imageSize bytes of
+     * image data.
+     *
+     * @param imageSize - the size of the image in bytes.
+     * @return True if the update was started, false if the image does
+     *         not fit the bank.
+     */
+    bool begin(unsigned int imageSize);
+
+    /**
+     * Write a chunk of the image. The chunks must arrive in order;
+     * a repeated chunk - the retransmit after a lost acknowledge - is
+     * accepted and ignored. Full flash pages are programmed as they
+     * complete.
+     *
+     * @param offset - the offset of the chunk in the image.
+     * @param data - the bytes of the chunk.
+     * @param count - the number of bytes.
+     * @return True if the chunk was accepted.
+     */
+    bool write(unsigned int offset, const byte* data, unsigned int count);
+
+    /**
+     * End the stream: program the last partial page and verify the
+     * CRC-32 of the flash contents against the expected value.
+     *
+     * @param crc - the expected CRC-32 of the image.
+     * @return True if the image is complete and its CRC matches.
+     */
+    bool finish(unsigned int crc);
+
+    /**
+     * Program the descriptor of the verified image into the last page
+     * of the bank. After the next reboot the boot side switches to the
+     * new image, see validImage().
+     *
+     * @return True if the descriptor was programmed.
+     */
+    bool activate();
+
+    /** @return The state of the update, see FwUpdateState */
+    int state() const { return updateState; }
+
+    /** @return The number of received image bytes */
+    unsigned int received() const { return recvOffset; }
+
+    /**
+     * Map the updater into the memory address space, so the update
+     * streams in as memory write telegrams, see bcu.setFirmwareUpdate().
+     * The window base takes the commands: one command byte followed by
+     * a 4 byte little endian argument. The image data area starts 16
+     * bytes above the base, a data write at base + 16 + n is the image
+     * chunk at offset n.
+     *
+     * @param base - the base address of the window, 0 unmaps.
+     */
+    void setMemoryWindow(unsigned int base);
+
+    /**
+     * Test if a memory address belongs to the updater's window.
+     *
+     * @param address - the memory address.
+     * @return True if the address belongs to the window.
+     */
+    bool handlesAddress(unsigned int address) const;
+
+    /**
+     * @return The first address of the memory window, 0 if unmapped.
+     */
+    unsigned int windowStart() const { return windowBase; }
+
+    /**
+     * @return The address behind the memory window, 0 if unmapped.
+     */
+    unsigned int windowEnd() const;
+
+    /**
+     * Process a memory write telegram of the updater's window.
+     *
+     * @param address - the memory address, see handlesAddress().
+     * @param data - the written bytes.
+     * @param count - the number of bytes.
+     */
+    void writeMem(unsigned int address, const byte* data, unsigned int count);
+
+    /**
+     * Answer a memory read telegram of the updater's window: the state
+     * byte followed by the received byte count, little endian.
+     *
+     * @param address - the memory address, see handlesAddress().
+     * @param data - the buffer to fill.
+     * @param count - the number of bytes to fill.
+     */
+    void readMem(unsigned int address, byte* data, unsigned int count);
+
+    /**
+     * Test if a bank holds an activated, intact firmware image. For the
+     * boot side: only switch to an image that passes this check.
+     *
+     * @param bankAddress - the start of the bank.
+     * @param bankSize - the size of the bank in bytes.
+     * @return True if the bank holds a valid image.
+     */
+    static bool validImage(const byte* bankAddress, unsigned int bankSize);
+
+    /**
+     * Compute the CRC-32 (IEEE 802.3, reflected) of a block.
+     *
+     * @param data - the bytes to checksum.
+     * @param count - the number of bytes.
+     * @return The CRC-32 of the block.
+     */
+    static unsigned int crc32(const byte* data, unsigned int count);
+
+private:
+    /** Program the buffered page into the flash
+     * @return True if the flash write succeeded
+     */
+    bool flushPage();
+
+    byte* bank;                //!< The start of the inactive bank
+    unsigned int bankSize;     //!< The size of the bank in bytes
+    unsigned int imageSize;    //!< The expected image size in bytes
+    unsigned int recvOffset;   //!< The number of received image bytes
+    unsigned int windowBase;   //!< The memory window base, 0: unmapped
+    int updateState;           //!< The state, see FwUpdateState
+    byte pageBuf[FLASH_PAGE_SIZE];  //!< The batch buffer of one flash page
+};
+
+#endif /*sblib_fw_update_h*/
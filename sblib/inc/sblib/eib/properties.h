@@ -26,7 +26,8 @@
 int loadProperty(int objectIdx, const byte* data, int len);
 
 /**
- * Find a property definition in a properties table.
+ * Find a property definition in a properties table. The table must be
+ * sorted by ascending property ID.
  *
  * @param id - the ID of the property to find.
  * @param table - the properties table. The last table element must be PROPERTY_DEF_TABLE_END
@@ -35,6 +36,18 @@ int loadProperty(int objectIdx, const byte* data, int len);
  */
 const PropertyDef* findProperty(PropertyID id, const PropertyDef* table);
 
+/**
+ * Find a property definition in a properties table of known size, with
+ * binary search. The table must be sorted by ascending property ID.
+ *
+ * @param id - the ID of the property to find.
+ * @param table - the properties table.
+ * @param count - the number of entries in the table.
+ *
+ * @return Pointer to the property definition, 0 if not found.
+ */
+const PropertyDef* findProperty(PropertyID id, const PropertyDef* table, int count);
+
 /**
  * Interface object type ID
  */
@@ -0,0 +1,119 @@
+/*
+ *  scene.h - ETS parameterized scene engine with direct scene recall.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_scene_h
+#define sblib_scene_h
+
+#include <sblib/types.h>
+
+/**
+ * The maximum number of scene table entries the engine can index.
+ */
+#ifndef SCENE_MAX_ENTRIES
+# define SCENE_MAX_ENTRIES 64
+#endif
+
+/**
+ * The number of KNX scene numbers (DPT17 / DPT18: 0..63).
+ */
+#define SCENE_NUMBERS 64
+
+/**
+ * A scene engine that recalls and stores ETS parameterized scenes without
+ * scanning the scene table on every telegram.
+ *
+ * The scene table lives in the user EEPROM: a count byte, then 3 bytes per
+ * entry - the scene number (0..63, other values mark the entry unused),
+ * the com object, and the value to write. begin() compiles the table into
+ * a direct index from scene number to its entries, so a recall only
+ * touches the entries of that scene and fans the values out through
+ * objectWriteMultiple() - instead of comparing scene numbers over the
+ * whole table for every object.
+ *
+ * Storing a scene copies the current com object values into the EEPROM
+ * entries of that scene. The index is unaffected: the scene membership
+ * only changes with an ETS download, after which begin() is called again
+ * anyway.
+ *
+ * Example:
+ *
+ * SceneEngine scenes;
+ * scenes.begin(0x120, OBJ_SCENE_CTRL);
+ * ...
+ * scenes.processTelegram(objno);  // from the object update handler
+ */
+class SceneEngine
+{
+public:
+    SceneEngine();
+
+    /**
+     * Compile the scene table in the user EEPROM into the recall index.
+     * Call after bcu.begin(), and again after an ETS download that
+     * changed the table.
+     *
+     * @param tableAddr - the address of the scene table in the user EEPROM.
+     * @param sceneObjno - the com object that receives the DPT18 scene
+     *                     control telegrams, -1 if processTelegram() is
+     *                     not used (default: -1).
+     */
+    void begin(int tableAddr, int sceneObjno = -1);
+
+    /**
+     * Recall a scene: write the value of every entry of the scene to its
+     * com object. The values go out through objectWriteMultiple(), so the
+     * telegrams of the scene stream out back-to-back.
+     *
+     * @param scene - the scene number, 0..63.
+     * @return The number of objects written, 0 if the scene is empty.
+     */
+    int recall(int scene);
+
+    /**
+     * Store a scene: copy the current value of every com object of the
+     * scene into its EEPROM entry, so the next recall plays the stored
+     * values. Only changed values are written and the EEPROM is marked
+     * modified for the delayed write-back.
+     *
+     * @param scene - the scene number, 0..63.
+     * @return The number of objects stored, 0 if the scene is empty.
+     */
+    int store(int scene);
+
+    /**
+     * Process a DPT18 scene control telegram of the scene com object:
+     * bit 7 selects store (1) or recall (0), bits 0..5 the scene number.
+     * Call with every updated object, e.g. from the object update handler
+     * or after nextUpdatedObject(); other objects are ignored.
+     *
+     * @param objno - the com object that was updated.
+     * @return True if the object was the scene control object.
+     */
+    bool processTelegram(int objno);
+
+    /**
+     * @return The number of indexed scene table entries.
+     */
+    int entryCount() const;
+
+private:
+    int tableAddr;                  //!< The scene table address in the user EEPROM, -1 if unset
+    short sceneObjno;               //!< The DPT18 scene control object, -1 if unset
+    byte count;                     //!< The number of indexed entries
+    byte order[SCENE_MAX_ENTRIES];  //!< The table entry indexes, grouped by scene number
+    byte first[SCENE_NUMBERS];      //!< Start of each scene in order[], 0xff if empty
+};
+
+
+inline int SceneEngine::entryCount() const
+{
+    return count;
+}
+
+#endif /*sblib_scene_h*/
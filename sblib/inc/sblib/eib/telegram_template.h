@@ -0,0 +1,52 @@
+/*
+ *  telegram_template.h - Constant telegram frame templates.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_telegram_template_h
+#define sblib_telegram_template_h
+
+#include <sblib/types.h>
+
+/**
+ * The constant part of a telegram frame, from byte 5 (the length byte)
+ * onward. The constant bytes of a response frame are laid out by the
+ * compiler as flash data; a telegram handler applies the template with
+ * one small copy and patches only the variable fields afterwards,
+ * instead of assembling the whole frame byte by byte.
+ *
+ * Telegram bytes 0-4 (control byte, sender and receiver address) are
+ * not part of a template - they are patched for every telegram anyway.
+ *
+ * Example:
+ *
+ * static const TelegramTemplate deviceDescriptorResponse =
+ *     { 3, { 0x63, 0x43, 0x40 } };
+ * ...
+ * deviceDescriptorResponse.apply(sendTelegram);
+ * sendTelegram[8] = version >> 8;  // patch the variable fields
+ * sendTelegram[9] = version;
+ */
+struct TelegramTemplate
+{
+    byte length;   //!< The number of constant bytes
+    byte data[7];  //!< The constant bytes, starting at telegram byte 5
+
+    /**
+     * Copy the constant bytes of the template into a telegram buffer,
+     * starting at byte 5.
+     *
+     * @param telegram - the telegram buffer to compose into.
+     */
+    void apply(byte* telegram) const
+    {
+        for (int i = 0; i < length; ++i)
+            telegram[5 + i] = data[i];
+    }
+};
+
+#endif /*sblib_telegram_template_h*/
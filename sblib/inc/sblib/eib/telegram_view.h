@@ -0,0 +1,152 @@
+/*
+ *  telegram_view.h - Zero-copy accessor for raw EIB telegram bytes.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_telegram_view_h
+#define sblib_telegram_view_h
+
+#include <sblib/bits.h>
+#include <sblib/types.h>
+
+/**
+ * A zero-copy accessor for a raw telegram buffer, e.g. bus.telegram.
+ *
+ * Unlike Telegram, a TelegramView does not own the telegram bytes. It wraps
+ * an existing buffer and decodes the protocol fields in place, so telegram
+ * handlers do not re-derive the same fields byte by byte. The setters can be
+ * used to compose a telegram in a send buffer.
+ */
+class TelegramView
+{
+public:
+    /**
+     * Create a view onto a telegram buffer.
+     *
+     * @param telegram - the raw telegram bytes.
+     */
+    explicit TelegramView(byte* telegram): tel(telegram) {}
+
+    /**
+     * @return The KNX priority bits of the control byte (0x00..0x0c).
+     */
+    int priority() const { return tel[0] & 0x0c; }
+
+    /**
+     * Set the control byte to a standard frame with the given priority bits.
+     *
+     * @param prio - the priority bits (0x00..0x0c).
+     */
+    void priority(int prio) { tel[0] = 0xb0 | (prio & 0x0c); }
+
+    /**
+     * @return True if the telegram is a repeated transmission.
+     */
+    bool repeated() const { return !(tel[0] & 0x20); }
+
+    /**
+     * @return The 16 bit sender address.
+     */
+    int sender() const { return loadBE16(tel + 1); }
+
+    /**
+     * Set the sender address. Usually the sender address is set
+     * automatically when a telegram is being sent by the bus.
+     *
+     * @param addr - the 16 bit sender address.
+     */
+    void sender(int addr) { storeBE16(tel + 1, addr); }
+
+    /**
+     * @return The 16 bit receiver address.
+     */
+    int receiver() const { return loadBE16(tel + 3); }
+
+    /**
+     * Set the receiver address.
+     *
+     * @param addr - the address.
+     * @param isGroup - true if the address is a group address.
+     */
+    void receiver(int addr, bool isGroup)
+    {
+        storeBE16(tel + 3, addr);
+        if (isGroup) tel[5] |= 0x80;
+        else tel[5] &= 0x7f;
+    }
+
+    /**
+     * @return True if the receiver address is a group address.
+     */
+    bool isGroupAddress() const { return tel[5] & 0x80; }
+
+    /**
+     * @return The length of the telegram's data, which starts at byte 7.
+     */
+    byte length() const { return tel[5] & 0x0f; }
+
+    /**
+     * Set the length of the telegram's data, which starts at byte 7.
+     *
+     * @param len - the length.
+     */
+    void length(byte len) { tel[5] = (tel[5] & 0xf0) | (len & 0x0f); }
+
+    /**
+     * @return The size of the telegram in bytes, excluding the checksum.
+     */
+    int size() const { return 7 + (tel[5] & 0x0f); }
+
+    /**
+     * @return The transport control field (see KNX 3/3/4 p.6 TPDU).
+     */
+    int tpci() const { return tel[6] & 0xc3; }
+
+    /**
+     * @return True if the telegram is a numbered data telegram.
+     */
+    bool numbered() const { return tel[6] & 0x40; }
+
+    /**
+     * @return The sequence number of a numbered telegram, shifted in place
+     *         (0x00..0x3c).
+     */
+    int seqNo() const { return tel[6] & 0x3c; }
+
+    /**
+     * Set the sequence number of a numbered telegram.
+     *
+     * @param seq - the sequence number, shifted in place (0x00..0x3c).
+     */
+    void seqNo(int seq) { tel[6] = (tel[6] & ~0x3c) | (seq & 0x3c); }
+
+    /**
+     * @return The 10 bit APCI value.
+     */
+    int apci() const { return ((tel[6] & 3) << 8) | tel[7]; }
+
+    /**
+     * Set the APCI value.
+     *
+     * @param apci - the 10 bit APCI value.
+     */
+    void apci(int apci)
+    {
+        tel[6] = (tel[6] & ~3) | ((apci >> 8) & 3);
+        tel[7] = apci;
+    }
+
+    /**
+     * @return The raw telegram bytes.
+     */
+    byte* data() const { return tel; }
+
+private:
+    byte* tel;  //!< The raw telegram bytes
+};
+
+#endif /*sblib_telegram_view_h*/
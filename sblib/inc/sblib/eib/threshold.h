@@ -0,0 +1,90 @@
+/*
+ *  threshold.h - Threshold with hysteresis that writes a com object.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_threshold_h
+#define sblib_threshold_h
+
+/**
+ * A threshold channel: compares sensor values against a switching level
+ * with hysteresis and writes a 1 bit com object when the level is crossed.
+ *
+ * The channel is evaluated only when a new sample is pushed with
+ * newSample() - e.g. from a sensor completion callback - not every loop
+ * iteration. The object is written on transitions only (and once for the
+ * first sample, so the bus state is defined): above the switching level
+ * the state becomes active, and it becomes inactive again only when the
+ * value falls below the level minus the hysteresis.
+ *
+ * Example:
+ *
+ * Threshold lux;
+ * lux.begin(OBJ_LUX_LOW, 500, 50, true);  // object 1 below 450 lux
+ * ...
+ * lux.newSample(bh1750.uLuxCurrent);      // on every new reading
+ */
+class Threshold
+{
+public:
+    Threshold();
+
+    /**
+     * Configure the threshold channel.
+     *
+     * @param objno - the com object to write on transitions.
+     * @param threshold - the switching level.
+     * @param hysteresis - the state switches back off below
+     *                     threshold - hysteresis.
+     * @param invert - write 1 when the value is below the level instead
+     *                 of above (default: false).
+     */
+    void begin(int objno, int threshold, int hysteresis, bool invert = false);
+
+    /**
+     * Configure the threshold channel from ETS parameters: the switching
+     * level and the hysteresis are read as 16 bit big-endian values from
+     * userEeprom[paramAddr] and userEeprom[paramAddr + 2].
+     *
+     * @param objno - the com object to write on transitions.
+     * @param paramAddr - the address of the parameters in the user EEPROM.
+     * @param invert - write 1 when the value is below the level instead
+     *                 of above (default: false).
+     */
+    void beginFromParams(int objno, int paramAddr, bool invert = false);
+
+    /**
+     * Evaluate a new sample. Writes the com object when the state changes,
+     * and once for the first sample after begin().
+     *
+     * @param value - the new sample.
+     */
+    void newSample(int value);
+
+    /**
+     * @return True if the value is above the switching level (before the
+     *         optional inversion), false if below or no sample was
+     *         evaluated yet.
+     */
+    bool state() const;
+
+private:
+    short objno;         //!< The com object to write, -1 if unconfigured
+    int threshold;       //!< The switching level
+    int hysteresis;      //!< The state switches off below threshold - hysteresis
+    bool invert;         //!< Write the inverted state
+    bool valid;          //!< A sample was evaluated since begin()
+    bool active;         //!< The value is above the switching level
+};
+
+
+inline bool Threshold::state() const
+{
+    return active;
+}
+
+#endif /*sblib_threshold_h*/
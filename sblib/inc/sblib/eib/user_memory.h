@@ -205,10 +205,37 @@ public:
      */
     void modified();
 
+    /**
+     * Mark a range of the user EEPROM as modified. Same as modified(), but only
+     * the 256 byte flash pages that contain the range are rewritten when the
+     * EEPROM is written to flash.
+     *
+     * @param offset - the offset of the modified range in the EEPROM.
+     * @param len - the length of the modified range in bytes.
+     */
+    void modified(int offset, int len);
+
     /**
      * Test if the user EEPROM is modified.
      */
     bool isModified() const;
+
+    /**
+     * Set the commit delay of the EEPROM write-back. Modified data ages for
+     * this time before it is written to flash, so multiple modifications
+     * within the window collapse into a single flash transaction. Every
+     * modification restarts the delay. The default is 50 milliseconds.
+     *
+     * @param ms - the commit delay in milliseconds.
+     */
+    void commitDelay(unsigned int ms);
+
+    /**
+     * Write the user EEPROM to flash now if it is modified, without waiting
+     * for the commit delay. Call this before a planned reset. The function
+     * blocks until the bus is idle and the flash write is done.
+     */
+    void commitNow();
 };
 
 
@@ -269,6 +296,21 @@ inline void UserEeprom::modified()
 {
     extern byte userEepromModified;
     extern unsigned int writeUserEepromTime;
+    extern unsigned int userEepromDirtyPages;
+
+    userEepromModified = 1;
+    userEepromDirtyPages = ~0;
+    writeUserEepromTime = 0;
+}
+
+inline void UserEeprom::modified(int offset, int len)
+{
+    extern byte userEepromModified;
+    extern unsigned int writeUserEepromTime;
+    extern unsigned int userEepromDirtyPages;
+
+    for (int page = offset >> 8; page <= (offset + len - 1) >> 8; ++page)
+        userEepromDirtyPages |= 1 << page;
 
     userEepromModified = 1;
     writeUserEepromTime = 0;
@@ -280,6 +322,18 @@ inline bool UserEeprom::isModified() const
     return userEepromModified;
 }
 
+inline void UserEeprom::commitDelay(unsigned int ms)
+{
+    extern unsigned int userEepromCommitDelay;
+    userEepromCommitDelay = ms;
+}
+
+inline void UserEeprom::commitNow()
+{
+    extern void writeUserEeprom();
+    writeUserEeprom();
+}
+
 inline byte* userMemoryPtr(int addr)
 {
     if (addr >= USER_EEPROM_START && addr <= USER_EEPROM_END)
@@ -0,0 +1,84 @@
+/*
+ *  encoder.h - Quadrature decoder for rotary encoders.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_encoder_h
+#define sblib_encoder_h
+
+#include <sblib/types.h>
+
+/**
+ * A quadrature decoder for a rotary encoder. The two encoder signals are
+ * decoded in the GPIO port interrupts and the steps are accumulated in a
+ * signed counter, so no steps are lost when the main loop stalls on a
+ * flash write or a display transfer. read() fetches and clears the
+ * accumulated steps atomically - input handling in the loop is one call,
+ * whatever happened in between.
+ *
+ * The port interrupt handlers must be connected with the
+ * ENCODER_INTERRUPT_HANDLER() macro, one per GPIO port that has encoder
+ * pins:
+ *
+ * RotaryEncoder knob;
+ * knob.begin(PIO1_4, PIO1_5);
+ * ENCODER_INTERRUPT_HANDLER(PIOINT1_IRQHandler, knob, 1)
+ * ...
+ * int steps = knob.read();   // in loop(): signed steps since last read
+ */
+class RotaryEncoder
+{
+public:
+    RotaryEncoder();
+
+    /**
+     * Begin decoding the encoder. Both pins are configured as interrupt
+     * inputs with internal pull-up, triggering on both edges, and the
+     * port interrupts are enabled.
+     *
+     * @param pinA - the first encoder signal, e.g. PIO1_4
+     * @param pinB - the second encoder signal, e.g. PIO1_5
+     */
+    void begin(int pinA, int pinB);
+
+    /**
+     * Get the number of steps that accumulated since the last read, and
+     * clear the counter. One detent of a typical encoder is 4 steps
+     * (one full quadrature cycle).
+     *
+     * @return The accumulated steps: positive for one direction,
+     *         negative for the other.
+     */
+    int read();
+
+    /**
+     * The interrupt handler of a GPIO port with encoder pins. Do not
+     * call this directly, use the ENCODER_INTERRUPT_HANDLER() macro.
+     *
+     * @param portNum - the GPIO port number: 0..3
+     */
+    void portInterruptHandler(int portNum);
+
+protected:
+    int pinA, pinB;            //!< The encoder pins
+    byte state;                //!< The last quadrature state: A<<1 | B
+    volatile int delta;        //!< The accumulated steps
+};
+
+/**
+ * Create an interrupt handler for a GPIO port of a rotary encoder. Use
+ * this macro once per GPIO port that has encoder pins; when both pins
+ * share a port - the usual wiring - one handler is enough.
+ *
+ * @param handler - the name of the interrupt handler, e.g. PIOINT1_IRQHandler
+ * @param encoderObj - the RotaryEncoder object
+ * @param portNum - the GPIO port number of the handler: 0..3
+ */
+#define ENCODER_INTERRUPT_HANDLER(handler, encoderObj, portNum) \
+    extern "C" void handler() { encoderObj.portInterruptHandler(portNum); }
+
+#endif /*sblib_encoder_h*/
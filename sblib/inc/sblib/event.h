@@ -0,0 +1,89 @@
+/*
+ *  event.h - Event flags connecting interrupt handlers to the main loop.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_event_h
+#define sblib_event_h
+
+/**
+ * A word of 32 event flags that interrupt handlers set and the main loop
+ * fetches. Instead of polling every source on every pass, the loop
+ * sleeps in eventWait() and dispatches only the work whose flag is set -
+ * one word test in the steady state.
+ *
+ * The library's interrupt handlers post the EVENT_xx flags below; the
+ * upper 16 flags are free for the application. Example:
+ *
+ *     void loop()
+ *     {
+ *         unsigned int events = eventWait(ScheduledTimeout::nextDelay());
+ *
+ *         ScheduledTimeout::checkNext();
+ *
+ *         if (events & EVENT_BUS_RX)
+ *             processTelegrams();
+ *         if (events & EVENT_SERIAL_RX)
+ *             processSerialInput();
+ *     }
+ *
+ * Note that the library's main still calls bcu.loop() before every
+ * loop() pass, so bus processing is never starved: a received telegram
+ * sets EVENT_BUS_RX and ends the wait.
+ */
+
+/** Bus: a telegram was received and waits in the receive ring */
+#define EVENT_BUS_RX      0x00000001
+
+/** Bus: a telegram was sent and a send slot became free */
+#define EVENT_BUS_TX      0x00000002
+
+/** Serial: received data is available */
+#define EVENT_SERIAL_RX   0x00000004
+
+/** Serial: the transmit buffer has fully drained */
+#define EVENT_SERIAL_TX   0x00000008
+
+/** The first event flag that is free for the application */
+#define EVENT_APP_FIRST   0x00010000
+
+/**
+ * Set event flags. Safe to call from interrupt handlers and from the
+ * main loop; a concurrent eventWait() ends.
+ *
+ * @param mask - the event flags to set, e.g. EVENT_APP_FIRST.
+ */
+void eventSet(unsigned int mask);
+
+/**
+ * Get the pending event flags without clearing them.
+ *
+ * @return The pending event flags.
+ */
+unsigned int eventPending();
+
+/**
+ * Atomically fetch and clear event flags. Flags that are set again
+ * between the fetch and the next call are not lost.
+ *
+ * @param mask - the event flags to fetch, default all.
+ * @return The fetched event flags.
+ */
+unsigned int eventFetch(unsigned int mask = ~0u);
+
+/**
+ * Sleep until an event flag is set or the timeout passed, and fetch the
+ * flags. A flag that was posted before the call ends the wait
+ * immediately. Returns 0 on timeout.
+ *
+ * @param maxMs - the maximum number of milliseconds to wait, default
+ *                forever.
+ * @return The fetched event flags, 0 on timeout.
+ */
+unsigned int eventWait(unsigned int maxMs = ~0u);
+
+#endif /*sblib_event_h*/
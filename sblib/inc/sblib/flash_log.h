@@ -0,0 +1,97 @@
+/*
+ * flash_log.h - journaled append-log storage in flash
+ *
+ *  Copyright (c) 2015 Selfbus.org
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ */
+
+#ifndef SBLIB_FLASH_LOG_H_
+#define SBLIB_FLASH_LOG_H_
+
+#include <sblib/platform.h>
+#include <sblib/types.h>
+
+#define FLASH_LOG_SUCCESS          0
+#define FLASH_LOG_EMPTY           -1
+#define FLASH_LOG_INVALID_RECORD  -2
+
+/**
+ * An append-only log of fixed-size records in a flash region, for values
+ * that are written often, like counters or state snapshots. Where a page
+ * mapped store costs a page erase per update, a record append only programs
+ * the current page: the rest of the page stays erased, so appending clears
+ * bits only and needs no erase. A page is erased once when the log moves
+ * into it, which gives many record updates per erase cycle. The oldest
+ * page is recycled when the region is full.
+ *
+ * The newest record is found at boot by following the page sequence
+ * numbers and scanning the newest page for the last used record slot.
+ */
+class FlashLog
+{
+public:
+    /**
+     * Creates a FlashLog instance with flash base address and size. Scans
+     * the flash region for the newest record.
+     *
+     * @param flashBase - must be a page aligned address within 16 bit address space
+     * @param flashSize - must be a page aligned size in bytes
+     * @param recordSize - the payload size of a record in bytes, at most 251
+     */
+    FlashLog(unsigned int flashBase = 0xf000, unsigned int flashSize = 0x1000,
+            int recordSize = 16);
+
+    /**
+     * Append a record to the log. The record becomes the newest record.
+     *
+     * @param record - the record payload, recordSize bytes
+     * @return 0 on success, else error
+     */
+    int appendRecord(const byte* record);
+
+    /**
+     * Read the newest record of the log.
+     *
+     * @param record - the buffer for the record payload, recordSize bytes
+     * @return 0 on success, FLASH_LOG_EMPTY if the log holds no record
+     */
+    int latestRecord(byte* record) const;
+
+    /**
+     * Test if the log holds a record.
+     *
+     * @return True if the log is empty.
+     */
+    bool isEmpty() const
+    {
+        return currentPage == 0 || currentSlot == 0;
+    }
+
+private:
+    /**
+     * Switch to the next flash page of the region, erasing it if it is not
+     * blank. The page header is programmed together with the first record.
+     *
+     * @return 0 on success, else error
+     */
+    int advancePage();
+
+    unsigned int flashBasePage;
+    unsigned int flashSizePages;
+
+    int recordSize;     // the payload size of a record
+    int slotSize;       // a record slot: one marker byte plus the payload
+    int slotsPerPage;
+
+    int currentPage;    // the flash page that is appended to, 0 if none yet
+    int currentSlot;    // the next free record slot of the current page
+    byte sequence;      // the sequence number of the current page
+
+    byte pageBuf[FLASH_PAGE_SIZE]; // RAM copy of the current page
+};
+
+#endif /* SBLIB_FLASH_LOG_H_ */
@@ -0,0 +1,66 @@
+/*
+ *  hot_table.h - RAM residency for hot lookup tables.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_hot_table_h
+#define sblib_hot_table_h
+
+/**
+ * Frequently accessed lookup tables - the bus parity table, CRC tables -
+ * normally live in flash. Flash accesses take wait states at 48 MHz while
+ * SRAM accesses do not, so on devices with RAM to spare such tables are
+ * faster when they reside in SRAM.
+ *
+ * A table that is declared with the HOT_TABLE attribute stays a const in
+ * flash by default. When the project defines SBLIB_HOT_TABLES_RAM the
+ * table becomes part of the data image instead: the library startup
+ * copies it into SRAM together with the initialized data, no linker
+ * script changes are needed. The tables share the section prefix
+ * .data.$hottab, so the linker map lists them together with their total
+ * SRAM cost.
+ *
+ * Example:
+ *
+ *     static const byte crcTab[256] HOT_TABLE = { ... };
+ *     HOT_TABLE_BUDGET_CHECK(crcTab);
+ */
+
+/**
+ * The SRAM budget in bytes that a single hot table may use, see
+ * HOT_TABLE_BUDGET_CHECK(). Small-RAM devices can lower it in the
+ * project settings to reject RAM residency of large tables at compile
+ * time.
+ */
+#ifndef SBLIB_HOT_TABLES_BUDGET
+#define SBLIB_HOT_TABLES_BUDGET 1024
+#endif
+
+#ifdef SBLIB_HOT_TABLES_RAM
+
+/** Place the declared table in SRAM, see the description above */
+#define HOT_TABLE __attribute__ ((section(".data.$hottab")))
+
+/**
+ * Compile time check that the table fits the hot table budget. With
+ * RAM residency disabled the table costs no SRAM and the check is empty.
+ *
+ * @param table - the table that was declared with HOT_TABLE.
+ */
+#define HOT_TABLE_BUDGET_CHECK(table) \
+    typedef char table##_exceeds_hot_table_budget \
+        [sizeof(table) <= SBLIB_HOT_TABLES_BUDGET ? 1 : -1]
+
+#else /*!SBLIB_HOT_TABLES_RAM*/
+
+#define HOT_TABLE
+#define HOT_TABLE_BUDGET_CHECK(table) \
+    typedef char table##_exceeds_hot_table_budget[1]
+
+#endif /*SBLIB_HOT_TABLES_RAM*/
+
+#endif /*sblib_hot_table_h*/
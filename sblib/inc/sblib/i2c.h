@@ -71,11 +71,76 @@
 #define I2SCLH_HS_SCLH  0x00000020  // Fast Plus I2C SCL Duty Cycle High Reg
 #define I2SCLL_HS_SCLL  0x00000020  // Fast Plus I2C SCL Duty Cycle Low Reg
 
+/*
+ * The I2C bus speed profiles, see I2C::I2CInit(). The duty cycle registers
+ * are computed from SystemCoreClock, so the profiles stay correct for any
+ * system clock. Fast mode and Fast mode plus only work with devices that
+ * support them.
+ */
+enum I2cSpeed
+{
+  I2C_SPEED_100K = 100000,   // Standard mode, 100 kHz
+  I2C_SPEED_400K = 400000,   // Fast mode, 400 kHz
+  I2C_SPEED_1M   = 1000000   // Fast mode plus, 1 MHz
+};
+
+/*
+ * Type of the transaction complete handler, see I2C::onTransactionComplete().
+ * The handler is called from the I2C interrupt with the final transaction
+ * state (I2CSTATE_ACK on success). Keep the handler short, it runs in
+ * interrupt context.
+ */
+typedef void (*I2cTransactionHandler)(uint16_t state);
+
+/*
+ * Type of the slave receive handler, see I2C::onSlaveReceive(). The
+ * handler is called from the I2C interrupt when the master finished
+ * writing to us, with the receive buffer and the number of bytes in it.
+ * Keep the handler short, it runs in interrupt context.
+ */
+typedef void (*I2cSlaveRxHandler)(const uint8_t* data, uint16_t length);
+
+/*
+ * Type of the slave request handler, see I2C::onSlaveRequest(). The
+ * handler is called from the I2C interrupt when the master addresses us
+ * for reading: it fills the transmit buffer and returns the number of
+ * bytes to send. Keep the handler short, it runs in interrupt context.
+ */
+typedef uint16_t (*I2cSlaveTxHandler)(uint8_t* buffer, uint16_t maxLength);
+
+/*
+ * The number of entries of the transaction queue, see
+ * I2C::queueTransaction(). Must be a power of two.
+ */
+#ifndef I2C_QUEUE_SIZE
+#define I2C_QUEUE_SIZE  8
+#endif
+
+#if I2C_QUEUE_SIZE & (I2C_QUEUE_SIZE - 1)
+#error "I2C_QUEUE_SIZE must be a power of two"
+#endif
+
+/*
+ * A queued transaction, see I2C::queueTransaction().
+ */
+struct I2cTransaction
+{
+  uint8_t deviceAddr;           // the slave address
+  const uint8_t* txData;        // the bytes to send, 0 if none
+  uint16_t txLen;               // the number of bytes to send
+  uint8_t* rxData;              // the receive buffer, 0 if none
+  uint16_t rxLen;               // the number of bytes to read
+  I2cTransactionHandler handler; // called when this transaction is done, 0 for none
+};
+
+template<class T, int poolSize> class ObjectPool;
+
 /****************************************************************************
 * I2C Class
 *****************************************************************************/
 class I2C
 {
+  friend class ObjectPool<I2C, 1>; // the pool that creates the instance
 public:
   static I2C* Instance();
   uint8_t I2CMasterBuffer[BUFSIZE];
@@ -88,12 +153,20 @@ public:
   uint16_t RdIndex;
   uint16_t WrIndex;
 
+  uint8_t I2CDeviceAddr;        // the slave address of the running transaction
+  const uint8_t* I2CTxData;     // the bytes the running transaction sends, 0 if none
+  uint8_t* I2CRxData;           // the receive buffer of the running transaction, 0 if none
+  I2cTransactionHandler transactionHandler; // called when a transaction is done, 0 for none
+
   uint8_t I2CScan_State;
   uint8_t I2CScan_uAdress[MAX_SCAN_DEVICES];
 
   bool bI2CIsInitialized;
 
-  void I2CInit( uint8_t I2cMode=I2CMASTER );
+  // Initialize the I2C controller with the given mode and bus speed. The
+  // default speed honors the legacy FAST_MODE_PLUS switch.
+  void I2CInit( uint8_t I2cMode=I2CMASTER,
+                uint32_t I2cSpeed = FAST_MODE_PLUS ? I2C_SPEED_1M : I2C_SPEED_100K );
   uint16_t I2CEngine( void );
   bool I2CStart();
   bool I2CStop();
@@ -101,6 +174,113 @@ public:
   void ClearBuffer(bool bClearMaster=true, bool bClearSlave=true);
   bool Write(uint8_t uDeviceAddr, const char *udata, uint8_t data_length);
   bool Read(uint8_t uDeviceAddr, char *udata, uint8_t data_read_length, uint16_t uDelayMS=200);
+
+  /*
+   * Combined write-then-read: the txData bytes (typically a register
+   * address) are written, then rxLen bytes are read into rxData after a
+   * repeated start - one bus transaction instead of a separate write and
+   * read with a stop/start in between. A txLen of 0 reads without
+   * addressing a register first.
+   */
+  bool WriteRead(uint8_t uDeviceAddr, const uint8_t *txData, uint8_t txLen,
+                 uint8_t *rxData, uint8_t rxLen);
+
+  /*
+   * Start a transaction in the background and return immediately: the
+   * txData bytes are sent to the device, then rxLen bytes are read into
+   * rxData after a repeated start. Either part may be empty. The whole
+   * transaction runs from the I2C interrupt; the buffers must stay valid
+   * until it is done. Poll transactionDone() or use onTransactionComplete()
+   * to learn when it is. Returns false if a transaction is still running.
+   */
+  bool startTransaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                        uint8_t *rxData, uint16_t rxLen);
+
+  /*
+   * Run a transaction like startTransaction() and wait until it is done.
+   * Returns the final state, I2CSTATE_ACK on success or 0 on timeout.
+   */
+  uint16_t transaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                       uint8_t *rxData, uint16_t rxLen);
+
+  // Test if no transaction is running
+  bool transactionDone() const { return I2CMasterState != I2CSTATE_PENDING; }
+
+  // Set the handler that is called from the I2C interrupt when a
+  // transaction is done, 0 for none
+  void onTransactionComplete(I2cTransactionHandler handler) { transactionHandler = handler; }
+
+  /*
+   * Queue a transaction. If the bus is idle the transaction starts right
+   * away, otherwise it starts from the I2C interrupt when the previous
+   * transaction is done - a polling cycle queues all its sensor
+   * transactions at once and they run back-to-back while the application
+   * keeps computing. The per-entry handler is called from the interrupt
+   * with the final state; the buffers must stay valid until then.
+   * Returns false if the queue is full or the arguments are inconsistent.
+   */
+  bool queueTransaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                        uint8_t *rxData, uint16_t rxLen, I2cTransactionHandler handler = 0);
+
+  // The number of transactions that are queued or running
+  uint8_t queuePending() const
+  {
+    return ((queueTail - queueHead) & (I2C_QUEUE_SIZE - 1)) +
+        (I2CMasterState == I2CSTATE_PENDING ? 1 : 0);
+  }
+
+  /*
+   * Start the next queued transaction. This method is called from the I2C
+   * interrupt when a transaction is done. Consider it to be a private
+   * method and do not call it yourself.
+   */
+  void serviceQueue();
+
+  /*
+   * Begin answering as an I2C slave on the given address. The slave runs
+   * entirely from the I2C interrupt: bytes the master writes are collected
+   * in rxBuffer and handed to the onSlaveReceive() handler at the stop
+   * condition; when the master reads, the onSlaveRequest() handler fills
+   * txBuffer with the bytes to send. Slave and master mode work at the
+   * same time - the controller answers on its address between its own
+   * transactions. Call I2CInit() before.
+   *
+   * @param ownAddress - our slave address (8 bit form, e.g. 0xA0; the
+   *                     R/W bit is ignored)
+   * @param rxBuffer - the buffer for bytes the master writes to us
+   * @param rxBufferSize - the size of rxBuffer; extra bytes are NACKed
+   * @param txBuffer - the buffer for bytes the master reads from us
+   * @param txBufferSize - the size of txBuffer
+   */
+  void slaveBegin(uint8_t ownAddress, uint8_t* rxBuffer, uint16_t rxBufferSize,
+                  uint8_t* txBuffer, uint16_t txBufferSize);
+
+  // End answering as an I2C slave
+  void slaveEnd();
+
+  // Set the handler that is called from the I2C interrupt when the master
+  // finished writing to us, 0 for none
+  void onSlaveReceive(I2cSlaveRxHandler handler) { slaveRxHandler = handler; }
+
+  // Set the handler that is called from the I2C interrupt when the master
+  // addresses us for reading, 0 for none
+  void onSlaveRequest(I2cSlaveTxHandler handler) { slaveTxHandler = handler; }
+
+  I2cTransaction queue[I2C_QUEUE_SIZE]; // the queued transactions
+  volatile uint8_t queueHead;   // the next queued transaction to start
+  volatile uint8_t queueTail;   // the next free queue entry
+  I2cTransactionHandler currentHandler; // the handler of the running queued transaction
+
+  uint8_t* slaveRxBuffer;       // the buffer for bytes the master writes to us
+  uint16_t slaveRxSize;         // the size of the slave receive buffer
+  volatile uint16_t slaveRxIndex; // the number of received slave bytes
+  uint8_t* slaveTxBuffer;       // the buffer for bytes the master reads from us
+  uint16_t slaveTxSize;         // the size of the slave transmit buffer
+  volatile uint16_t slaveTxLen; // the number of slave bytes to send
+  volatile uint16_t slaveTxIndex; // the next slave byte to send
+  I2cSlaveRxHandler slaveRxHandler; // called when the master finished writing to us
+  I2cSlaveTxHandler slaveTxHandler; // called when the master addresses us for reading
+
 private:
   I2C(); I2C(I2C const&);
   static I2C* m_pInstance;
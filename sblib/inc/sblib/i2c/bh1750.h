@@ -40,7 +40,25 @@ public:
   void BH1750DeInit();
   bool GetLux();
 
+  /*
+   * Put the sensor into a continuous measurement mode (default: high
+   * resolution). The sensor then converts on its own and GetLux() only
+   * fetches the latest result, returning in microseconds instead of
+   * waiting out a one-shot conversion.
+   */
+  bool StartContinuous(uint8_t uMode = BH1750_CONTINUOUS_HIGH_RES_MODE);
+
+  /*
+   * The age of uLuxCurrent in milliseconds: the time since the last
+   * successful fetch from the sensor.
+   */
+  unsigned int LuxAgeMs();
+
 private:
   bool PowerDownBH1750();
+  bool ReadLux();
+
+  bool bBH1750Continuous;     // the sensor measures continuously
+  unsigned int uLuxMillis;    // time of the last successful fetch
 };
 #endif /* BH1750_H*/
@@ -189,11 +189,21 @@ public:
     LSB_TEMP              // 0x12 - LSB of Temp
   } ds3231_Regs_t;
 
+  Ds3231();
+
   bool Ds3231Init();
   bool SetTime(ds3231_time_t time);
   bool GetTime(ds3231_time_t* time);
   bool SetCalendar(ds3231_calendar_t calendar);
   bool GetCalendar(ds3231_calendar_t* calendar);
+
+  /*
+   * Burst read: fetch time and calendar (and optionally the temperature)
+   * in one sequential register read starting at SECONDS, instead of one
+   * bus transaction per register group.
+   */
+  bool GetTimeDate(ds3231_time_t* time, ds3231_calendar_t* calendar,
+                   float* fTemperature = 0);
   bool SetAlarm(ds3231_alrm_t alarm, bool one_r_two);
   bool GetAlarm(ds3231_alrm_t* alarm, bool one_r_two);
   time_t GetEpoch();
@@ -205,8 +215,39 @@ public:
   bool EnableOscillator(bool TF, bool bBattery, uint8_t RS_bit_SQW);
   float GetTemperature();
 
+  /*
+   * Cached time mode: the 1Hz SQW output of the DS3231 drives a GPIO
+   * interrupt that increments a RAM copy of time and calendar, so
+   * GetCachedTimeDate() is a RAM read instead of a multi-millisecond
+   * I2C transaction. The cache is resynced over I2C periodically.
+   *
+   * The application must create the interrupt handler of the SQW pin's
+   * GPIO port with PIN_INTERRUPT_HANDLER (see digital_pin.h), and wire
+   * the SQW output to the pin.
+   */
+  bool EnableCachedTime(int sqwPin, uint32_t resyncSeconds = 3600);
+  void DisableCachedTime();
+  bool GetCachedTimeDate(ds3231_time_t* time, ds3231_calendar_t* calendar);
+
+  /*
+   * Advance the cached time by one second. Called from the SQW pin
+   * interrupt; do not call it yourself.
+   */
+  void SqwTick();
+
 private:
   uint16_t uchar_2_bcd(uint8_t data);
   uint8_t bcd_2_uchar(uint8_t bcd);
+  void TickTime();
+  static void SqwIsr();
+
+  int sqw_pin;                      // the GPIO pin wired to the SQW output
+  bool cache_enabled;               // true while the cached time mode runs
+  uint32_t resync_secs;             // the seconds between two I2C resyncs
+  volatile uint32_t secs_since_sync;// the seconds since the last I2C resync
+  ds3231_time_t cached_time;        // the RAM copy of the time
+  ds3231_calendar_t cached_calendar;// the RAM copy of the calendar
+
+  static Ds3231* sqw_instance;      // the object ticked by the SQW interrupt
 };
 #endif /* DS3231_H */
@@ -63,6 +63,19 @@ IAP_Status iapEraseSector(int sector);
  */
 IAP_Status iapErasePage(int sector);
 
+/**
+ * Erase a range of pages. Sub-ranges that cover whole sectors are erased
+ * with the ROM's sector erase, which is much faster than the equivalent
+ * page erase sequence; only the partial sectors at the edges are erased
+ * page by page. Use this for wiping large regions, e.g. an OTA image
+ * area or a MemMapper region.
+ *
+ *  @param startPage    index of the first page to erase
+ *  @param endPage      index of the last page to erase
+ *  @return             status code (0 == OK)
+ */
+IAP_Status iapEraseRange(int startPage, int endPage);
+
 /**
  * Programs the specified number of bytes from the RAM to the specified location
  * inside the FLASH.
@@ -73,6 +86,44 @@ IAP_Status iapErasePage(int sector);
  */
 IAP_Status iapProgram(byte* rom, const byte* ram, unsigned int size);
 
+/**
+ * Programs the specified number of bytes from the RAM to the specified
+ * location inside the FLASH with the minimum number of IAP calls: one
+ * prepare and one copy, without the verify pass and the statistics of
+ * iapProgram(). For the power fail fast save, where the write must fit
+ * into the decaying supply window; use iapProgram() everywhere else.
+ *
+ * @param rom           start address inside the FLASH, page aligned
+ * @param ram           start address of the buffer
+ * @param size          number of bytes to program
+ * @return              status code, see enum IAP_Status above
+ */
+IAP_Status iapProgramFast(byte* rom, const byte* ram, unsigned int size);
+
+/**
+ * A flash region for iapProgramScatter().
+ */
+struct IapRegion
+{
+    byte* rom;          //!< Start address inside the FLASH, page aligned
+    const byte* ram;    //!< Start address of the buffer to program from
+    unsigned int size;  //!< Number of bytes, a multiple of the page size
+};
+
+/**
+ * Validate, erase and program a batch of flash regions in one planned
+ * sequence. The whole batch is validated before the flash is touched, the
+ * pages of adjacent or overlapping regions are merged into single erase
+ * calls, and each region is programmed in the largest chunks the IAP
+ * accepts, which is considerably faster than erasing and programming the
+ * regions page by page. The regions must be in ascending address order.
+ *
+ * @param regions      the flash regions to program
+ * @param count        the number of regions
+ * @return             status code, see enum IAP_Status above
+ */
+IAP_Status iapProgramScatter(const IapRegion* regions, int count);
+
 /**
  * Read the unique ID of the CPU. The ID is 16 bytes long.
  *
@@ -99,5 +150,128 @@ IAP_Status iapReadPartID(unsigned int* partId);
  */
 int iapFlashSize();
 
+/**
+ * The number of flash sectors that the IAP statistics cover. Operations on
+ * sectors beyond this limit are not counted.
+ */
+#ifndef IAP_STATS_SECTORS
+#define IAP_STATS_SECTORS 16
+#endif
+
+class Timer;
+class FlashLog;
+
+/**
+ * The erase and program counters of one flash sector.
+ */
+struct IapSectorStats
+{
+    unsigned int erases;    //!< The number of erase operations of the sector
+    unsigned int programs;  //!< The number of program operations of the sector
+};
+
+/**
+ * Statistics of the flash operations: erase and program counts per sector,
+ * and the flash call durations in microseconds. The counters are always
+ * maintained; the durations are only recorded after iapStatsEnable() was
+ * called. The structure can be copied into a MemMapper range or a property
+ * for reporting.
+ */
+struct IapStats
+{
+    IapSectorStats sector[IAP_STATS_SECTORS]; //!< The per sector counters
+
+    unsigned int eraseMin;    //!< The shortest erase call, in usec
+    unsigned int eraseMax;    //!< The longest erase call, in usec
+    unsigned int eraseLast;   //!< The last erase call, in usec
+
+    unsigned int programMin;  //!< The shortest program call, in usec
+    unsigned int programMax;  //!< The longest program call, in usec
+    unsigned int programLast; //!< The last program call, in usec
+};
+
+/**
+ * The statistics of the flash operations.
+ */
+extern IapStats iapStats;
+
+/**
+ * Enable recording of the flash call durations. The timer is claimed and
+ * configured to count microseconds. The system time stands still during a
+ * flash call as the interrupts are blocked, therefore a hardware timer is
+ * used for the measurement. Use a 32 bit timer, a 16 bit timer overflows
+ * during a long erase.
+ *
+ * @param timer - the timer to measure with, e.g. timer32_0
+ */
+void iapStatsEnable(Timer& timer);
+
+/**
+ * Save the flash statistics as a record of the log, to persist the counters
+ * over a restart.
+ *
+ * @param log - a FlashLog that was created with recordSize sizeof(IapStats)
+ * @return 0 on success, else error
+ */
+int iapStatsSave(FlashLog& log);
+
+/**
+ * Restore the flash statistics from the newest record of the log.
+ *
+ * @param log - a FlashLog that was created with recordSize sizeof(IapStats)
+ * @return 0 on success, else error
+ */
+int iapStatsRestore(FlashLog& log);
+
+/**
+ * Callback type for the asynchronous flash functions. The callback is invoked
+ * from iapAsyncStep() when the flash operation is finished.
+ *
+ * @param status - the result of the flash operation
+ */
+typedef void (*IapCallback)(IAP_Status status);
+
+/**
+ * Start erasing a page asynchronously. The erase is executed by a later call
+ * to iapAsyncStep().
+ *
+ * @param pageNumber   index of the page which should be erased
+ * @param done         callback that is invoked when the erase is finished,
+ *                     0 for none
+ * @return             True if the erase was scheduled, false if another
+ *                     asynchronous flash operation is still in progress.
+ */
+bool iapAsyncErasePage(int pageNumber, IapCallback done);
+
+/**
+ * Start programming a flash region asynchronously. The programming and the
+ * verify are executed by later calls to iapAsyncStep(), one step per call.
+ * The RAM buffer must stay valid until the callback is invoked.
+ *
+ * @param rom          start address inside the FLASH
+ * @param ram          start address of the buffer
+ * @param size         number of bytes to program
+ * @param done         callback that is invoked when programming is finished,
+ *                     0 for none
+ * @return             True if the operation was scheduled, false if another
+ *                     asynchronous flash operation is still in progress.
+ */
+bool iapAsyncProgram(byte* rom, const byte* ram, unsigned int size, IapCallback done);
+
+/**
+ * Test if an asynchronous flash operation is in progress.
+ *
+ * @return True if an operation is scheduled or running.
+ */
+bool iapAsyncBusy();
+
+/**
+ * Execute at most one step of the pending asynchronous flash operation.
+ * Call when a blocking flash access is acceptable, e.g. while the bus is
+ * idle - bcu.loop() does this automatically. Returns immediately if no
+ * operation is pending.
+ */
+void iapAsyncStep();
+
 
 #endif /* SB_IAP_H_ */
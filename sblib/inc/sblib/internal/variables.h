@@ -33,6 +33,9 @@ extern byte userEepromDirty;
 // Table of interface/property objects (eib/property_defs.cpp)
 extern const PropertyDef* const propertiesTab[NUM_PROP_OBJECTS];
 
+// Number of properties per interface/property object (eib/property_defs.cpp)
+extern const byte propertiesTabSize[NUM_PROP_OBJECTS];
+
 #endif
 
 #endif /*sblib_internal_variables_h*/
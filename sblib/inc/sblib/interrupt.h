@@ -85,6 +85,58 @@ void clearPendingInterrupt(IRQn_Type interruptType);
 void setPendingInterrupt(IRQn_Type interruptType);
 
 
+/**
+ * The interrupt priority policy of the library. The Cortex-M0 has four
+ * preemption levels, 0 is the highest. The levels are assigned so that
+ * the bus timer interrupt can never be preempted or delayed by another
+ * library interrupt: a burst of serial input or a long SPI transfer at
+ * a higher priority would stretch the bus ISR past the bit timing
+ * tolerance.
+ *
+ * ISR_PRIO_BUS - the bus timer interrupt, exclusively. Nothing else in
+ *     the library runs at this level.
+ * ISR_PRIO_TIME_CRITICAL - short pin interrupts with timing demands of
+ *     their own: edge capture, quadrature decoding.
+ * ISR_PRIO_PERIPHERAL - the Serial, SPI and I2C transfer interrupts.
+ * ISR_PRIO_BACKGROUND - interrupts without timing demands: the ADC scan.
+ *     SysTick_Config() puts the system tick at this level too.
+ *
+ * The library's begin() functions assign these defaults. Application
+ * interrupt handlers get ISR_PRIO_BACKGROUND from reset; use
+ * setInterruptPriority() to raise them, but never to ISR_PRIO_BUS.
+ */
+#define ISR_PRIO_BUS            0
+#define ISR_PRIO_TIME_CRITICAL  1
+#define ISR_PRIO_PERIPHERAL     2
+#define ISR_PRIO_BACKGROUND     3
+
+// Compile-time guard of the policy: the bus ISR must be alone at the
+// highest priority level, so no library ISR can preempt it and break
+// the bit timing - any duration is safe at a lower level.
+typedef char bus_isr_priority_must_be_highest[
+    (ISR_PRIO_BUS == 0
+     && ISR_PRIO_TIME_CRITICAL > ISR_PRIO_BUS
+     && ISR_PRIO_PERIPHERAL > ISR_PRIO_BUS
+     && ISR_PRIO_BACKGROUND > ISR_PRIO_BUS) ? 1 : -1];
+
+/**
+ * Set the priority of an interrupt. Use the ISR_PRIO_xx levels of the
+ * library's priority policy.
+ *
+ * @param interruptType - the interrupt: TIMER_16_0_IRQn, I2C_IRQn, ...
+ * @param priority - the priority, 0..3, lower value preempts higher.
+ */
+void setInterruptPriority(IRQn_Type interruptType, unsigned int priority);
+
+/**
+ * Get the priority of an interrupt.
+ *
+ * @param interruptType - the interrupt: TIMER_16_0_IRQn, I2C_IRQn, ...
+ * @return The priority, 0..3, lower value preempts higher.
+ */
+unsigned int getInterruptPriority(IRQn_Type interruptType);
+
+
 /**
  * This define creates an interrupt handler that calls a callback function.
  *
@@ -95,6 +147,52 @@ void setPendingInterrupt(IRQn_Type interruptType);
 extern "C" void handler() { callback; }
 
 
+class InterruptLock
+/**
+ * A scoped critical section that masks a single interrupt in the NVIC.
+ * The interrupt is disabled by the constructor and restored to its
+ * previous enable state by the destructor, so locks nest correctly.
+ *
+ * Use this instead of noInterrupts()/interrupts() when the protected
+ * data is only shared with one interrupt handler: a global critical
+ * section also stalls the bus timer interrupt and can lose bus bits,
+ * masking just the relevant peripheral cannot. An interrupt that fires
+ * while masked stays pending and is handled when the lock is released.
+ *
+ * Example:
+ *
+ *     {
+ *         InterruptLock lock(UART_IRQn);
+ *         head = next;  // touch data shared with UART_IRQHandler()
+ *     }                 // the UART interrupt is restored here
+ */
+{
+public:
+    /**
+     * Mask an interrupt until the end of the scope.
+     *
+     * @param interruptType - the interrupt to mask: UART_IRQn, ...
+     */
+    explicit InterruptLock(IRQn_Type interruptType)
+    : irq(interruptType)
+    , wasEnabled(NVIC->ISER[0] & (1 << (interruptType & 0x1f)))
+    {
+        NVIC->ICER[0] = 1 << (irq & 0x1f);
+    }
+
+    /** Restore the previous enable state of the interrupt */
+    ~InterruptLock()
+    {
+        if (wasEnabled)
+            NVIC->ISER[0] = wasEnabled;
+    }
+
+private:
+    IRQn_Type irq;           //!< the masked interrupt
+    unsigned int wasEnabled; //!< the enable bit before masking, 0 if none
+};
+
+
 //
 // Inline functions
 //
@@ -134,4 +232,14 @@ ALWAYS_INLINE void setPendingInterrupt(IRQn_Type interruptType)
     NVIC->ICPR[0] = 1 << (interruptType & 0x1f);
 }
 
+ALWAYS_INLINE void setInterruptPriority(IRQn_Type interruptType, unsigned int priority)
+{
+    NVIC_SetPriority(interruptType, priority);
+}
+
+ALWAYS_INLINE unsigned int getInterruptPriority(IRQn_Type interruptType)
+{
+    return NVIC_GetPriority(interruptType);
+}
+
 #endif /*sblib_interrupt_h*/
@@ -28,6 +28,50 @@ public:
      */
     Font(int firstChar, int numChars, int charWidth, const char* data);
 
+    /**
+     * Create a proportional font object. Every character has its own
+     * width; the width and offset tables are computed when the font is
+     * built and live in flash, so the layout lookup for a character is
+     * a single array access.
+     *
+     * @param firstChar - the first character in the font
+     * @param numChars - the number of characters in the font
+     * @param charWidth - the width of the widest character in pixel
+     * @param data - the font data bytes, the glyph columns back to back
+     * @param widths - per character: the width in pixel, numChars entries
+     * @param offsets - per character: the offset of the first glyph column
+     *                  in data, numChars entries
+     */
+    Font(int firstChar, int numChars, int charWidth, const char* data,
+         const unsigned char* widths, const unsigned short* offsets);
+
+    /**
+     * The width of a character in pixel: the character's own width for a
+     * proportional font, the fixed cell width otherwise. Unknown
+     * characters have the width 0.
+     *
+     * @param ch - the character
+     * @return The width of the character in pixel.
+     */
+    int charWidthOf(int ch) const;
+
+    /**
+     * The offset of the first glyph column of a character in data.
+     *
+     * @param idx - the character index: ch - firstChar
+     * @return The offset in data.
+     */
+    int charOffset(int idx) const;
+
+    /**
+     * The width of a string in pixel when rendered with this font, for
+     * layout calculations.
+     *
+     * @param text - the string
+     * @return The width in pixel.
+     */
+    int textWidth(const char* text) const;
+
     /**
      * The first character in the font.
      */
@@ -44,9 +88,40 @@ public:
     const int charWidth;
 
     /**
-     * The raw font data bytes, an array of numChars*charWidth size.
+     * The raw font data bytes, an array of numChars*charWidth size for a
+     * fixed-cell font, the glyph columns back to back for a proportional
+     * font.
      */
     const char* data;
+
+    /**
+     * Per character: the width in pixel. 0 for a fixed-cell font.
+     */
+    const unsigned char* widths;
+
+    /**
+     * Per character: the offset of the first glyph column in data.
+     * 0 for a fixed-cell font.
+     */
+    const unsigned short* offsets;
 };
 
+
+//
+//  Inline functions
+//
+
+inline int Font::charWidthOf(int ch) const
+{
+    int idx = ch - firstChar;
+    if (idx < 0 || idx >= numChars)
+        return 0;
+    return widths ? widths[idx] : charWidth;
+}
+
+inline int Font::charOffset(int idx) const
+{
+    return offsets ? offsets[idx] : idx * charWidth;
+}
+
 #endif /*sblib_lcd_font_h*/
@@ -15,6 +15,12 @@
 class Font;
 
 
+/**
+ * The maximum number of display pages (rows of 8 pixels) that the
+ * framebuffer dirty tracking can handle.
+ */
+#define LCD_MAX_PAGES 8
+
 /**
  * Base class for graphical LCD displays.
  */
@@ -26,6 +32,118 @@ public:
      */
     void clear();
 
+    /**
+     * Use a framebuffer for the display. Drawing then only mutates the
+     * framebuffer in RAM, and flush() transfers the changed parts to the
+     * display controller. Without a framebuffer every drawing operation
+     * is written through to the controller as it happens.
+     *
+     * @param buffer - the framebuffer: width * height bytes, one byte per
+     *                 page (8 vertical pixels) and column.
+     */
+    void frameBuffer(byte* buffer);
+
+    /**
+     * Transfer the changed parts of the framebuffer to the display
+     * controller. Per display page only the span of columns that was
+     * touched since the last flush is written, so updating a single
+     * value costs a few small transfers instead of a full redraw.
+     */
+    void flush();
+
+    /**
+     * Use a second buffer that holds the frame as it was last transferred
+     * to the display controller. flush() then diffs every dirty span
+     * against this shadow frame and transmits only the bytes that really
+     * changed - redraws that repaint a region with mostly identical
+     * content, e.g. animated indicators, cost only their actual visual
+     * change in display bandwidth. Requires a framebuffer, see
+     * frameBuffer().
+     *
+     * @param buffer - the shadow frame buffer: width * height bytes, like
+     *                 the framebuffer.
+     */
+    void shadowBuffer(byte* buffer);
+
+    /**
+     * Transfer at most maxBytes framebuffer bytes to the display
+     * controller, continuing where the previous call stopped. This
+     * slices a display update into small transfers whose duration - and
+     * with it the added latency for everything else in the loop - is
+     * bounded by the chunk size, while repeated calls still complete the
+     * frame. Typical use is flushing in bus idle gaps:
+     *
+     *     if (bus.idle())
+     *         lcd.flushChunk(32);
+     *
+     * so display transfers never collide with telegram processing.
+     *
+     * @param maxBytes - the maximum number of bytes to transfer
+     * @return True if dirty data remains for another call, false when
+     *         the display is up to date.
+     */
+    bool flushChunk(int maxBytes);
+
+    /**
+     * Blit a string into the framebuffer at the given position. The
+     * string is clipped to the display once, then the glyph columns are
+     * copied into the framebuffer with a tight copy kernel (word stores
+     * where the alignment allows) and the touched span is marked dirty
+     * in one go - much faster than write() per character for the status
+     * lines that make up most redraws.
+     *
+     * @param x - the X position of the first glyph column
+     * @param page - the display page (row of 8 pixels)
+     * @param text - the string to blit
+     */
+    void drawString(int x, int page, const char* text);
+
+    /**
+     * Draw a bitmap into the framebuffer. The bitmap data is organized
+     * like the framebuffer: one byte per page (8 vertical pixels) and
+     * column, the pages back to back.
+     *
+     * @param x - the X position of the first bitmap column
+     * @param page - the display page of the first bitmap page
+     * @param data - the bitmap data: bmWidth * bmPages bytes
+     * @param bmWidth - the width of the bitmap in columns
+     * @param bmPages - the height of the bitmap in pages
+     */
+    void drawBitmap(int x, int page, const byte* data, int bmWidth, int bmPages);
+
+    /**
+     * Draw an RLE compressed bitmap into the framebuffer. The bitmap was
+     * compressed at build time, see sblib/lcd/resource.h; the decode is
+     * streamed directly into the framebuffer.
+     *
+     * @param x - the X position of the first bitmap column
+     * @param page - the display page of the first bitmap page
+     * @param data - the compressed bitmap data
+     * @param bmWidth - the width of the bitmap in columns
+     * @param bmPages - the height of the bitmap in pages
+     */
+    void drawBitmapRLE(int x, int page, const byte* data, int bmWidth, int bmPages);
+
+    /**
+     * Fill a span of framebuffer columns of a page with a byte pattern,
+     * e.g. 0 to blank a text region before redrawing it.
+     *
+     * @param page - the display page (row of 8 pixels)
+     * @param x - the first column of the span
+     * @param count - the number of columns to fill
+     * @param pattern - the byte to fill with (default: 0)
+     */
+    void fillPage(int page, int x, int count, byte pattern = 0);
+
+    /**
+     * Set or clear a pixel of the framebuffer.
+     *
+     * @param x - the X position of the pixel
+     * @param y - the Y position of the pixel
+     * @param set - true to set the pixel, false to clear it
+     */
+    void setPixel(int x, int y, bool set);
+
     /**
      * Position the cursor. 0/0 is the top/left position
      * on the display.
@@ -52,8 +170,34 @@ protected:
      */
     LcdGraphical(const Font& font, int width, int height);
 
+    /**
+     * Write framebuffer bytes to the display controller. Called by
+     * flush() for every dirty span. Implemented by the display driver.
+     *
+     * @param page - the display page (row of 8 pixels)
+     * @param x - the first column of the span
+     * @param data - the framebuffer bytes to write
+     * @param count - the number of bytes to write
+     */
+    virtual void writePage(int page, int x, const byte* data, int count);
+
+    /**
+     * Mark a span of columns of a page as dirty, to be transferred by
+     * the next flush().
+     *
+     * @param page - the display page (row of 8 pixels)
+     * @param x0 - the first column of the span
+     * @param x1 - the last column of the span
+     */
+    void markDirty(int page, int x0, int x1);
+
     const Font* fnt;
     const int width, height;
+
+    byte* fb;                       //!< The framebuffer, 0 if unbuffered
+    byte* shadow;                   //!< The last transferred frame, 0 if unused
+    byte dirtyMin[LCD_MAX_PAGES];   //!< Per page: first dirty column
+    byte dirtyMax[LCD_MAX_PAGES];   //!< Per page: last dirty column + 1
 };
 
 
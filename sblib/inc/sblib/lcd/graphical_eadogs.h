@@ -84,9 +84,22 @@ public:
      */
     virtual void clear();
 
+protected:
+    /**
+     * Write framebuffer bytes to the display controller, see
+     * LcdGraphical::flush().
+     *
+     * @param page - the display page (row of 8 pixels)
+     * @param x - the first column of the span
+     * @param data - the framebuffer bytes to write
+     * @param count - the number of bytes to write
+     */
+    virtual void writePage(int page, int x, const byte* data, int count);
+
 protected:
     SPI spi;
     const int pinCD, pinCS;
+    int cursorX, cursorPage;
 };
 
 
@@ -12,25 +12,31 @@
 #define sblib_lcd_graphical_sed1520_h
 
 #include <sblib/lcd/graphical.h>
+#include <sblib/digital_pin.h>
 #include <sblib/ioports.h>
 
 
 /**
  * Class for graphical LCD display with a SED1520 compatible controller.
+ * The display is driven over its 8 bit parallel interface: the data lines
+ * on pins 0-7 of one GPIO port, written with a single masked port store
+ * per byte. Two controllers drive the left and the right half of the
+ * display.
  *
  * The fonts are stored in separate files. The default font can be used with
  * #include <sblib/lcd/font_5x7.h> and is named font_5x7.
  *
- * WARNING
- *
- * This code is only half done !
- *
+ * Reading from the display (busy flag, read-modify-write) is not
+ * implemented; the write timing is slow enough that the controller is
+ * never busy.
  */
 class LcdGraphicalSED1520: public LcdGraphical
 {
 public:
     /**
      * Create a graphical LCD display for a SED1520 compatible controller.
+     * The data lines of the display must be connected to the pins 0-7 of
+     * the data port.
      *
      * @param dataPort - the IO port for the data lines: PIO0, PIO1, PIO2, PIO3
      * @param pinA0 - the digital pin for instruction/data select
@@ -43,6 +49,17 @@ public:
     LcdGraphicalSED1520(int dataPort, int pinA0, int pinCS1, int pinCS2, int pinRD,
         int pinWR, const Font& font);
 
+    /**
+     * Begin using the display: switches the data port to output and
+     * initializes both display controllers.
+     */
+    void begin();
+
+    /**
+     * End using the display (sleep mode).
+     */
+    void end();
+
     /**
      * Position the cursor. 0/0 is the top/left position
      * on the display.
@@ -52,14 +69,69 @@ public:
      */
     virtual void pos(int x, int y);
 
+    /**
+     * Write a single character.
+     *
+     * @param ch - the character to write.
+     *
+     * @return 1 if the character was written, 0 if not.
+     */
+    virtual int write(byte ch);
+
+    /**
+     * Clear the display.
+     */
+    virtual void clear();
+
 protected:
+    /**
+     * Write framebuffer bytes to the display controller, see
+     * LcdGraphical::flush(). The span is split at the boundary between
+     * the two controllers.
+     *
+     * @param page - the display page (row of 8 pixels)
+     * @param x - the first column of the span
+     * @param data - the framebuffer bytes to write
+     * @param count - the number of bytes to write
+     */
+    virtual void writePage(int page, int x, const byte* data, int count);
+
+    /**
+     * Strobe a byte into the selected display controller.
+     *
+     * @param value - the byte to write.
+     */
+    void strobeByte(byte value);
+
+    /**
+     * Write a command byte to one display controller.
+     *
+     * @param chip - the controller: 0 for CS1, 1 for CS2.
+     * @param cmd - the command byte.
+     */
+    void writeCommand(int chip, byte cmd);
+
+    /**
+     * Write a span of data bytes to one display controller.
+     *
+     * @param chip - the controller: 0 for CS1, 1 for CS2.
+     * @param page - the display page (row of 8 pixels)
+     * @param col - the first column, local to the controller
+     * @param data - the data bytes to write
+     * @param count - the number of bytes to write
+     */
+    void writeChipSpan(int chip, int page, int col, const byte* data, int count);
+
     /**
      * Wait until the display is idle.
      */
     void idle();
 
 protected:
+    PortHandle dataBus;   //!< The 8 data lines, written with one store
+    PortHandle wrStrobe;  //!< The WR pin, pre-resolved for the byte loop
     const int dataPort, pinA0, pinCS1, pinCS2, pinRD, pinWR;
+    int cursorX, cursorPage;
 };
 
 
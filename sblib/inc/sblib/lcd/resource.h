@@ -0,0 +1,42 @@
+/*
+ *  resource.h - RLE compressed flash resources for LCD fonts and bitmaps.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_lcd_resource_h
+#define sblib_lcd_resource_h
+
+#include <sblib/types.h>
+
+/**
+ * The compression of the LCD resources is a byte RLE that is tuned for
+ * glyph and bitmap column data, where long runs of 0x00 and 0xff bytes
+ * dominate. The encoded stream is a sequence of blocks, each starting
+ * with a control byte c:
+ *
+ * c < 0x80:  a literal block, the c + 1 following bytes are copied
+ * c >= 0x80: a run, the one following byte is repeated c - 0x80 + 2 times
+ *
+ * The stream carries no length: the decoder is driven by the expected
+ * output size. Resources are converted at build time with
+ * tools/lcd-rle.py, which emits the encoded bytes as a C array.
+ */
+
+/**
+ * Decode RLE compressed resource bytes, see the format description above.
+ * The decode is a plain copy loop and fast enough to feed the blitter on
+ * demand.
+ *
+ * @param src - the encoded bytes
+ * @param dst - the buffer for the decoded bytes
+ * @param count - the number of bytes to decode
+ * @return The position in src just past the consumed input, to continue
+ *         decoding the stream from there.
+ */
+const byte* lcdResourceDecode(const byte* src, byte* dst, int count);
+
+#endif /*sblib_lcd_resource_h*/
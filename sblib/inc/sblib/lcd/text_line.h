@@ -0,0 +1,83 @@
+/*
+ *  text_line.h - a cached text line widget for graphical LCD displays.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_lcd_text_line_h
+#define sblib_lcd_text_line_h
+
+#include <sblib/lcd/graphical.h>
+
+/**
+ * A text line widget: a bounded text region on a graphical LCD display
+ * that remembers the string it last drew. Showing the same content again
+ * is an early-out string compare; only an actual change blanks the
+ * region, rasterizes the new string and marks the span dirty. This
+ * removes the steady-state cost of display loops that redraw unchanged
+ * status strings every cycle.
+ *
+ * Requires a framebuffer on the display, see LcdGraphical::frameBuffer().
+ *
+ * Example:
+ *
+ *     char cache[22];
+ *     LcdTextLine status;
+ *     status.begin(lcd, 0, 0, 102, cache, sizeof(cache));
+ *     ...
+ *     status.show(buffer);    // every loop; draws only on change
+ *     lcd.flush();
+ */
+class LcdTextLine
+{
+public:
+    /**
+     * Create a text line widget.
+     */
+    LcdTextLine();
+
+    /**
+     * Begin using the text line.
+     *
+     * @param lcd - the display to draw on
+     * @param x - the first column of the text region
+     * @param page - the display page (row of 8 pixels) of the region
+     * @param width - the width of the region in columns
+     * @param cache - the buffer for the last drawn string
+     * @param cacheSize - the size of the cache buffer, including the
+     *                    terminating zero
+     */
+    void begin(LcdGraphical& lcd, int x, int page, int width,
+               char* cache, int cacheSize);
+
+    /**
+     * Show a string in the text region. When the string equals the last
+     * drawn one, nothing is done; otherwise the region is blanked, the
+     * string is drawn and the change is transferred with the display's
+     * next flush(). Strings longer than the cache are truncated.
+     *
+     * @param text - the string to show
+     * @return True if the string changed and was drawn, false if the
+     *         content was already up to date.
+     */
+    bool show(const char* text);
+
+    /**
+     * Force the next show() to draw, e.g. after the display was
+     * re-initialized.
+     */
+    void invalidate();
+
+protected:
+    LcdGraphical* lcd;   //!< The display to draw on
+    short x;             //!< The first column of the region
+    byte page;           //!< The display page of the region
+    short regionWidth;   //!< The width of the region in columns
+    char* cache;         //!< The last drawn string
+    byte cacheSize;      //!< The size of the cache buffer
+};
+
+#endif /*sblib_lcd_text_line_h*/
@@ -23,4 +23,18 @@ void setup();
  */
 void loop();
 
+/**
+ * Sleep until the next interrupt if the device has nothing to do: the bus
+ * is idle and no com-object is waiting to be transmitted. Call this at the
+ * end of loop() when all work of the application is interrupt or timer
+ * driven.
+ *
+ * The processor enters sleep mode with all peripherals running: bus
+ * traffic wakes it through the bus timer capture interrupt with plain
+ * interrupt latency, and the system timer wakes it at the next
+ * millisecond tick, so loop() keeps being called at least once per msec
+ * and Timeout / ScheduledTimeout deadlines are met at their granularity.
+ */
+void sleepIfIdle();
+
 #endif /*sblib_main_h*/
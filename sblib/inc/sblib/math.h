@@ -100,4 +100,88 @@
  */
 #define sq(x) ((x) * (x))
 
+
+/**
+ * A Q16.16 fixed-point number: 16 integer bits, 16 fraction bits.
+ * Fixed-point arithmetic takes tens of cycles per operation on the
+ * Cortex-M0, where every software float operation costs hundreds.
+ */
+typedef int fixed;
+
+/**
+ * The fixed-point value 1.0
+ */
+#define FIX_ONE 0x10000
+
+/**
+ * Convert a constant to fixed-point, e.g. FIX(2.5) or FIX(180).
+ * For compile-time constants only - the conversion is done by the
+ * compiler and no float code ends up in the binary.
+ */
+#define FIX(x) ((fixed) ((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/**
+ * Convert an integer to fixed-point.
+ */
+#define FIX_FROM_INT(x) ((fixed) (x) << 16)
+
+/**
+ * Convert a fixed-point value to an integer, truncating the fraction.
+ */
+#define FIX_TO_INT(x) ((x) >> 16)
+
+/**
+ * Multiply two fixed-point values, with rounding.
+ *
+ * @param a - the first factor.
+ * @param b - the second factor.
+ * @return The product a*b as fixed-point value.
+ */
+fixed fixMul(fixed a, fixed b);
+
+/**
+ * Divide two fixed-point values, with rounding.
+ *
+ * @param a - the dividend.
+ * @param b - the divisor, must not be zero.
+ * @return The quotient a/b as fixed-point value.
+ */
+fixed fixDiv(fixed a, fixed b);
+
+/**
+ * The sine of an angle, by table lookup with linear interpolation.
+ * The result is exact to about 4 fraction digits.
+ *
+ * @param angle - the angle in fixed-point degrees, e.g. FIX(45).
+ *                Any angle is allowed, also negative or above 360.
+ * @return The sine as fixed-point value: -FIX_ONE..FIX_ONE
+ */
+fixed fixSin(fixed angle);
+
+/**
+ * The cosine of an angle, see fixSin().
+ *
+ * @param angle - the angle in fixed-point degrees, e.g. FIX(45).
+ * @return The cosine as fixed-point value: -FIX_ONE..FIX_ONE
+ */
+fixed fixCos(fixed angle);
+
+/**
+ * The square root of a fixed-point value, by Newton iteration.
+ *
+ * @param x - the value, must not be negative.
+ * @return The square root as fixed-point value.
+ */
+fixed fixSqrt(fixed x);
+
+/**
+ * Linear interpolation between two fixed-point values.
+ *
+ * @param a - the value at t == 0.
+ * @param b - the value at t == FIX_ONE.
+ * @param t - the interpolation position, usually 0..FIX_ONE.
+ * @return The interpolated value: a + (b - a) * t
+ */
+fixed fixLerp(fixed a, fixed b, fixed t);
+
 #endif /*sblib_math_h*/
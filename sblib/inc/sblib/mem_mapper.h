@@ -19,6 +19,16 @@
 #define MEM_MAPPER_OUT_OF_MEMORY   -4
 #define MEM_MAPPER_INVALID_LENGTH  -8
 
+/**
+ * The number of flash pages that a MemMapper buffers in RAM at the same
+ * time. With more than one buffer, writes that alternate between pages or
+ * span a page boundary do not force a flash transaction per page change;
+ * the least recently used buffer is written back when a new page is needed.
+ */
+#ifndef MEM_MAPPER_WRITE_BUFFERS
+#define MEM_MAPPER_WRITE_BUFFERS 2
+#endif
+
 class MemMapper
 {
 public:
@@ -113,6 +123,17 @@ public:
      * @return The data byte.
      */
     unsigned char getUInt8(int virtAddress);
+
+    /**
+     * Read access to a data byte. Reads of pages that are held dirty in a
+     * write buffer are served from the buffer, without flushing - so
+     * interleaving reads with buffered writes (e.g. append then verify)
+     * does not force premature flash commits. Do not write through the
+     * returned reference, use writeMem() or the setUIntX() methods.
+     *
+     * @param nIndex - the virtual address of the data byte to access.
+     * @return A reference to the data byte.
+     */
     unsigned char &operator[] (const int nIndex) const;
 
     /**
@@ -168,6 +189,21 @@ public:
      */
     byte* memoryPtr(int virtAddress, bool forceFlash = true) const;
 
+    /**
+     * Read-only access to the user EEPROM as a pointer, without flushing:
+     * a page that is held dirty in a write buffer is served from the
+     * buffer, so the read sees the buffered data and no flash transaction
+     * is triggered. Use this instead of memoryPtr() where reads interleave
+     * with buffered writes.
+     *
+     * The pointer is only valid until the next write or flush - a write
+     * may evict the page from its buffer.
+     *
+     * @param virtAddresss - the virtual address of the data block.
+     * @return a pointer to the desired data, 0 if the address is not mapped
+     */
+    const byte* readOnlyPtr(int virtAddress) const;
+
     /**
      * Query about mapping
      *
@@ -182,22 +218,86 @@ private:
     unsigned int getUIntX(int virtAddress, int length);
     int setUIntX(int virtAddress, int length, int val);
 
+    /**
+     * Get the virtual page that is mapped to the flash page.
+     *
+     * @param flashPageNum - the flash page number.
+     * @return The virtual page, -1 if no virtual page maps to the flash page.
+     */
+    int virtPageOf(int flashPageNum) const;
+
+    /**
+     * Test if the flash page is neither mapped to a virtual page nor held in
+     * a write buffer.
+     *
+     * @param flashPageNum - the flash page number.
+     * @return True if the flash page is free.
+     */
+    bool isFreePage(int flashPageNum) const;
+
+    /**
+     * Find a free physical flash page, searching ascending from the last
+     * allocated page and wrapping around within the flash region, so
+     * consecutive allocations rotate over all free pages.
+     *
+     * @return The flash page number, 0 if all pages are in use.
+     */
+    int findFreePage() const;
+
+    /**
+     * Get the index of the write buffer that holds the flash page.
+     *
+     * @param flashPageNum - the flash page number.
+     * @return The buffer index, -1 if the page is not buffered.
+     */
+    int bufferIndexOf(int flashPageNum) const;
+
+    /**
+     * Get a free write buffer by flushing and evicting the least recently
+     * used one.
+     *
+     * @return The buffer index.
+     */
+    int evictBuffer() const;
+
+    /**
+     * Get the write buffer that holds the flash page, loading the page into
+     * the least recently used buffer if it is not buffered yet.
+     *
+     * @param flashPageNum - the flash page number.
+     * @return The buffer index.
+     */
+    int loadPage(int flashPageNum) const;
+
+    /**
+     * Write the buffer back to flash if it holds modified data.
+     *
+     * @param index - the buffer index.
+     * @return 2 if the buffer was flashed, 0 if not.
+     */
+    int flushBuffer(int index) const;
+
     unsigned int flashBase; //memory layout: flashBase + 0 = allocTable, flashBase + 1 = usableMemory
     unsigned int flashBasePage;
 
     unsigned int flashSize;
     unsigned int flashSizePages;
 
-    byte allocTable[FLASH_PAGE_SIZE];
+    mutable byte allocTable[FLASH_PAGE_SIZE];
+
+    mutable int cachedVirtPage;   // the last resolved virtual page, -1 if none
+    mutable byte* cachedPagePtr;  // the data of the last resolved virtual page
 
-    mutable byte writeBuf[FLASH_PAGE_SIZE];
-    mutable int writePage;
+    mutable byte writeBuf[MEM_MAPPER_WRITE_BUFFERS][FLASH_PAGE_SIZE];
+    mutable int writePage[MEM_MAPPER_WRITE_BUFFERS];
+    mutable bool bufModified[MEM_MAPPER_WRITE_BUFFERS];
+    mutable unsigned int bufLastUsed[MEM_MAPPER_WRITE_BUFFERS];
+    mutable unsigned int useCounter;
 
-    unsigned int lastAllocated;
+    mutable unsigned int lastAllocated;
     int endianess;
 
     bool autoAddPage;
-    mutable bool flashMemModified;
     mutable bool allocTableModified;
 };
 
@@ -0,0 +1,79 @@
+/*
+ *  mem_usage.h - Stack and heap usage instrumentation.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_mem_usage_h
+#define sblib_mem_usage_h
+
+/**
+ * Stack high water mark instrumentation. stackPaint() fills the unused
+ * stack area with a known pattern; stackMaxUsed() later scans for the
+ * first overwritten word and reports how deep the stack ever grew. Call
+ * stackPaint() as early as possible, e.g. first thing in setup() - the
+ * stack bytes that were already used before the call are counted as used.
+ *
+ * On the 4 KB parts this turns buffer sizing from guesswork into
+ * measurement: the worst case of interrupt nesting on top of the deepest
+ * application call chain shows up in the mark after a long test run.
+ */
+
+/** The pattern that stackPaint() fills the unused stack with */
+#define STACK_PAINT_PATTERN 0xc5c5c5c5
+
+/**
+ * Paint the unused stack area, from the end of the static data up to
+ * just below the current stack pointer.
+ */
+void stackPaint();
+
+/**
+ * Get the maximum number of stack bytes that were used since the call
+ * to stackPaint().
+ *
+ * @return The stack high water mark in bytes.
+ */
+unsigned int stackMaxUsed();
+
+/**
+ * Get the number of stack bytes that were never used since the call to
+ * stackPaint() - the measured headroom between stack and static data.
+ *
+ * @return The untouched stack area in bytes.
+ */
+unsigned int stackFree();
+
+/**
+ * Paint an explicit memory region. Used internally by stackPaint() and
+ * directly by the host tests, which cannot paint the real stack.
+ *
+ * @param start - the first word to paint.
+ * @param end - the first word that is not painted anymore.
+ */
+void stackPaintRegion(unsigned int* start, unsigned int* end);
+
+/**
+ * Scan a painted region for the first overwritten word.
+ *
+ * @param start - the first word of the painted region.
+ * @param end - the first word behind the painted region.
+ * @return The number of untouched bytes from start.
+ */
+unsigned int stackUntouchedRegion(const unsigned int* start, const unsigned int* end);
+
+/**
+ * Heap usage counters. The library itself does not allocate, but
+ * applications may; the counters make the heap traffic visible.
+ *
+ * @return The number of calls to operator new / operator delete and the
+ * total number of requested bytes.
+ */
+unsigned int heapAllocCount();
+unsigned int heapFreeCount();
+unsigned int heapAllocBytes();
+
+#endif /*sblib_mem_usage_h*/
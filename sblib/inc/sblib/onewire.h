@@ -23,8 +23,45 @@
 
 #define ONEWIRE_SEARCH          1      // Exclude onewire_search by defining this to '0'
 #define ONEWIRE_CRC             1      // Exclude CRC checks altogether by defining this to '0'
+#define ONEWIRE_CRC8_TABLE      1      // Compute the 8-bit CRC with a 256-entry table in flash (~8x faster); define to '0' for the small bitwise version
 #define ONEWIRE_CRC16           1      // Allow 16-bit CRC checks by defining this to 1 (Note that ONEWIRE_CRC must also be 1.)
 #define ONEWIRE_INTERNAL_PULLUP 1      // Use internal pull-up resistor instead of regular 4.7KOhms (Info -> http://wp.josh.com/2014/06/23/no-external-pull-up-needed-for-ds18b20-temp-sensor/)
+#define ONEWIRE_ASYNC           1      // Exclude the timer driven engine by defining this to '0'
+
+// ROM commands
+#define ONEWIRE_CMD_READ_ROM        0x33
+#define ONEWIRE_CMD_MATCH_ROM       0x55
+#define ONEWIRE_CMD_SKIP_ROM        0xCC
+#define ONEWIRE_CMD_SEARCH_ROM      0xF0
+#define ONEWIRE_CMD_OVERDRIVE_SKIP  0x3C  // Skip ROM and switch all overdrive capable devices to overdrive speed
+#define ONEWIRE_CMD_OVERDRIVE_MATCH 0x69  // Match ROM and switch the addressed device to overdrive speed
+
+// Communication speed of the bus, see OneWireSetSpeed()
+enum OneWireSpeed
+{
+  ONEWIRE_SPEED_STANDARD  = 0,         // standard speed, all devices
+  ONEWIRE_SPEED_OVERDRIVE = 1          // overdrive speed (~10x), overdrive capable devices only
+};
+
+/*****************************************************************************
+** OneWireTiming - Struct for containing the slot timings of one speed.
+**                 All times are in microseconds.
+*****************************************************************************/
+typedef struct
+{
+  uint16_t resetLowTime;    // reset: low time of the reset pulse
+  uint16_t presenceDelay;   // reset: delay from the release to the presence sample
+  uint16_t resetRecover;    // reset: rest of the reset cycle after the sample
+  uint8_t write1Low;        // write 1 slot: low time
+  uint8_t write1High;       // write 1 slot: high / recovery time
+  uint8_t write0Low;        // write 0 slot: low time
+  uint8_t write0High;       // write 0 slot: high / recovery time
+  uint8_t readLow;          // read slot: low time
+  uint8_t readSampleDelay;  // read slot: delay from the release to the sample
+  uint8_t readRecover;      // read slot: rest of the slot after the sample
+} OneWireTiming;
+
+class Timer;
 
 /*
  * OneWire Class
@@ -33,6 +70,30 @@ class OneWire
 {
   private:
     int _pin;
+    OneWireSpeed _eSpeed;              // the current communication speed
+    const OneWireTiming* _timing;      // the slot timings of the current speed
+    int _pullupPin;                    // GPIO of the external strong pull-up, -1 if unset
+    bool _bPullupActiveHigh;           // level of _pullupPin that switches the pull-up on
+    bool _bPullupActive;               // the strong pull-up is currently applied
+
+    void ReleaseStrongPullup();        // switch the strong pull-up off, if active
+#if ONEWIRE_ASYNC                      // State of the timer driven engine
+    Timer* _timer;            // The timer that generates the slots, 0 if unset
+    volatile uint8_t _uAsyncState;
+    bool _bAsyncRead;         // the running operation reads from the bus
+    bool _bAsyncPresence;     // presence pulse seen at the last async reset
+    const uint8_t* _pAsyncTxBuf;
+    uint8_t* _pAsyncRxBuf;
+    uint16_t _uAsyncCount;    // bytes still to transfer (including the current)
+    uint8_t _uAsyncByte;      // shift register for the current byte
+    uint8_t _uAsyncBitMask;
+
+    void AsyncStartReset();
+    void AsyncStartBit();
+    void AsyncNextBit();
+    void AsyncFinish();
+    void AsyncSchedule(unsigned int timeUs);
+#endif
 #if ONEWIRE_SEARCH                     // Global search state
     byte ROM_NO[8];           // Device ROM. 64bit Lasered ROM-Code to detect the Family Code
     uint8_t _LastDiscrepancy;
@@ -144,6 +205,83 @@ class OneWire
     */
     void OneWireSkip(void);
 
+   /*
+    * Function name:  OneWireSetSpeed
+    * Descriptions:   Select the communication speed of the bus. All slot
+    *                 timings are taken from the table of the selected speed.
+    *                 Note that the devices themselves only listen at
+    *                 overdrive speed after an overdrive ROM command, use
+    *                 OneWireOverdriveSkip() / OneWireOverdriveMatch() for
+    *                 that. A reset at standard speed brings every device
+    *                 back to standard speed.
+    * parameters:     speed (ONEWIRE_SPEED_STANDARD or ONEWIRE_SPEED_OVERDRIVE)
+    * Returned value: none
+    */
+    void OneWireSetSpeed(OneWireSpeed speed);
+
+    /*
+     * Function name: OneWireGetSpeed
+     * Description:   The current communication speed of the bus
+     * parameters:    none
+     * Returned value: the current speed
+     */
+    inline OneWireSpeed OneWireGetSpeed() { return this->_eSpeed; }
+
+   /*
+    * Function name:  OneWireOverdriveSkip
+    * Descriptions:   Switch all overdrive capable devices on the bus to
+    *                 overdrive speed: reset at standard speed, issue the
+    *                 Overdrive Skip ROM command and switch this bus instance
+    *                 to overdrive. Like after OneWireSkip(), all devices are
+    *                 addressed; follow up with a reset (now at overdrive
+    *                 speed) and a ROM select to talk to a single one.
+    * parameters:     none
+    * Returned value: true if a device responded to the standard speed reset
+    */
+    bool OneWireOverdriveSkip();
+
+   /*
+    * Function name:  OneWireOverdriveMatch
+    * Descriptions:   Switch one overdrive capable device to overdrive speed
+    *                 and select it: reset at standard speed, issue the
+    *                 Overdrive Match ROM command, switch to overdrive and
+    *                 send the ROM at overdrive speed. Afterwards the device
+    *                 is selected like after OneWireSelect().
+    * parameters:     ROM
+    * Returned value: true if a device responded to the standard speed reset
+    */
+    bool OneWireOverdriveMatch(const uint8_t rom[8]);
+
+   /*
+    * Function name:  OneWireSetStrongPullup
+    * Descriptions:   Assign a GPIO that switches an external strong pull-up
+    *                 (e.g. a P-FET between VCC and the data line) for
+    *                 parasite powered devices. OneWirePower() then switches
+    *                 the FET instead of driving the data pin, which can
+    *                 supply the higher conversion current of a whole sensor
+    *                 string. The pin is configured as output and the
+    *                 pull-up starts switched off. Without this call,
+    *                 OneWirePower() drives the data pin push-pull.
+    * parameters:     pin, bActiveHigh: the level that switches the pull-up
+    *                 on (default: true)
+    * Returned value: none
+    */
+    void OneWireSetStrongPullup(int pin, bool bActiveHigh= true);
+
+   /*
+    * Function name:  OneWirePower
+    * Descriptions:   Apply the strong pull-up to the bus, e.g. during the
+    *                 conversion of parasite powered DS18x20 sensors. With a
+    *                 pull-up pin (see OneWireSetStrongPullup()) the external
+    *                 pull-up is switched on, otherwise the data pin is
+    *                 driven high push-pull. The pull-up is released
+    *                 automatically by the next OneWireReset() and by
+    *                 OneWireDePower().
+    * parameters:     none
+    * Returned value: none
+    */
+    void OneWirePower(void);
+
    /*
     * Function name:  OneWireDePower
     * Descriptions:   Stop forcing power onto the bus. You only need to do this if
@@ -151,6 +289,8 @@ class OneWire
     *                 used a OneWireWriteBit() call and aren't about to do another
     *                 read or write. You would rather not leave this powered if you
     *                 don't have to, just in case someone shorts your bus.
+    *                 An external strong pull-up (see OneWirePower()) is
+    *                 switched off as well.
     * parameters:     none
     * Returned value: none
     */
@@ -164,6 +304,77 @@ class OneWire
      */
     inline bool IsParasiteMode(){ return this->m_bParasitePowerMode; }
 
+#if ONEWIRE_ASYNC
+   /*
+    * Function name:  OneWireSetTimer
+    * Descriptions:   Assign the timer that generates the 1-Wire time slots.
+    *                 The timer is claimed completely (1us resolution, match
+    *                 channel MAT0) and must not be used for anything else.
+    *                 Connect its interrupt handler to this object with the
+    *                 ONEWIRE_TIMER_INTERRUPT_HANDLER() macro. Once a timer is
+    *                 set, OneWireStartWrite() / OneWireStartRead() run the bus
+    *                 from the timer interrupt: no busy waiting, the CPU is
+    *                 free between the slot edges.
+    * parameters:     timer (e.g. timer16_0)
+    * Returned value: none
+    */
+    void OneWireSetTimer(Timer& timer);
+
+   /*
+    * Function name:  OneWireStartWrite
+    * Descriptions:   Write bytes in the background, driven by the timer
+    *                 interrupt. With bReset a reset cycle is generated first
+    *                 and the presence answer is latched (see
+    *                 OneWireAsyncPresence()). Poll OneWireAsyncDone() for the
+    *                 end of the transfer; buf must stay valid until then. The
+    *                 same end-of-write bus handling as OneWireWriteBytes()
+    *                 applies (tri-state unless parasite powered).
+    * parameters:     Value buffer, Counter, bReset (default: false)
+    * Returned value: true if started, false if no timer is set, a transfer
+    *                 is still running or count is 0
+    */
+    bool OneWireStartWrite(const uint8_t *buf, uint16_t count, bool bReset= false);
+
+   /*
+    * Function name:  OneWireStartRead
+    * Descriptions:   Read bytes in the background, driven by the timer
+    *                 interrupt. Poll OneWireAsyncDone() for the end of the
+    *                 transfer; buf is filled from the interrupt handler and
+    *                 must stay valid until then.
+    * parameters:     bytes buffer, read count
+    * Returned value: true if started, false if no timer is set, a transfer
+    *                 is still running or count is 0
+    */
+    bool OneWireStartRead(uint8_t *buf, uint16_t count);
+
+    /*
+     * Function name: OneWireAsyncDone
+     * Description:   Test for the end of a background transfer
+     * parameters:    none
+     * Returned value: true if no background transfer is running
+     */
+    inline bool OneWireAsyncDone() { return this->_uAsyncState == 0; }
+
+    /*
+     * Function name: OneWireAsyncPresence
+     * Description:   Result of the reset cycle of the last background write
+     *                that was started with bReset
+     * parameters:    none
+     * Returned value: true if a device responded with a presence pulse
+     */
+    inline bool OneWireAsyncPresence() { return this->_bAsyncPresence; }
+
+   /*
+    * Function name:  timerInterruptHandler
+    * Descriptions:   The timer interrupt handler of the background engine.
+    *                 Do not call this directly, use the macro
+    *                 ONEWIRE_TIMER_INTERRUPT_HANDLER() instead.
+    * parameters:     none
+    * Returned value: none
+    */
+    void timerInterruptHandler();
+#endif
+
 #if ONEWIRE_SEARCH
    /*
     * Function name:  OneWireResetSearch
@@ -207,16 +418,42 @@ class OneWire
     *                 false --> device not found, end of search
     */
     bool OneWireSearch(uint8_t *newAddr);
+
+   /*
+    * Function name:  OneWireVerify
+    * Descriptions:   Verify that the device with the given ROM is present on
+    *                 the bus, without enumerating the whole bus: the search
+    *                 algorithm is run once with the search state preloaded
+    *                 to the given ROM, so only 64 bit slots are needed per
+    *                 device instead of a full search. The regular search
+    *                 state is preserved.
+    * parameters:     ROM
+    * Returned value: true, if the device answered
+    */
+    bool OneWireVerify(const uint8_t rom[8]);
 #endif
 #if ONEWIRE_CRC
    /*
     * Function name:  OneWireCRC8
-    * Descriptions:   Compute a Dallas Semiconductor 8 bit CRC directly. this is
-    *                 much slower, but much smaller, than a lookup table.
+    * Descriptions:   Compute a Dallas Semiconductor 8 bit CRC over a block.
+    *                 With ONEWIRE_CRC8_TABLE the CRC comes from a 256-entry
+    *                 lookup table in flash (one lookup per byte), otherwise
+    *                 the polynomial is run bit by bit: much slower, but much
+    *                 smaller.
     * parameters:     addr and len
     * Returned value: CRC 8
     */
     static uint8_t OneWireCRC8(const uint8_t *addr, uint8_t len);
+
+   /*
+    * Function name:  OneWireCheckCRC8
+    * Descriptions:   Validate a received block (e.g. a ROM or a scratchpad)
+    *                 whose last byte is the 8 bit CRC of the bytes before it.
+    * parameters:     [in] input - Array of bytes to check, CRC in the last byte.
+    *                 [in] len - Length of the block including the CRC byte.
+    * Returned value: true, if the CRC matches.
+    */
+    static bool OneWireCheckCRC8(const uint8_t* input, uint8_t len);
 #if ONEWIRE_CRC16
 
    /*
@@ -252,4 +489,22 @@ class OneWire
 #endif
 };
 
+#if ONEWIRE_ASYNC
+/*
+ * Create an interrupt handler for the timer of a OneWire object. This macro
+ * must be used once for every OneWire object that uses the timer driven
+ * engine, e.g. with the timer timer16_0:
+ *
+ * OneWire ow;
+ * ow.OneWireInit(PIO1_8);
+ * ow.OneWireSetTimer(timer16_0);
+ * ONEWIRE_TIMER_INTERRUPT_HANDLER(TIMER16_0_IRQHandler, ow)
+ *
+ * @param handler - the name of the interrupt handler, e.g. TIMER16_0_IRQHandler
+ * @param onewireObj - the OneWire object that the timer is assigned to
+ */
+#define ONEWIRE_TIMER_INTERRUPT_HANDLER(handler, onewireObj) \
+    extern "C" void handler() { onewireObj.timerInterruptHandler(); }
+#endif
+
 #endif /* 1wire_h */
@@ -24,6 +24,7 @@ extern LPC_GPIO_TypeDef (* const gpioPorts[4]);
  */
 typedef LPC_SSPx_Type LPC_SSP_TypeDef;
 typedef LPC_CTxxBx_Type LPC_TMR_TypeDef;
+typedef LPC_USART_Type LPC_UART_TypeDef;
 #define LPC_UART LPC_USART
 #define LPC_TMR16B0 LPC_CT16B0
 #define LPC_TMR16B1 LPC_CT16B1
@@ -34,6 +35,19 @@ typedef LPC_CTxxBx_Type LPC_TMR_TypeDef;
 #endif
 #include <core_cm0.h>
 
+/**
+ * Place a function in SRAM instead of flash. Use this for time critical
+ * interrupt handlers: on LPC11xx parts running at 48 MHz the flash wait
+ * states add cycles to every instruction fetch, which RAM execution avoids.
+ * The section is part of the .data image and is copied to RAM by the
+ * startup code.
+ */
+#if defined(__arm__)
+#define SBLIB_RAM_FUNC __attribute__ ((noinline, section(".data.ramfunc")))
+#else
+#define SBLIB_RAM_FUNC
+#endif
+
 /**
  * Get a pointer to a low level IO configuration register.
  *
@@ -54,7 +68,7 @@ unsigned int* ioconPointer(int port, int pinNum);
 
 #ifdef IAP_EMULATION
   extern unsigned char FLASH[];
-  #define LPC _Flash_Base *FLASH
+  #define LPC_FLASH_BASE ((unsigned long) FLASH)
 #else
   #if not defined LPC_FLASH_BASE
     #define LPC_FLASH_BASE 0
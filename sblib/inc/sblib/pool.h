@@ -0,0 +1,145 @@
+/*
+ *  pool.h - Fixed-size object pools.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_pool_h
+#define sblib_pool_h
+
+#include <sblib/types.h>
+
+#include <new>
+
+/**
+ * A fixed-size pool of objects of one type. The pool storage is a plain
+ * member array, so it can be placed statically and every RAM byte is
+ * accounted at link time. Allocation and release are O(1): released
+ * slots are kept in an intrusive free list through the unused storage.
+ *
+ * Unlike the heap, a pool cannot fragment and allocation cost does not
+ * depend on the allocation history - what long running devices on the
+ * 4-8 KB RAM parts need.
+ *
+ * Example:
+ *
+ * static ObjectPool<OneWire, 2> oneWirePool;
+ * ...
+ * OneWire* ow = oneWirePool.create();  // 0 if the pool is exhausted
+ * ...
+ * oneWirePool.destroy(ow);
+ */
+template<class T, int poolSize>
+class ObjectPool
+{
+public:
+    ObjectPool()
+    : freeList(0)
+    , used(0)
+    , liveCount(0)
+    , maxLive(0)
+    {
+    }
+
+    /**
+     * Allocate an object slot from the pool, without constructing an
+     * object in it.
+     *
+     * @return The slot, 0 if the pool is exhausted.
+     */
+    void* allocate()
+    {
+        void* place = 0;
+
+        if (freeList)
+        {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            place = slot->data;
+        }
+        else if (used < poolSize)
+            place = slots[used++].data;
+
+        if (place && ++liveCount > maxLive)
+            maxLive = liveCount;
+
+        return place;
+    }
+
+    /**
+     * Release an object slot back to the pool. The slot must have been
+     * returned by allocate() of the same pool.
+     *
+     * @param ptr - the slot to release.
+     */
+    void release(void* ptr)
+    {
+        Slot* slot = (Slot*) ptr;
+        slot->next = freeList;
+        freeList = slot;
+        --liveCount;
+    }
+
+    /**
+     * @return The number of objects currently allocated from the pool.
+     */
+    int inUse() const
+    {
+        return liveCount;
+    }
+
+    /**
+     * @return The highest number of objects that were allocated at the
+     * same time - the measured pool size requirement.
+     */
+    int maxInUse() const
+    {
+        return maxLive;
+    }
+
+    /**
+     * Create a default-constructed object in a slot of the pool.
+     *
+     * @return The object, 0 if the pool is exhausted.
+     */
+    T* create()
+    {
+        void* place = allocate();
+        return place ? new (place) T() : 0;
+    }
+
+    /**
+     * Destruct an object that was created with create() and release
+     * its slot.
+     *
+     * @param obj - the object to destroy, 0 is allowed and ignored.
+     */
+    void destroy(T* obj)
+    {
+        if (!obj)
+            return;
+
+        obj->~T();
+        release(obj);
+    }
+
+protected:
+    /** A pool slot: object storage, or a free list link while unused */
+    union Slot
+    {
+        Slot* next;               //!< The next slot of the free list
+        unsigned long long align; //!< Forces the strictest alignment
+        byte data[sizeof(T)];     //!< The object storage
+    };
+
+    Slot slots[poolSize];  //!< The pool storage
+    Slot* freeList;        //!< The released slots
+    short used;            //!< The slots handed out while the pool fills
+    short liveCount;       //!< The currently allocated objects
+    short maxLive;         //!< The high water mark of liveCount
+};
+
+#endif /*sblib_pool_h*/
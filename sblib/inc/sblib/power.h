@@ -0,0 +1,59 @@
+/*
+ *  power.h - Power management: deep-sleep with pin wakeup.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_power_h
+#define sblib_power_h
+
+/**
+ * The edge of a wakeup pin that wakes the processor from deep-sleep,
+ * see deepSleep().
+ */
+enum WakeupEdge
+{
+    /**
+     * Wake on a falling edge. This is the edge of the start bit of a
+     * telegram on the bus receive signal.
+     */
+    WAKEUP_EDGE_FALLING = 0,
+
+    /**
+     * Wake on a rising edge.
+     */
+    WAKEUP_EDGE_RISING = 1
+};
+
+/**
+ * Put the processor into deep-sleep until an edge on the wakeup pin occurs.
+ * In deep-sleep all clocks and peripherals are stopped and only the wakeup
+ * start logic is alive; the device draws some 10 uA instead of milliamperes.
+ *
+ * The start logic exists for the pins PIO0_0 ... PIO0_11 and PIO1_0 only.
+ * To sleep between bus telegrams, the bus receive signal must (also) be
+ * wired to one of these pins. The system time stands still while sleeping,
+ * and the bus must be re-initialized after the wakeup:
+ *
+ *     if (bus.idle())
+ *     {
+ *         deepSleep(PIO0_3, WAKEUP_EDGE_FALLING);
+ *         bus.begin();    // restore the bus timing
+ *     }
+ *
+ * The analog blocks that are powered when entering deep-sleep are powered
+ * again after the wakeup, and the interrupt handler of the wakeup is
+ * provided by the library.
+ *
+ * @param wakeupPin - the pin whose edge wakes the processor:
+ *                    PIO0_0 ... PIO0_11 or PIO1_0.
+ * @param edge - the edge to wake on: WAKEUP_EDGE_FALLING or
+ *               WAKEUP_EDGE_RISING.
+ * @return True after the wakeup, false if the pin has no start logic.
+ */
+bool deepSleep(int wakeupPin, WakeupEdge edge);
+
+#endif /*sblib_power_h*/
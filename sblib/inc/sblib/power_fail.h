@@ -0,0 +1,99 @@
+/*
+ *  power_fail.h - Fast state save when the bus power fails.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_power_fail_h
+#define sblib_power_fail_h
+
+#include <sblib/types.h>
+
+/**
+ * Devices like actuators must remember their state - positions, com-object
+ * values - across a bus power loss, but writing flash during normal
+ * operation wears it out. The power fail save keeps one reserved flash
+ * page pre-erased and a preformatted record staged in RAM; when the
+ * brown-out detector fires, the registered memory regions are copied into
+ * the record and the page is programmed with a single minimal-latency
+ * flash write (iapProgramFast()), inside the decaying supply window.
+ *
+ * Example:
+ *
+ *     void setup()
+ *     {
+ *         powerFailBegin((byte*) 0x6f00);      // the reserved page
+ *         powerFailRegister(&position, sizeof(position));
+ *
+ *         if (powerFailSaved())                // state from a power fail?
+ *             powerFailRestore();
+ *         powerFailArm();                      // erase the page, enable BOD
+ *     }
+ *
+ * The regions must be registered in the same order before restoring as
+ * before saving. powerFailArm() is called after the restore; the erase of
+ * the reserved page happens there, during normal operation, so nothing
+ * but the program call is left to do when the power actually fails.
+ */
+
+/** The magic word of a power fail record: "SBPF". */
+#define POWER_FAIL_MAGIC 0x46504253
+
+/**
+ * Set the reserved flash page of the power fail save and clear the list
+ * of registered regions. The page must not be used for anything else.
+ *
+ * @param pageAddress - the page aligned address of the reserved page.
+ */
+void powerFailBegin(byte* pageAddress);
+
+/**
+ * Register a memory region to be saved on power fail and restored by
+ * powerFailRestore(). The regions of all calls must fit into one flash
+ * page together with the record header.
+ *
+ * @param data - the start of the region.
+ * @param size - the size of the region in bytes.
+ * @return True if the region was registered, false if it does not fit.
+ */
+bool powerFailRegister(void* data, unsigned int size);
+
+/**
+ * Test if the reserved page holds a valid record from a power fail:
+ * magic and checksum match and the record covers the registered regions.
+ *
+ * @return True if a valid record is present.
+ */
+bool powerFailSaved();
+
+/**
+ * Copy the saved record back into the registered regions.
+ *
+ * @return True if the record was restored, see powerFailSaved().
+ */
+bool powerFailRestore();
+
+/**
+ * Arm the power fail save: erase the reserved page if it is not blank
+ * and enable the brown-out detect interrupt. Call after the restore.
+ *
+ * @return True if the page is erased and the save is armed.
+ */
+bool powerFailArm();
+
+/**
+ * Disarm the power fail save and disable the brown-out detect interrupt.
+ */
+void powerFailDisarm();
+
+/**
+ * The fast save: copy the registered regions into the staged record and
+ * program the reserved page with one flash write. Called from the
+ * brown-out interrupt handler; saves only once per powerFailArm().
+ */
+void powerFailSave();
+
+#endif /*sblib_power_fail_h*/
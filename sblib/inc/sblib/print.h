@@ -30,6 +30,62 @@ enum Base
     BIN = 2
 };
 
+/**
+ * The size of the stack buffer that printAll() collects its output in.
+ * Longer output is truncated.
+ */
+#ifndef PRINT_ALL_BUFFER_SIZE
+#define PRINT_ALL_BUFFER_SIZE 80
+#endif
+
+/**
+ * A number wrapped with its output base and digit count, for printAll().
+ * Use the fmtHex(), fmtBin(), fmtNum() functions to create it.
+ */
+struct PrintFmt
+{
+    unsigned int value; //!< the number to print
+    byte base;          //!< the base to print in
+    short digits;       //!< the minimum number of digits, -1 for no minimum
+};
+
+/**
+ * Wrap a number to print it hexadecimal with printAll().
+ *
+ * @param value - the number to print.
+ * @param digits - the minimum number of digits, -1 for no minimum.
+ */
+inline PrintFmt fmtHex(unsigned int value, int digits = -1)
+{
+    PrintFmt fmt = { value, HEX, (short) digits };
+    return fmt;
+}
+
+/**
+ * Wrap a number to print it binary with printAll().
+ *
+ * @param value - the number to print.
+ * @param digits - the minimum number of digits, -1 for no minimum.
+ */
+inline PrintFmt fmtBin(unsigned int value, int digits = -1)
+{
+    PrintFmt fmt = { value, BIN, (short) digits };
+    return fmt;
+}
+
+/**
+ * Wrap a number to print it in an arbitrary base with printAll().
+ *
+ * @param value - the number to print.
+ * @param base - the base to print in, e.g. DEC.
+ * @param digits - the minimum number of digits, -1 for no minimum.
+ */
+inline PrintFmt fmtNum(unsigned int value, Base base, int digits = -1)
+{
+    PrintFmt fmt = { value, (byte) base, (short) digits };
+    return fmt;
+}
+
 /**
  * Base class that provides print() and println().
  */
@@ -115,6 +171,68 @@ public:
      */
     int println(unsigned int value, Base base = DEC, int digits = -1);
 
+    /**
+     * Print a fixed point number: the scaled integer value with a decimal
+     * point inserted before the last decimals digits. A DPT9 temperature
+     * from objectReadFloat() is 1/100 fixed point, so printFixed(2150, 2)
+     * prints "21.50" - straight from the scaled integer, without the float
+     * conversion and the soft-float division per digit that
+     * print((float) value / 100) would cost.
+     *
+     * @param value - the scaled integer to print, e.g. 2150 for 21.50
+     * @param decimals - the number of decimal places, 0 for none
+     *
+     * @return The number of bytes that were written.
+     */
+    int printFixed(int value, int decimals);
+
+    /**
+     * Print a fixed point number followed by a new line, see printFixed().
+     *
+     * @param value - the scaled integer to print, e.g. 2150 for 21.50
+     * @param decimals - the number of decimal places, 0 for none
+     *
+     * @return The number of bytes that were written.
+     */
+    int printlnFixed(int value, int decimals);
+
+    /**
+     * Print several values with a single coalesced write. The formatting of
+     * every argument is resolved at compile time by its type: C strings and
+     * characters are copied, integers are printed in decimal, and numbers
+     * wrapped with fmtHex()/fmtBin()/fmtNum() are printed in that base. The
+     * whole line is collected in a stack buffer and written with one
+     * write() call instead of one virtual call per value, e.g.:
+     *
+     *     serial.printAll("temp ", objno, ": ", fmtHex(value, 4));
+     *
+     * Output beyond PRINT_ALL_BUFFER_SIZE bytes is truncated.
+     *
+     * @param args - the values to print.
+     * @return The number of bytes that were written.
+     */
+    template<typename... Args>
+    int printAll(const Args&... args)
+    {
+        byte buf[PRINT_ALL_BUFFER_SIZE];
+        Collector out = { buf, buf + PRINT_ALL_BUFFER_SIZE };
+
+        appendAll(out, args...);
+        return write(buf, out.pos - buf);
+    }
+
+    /**
+     * Like printAll(), with a carriage return and newline appended.
+     *
+     * @param args - the values to print.
+     * @return The number of bytes that were written.
+     */
+    template<typename... Args>
+    int printlnAll(const Args&... args)
+    {
+        return printAll(args..., "\r\n");
+    }
+
     /**
      * Write a zero terminated string.
      *
@@ -144,6 +262,38 @@ public:
 
 private:
     int printNumber(unsigned int value, Base base);
+
+    /**
+     * Collects the output of printAll() in a stack buffer. Output beyond
+     * the buffer end is dropped.
+     */
+    struct Collector
+    {
+        byte* pos;  //!< the next free byte of the buffer
+        byte* end;  //!< the end of the buffer
+
+        void append(char ch)
+        {
+            if (pos < end)
+                *pos++ = ch;
+        }
+
+        void append(const char* str);
+        void append(int value);
+        void append(unsigned int value);
+        void append(const PrintFmt& fmt);
+    };
+
+    static void appendAll(Collector&)
+    {
+    }
+
+    template<typename T, typename... Args>
+    static void appendAll(Collector& out, const T& first, const Args&... rest)
+    {
+        out.append(first);
+        appendAll(out, rest...);
+    }
 };
 
 
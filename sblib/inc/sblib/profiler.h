@@ -0,0 +1,133 @@
+/*
+ *  profiler.h - Compile-out timing of main loop sections.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_profiler_h
+#define sblib_profiler_h
+
+/**
+ * Timing of main loop sections with the microsecond clock: where does a
+ * sluggish loop pass spend its time? Each section accumulates count,
+ * min, max and total duration, and a section can get a time budget - a
+ * pass over budget counts as overrun, is recorded as the last overrun
+ * and reported to an optional handler.
+ *
+ * Everything compiles to nothing unless the global define SB_PROFILE is
+ * set, so release builds stay clean. The library's main times the BCU
+ * loop, the housekeeping tick and the application loop; the PROF_APP
+ * sections are free for finer application timing:
+ *
+ *     PROFILE_BEGIN(PROF_APP1);
+ *     updateDisplay();
+ *     PROFILE_END(PROF_APP1);
+ */
+
+/**
+ * The profiled sections. The library's own sections come first, the
+ * PROF_APP sections are free for the application.
+ */
+enum ProfileSection
+{
+    PROF_BCU_LOOP,       //!< The BCU loop: bus telegram processing
+    PROF_TICK,           //!< The housekeeping tick, see tick.h
+    PROF_APP_LOOP,       //!< The application's loop()
+    PROF_APP1,           //!< Free for the application
+    PROF_APP2,           //!< Free for the application
+    PROF_APP3,           //!< Free for the application
+    PROF_APP4,           //!< Free for the application
+
+    PROF_SECTION_COUNT   //!< The number of profiled sections
+};
+
+#ifdef SB_PROFILE
+#define PROFILE_BEGIN(section)  profileBegin(section)
+#define PROFILE_END(section)    profileEnd(section)
+#else
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+#endif
+
+#ifdef SB_PROFILE
+
+/**
+ * The accumulated timing of one section, see profileStats().
+ */
+struct ProfileStats
+{
+    unsigned int count;        //!< The number of timed passes
+    unsigned int min;          //!< The shortest pass in usec
+    unsigned int max;          //!< The longest pass in usec
+    unsigned long long total;  //!< The total time of all passes in usec
+    unsigned int overruns;     //!< The number of passes over the budget
+
+    /** @return The average pass duration in usec, 0 without passes */
+    unsigned int average() const
+    {
+        return count ? (unsigned int) (total / count) : 0;
+    }
+};
+
+/** A handler that is called when a section overruns its budget.
+ * @param  section   The section that overran, see ProfileSection
+ * @param  usec      The duration of the pass in usec
+ */
+typedef void (*ProfileOverrunHandler)(int section, unsigned int usec);
+
+/**
+ * Start timing a pass of a section.
+ *
+ * @param section - the section, see ProfileSection.
+ */
+void profileBegin(int section);
+
+/**
+ * End timing a pass of a section and accumulate its duration. A pass
+ * over the section's budget is counted and reported as overrun.
+ *
+ * @param section - the section, see ProfileSection.
+ */
+void profileEnd(int section);
+
+/**
+ * Set the time budget of a section.
+ *
+ * @param section - the section, see ProfileSection.
+ * @param usec - the budget in usec, 0 disables overrun detection.
+ */
+void profileBudget(int section, unsigned int usec);
+
+/**
+ * Set the handler that is called when a section overruns its budget.
+ *
+ * @param handler - the handler, 0 for none.
+ */
+void profileOverrunHandler(ProfileOverrunHandler handler);
+
+/**
+ * Get the accumulated timing of a section.
+ *
+ * @param section - the section, see ProfileSection.
+ * @return The timing statistics of the section.
+ */
+const ProfileStats& profileStats(int section);
+
+/**
+ * The section that blew its budget most recently.
+ *
+ * @return The section of the last overrun, -1 when none occurred.
+ */
+int profileLastOverrun();
+
+/**
+ * Reset all statistics and the last overrun.
+ */
+void profileClear();
+
+#endif /*SB_PROFILE*/
+
+#endif /*sblib_profiler_h*/
@@ -0,0 +1,118 @@
+/*
+ *  pwm.h - Multi channel buffered PWM on a 16/32 bit timer.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_pwm_h
+#define sblib_pwm_h
+
+#include <sblib/timer.h>
+
+/**
+ * A multi channel PWM engine on one of the 16/32 bit timers. One match
+ * channel of the timer generates the PWM period, the other match channels
+ * are available as PWM outputs.
+ *
+ * Duty cycle updates are double buffered: they are written to the match
+ * registers from the period interrupt, at the period boundary, so a
+ * running period is never distorted - unlike poking the match registers
+ * directly, which glitches when the write falls into the running period.
+ *
+ * Example, three LED channels with 1 kHz PWM on the 16 bit timer #0:
+ *
+ *     Pwm pwm(timer16_0);
+ *     PWM_INTERRUPT_HANDLER(TIMER16_0_IRQHandler, pwm);
+ *
+ *     pwm.begin(1000, SystemCoreClock / 1000000 - 1);  // 1 usec ticks
+ *     pwm.addChannel(MAT0, PIO0_8);
+ *     pwm.addChannel(MAT1, PIO0_9);
+ *     pwm.addChannel(MAT2, PIO0_10);
+ *
+ *     pwm.dim(MAT0, 128);  // half brightness, dimming curve applied
+ */
+class Pwm
+{
+public:
+    /**
+     * Create a PWM engine on a timer.
+     *
+     * @param aTimer - the timer to use: timer16_0, timer32_1, ...
+     * @param aPeriodChannel - the match channel that generates the PWM
+     *                         period: MAT0, MAT1, MAT2, MAT3.
+     */
+    Pwm(Timer& aTimer, TimerMatch aPeriodChannel = MAT3);
+
+    /**
+     * Begin generating the PWM. All outputs start with duty cycle 0.
+     *
+     * @param aPeriod - the PWM period in timer ticks. Must fit into
+     *                  16 bit for the 16 bit timers.
+     * @param prescaler - the prescaler division factor for the timer,
+     *                    see Timer::prescaler().
+     */
+    void begin(unsigned int aPeriod, unsigned int prescaler = 0);
+
+    /**
+     * End generating the PWM and stop the timer.
+     */
+    void end();
+
+    /**
+     * Add a PWM output on a match channel of the timer. The pin is
+     * configured as match output of the channel.
+     *
+     * @param channel - the match channel: any channel of the timer except
+     *                  the period channel.
+     * @param pin - the pin of the channel's match output.
+     */
+    void addChannel(TimerMatch channel, int pin);
+
+    /**
+     * Set the duty cycle of a channel. The value is buffered and latched
+     * at the next period boundary.
+     *
+     * @param channel - the match channel of the output.
+     * @param ticks - the high time in timer ticks: 0 for permanently off
+     *                up to the period for permanently on.
+     */
+    void dutyCycle(TimerMatch channel, unsigned int ticks);
+
+    /**
+     * Set the brightness of a channel. The logarithmic dimming curve maps
+     * the brightness to the duty cycle so that equal brightness steps
+     * appear as equal steps to the eye.
+     *
+     * @param channel - the match channel of the output.
+     * @param brightness - the brightness: 0 for off, 255 for fully on.
+     */
+    void dim(TimerMatch channel, int brightness);
+
+    /**
+     * Handle the period interrupt of the timer: latch the buffered duty
+     * cycles into the match registers. Must be called from the timer's
+     * interrupt handler, see PWM_INTERRUPT_HANDLER.
+     */
+    void interruptHandler();
+
+private:
+    Timer& timer;              //!< The timer that generates the PWM
+    TimerMatch periodChannel;  //!< The match channel that generates the period
+    unsigned int period;       //!< The PWM period in timer ticks
+    volatile unsigned int pending[4]; //!< Match values to latch, ~0 if unchanged
+};
+
+/**
+ * Create an interrupt handler for a PWM engine. This macro must be used
+ * once for every Pwm object that is created.
+ *
+ * @param handler - the name of the interrupt handler, e.g. TIMER16_0_IRQHandler
+ * @param pwmObj - the PWM object of the timer, e.g. pwm
+ */
+#define PWM_INTERRUPT_HANDLER(handler, pwmObj) \
+    extern "C" void handler() { pwmObj.interruptHandler(); }
+
+#endif /*sblib_pwm_h*/
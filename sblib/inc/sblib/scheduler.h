@@ -0,0 +1,115 @@
+/*
+ *  scheduler.h - Cooperative task scheduler for the main loop.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_scheduler_h
+#define sblib_scheduler_h
+
+/** A task function of the scheduler */
+typedef void (*SchedulerTask)();
+
+/**
+ * The maximum number of tasks of a Scheduler. Can be overridden with a
+ * global define.
+ */
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+class Scheduler
+/**
+ * A cooperative scheduler with a static task table. The tasks are plain
+ * functions that run to completion; each one shall do a bounded slice of
+ * work and return, like loop() itself.
+ *
+ * runNext() runs at most one task per call. Calling it from loop() lets
+ * the library's main interleave bcu.loop() between any two tasks, so
+ * telegram processing is never delayed by more than the longest single
+ * task - instead of by the sum of all the work of one monolithic loop().
+ *
+ * A task has a period hint in milliseconds: it becomes due that often,
+ * and when several tasks are due the most overdue one runs first. A
+ * period of 0 marks a background task that runs round-robin whenever no
+ * periodic task is due. The worst observed duration of every task is
+ * recorded, see maxDuration().
+ *
+ * Example:
+ *
+ *     Scheduler sched;
+ *
+ *     void setup()
+ *     {
+ *         bcu.begin(...);
+ *         sched.add(readSensors, 100);   // every 100 ms
+ *         sched.add(flushDisplay, 50);   // every 50 ms
+ *         sched.add(pollSerial, 0);      // background
+ *     }
+ *
+ *     void loop()
+ *     {
+ *         sched.runNext();
+ *     }
+ */
+{
+public:
+    Scheduler();
+
+    /**
+     * Add a task to the task table. It is a programming error to add
+     * more than SCHEDULER_MAX_TASKS tasks, see fatalError().
+     *
+     * @param task - the task function.
+     * @param period - the period hint in milliseconds, 0 for a
+     *                 background task.
+     * @param offset - an extra delay in milliseconds before the task is
+     *                 due for the first time, after its first period.
+     *                 Use different offsets to stagger tasks that have
+     *                 the same period.
+     */
+    void add(SchedulerTask task, unsigned int period, unsigned int offset = 0);
+
+    /**
+     * Run the most overdue periodic task, or the next background task
+     * when no periodic task is due. At most one task runs per call.
+     *
+     * @return True if a periodic task ran, false otherwise.
+     */
+    bool runNext();
+
+    /**
+     * Get the worst observed duration of a task, for finding the task
+     * that overruns its slice.
+     *
+     * @param task - the task function that was passed to add().
+     * @return The longest single run of the task in milliseconds, 0 if
+     *         the task never ran or is unknown.
+     */
+    unsigned int maxDuration(SchedulerTask task) const;
+
+private:
+    struct Entry
+    {
+        SchedulerTask task;        //!< the task function
+        unsigned int period;       //!< the period in msec, 0 = background
+        unsigned int nextRun;      //!< the system time the task is due
+        unsigned int maxDuration;  //!< the longest single run in msec
+    };
+
+    /**
+     * Run the entry's task, record its duration and re-arm its deadline.
+     *
+     * @param entry - the table entry to run.
+     */
+    void run(Entry& entry);
+
+    Entry table[SCHEDULER_MAX_TASKS];
+    short count;          //!< the number of tasks in the table
+    short backgroundIdx;  //!< the round-robin position of the background tasks
+};
+
+#endif /*sblib_scheduler_h*/
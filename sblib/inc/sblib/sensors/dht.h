@@ -11,6 +11,12 @@
 #ifndef dht_h
 #define dht_h
 
+#include <sblib/timer.h>
+
+#define DHT_CAPTURE_EDGES     44  // Capacity of the edge timestamp ring (start response + 40 bits + spare)
+#define DHT_CAPTURE_MIN_EDGES 42  // Falling edges of a complete response: start response + 41 bit edges
+#define DHT_BIT_THRESHOLD    100  // Edge distance in us above which a bit is a '1' (50us low + 26/70us high)
+
 /****************************************************************************
  *  Works with DHT11, DHT22
  *      SEN11301P,  Grove - Temperature & Humidity Sensor    (Seeed Studio)
@@ -64,10 +70,93 @@ public:
   float ConvertTemperature(eScale Scale);
   float CalcdewPointFast(float celsius, float humidity);
   //float CalcdewPoint(float celsius, float humidity);
+
+ /*
+  * Function name:  DHTSetTimer
+  * Descriptions:   Assign a timer capture channel to the sensor. The data
+  *                 pin must be a capture input of that timer (e.g. PIO1_8
+  *                 for CAP0 of timer16_1, see INPUT_CAPTURE in
+  *                 digital_pin.h). Connect the timer interrupt with the
+  *                 DHT_TIMER_INTERRUPT_HANDLER() macro. Once set,
+  *                 startAcquisition() / pollAcquisition() read the sensor
+  *                 with edge timestamps captured in the interrupt handler
+  *                 instead of busy-waiting with interrupts disabled.
+  * parameters:     timer (e.g. timer16_1), captureChannel (CAP0, CAP1)
+  * Returned value: none
+  */
+  void DHTSetTimer(Timer& timer, int captureChannel);
+
+ /*
+  * Function name:  startAcquisition
+  * Descriptions:   Start a sensor reading in the background: the start
+  *                 signal and the response capture are sequenced by
+  *                 pollAcquisition(), call it from the main loop until it
+  *                 returns true. Requires DHTSetTimer().
+  * parameters:     bForceRead, to ignore the internal DHT TIMER
+  * Returned value: true if started. false on error,
+  *                 check _lastError for reason.
+  */
+  bool startAcquisition(bool bForceRead =false );
+
+ /*
+  * Function name:  pollAcquisition
+  * Descriptions:   Drive a reading started with startAcquisition(). Ends
+  *                 the start signal after its 20ms low time, arms the
+  *                 capture and decodes the edge timestamps when the
+  *                 response is complete.
+  * parameters:     none
+  * Returned value: true when a new reading is available. Check:
+  *                 _lastHumidity and _lastTemperature
+  */
+  bool pollAcquisition();
+
+  /*
+   * Function name: acquisitionDone
+   * Description:   Test for the end of a background reading
+   * parameters:    none
+   * Returned value: true if no background reading is running
+   */
+  inline bool acquisitionDone() { return this->_acqState == 0; }
+
+ /*
+  * Function name:  timerInterruptHandler
+  * Descriptions:   The timer interrupt handler of the capture engine. Do
+  *                 not call this directly, use the macro
+  *                 DHT_TIMER_INTERRUPT_HANDLER() instead.
+  * parameters:     none
+  * Returned value: none
+  */
+  void timerInterruptHandler();
+
 private:
   int  _pin, _lastReadTime;
   uint32_t _maxcycles;
   uint32_t expectPulse(bool level);
+  bool convertData();
+  bool decodeCapture();
+
+  Timer* _timer;                       // The capture timer, 0 if unset
+  int _captureChannel;                 // The capture channel of the data pin
+  uint8_t _acqState;                   // State of the background reading
+  unsigned int _acqStart;              // millis() of the last state change
+  volatile uint8_t _capCount;          // number of captured edges
+  volatile uint16_t _capTimes[DHT_CAPTURE_EDGES]; // timestamps of the falling edges in us
 };
 
+/*
+ * Create an interrupt handler for the capture timer of a DHT object. This
+ * macro must be used once for every DHT object that uses the capture engine,
+ * e.g. with the timer timer16_1:
+ *
+ * DHT dht;
+ * dht.DHTInit(PIO1_8, DHT22);
+ * dht.DHTSetTimer(timer16_1, CAP0);
+ * DHT_TIMER_INTERRUPT_HANDLER(TIMER16_1_IRQHandler, dht)
+ *
+ * @param handler - the name of the interrupt handler, e.g. TIMER16_1_IRQHandler
+ * @param dhtObj - the DHT object that the timer is assigned to
+ */
+#define DHT_TIMER_INTERRUPT_HANDLER(handler, dhtObj) \
+    extern "C" void handler() { dhtObj.timerInterruptHandler(); }
+
 #endif /* dht_h */
@@ -16,10 +16,18 @@
 #include <sblib/onewire.h>
 #endif
 
+#include <sblib/timer.h>    // for millis() in conversionReady()
+
 #ifndef MAX_DS_DEVICES
 #define MAX_DS_DEVICES 10
 #endif
 
+// Maximal count of DS18x20 bus instances. The OneWire objects live in a
+// static pool, so the RAM usage is fixed at compile time.
+#ifndef DS18X20_POOL_SIZE
+#define DS18X20_POOL_SIZE 2
+#endif
+
 #define DS18X20_SEARCH 1
 
 #if DS18X20_SEARCH
@@ -39,6 +47,7 @@ struct sDS18x20
     eDsType type;             // Device type
 #endif
     uint8_t res_type;         // Resolution type 0 or 1
+    uint8_t resolution;       // Configured resolution in bits (9..12), see SetResolution()
     byte data[12];            // Read data
     byte addr[8];             // Device ROM. 64bit Lasered ROM-Code to detect the Family Code
     bool crcOK;               // Last read crc state
@@ -48,6 +57,12 @@ struct sDS18x20
 };
 
 
+#if DS18X20_SEARCH
+#define DS18X20_CACHE_MAGIC 0xD5  // Marks a valid device list in the MemMapper area
+
+class MemMapper;
+#endif
+
 // Temperature conversions types
 typedef enum {
   CELCIUS   = 0,
@@ -62,6 +77,8 @@ class DS18x20
 {
 private:
   OneWire *_OW_DS18x;
+  unsigned int m_convStart;    // millis() of the last conversion start
+  uint16_t m_convDuration;     // conversion time of the running conversion
 
 public:
   uint8_t m_foundDevices;           // Number of found devices
@@ -77,6 +94,21 @@ public:
   */
   void DS18x20Init(int pin, bool bParasiteMode);
 
+ /*
+  * Function name:  SetStrongPullup
+  * Descriptions:   Assign a GPIO that switches an external strong pull-up
+  *                 for parasite powered sensors, see
+  *                 OneWire::OneWireSetStrongPullup(). The pull-up is
+  *                 applied during the conversion windows of
+  *                 startConversion() / startConversionAll(), so parasite
+  *                 powered strings convert all sensors in parallel like
+  *                 powered ones. Without a pull-up pin the data pin is
+  *                 driven high push-pull during the conversions.
+  * parameters:     pin, bActiveHigh: the level that switches the pull-up on
+  * Returned value: none
+  */
+  void SetStrongPullup(int pin, bool bActiveHigh= true);
+
  /*
   * Function name:  ds18x20DeInit
   * Descriptions:   DeInitialize the ds18x20
@@ -98,6 +130,44 @@ public:
   */
 #if DS18X20_SEARCH
   bool Search(uint8_t uMaxDeviceSearch= MAX_DS_DEVICES);
+
+ /*
+  * Function name:  SearchCached
+  * Descriptions:   Like Search(), but with a persisted device list: first
+  *                 the ROMs stored in the given MemMapper area are loaded
+  *                 and each device is presence-verified with a single
+  *                 Match-ROM pass (fast). Only when the stored set does not
+  *                 match the bus any more, the full binary ROM search is
+  *                 performed and the new list is persisted.
+  * parameters:     memMapper and the virtual address of the list inside it,
+  *                 uMaxDeviceSearch Maximal count of devices to find.
+  * Returned value: true, if one or more devices are found (see Search())
+  */
+  bool SearchCached(MemMapper& memMapper, int virtAddress,
+                    uint8_t uMaxDeviceSearch= MAX_DS_DEVICES);
+
+ /*
+  * Function name:  LoadDevices
+  * Descriptions:   Load the persisted device list from the given MemMapper
+  *                 area and verify that every stored device is still
+  *                 present on the bus. m_dsDev / m_foundDevices are only
+  *                 filled if the complete list verifies.
+  * parameters:     memMapper and the virtual address of the list inside it
+  * Returned value: true, if the stored list matches the bus
+  */
+  bool LoadDevices(MemMapper& memMapper, int virtAddress);
+
+ /*
+  * Function name:  StoreDevices
+  * Descriptions:   Persist the current device list (m_dsDev) into the given
+  *                 MemMapper area, to be reloaded with LoadDevices(). The
+  *                 list is only written when it differs from the stored one
+  *                 to avoid needless flash wear; doFlash() is left to the
+  *                 caller.
+  * parameters:     memMapper and the virtual address of the list inside it
+  * Returned value: true on success, false on a MemMapper error
+  */
+  bool StoreDevices(MemMapper& memMapper, int virtAddress);
 #endif
 
  /*
@@ -113,10 +183,87 @@ public:
   */
   bool readTemperature( sDS18x20 *sDev);
 
+ /*
+  * Function name:  SetResolution
+  * Descriptions:   Configure the conversion resolution of a DS18B20/DS1822
+  *                 (the DS18S20 has a fixed resolution). Lower resolutions
+  *                 convert faster: 9 bit in 94ms instead of 750ms at
+  *                 12 bit; the conversion waits of this class adapt
+  *                 automatically. With bSave the setting is copied to the
+  *                 sensor EEPROM, otherwise it is lost on its power cycle.
+  * parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+  *                 DS18x20 device.(Is filled automatically by Search() function.)
+  *                 uBits: resolution in bits (9..12)
+  *                 bSave: also save to the sensor EEPROM (default: false)
+  * Returned value: true on success
+  */
+  bool SetResolution(sDS18x20 *sDev, uint8_t uBits, bool bSave= false);
+
+ /*
+  * Function name:  conversionTimeMs
+  * Descriptions:   The worst case conversion time of the given device at
+  *                 its configured resolution.
+  * parameters:     sDS18x20 *sDev
+  * Returned value: the conversion time in milliseconds
+  */
+  uint16_t conversionTimeMs(const sDS18x20 *sDev);
+
+  /*
+   * Function name: conversionReady
+   * Description:   Test if the conversion started with startConversion() /
+   *                startConversionAll() is ready to be read, based on the
+   *                configured resolutions instead of worst-case waiting.
+   * parameters:    none
+   * Returned value: true if the conversion time has elapsed
+   */
+  inline bool conversionReady() { return millis() - m_convStart >= m_convDuration; }
+
+ /*
+  * Function name:  startConversion
+  * Descriptions:   Start a temperature conversion on the given device
+  *                 without waiting for it. Read the result with
+  *                 readScratchpad() when conversionReady(), after the
+  *                 conversion time of the device's resolution.
+  * parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+  *                 DS18x20 device.(Is filled automatically by Search() function.)
+  * Returned value: true, if a device responded to the reset
+  */
+  bool startConversion( sDS18x20 *sDev);
+
+ /*
+  * Function name:  startConversionAll
+  * Descriptions:   Start a temperature conversion on all devices at once
+  *                 with a Skip ROM broadcast. All sensors convert
+  *                 simultaneously, so one acquisition cycle takes a single
+  *                 conversion window (up to 750ms) regardless of the
+  *                 sensor count. In parasite power mode the bus is powered
+  *                 during the window (see SetStrongPullup()), so this also
+  *                 works for parasite powered strings. Read the results
+  *                 with readScratchpad().
+  * parameters:     none
+  * Returned value: true, if a device responded to the reset
+  */
+  bool startConversionAll();
+
+ /*
+  * Function name:  readScratchpad
+  * Descriptions:   Read the scratchpad of the given device and decode the
+  *                 temperature of the last conversion, see
+  *                 startConversion() / startConversionAll().
+  * parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+  *                 DS18x20 device.(Is filled automatically by Search() function.)
+  * Returned value: true, if the read was successful.
+  *                 following global Parameter of sDS18x20 will be filled:
+  *                 last_temperature - the current read temperature
+  *                 lastReadOK       - will be set to true if read was successful
+  */
+  bool readScratchpad( sDS18x20 *sDev);
+
  /*
   * Function name:  readTemperatureAll
-  * Descriptions:   Iterates the the global m_dsDev object and calls
-  *                 readTemperature() for each device.
+  * Descriptions:   Starts the conversion on all found devices at once with
+  *                 startConversionAll(), waits one conversion window and
+  *                 then reads the scratchpad of each device.
   * parameters:    none
   * Returned value: true, if one or more devices reads are successful.
   *                 following global object parameters will be filled:
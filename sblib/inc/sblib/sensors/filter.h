@@ -0,0 +1,150 @@
+/*
+ *  filter.h - Incremental filter primitives for sensor values
+ *
+ *  Copyright (c) 2015 Selfbus
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef sensor_filter_h
+#define sensor_filter_h
+
+/****************************************************************************
+* MovingAverage Class
+*
+* Moving average over the last N samples with an incrementally updated
+* running sum: adding a sample is O(1), no re-summing of the window.
+* The window buffer is supplied by the caller.
+*****************************************************************************/
+class MovingAverage
+{
+public:
+ /*
+  * Function name:  FilterInit
+  * Descriptions:   Initialize the filter with an empty window
+  * parameters:     buffer - window buffer of the caller, size - window size
+  * Returned value: none
+  */
+  void FilterInit(int* buffer, uint8_t size);
+
+ /*
+  * Function name:  Add
+  * Descriptions:   Add a sample to the window, dropping the oldest when
+  *                 the window is full. The running sum is updated
+  *                 incrementally.
+  * parameters:     value - the new sample
+  * Returned value: the average over the current window
+  */
+  int Add(int value);
+
+  /*
+   * Function name: Value
+   * Description:   The average over the current window
+   * parameters:    none
+   * Returned value: the average, 0 if the window is empty
+   */
+  int Value();
+
+private:
+  int* m_buffer;            // the window buffer (ring)
+  uint8_t m_uSize;          // window size
+  uint8_t m_uCount;         // number of samples in the window
+  uint8_t m_uPos;           // ring position of the next sample
+  int m_sum;                // running sum of the window
+};
+
+/****************************************************************************
+* MedianFilter Class
+*
+* Median over the last N samples. Besides the age-ordered ring a sorted
+* copy of the window is maintained by insertion update: per sample one
+* binary search to remove the oldest value and one to insert the new one,
+* instead of re-sorting the window. The two buffers are supplied by the
+* caller.
+*****************************************************************************/
+class MedianFilter
+{
+public:
+ /*
+  * Function name:  FilterInit
+  * Descriptions:   Initialize the filter with an empty window
+  * parameters:     buffer - window ring of the caller,
+  *                 sorted - sorted window buffer of the caller,
+  *                 size - window size (odd sizes give the true median)
+  * Returned value: none
+  */
+  void FilterInit(int* buffer, int* sorted, uint8_t size);
+
+ /*
+  * Function name:  Add
+  * Descriptions:   Add a sample to the window, dropping the oldest when
+  *                 the window is full, and update the sorted copy by
+  *                 insertion.
+  * parameters:     value - the new sample
+  * Returned value: the median of the current window
+  */
+  int Add(int value);
+
+  /*
+   * Function name: Value
+   * Description:   The median of the current window
+   * parameters:    none
+   * Returned value: the median, 0 if the window is empty
+   */
+  int Value();
+
+private:
+  uint8_t findPos(int value, uint8_t count);
+
+  int* m_buffer;            // the window ring in age order
+  int* m_sorted;            // the window in sorted order
+  uint8_t m_uSize;          // window size
+  uint8_t m_uCount;         // number of samples in the window
+  uint8_t m_uPos;           // ring position of the next sample
+};
+
+/****************************************************************************
+* ExpSmooth Class
+*
+* Exponential smoothing in fixed point: out += (in - out) / 2^shift, with
+* the state kept scaled by 2^shift so no precision is lost to rounding.
+* No window buffer and O(1) per sample; larger shift values smooth more.
+*****************************************************************************/
+class ExpSmooth
+{
+public:
+ /*
+  * Function name:  FilterInit
+  * Descriptions:   Initialize the filter. The first sample added
+  *                 initializes the state, so there is no settling ramp
+  *                 from zero.
+  * parameters:     shift - smoothing factor 1/2^shift (1..14)
+  * Returned value: none
+  */
+  void FilterInit(uint8_t shift);
+
+ /*
+  * Function name:  Add
+  * Descriptions:   Add a sample to the filter
+  * parameters:     value - the new sample
+  * Returned value: the smoothed value
+  */
+  int Add(int value);
+
+  /*
+   * Function name: Value
+   * Description:   The current smoothed value
+   * parameters:    none
+   * Returned value: the smoothed value, 0 before the first sample
+   */
+  int Value();
+
+private:
+  int m_state;              // the smoothed value, scaled by 2^shift
+  uint8_t m_uShift;         // smoothing factor 1/2^shift
+  bool m_bPrimed;           // the state was initialized with a sample
+};
+
+#endif /* sensor_filter_h */
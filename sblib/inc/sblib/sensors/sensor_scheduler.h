@@ -0,0 +1,119 @@
+/*
+ *  sensor_scheduler.h - Non-blocking acquisition scheduler for sensors
+ *
+ *  Copyright (c) 2015 Selfbus
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef sensor_scheduler_h
+#define sensor_scheduler_h
+
+#ifndef SENSOR_SCHEDULER_MAX
+#define SENSOR_SCHEDULER_MAX 8         // Maximal number of scheduled sensors
+#endif
+
+// Result of a SensorPollFunc
+enum eSensorPollResult
+{
+  SENSOR_BUSY   =  0,                  // the acquisition is still running
+  SENSOR_DONE   =  1,                  // the acquisition finished, a new value is available
+  SENSOR_FAILED = -1                   // the acquisition finished with an error
+};
+
+/*
+ * Start an acquisition on the device. Return true if the acquisition was
+ * started, false to retry on the next scheduler pass (e.g. the bus or the
+ * device is busy).
+ */
+typedef bool (*SensorStartFunc)(void* device);
+
+/*
+ * Drive the acquisition of the device (poll its state machine). Return
+ * SENSOR_BUSY while it is running, SENSOR_DONE or SENSOR_FAILED when it
+ * ended.
+ */
+typedef int (*SensorPollFunc)(void* device);
+
+/*
+ * Called when the acquisition of the device ended. bSuccess is true when
+ * the poll function returned SENSOR_DONE. May be 0 if not needed.
+ */
+typedef void (*SensorCompleteFunc)(void* device, bool bSuccess);
+
+/****************************************************************************
+* SensorScheduler Class
+*
+* Drives the asynchronous state machines of multiple sensor drivers from
+* the main loop: every sensor is described once by a table entry (device,
+* start / poll functions, completion callback, acquisition interval) and
+* PollSensors() interleaves the acquisitions, so slow conversions (DHT 2s,
+* DS18x20 750ms, BH1750 120ms, ...) overlap instead of serializing and no
+* hand-rolled millis() bookkeeping is needed in loop().
+*****************************************************************************/
+class SensorScheduler
+{
+public:
+ /*
+  * Function name:  SchedulerInit
+  * Descriptions:   Initialize the scheduler (empty sensor table)
+  * parameters:     none
+  * Returned value: none
+  */
+  void SchedulerInit();
+
+ /*
+  * Function name:  AddSensor
+  * Descriptions:   Add a sensor to the schedule. The acquisition is
+  *                 restarted every uIntervalMs milliseconds; uOffsetMs
+  *                 delays the first start to stagger sensors that share
+  *                 a bus.
+  * parameters:     device - opaque pointer, passed to all callbacks
+  *                 start / poll - the driver's async state machine
+  *                 complete - completion callback, may be 0
+  *                 uIntervalMs - time between two acquisition starts
+  *                 uOffsetMs - delay of the first start (default 0)
+  * Returned value: the sensor index, or -1 if the table is full
+  */
+  int AddSensor(void* device, SensorStartFunc start, SensorPollFunc poll,
+                SensorCompleteFunc complete, unsigned int uIntervalMs,
+                unsigned int uOffsetMs= 0);
+
+ /*
+  * Function name:  PollSensors
+  * Descriptions:   Drive the schedule, to be called from the main loop:
+  *                 polls the running acquisitions, fires the completion
+  *                 callbacks and starts sensors whose interval elapsed.
+  * parameters:     none
+  * Returned value: none
+  */
+  void PollSensors();
+
+  /*
+   * Function name: IsRunning
+   * Description:   Test if the acquisition of a sensor is running
+   * parameters:    idx - the sensor index from AddSensor()
+   * Returned value: true if the sensor's acquisition is running
+   */
+  inline bool IsRunning(int idx) { return this->m_sensors[idx].bRunning; }
+
+private:
+  // One entry of the sensor table
+  struct sSensor
+  {
+    void* device;                      // opaque device pointer
+    SensorStartFunc start;
+    SensorPollFunc poll;
+    SensorCompleteFunc complete;       // 0 if not needed
+    unsigned int uIntervalMs;          // time between two acquisition starts
+    unsigned int uNextStart;           // millis() of the next start
+    bool bRunning;                     // an acquisition is running
+  };
+
+  sSensor m_sensors[SENSOR_SCHEDULER_MAX];
+  uint8_t m_uCount;                    // number of used table entries
+};
+
+#endif /* sensor_scheduler_h */
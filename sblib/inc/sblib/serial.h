@@ -12,6 +12,7 @@
 
 #include <sblib/buffered_stream.h>
 #include <sblib/interrupt.h>
+#include <sblib/platform.h>
 
 class Serial;
 
@@ -55,6 +56,25 @@ enum SerialConfig
 
 extern "C" void UART_IRQHandler();
 
+/**
+ * Type of the transmit complete handler, see Serial::onTxComplete().
+ */
+typedef void (*SerialTxHandler)();
+
+/**
+ * The flow control mode of the serial port, see Serial::enableFlowControl().
+ */
+enum SerialFlow
+{
+    FLOW_NONE,     //!< no flow control
+    FLOW_RTS,      //!< RTS on a GPIO pin: low while the RX ring has room
+    FLOW_XON_XOFF  //!< XON / XOFF characters on the data line
+};
+
+// The XON / XOFF flow control characters
+#define SERIAL_XON   0x11
+#define SERIAL_XOFF  0x13
+
 
 /**
  * Serial port access. All ARM processors have a serial port, also known as UART.
@@ -63,13 +83,32 @@ class Serial: public BufferedStream
 {
 public:
     /**
-     * Create a serial port access object.
+     * Create a serial port access object for the default UART.
      *
      * @param rxPin - the pin to use for RXD: PIO1_6, PIO2_7, PIO3_1, or PIO3_4
      * @param txPin - the pin to use for TXD: PIO1_7, PIO2_8, PIO3_0, or PIO3_5
      */
     Serial(int rxPin, int txPin);
 
+    /**
+     * Create a serial port access object for a specific UART, for parts
+     * with more than one USART. Create the interrupt handler for the port
+     * with the SERIAL_INTERRUPT_HANDLER macro, e.g.:
+     *
+     *     Serial serial1(LPC_USART1, USART1_IRQn, PIO1_2, PIO1_3);
+     *     SERIAL_INTERRUPT_HANDLER(USART1_IRQHandler, serial1);
+     *
+     * begin() only enables the peripheral clock of the default UART; for
+     * an additional USART the board support must enable its clock and
+     * clock divider before begin() is called.
+     *
+     * @param port - the UART registers, e.g. LPC_USART1
+     * @param irq - the interrupt number of the UART
+     * @param rxPin - the pin to use for RXD
+     * @param txPin - the pin to use for TXD
+     */
+    Serial(LPC_UART_TypeDef* port, IRQn_Type irq, int rxPin, int txPin);
+
     /**
      * Set rx pin for serial communication.
      *
@@ -121,11 +160,110 @@ public:
      */
     virtual int write(byte ch);
 
+    /**
+     * Write a block of bytes. The block is copied into the write buffer
+     * with at most two memcpy calls instead of a per byte call; when the
+     * transmitter is idle the first bytes go directly into the TX FIFO.
+     * Blocks until all bytes are written or buffered.
+     *
+     * @param data - the bytes to write.
+     * @param count - the number of bytes to write.
+     * @return The number of bytes written.
+     */
+    virtual int write(const byte* data, int count);
+
     /**
      * Wait until all bytes are written.
      */
     virtual void flush();
 
+    /**
+     * Get the number of bytes that wait in the write buffer or in a
+     * background transmit block, see transmitBlock().
+     * A non-blocking alternative to flush(): the caller can
+     * continue working, or sleep with waitForInterrupt(), until the count
+     * reaches zero. The hardware may still be shifting out the last bytes
+     * when zero is returned - use flush() where the line must be silent.
+     *
+     * @return The number of buffered bytes.
+     */
+    int writePending() const;
+
+    /**
+     * Set a handler that is called from the UART interrupt when the write
+     * buffer has drained and the TX FIFO is empty. Keep the handler short,
+     * it runs in interrupt context.
+     *
+     * @param handler - the handler to call, 0 for none.
+     */
+    void onTxComplete(SerialTxHandler handler);
+
+    /**
+     * Transmit a block of bytes in the background, directly from the
+     * caller's buffer without copying it into the write buffer. The THRE
+     * interrupt feeds the TX FIFO until the block is done, so the main
+     * loop does not shovel the bytes - the counterpart of the interrupt
+     * driven SPI::transferBlock(). The buffer must stay valid until the
+     * transfer has finished; poll writePending() or use onTxComplete() to
+     * learn when it has. Buffered write() output that is already pending
+     * is sent first.
+     *
+     * @param data - the bytes to transmit.
+     * @param count - the number of bytes to transmit.
+     * @return True if the transfer was started, false if a previous block
+     *         transfer is still running.
+     */
+    bool transmitBlock(const byte* data, int count);
+
+    /**
+     * Enable RS-485 half duplex direction control. The UART asserts the
+     * driver enable pin in hardware with the start bit of the first byte
+     * and releases it a configurable number of bit times after the last
+     * stop bit has left the shift register - no application timing, no
+     * truncated frames and no padding delays between back-to-back frames.
+     *
+     * The pin must be the RTS pin of the port (PIO1_5 or PIO0_17 for the
+     * default UART). Call after begin(); end() leaves the control enabled
+     * for the next begin().
+     *
+     * @param dePin - the driver enable pin, active high.
+     * @param turnaround - bit times between the end of the last stop bit
+     *                     and the release of the pin (0..255).
+     */
+    void enableDirectionControl(int dePin, int turnaround = 0);
+
+    /**
+     * Disable the RS-485 direction control again.
+     */
+    void disableDirectionControl();
+
+    /**
+     * Enable RTS flow control on a GPIO pin. The pin is driven low while
+     * the RX ring buffer has room. When the ring fills to the high
+     * watermark the RX interrupt raises the pin, telling the peer to
+     * pause; read() drops it again when the ring has drained to the low
+     * watermark. A peer that bursts faster than loop() reads then
+     * self-paces at ring capacity instead of overflowing the ring and
+     * retransmitting whole frames.
+     *
+     * @param aRtsPin - the pin to drive, any GPIO pin.
+     */
+    void enableFlowControl(int aRtsPin);
+
+    /**
+     * Enable XON / XOFF software flow control: like the RTS flow control,
+     * but an XOFF character is sent on the data line at the high
+     * watermark and an XON when the ring has drained to the low
+     * watermark. For peers without a spare input pin; the data must be
+     * free of the XON/XOFF characters (e.g. a text protocol).
+     */
+    void enableFlowControlXonXoff();
+
+    /**
+     * Disable the flow control again. A paused peer is released first.
+     */
+    void disableFlowControl();
+
     /**
      * Test if the serial port is ready to being used.
      *
@@ -133,16 +271,46 @@ public:
      */
     operator bool();
 
+    /**
+     * Handle the serial interrupt. This method must be called from the
+     * interrupt handler of the UART, see SERIAL_INTERRUPT_HANDLER.
+     * Consider it to be a private method and do not call it yourself.
+     */
+    void interruptHandler();
+
 protected:
-    // Allow the interrupt handler to call our protected methods
-    friend void UART_IRQHandler();
+    LPC_UART_TypeDef* uart;  //!< the UART registers of this port
+    IRQn_Type irqn;          //!< the interrupt number of this port
+
+    SerialTxHandler txCompleteHandler; //!< called when the output has drained, 0 for none
+
+    const byte* volatile txBlock;  //!< the rest of the background transmit block
+    volatile int txBlockCount;     //!< remaining bytes of the block, 0 if none
+
+    byte flowMode;                 //!< the flow control mode, see SerialFlow
+    int rtsPin;                    //!< the RTS pin of the FLOW_RTS mode
+    volatile bool flowPaused;      //!< true while we told the peer to pause
+    volatile byte pendingFlow;     //!< XON/XOFF waiting for TX space, 0 if none
 
     /**
-     * Handle the serial interrupt.
+     * Send an XON or XOFF character: directly when the TX FIFO is empty,
+     * otherwise as the first byte of the next TX FIFO refill.
+     *
+     * @param ch - the character to send: SERIAL_XON or SERIAL_XOFF.
      */
-    void interruptHandler();
+    void sendFlowChar(byte ch);
 };
 
+/**
+ * Create an interrupt handler for a serial port. This macro must be used
+ * once for every Serial object that is created.
+ *
+ * @param handler - the name of the interrupt handler, e.g. UART_IRQHandler
+ * @param serialObj - the serial object of the port, e.g. serial
+ */
+#define SERIAL_INTERRUPT_HANDLER(handler, serialObj) \
+    extern "C" void handler() { serialObj.interruptHandler(); }
+
 
 //
 //  Inline functions
@@ -159,4 +327,14 @@ inline void Serial::begin(int baudRate)
     begin(baudRate, SERIAL_8N1);
 }
 
+inline int Serial::writePending() const
+{
+    return ((writeTail - writeHead) & BufferedStream::BUFFER_SIZE_MASK) + txBlockCount;
+}
+
+inline void Serial::onTxComplete(SerialTxHandler handler)
+{
+    txCompleteHandler = handler;
+}
+
 #endif /*sblib_serial_h*/
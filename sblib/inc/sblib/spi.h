@@ -11,6 +11,7 @@
 #define sblib_spi_h
 
 #include <sblib/platform.h>
+#include <sblib/types.h>
 
 
 /**
@@ -105,6 +106,11 @@ enum SpiMode
 // The default SPI mode settings
 #define SPI_DEFAULT_MODE  (SPI_FORMAT_SPI | SPI_CPOL_LOW | SPI_CPHASE_RAISE)
 
+/**
+ * Type of the transfer complete handler, see SPI::onTransferComplete().
+ */
+typedef void (*SpiTransferHandler)();
+
 
 /**
  * Class for accessing the serial peripheral interfaces (SPI).
@@ -114,6 +120,10 @@ enum SpiMode
  * to IO pins when using SPI port 0: SCK0, MISO0, MOSI0. Ffor SPI port 1, use
  * SCK1, MISO1, MOSI1.
  *
+ * Both SSP ports can be used concurrently with one SPI object per port,
+ * e.g. a display on SPI_PORT_0 and an SPI EEPROM on SPI_PORT_1. Every
+ * instance has its own clock configuration, see setClockDivider().
+ *
  * This class implements a SPI master.
  */
 class SPI
@@ -150,12 +160,33 @@ public:
     void setClockDivider(int div);
 
     /**
-     * Set the SPI data size. Default is 8 bit.
+     * Set the SPI data size: the number of bits per frame that the SSP
+     * hardware shifts out, 4 to 16 bits. Default is 8 bit.
      *
-     * @param dataSize - the data size, e.g. SPI_DATA_8BIT
+     * Peripherals with word oriented registers (16 bit display data, 12
+     * bit DAC values) are best driven with their native frame size and
+     * the 16 bit transfer calls (transfer(), transferBlock16(),
+     * startTransfer16()): one frame carries one value, halving the frame
+     * count and the per-frame status overhead compared to byte pairs.
+     *
+     * @param dataSize - the data size, e.g. SPI_DATA_8BIT, SPI_DATA_16BIT
      */
     void setDataSize(SpiDataSize dataSize);
 
+    /**
+     * Let the SPI object manage the slave select pin of the device. The
+     * pin is configured as output and deactivated (high). Transfers then
+     * assert the pin before the first byte and deactivate it when the
+     * transfer is done; with SPI_CONTINUE the pin stays asserted, so
+     * back-to-back transfers to the same device stream without a gap.
+     *
+     * Without a managed slave select pin the application has to drive the
+     * pin with digitalWrite() around every transfer.
+     *
+     * @param pin - the slave select pin, e.g. PIO0_2, -1 for none.
+     */
+    void setSlaveSelect(int pin);
+
     /**
      * Transfer one byte over the SPI bus. Sending and receiving of one
      * byte is done.
@@ -184,6 +215,102 @@ public:
      */
     int transfer(int val, SpiTransferMode transferMode);
 
+    /**
+     * Transfer a block of bytes over the SPI bus. The SSP hardware has an
+     * 8 frame FIFO in both directions: the TX FIFO is kept topped up while
+     * the RX FIFO is drained, so the bus stays busy between the bytes
+     * instead of waiting per byte for the transfer to complete.
+     *
+     * A managed slave select pin (see setSlaveSelect()) is asserted for
+     * the whole block; with SPI_CONTINUE it stays asserted afterwards.
+     * Blocks until the transfer is done.
+     *
+     * @param txData - the bytes to send, 0 to send 0xff fill bytes (e.g. when reading).
+     * @param rxData - the buffer for the received bytes, 0 to discard them.
+     * @param count - the number of bytes to transfer.
+     * @param transferMode - the transfer mode: SPI_CONTINUE or SPI_LAST (default)
+     *
+     * @return The number of bytes transferred.
+     */
+    int transferBlock(const byte* txData, byte* rxData, int count,
+        SpiTransferMode transferMode = SPI_LAST);
+
+    /**
+     * Transfer a block of 16 bit values over the SPI bus, like
+     * transferBlock() but one value per frame. Use with a frame size
+     * above 8 bits, see setDataSize(); values wider than the frame size
+     * are truncated by the hardware.
+     *
+     * @param txData - the values to send, 0 to send 0xffff fill values.
+     * @param rxData - the buffer for the received values, 0 to discard them.
+     * @param count - the number of values to transfer.
+     * @param transferMode - the transfer mode: SPI_CONTINUE or SPI_LAST (default)
+     *
+     * @return The number of values transferred.
+     */
+    int transferBlock16(const uint16_t* txData, uint16_t* rxData, int count,
+        SpiTransferMode transferMode = SPI_LAST);
+
+    /**
+     * Transfer a block of bytes in the background: the call returns
+     * immediately and the SSP interrupt moves the bytes, so the main loop
+     * keeps running during long transfers, e.g. a display update. Poll
+     * transferFinished() or use onTransferComplete() to learn when the
+     * transfer is done. The buffers must stay valid until then.
+     *
+     * A managed slave select pin (see setSlaveSelect()) is asserted for
+     * the whole block; with SPI_CONTINUE it stays asserted afterwards, so
+     * a queue of buffers can be streamed to one device without a gap.
+     *
+     * @param txData - the bytes to send, 0 to send 0xff fill bytes (e.g. when reading).
+     * @param rxData - the buffer for the received bytes, 0 to discard them.
+     * @param count - the number of bytes to transfer.
+     * @param transferMode - the transfer mode: SPI_CONTINUE or SPI_LAST (default)
+     *
+     * @return True if the transfer was started, false if a previous
+     *         transfer is still running.
+     */
+    bool startTransfer(const byte* txData, byte* rxData, int count,
+        SpiTransferMode transferMode = SPI_LAST);
+
+    /**
+     * Transfer a block of 16 bit values in the background, like
+     * startTransfer() but one value per frame. Use with a frame size
+     * above 8 bits, see setDataSize().
+     *
+     * @param txData - the values to send, 0 to send 0xffff fill values.
+     * @param rxData - the buffer for the received values, 0 to discard them.
+     * @param count - the number of values to transfer.
+     * @param transferMode - the transfer mode: SPI_CONTINUE or SPI_LAST (default)
+     *
+     * @return True if the transfer was started, false if a previous
+     *         transfer is still running.
+     */
+    bool startTransfer16(const uint16_t* txData, uint16_t* rxData, int count,
+        SpiTransferMode transferMode = SPI_LAST);
+
+    /**
+     * Test if a transfer that was started with startTransfer() is done.
+     *
+     * @return True if no background transfer is running.
+     */
+    bool transferFinished() const;
+
+    /**
+     * Set a handler that is called from the SSP interrupt when a transfer
+     * that was started with startTransfer() is done. Keep the handler
+     * short, it runs in interrupt context.
+     *
+     * @param handler - the handler to call, 0 for none.
+     */
+    void onTransferComplete(SpiTransferHandler handler);
+
+    /**
+     * Handle the SSP interrupt.
+     * Consider it to be a private method and do not call it yourself.
+     */
+    void interruptHandler();
+
 #ifdef SPI_BLOCK_TRANSFER
     /**
      * Transfer a bloc of data SPI bus.
@@ -219,6 +346,19 @@ public:
 protected:
     LPC_SSP_TypeDef& port;
     int clockDiv;
+    int portNum;             //!< the number of the SSP port: 0 or 1
+    IRQn_Type irqn;          //!< the interrupt number of the SSP port
+
+    const byte* volatile txPtr;  //!< the rest of the background transfer send data
+    byte* volatile rxPtr;        //!< the rest of the background transfer receive buffer
+    volatile int txRemaining;    //!< background transfer frames still to send
+    volatile int rxRemaining;    //!< background transfer frames still to receive, 0 if none
+    volatile bool wideFrames;    //!< background transfer with 16 bit values per frame
+
+    SpiTransferHandler transferCompleteHandler; //!< called when a background transfer is done, 0 for none
+
+    int sselPin;             //!< the managed slave select pin, -1 for none
+    volatile bool sselHold;  //!< keep the slave select asserted after the background transfer
 
 #ifdef SPI_BLOCK_TRANSFER
     uint16_t * sndData;
@@ -237,4 +377,14 @@ inline int SPI::transfer(int value)
     return transfer(value, SPI_LAST);
 }
 
+inline bool SPI::transferFinished() const
+{
+    return rxRemaining == 0;
+}
+
+inline void SPI::onTransferComplete(SpiTransferHandler handler)
+{
+    transferCompleteHandler = handler;
+}
+
 #endif /*sblib_spi_h*/
@@ -0,0 +1,257 @@
+/*
+ *  static_timer.h - Compile time bound timer access.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_static_timer_h
+#define sblib_static_timer_h
+
+#include <sblib/timer.h>
+
+/**
+ * A timer facade with the timer selected at compile time. The methods
+ * mirror the Timer class, but regs() folds to the constant peripheral
+ * address, so every access compiles to a direct register load or store -
+ * no object, no base pointer to fetch first. The Timer class resolves
+ * the timer through two indirections (the reference and the stored
+ * register pointer) on every call, which adds up in interrupt handlers
+ * that touch the timer a dozen times per invocation.
+ *
+ * Use it where the timer assignment is fixed anyway, e.g.:
+ *
+ *     typedef StaticTimer<TIMER16_0> PulseTimer;
+ *
+ *     PulseTimer::match(MAT1, 800);
+ *     if (PulseTimer::flag(CAP0)) ...
+ *
+ * Keep using the Timer class (timer16_0, ...) where the timer is chosen
+ * at run time.
+ *
+ * @param timerNum - the timer: TIMER16_0, TIMER16_1, TIMER32_0, TIMER32_1
+ */
+template<byte timerNum>
+class StaticTimer
+{
+public:
+    /**
+     * Get the registers of the timer. With timerNum being a compile time
+     * constant, the selection folds to the constant address.
+     */
+    static ALWAYS_INLINE LPC_TMR_TypeDef* regs()
+    {
+        return timerNum == TIMER16_0 ? LPC_TMR16B0
+             : timerNum == TIMER16_1 ? LPC_TMR16B1
+             : timerNum == TIMER32_0 ? LPC_TMR32B0
+             : LPC_TMR32B1;
+    }
+
+    /**
+     * Begin using the timer: power it on, see Timer::begin().
+     */
+    static ALWAYS_INLINE void begin()
+    {
+        LPC_SYSCON->SYSAHBCLKCTRL |= 1 << (7 + timerNum);
+
+        regs()->EMR = 0;
+        regs()->MCR = 0;
+        regs()->CCR = 0;
+    }
+
+    /**
+     * End using the timer, see Timer::end().
+     */
+    static ALWAYS_INLINE void end()
+    {
+        LPC_SYSCON->SYSAHBCLKCTRL &= ~(1 << (7 + timerNum));
+    }
+
+    /**
+     * Set the prescaler division factor, see Timer::prescaler().
+     */
+    static ALWAYS_INLINE void prescaler(unsigned int factor) { regs()->PR = factor; }
+
+    /**
+     * Get the prescaler division factor.
+     */
+    static ALWAYS_INLINE unsigned int prescaler() { return regs()->PR; }
+
+    /**
+     * Start the timer.
+     */
+    static ALWAYS_INLINE void start() { regs()->TCR |= 1; }
+
+    /**
+     * Stop the timer.
+     */
+    static ALWAYS_INLINE void stop() { regs()->TCR &= ~1; }
+
+    /**
+     * Restart the timer: reset and start.
+     */
+    static ALWAYS_INLINE void restart()
+    {
+        regs()->TCR = 2;
+        regs()->TCR = 1;
+    }
+
+    /**
+     * Reset the timer.
+     */
+    static ALWAYS_INLINE void reset()
+    {
+        regs()->TCR |= 2;
+        regs()->TCR &= ~2;
+    }
+
+    /**
+     * Read the current value of the timer.
+     */
+    static ALWAYS_INLINE unsigned int value() { return regs()->TC; }
+
+    /**
+     * Set the current value of the timer.
+     */
+    static ALWAYS_INLINE void value(unsigned int val) { regs()->TC = val; }
+
+    /**
+     * Enable timer interrupts for this timer.
+     */
+    static ALWAYS_INLINE void interrupts()
+    {
+        NVIC_EnableIRQ(interruptNumber());
+    }
+
+    /**
+     * Disable timer interrupts for this timer.
+     */
+    static ALWAYS_INLINE void noInterrupts()
+    {
+        NVIC_DisableIRQ(interruptNumber());
+    }
+
+    /**
+     * Set the priority of this timer's interrupt, see
+     * Timer::interruptPriority().
+     */
+    static ALWAYS_INLINE void interruptPriority(unsigned int priority)
+    {
+        NVIC_SetPriority(interruptNumber(), priority);
+    }
+
+    /**
+     * Get the interrupt number of this timer.
+     */
+    static ALWAYS_INLINE IRQn_Type interruptNumber()
+    {
+        return (IRQn_Type) (TIMER_16_0_IRQn + timerNum);
+    }
+
+    /**
+     * Read the interrupt flags of the timer, see Timer::flags().
+     */
+    static ALWAYS_INLINE int flags() { return regs()->IR; }
+
+    /**
+     * Reset the interrupt flags of the timer.
+     */
+    static ALWAYS_INLINE void resetFlags() { regs()->IR = 0xff; }
+
+    /**
+     * Test if the timer flag of a match channel is set.
+     */
+    static ALWAYS_INLINE bool flag(TimerMatch match)
+    {
+        return regs()->IR & (1 << match);
+    }
+
+    /**
+     * Test if the timer flag of a capture channel is set.
+     */
+    static ALWAYS_INLINE bool flag(TimerCapture cap)
+    {
+        return regs()->IR & (16 << cap);
+    }
+
+    /**
+     * Configure a match channel, see Timer::matchMode().
+     */
+    static void matchMode(int channel, int mode)
+    {
+        int offset = channel * 3;
+        regs()->MCR &= ~(7 << offset);
+        regs()->MCR |= (mode & 7) << offset;
+
+        offset = channel << 1;
+        regs()->EMR &= ~(0x30 << offset);
+        regs()->EMR |= (mode & 0x30) << offset;
+    }
+
+    /**
+     * Set the timer value of a match channel.
+     */
+    static ALWAYS_INLINE void match(int channel, unsigned int value)
+    {
+        (&regs()->MR0)[channel] = value;
+    }
+
+    /**
+     * Get the timer value of a match channel.
+     */
+    static ALWAYS_INLINE unsigned int match(int channel)
+    {
+        return (&regs()->MR0)[channel];
+    }
+
+    /**
+     * Configure a capture channel, see Timer::captureMode().
+     */
+    static void captureMode(int channel, int mode)
+    {
+        short offset = channel * 3;
+
+        short val = (mode >> 6) & 3;
+        if (mode & INTERRUPT)
+            val |= 4;
+
+        regs()->CCR &= ~(7 << offset);
+        regs()->CCR |= val << offset;
+    }
+
+    /**
+     * Get the timer value of a capture channel.
+     */
+    static ALWAYS_INLINE unsigned int capture(int channel)
+    {
+        return (&regs()->CR0)[channel];
+    }
+
+    /**
+     * Enable a PWM channel, see Timer::pwmEnable().
+     */
+    static ALWAYS_INLINE void pwmEnable(int channel)
+    {
+        regs()->PWMC |= 1 << channel;
+    }
+
+    /**
+     * Disable a PWM channel.
+     */
+    static ALWAYS_INLINE void pwmDisable(int channel)
+    {
+        regs()->PWMC &= ~(1 << channel);
+    }
+
+    /**
+     * Get the digital level of a match channel.
+     */
+    static ALWAYS_INLINE bool getMatchChannelLevel(int channel)
+    {
+        return regs()->EMR & (1 << channel);
+    }
+};
+
+#endif /*sblib_static_timer_h*/
@@ -0,0 +1,67 @@
+/*
+ *  tick.h - The consolidated housekeeping tick of the library.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_tick_h
+#define sblib_tick_h
+
+/**
+ * Periodic lightweight work - debounce sampling, timeout checks,
+ * statistics windows - does not need its own time gate in every loop()
+ * pass. The housekeeping tick reads the millisecond clock once per main
+ * loop pass and runs the attached handlers in one pass: the 1 kHz tier
+ * at most once per millisecond, the 100 Hz tier every 10 milliseconds.
+ * The expired scheduled timeouts are fired from the 1 kHz tier, see
+ * ScheduledTimeout.
+ *
+ * The library's main calls tickCheck() before every loop() pass.
+ * Handlers must be short: they run in the main loop, not in an
+ * interrupt, but everything in their tier waits for them.
+ */
+
+/** A tick handler. Called without arguments, must not block. */
+typedef void (*TickHandler)(void);
+
+/** The rates that a tick handler can be attached at */
+enum TickRate
+{
+    TICK_1KHZ,   //!< run at most once per millisecond
+    TICK_100HZ   //!< run every 10 milliseconds
+};
+
+/**
+ * The maximum number of handlers per tier. Can be overridden in the
+ * project settings.
+ */
+#ifndef TICK_MAX_HANDLERS
+#define TICK_MAX_HANDLERS 4
+#endif
+
+/**
+ * Attach a handler to the housekeeping tick.
+ *
+ * @param handler - the handler to call.
+ * @param rate - the tier to run the handler at, default TICK_1KHZ.
+ * @return True if the handler was attached, false if the tier is full.
+ */
+bool tickAttach(TickHandler handler, TickRate rate = TICK_1KHZ);
+
+/**
+ * Detach a handler from the housekeeping tick.
+ *
+ * @param handler - the handler to detach.
+ */
+void tickDetach(TickHandler handler);
+
+/**
+ * Run the due tick work. The library's main calls this once per loop
+ * pass; a program with its own main loop calls it itself.
+ */
+void tickCheck();
+
+#endif /*sblib_tick_h*/
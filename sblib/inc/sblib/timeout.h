@@ -12,6 +12,7 @@
 #define TIMEOUT_H_
 
 #include "sblib/internal/variables.h"
+#include "sblib/timer.h"
 
 #define MS2TICKS(m) (m)
 
@@ -47,7 +48,7 @@ public:
 			stop();
 		else
 		{
-			timeout = systemTime + ms;
+			timeout = millis() + ms;
 			if(timeout == Timeout::STOPPED) timeout++;
 		}
 	};
@@ -60,7 +61,7 @@ public:
 	{
 		if (timeout != Timeout::STOPPED)
 		{
-			if(((int)(systemTime - timeout)) >= 0)
+			if(((int)(millis() - timeout)) >= 0)
 			{
 				stop();
 				return true;
@@ -98,6 +99,95 @@ protected:
 	enum STATE { STOPPED  = 0};
 };
 
+/** The callback function of a ScheduledTimeout
+ * @param   param   The parameter that was passed to callback()
+ */
+typedef void (*TimeoutCallback)(void* param);
+
+class ScheduledTimeout
+/**
+ * A timeout that is kept in a deadline-sorted list and fires a callback
+ * when it expires. Unlike Timeout, the instances are not polled: one
+ * ScheduledTimeout::checkNext() call per loop compares only the earliest
+ * deadline against the system time, so the steady-state cost does not
+ * grow with the number of pending timeouts.
+ *
+ * Example:
+ *
+ *     ScheduledTimeout t;
+ *     t.callback(blink);   // void blink(void* param)
+ *     t.startPeriodic(500);
+ *     ...
+ *     while (1)
+ *     {
+ *         bcu.loop();
+ *         ScheduledTimeout::checkNext();
+ *     }
+ */
+{
+public:
+	/** Create a new timeout in the stopped state */
+	ScheduledTimeout(void);
+
+	/** Set the function that is called when the timeout expires
+	 * @param   cb     The callback function
+	 * @param   param  An arbitrary parameter that is passed to the callback
+	 */
+	void callback(TimeoutCallback cb, void* param = 0);
+
+	/** Start the timeout: the callback fires once in ms milli seconds
+	 * @param   ms  The timeout value in milli seconds
+	 */
+	void start(unsigned int ms);
+
+	/** Start the timeout periodically: the callback fires every ms
+	 *  milli seconds until stop() is called
+	 * @param   ms  The period in milli seconds
+	 */
+	void startPeriodic(unsigned int ms);
+
+	/** Stop the timeout: it is removed from the list and does not fire */
+	void stop(void);
+
+	/** Returns if the timeout has been started
+	 *
+	 * @return If the timeout as been started
+	 */
+	bool started(void)
+	{
+		return queued;
+	}
+
+	/** Fire the expired timeouts. Call this once per main loop. Only the
+	 *  earliest deadline is compared when nothing has expired.
+	 */
+	static void checkNext(void);
+
+	/** The number of milli seconds until the earliest deadline, for
+	 *  bounding a sleep of the main loop, see eventWait().
+	 *
+	 * @return The milli seconds until the earliest pending timeout, 0
+	 *         when one already expired, ~0 when none is pending.
+	 */
+	static unsigned int nextDelay(void);
+
+protected:
+	/** Insert this timeout into the deadline-sorted list */
+	void insert(void);
+
+	/** Remove this timeout from the list if it is queued */
+	void remove(void);
+
+	unsigned int timeout;       //!< The deadline in system time
+	unsigned int period;        //!< The period in ms, 0 when one-shot
+	TimeoutCallback cb;         //!< The callback to fire
+	void* cbParam;              //!< The parameter of the callback
+	ScheduledTimeout* next;     //!< The next timeout in the list
+	bool queued;                //!< If the timeout is in the list
+
+	static ScheduledTimeout* first;  //!< The timeout with the earliest deadline
+};
+
 #if 0
 class Periodic_Timeout : public Timeout
 {
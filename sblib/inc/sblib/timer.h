@@ -36,6 +36,9 @@ void delayMicroseconds(unsigned int usec);
  * Get the number of milliseconds that elapsed since the last reset or processor start.
  * Please note that the system time overflows and restarts at zero after 49,7 days.
  *
+ * The clock is derived from the free running microsecond timer on read,
+ * see microsBegin() - there is no periodic tick interrupt behind it.
+ *
  * @return The number of milliseconds.
  */
 unsigned int millis();
@@ -48,6 +51,125 @@ unsigned int millis();
  */
 unsigned int elapsed(unsigned int ref);
 
+/**
+ * Begin the monotonic microsecond clock, see micros64(). The timer is
+ * claimed completely and runs free with 1 usec resolution; its overflows
+ * are accumulated into the upper half of the 64 bit clock. The timer
+ * interrupt must be connected with the MICROS_TIMER_INTERRUPT_HANDLER()
+ * macro:
+ *
+ * microsBegin(timer32_0);
+ * MICROS_TIMER_INTERRUPT_HANDLER(TIMER32_0_IRQHandler)
+ *
+ * Use a 32 bit timer: it overflows every 71.6 minutes, a 16 bit timer
+ * every 65.5 msec and would spend considerable time in the overflow
+ * interrupt.
+ *
+ * The library's main calls microsBegin(timer32_1) at startup: millis()
+ * and delay() are derived from this clock, and timer32_1 is taken.
+ *
+ * @param aTimer - the timer to use for the clock, e.g. timer32_0.
+ */
+void microsBegin(Timer& aTimer);
+
+/**
+ * Get the number of microseconds that elapsed since microsBegin(). The
+ * clock is monotonic and does not overflow for 584000 years, so interval
+ * math is a plain subtraction without any wrap handling.
+ *
+ * @return The number of microseconds as 64 bit value.
+ */
+unsigned long long micros64();
+
+/**
+ * Get the number of microseconds that elapsed since the reference time.
+ *
+ * @param since - the reference time from micros64() to compare with
+ * @return The number of microseconds since the reference time.
+ */
+unsigned long long elapsedMicros(unsigned long long since);
+
+/**
+ * A non-blocking microsecond delay for state machines. The token stores
+ * the expiry time of the monotonic microsecond clock, so a state machine
+ * can start a delay, keep doing other work and poll expired() - instead
+ * of blocking in delayMicroseconds(). The clock read makes the delay as
+ * precise as the blocking one: no calibration loop, no drift with
+ * compiler flags or interrupt load.
+ *
+ *     DelayToken recovery;
+ *     recovery.start(480);
+ *     ...
+ *     if (recovery.expired()) nextState();
+ *
+ * A default constructed token is expired. The token needs the
+ * microsecond clock, see microsBegin().
+ */
+class DelayToken
+{
+public:
+    /**
+     * Create an expired delay token.
+     */
+    DelayToken() : end(0) {}
+
+    /**
+     * Start the delay: the token expires in usec microseconds. One
+     * microsecond extra so the delay is at least usec, wherever within
+     * the current microsecond it starts.
+     *
+     * @param usec - the number of microseconds until expiry.
+     */
+    void start(unsigned int usec) { end = micros64() + usec + 1; }
+
+    /**
+     * Test if the delay has expired.
+     *
+     * @return True if the delay has expired or was never started.
+     */
+    bool expired() const { return micros64() >= end; }
+
+    /**
+     * Get the time until the delay expires.
+     *
+     * @return The remaining microseconds, 0 if expired.
+     */
+    unsigned int remaining() const
+    {
+        unsigned long long now = micros64();
+        return now < end ? (unsigned int) (end - now) : 0;
+    }
+
+private:
+    unsigned long long end; //!< the clock value at which the delay expires
+};
+
+/**
+ * Sleep until approximately usec microseconds passed, or until any other
+ * interrupt wakes the processor, whichever comes first. A match channel
+ * of the clock timer is used as the wakeup. Returns immediately when the
+ * microsecond clock is not running.
+ *
+ * @param usec - the number of microseconds to sleep at most.
+ */
+void microsSleep(unsigned int usec);
+
+/**
+ * The interrupt handler of the microsecond clock. Do not call this
+ * directly, use the MICROS_TIMER_INTERRUPT_HANDLER() macro.
+ */
+void microsTimerInterruptHandler();
+
+/**
+ * Create the interrupt handler for the timer of the microsecond clock,
+ * see microsBegin().
+ *
+ * @param handler - the name of the interrupt handler, e.g.
+ *                  TIMER32_0_IRQHandler for timer32_0.
+ */
+#define MICROS_TIMER_INTERRUPT_HANDLER(handler) \
+    extern "C" void handler() { microsTimerInterruptHandler(); }
+
 /**
  * The number of CPU clock cycles per microsecond.
  */
@@ -193,6 +315,22 @@ public:
      */
     void noInterrupts();
 
+    /**
+     * Set the priority of this timer's interrupt. Use the ISR_PRIO_xx
+     * levels of the library's priority policy, see interrupt.h.
+     *
+     * @param priority - the priority, 0..3, lower value preempts higher.
+     */
+    void interruptPriority(unsigned int priority);
+
+    /**
+     * Get the interrupt number of this timer, e.g. for an InterruptLock
+     * around data that is shared with the timer's interrupt handler.
+     *
+     * @return The interrupt number: TIMER_16_0_IRQn, ...
+     */
+    IRQn_Type interruptNumber() const;
+
     /**
      * Read the interrupt flags of the timer. This register contains the flags that caused an
      * interrupt for the timer.
@@ -428,16 +566,9 @@ protected:
 //
 
 
-ALWAYS_INLINE unsigned int millis()
-{
-    extern volatile unsigned int systemTime;
-    return systemTime;
-}
-
 ALWAYS_INLINE unsigned int elapsed(unsigned int ref)
 {
-    extern volatile unsigned int systemTime;
-    return systemTime - ref;
+    return millis() - ref;
 }
 
 ALWAYS_INLINE void Timer::prescaler(unsigned int factor)
@@ -527,6 +658,16 @@ ALWAYS_INLINE void Timer::noInterrupts()
     NVIC_DisableIRQ((IRQn_Type) (TIMER_16_0_IRQn + timerNum));
 }
 
+ALWAYS_INLINE void Timer::interruptPriority(unsigned int priority)
+{
+    NVIC_SetPriority((IRQn_Type) (TIMER_16_0_IRQn + timerNum), priority);
+}
+
+ALWAYS_INLINE IRQn_Type Timer::interruptNumber() const
+{
+    return (IRQn_Type) (TIMER_16_0_IRQn + timerNum);
+}
+
 
 ALWAYS_INLINE unsigned int Timer::match(int channel) const
 {
@@ -0,0 +1,103 @@
+/*
+ *  trace.h - Compile-out event counters and tracepoints.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef sblib_trace_h
+#define sblib_trace_h
+
+/**
+ * A lightweight tracing facility: named counters and timestamped events
+ * at the library's hot spots, for the instrumentation that the
+ * performance work needs. Everything compiles to nothing unless the
+ * global define SB_TRACE is set, so release builds stay clean and the
+ * hot paths keep their cycle budgets.
+ *
+ * Use TRACE_COUNT(id) to count an occurrence and TRACE_EVENT(id, value)
+ * to additionally record the value with a millisecond timestamp into a
+ * small ring. traceDrain() writes the counters and the event ring in a
+ * compact binary format to any Print sink, typically the serial port.
+ */
+
+/**
+ * The trace point ids. The library's own trace points come first, the
+ * TRACE_APP ids are free for the application.
+ */
+enum TraceId
+{
+    TRACE_RX_TELEGRAM,   //!< A valid telegram was received
+    TRACE_TX_RETRY,      //!< A telegram transmission was repeated
+    TRACE_QUEUE_FULL,    //!< A telegram was dropped or delayed: queue full
+    TRACE_RX_FILTERED,   //!< A received telegram was dropped early: for another device
+    TRACE_FLASH_COMMIT,  //!< The user EEPROM was committed to flash
+    TRACE_APP1,          //!< Free for the application
+    TRACE_APP2,          //!< Free for the application
+    TRACE_APP3,          //!< Free for the application
+    TRACE_APP4,          //!< Free for the application
+
+    TRACE_ID_COUNT       //!< The number of trace point ids
+};
+
+#ifdef SB_TRACE
+#define TRACE_COUNT(id)         traceCount(id)
+#define TRACE_EVENT(id, value)  traceEvent(id, value)
+#else
+#define TRACE_COUNT(id)
+#define TRACE_EVENT(id, value)
+#endif
+
+#ifdef SB_TRACE
+
+/** The number of entries of the trace event ring */
+#define TRACE_EVENT_RING 32
+
+class Print;
+
+/**
+ * Count one occurrence of a trace point.
+ *
+ * @param id - the trace point id, see TraceId.
+ */
+void traceCount(int id);
+
+/**
+ * Count one occurrence of a trace point and record the value with a
+ * millisecond timestamp into the event ring. The ring keeps the latest
+ * TRACE_EVENT_RING events, older events are overwritten.
+ *
+ * @param id - the trace point id, see TraceId.
+ * @param value - the value to record with the event.
+ */
+void traceEvent(int id, unsigned int value);
+
+/**
+ * Get the counter of a trace point.
+ *
+ * @param id - the trace point id, see TraceId.
+ * @return The number of occurrences since the last traceClear().
+ */
+unsigned int traceCounter(int id);
+
+/**
+ * Reset all counters and the event ring.
+ */
+void traceClear();
+
+/**
+ * Write the counters and the event ring to a Print sink in a binary
+ * format: the header "SBTR", a version byte, the number of counters,
+ * the number of events and a reserved byte, then the counters (4 bytes
+ * each) and the events (4 bytes time, 2 bytes id, 4 bytes value),
+ * oldest first, all little endian.
+ *
+ * @param out - the sink to write to, e.g. serial.
+ */
+void traceDrain(Print& out);
+
+#endif /*SB_TRACE*/
+
+#endif /*sblib_trace_h*/
@@ -11,6 +11,7 @@
 #define sblib_utils_h
 
 #include <sblib/types.h>
+#include <sblib/crc.h>
 
 
 /**
@@ -22,6 +23,28 @@
  */
 void reverseCopy(byte* dest, const byte* src, int len);
 
+/**
+ * Copy from src to dest. Copies a word at a time when the alignment of
+ * the pointers allows it, so copying telegram or display buffers is a
+ * fraction of a byte-wise loop.
+ *
+ * @param dest - the destination to copy to
+ * @param src - the source to copy from
+ * @param len - the number of bytes to copy
+ */
+void copyData(byte* dest, const byte* src, int len);
+
+/**
+ * Compare two data blocks. Compares a word at a time when the alignment
+ * of the pointers allows it.
+ *
+ * @param a - the first data block
+ * @param b - the second data block
+ * @param len - the number of bytes to compare
+ * @return True if the data blocks are equal, false if not.
+ */
+bool equalData(const byte* a, const byte* b, int len);
+
 /**
  * Call when a fatal application error happens. This function will never
  * return and the program LED will blink rapidly to indicate the error.
@@ -44,8 +67,11 @@ void fatalError();
  *        };
  *
  *        OFFSET_OF(ex,c) returns 2
+ *
+ *        The offset is a constant expression that can also be used in
+ *        static_assert() and constexpr contexts.
  */
-#define OFFSET_OF(type, field)  ((unsigned int) &(((type *) 0)->field))
+#define OFFSET_OF(type, field)  (__builtin_offsetof(type, field))
 
 /**
  * Include the C++ code snippet if DEBUG is defined, do not include the code
@@ -0,0 +1,122 @@
+/*
+ *  analog_pin_scan.cpp - Continuous analog scan with interrupt collection
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/analog_pin.h>
+
+#include <sblib/interrupt.h>
+#include <sblib/platform.h>
+
+// ADC conversion complete
+#define ADC_DONE  0x80000000
+
+// ADC burst mode: convert the selected channels round-robin in hardware
+#define ADC_BURST  (1 << 16)
+
+// The channels that the scan converts
+static unsigned int scanChannels;
+
+// The latest converted value per channel
+static volatile unsigned short scanValues[8];
+
+// The decimation shift per channel: 0 for plain 10 bit values, 1..3 for
+// 4x / 16x / 64x oversampling
+static byte scanShift[8];
+
+// The number of conversions to accumulate per channel: 4^scanShift
+static byte scanTarget[8];
+
+// The oversampling accumulator and conversion count per channel
+static unsigned short scanAcc[8];
+static byte scanCount[8];
+
+
+void analogBeginScan(int channelMask)
+{
+    scanChannels = channelMask & 0xff;
+
+    // Stop the ADC and deselect all channels
+    LPC_ADC->CR &= 0xf8ffff00;
+
+    // Read the channels to clear old "done" flags
+    for (int channel = 0; channel < 8; ++channel)
+    {
+        if (scanChannels & (1 << channel))
+            LPC_ADC->DR[channel];
+    }
+
+    // Interrupt on every converted channel, not on the global "done" flag
+    LPC_ADC->INTEN = scanChannels;
+    setInterruptPriority(ADC_IRQn, ISR_PRIO_BACKGROUND);
+    enableInterrupt(ADC_IRQn);
+
+    // Select the channels and start the burst. The start bits must be zero
+    // in burst mode.
+    LPC_ADC->CR |= scanChannels | ADC_BURST;
+}
+
+void analogEndScan()
+{
+    LPC_ADC->CR &= ~(ADC_BURST | 0xff);
+
+    disableInterrupt(ADC_IRQn);
+    LPC_ADC->INTEN = 0x100;
+
+    scanChannels = 0;
+}
+
+int analogScanValue(int channel)
+{
+    return scanValues[channel];
+}
+
+void analogScanOversample(int channel, int ratio)
+{
+    byte shift = 0;
+    while ((1 << (shift + shift)) < ratio)
+        ++shift;
+
+    scanShift[channel] = 0;  // keep the interrupt out of the accumulator
+    scanAcc[channel] = 0;
+    scanCount[channel] = 0;
+    scanTarget[channel] = 1 << (shift + shift);
+    scanShift[channel] = shift;
+}
+
+extern "C" void ADC_IRQHandler()
+{
+    for (int channel = 0; channel < 8; ++channel)
+    {
+        if (!(scanChannels & (1 << channel)))
+            continue;
+
+        // Reading the data register clears its "done" and "overrun" flags
+        unsigned int regVal = LPC_ADC->DR[channel];
+        if (!(regVal & ADC_DONE))
+            continue;
+
+        unsigned int value = (regVal >> 6) & 0x3ff;
+        byte shift = scanShift[channel];
+        if (!shift)
+        {
+            scanValues[channel] = value;
+            continue;
+        }
+
+        // Oversampling: accumulate 4^shift conversions and decimate the
+        // sum, gaining shift bits of effective resolution
+        scanAcc[channel] += value;
+        if (++scanCount[channel] >= scanTarget[channel])
+        {
+            scanValues[channel] = scanAcc[channel] >> shift;
+            scanAcc[channel] = 0;
+            scanCount[channel] = 0;
+        }
+    }
+}
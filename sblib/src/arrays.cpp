@@ -35,10 +35,90 @@ short indexOf(unsigned short val, const unsigned short* arr, short count)
 
 short indexOf(byte val, const byte* arr, short count)
 {
-    for (short idx = 0; idx < count; ++idx)
+    const byte* ptr = arr;
+
+    // Scan byte-wise up to the next word boundary
+    while (count > 0 && ((unsigned long) ptr & 3))
     {
-        if (arr[idx] == val)
-            return idx;
+        if (*ptr == val)
+            return ptr - arr;
+        ++ptr;
+        --count;
+    }
+
+    // Scan 4 bytes per iteration: a word XORed with the repeated search
+    // value has a zero byte exactly where the value matches, and the
+    // classic (x - 0x01010101) & ~x & 0x80808080 test detects a zero
+    // byte without looking at the single bytes
+    unsigned int pattern = val * 0x01010101u;
+
+    while (count >= 4)
+    {
+        unsigned int word = *(const unsigned int*) ptr ^ pattern;
+        if ((word - 0x01010101) & ~word & 0x80808080)
+            break;  // one of the 4 bytes matches: find it below
+
+        ptr += 4;
+        count -= 4;
+    }
+
+    while (count > 0)
+    {
+        if (*ptr == val)
+            return ptr - arr;
+        ++ptr;
+        --count;
+    }
+
+    return -1;
+}
+
+short indexOfSorted(int val, const int* arr, short count)
+{
+    short lo = 0;
+    short hi = count - 1;
+
+    while (lo <= hi)
+    {
+        short mid = (lo + hi) >> 1;
+
+        if (arr[mid] < val) lo = mid + 1;
+        else if (arr[mid] > val) hi = mid - 1;
+        else return mid;
+    }
+
+    return -1;
+}
+
+short indexOfSorted(unsigned short val, const unsigned short* arr, short count)
+{
+    short lo = 0;
+    short hi = count - 1;
+
+    while (lo <= hi)
+    {
+        short mid = (lo + hi) >> 1;
+
+        if (arr[mid] < val) lo = mid + 1;
+        else if (arr[mid] > val) hi = mid - 1;
+        else return mid;
+    }
+
+    return -1;
+}
+
+short indexOfSorted(byte val, const byte* arr, short count)
+{
+    short lo = 0;
+    short hi = count - 1;
+
+    while (lo <= hi)
+    {
+        short mid = (lo + hi) >> 1;
+
+        if (arr[mid] < val) lo = mid + 1;
+        else if (arr[mid] > val) hi = mid - 1;
+        else return mid;
     }
 
     return -1;
@@ -10,6 +10,89 @@
 
 #include <sblib/buffered_stream.h>
 
+#include <sblib/timer.h>
+#include <string.h>
+
+
+int BufferedStream::readBytes(byte* buffer, int length, unsigned int timeoutMs)
+{
+    unsigned int start = millis();
+    int done = 0;
+
+    while (done < length)
+    {
+        int count = available();
+        if (!count)
+        {
+            if (millis() - start > timeoutMs)
+                break;
+            continue;
+        }
+
+        if (count > length - done)
+            count = length - done;
+
+        // Copy out of the ring, at most up to the ring end per round - the
+        // rest follows in the next round from the ring start
+        int chunk = BUFFER_SIZE - readHead;
+        if (chunk > count) chunk = count;
+
+        memcpy(buffer + done, (const byte*) readBuffer + readHead, chunk);
+        readHead = (readHead + chunk) & BUFFER_SIZE_MASK;
+        done += chunk;
+    }
+
+    return done;
+}
+
+int BufferedStream::readUntil(byte delim, byte* buffer, int maxLength, unsigned int timeoutMs)
+{
+    unsigned int start = millis();
+    int done = 0;
+    bool found = false;
+
+    while (!found && done < maxLength)
+    {
+        int avail = available();
+        if (!avail)
+        {
+            if (millis() - start > timeoutMs)
+                break;
+            continue;
+        }
+
+        // Scan the buffered bytes for the delimiter
+        int pos = readHead;
+        int count = 0;
+        while (count < avail && done + count < maxLength)
+        {
+            if (readBuffer[pos] == delim)
+            {
+                found = true;
+                break;
+            }
+            pos = (pos + 1) & BUFFER_SIZE_MASK;
+            ++count;
+        }
+
+        // Copy out of the ring, in at most two segments
+        while (count > 0)
+        {
+            int chunk = BUFFER_SIZE - readHead;
+            if (chunk > count) chunk = count;
+
+            memcpy(buffer + done, (const byte*) readBuffer + readHead, chunk);
+            readHead = (readHead + chunk) & BUFFER_SIZE_MASK;
+            done += chunk;
+            count -= chunk;
+        }
+
+        if (found) // consume the delimiter
+            readHead = (readHead + 1) & BUFFER_SIZE_MASK;
+    }
+
+    return done;
+}
 
 int BufferedStream::read()
 {
@@ -34,3 +34,29 @@ int Debouncer::debounce(int current, unsigned int timeout)
 
     return valid;
 }
+
+VectorDebouncer::VectorDebouncer()
+: valid(0)
+, cnt0(0)
+, cnt1(0)
+, edges(0)
+{
+}
+
+unsigned int VectorDebouncer::debounce(unsigned int current)
+{
+    // Vertical counters: cnt1/cnt0 hold one 2 bit counter per channel.
+    // The counter of a channel counts up while the channel differs from
+    // its stable state and is reset when it matches again. On the 4th
+    // consecutive differing poll the counter overflows and the stable
+    // state of the channel is toggled.
+    unsigned int delta = current ^ valid;
+
+    cnt1 = (cnt1 ^ cnt0) & delta;
+    cnt0 = ~cnt0 & delta;
+
+    edges = delta & ~(cnt0 | cnt1);
+    valid ^= edges;
+
+    return valid;
+}
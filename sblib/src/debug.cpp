@@ -28,16 +28,39 @@
 #endif
 
 
+Debug::Debug()
+{
+    buffered = 0;
+}
+
 int Debug::write(byte ch)
 {
-    return write((const byte*) &ch, 1);
+    buffer[buffered++] = ch;
+
+    // One semihosting call per line: each call stops the ARM, so the
+    // output is collected until the line is complete or the buffer full
+    if (ch == '\n' || buffered == (int) sizeof(buffer))
+        flush();
+
+    return 1;
 }
 
 int Debug::write(const byte* data, int count)
 {
+    for (int i = 0; i < count; ++i)
+        write(data[i]);
+
+    return count;
+}
+
+void Debug::flush()
+{
+    if (!buffered)
+        return;
+
 #ifndef IAP_EMULATION
     if (DEBUG_ACTIVE)
-        return __write(0, (const char*) data, count);
+        __write(0, (const char*) buffer, buffered);
 #endif
-    return 0;
+    buffered = 0;
 }
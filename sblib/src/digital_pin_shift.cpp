@@ -9,6 +9,129 @@
  */
 #include <sblib/digital_pin.h>
 
+#include <sblib/platform.h>
+
+// SSP status: TX FIFO not full
+#define SSP_SR_TNF  (1 << 1)
+
+// SSP status: RX FIFO not empty
+#define SSP_SR_RNE  (1 << 2)
+
+// SSP status: busy
+#define SSP_SR_BSY  (1 << 4)
+
+// The SSP port that backs shiftOut(), 0 for bit-banging
+static LPC_SSP_TypeDef* shiftSsp;
+
+// The pin pair that the SSP port is attached to
+static int shiftDataPin = -1;
+static int shiftClockPin = -1;
+
+
+/*
+ * Reverse the bit order of a byte, for LSBFIRST output through the
+ * MSB-first SSP hardware.
+ */
+static byte reverseBits(byte value)
+{
+    value = ((value & 0xf0) >> 4) | ((value & 0x0f) << 4);
+    value = ((value & 0xcc) >> 2) | ((value & 0x33) << 2);
+    value = ((value & 0xaa) >> 1) | ((value & 0x55) << 1);
+    return value;
+}
+
+/*
+ * Shift out a byte through the attached SSP port: push it into the TX
+ * FIFO and discard the received byte.
+ */
+static void shiftSspByte(byte value)
+{
+    while (!(shiftSsp->SR & SSP_SR_TNF))
+        ;
+    shiftSsp->DR = value;
+
+    while (shiftSsp->SR & SSP_SR_RNE)
+        shiftSsp->DR;
+}
+
+bool shiftOutBegin(int dataPin, int clockPin)
+{
+    shiftSsp = 0;
+    shiftDataPin = dataPin;
+    shiftClockPin = clockPin;
+
+#ifdef __LPC11XX__
+    int portNum = -1;
+
+    if (dataPin == PIO0_9 &&
+        (clockPin == PIO0_10 || clockPin == PIO2_11 || clockPin == PIO0_6))
+    {
+        portNum = 0;
+    }
+    else if ((dataPin == PIO2_3 || dataPin == PIO1_9) &&
+        (clockPin == PIO2_1 || clockPin == PIO3_2))
+    {
+        portNum = 1;
+    }
+
+    if (portNum >= 0)
+    {
+        // Enable the clock for the SSP port and release its reset
+        if (portNum == 0)
+        {
+            LPC_SYSCON->PRESETCTRL |= 1;
+            LPC_SYSCON->SYSAHBCLKCTRL |= 1 << 11;
+            LPC_SYSCON->SSP0CLKDIV = 2;
+            shiftSsp = LPC_SSP0;
+        }
+        else
+        {
+            LPC_SYSCON->PRESETCTRL |= 4;
+            LPC_SYSCON->SYSAHBCLKCTRL |= 1 << 18;
+            LPC_SYSCON->SSP1CLKDIV = 2;
+            shiftSsp = LPC_SSP1;
+        }
+
+        pinMode(dataPin, OUTPUT | SPI_MOSI);
+        pinMode(clockPin, OUTPUT | SPI_CLOCK);
+
+        // 8 bit frames, SPI format, clock low between frames, a moderate
+        // bit clock that any shift register chain can follow
+        shiftSsp->CR0 = 7 | (3 << 8);
+        shiftSsp->CPSR = 2;
+        shiftSsp->CR1 = 2;  // master mode, enabled
+
+        return true;
+    }
+#endif
+
+    pinMode(dataPin, OUTPUT);
+    pinMode(clockPin, OUTPUT);
+    return false;
+}
+
+void shiftOutBlock(int dataPin, int clockPin, BitOrder bitOrder,
+    const byte* data, int count)
+{
+    if (shiftSsp && dataPin == shiftDataPin && clockPin == shiftClockPin)
+    {
+        while (count-- > 0)
+        {
+            byte value = *data++;
+            shiftSspByte(bitOrder == LSBFIRST ? reverseBits(value) : value);
+        }
+
+        while (shiftSsp->SR & SSP_SR_BSY)
+            ;
+        while (shiftSsp->SR & SSP_SR_RNE)
+            shiftSsp->DR;
+        return;
+    }
+
+    while (count-- > 0)
+        shiftOut(dataPin, clockPin, bitOrder, *data++);
+}
+
 byte shiftIn(int dataPin, int clockPin, BitOrder bitOrder)
 {
     int value = 0;
@@ -31,6 +154,18 @@ void shiftOut(int dataPin, int clockPin, BitOrder bitOrder, byte val)
 {
     int i, value = val;
 
+    if (shiftSsp && dataPin == shiftDataPin && clockPin == shiftClockPin)
+    {
+        shiftSspByte(bitOrder == LSBFIRST ? reverseBits(val) : val);
+
+        // Wait for the last bit so a latch pin can be pulsed right away
+        while (shiftSsp->SR & SSP_SR_BSY)
+            ;
+        while (shiftSsp->SR & SSP_SR_RNE)
+            shiftSsp->DR;
+        return;
+    }
+
     for (i = 0; i < 8; i++)
     {
         if (bitOrder == LSBFIRST)
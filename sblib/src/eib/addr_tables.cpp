@@ -15,11 +15,43 @@
 #include <sblib/internal/functions.h>
 #include <sblib/bits.h>
 
+// Sorted index over the address table: the indexes of the group address
+// entries, ordered by their address. Allows binary searching indexOfAddr().
+static byte addrIndexSorted[ADDR_INDEX_SIZE];
+static volatile int addrIndexCount;
+
+byte assocIndexSorted[ASSOC_INDEX_SIZE];
+volatile int assocIndexCount;
+
+// Per com-object index of the group address that the object sends to: the
+// address table index of the object's first association, 0 if none.
+static byte sendAddrIndex[SEND_ADDR_INDEX_SIZE];
+static volatile bool sendAddrIndexValid;
+
 int indexOfAddr(int addr)
 {
     byte* tab = addrTable();
     int num = *tab;
 
+    if (addrIndexCount)  // Binary search through the sorted index
+    {
+        int lo = 0;
+        int hi = addrIndexCount - 1;
+
+        while (lo <= hi)
+        {
+            int mid = (lo + hi) >> 1;
+            const byte* entry = tab + 1 + (addrIndexSorted[mid] << 1);
+            int entryAddr = loadBE16(entry);
+
+            if (entryAddr < addr) lo = mid + 1;
+            else if (entryAddr > addr) hi = mid - 1;
+            else return addrIndexSorted[mid];
+        }
+
+        return -1;
+    }
+
     int addrHigh = addr >> 8;
     int addrLow = addr & 255;
 
@@ -33,6 +65,111 @@ int indexOfAddr(int addr)
     return -1;
 }
 
+byte groupAddrFilter[32];
+
+void updateGroupAddrFilter()
+{
+    byte* tab = addrTable();
+    byte* assocTab = assocTable();
+    int num = *tab;
+    int numAssoc = *assocTab;
+    int i, j;
+
+    // Disable the indexes while rebuilding, so that concurrent lookups from
+    // the bus interrupt handler fall back to the linear scan.
+    addrIndexCount = 0;
+    assocIndexCount = 0;
+    sendAddrIndexValid = false;
+
+    for (i = 0; i < 32; ++i)
+        groupAddrFilter[i] = 0;
+
+    tab += 3;
+    for (i = 1; i <= num; ++i, tab += 2)
+    {
+        int hash = tab[0] ^ tab[1];
+        groupAddrFilter[hash >> 3] |= 1 << (hash & 7);
+    }
+
+    // Build the sorted index over the address table, by insertion sort
+    tab = addrTable();
+    if (num <= ADDR_INDEX_SIZE)
+    {
+        for (i = 1; i <= num; ++i)
+        {
+            const byte* entry = tab + 1 + (i << 1);
+            int addr = loadBE16(entry);
+
+            for (j = i - 1; j > 0; --j)
+            {
+                const byte* other = tab + 1 + (addrIndexSorted[j - 1] << 1);
+                if (loadBE16(other) <= addr)
+                    break;
+                addrIndexSorted[j] = addrIndexSorted[j - 1];
+            }
+            addrIndexSorted[j] = i;
+        }
+        addrIndexCount = num;
+    }
+
+    // Build the sorted index over the association table. The sort is stable,
+    // so associations of the same address keep their table order.
+    if (numAssoc <= ASSOC_INDEX_SIZE)
+    {
+        for (i = 0; i < numAssoc; ++i)
+        {
+            int key = assocTab[1 + (i << 1)];
+
+            for (j = i; j > 0; --j)
+            {
+                if (assocTab[1 + (assocIndexSorted[j - 1] << 1)] <= key)
+                    break;
+                assocIndexSorted[j] = assocIndexSorted[j - 1];
+            }
+            assocIndexSorted[j] = i;
+        }
+        assocIndexCount = numAssoc;
+    }
+
+    // Build the per-object sending address index: the first association of
+    // each com-object, in association table order.
+    for (i = 0; i < SEND_ADDR_INDEX_SIZE; ++i)
+        sendAddrIndex[i] = 0;
+
+    for (i = 0; i < numAssoc; ++i)
+    {
+        const byte* entry = assocTab + 1 + (i << 1);
+        if (entry[1] < SEND_ADDR_INDEX_SIZE && !sendAddrIndex[entry[1]])
+            sendAddrIndex[entry[1]] = entry[0];
+    }
+    sendAddrIndexValid = true;
+}
+
+int firstAssocOfAddr(int addrIndex)
+{
+    const byte* assocTab = assocTable();
+    int lo = 0;
+    int hi = assocIndexCount - 1;
+    int found = -1;
+
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) >> 1;
+        int key = assocTab[1 + (assocIndexSorted[mid] << 1)];
+
+        if (key < addrIndex)
+            lo = mid + 1;
+        else
+        {
+            if (key == addrIndex)
+                found = mid;
+            hi = mid - 1;
+        }
+    }
+
+    return found;
+}
+
 int objectOfAddr(int addr)
 {
     int addrIndex = indexOfAddr(addr);
@@ -40,6 +177,13 @@ int objectOfAddr(int addr)
     byte* tab = assocTable();
     int num = *tab++;
 
+    if (assocIndexCount)
+    {
+        int pos = firstAssocOfAddr(addrIndex);
+        if (pos < 0) return -1;
+        return tab[(assocIndexSorted[pos] << 1) + 1];
+    }
+
     for (int i = 0; i < num; ++i, tab += 2)
     {
         if (tab[0] == addrIndex)
@@ -51,6 +195,32 @@ int objectOfAddr(int addr)
 
 int addrForSendObject(int objno)
 {
+    byte* tab = addrTable();
+
+    if (sendAddrIndexValid && objno < SEND_ADDR_INDEX_SIZE)
+    {
+        int addrIndex = sendAddrIndex[objno];
+        if (!addrIndex)
+            return 0;
+
+        const byte* entry = tab + 1 + (addrIndex << 1);
+        return loadBE16(entry);
+    }
+
+    // No index for this object: scan the association table
+    byte* assocTab = assocTable();
+    int num = *assocTab;
+
+    for (int i = 0; i < num; ++i)
+    {
+        const byte* entry = assocTab + 1 + (i << 1);
+        if (entry[1] == objno)
+        {
+            const byte* addr = tab + 1 + (entry[0] << 1);
+            return loadBE16(addr);
+        }
+    }
+
     return 0;
 }
 
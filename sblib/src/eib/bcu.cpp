@@ -15,8 +15,11 @@
 #include <sblib/eib/bus.h>
 #include <sblib/eib/addr_tables.h>
 #include <sblib/eib/com_objects.h>
+#include <sblib/eib/fw_update.h>
 #include <sblib/eib/properties.h>
 #include <sblib/eib/user_memory.h>
+#include <sblib/eib/telegram_template.h>
+#include <sblib/eib/telegram_view.h>
 
 #include <sblib/version.h>
 #include <sblib/internal/iap.h>
@@ -37,8 +40,28 @@ extern unsigned char handleMemoryRequests(int apciCmd, bool * sendTel, unsigned
 BCU bcu;
 
 extern unsigned int writeUserEepromTime;
+extern unsigned int userEepromCommitDelay;
 extern volatile unsigned int systemTime;
 
+// System time of the last memory write telegram. ETS downloads consist of
+// several connect/disconnect phases; holding the EEPROM flash commit back
+// until the whole session is over batches them into one erase/program cycle.
+static unsigned int lastMemWriteTime;
+
+// Idle gap after the last memory write telegram before the user EEPROM is
+// committed to flash (msec). A restart telegram flushes immediately.
+#define EEPROM_COMMIT_SESSION_GAP 2000
+
+// Set while a run of memory write telegrams is being received. The derived
+// tables (group address filter and index, com-object cache) are rebuilt
+// once when the run starts and once when it is over, instead of after
+// every single write telegram: a full application download consists of
+// thousands of segment writes, and the rebuild is the dominating cost
+// per telegram. Between the rebuilds the tables describe the pre-download
+// state, which is no more stale than the half-written table contents that
+// the per-telegram rebuild used to pick up.
+static bool downloadSession;
+
 
 // Default pin of the programming mode button+led
 #if defined (__LPC11XX__)
@@ -53,6 +76,8 @@ BCU::BCU()
     progPin = DEFAULT_PROG_PIN;
     progPinInv = true;
     enabled = false;
+    staggerWindow = 0;
+    staggerInterval = 0;
 }
 
 // The method begin_BCU() is renamed during compilation to indicate the BCU type.
@@ -67,12 +92,23 @@ void BCU::begin_BCU(int manufacturer, int deviceType, int version)
 #endif
 
     sendTelegram[0] = 0;
+
+    // Preformat the connection control telegram. Only the priority bits, the
+    // destination address and the command byte are patched at runtime.
     sendCtrlTelegram[0] = 0;
+    sendCtrlTelegram[5] = 0x60;
 
     connectedAddr = 0;
     connectedSeqNo = 0;
+    connectedRcvSeqNo = 0;
+    pendingAckSeqNo = 0;
+    pendingAckCount = 0;
     lastAckSeqNo = -1;
+    lastResponseSeqNo = -1;
     incConnectedSeqNo = false;
+    lastTelLen = 0;
+    lastTelTime = 0;
+    progButtonPollTime = 0;
 
     userRam.status = BCU_STATUS_LL | BCU_STATUS_TL | BCU_STATUS_AL | BCU_STATUS_USR;
     userRam.deviceControl = 0;
@@ -103,7 +139,21 @@ void BCU::begin_BCU(int manufacturer, int deviceType, int version)
     writeUserEepromTime = 0;
     enabled = true;
 
+    initMemoryRanges();
+    updateGroupAddrFilter();
+    updateObjectCache();
     bus.begin();
+
+    if (staggerWindow)
+    {
+        // Hold back the queued group telegrams; staggerReleased() seeds
+        // the hold-off on the first loop() pass, after the application
+        // setup has set the final physical address
+        staggerNext = 0;
+        staggerInterval = staggerWindow / 32 + 1;
+    }
+    else staggerInterval = 0;
+
     progButtonDebouncer.init(1);
 }
 
@@ -139,27 +189,35 @@ void BCU::loop()
         return;
 
 #ifdef DUMP_TELEGRAMS
-	{
-    	extern unsigned char telBuffer[];
-    	extern unsigned int telLength ;
-    	if (telLength > 0)
-    	{
-            serial.print("RX: ");
-            for (int i = 0; i < telLength; ++i)
-            {
-                if (i) serial.print(" ");
-                serial.print(telBuffer[i], HEX, 2);
-            }
-            serial.println();
-            telLength = 0;
-    	}
-	}
+    // Drain the binary trace ring that the bus code fills; the slow hex
+    // formatting happens here, outside of the time critical context
+    while (telTraceHead != telTraceTail)
+    {
+        TelTraceRecord& rec = telTrace[telTraceHead];
+
+        serial.print(rec.time, DEC);
+        serial.print(rec.direction ? " TX:" : " RX:");
+        for (int i = 0; i < rec.length; ++i)
+        {
+            serial.print(" ");
+            serial.print(rec.data[i], HEX, 2);
+        }
+        serial.println();
+
+        telTraceHead = (telTraceHead + 1) & (TEL_TRACE_RECORDS - 1);
+    }
+    if (telTraceDropped)
+    {
+        serial.print("trace dropped: ");
+        serial.println(telTraceDropped, DEC);
+        telTraceDropped = 0;
+    }
 #endif
 
     if (bus.telegramReceived() && !bus.sendingTelegram() && (userRam.status & BCU_STATUS_TL))
         bcu.processTelegram();
 
-    if (!bus.sendingTelegram())
+    if (!bus.sendingTelegram() && staggerReleased())
         sendNextGroupTelegram();
 #if 1
     // Send a disconnect after 6 seconds inactivity
@@ -170,8 +228,15 @@ void BCU::loop()
     }
 #endif
 
-    if (bcu.progPin)
+    // Sample the programming mode button at most once per millisecond. The
+    // debouncer works in that granularity anyway, and the main loop of fast
+    // polling devices runs far more often than that. The button shares its
+    // pin with the programming mode LED, so sampling switches the pin to
+    // input and back - too expensive for every loop pass.
+    if (bcu.progPin && progButtonPollTime != systemTime)
     {
+        progButtonPollTime = systemTime;
+
         // Detect the falling edge of pressing the prog button
         pinMode(bcu.progPin, INPUT|PULL_UP);
         int oldValue = progButtonDebouncer.value();
@@ -183,15 +248,57 @@ void BCU::loop()
         digitalWrite(bcu.progPin, (userRam.status & BCU_STATUS_PROG)^progPinInv);
     }
 
-    if (userEeprom.isModified() && bus.idle() && bus.telegramLen == 0 && connectedAddr == 0)
+    // Run at most one pending asynchronous flash step per loop pass, placed
+    // into a bus idle gap so the blocking IAP call does not overlap a
+    // telegram reception
+    if (iapAsyncBusy() && bus.idle() && bus.telegramLen == 0)
+        iapAsyncStep();
+
+    // End of a memory download run: rebuild the derived tables from the
+    // final table contents
+    if (downloadSession
+        && (connectedAddr == 0 || elapsed(lastMemWriteTime) > EEPROM_COMMIT_SESSION_GAP))
+    {
+        downloadSession = false;
+        updateGroupAddrFilter();
+        updateObjectCache();
+    }
+
+    if (userEeprom.isModified() && bus.idle() && bus.telegramLen == 0 && connectedAddr == 0
+        && elapsed(lastMemWriteTime) > EEPROM_COMMIT_SESSION_GAP)
     {
         if (writeUserEepromTime)
         {
             if (millis() - writeUserEepromTime > 0)
                 writeUserEeprom();
         }
-        else writeUserEepromTime = millis() + 50;
+        else writeUserEepromTime = millis() + userEepromCommitDelay;
+    }
+}
+
+bool BCU::staggerReleased()
+{
+    if (!staggerInterval)
+        return true;
+
+    if (!staggerNext)
+    {
+        // Spread the restart traffic of the line: the hold-off is seeded
+        // from the physical address, so every device picks its own slot
+        // of the window
+        staggerNext = millis() + (bus.ownAddress() * 2654435761u) % staggerWindow;
+        return false;
     }
+
+    if ((int) (millis() - staggerNext) < 0)
+        return false;
+
+    // Release one group telegram and re-arm the gate with a halving gap,
+    // so the queued startup telegrams ramp up to full rate instead of
+    // going out in one burst
+    staggerNext = millis() + staggerInterval;
+    staggerInterval >>= 1;
+    return true;
 }
 
 void BCU::sendConControlTelegram(int cmd, int senderSeqNo)
@@ -199,11 +306,10 @@ void BCU::sendConControlTelegram(int cmd, int senderSeqNo)
     if (cmd & 0x40)  // Add the sequence number if the command shall contain it
         cmd |= senderSeqNo & 0x3c;
 
+    // The rest of the telegram is preformatted: bytes 1+2 contain the sender
+    // address, which is set by bus.sendTelegram(), bytes 3-5 are patched when
+    // the connection is opened.
     sendCtrlTelegram[0] = 0xb0 | (bus.telegram[0] & 0x0c); // Control byte
-    // 1+2 contain the sender address, which is set by bus.sendTelegram()
-    sendCtrlTelegram[3] = connectedAddr >> 8;
-    sendCtrlTelegram[4] = connectedAddr;
-    sendCtrlTelegram[5] = 0x60;
     sendCtrlTelegram[6] = cmd;
 
     bus.sendTelegram(sendCtrlTelegram, 7);
@@ -211,9 +317,34 @@ void BCU::sendConControlTelegram(int cmd, int senderSeqNo)
 
 void BCU::processTelegram()
 {
-    unsigned short destAddr = (bus.telegram[3] << 8) | bus.telegram[4];
-    unsigned char tpci = bus.telegram[6] & 0xc3; // Transport control field (see KNX 3/3/4 p.6 TPDU)
-    unsigned short apci = ((bus.telegram[6] & 3) << 8) | bus.telegram[7];
+#ifdef BUS_RX_LATENCY
+    // Measure how long the telegram sat in the receive ring
+    bus.recordRxLatency();
+#endif
+
+    // Suppress duplicates: if this is a repeated telegram that matches the
+    // last processed one, our ACK for the original probably got corrupted.
+    // Skip the application layer processing so e.g. dimmers do not step twice.
+    // The compare covers byte 1 up to the end of the payload, as given by
+    // the length field: byte 0 holds the repeat flag and the checksum
+    // behind the payload changes with it.
+    int telLen = 7 + (bus.telegram[5] & 15);
+    if (!(bus.telegram[0] & SB_TEL_REPEAT_FLAG)
+        && lastTelLen == telLen && elapsed(lastTelTime) < 500
+        && memcmp(lastTel, bus.telegram + 1, telLen - 1) == 0)
+    {
+        bus.discardReceivedTelegram();
+        return;
+    }
+    lastTelLen = telLen;
+    lastTelTime = millis();
+    memcpy(lastTel, bus.telegram + 1, telLen - 1);
+
+    // Decode the protocol fields of the received telegram once
+    TelegramView tel(bus.telegram);
+    unsigned short destAddr = tel.receiver();
+    unsigned char tpci = tel.tpci(); // Transport control field (see KNX 3/3/4 p.6 TPDU)
+    unsigned short apci = tel.apci();
 
     if (destAddr == 0) // a broadcast
     {
@@ -221,7 +352,7 @@ void BCU::processTelegram()
         {
             if (apci == APCI_INDIVIDUAL_ADDRESS_WRITE_PDU)
             {
-                setOwnAddress((bus.telegram[8] << 8) | bus.telegram[9]);
+                setOwnAddress(loadBE16(bus.telegram + 8));
             }
             else if (apci == APCI_INDIVIDUAL_ADDRESS_READ_PDU)
             {
@@ -236,7 +367,7 @@ void BCU::processTelegram()
             }
         }
     }
-    else if ((bus.telegram[5] & 0x80) == 0) // a physical destination address
+    else if (!tel.isGroupAddress()) // a physical destination address
     {
         if (destAddr == bus.ownAddr) // it's our physical address
         {
@@ -257,17 +388,44 @@ void BCU::processTelegram()
 
     // At the end: discard the received telegram
     bus.discardReceivedTelegram();
+
+    // Flush deferred transport layer ACKs when the window is full or no
+    // further telegram is waiting to be processed
+    if (pendingAckCount
+        && (pendingAckCount >= BCU_TL_WINDOW || !bus.telegramReceived()))
+    {
+        sendConControlTelegram(T_ACK_PDU, pendingAckSeqNo);
+        pendingAckCount = 0;
+    }
 }
 
+//
+// The constant frame parts of the response telegrams, from byte 5 (the
+// length byte) on. Collected here so the frame layouts are auditable in
+// one place; the handlers apply a template and patch only the variable
+// fields. The connection control frame is preformatted in
+// sendCtrlTelegram, see begin_BCU().
+//
+static const TelegramTemplate adcResponse = { 2, { 0x64, 0x41 } };
+static const TelegramTemplate memoryResponse = { 3, { 0x63, 0x42, 0x40 } };
+static const TelegramTemplate deviceDescriptorResponse = { 3, { 0x63, 0x43, 0x40 } };
+static const TelegramTemplate authorizeResponse = { 4, { 0x62, 0x43, 0xd2, 0x00 } };
+#if BCU_TYPE != BCU1_TYPE && !defined(SBLIB_NO_PROPERTIES)
+static const TelegramTemplate propertyValueResponse =
+    { 3, { 0x65, 0x40 | (APCI_PROPERTY_VALUE_RESPONSE_PDU >> 8),
+           APCI_PROPERTY_VALUE_RESPONSE_PDU & 0xff } };
+static const TelegramTemplate propertyDescResponse =
+    { 3, { 0x68, 0x64 | (APCI_PROPERTY_DESCRIPTION_RESPONSE_PDU >> 8),
+           APCI_PROPERTY_DESCRIPTION_RESPONSE_PDU & 0xff } };
+#endif
+
 bool BCU::processDeviceDescriptorReadTelegram(int id)
 {
     if (id == 0)
     {
         int version = maskVersion();
 
-        sendTelegram[5] = 0x63;
-        sendTelegram[6] = 0x43;
-        sendTelegram[7] = 0x40;
+        deviceDescriptorResponse.apply(sendTelegram);
         sendTelegram[8] = version >> 8;
         sendTelegram[9] = version;
         return true;
@@ -318,46 +476,238 @@ static void cpyFromUserRam(unsigned int address, unsigned char * buffer, unsigne
 	}
 }
 
+//
+// The read/write handlers of the built-in address ranges of the memory
+// telegram dispatch table, see BCU::initMemoryRanges().
+//
+
+static void readUserRamRange(int address, byte* data, int count)
+{
+    cpyFromUserRam(address, data, count);
+}
+
+static void writeUserRamRange(int address, byte* data, int count)
+{
+    cpyToUserRam(address, data, count);
+}
+
+static void readUserEepromRange(int address, byte* data, int count)
+{
+    memcpy(data, userEepromData + (address - USER_EEPROM_START), count);
+}
+
+static void writeUserEepromRange(int address, byte* data, int count)
+{
+    memcpy(userEepromData + (address - USER_EEPROM_START), data, count);
+    userEeprom.modified(address - USER_EEPROM_START, count);
+    lastMemWriteTime = systemTime;
+
+    if (!downloadSession)
+    {
+        // First write of a run: rebuild the derived tables once.
+        // The final rebuild happens when the session is over.
+        downloadSession = true;
+        updateGroupAddrFilter();  // the write may have changed the address table
+        updateObjectCache();      // ... or the com-object config table
+    }
+}
+
+#ifdef LOAD_STATE_ADDR
+static void readLoadStateRange(int address, byte* data, int count)
+{
+    memcpy(data, userEeprom.loadState + (address - LOAD_STATE_ADDR), count);
+}
+#endif
+
+void BCU::readFwUpdateRange(int address, byte* data, int count)
+{
+    bcu.firmwareUpdate->readMem(address, data, count);
+}
+
+void BCU::writeFwUpdateRange(int address, byte* data, int count)
+{
+    bcu.firmwareUpdate->writeMem(address, data, count);
+}
+
+void BCU::initMemoryRanges()
+{
+    memRangeCount = 0;
+
+    addMemoryRange(USER_RAM_START, USER_RAM_END - 1,
+        readUserRamRange, writeUserRamRange);
+    addMemoryRange(USER_EEPROM_START, USER_EEPROM_END - 1,
+        readUserEepromRange, writeUserEepromRange);
+#ifdef LOAD_STATE_ADDR
+    addMemoryRange(LOAD_STATE_ADDR, LOAD_STATE_ADDR + 7,
+        readLoadStateRange, 0);
+#endif
+
+    if (firmwareUpdate && firmwareUpdate->windowStart())
+    {
+        addMemoryRange(firmwareUpdate->windowStart(),
+            firmwareUpdate->windowEnd() - 1,
+            readFwUpdateRange, writeFwUpdateRange);
+    }
+}
+
+bool BCU::addMemoryRange(int start, int end,
+    void (*readFn)(int address, byte* data, int count),
+    void (*writeFn)(int address, byte* data, int count))
+{
+    if (memRangeCount >= BCU_MEM_RANGES || start > end)
+        return false;
+
+    // Find the insert position that keeps the table sorted by start address
+    int pos = 0;
+    while (pos < memRangeCount && memRanges[pos].start < start)
+        ++pos;
+
+    // Reject a range that overlaps one of its sorted neighbours
+    if (pos > 0 && memRanges[pos - 1].end >= start)
+        return false;
+    if (pos < memRangeCount && memRanges[pos].start <= end)
+        return false;
+
+    for (int idx = memRangeCount; idx > pos; --idx)
+        memRanges[idx] = memRanges[idx - 1];
+
+    memRanges[pos].start = start;
+    memRanges[pos].end = end;
+    memRanges[pos].read = readFn;
+    memRanges[pos].write = writeFn;
+    ++memRangeCount;
+
+    return true;
+}
+
+const MemoryRange* BCU::findMemoryRange(int address) const
+{
+    int lo = 0;
+    int hi = memRangeCount - 1;
+
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) >> 1;
+
+        if (address < memRanges[mid].start)
+            hi = mid - 1;
+        else if (address > memRanges[mid].end)
+            lo = mid + 1;
+        else return memRanges + mid;
+    }
+
+    return 0;
+}
+
+void BCU::setFirmwareUpdate(FirmwareUpdate *updater)
+{
+    firmwareUpdate = updater;
+    initMemoryRanges();
+}
+
+
+// Handlers for the APCI dispatch table below
+enum ApciHandler
+{
+    HANDLER_NONE,                  //!< command not supported: reply with T_NACK
+    HANDLER_ADC_READ,              //!< APCI_ADC_READ_PDU
+    HANDLER_MEMORY,                //!< APCI_MEMORY_READ_PDU / APCI_MEMORY_WRITE_PDU
+    HANDLER_DEVICEDESCRIPTOR_READ, //!< APCI_DEVICEDESCRIPTOR_READ_PDU
+    HANDLER_RESTART,               //!< APCI_RESTART_PDU / APCI_RESTART_TYPE1_PDU
+    HANDLER_EXTENDED               //!< commands that use all 10 APCI bits (0x3c0 page)
+};
+
+// Flags for the APCI dispatch table below
+#define APCI_CONNECTED 0x40  //!< the command requires an open direct connection
+#define APCI_RESPONSE  0x80  //!< the handler always replies with a response telegram
+
+// Dispatch table for directed telegrams, indexed by the upper 4 bits of the
+// (10 bit) APCI value. A single table lookup replaces the cascaded switch
+// statements, so resolving a command stays O(1) when handlers are added.
+static const byte apciDispatchTab[16] =
+{
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x000 group value read
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x040 group value response
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x080 group value write
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x0c0 individual address write
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x100 individual address read
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x140 individual address response
+    HANDLER_ADC_READ | APCI_CONNECTED | APCI_RESPONSE,  // 0x180 ADC read
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x1c0 ADC response
+    HANDLER_MEMORY | APCI_CONNECTED,                    // 0x200 memory read
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x240 memory response
+    HANDLER_MEMORY | APCI_CONNECTED,                    // 0x280 memory write
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x2c0 unused
+    HANDLER_DEVICEDESCRIPTOR_READ | APCI_CONNECTED | APCI_RESPONSE, // 0x300
+    HANDLER_NONE | APCI_CONNECTED,                      // 0x340 device descriptor response
+    HANDLER_RESTART | APCI_CONNECTED,                   // 0x380 restart
+    HANDLER_EXTENDED | APCI_CONNECTED                   // 0x3c0 authorize, properties
+};
+
 void BCU::processDirectTelegram(int apci)
 {
-    const int senderAddr = (bus.telegram[1] << 8) | bus.telegram[2];
-    const int senderSeqNo = bus.telegram[6] & 0x3c;
+    const TelegramView tel(bus.telegram);
+    const int senderAddr = tel.sender();
+    const int senderSeqNo = tel.seqNo();
     int count, address, index;
+    const MemoryRange* memRange;
 #if BCU_TYPE != BCU1_TYPE
     bool found;
     int id;
 #endif
     unsigned char sendAck = 0;
-    bool sendTel = false;
 
-    if (connectedAddr != senderAddr) // ensure that the sender is correct
-        return;
+    const byte disp = apciDispatchTab[apci >> 6];
+    bool sendTel = (disp & APCI_RESPONSE) != 0;
+
+    if ((disp & APCI_CONNECTED) && connectedAddr != senderAddr)
+        return; // ensure that the sender is correct
 
     connectedTime = systemTime;
     sendTelegram[6] = 0;
 
+    if (tel.numbered())  // A numbered data telegram
+    {
+        if (senderSeqNo == ((connectedRcvSeqNo - 4) & 0x3c))
+        {
+            // A repeat of the last accepted telegram: our T_ACK or our
+            // response got lost. Acknowledge it again but do not process it
+            // twice. If the telegram was answered with a response, re-queue
+            // the cached response frame instead of recomputing it.
+            sendConControlTelegram(T_ACK_PDU, senderSeqNo);
+            if (lastResponseSeqNo == senderSeqNo)
+            {
+                memcpy(sendTelegram, lastResponse, telegramSize(lastResponse));
+                bus.sendTelegram(sendTelegram, telegramSize(sendTelegram));
+            }
+            return;
+        }
+        connectedRcvSeqNo = (senderSeqNo + 4) & 0x3c;
+    }
+
     int apciCmd = apci & APCI_GROUP_MASK;
-    switch (apciCmd)  // ADC / memory commands use the low bits for data
+    switch (disp & 0x3f)  // ADC / memory commands use the low APCI bits for data
     {
-    case APCI_ADC_READ_PDU:
+    case HANDLER_ADC_READ:
         index = bus.telegram[7] & 0x3f;  // ADC channel
         count = bus.telegram[8];         // number of samples
-        sendTelegram[5] = 0x64;
-        sendTelegram[6] = 0x41;
+        adcResponse.apply(sendTelegram);
         sendTelegram[7] = 0xc0 | (index & 0x3f);   // channel
         sendTelegram[8] = count;                   // read count
         sendTelegram[9] = 0;                       // FIXME dummy - ADC value high byte
         sendTelegram[10] = 0;                      // FIXME dummy - ADC value low byte
-        sendTel = true;
         break;
 
-    case APCI_MEMORY_READ_PDU:
-    case APCI_MEMORY_WRITE_PDU:
+    case HANDLER_MEMORY:
 #ifdef APP_HANDLES_MEMORY_REQUESTS
     	sendAck = handleMemoryRequests(apciCmd, &sendTel, & bus.telegram[7]);
 #else
         count = bus.telegram[7] & 0x0f; // number of data byes
-        address = (bus.telegram[8] << 8) | bus.telegram[9]; // address of the data block
+        address = loadBE16(bus.telegram + 8); // address of the data block
+
+        // Resolve the address to its registered range once, by binary
+        // search - a write with auto-response reuses the result for the read
+        memRange = findMemoryRange(address);
 
         if (apciCmd == APCI_MEMORY_WRITE_PDU)
         {
@@ -371,18 +721,19 @@ void BCU::processDirectTelegram(int apci)
             }
             serial.println("");
 #endif
-            if(memMapper && memMapper->isMapped(address))
+            if (memRange)
             {
-                memMapper->writeMemPtr(address, bus.telegram + 10, count);
+                if (memRange->write)
+                    memRange->write(address, bus.telegram + 10, count);
             }
-
-            if (address >= USER_EEPROM_START && address < USER_EEPROM_END)
+#ifndef SBLIB_NO_MEMMAPPER
+            else if (memMapper && memMapper->isMapped(address))
             {
-                memcpy(userEepromData + (address - USER_EEPROM_START), bus.telegram + 10, count);
-                userEeprom.modified();
+                // The mapper allocates its virtual pages anywhere in the
+                // address space, so it is the fallback behind the table
+                memMapper->writeMemPtr(address, bus.telegram + 10, count);
             }
-            else if (address >= USER_RAM_START && address < USER_RAM_END)
-            	cpyToUserRam(address - USER_RAM_START, bus.telegram + 10, count);
+#endif
 
             sendAck = T_ACK_PDU;
 
@@ -403,19 +754,17 @@ void BCU::processDirectTelegram(int apci)
 
         if (apciCmd == APCI_MEMORY_READ_PDU)
         {
-            if (address >= USER_EEPROM_START && address < USER_EEPROM_END) {
-                  memcpy(sendTelegram + 10, userEepromData + (address - USER_EEPROM_START), count);
+            if (memRange)
+            {
+                if (memRange->read)
+                    memRange->read(address, sendTelegram + 10, count);
             }
-            else if (address >= USER_RAM_START && address < USER_RAM_END)
-            	cpyFromUserRam(address - USER_RAM_START, sendTelegram + 10, count);
-#ifdef LOAD_STATE_ADDR
-            else if (address >= LOAD_STATE_ADDR && address < LOAD_STATE_ADDR + 8)
-                memcpy(sendTelegram + 10, userEeprom.loadState + (address - LOAD_STATE_ADDR), count);
-#endif
-            if(memMapper && memMapper->isMapped(address))
+#ifndef SBLIB_NO_MEMMAPPER
+            else if (memMapper && memMapper->isMapped(address))
             {
                 memMapper->readMemPtr(address, sendTelegram + 10, count);
             }
+#endif
 #ifdef DUMP_MEM_OPS
             serial.print("readMem: ");
             serial.print(address, HEX, 4);
@@ -426,27 +775,29 @@ void BCU::processDirectTelegram(int apci)
             }
             serial.println("");
 #endif
-            sendTelegram[5] = 0x63 + count;
-            sendTelegram[6] = 0x42;
-            sendTelegram[7] = 0x40 | count;
-            sendTelegram[8] = address >> 8;
-            sendTelegram[9] = address;
+            memoryResponse.apply(sendTelegram);
+            sendTelegram[5] += count;
+            sendTelegram[7] |= count;
+            storeBE16(sendTelegram + 8, address);
             sendTel = true;
         }
 #endif
         break;
 
-    case APCI_DEVICEDESCRIPTOR_READ_PDU:
-        if (processDeviceDescriptorReadTelegram(apci & 0x3f))
-            sendTel = true;
-        else sendAck = T_NACK_PDU;
+    case HANDLER_DEVICEDESCRIPTOR_READ:
+        if (!processDeviceDescriptorReadTelegram(apci & 0x3f))
+        {
+            sendTel = false;
+            sendAck = T_NACK_PDU;
+        }
         break;
 
-    default:
-        switch (apci)
-        {
-        case APCI_RESTART_PDU:
-        case APCI_RESTART_TYPE1_PDU:
+    case HANDLER_RESTART:
+            if (apci != APCI_RESTART_PDU && apci != APCI_RESTART_TYPE1_PDU)
+            {
+                sendAck = T_NACK_PDU;  // Command not supported
+                break;
+            }
 			if(apci&1)
 			{
 				unsigned int erase   = bus.telegram[8];
@@ -459,27 +810,27 @@ void BCU::processDirectTelegram(int apci)
 				}
 			}
 			writeUserEeprom();   // Flush the EEPROM before resetting
+#ifndef SBLIB_NO_MEMMAPPER
 			if(memMapper)
 			{
 				memMapper->doFlash();
 			}
+#endif
 			NVIC_SystemReset();  // Software Reset
             break;
 
+    case HANDLER_EXTENDED:
+        switch (apci)
+        {
         case APCI_AUTHORIZE_REQUEST_PDU:
-            sendTelegram[5] = 0x62;
-            sendTelegram[6] = 0x43;
-            sendTelegram[7] = 0xd2;
-            sendTelegram[8] = 0x00;
+            authorizeResponse.apply(sendTelegram);
             sendTel = true;
             break;
 
-#if BCU_TYPE != BCU1_TYPE
+#if BCU_TYPE != BCU1_TYPE && !defined(SBLIB_NO_PROPERTIES)
         case APCI_PROPERTY_VALUE_READ_PDU:
         case APCI_PROPERTY_VALUE_WRITE_PDU:
-            sendTelegram[5] = 0x65;
-            sendTelegram[6] = 0x40 | (APCI_PROPERTY_VALUE_RESPONSE_PDU >> 8);
-            sendTelegram[7] = APCI_PROPERTY_VALUE_RESPONSE_PDU & 0xff;
+            propertyValueResponse.apply(sendTelegram);
             index = sendTelegram[8] = bus.telegram[8];
             id = sendTelegram[9] = bus.telegram[9];
             count = (sendTelegram[10] = bus.telegram[10]) >> 4;
@@ -493,28 +844,39 @@ void BCU::processDirectTelegram(int apci)
             break;
 
         case APCI_PROPERTY_DESCRIPTION_READ_PDU:
-            sendTelegram[5] = 0x68;
-            sendTelegram[6] = 0x64 | (APCI_PROPERTY_DESCRIPTION_RESPONSE_PDU >> 8);
-            sendTelegram[7] = APCI_PROPERTY_DESCRIPTION_RESPONSE_PDU & 0xff;
+            propertyDescResponse.apply(sendTelegram);
             index = sendTelegram[8] = bus.telegram[8];
             id = sendTelegram[9] = bus.telegram[9];
             address = (sendTelegram[10] = bus.telegram[10]);
             propertyDescReadTelegram(index, (PropertyID) id, address);
             sendTel = true;
             break;
-#endif /*BCU_TYPE != BCU1_TYPE*/
+#endif /*BCU_TYPE != BCU1_TYPE && !SBLIB_NO_PROPERTIES*/
 
         default:
             sendAck = T_NACK_PDU;  // Command not supported
             break;
         }
         break;
+
+    default:
+        sendAck = T_NACK_PDU;  // Command not supported
+        break;
     }
 
     if (sendTel)
         sendAck = T_ACK_PDU;
 
-    if (sendAck)
+    if (sendAck == T_ACK_PDU && !sendTel && tel.numbered())
+    {
+        // Defer the T_ACK so pipelined senders get one cumulative ACK per
+        // window instead of one per telegram. The ACK is flushed in
+        // processTelegram() when the receive queue runs empty, so a
+        // stop-and-wait sender still gets its ACK immediately.
+        pendingAckSeqNo = senderSeqNo;
+        ++pendingAckCount;
+    }
+    else if (sendAck)
         sendConControlTelegram(sendAck, senderSeqNo);
     else sendCtrlTelegram[0] = 0;
 
@@ -522,8 +884,7 @@ void BCU::processDirectTelegram(int apci)
     {
         sendTelegram[0] = 0xb0 | (bus.telegram[0] & 0x0c); // Control byte
         // 1+2 contain the sender address, which is set by bus.sendTelegram()
-        sendTelegram[3] = connectedAddr >> 8;
-        sendTelegram[4] = connectedAddr;
+        storeBE16(sendTelegram + 3, connectedAddr);
 
         if (sendTelegram[6] & 0x40) // Add the sequence number if applicable
         {
@@ -533,13 +894,27 @@ void BCU::processDirectTelegram(int apci)
         }
         else incConnectedSeqNo = false;
 
+        if (tel.numbered())
+        {
+            // Keep a copy of the response: a retransmit of the request is
+            // answered from this cache, see above
+            lastResponseSeqNo = senderSeqNo;
+            memcpy(lastResponse, sendTelegram, telegramSize(sendTelegram));
+        }
+
         bus.sendTelegram(sendTelegram, telegramSize(sendTelegram));
     }
+    else if (tel.numbered())
+    {
+        // The telegram produced no response: the sequence numbers wrap, so
+        // an older cached response must not be replayed for this one
+        lastResponseSeqNo = -1;
+    }
 }
 
 void BCU::processConControlTelegram(int tpci)
 {
-    int senderAddr = (bus.telegram[1] << 8) | bus.telegram[2];
+    int senderAddr = TelegramView(bus.telegram).sender();
 
     if (tpci & 0x40)  // An acknowledgement
     {
@@ -574,7 +949,14 @@ void BCU::processConControlTelegram(int tpci)
             {
                 connectedTime = systemTime;
                 connectedAddr = senderAddr;
+
+                // Patch the destination of the preformatted control telegram
+                storeBE16(sendCtrlTelegram + 3, connectedAddr);
+
                 connectedSeqNo = 0;
+                connectedRcvSeqNo = 0;
+                lastResponseSeqNo = -1;
+                pendingAckCount = 0;
                 incConnectedSeqNo = false;
                 bus.sendAck = 0;
             }
@@ -584,6 +966,7 @@ void BCU::processConControlTelegram(int tpci)
             if (connectedAddr == senderAddr)
             {
                 connectedAddr = 0;
+                pendingAckCount = 0;
                 bus.sendAck = 0;
             }
         }
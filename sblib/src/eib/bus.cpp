@@ -10,12 +10,19 @@
 
 #include <sblib/eib/bus.h>
 
+#include <sblib/event.h>
+
 #include <sblib/core.h>
 #include <sblib/interrupt.h>
 #include <sblib/platform.h>
 #include <sblib/eib/addr_tables.h>
 #include <sblib/eib/user_memory.h>
 #include <sblib/eib/properties.h>
+#include <sblib/hot_table.h>
+#include <sblib/static_timer.h>
+#include <sblib/trace.h>
+
+#include <string.h>
 
 // The EIB bus access object
 #if defined (__LPC11XX__)
@@ -28,6 +35,12 @@ Bus bus(timer16_1, PIO0_20, PIO0_21, CAP0, MAT0);
 // The interrupt handler for the EIB bus access object
 BUS_TIMER_INTERRUPT_HANDLER(TIMER16_1_IRQHandler, bus);
 
+// The bus timer, bound at compile time. The interrupt handler and its
+// helpers access the timer through this facade: direct register accesses
+// instead of fetching the timer base pointer on every call. begin()
+// checks that the timer of the constructor is this timer.
+typedef StaticTimer<TIMER16_1> BusTimer;
+
 
 /*
  * The timer16_1 is used as follows:
@@ -43,8 +56,21 @@ BUS_TIMER_INTERRUPT_HANDLER(TIMER16_1_IRQHandler, bus);
 #define D(x)
 
 
-// Telegram repeat flag in byte #0 of the telegram: 1=not repeated, 0=repeated
-#define SB_TEL_REPEAT_FLAG 0x20
+// Queue rank per KNX priority field value (control byte bits 3..2):
+// 0=system, 2=alarm, 1=high, 3=low
+static const byte busPrioRank[4] = { 0, 2, 1, 3 };
+
+// Parity lookup table: busParityTab[x] is 1 if x has an odd number of one
+// bits. Used instead of computing the parity bit-by-bit in the interrupt
+// handler.
+#define PT2(n) n, n^1, n^1, n
+#define PT4(n) PT2(n), PT2(n^1), PT2(n^1), PT2(n)
+#define PT6(n) PT4(n), PT4(n^1), PT4(n^1), PT4(n)
+static const byte busParityTab[256] HOT_TABLE = { PT6(0), PT6(1), PT6(1), PT6(0) };
+HOT_TABLE_BUDGET_CHECK(busParityTab);
+#undef PT2
+#undef PT4
+#undef PT6
 
 static int debugLine = 0;
 
@@ -78,6 +104,17 @@ static int debugLine = 0;
 // The value for the prescaler
 #define TIMER_PRESCALER (SystemCoreClock / 1000000 - 1)
 
+/*
+ * Convert an inter telegram gap from bit times to usec, clamped so the
+ * pre-send listening window always fits and the usec value stays 16 bit.
+ */
+static unsigned short gapTime(int bitTimes)
+{
+    if (bitTimes < 2) bitTimes = 2;
+    if (bitTimes > 600) bitTimes = 600;
+    return bitTimes * BIT_TIME;
+}
+
 
 Bus::Bus(Timer& aTimer, int aRxPin, int aTxPin, TimerCapture aCaptureChannel, TimerMatch aPwmChannel)
 :timer(aTimer)
@@ -88,7 +125,72 @@ Bus::Bus(Timer& aTimer, int aRxPin, int aTxPin, TimerCapture aCaptureChannel, Ti
 {
     timeChannel = (TimerMatch) ((pwmChannel + 2) & 3);  // +2 to be compatible to old code during refactoring
     state = Bus::IDLE;
+    sendCurOwner = 0;
+    rxDropped = false;
+#ifndef SBLIB_NO_BUS_MONITOR
+    monFrames = 0;
+    monCount = 0;
+    monHead = 0;
+    monTail = 0;
+#endif
+}
+
+#if !defined(SBLIB_NO_BUS_MONITOR) || defined(DUMP_TELEGRAMS)
+// Microsecond timestamp from the monotonic microsecond clock
+static unsigned int monitorTimestamp()
+{
+    return (unsigned int) micros64();
 }
+#endif
+
+#ifndef SBLIB_NO_BUS_MONITOR
+void Bus::monitorBegin(BusMonFrame* frames, int count)
+{
+    monHead = 0;
+    monTail = 0;
+    monCount = count;
+    monFrames = frames;
+}
+
+void Bus::monitorEnd()
+{
+    monFrames = 0;
+}
+
+bool Bus::monitorRead(BusMonFrame& frame)
+{
+    if (!monFrames || monTail == monHead)
+        return false;
+
+    frame = monFrames[monTail];
+
+    int next = monTail + 1;
+    if (next == monCount) next = 0;
+    monTail = next;
+
+    return true;
+}
+
+void Bus::captureMonitorFrame(bool valid)
+{
+    int next = monHead + 1;
+    if (next == monCount) next = 0;
+    if (next == monTail)  // Ring full: the frame is lost
+        return;
+
+    BusMonFrame& frame = monFrames[monHead];
+    frame.time = monitorTimestamp();
+    frame.length = nextByteIndex < SB_TELEGRAM_SIZE ? nextByteIndex : SB_TELEGRAM_SIZE;
+    frame.flags = 0;
+    if (valid) frame.flags |= BUS_MON_FRAME_VALID;
+    if (collision) frame.flags |= BUS_MON_FRAME_COLLISION;
+
+    for (int i = 0; i < frame.length; ++i)
+        frame.data[i] = rxTelegram[i];
+
+    monHead = next;
+}
+#endif /*!SBLIB_NO_BUS_MONITOR*/
 
 void Bus::begin()
 {
@@ -101,19 +203,46 @@ void Bus::begin()
     }
 #endif
     telegramLen = 0;
+    rxHead = 0;
+    rxTail = 0;
+    for (int i = 0; i < BUS_RX_BUFFER_COUNT; ++i)
+        rxLen[i] = 0;
+    telegram = rxBuffer[0];
+    rxTelegram = rxBuffer[0];
 
     state = Bus::IDLE;
     sendAck = 0;
     sendCurTelegram = 0;
-    sendNextTel = 0;
+    sendCurOwner = 0;
+    sendQueueCount = 0;
+    for (int i = 0; i < BUS_TX_POOL_SIZE; ++i)
+        txPoolBusy[i] = 0;
     sendTriesMax = 4;
+    gapFreeBus = SEND_WAIT_TIME;
+    gapAfterAck = SEND_WAIT_TIME;
+    gapAfterNack = SEND_WAIT_TIME;
+    gapAfterBusy = 3 * SEND_WAIT_TIME;  // 150 bit times, the BUSY backoff
     collision = false;
+    clearStatistics();
+#ifdef BUS_ISR_LATENCY
+    clearLatencyStatistics();
+#endif
+#ifdef BUS_RX_LATENCY
+    clearRxLatencyStatistics();
+#endif
+
+    // The interrupt handler is bound to the bus timer at compile time
+    if (timer.interruptNumber() != BusTimer::interruptNumber())
+        fatalError();
 
     timer.begin();
     timer.pwmEnable(pwmChannel);
     timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
     timer.start();
     timer.interrupts();
+    // The bus ISR runs exclusively at the highest priority so no other
+    // interrupt can stretch it past the bit timing, see interrupt.h
+    timer.interruptPriority(ISR_PRIO_BUS);
     timer.prescaler(TIMER_PRESCALER);
 
     timer.match(timeChannel, 0xfffe);
@@ -153,11 +282,11 @@ void Bus::begin()
 
 void Bus::idleState()
 {
-    timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+    BusTimer::captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
 
-    timer.matchMode(timeChannel, RESET);
-    timer.match(timeChannel, 0xfffe);
-    timer.match(pwmChannel, 0xffff);
+    BusTimer::matchMode(timeChannel, RESET);
+    BusTimer::match(timeChannel, 0xfffe);
+    BusTimer::match(pwmChannel, 0xffff);
 
     state = Bus::IDLE;
     sendAck = 0;
@@ -167,92 +296,329 @@ void Bus::idleState()
 }
 
 #ifdef DUMP_TELEGRAMS
-unsigned char telBuffer[32];
-unsigned int telLength = 0;
+TelTraceRecord telTrace[TEL_TRACE_RECORDS];
+volatile int telTraceHead;
+volatile int telTraceTail;
+volatile unsigned int telTraceDropped;
+
+void traceTelegram(int direction, const byte* data, int length)
+{
+    int next = (telTraceTail + 1) & (TEL_TRACE_RECORDS - 1);
+    if (next == telTraceHead)
+    {
+        ++telTraceDropped; // the ring is full
+        return;
+    }
+
+    TelTraceRecord& rec = telTrace[telTraceTail];
+    rec.time = monitorTimestamp();
+    rec.direction = direction;
+    if (length > (int) sizeof(rec.data)) length = sizeof(rec.data);
+    rec.length = length;
+    memcpy(rec.data, data, length);
+
+    telTraceTail = next;
+}
+#endif
+// Decide while the telegram is still being received whether it is addressed
+// to us and shall be acknowledged. Called from the interrupt handler as soon
+// as the destination address and the flags byte have arrived, so that the
+// acknowledge is pre-armed the moment the last byte closes instead of doing
+// the address lookup in the tight ACK turnaround window.
+// Early destination pre-filter, called the moment the destination address
+// word is complete. The common case on a commissioning-heavy line is a
+// unicast for another device: if the word matches neither our physical
+// address nor the group address filter, the telegram cannot be for us no
+// matter what the address type flag says, and the remaining bytes skip the
+// parity, checksum and buffer work. Broadcasts (address 0) always pass,
+// and the monitor modes keep every telegram.
+void Bus::earlyAddressFilter()
+{
+    int destAddr = (rxTelegram[3] << 8) | rxTelegram[4];
+
+    if (destAddr == 0 || destAddr == ownAddr || filterGroupAddr(destAddr))
+        return;
+
+    if (!(userRam.status & BCU_STATUS_TL))
+        return;
+
+#ifndef SBLIB_NO_BUS_MONITOR
+    if (monFrames)
+        return;
 #endif
+
+    rxDropped = true;
+}
+
+void Bus::prepareAck()
+{
+    int destAddr = (rxTelegram[3] << 8) | rxTelegram[4];
+
+    preProcessTel = false;
+
+    // We ACK the telegram only if it's for us. The filter bitmap drops
+    // non-matching group telegrams without scanning the address table.
+    if (rxTelegram[5] & 0x80)
+    {
+        if (destAddr == 0
+            || (filterGroupAddr(destAddr) && indexOfAddr(destAddr) >= 0))
+            preProcessTel = true;
+    }
+    else if (destAddr == ownAddr)
+    {
+        preProcessTel = true;
+    }
+}
+
 void Bus::handleTelegram(bool valid)
 {
 //    D(digitalWrite(PIO1_4, 1));         // purple: end of telegram
     sendAck = 0;
 
+    // The pause before our own next transmission, see setInterFrameGaps()
+    unsigned int gap = gapFreeBus;
+
+#ifndef SBLIB_NO_BUS_MONITOR
+    if (monFrames && nextByteIndex > 0)
+        captureMonitorFrame(valid);
+#endif
+
     if (collision) // A collision occurred. Ignore the received bytes
     {
     }
+    else if (rxDropped) // Pre-filtered: the telegram is for another device
+    {
+        ++stats.rxFiltered;
+        TRACE_COUNT(TRACE_RX_FILTERED);
+    }
     else if (nextByteIndex >= 8 && valid) // Received a valid telegram with correct checksum
     {
 #ifdef DUMP_TELEGRAMS
-    	memcpy(telBuffer, bus.telegram, nextByteIndex);
-    	telLength = nextByteIndex;
+        traceTelegram(0, rxTelegram, nextByteIndex);
 #endif
-        int destAddr = (telegram[3] << 8) | telegram[4];
-        bool processTel = false;
+        bool storeTel = false;
 
-        // We ACK the telegram only if it's for us
-        if (telegram[5] & 0x80)
-        {
-            if (destAddr == 0 || indexOfAddr(destAddr) >= 0)
-                processTel = true;
-        }
-        else if (destAddr == ownAddr)
-        {
-            processTel = true;
-        }
+        ++stats.rxTelegrams;
+        TRACE_COUNT(TRACE_RX_TELEGRAM);
+
+        // The ACK decision was already made in prepareAck() while the
+        // telegram was still being received.
 
         // Only process the telegram if it is for us or if we want to get all telegrams
         if (!(userRam.status & BCU_STATUS_TL))
         {
-            telegramLen = nextByteIndex;
+            storeTel = true;
 
             if (userRam.status & BCU_STATUS_LL)
                 sendAck = SB_BUS_ACK;
         }
-        else if (processTel)
+        else if (preProcessTel)
         {
-            telegramLen = nextByteIndex;
-            sendAck = SB_BUS_ACK;
+            if (rxTelegram == rxOverflow)
+            {
+                // The receive ring is full: answer with BUSY so that the
+                // sender backs off and repeats later, as the spec intends,
+                // instead of dropping the telegram and getting hammered
+                // with immediate repeats.
+                sendAck = SB_BUS_BUSY;
+                ++stats.rxOverruns;
+                TRACE_COUNT(TRACE_QUEUE_FULL);
+            }
+            else
+            {
+                storeTel = true;
+                sendAck = SB_BUS_ACK;
+            }
+        }
+
+        if (storeTel)
+        {
+            // Store the telegram in the receive ring. Without the transport
+            // layer the ring can still overflow; the telegram is dropped
+            // here and the sender will repeat it.
+            if (rxTelegram != rxOverflow)
+            {
+#ifdef BUS_RX_LATENCY
+                rxTime[rxHead] = (unsigned int) micros64();
+#endif
+                rxLen[rxHead] = nextByteIndex;
+                if (++rxHead == BUS_RX_BUFFER_COUNT)
+                    rxHead = 0;
+
+                if (!telegramLen && rxLen[rxTail] > 0)
+                {
+                    // Publish the telegram if none is pending
+                    telegram = rxBuffer[rxTail];
+                    telegramLen = rxLen[rxTail];
+                }
+
+                eventSet(EVENT_BUS_RX);
+            }
+            else
+            {
+                ++stats.rxOverruns;
+                TRACE_COUNT(TRACE_QUEUE_FULL);
+            }
         }
     }
     else if (nextByteIndex == 1)   // Received a spike or a bus acknowledgment
     {
         currentByte &= 0xff;
 
+        if (sendCurTelegram && sendTries > 0)
+        {
+            if (currentByte == SB_BUS_NACK)
+            {
+                ++stats.nackAcks;
+                gap = gapAfterNack;
+            }
+            else if (currentByte == SB_BUS_BUSY || currentByte == SB_BUS_NACK_BUSY)
+            {
+                ++stats.busyAcks;
+                gap = gapAfterBusy;
+            }
+            else if (currentByte == SB_BUS_ACK)
+                gap = gapAfterAck;
+        }
+
         if ((currentByte == SB_BUS_ACK || sendTries > sendTriesMax) && sendCurTelegram && sendTries > 0)
             sendNextTelegram();
     }
     else // Received wrong checksum, or more than one byte but too short for a telegram
     {
-        telegramLen = 0;
+        ++stats.checksumErrors;
         sendAck = SB_BUS_NACK;
     }
 
     // Wait before sending. In SEND_INIT we will cancel if there is nothing to be sent.
     // We need to wait anyways to avoid triggering sending from the application code when
     // the bus is in cooldown. This could happen if we set state to Bus::IDLE here.
-    timer.match(timeChannel, sendAck ? SEND_ACK_WAIT_TIME - PRE_SEND_TIME : SEND_WAIT_TIME - PRE_SEND_TIME);
-    timer.matchMode(timeChannel, INTERRUPT | RESET);
+    BusTimer::match(timeChannel, sendAck ? SEND_ACK_WAIT_TIME - PRE_SEND_TIME : gap - PRE_SEND_TIME);
+    BusTimer::matchMode(timeChannel, INTERRUPT | RESET);
 
-    timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+    BusTimer::captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
 
     collision = false;
     state = Bus::SEND_INIT;
     debugLine = __LINE__;
 }
 
+void Bus::setInterFrameGaps(int freeBus, int afterAck, int afterNack,
+    int afterBusy)
+{
+    // Keep room for the pre-send listening window, and within the 16 bit
+    // usec range of the gap members
+    gapFreeBus = gapTime(freeBus);
+    gapAfterAck = gapTime(afterAck);
+    gapAfterNack = gapTime(afterNack);
+    gapAfterBusy = gapTime(afterBusy);
+}
+
 void Bus::sendNextTelegram()
 {
+    ++stats.txTelegrams;
     sendCurTelegram[0] = 0;
-    sendCurTelegram = sendNextTel;
-    sendNextTel = 0;
+
+    if (sendCurOwner)  // Return a forwarded buffer to its receive ring
+    {
+        sendCurOwner->releaseForwardedBuffer((byte*) sendCurTelegram);
+        sendCurOwner = 0;
+    }
+
+    sendCurTelegram = 0;
+
+    if (sendQueueCount)  // Fetch the highest priority queued telegram
+    {
+        sendCurTelegram = sendQueue[0];
+        sendCurOwner = sendQueueOwner[0];
+        --sendQueueCount;
+
+        for (int i = 0; i < sendQueueCount; ++i)
+        {
+            sendQueue[i] = sendQueue[i + 1];
+            sendQueueOwner[i] = sendQueueOwner[i + 1];
+        }
+    }
+
     sendTries = 0;
     sendTelegramLen = 0;
+
+    eventSet(EVENT_BUS_TX);
 }
 
-void Bus::timerInterruptHandler()
+void Bus::clearStatistics()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+#ifdef BUS_ISR_LATENCY
+void Bus::clearLatencyStatistics()
+{
+    memset(&latency, 0, sizeof(latency));
+    latency.min = ~0;
+}
+#endif
+
+#ifdef BUS_RX_LATENCY
+void Bus::recordRxLatency()
+{
+    if (!telegramLen || rxLen[rxTail] <= 0)
+        return;  // no published ring telegram to measure
+
+    unsigned int lat = (unsigned int) micros64() - rxTime[rxTail];
+
+    ++rxLatency.samples;
+    if (lat < rxLatency.min) rxLatency.min = lat;
+    if (lat > rxLatency.max) rxLatency.max = lat;
+
+    unsigned int bin = 0;
+    while (lat > 1 && bin < BUS_LATENCY_BINS - 1)
+    {
+        lat >>= 1;
+        ++bin;
+    }
+    ++rxLatency.bins[bin];
+}
+
+void Bus::clearRxLatencyStatistics()
+{
+    memset(&rxLatency, 0, sizeof(rxLatency));
+    rxLatency.min = ~0;
+}
+#endif
+
+SBLIB_RAM_FUNC void Bus::timerInterruptHandler()
 {
     D(static unsigned short tick = 0);
     bool timeout;
     int time;
 
+#ifdef BUS_ISR_LATENCY
+    // The time between the capture event and this read is the interrupt
+    // latency: what flash waits, other interrupts or disabled interrupt
+    // windows delayed the handler by
+    if (BusTimer::flag(captureChannel))
+    {
+        unsigned int lat = BusTimer::value() - BusTimer::capture(captureChannel);
+
+        // Skip the sample if the timer was restarted in between
+        if ((int) lat >= 0)
+        {
+            ++latency.samples;
+            if (lat < latency.min) latency.min = lat;
+            if (lat > latency.max) latency.max = lat;
+
+            unsigned int bin = 0;
+            while (lat > 1 && bin < BUS_LATENCY_BINS - 1)
+            {
+                lat >>= 1;
+                ++bin;
+            }
+            ++latency.bins[bin];
+        }
+    }
+#endif
+
     // Debug output
     D(digitalWrite(PIO0_6, ++tick & 1));  // brown: interrupt tick
     D(digitalWrite(PIO3_0, state==Bus::SEND_BIT_0)); // red
@@ -262,46 +628,75 @@ void Bus::timerInterruptHandler()
     //D(digitalWrite(PIO2_8, 0));           // blue
 //    D(digitalWrite(PIO2_9, 0));           //
 
-STATE_SWITCH:
-    switch (state)
+    // Constant-time state dispatch: an indexed load and branch (~5 cycles on
+    // Cortex-M0) instead of the compare chain a switch generates, which costs
+    // more cycles the higher the state number. The table is indexed by the
+    // State enum and must match its order.
+    //
+    // Approximate worst-case cycles per state at -Os on Cortex-M0 (without
+    // flash wait states, the handler runs from RAM):
+    //   IDLE            ~35  start of reception, buffer setup
+    //   RECV_START      ~45  arm the byte timeout
+    //   RECV_BYTE       ~110 end of byte: parity check, store, ACK decision
+    //   SEND_INIT       ~95  transmission setup incl. repeat marking
+    //   SEND_START_BIT  ~40  start bit collision check
+    //   SEND_BIT_0      ~25  fetch byte, add parity
+    //   SEND_BIT        ~85  find next zero bit, arm PWM match
+    //   SEND_BIT_WAIT   ~30  collision check
+    //   SEND_WAIT       ~25  ACK window check
+    //   SEND_END        ~30  arm inter-telegram wait
+    static const void* const stateJump[] =
     {
+        &&S_IDLE, &&S_RECV_BYTE, &&S_RECV_START, &&S_SEND_INIT,
+        &&S_SEND_START_BIT, &&S_SEND_BIT_0, &&S_SEND_BIT,
+        &&S_SEND_BIT_WAIT, &&S_SEND_WAIT, &&S_SEND_END
+    };
+
+STATE_SWITCH:
+    goto *stateJump[state];
+
     // The bus is idle. Usually we come here when there is a capture event on bus-in.
-    case Bus::IDLE:
-        if (!timer.flag(captureChannel)) // Not a bus-in signal: do nothing
-            break;
+S_IDLE:
+        if (!BusTimer::flag(captureChannel)) // Not a bus-in signal: do nothing
+            goto STATE_END;
         nextByteIndex = 0;
         collision = false;
         checksum = 0xff;
         sendAck = 0;
         valid = 1;
+        preProcessTel = false;
+        rxDropped = false;
+        // Receive into the next free ring buffer. If the ring is full (or
+        // the slot is lent to another bus), use the overflow buffer so no
+        // pending telegram gets overwritten; the frame is then dropped.
+        rxTelegram = rxLen[rxHead] == 0 ? rxBuffer[rxHead] : rxOverflow;
         // no break here
 
     // A start bit is expected to arrive here. If we have a timeout instead, the
     // transmission is over.
-    case Bus::RECV_START:
+S_RECV_START:
         //D(digitalWrite(PIO3_1, 1));   // orange
-        if (!timer.flag(captureChannel))  // No start bit: then it is a timeout
+        if (!BusTimer::flag(captureChannel))  // No start bit: then it is a timeout
         {
             handleTelegram(valid && !checksum);
-            break;
+            goto STATE_END;
         }
 
-        timer.match(timeChannel, BYTE_TIME);
-        timer.restart();
-        timer.matchMode(timeChannel, INTERRUPT | RESET);
+        BusTimer::match(timeChannel, BYTE_TIME);
+        BusTimer::restart();
+        BusTimer::matchMode(timeChannel, INTERRUPT | RESET);
 
         state = Bus::RECV_BYTE;
         currentByte = 0;
         bitTime = 0;
         bitMask = 1;
-        parity = 1;
-        break;
+        goto STATE_END;
 
-    case Bus::RECV_BYTE:
-        timeout = timer.flag(timeChannel);
+S_RECV_BYTE:
+        timeout = BusTimer::flag(timeChannel);
 
         if (timeout) time = BYTE_TIME;
-        else time = timer.capture(captureChannel);
+        else time = BusTimer::capture(captureChannel);
 
         if (time >= bitTime + BIT_WAIT_TIME)
         {
@@ -309,7 +704,6 @@ STATE_SWITCH:
             while (time >= bitTime + BIT_WAIT_TIME && bitMask <= 0x100)
             {
                 currentByte |= bitMask;
-                parity = !parity;
 
                 bitTime += BIT_TIME;
                 bitMask <<= 1;
@@ -321,26 +715,43 @@ STATE_SWITCH:
         if (timeout)  // Timer timeout: end of byte
         {
             D(digitalWrite(PIO1_5, 1));     // yellow: end of byte
-            D(digitalWrite(PIO3_1, parity));// orange: parity bit ok
 
-            valid &= parity;
-            if (nextByteIndex < SB_TELEGRAM_SIZE)
+            if (rxDropped)
             {
-                telegram[nextByteIndex++] = currentByte;
-                checksum ^= currentByte;
+                // Pre-filtered: just count the byte, the telegram is
+                // for another device
+                if (nextByteIndex < SB_TELEGRAM_SIZE)
+                    ++nextByteIndex;
+            }
+            else
+            {
+                // The received parity bit (bit 8) must match the data parity
+                valid &= busParityTab[currentByte & 0xff] == (currentByte >> 8);
+                if (nextByteIndex < SB_TELEGRAM_SIZE)
+                {
+                    rxTelegram[nextByteIndex++] = currentByte;
+                    checksum ^= currentByte;
+
+                    // The destination address is in: filter early
+                    if (nextByteIndex == 5)
+                        earlyAddressFilter();
+                    // Destination address and flags are in: decide the ACK now
+                    else if (nextByteIndex == 6)
+                        prepareAck();
+                }
             }
 
             state = Bus::RECV_START;   // wait for the next byte's start bit
-            timer.match(timeChannel, BIT_TIME * 4);
+            BusTimer::match(timeChannel, BIT_TIME * 4);
         }
-        break;
+        goto STATE_END;
 
     // SEND_INIT is entered some usec before sending the start bit of the first byte. It
     // is always entered after receiving or sending is done, even if nothing is to be sent.
-    case Bus::SEND_INIT:
+S_SEND_INIT:
         D(digitalWrite(PIO1_5, 1)); // yellow: prepare transmission
 
-        if (timer.flag(captureChannel))  // Bus input, enter receive mode
+        if (BusTimer::flag(captureChannel))  // Bus input, enter receive mode
         {
             state = Bus::IDLE;
             goto STATE_SWITCH;
@@ -358,6 +769,12 @@ STATE_SWITCH:
 
             if (sendCurTelegram)  // Send a telegram?
             {
+                if (sendTries > 0)
+                {
+                    ++stats.repeats;
+                    TRACE_COUNT(TRACE_TX_RETRY);
+                }
+
                 time = PRE_SEND_TIME + ((sendCurTelegram[0] >> 2) & 3) * BIT_TIME;
                 sendTelegramLen = telegramSize(sendCurTelegram) + 1;
 
@@ -375,39 +792,42 @@ STATE_SWITCH:
             else  // Send nothing
             {
                 idleState();
-                break;
+                goto STATE_END;
             }
         }
 
-        timer.match(pwmChannel, time);
-        timer.match(timeChannel, time + BIT_PULSE_TIME);
-        timer.matchMode(timeChannel, RESET | INTERRUPT);
-        timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+        BusTimer::match(pwmChannel, time);
+        BusTimer::match(timeChannel, time + BIT_PULSE_TIME);
+        BusTimer::matchMode(timeChannel, RESET | INTERRUPT);
+        BusTimer::captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
 
         nextByteIndex = 0;
         state = Bus::SEND_START_BIT;
-        break;
+        goto STATE_END;
 
     // The start bit of the first byte is being sent. We should come here when the flank
     // of the start bit is captured by bus-in. We might come here when somebody else started
     // sending before us, or if a timeout occurred. In case of a timeout, we have a hardware
     // problem as receiving our sent signal does not work.
-    case Bus::SEND_START_BIT:
-        if (timer.flag(captureChannel))
+S_SEND_START_BIT:
+        if (BusTimer::flag(captureChannel))
         {
             // Abort sending if we receive a start bit early enough to abort.
             // We will receive our own start bit here too.
-            if (timer.value() < timer.match(pwmChannel) - 10)
+            if (BusTimer::value() < BusTimer::match(pwmChannel) - 10)
             {
-                timer.match(pwmChannel, 0xffff);
-                state = Bus::RECV_START;
+                BusTimer::match(pwmChannel, 0xffff);
+                // Enter via IDLE, not RECV_START: IDLE initializes the
+                // receiver state (checksum, valid, receive buffer) that
+                // would otherwise be stale from the last reception
+                state = Bus::IDLE;
                 goto STATE_SWITCH;
             }
 
             state = Bus::SEND_BIT_0;
-            break;
+            goto STATE_END;
         }
-        else if (timer.flag(timeChannel))
+        else if (BusTimer::flag(timeChannel))
         {
             // Timeout: we have a hardware problem as receiving our sent signal does not work.
             // for now we will just continue
@@ -415,22 +835,18 @@ STATE_SWITCH:
         }
         // No break here
 
-    case Bus::SEND_BIT_0:
+S_SEND_BIT_0:
         if (sendAck)
             currentByte = sendAck;
         else currentByte = sendCurTelegram[nextByteIndex++];
 
-        // Calculate the parity bit
-        for (bitMask = 1; bitMask < 0x100; bitMask <<= 1)
-        {
-            if (currentByte & bitMask)
-                currentByte ^= 0x100;
-        }
+        // Add the parity bit from the lookup table
+        currentByte |= busParityTab[currentByte] << 8;
 
         bitMask = 1;
         // no break here
 
-    case Bus::SEND_BIT:
+S_SEND_BIT:
         D(digitalWrite(PIO1_5, 1));    // yellow: send next bits
 
         // Search for the next zero bit and count the one bits for the wait time
@@ -461,58 +877,57 @@ STATE_SWITCH:
         }
 
         if (state == Bus::SEND_BIT_WAIT)
-            timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
-        else timer.captureMode(captureChannel, FALLING_EDGE);
+            BusTimer::captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+        else BusTimer::captureMode(captureChannel, FALLING_EDGE);
 
         if (state == Bus::SEND_END)
-            timer.match(pwmChannel, 0xffff);
-        else timer.match(pwmChannel, time - BIT_PULSE_TIME);
+            BusTimer::match(pwmChannel, 0xffff);
+        else BusTimer::match(pwmChannel, time - BIT_PULSE_TIME);
 
-        timer.match(timeChannel, time);
-        break;
+        BusTimer::match(timeChannel, time);
+        goto STATE_END;
 
     // Wait for a capture event from bus-in. This should be from us sending a zero bit, but it
     // might as well be from somebody else in case of a collision.
-    case Bus::SEND_BIT_WAIT:
-        if (timer.capture(captureChannel) < timer.match(pwmChannel) - BIT_WAIT_TIME)
+S_SEND_BIT_WAIT:
+        if (BusTimer::capture(captureChannel) < BusTimer::match(pwmChannel) - BIT_WAIT_TIME)
         {
             // A collision. Stop sending and ignore the current transmission.
             D(digitalWrite(PIO1_4, 1));  // purple
-            timer.match(pwmChannel, 0xffff);
+            BusTimer::match(pwmChannel, 0xffff);
             state = Bus::RECV_BYTE;
             collision = true;
-            break;
+            ++stats.collisions;
+            goto STATE_END;
         }
         state = Bus::SEND_BIT;
-        break;
+        goto STATE_END;
 
-    case Bus::SEND_END:
+S_SEND_END:
         //D(digitalWrite(PIO2_9, 1));
-        timer.match(timeChannel, SEND_WAIT_TIME);
-        timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+        // The fallback gap when no ACK arrives; the ACK re-arms the wait
+        // in handleTelegram() with the state-aware gap
+        BusTimer::match(timeChannel, gapFreeBus);
+        BusTimer::captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
 
         if (sendAck) sendAck = 0;
         else ++sendTries;
 
         state = Bus::SEND_WAIT;
-        break;
+        goto STATE_END;
 
     // Wait for ACK or resend / send next telegram
-    case Bus::SEND_WAIT:
-        if (timer.flag(captureChannel) && timer.capture(captureChannel) < SEND_ACK_WAIT_TIME)
+S_SEND_WAIT:
+        if (BusTimer::flag(captureChannel) && BusTimer::capture(captureChannel) < SEND_ACK_WAIT_TIME)
         {
             // Ignore bits that arrive too early
-            break;
+            goto STATE_END;
         }
         state = Bus::SEND_INIT;  // Receiving will be handled there too
         goto STATE_SWITCH;
 
-    default:
-        idleState();
-        break;
-    }
-
-    timer.resetFlags();
+STATE_END:
+    BusTimer::resetFlags();
 }
 
 /**
@@ -550,27 +965,169 @@ void Bus::sendTelegram(unsigned char* telegram, unsigned short length)
     prepareTelegram(telegram, length);
 
 #ifdef DUMP_TELEGRAMS
-	{
-        serial.print("TX: ");
-        for (int i = 0; i <= length; ++i)
+    {
+        // the bus interrupt appends to the same ring
+        InterruptLock lock(timer.interruptNumber());
+        traceTelegram(1, telegram, length + 1);
+    }
+#endif
+    enqueueTelegram(telegram, 0);
+}
+
+void Bus::sendPreparedTelegram(unsigned char* telegram, Bus* owner)
+{
+    enqueueTelegram(telegram, owner);
+}
+
+byte* Bus::acquireTelegram()
+{
+    // The pool is shared with our ISR, which returns sent buffers
+    InterruptLock lock(timer.interruptNumber());
+
+    for (int i = 0; i < BUS_TX_POOL_SIZE; ++i)
+    {
+        if (!txPoolBusy[i])
         {
-            if (i) serial.print(" ");
-            serial.print(telegram[i], HEX, 2);
+            txPoolBusy[i] = 1;
+            return txPool[i];
         }
-        serial.println();
-	}
-#endif
+    }
+    return 0;
+}
+
+void Bus::queueTelegram(byte* telegram, unsigned short length)
+{
+    prepareTelegram(telegram, length);
+
+    // Queue with ourself as the owner, so the buffer is returned to the
+    // pool by sendNextTelegram() when sending is done.
+    enqueueTelegram(telegram, this);
+}
+
+bool Bus::updateQueuedTelegram(byte* telegram, int destAddr, const byte* data, int offset, int count)
+{
+    bool found = false;
+
+    // The queue is shared with our ISR, which pops sent telegrams
+    InterruptLock lock(timer.interruptNumber());
+
+    for (int i = 0; i < sendQueueCount; ++i)
+    {
+        if (sendQueue[i] != telegram)
+            continue;
+
+        if (telegram[3] == (byte) (destAddr >> 8) && telegram[4] == (byte) destAddr)
+        {
+            byte checksum = 0xff;
+            int length = telegramSize(telegram);
+
+            memcpy(telegram + offset, data, count);
+
+            for (int idx = 0; idx < length; ++idx)
+                checksum ^= telegram[idx];
+            telegram[length] = checksum;
+
+            found = true;
+        }
+        break;
+    }
+
+    return found;
+}
+
+bool Bus::forwardReceivedTelegram(Bus& dest)
+{
+    byte* tel;
+
+    {
+        // The receive ring is shared with our ISR
+        InterruptLock lock(timer.interruptNumber());
+
+        if (!telegramLen || rxLen[rxTail] <= 0)
+        {
+            // No received telegram, or it was not received from the bus
+            // (e.g. injected by a test) and cannot be lent out.
+            return false;
+        }
+
+        tel = rxBuffer[rxTail];
+        rxLen[rxTail] = -1;  // The slot is lent out until the destination sent it
+        telegramLen = 0;
+
+        if (++rxTail == BUS_RX_BUFFER_COUNT)
+            rxTail = 0;
+
+        if (rxLen[rxTail] > 0)  // Publish the next pending telegram, if any
+        {
+            telegram = rxBuffer[rxTail];
+            telegramLen = rxLen[rxTail];
+        }
+    }
+
+    dest.sendPreparedTelegram(tel, this);
+    return true;
+}
+
+void Bus::releaseForwardedBuffer(byte* telegram)
+{
+    int i;
+
+    for (i = 0; i < BUS_TX_POOL_SIZE; ++i)
+    {
+        if (txPool[i] == telegram)
+        {
+            txPoolBusy[i] = 0;
+            return;
+        }
+    }
+
+    for (i = 0; i < BUS_RX_BUFFER_COUNT; ++i)
+    {
+        if (rxBuffer[i] == telegram)
+        {
+            rxLen[i] = 0;
+            return;
+        }
+    }
+}
+
+void Bus::enqueueTelegram(unsigned char* telegram, Bus* owner)
+{
     // Wait until there is space in the sending queue
-    while (sendNextTel)
+    while (sendQueueCount >= BUS_TX_QUEUE_SIZE)
     {
     }
 
-    if (!sendCurTelegram) sendCurTelegram = telegram;
-    else if (!sendNextTel) sendNextTel = telegram;
-    else fatalError();   // soft fault: send buffer overflow
+    // The queue and the send state are shared with our ISR
+    InterruptLock lock(timer.interruptNumber());
+
+    if (!sendCurTelegram)
+    {
+        sendCurTelegram = telegram;
+        sendCurOwner = owner;
+    }
+    else
+    {
+        // Insert the telegram into the queue, ordered by the KNX priority
+        // of the control byte: system, alarm, high, low.
+        int rank = busPrioRank[(telegram[0] >> 2) & 3];
+        int pos = sendQueueCount;
+
+        while (pos > 0 && busPrioRank[(sendQueue[pos - 1][0] >> 2) & 3] > rank)
+            --pos;
+
+        for (int i = sendQueueCount; i > pos; --i)
+        {
+            sendQueue[i] = sendQueue[i - 1];
+            sendQueueOwner[i] = sendQueueOwner[i - 1];
+        }
+
+        sendQueue[pos] = telegram;
+        sendQueueOwner[pos] = owner;
+        ++sendQueueCount;
+    }
 
     // Start sending if the bus is idle
-    noInterrupts();
     if (state == IDLE)
     {
         sendTries = 0;
@@ -581,5 +1138,4 @@ void Bus::sendTelegram(unsigned char* telegram, unsigned short length)
         timer.matchMode(timeChannel, INTERRUPT | RESET);
         timer.value(0);
     }
-    interrupts();
 }
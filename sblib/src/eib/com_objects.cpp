@@ -15,6 +15,8 @@
 #include <sblib/eib/property_types.h>
 #include <sblib/eib/user_memory.h>
 #include <sblib/internal/functions.h>
+#include <sblib/timeout.h>
+#include <sblib/timer.h>
 
 
 // The COMFLAG_UPDATE flag, moved to the high nibble
@@ -27,10 +29,272 @@
 // The size of the object types BIT_7...VARDATA in bytes
 const byte objectTypeSizes[10] = { 1, 1, 2, 3, 4, 6, 8, 10, 14, 15 };
 
+// One bit per com-object: set when the object may have a transmission
+// request / update flag pending. The scan loops test a whole word of
+// objects at once, so the no-work case is a few word compares. The 4 bit
+// flags table stays authoritative; a set bit is only a hint.
+// Not static: the host simulation harness swaps them per simulated node.
+#define OBJ_PENDING_WORDS 8  // 8 * 32 = 256 objects
+
+unsigned int transPendingMask[OBJ_PENDING_WORDS];
+unsigned int updatePendingMask[OBJ_PENDING_WORDS];
+
+// One bit per com-object: write telegrams of the object may be coalesced
+// (see objectCoalesce). The telegram that is waiting in the send queue for
+// a coalesced object is remembered in coalesceTel[].
+static unsigned int coalesceMask[OBJ_PENDING_WORDS];
+static byte* coalesceTel[OBJ_CACHE_SIZE];
+
+// Token bucket rate limiters for com-objects (see objectRateLimit)
+struct ObjectRateLimit
+{
+    byte objno;               //!< The rate limited com-object
+    byte rate;                //!< Tokens (telegrams) earned per second
+    byte burst;               //!< The maximum number of accumulated tokens
+    byte tokens;              //!< The currently available tokens
+    unsigned int refillTime;  //!< System time of the last token refill
+};
+
+static ObjectRateLimit rateLimits[OBJ_RATE_LIMITS];
+static int rateLimitCount;
+
+void objectRateLimit(int objno, int telPerSecond, int burst)
+{
+    int i;
+
+    for (i = 0; i < rateLimitCount; ++i)
+    {
+        if (rateLimits[i].objno == objno)
+            break;
+    }
+
+    if (telPerSecond <= 0)  // Remove the limit
+    {
+        if (i < rateLimitCount)
+            rateLimits[i] = rateLimits[--rateLimitCount];
+        return;
+    }
+
+    if (i == rateLimitCount)
+    {
+        if (rateLimitCount == OBJ_RATE_LIMITS)
+            return;  // all limiter slots are in use
+        ++rateLimitCount;
+    }
+
+    if (burst < 1)
+        burst = 1;
+
+    rateLimits[i].objno = objno;
+    rateLimits[i].rate = telPerSecond;
+    rateLimits[i].burst = burst;
+    rateLimits[i].tokens = burst;
+    rateLimits[i].refillTime = millis();
+}
+
+/*
+ * Take a send token of a rate limited com-object.
+ *
+ * @return True if the object may send now, false if its token bucket is
+ *         empty and the transmission shall stay pending.
+ */
+static bool takeRateLimitToken(int objno)
+{
+    for (int i = 0; i < rateLimitCount; ++i)
+    {
+        ObjectRateLimit& lim = rateLimits[i];
+        if (lim.objno != objno)
+            continue;
+
+        // Earn the tokens for the elapsed time, capped at the burst size
+        unsigned int earned = elapsed(lim.refillTime) * lim.rate / 1000;
+        if (earned)
+        {
+            lim.refillTime += earned * 1000 / lim.rate;
+            if (earned > (unsigned int) (lim.burst - lim.tokens))
+                lim.tokens = lim.burst;
+            else lim.tokens += earned;
+        }
+
+        if (!lim.tokens)
+            return false;
+
+        --lim.tokens;
+        return true;
+    }
+
+    return true;  // the object is not rate limited
+}
+
+// Cyclic transmission entries (see objectSendCyclic)
+struct ObjectCyclicSend
+{
+    byte objno;                //!< The cyclically sent com-object
+    bool primed;               //!< True once the staggered first send fired
+    unsigned int interval;     //!< The send interval in ms, 0: slot is free
+    ScheduledTimeout timeout;  //!< The timeout that drives the sending
+};
+
+static ObjectCyclicSend cyclicSends[OBJ_CYCLIC_SENDS];
+
+/*
+ * Fire one cyclic transmission: mark the object as written. The first,
+ * staggered timeout arms the periodic interval.
+ */
+static void cyclicSendFire(void* param)
+{
+    ObjectCyclicSend* entry = (ObjectCyclicSend*) param;
+
+    if (!entry->primed)
+    {
+        entry->primed = true;
+        entry->timeout.startPeriodic(entry->interval);
+    }
+
+    objectWritten(entry->objno);
+}
+
+void objectSendCyclic(int objno, unsigned int intervalMs)
+{
+    int slot, freeSlot = -1;
+
+    for (slot = 0; slot < OBJ_CYCLIC_SENDS; ++slot)
+    {
+        if (cyclicSends[slot].interval)
+        {
+            if (cyclicSends[slot].objno == objno)
+                break;
+        }
+        else if (freeSlot < 0)
+            freeSlot = slot;
+    }
+
+    if (slot == OBJ_CYCLIC_SENDS)  // the object has no entry yet
+    {
+        if (!intervalMs || freeSlot < 0)
+            return;  // nothing to stop, or all slots are in use
+        slot = freeSlot;
+    }
+
+    ObjectCyclicSend& entry = cyclicSends[slot];
+
+    if (!intervalMs)  // Stop the cyclic sending
+    {
+        entry.timeout.stop();
+        entry.interval = 0;
+        return;
+    }
+
+    entry.objno = objno;
+    entry.interval = intervalMs;
+    entry.primed = false;
+    entry.timeout.callback(cyclicSendFire, &entry);
+
+    // Stagger the first transmission over the interval by the slot
+    // number, so the cyclic objects of a device do not all queue in the
+    // same loop pass
+    unsigned int offset = intervalMs * (slot + 1) / OBJ_CYCLIC_SENDS;
+    if (!offset)
+        offset = slot + 1;
+    entry.timeout.start(offset);
+}
+
+// De Bruijn multiply lookup for counting trailing zeros, as the Cortex-M0
+// has no CLZ instruction
+static const byte trailingZerosTab[32] =
+{
+     0,  1, 28,  2, 29, 14, 24,  3, 30, 22, 20, 15, 25, 17,  4,  8,
+    31, 27, 13, 23, 21, 19, 16,  7, 26, 12, 18,  6, 11,  5, 10,  9
+};
+
+static inline int trailingZeros(unsigned int word)
+{
+    return trailingZerosTab[((word & -word) * 0x077cb531) >> 27];
+}
+
+int telegramObjectSize(int objno);
+
 int le_ptr = BIG_ENDIAN;
 
+// Precomputed value pointer and size per com-object, and the resolved
+// flags table pointer (see updateObjectCache). Resolving these through the
+// config table costs several indirections on every object access.
+static byte* objValuePtrCache[OBJ_CACHE_SIZE];
+static byte objSizeCache[OBJ_CACHE_SIZE];
+static volatile int objCacheCount;
+static byte* objFlagsTabCache;
+
+
+// Cache for precomposed group read responses (see enableGroupReadCache)
+static GroupReadResponse* readCache;
+static int readCacheCount;
+
+void enableGroupReadCache(GroupReadResponse* cache, int count)
+{
+    for (int i = 0; i < count; ++i)
+        cache[i].length = 0;
+
+    readCache = cache;
+    readCacheCount = count;
+}
+
+void objectCoalesce(int objno, bool enable)
+{
+    if (objno >= OBJ_CACHE_SIZE)
+        return;
+
+    if (enable)
+        coalesceMask[objno >> 5] |= 1 << (objno & 31);
+    else
+    {
+        coalesceMask[objno >> 5] &= ~(1 << (objno & 31));
+        coalesceTel[objno] = 0;
+    }
+}
+
+/*
+ * Try to patch the new value of a coalesced com-object into its write
+ * telegram that is still waiting in the send queue.
+ *
+ * @return True if the queued telegram was updated and no new transmission
+ *         is needed, false otherwise.
+ */
+static bool coalesceObjectWrite(int objno)
+{
+    if (objno >= OBJ_CACHE_SIZE || !(coalesceMask[objno >> 5] & (1 << (objno & 31))))
+        return false;
+
+    byte* tel = coalesceTel[objno];
+    if (!tel)
+        return false;
+
+    byte* valuePtr = objectValuePtr(objno);
+    int addr = addrForSendObject(objno);
+    int sz = telegramObjectSize(objno);
+
+    if (sz)
+    {
+        byte payload[14];
+        reverseCopy(payload, valuePtr, sz);
+        return bus.updateQueuedTelegram(tel, addr, payload, 8, sz);
+    }
+
+    byte small = 0x80 | (*valuePtr & 0x3f);
+    return bus.updateQueuedTelegram(tel, addr, &small, 7, 1);
+}
+
+// Invalidate the cached read response when the object's value changes
+static void invalidateGroupReadResponse(int objno)
+{
+    if (objno < readCacheCount)
+        readCache[objno].length = 0;
+}
+
 int objectSize(int objno)
 {
+    if (objno < objCacheCount)
+        return objSizeCache[objno];
+
     int type = objectType(objno);
     if (type < BIT_7) return 1;
     return objectTypeSizes[type - BIT_7];
@@ -63,6 +327,11 @@ void addObjectFlags(int objno, int flags)
     if(flagsTab == 0)
     	return;
 
+    if ((flags & COMFLAG_TRANS_MASK) == COMFLAG_TRANSREQ)
+        transPendingMask[objno >> 5] |= 1 << (objno & 31);
+    if (flags & COMFLAG_UPDATE)
+        updatePendingMask[objno >> 5] |= 1 << (objno & 31);
+
     if (objno & 1)
         flags <<= 4;
 
@@ -83,6 +352,11 @@ void setObjectFlags(int objno, int flags)
     byte* flagsPtr = objectFlagsTable();
     flagsPtr += objno >> 1;
 
+    if ((flags & COMFLAG_TRANS_MASK) == COMFLAG_TRANSREQ)
+        transPendingMask[objno >> 5] |= 1 << (objno & 31);
+    if (flags & COMFLAG_UPDATE)
+        updatePendingMask[objno >> 5] |= 1 << (objno & 31);
+
     if (objno & 1)
     {
         *flagsPtr &= 0x0f;
@@ -95,7 +369,208 @@ void setObjectFlags(int objno, int flags)
     }
 }
 
-byte* objectValuePtr(int objno)
+/*
+ * Spread an 8 bit object mask to a 32 bit nibble mask: bit N of the mask
+ * becomes nibble N, 0xf where the bit was set.
+ */
+static unsigned int spreadObjectMask(unsigned int objnoMask)
+{
+    unsigned int x = objnoMask & 0xff;
+    x = (x | (x << 12)) & 0x000f000f;
+    x = (x | (x << 6)) & 0x03030303;
+    x = (x | (x << 3)) & 0x11111111;
+    return x * 0xf;
+}
+
+/*
+ * Compress a 32 bit flags word back to an 8 bit object mask: bit N of the
+ * result is set if nibble N contains any set bit. The inverse of
+ * spreadObjectMask().
+ */
+static unsigned int compressObjectMask(unsigned int word)
+{
+    unsigned int x = word;
+    x |= x >> 2;
+    x |= x >> 1;
+    x &= 0x11111111;
+    x = (x | (x >> 3)) & 0x03030303;
+    x = (x | (x >> 6)) & 0x000f000f;
+    return (x | (x >> 12)) & 0xff;
+}
+
+/*
+ * Load the flags table bytes of a group of 8 objects as one 32 bit word.
+ * The flags table lies at an arbitrary byte offset in the user memory and
+ * the Cortex-M0 faults on unaligned word access, so the word is assembled
+ * from byte loads. Only bytes that hold selected objects are read, so a
+ * partial group at the end of the table does not read past it.
+ *
+ * @param groupPtr - the flags table byte of the first object of the group
+ * @param objnoMask - the selected objects, one bit per object
+ */
+static unsigned int loadFlagsWord(const byte* groupPtr, unsigned int objnoMask)
+{
+    unsigned int word = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (objnoMask & (3 << (i << 1)))
+            word |= (unsigned int) groupPtr[i] << (i << 3);
+    }
+    return word;
+}
+
+/*
+ * Store a 32 bit word back into the flags table bytes of a group of 8
+ * objects, see loadFlagsWord(). Only bytes that hold selected objects are
+ * written.
+ */
+static void storeFlagsWord(byte* groupPtr, unsigned int objnoMask, unsigned int word)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        if (objnoMask & (3 << (i << 1)))
+            groupPtr[i] = word >> (i << 3);
+    }
+}
+
+/*
+ * @return The number of communication objects.
+ */
+inline int objectCount()
+{
+    // The first byte of the config table contains the number of com-objects
+    return *objectConfigTable();
+}
+
+/*
+ * Clamp a group's object mask to the objects that exist, so a partial
+ * group at the end of the config table does not touch flags table bytes
+ * past the table.
+ */
+static unsigned int clampObjectMask(int firstObjno, unsigned int objnoMask)
+{
+    int numObjs = objectCount();
+
+    if (firstObjno >= numObjs)
+        return 0;
+    if (numObjs - firstObjno < 8)
+        objnoMask &= (1 << (numObjs - firstObjno)) - 1;
+    return objnoMask;
+}
+
+void addObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags)
+{
+    byte* flagsTab = objectFlagsTable();
+    objnoMask &= 0xff;
+    if (flagsTab == 0)
+        return;
+    firstObjno &= ~7;
+    objnoMask = clampObjectMask(firstObjno, objnoMask);
+    if (!objnoMask)
+        return;
+
+    if ((flags & COMFLAG_TRANS_MASK) == COMFLAG_TRANSREQ)
+        transPendingMask[firstObjno >> 5] |= objnoMask << (firstObjno & 31);
+    if (flags & COMFLAG_UPDATE)
+        updatePendingMask[firstObjno >> 5] |= objnoMask << (firstObjno & 31);
+
+    byte* groupPtr = flagsTab + (firstObjno >> 1);
+    unsigned int word = loadFlagsWord(groupPtr, objnoMask);
+    word |= spreadObjectMask(objnoMask) & ((flags & 0xf) * 0x11111111);
+    storeFlagsWord(groupPtr, objnoMask, word);
+}
+
+void clearObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags)
+{
+    byte* flagsTab = objectFlagsTable();
+    objnoMask &= 0xff;
+    if (flagsTab == 0)
+        return;
+    firstObjno &= ~7;
+    objnoMask = clampObjectMask(firstObjno, objnoMask);
+    if (!objnoMask)
+        return;
+
+    // Clearing any transmission status bit leaves the field != COMFLAG_TRANSREQ
+    if (flags & COMFLAG_TRANS_MASK)
+        transPendingMask[firstObjno >> 5] &= ~(objnoMask << (firstObjno & 31));
+    if (flags & COMFLAG_UPDATE)
+        updatePendingMask[firstObjno >> 5] &= ~(objnoMask << (firstObjno & 31));
+
+    byte* groupPtr = flagsTab + (firstObjno >> 1);
+    unsigned int word = loadFlagsWord(groupPtr, objnoMask);
+    word &= ~(spreadObjectMask(objnoMask) & ((flags & 0xf) * 0x11111111));
+    storeFlagsWord(groupPtr, objnoMask, word);
+}
+
+unsigned int testObjectFlagsMasked(int firstObjno, unsigned int objnoMask, int flags)
+{
+    byte* flagsTab = objectFlagsTable();
+    objnoMask &= 0xff;
+    if (flagsTab == 0)
+        return 0;
+    firstObjno &= ~7;
+    objnoMask = clampObjectMask(firstObjno, objnoMask);
+    if (!objnoMask)
+        return 0;
+
+    unsigned int word = loadFlagsWord(flagsTab + (firstObjno >> 1), objnoMask);
+    word &= spreadObjectMask(objnoMask) & ((flags & 0xf) * 0x11111111);
+    return compressObjectMask(word);
+}
+
+void clearTransmitFlags()
+{
+    int numObjs = objectCount();
+
+    for (int objno = 0; objno < numObjs; objno += 8)
+        clearObjectFlagsMasked(objno, 0xff, COMFLAG_TRANS_MASK);
+
+    // Also drop stale pending hints of objects past the config table,
+    // e.g. after the table was replaced by a smaller one
+    for (int i = 0; i < OBJ_PENDING_WORDS; ++i)
+        transPendingMask[i] = 0;
+}
+
+int snapshotUpdatedObjects(unsigned int* snapshot)
+{
+    byte* flagsTab = objectFlagsTable();
+    if (flagsTab == 0)
+        return 0;
+
+    int numObjs = objectCount();
+    int numWords = (numObjs + 31) >> 5;
+
+    for (int i = 0; i < numWords; ++i)
+        snapshot[i] = 0;
+
+    for (int objno = 0; objno < numObjs; objno += 8)
+    {
+        // Skip a whole group of objects if none of them is updated
+        if (!((updatePendingMask[objno >> 5] >> (objno & 31)) & 0xff))
+            continue;
+
+        unsigned int objnoMask = 0xff;
+        if (numObjs - objno < 8)
+            objnoMask = (1 << (numObjs - objno)) - 1;
+
+        unsigned int updated = testObjectFlagsMasked(objno, objnoMask, COMFLAG_UPDATE);
+        updatePendingMask[objno >> 5] &= ~(objnoMask << (objno & 31));
+        if (!updated)
+            continue;
+
+        clearObjectFlagsMasked(objno, updated, COMFLAG_UPDATE);
+        snapshot[objno >> 5] |= updated << (objno & 31);
+    }
+
+    return numWords;
+}
+
+/*
+ * Resolve the pointer to the value bytes of a com-object from the config
+ * table, ignoring the cache.
+ */
+static byte* resolveObjectValuePtr(int objno)
 {
     // The object configuration
     const ComConfig& cfg = objectConfig(objno);
@@ -115,6 +590,14 @@ byte* objectValuePtr(int objno)
 #endif
 }
 
+byte* objectValuePtr(int objno)
+{
+    if (objno < objCacheCount)
+        return objValuePtrCache[objno];
+
+    return resolveObjectValuePtr(objno);
+}
+
 unsigned int objectRead(int objno)
 {
 	int sz = objectSize(objno);
@@ -129,6 +612,25 @@ unsigned int objectRead(int objno)
     return value;
 }
 
+/*
+ * The common tail of a com-object value change: invalidate the cached
+ * read response, try to coalesce the value into an already queued
+ * telegram, and raise the object's flags otherwise. Called after the
+ * new value was stored.
+ *
+ * @param objno - the ID of the communication object
+ * @param flags - the flags to add (see addObjectFlags())
+ */
+void objectValueStored(int objno, int flags)
+{
+    invalidateGroupReadResponse(objno);
+
+    if ((flags & COMFLAG_TRANS_MASK) == COMFLAG_TRANSREQ && coalesceObjectWrite(objno))
+        return;  // the queued telegram carries the new value already
+
+    addObjectFlags(objno, flags);
+}
+
 void _objectWrite(int objno, unsigned int value, int flags)
 {
     byte* ptr = objectValuePtr(objno);
@@ -143,7 +645,7 @@ void _objectWrite(int objno, unsigned int value, int flags)
         value >>= 8;
     }
 
-    addObjectFlags(objno, flags);
+    objectValueStored(objno, flags);
 }
 
 void _objectWriteBytes(int objno, byte* value, int flags)
@@ -151,45 +653,37 @@ void _objectWriteBytes(int objno, byte* value, int flags)
     byte* ptr = objectValuePtr(objno);
     int sz = objectSize(objno);
 
-    for (; sz > 0; --sz)
-        *ptr++ = *value++;
+    // Word-wise copy, which matters for the 14 byte DPT16 / DPT232
+    // objects used for text displays
+    copyData(ptr, value, sz);
 
-    addObjectFlags(objno, flags);
+    objectValueStored(objno, flags);
 }
 
-/*
- * @return The number of communication objects.
- */
-inline int objectCount()
+void updateObjectCache()
 {
-    // The first byte of the config table contains the number of com-objects
-    return *objectConfigTable();
-}
+    int numObjs = objectCount();
+    int i;
 
-/*
- * Find the first group address for the communication object. This is the
- * address that is used when sending a read-value or a write-value telegram.
- *
- * @param objno - the ID of the communication object
- * @return The group address, or 0 if none found.
- */
-int firstObjectAddr(int objno)
-{
-    byte* assocTab = assocTable();
-    byte* assocTabEnd = assocTab + (*assocTab << 1);
+    objCacheCount = 0;
+    objFlagsTabCache = 0;
+    objFlagsTabCache = objectFlagsTable();
+
+    if (numObjs > OBJ_CACHE_SIZE)
+        numObjs = OBJ_CACHE_SIZE;
 
-    for (++assocTab; assocTab < assocTabEnd; assocTab += 2)
+    for (i = 0; i < numObjs; ++i)
     {
-        if (assocTab[1] == objno)
-        {
-            byte* addr = addrTable() + 1 + (assocTab[0] << 1);
-            return (addr[0] << 8) | addr[1];
-        }
-    }
+        objValuePtrCache[i] = resolveObjectValuePtr(i);
 
-    return 0;
+        int type = objectType(i);
+        objSizeCache[i] = type < BIT_7 ? 1 : objectTypeSizes[type - BIT_7];
+    }
+    objCacheCount = numObjs;
 }
 
+
+
 /*
  * Create and send a group read request telegram.
  *
@@ -200,8 +694,7 @@ void sendGroupReadTelegram(int objno, int addr)
 {
     bcu.sendTelegram[0] = 0xbc; // Control byte
     // 1+2 contain the sender address, which is set by bus.sendTelegram()
-    bcu.sendTelegram[3] = addr >> 8;
-    bcu.sendTelegram[4] = addr;
+    storeBE16(bcu.sendTelegram + 3, addr);
     bcu.sendTelegram[5] = 0xe1;
     bcu.sendTelegram[6] = 0;
     bcu.sendTelegram[7] = 0x00;
@@ -218,25 +711,130 @@ void sendGroupReadTelegram(int objno, int addr)
  */
 void sendGroupWriteTelegram(int objno, int addr, bool isResponse)
 {
+    byte* telegram = bcu.sendTelegram;
+    GroupReadResponse* resp = 0;
+    byte* poolTel = 0;
+
+    if (!isResponse && objno < OBJ_CACHE_SIZE
+        && (coalesceMask[objno >> 5] & (1 << (objno & 31))))
+    {
+        // Compose coalesced write telegrams into a send pool buffer, so a
+        // later objectWrite() can patch the value while it is queued
+        poolTel = bus.acquireTelegram();
+        if (poolTel)
+            telegram = poolTel;
+    }
+    else if (isResponse && objno < readCacheCount)
+    {
+        // Responses are queued from send pool buffers only: the cache
+        // entry itself is never handed to the bus, so a second read of
+        // the same object cannot recompose a buffer that is still being
+        // sent. Without a free pool buffer the response is composed and
+        // sent uncached, like with a full cache.
+        poolTel = bus.acquireTelegram();
+        if (poolTel)
+        {
+            resp = readCache + objno;
+            if (resp->length && resp->data[3] == (byte) (addr >> 8)
+                && resp->data[4] == (byte) addr)
+            {
+                // The precomposed response is still valid: replay a copy
+                copyData(poolTel, resp->data, resp->length);
+                bus.queueTelegram(poolTel, resp->length);
+                return;
+            }
+            telegram = poolTel;  // compose here, cache a copy below
+        }
+    }
+
     byte* valuePtr = objectValuePtr(objno);
     int sz = telegramObjectSize(objno);
 
-    bcu.sendTelegram[0] = 0xbc; // Control byte
+    telegram[0] = 0xbc; // Control byte
     // 1+2 contain the sender address, which is set by bus.sendTelegram()
-    bcu.sendTelegram[3] = addr >> 8;
-    bcu.sendTelegram[4] = addr;
-    bcu.sendTelegram[5] = 0xe0 | ((sz + 1) & 15);
-    bcu.sendTelegram[6] = 0;
-    bcu.sendTelegram[7] = isResponse ? 0x40 : 0x80;
+    storeBE16(telegram + 3, addr);
+    telegram[5] = 0xe0 | ((sz + 1) & 15);
+    telegram[6] = 0;
+    telegram[7] = isResponse ? 0x40 : 0x80;
+
+    if (sz) reverseCopy(telegram + 8, valuePtr, sz);
+    else telegram[7] |= *valuePtr & 0x3f;
+
+    if (resp)
+    {
+        // Keep a copy for the next read of the same object
+        copyData(resp->data, telegram, 8 + sz);
+        resp->length = 8 + sz;
+    }
 
-    if (sz) reverseCopy(bcu.sendTelegram + 8, valuePtr, sz);
-    else bcu.sendTelegram[7] |= *valuePtr & 0x3f;
+    if (poolTel)
+    {
+        if (!isResponse)
+            coalesceTel[objno] = poolTel;
+        bus.queueTelegram(poolTel, 8 + sz);
+        return;
+    }
 
-    bus.sendTelegram(bcu.sendTelegram, 8 + sz);
+    bus.sendTelegram(telegram, 8 + sz);
 }
 
 int sndStartIdx = 0;
 
+// The handler that is called when an object was updated from the bus
+static void (*objectUpdateHandler)(int objno);
+
+void setObjectUpdateHandler(void (*handler)(int objno))
+{
+    objectUpdateHandler = handler;
+}
+
+bool objectTransmitPending()
+{
+    for (int i = 0; i < OBJ_PENDING_WORDS; ++i)
+    {
+        if (transPendingMask[i])
+            return true;
+    }
+    return false;
+}
+
+void objectWriteMultiple(const int* objnos, const unsigned int* values, int count)
+{
+    extern void _objectWrite(int objno, unsigned int value, int flags);
+    int minObjno = -1;
+
+    for (int i = 0; i < count; ++i)
+    {
+        _objectWrite(objnos[i], values[i], COMFLAG_TRANSREQ);
+
+        if (minObjno < 0 || objnos[i] < minObjno)
+            minObjno = objnos[i];
+    }
+
+    // Prime the transmit scanner so the burst does not wait for a wrap
+    // of the round robin scan
+    if (minObjno >= 0 && minObjno < sndStartIdx)
+        sndStartIdx = minObjno;
+}
+
+void objectWritePartial(int objno, int offset, const byte* data, int len)
+{
+    byte* ptr = objectValuePtr(objno);
+    int sz = objectSize(objno);
+
+    if (ptr == 0 || offset < 0 || offset >= sz)
+        return;
+    if (len > sz - offset)
+        len = sz - offset;
+
+    copyData(ptr + offset, data, len);
+
+    if (offset + len < sz)
+        return;  // more chunks to come, do not send a half-written value
+
+    objectValueStored(objno, COMFLAG_TRANSREQ);
+}
+
 void sendNextGroupTelegram()
 {
 
@@ -245,33 +843,62 @@ void sendNextGroupTelegram()
     if(flagsTab == 0)
     	return;
 
-    int addr, flags, objno, config, numObjs = objectCount();
+    int addr, flags, config, numObjs = objectCount();
+    int objno = sndStartIdx;
 
-    for (objno = sndStartIdx; objno < numObjs; ++objno)
+    while (objno < numObjs)
     {
+        // Skip a whole word of objects if none of them is pending
+        unsigned int pending = transPendingMask[objno >> 5] >> (objno & 31);
+        if (!pending)
+        {
+            objno = (objno | 31) + 1;
+            continue;
+        }
+
+        objno += trailingZeros(pending);
+        if (objno >= numObjs)
+            break;
+
+        transPendingMask[objno >> 5] &= ~(1 << (objno & 31));
+
         flags = flagsTab[objno >> 1];
         if (objno & 1) flags >>= 4;
 
         if ((flags & COMFLAG_TRANSREQ) == COMFLAG_TRANSREQ)
         {
+            if (!takeRateLimitToken(objno))
+            {
+                // The object's token bucket is empty: leave the request
+                // pending so the latest value is sent when a token is earned
+                transPendingMask[objno >> 5] |= 1 << (objno & 31);
+                ++objno;
+                continue;
+            }
+
             unsigned int mask = COMFLAG_TRANS_MASK << (objno & 1 ? 4 :  0);
             flagsTab[objno >> 1] &= ~mask;
 
             config = configTab[objno].config;
-            addr = firstObjectAddr(objno);
+            addr = addrForSendObject(objno);
 
-            if (addr == 0 || !(config & COMCONF_COMM))
-                continue;
-
-            if (flags & COMFLAG_DATAREQ)
-                sendGroupReadTelegram(objno, addr);
-            else if (config & COMCONF_TRANS)
-                sendGroupWriteTelegram(objno, addr, false);
-            else continue;
-
-            sndStartIdx = objno + 1;
-            return;
+            if (addr != 0 && (config & COMCONF_COMM))
+            {
+                if (flags & COMFLAG_DATAREQ)
+                    sendGroupReadTelegram(objno, addr);
+                else if (config & COMCONF_TRANS)
+                    sendGroupWriteTelegram(objno, addr, false);
+                else
+                {
+                    ++objno;
+                    continue;
+                }
+
+                sndStartIdx = objno + 1;
+                return;
+            }
         }
+        ++objno;
     }
 
     sndStartIdx = 0;
@@ -285,10 +912,25 @@ int nextUpdatedObject()
     if(flagsTab == 0)
     	return -1;
 
-    int flags, objno, numObjs = objectCount();
+    int flags, numObjs = objectCount();
+    int objno = startIdx;
 
-    for (objno = startIdx; objno < numObjs; ++objno)
+    while (objno < numObjs)
     {
+        // Skip a whole word of objects if none of them is updated
+        unsigned int pending = updatePendingMask[objno >> 5] >> (objno & 31);
+        if (!pending)
+        {
+            objno = (objno | 31) + 1;
+            continue;
+        }
+
+        objno += trailingZeros(pending);
+        if (objno >= numObjs)
+            break;
+
+        updatePendingMask[objno >> 5] &= ~(1 << (objno & 31));
+
         flags = flagsTab[objno >> 1];
 
         if (objno & 1) flags &= COMFLAG_UPDATE_HIGH;
@@ -300,6 +942,7 @@ int nextUpdatedObject()
             startIdx = objno + 1;
             return objno;
         }
+        ++objno;
     }
 
     startIdx = 0;
@@ -314,43 +957,87 @@ void processGroupWriteTelegram(int objno)
     if (count > 0) reverseCopy(valuePtr, bus.telegram + 8, count);
     else *valuePtr = bus.telegram[7] & 0x3f;
 
+    invalidateGroupReadResponse(objno);
     addObjectFlags(objno, COMFLAG_UPDATE);
+
+    if (objectUpdateHandler)
+        objectUpdateHandler(objno);
+}
+
+/*
+ * Process one com-object that is associated with the destination group
+ * address of the received telegram.
+ */
+static void processGroupObject(int objno, int apci, int addr)
+{
+    int objConf = objectConfig(objno).config;
+
+    if (apci == APCI_GROUP_VALUE_WRITE_PDU || apci == APCI_GROUP_VALUE_RESPONSE_PDU)
+    {
+        // Check if communication and write are enabled
+        if ((objConf & COMCONF_WRITE_COMM) == COMCONF_WRITE_COMM)
+            processGroupWriteTelegram(objno);
+    }
+    else if (apci == APCI_GROUP_VALUE_READ_PDU)
+    {
+        // Check if communication and read are enabled
+        if ((objConf & COMCONF_READ_COMM) == COMCONF_READ_COMM)
+            sendGroupWriteTelegram(objno, addr, true);
+    }
 }
 
 void processGroupTelegram(int addr, int apci)
 {
-    const ComConfig* configTab = &objectConfig(0);
     const byte* assocTab = assocTable();
     const int endAssoc = 1 + (*assocTab) * 2;
-    int objno, objConf;
 
     // Convert the group address into the index into the group address table
     const int gapos = indexOfAddr(addr);
     if (gapos < 0) return;
 
-    // Loop over all entries in the association table, as one group address
-    // could be assigned to multiple com-objects.
-    for (int idx = 1; idx < endAssoc; idx += 2)
+    if (assocIndexCount)
     {
-        // Check if grp-address index in assoc table matches the dest grp address index
-        if (gapos == assocTab[idx]) // We found an association for our addr
+        // The associations of our address are adjacent in the sorted
+        // association index: binary search the first one, then update all
+        // associated objects in one tight pass. The APCI dispatch is
+        // decided once, outside of the loop - a scene address that fans
+        // out to a dozen objects does not re-classify the telegram per
+        // object.
+        const bool isWrite = apci == APCI_GROUP_VALUE_WRITE_PDU
+            || apci == APCI_GROUP_VALUE_RESPONSE_PDU;
+
+        for (int pos = firstAssocOfAddr(gapos); pos >= 0 && pos < assocIndexCount; ++pos)
         {
-            objno = assocTab[idx + 1];  // Get the com-object number from the assoc table
-            objConf = configTab[objno].config;
+            const byte* entry = assocTab + 1 + (assocIndexSorted[pos] << 1);
+            if (entry[0] != gapos)
+                break;
 
-            if (apci == APCI_GROUP_VALUE_WRITE_PDU || apci == APCI_GROUP_VALUE_RESPONSE_PDU)
+            const int objno = entry[1];
+            const int objConf = objectConfig(objno).config;
+
+            if (isWrite)
             {
                 // Check if communication and write are enabled
                 if ((objConf & COMCONF_WRITE_COMM) == COMCONF_WRITE_COMM)
                     processGroupWriteTelegram(objno);
             }
-            else if (apci == APCI_GROUP_VALUE_READ_PDU)
+            else if (apci == APCI_GROUP_VALUE_READ_PDU
+                && (objConf & COMCONF_READ_COMM) == COMCONF_READ_COMM)
             {
-                // Check if communication and read are enabled
-                if ((objConf & COMCONF_READ_COMM) == COMCONF_READ_COMM)
-                    sendGroupWriteTelegram(objno, addr, true);
+                sendGroupWriteTelegram(objno, addr, true);
             }
         }
+        return;
+    }
+
+    // The tables were too large for the sorted index: loop over all entries
+    // in the association table, as one group address could be assigned to
+    // multiple com-objects.
+    for (int idx = 1; idx < endAssoc; idx += 2)
+    {
+        // Check if grp-address index in assoc table matches the dest grp address index
+        if (gapos == assocTab[idx]) // We found an association for our addr
+            processGroupObject(assocTab[idx + 1], apci, addr);
     }
 }
 
@@ -366,6 +1053,9 @@ byte* objectConfigTable()
 
 byte* objectFlagsTable()
 {
+    if (objFlagsTabCache)
+        return objFlagsTabCache;
+
 #if BCU_TYPE == BCU1_TYPE
     return userRamData + userEepromData[userEeprom.commsTabPtr + 1];
 #else
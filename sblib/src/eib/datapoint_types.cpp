@@ -9,10 +9,37 @@
  */
 
 #include <sblib/eib/datapoint_types.h>
+#include <sblib/types.h>
 
 // Sign for a negative DPT9 float value
 #define DPT_FLOAT_NEG_SIGN 0x8000
 
+// Table for topBit() below: maps the De Bruijn hash of a power of two to
+// the index of the set bit.
+static const byte topBitTab[32] =
+{
+     0,  9,  1, 10, 13, 21,  2, 29, 11, 14, 16, 18, 22, 25,  3, 30,
+     8, 12, 20, 28, 15, 17, 24,  7, 19, 27, 23,  6, 26,  5,  4, 31
+};
+
+/**
+ * Get the index of the highest set bit of the word, which must not be zero.
+ * The Cortex-M0 has no CLZ instruction, so the word is rounded down to a
+ * power of two and hashed with a De Bruijn multiply: constant time,
+ * ~15 cycles, instead of a shift loop of up to 15 iterations.
+ *
+ * @param word - the word to scan, must not be 0.
+ * @return The index of the highest set bit (0..31).
+ */
+static inline int topBit(unsigned int word)
+{
+    word |= word >> 1;
+    word |= word >> 2;
+    word |= word >> 4;
+    word |= word >> 8;
+    word |= word >> 16;
+    return topBitTab[(word * 0x07c4acddu) >> 27];
+}
 
 unsigned short dptToFloat(int value)
 {
@@ -23,23 +50,20 @@ unsigned short dptToFloat(int value)
 
     if (value < 0)
     {
-        while (value < -2048)
-        {
-            value >>= 1;
-            ++exp;
-        }
+        // value >> exp >= -2048 once the highest set bit of the ones'
+        // complement is below bit 11 + exp
+        unsigned int mag = ~(unsigned int) value;
+        if (mag >= 2048)
+            exp = topBit(mag) - 10;
 
-        return DPT_FLOAT_NEG_SIGN | (((unsigned int) value) & 2047) | (exp << 11);
+        return DPT_FLOAT_NEG_SIGN | (((unsigned int) value >> exp) & 2047) | (exp << 11);
     }
     else
     {
-        while (value > 2047)
-        {
-            value >>= 1;
-            ++exp;
-        }
+        if (value > 2047)
+            exp = topBit(value) - 10;
 
-        return value | (exp << 11);
+        return (value >> exp) | (exp << 11);
     }
 }
 
@@ -55,8 +79,23 @@ int dptFromFloat(unsigned short dptValue)
         value = dptValue | (-1L & ~2047);
     else value = dptValue & 2047;
 
-    for (; exp; --exp)
-        value <<= 1;
+    return value << exp;
+}
 
-    return value;
+void dptToFloatArray(const int* values, unsigned short* dptValues, int count)
+{
+    while (count > 0)
+    {
+        *dptValues++ = dptToFloat(*values++);
+        --count;
+    }
+}
+
+void dptFromFloatArray(const unsigned short* dptValues, int* values, int count)
+{
+    while (count > 0)
+    {
+        *values++ = dptFromFloat(*dptValues++);
+        --count;
+    }
 }
@@ -0,0 +1,268 @@
+/*
+ *  fw_update.cpp - Firmware update over the bus into an inactive flash bank.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/eib/fw_update.h>
+
+#include <sblib/internal/iap.h>
+
+#include <string.h>
+
+// The offset of the image data area in the memory window
+#define FW_DATA_OFFSET 16
+
+
+FirmwareUpdate::FirmwareUpdate(byte* bankAddress, unsigned int aBankSize)
+: bank(bankAddress)
+, bankSize(aBankSize)
+, imageSize(0)
+, recvOffset(0)
+, windowBase(0)
+, updateState(FW_IDLE)
+{
+}
+
+bool FirmwareUpdate::begin(unsigned int size)
+{
+    // The last page of the bank is reserved for the image descriptor
+    if (!size || size > bankSize - FLASH_PAGE_SIZE)
+        return false;
+
+    // Erase the sectors that the image and the descriptor will occupy
+    int sector = iapSectorOfAddress(bank);
+    int lastSector = iapSectorOfAddress(bank + bankSize - 1);
+
+    for (; sector <= lastSector; ++sector)
+    {
+        if (iapEraseSector(sector) != IAP_SUCCESS)
+        {
+            updateState = FW_FAILED;
+            return false;
+        }
+    }
+
+    imageSize = size;
+    recvOffset = 0;
+    updateState = FW_RECEIVING;
+    return true;
+}
+
+bool FirmwareUpdate::write(unsigned int offset, const byte* data, unsigned int count)
+{
+    if (updateState != FW_RECEIVING)
+        return false;
+
+    // The retransmit of an already processed chunk: skip what was
+    // received before, e.g. when our acknowledge got lost
+    if (offset < recvOffset)
+    {
+        unsigned int done = recvOffset - offset;
+        if (done >= count)
+            return true;
+        offset += done;
+        data += done;
+        count -= done;
+    }
+
+    // A gap in the stream or data beyond the announced image size
+    if (offset != recvOffset || offset + count > imageSize)
+    {
+        updateState = FW_FAILED;
+        return false;
+    }
+
+    while (count)
+    {
+        unsigned int pagePos = recvOffset & (FLASH_PAGE_SIZE - 1);
+        unsigned int chunk = FLASH_PAGE_SIZE - pagePos;
+        if (chunk > count)
+            chunk = count;
+
+        memcpy(pageBuf + pagePos, data, chunk);
+        data += chunk;
+        count -= chunk;
+        recvOffset += chunk;
+
+        // A full page is programmed in one flash operation, batching
+        // many telegrams worth of data into one write
+        if ((recvOffset & (FLASH_PAGE_SIZE - 1)) == 0 && !flushPage())
+            return false;
+    }
+
+    return true;
+}
+
+bool FirmwareUpdate::finish(unsigned int crc)
+{
+    if (updateState != FW_RECEIVING || recvOffset != imageSize)
+    {
+        updateState = FW_FAILED;
+        return false;
+    }
+
+    // Program the last, partially filled page
+    unsigned int pagePos = recvOffset & (FLASH_PAGE_SIZE - 1);
+    if (pagePos)
+    {
+        memset(pageBuf + pagePos, 0xff, FLASH_PAGE_SIZE - pagePos);
+        if (!flushPage())
+            return false;
+    }
+
+    // Verify the flash contents, not the stream: what counts is what
+    // the device will boot from
+    if (crc32(bank, imageSize) != crc)
+    {
+        updateState = FW_FAILED;
+        return false;
+    }
+
+    updateState = FW_VERIFIED;
+    return true;
+}
+
+bool FirmwareUpdate::activate()
+{
+    if (updateState != FW_VERIFIED)
+        return false;
+
+    FwDescriptor descr;
+    descr.magic = FW_DESCRIPTOR_MAGIC;
+    descr.size = imageSize;
+    descr.crc = crc32(bank, imageSize);
+
+    memset(pageBuf, 0xff, FLASH_PAGE_SIZE);
+    memcpy(pageBuf, &descr, sizeof(descr));
+
+    byte* page = bank + bankSize - FLASH_PAGE_SIZE;
+    if (iapProgram(page, pageBuf, FLASH_PAGE_SIZE) != IAP_SUCCESS)
+    {
+        updateState = FW_FAILED;
+        return false;
+    }
+
+    return true;
+}
+
+bool FirmwareUpdate::flushPage()
+{
+    byte* page = bank + ((recvOffset - 1) & ~(FLASH_PAGE_SIZE - 1));
+
+    if (iapProgram(page, pageBuf, FLASH_PAGE_SIZE) != IAP_SUCCESS)
+    {
+        updateState = FW_FAILED;
+        return false;
+    }
+
+    return true;
+}
+
+void FirmwareUpdate::setMemoryWindow(unsigned int base)
+{
+    windowBase = base;
+}
+
+bool FirmwareUpdate::handlesAddress(unsigned int address) const
+{
+    if (!windowBase)
+        return false;
+
+    return address >= windowBase
+        && address - windowBase < FW_DATA_OFFSET + bankSize - FLASH_PAGE_SIZE;
+}
+
+unsigned int FirmwareUpdate::windowEnd() const
+{
+    if (!windowBase)
+        return 0;
+
+    return windowBase + FW_DATA_OFFSET + bankSize - FLASH_PAGE_SIZE;
+}
+
+void FirmwareUpdate::writeMem(unsigned int address, const byte* data, unsigned int count)
+{
+    if (address == windowBase)  // The command register
+    {
+        if (count < 5)
+            return;
+
+        unsigned int arg = data[1] | (data[2] << 8) | (data[3] << 16)
+            | ((unsigned int) data[4] << 24);
+
+        switch (data[0])
+        {
+        case FW_CMD_BEGIN:
+            begin(arg);
+            break;
+        case FW_CMD_FINISH:
+            finish(arg);
+            break;
+        case FW_CMD_ACTIVATE:
+            activate();
+            break;
+        }
+        return;
+    }
+
+    if (address >= windowBase + FW_DATA_OFFSET)
+        write(address - windowBase - FW_DATA_OFFSET, data, count);
+}
+
+void FirmwareUpdate::readMem(unsigned int address, byte* data, unsigned int count)
+{
+    byte status[5];
+    status[0] = updateState;
+    status[1] = recvOffset;
+    status[2] = recvOffset >> 8;
+    status[3] = recvOffset >> 16;
+    status[4] = recvOffset >> 24;
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int pos = address - windowBase + i;
+        data[i] = pos < sizeof(status) ? status[pos] : 0;
+    }
+}
+
+bool FirmwareUpdate::validImage(const byte* bankAddress, unsigned int bankSize)
+{
+    const FwDescriptor* descr = (const FwDescriptor*)
+        (bankAddress + bankSize - FLASH_PAGE_SIZE);
+
+    if (descr->magic != FW_DESCRIPTOR_MAGIC)
+        return false;
+    if (!descr->size || descr->size > bankSize - FLASH_PAGE_SIZE)
+        return false;
+
+    return crc32(bankAddress, descr->size) == descr->crc;
+}
+
+unsigned int FirmwareUpdate::crc32(const byte* data, unsigned int count)
+{
+    // CRC-32 (IEEE 802.3, reflected), computed nibble-wise: fast enough
+    // to verify a whole bank at activation time without a 1 KB table
+    static const unsigned int tab[16] =
+    {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+
+    unsigned int crc = 0xffffffff;
+
+    while (count--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ tab[crc & 15];
+        crc = (crc >> 4) ^ tab[crc & 15];
+    }
+
+    return ~crc;
+}
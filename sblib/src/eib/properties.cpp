@@ -10,8 +10,9 @@
 
 #include <sblib/eib/properties.h>
 #include <sblib/eib/bcu_type.h>
+#include <sblib/config.h>
 
-#if BCU_TYPE != BCU1_TYPE
+#if BCU_TYPE != BCU1_TYPE && !defined(SBLIB_NO_PROPERTIES)
 
 #include <sblib/core.h>
 #include <sblib/eib/user_memory.h>
@@ -30,7 +31,8 @@ const PropertyDef* findProperty(PropertyID propertyId, const PropertyDef* table)
 {
     const PropertyDef* def;
 
-    for (def = table; def->id; ++def)
+    // The tables are sorted by ID, so the scan can stop early
+    for (def = table; def->id && def->id <= propertyId; ++def)
     {
         if (def->id == propertyId)
             return def;
@@ -39,18 +41,56 @@ const PropertyDef* findProperty(PropertyID propertyId, const PropertyDef* table)
     return 0;
 }
 
+const PropertyDef* findProperty(PropertyID propertyId, const PropertyDef* table, int count)
+{
+    int lo = 0;
+    int hi = count - 1;
+
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) >> 1;
+
+        if (table[mid].id < propertyId) lo = mid + 1;
+        else if (table[mid].id > propertyId) hi = mid - 1;
+        else return table + mid;
+    }
+
+    return 0;
+}
+
 /*
  * Get a property definition.
  *
+ * ETS accesses the same property in runs during commissioning: a load
+ * control is written segment after segment, a long value is read in
+ * consecutive chunks. The last resolved definition is therefore cached,
+ * so back-to-back telegrams skip the table search. The definitions are
+ * constant flash data, the cache cannot go stale.
+ *
  * @param objectIdx - the index of the interface object.
  * @param propertyId - the property ID.
  * @return The property definition, or 0 if not found.
  */
 const PropertyDef* propertyDef(int objectIdx, PropertyID propertyId)
 {
+    static signed char lastObjectIdx = -1;
+    static const PropertyDef* lastDef;
+
+    if (objectIdx == lastObjectIdx && lastDef->id == propertyId)
+        return lastDef;
+
     if (objectIdx >= NUM_PROP_OBJECTS)
         return 0;
-    return findProperty(propertyId, propertiesTab[objectIdx]);
+
+    const PropertyDef* def = findProperty(propertyId, propertiesTab[objectIdx],
+        propertiesTabSize[objectIdx]);
+    if (def)
+    {
+        lastObjectIdx = objectIdx;
+        lastDef = def;
+    }
+
+    return def;
 }
 
 /*
@@ -209,7 +249,7 @@ bool propertyValueWriteTelegram(int objectIdx, PropertyID propertyId, int count,
         reverseCopy(bcu.sendTelegram + 12, valuePtr + start * type, len);
 
         if (def->isEepromPointer())
-            userEeprom.modified();
+            userEeprom.modified(valuePtr + start * type - userEepromData, len);
     }
 
     bcu.sendTelegram[5] += len;
@@ -250,4 +290,4 @@ bool propertyDescReadTelegram(int objectIdx, PropertyID propertyId, int index)
     return true;
 }
 
-#endif /* BCU_TYPE != BCU1_TYPE */
+#endif /* BCU_TYPE != BCU1_TYPE && !SBLIB_NO_PROPERTIES */
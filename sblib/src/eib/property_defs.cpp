@@ -15,18 +15,24 @@
 #if BCU_TYPE != BCU1_TYPE
 
 
+// The property tables are sorted by property ID so that findProperty()
+// can binary search them. When compiled as C++11 or newer, the sort
+// order is verified at compile time (see the end of this file).
+#if __cplusplus >= 201103L
+#  define PROP_TABLE constexpr
+#else
+#  define PROP_TABLE const
+#endif
+
 //
 // The properties of the device object
 // See BCU2 help
 //
-static const PropertyDef deviceObjectProps[] =
+static PROP_TABLE PropertyDef deviceObjectProps[] =
 {
     // Interface object type: 2 bytes
     { PID_OBJECT_TYPE, PDT_UNSIGNED_INT, 0x0000 },
 
-    // Device control
-    { PID_DEVICE_CONTROL, PDT_GENERIC_01|PC_WRITABLE|PC_POINTER, PD_USER_RAM_OFFSET(deviceControl) },
-
     // Load state control
     { PID_LOAD_STATE_CONTROL, PDT_CONTROL|PC_WRITABLE|PC_POINTER, PD_USER_EEPROM_OFFSET(loadState[OT_DEVICE]) },
 
@@ -43,6 +49,9 @@ static const PropertyDef deviceObjectProps[] =
     // Configured as PDT_GENERIC_02 and not as PDT_UNSIGNED_INT to avoid swapping the byte order
     { PID_MANUFACTURER_ID, PDT_GENERIC_02|PC_POINTER, PD_USER_EEPROM_OFFSET(manufacturerH) },
 
+    // Device control
+    { PID_DEVICE_CONTROL, PDT_GENERIC_01|PC_WRITABLE|PC_POINTER, PD_USER_RAM_OFFSET(deviceControl) },
+
     // Order number: 10 byte data, stored in userEeprom.serial
     // Ok this is a hack. The serial number and the following 4 bytes are returned.
     { PID_ORDER_INFO, PDT_GENERIC_10|PC_POINTER, PD_USER_EEPROM_OFFSET(serial) },
@@ -63,7 +72,7 @@ static const PropertyDef deviceObjectProps[] =
 //
 // The properties of the address table object
 //
-static const PropertyDef addrTabObjectProps[] =
+static PROP_TABLE PropertyDef addrTabObjectProps[] =
 {
     // Interface object type: 2 bytes
     { PID_OBJECT_TYPE, PDT_UNSIGNED_INT, 0x0001 },
@@ -81,7 +90,7 @@ static const PropertyDef addrTabObjectProps[] =
 //
 // The properties of the association table object
 //
-static const PropertyDef assocTabObjectProps[] =
+static PROP_TABLE PropertyDef assocTabObjectProps[] =
 {
     // Interface object type: 2 bytes
     { PID_OBJECT_TYPE, PDT_UNSIGNED_INT, 0x0002 },
@@ -99,7 +108,7 @@ static const PropertyDef assocTabObjectProps[] =
 //
 // The properties of the application program object
 //
-static const PropertyDef appObjectProps[] =
+static PROP_TABLE PropertyDef appObjectProps[] =
 {
     // Interface object type: 2 bytes
     { PID_OBJECT_TYPE, PDT_UNSIGNED_INT, 0x0003 },
@@ -110,12 +119,12 @@ static const PropertyDef appObjectProps[] =
     // Run state control
     { PID_RUN_STATE_CONTROL, PDT_UNSIGNED_CHAR|PC_POINTER, PD_USER_RAM_OFFSET(runState) },
 
-    // Program version
-    { PID_PROG_VERSION, PDT_GENERIC_05|PC_POINTER, PD_USER_EEPROM_OFFSET(manufacturerH) },
-
     // Pointer to the communication objects table
     { PID_TABLE_REFERENCE, PDT_UNSIGNED_INT|PC_ARRAY_POINTER, PD_USER_EEPROM_OFFSET(commsTabAddr) },
 
+    // Program version
+    { PID_PROG_VERSION, PDT_GENERIC_05|PC_POINTER, PD_USER_EEPROM_OFFSET(manufacturerH) },
+
     // ABB_CUSTOM
     { PID_ABB_CUSTOM, PDT_GENERIC_10|PC_POINTER|PC_WRITABLE, PD_USER_RAM_OFFSET(user2) },
 
@@ -135,4 +144,37 @@ const PropertyDef* const propertiesTab[NUM_PROP_OBJECTS] =
     appObjectProps        // Object 3
 };
 
+// The number of entries of a property table, without the end marker
+#define PROP_TABLE_SIZE(table)  (sizeof(table) / sizeof(PropertyDef) - 1)
+
+//
+// The number of properties per interface object, computed by the compiler
+//
+const byte propertiesTabSize[NUM_PROP_OBJECTS] =
+{
+    PROP_TABLE_SIZE(deviceObjectProps),    // Object 0
+    PROP_TABLE_SIZE(addrTabObjectProps),   // Object 1
+    PROP_TABLE_SIZE(assocTabObjectProps),  // Object 2
+    PROP_TABLE_SIZE(appObjectProps)        // Object 3
+};
+
+#if __cplusplus >= 201103L
+
+/*
+ * Compile time check that a property table is sorted by ascending
+ * property ID, up to the end marker.
+ */
+static constexpr bool sortedById(const PropertyDef* table, int idx = 1)
+{
+    return table[idx].id == 0 ||
+        (table[idx - 1].id < table[idx].id && sortedById(table, idx + 1));
+}
+
+static_assert(sortedById(deviceObjectProps), "deviceObjectProps must be sorted by property ID");
+static_assert(sortedById(addrTabObjectProps), "addrTabObjectProps must be sorted by property ID");
+static_assert(sortedById(assocTabObjectProps), "assocTabObjectProps must be sorted by property ID");
+static_assert(sortedById(appObjectProps), "appObjectProps must be sorted by property ID");
+
+#endif /*__cplusplus >= 201103L*/
+
 #endif /*BCU_TYPE != BCU1_TYPE*/
@@ -0,0 +1,144 @@
+/*
+ *  scene.cpp - ETS parameterized scene engine with direct scene recall.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/eib/scene.h>
+
+#include <sblib/eib/com_objects.h>
+#include <sblib/eib/user_memory.h>
+
+// Recall collects the fan-out in chunks of this size on the stack
+#define SCENE_WRITE_CHUNK 8
+
+
+SceneEngine::SceneEngine()
+: tableAddr(-1)
+, sceneObjno(-1)
+, count(0)
+{
+}
+
+void SceneEngine::begin(int tableAddr, int sceneObjno)
+{
+    byte cnt[SCENE_NUMBERS];
+    byte next[SCENE_NUMBERS];
+
+    this->tableAddr = tableAddr;
+    this->sceneObjno = sceneObjno;
+
+    int num = userEeprom[tableAddr];
+    if (num > SCENE_MAX_ENTRIES)
+        num = SCENE_MAX_ENTRIES;
+
+    // Count the entries of every scene
+    for (int scene = 0; scene < SCENE_NUMBERS; ++scene)
+        cnt[scene] = 0;
+    for (int entry = 0; entry < num; ++entry)
+    {
+        int scene = userEeprom[tableAddr + 1 + entry * 3];
+        if (scene < SCENE_NUMBERS)
+            ++cnt[scene];
+    }
+
+    // The start of every scene's group in order[]
+    byte at = 0;
+    for (int scene = 0; scene < SCENE_NUMBERS; ++scene)
+    {
+        first[scene] = cnt[scene] ? at : 0xff;
+        next[scene] = at;
+        at += cnt[scene];
+    }
+    count = at;
+
+    // Place the entry indexes into their scene's group
+    for (int entry = 0; entry < num; ++entry)
+    {
+        int scene = userEeprom[tableAddr + 1 + entry * 3];
+        if (scene < SCENE_NUMBERS)
+            order[next[scene]++] = entry;
+    }
+}
+
+int SceneEngine::recall(int scene)
+{
+    if (tableAddr < 0 || scene < 0 || scene >= SCENE_NUMBERS)
+        return 0;
+
+    int idx = first[scene];
+    if (idx == 0xff)
+        return 0;
+
+    int objnos[SCENE_WRITE_CHUNK];
+    unsigned int values[SCENE_WRITE_CHUNK];
+    int total = 0, pending = 0;
+
+    while (idx < count)
+    {
+        int addr = tableAddr + 1 + order[idx] * 3;
+        if (userEeprom[addr] != scene)
+            break;                     // the end of this scene's group
+
+        objnos[pending] = userEeprom[addr + 1];
+        values[pending] = userEeprom[addr + 2];
+        if (++pending == SCENE_WRITE_CHUNK)
+        {
+            objectWriteMultiple(objnos, values, pending);
+            total += pending;
+            pending = 0;
+        }
+        ++idx;
+    }
+
+    if (pending)
+    {
+        objectWriteMultiple(objnos, values, pending);
+        total += pending;
+    }
+    return total;
+}
+
+int SceneEngine::store(int scene)
+{
+    if (tableAddr < 0 || scene < 0 || scene >= SCENE_NUMBERS)
+        return 0;
+
+    int idx = first[scene];
+    if (idx == 0xff)
+        return 0;
+
+    int total = 0;
+    while (idx < count)
+    {
+        int addr = tableAddr + 1 + order[idx] * 3;
+        if (userEeprom[addr] != scene)
+            break;                     // the end of this scene's group
+
+        byte value = objectRead(userEeprom[addr + 1]);
+        if (userEeprom[addr + 2] != value)
+        {
+            userEeprom[addr + 2] = value;
+            userEeprom.modified();
+        }
+        ++total;
+        ++idx;
+    }
+    return total;
+}
+
+bool SceneEngine::processTelegram(int objno)
+{
+    if (sceneObjno < 0 || objno != sceneObjno)
+        return false;
+
+    int ctrl = objectRead(objno);
+    if (ctrl & 0x80)
+        store(ctrl & 0x3f);
+    else recall(ctrl & 0x3f);
+    return true;
+}
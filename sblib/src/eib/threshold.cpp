@@ -0,0 +1,61 @@
+/*
+ *  threshold.cpp - Threshold with hysteresis that writes a com object.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/eib/threshold.h>
+
+#include <sblib/eib/com_objects.h>
+#include <sblib/eib/user_memory.h>
+
+
+Threshold::Threshold()
+: objno(-1)
+, threshold(0)
+, hysteresis(0)
+, invert(false)
+, valid(false)
+, active(false)
+{
+}
+
+void Threshold::begin(int objno, int threshold, int hysteresis, bool invert)
+{
+    this->objno = objno;
+    this->threshold = threshold;
+    this->hysteresis = hysteresis;
+    this->invert = invert;
+    valid = false;
+    active = false;
+}
+
+void Threshold::beginFromParams(int objno, int paramAddr, bool invert)
+{
+    begin(objno,
+          (short) ((userEeprom[paramAddr] << 8) | userEeprom[paramAddr + 1]),
+          (short) ((userEeprom[paramAddr + 2] << 8) | userEeprom[paramAddr + 3]),
+          invert);
+}
+
+void Threshold::newSample(int value)
+{
+    if (objno < 0)
+        return;
+
+    bool newState;
+    if (valid && active)
+        newState = value > threshold - hysteresis;
+    else newState = value >= threshold;
+
+    if (!valid || newState != active)
+    {
+        active = newState;
+        valid = true;
+        objectWrite(objno, (unsigned int) (active != invert));
+    }
+}
@@ -15,6 +15,7 @@
 #include <sblib/core.h>
 
 #include <string.h>
+#include <sblib/trace.h>
 
 // move userRamData to a nice address (ok it's stupid but it helps debugging)
 byte __attribute__ ((aligned (4))) userRamPadding[20];
@@ -32,11 +33,37 @@ UserEeprom& userEeprom = *(UserEeprom*) userEepromData;
 volatile byte userEepromModified;
 volatile unsigned int writeUserEepromTime;
 
+// One bit per 256 byte flash page of the EEPROM image: set if the page was
+// modified since the last flash write (see userEeprom.modified(offset, len))
+unsigned int userEepromDirtyPages;
+
+// Time in milliseconds that modified data ages before it is written to
+// flash (see userEeprom.commitDelay())
+unsigned int userEepromCommitDelay = 50;
+
 
 #define NUM_EEPROM_PAGES     (FLASH_SECTOR_SIZE / USER_EEPROM_SIZE)
+#define EEPROM_FLASH_PAGES   (USER_EEPROM_SIZE / FLASH_PAGE_SIZE)
 #define FLASH_SECTOR_ADDRESS (FLASH_BASE_ADDRESS + iapFlashSize() - FLASH_SECTOR_SIZE)
 #define LAST_EEPROM_PAGE     (FLASH_SECTOR_ADDRESS + USER_EEPROM_SIZE * (NUM_EEPROM_PAGES - 1))
 
+// Offset of the stored CRC32 of the image, directly before the in-use marker
+// byte. The last 5 bytes of the EEPROM image are reserved by the library.
+#define EEPROM_CRC_OFFSET    (USER_EEPROM_SIZE - 5)
+
+
+/*
+ * Test if the stored EEPROM image has a valid CRC32.
+ */
+static bool validImage(const byte* page)
+{
+    unsigned int crc = crc32(0, page, EEPROM_CRC_OFFSET);
+
+    return page[EEPROM_CRC_OFFSET] == (byte) crc
+        && page[EEPROM_CRC_OFFSET + 1] == (byte) (crc >> 8)
+        && page[EEPROM_CRC_OFFSET + 2] == (byte) (crc >> 16)
+        && page[EEPROM_CRC_OFFSET + 3] == (byte) (crc >> 24);
+}
 
 /*
  * Find the last valid page in the flash sector
@@ -59,12 +86,73 @@ byte* findValidPage()
 
 void readUserEeprom()
 {
-    byte* page = findValidPage();
+    byte* firstPage = FLASH_BASE_ADDRESS + iapFlashSize() - FLASH_SECTOR_SIZE;
+    byte* fallback = 0;
+    byte* page;
+
+    // Use the newest stored image whose checksum validates. An image with a
+    // bad checksum is a torn write from a power failure during flashing; the
+    // previous committed image is used then. Images of library versions that
+    // did not store a CRC32 fail the check too, so if no image validates the
+    // newest marked image is used, as before.
+    for (page = LAST_EEPROM_PAGE; page >= firstPage; page -= USER_EEPROM_SIZE)
+    {
+        if (page[USER_EEPROM_SIZE - 1] == 0xff)
+            continue;
+
+        if (!fallback)
+            fallback = page;
+
+        if (validImage(page))
+            break;
+    }
+
+    if (page < firstPage)
+        page = fallback;
 
     if (page) memcpy(userEepromData, page, USER_EEPROM_SIZE);
     else memset(userEepromData, 0, USER_EEPROM_SIZE);
 
     userEepromModified = false;
+    userEepromDirtyPages = 0;
+}
+
+/*
+ * Wait until the bus is idle, so the next blocking IAP call does not fall
+ * into a telegram. The IAP calls block the interrupts themselves; waiting
+ * between the calls lets the bus ISR catch up with telegrams that arrived
+ * during the previous call.
+ */
+static void waitBusIdle()
+{
+    while (!bus.idle())
+        ;
+}
+
+/*
+ * Rewrite only the modified 256 byte flash pages of the valid page in place.
+ *
+ * @param page - the valid page in the flash sector
+ * @param dirty - the modified flash pages, one bit per page
+ */
+static void writeUserEepromPages(byte* page, unsigned int dirty)
+{
+    for (int i = 0; i < EEPROM_FLASH_PAGES; ++i)
+    {
+        if (!(dirty & (1 << i)))
+            continue;
+
+        byte* pageAddr = page + i * FLASH_PAGE_SIZE;
+
+        waitBusIdle();
+        IAP_Status rc = iapErasePage(iapPageOfAddress(pageAddr));
+        if (rc == IAP_SUCCESS)
+        {
+            waitBusIdle();
+            rc = iapProgram(pageAddr, userEepromData + i * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+        }
+        if (rc != IAP_SUCCESS) fatalError(); // flashing failed
+    }
 }
 
 void writeUserEeprom()
@@ -72,16 +160,50 @@ void writeUserEeprom()
     if (!userEepromModified)
         return;
 
-    // Wait for an idle bus and then disable the interrupts
-    while (!bus.idle())
-        ;
-    noInterrupts();
-
     byte* page = findValidPage();
+    unsigned int dirty = userEepromDirtyPages & ((1 << EEPROM_FLASH_PAGES) - 1);
+
+    TRACE_EVENT(TRACE_FLASH_COMMIT, dirty);
+
+    // Store the image checksum, for boot validation and torn write detection
+    userEepromData[USER_EEPROM_SIZE - 1] = 0; // mark the page as in use
+    unsigned int crc = crc32(0, userEepromData, EEPROM_CRC_OFFSET);
+    userEepromData[EEPROM_CRC_OFFSET] = crc;
+    userEepromData[EEPROM_CRC_OFFSET + 1] = crc >> 8;
+    userEepromData[EEPROM_CRC_OFFSET + 2] = crc >> 16;
+    userEepromData[EEPROM_CRC_OFFSET + 3] = crc >> 24;
+    dirty |= 1 << (EEPROM_FLASH_PAGES - 1); // the page that holds the CRC
+
+    if (page)
+    {
+        // Drop the pages whose flash content matches the shadow RAM already
+        for (int i = 0; i < EEPROM_FLASH_PAGES; ++i)
+        {
+            if ((dirty & (1 << i)) && memcmp(page + i * FLASH_PAGE_SIZE,
+                userEepromData + i * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE) == 0)
+            {
+                dirty &= ~(1 << i);
+            }
+        }
+
+        if (!dirty || dirty != (unsigned int) ((1 << EEPROM_FLASH_PAGES) - 1))
+        {
+            // Nothing really changed, or only a few flash pages: rewrite those
+            // pages of the valid page in place instead of writing a complete
+            // new copy of the image
+            writeUserEepromPages(page, dirty);
+
+            userEepromModified = 0;
+            userEepromDirtyPages = 0;
+            return;
+        }
+    }
+
     if (page == LAST_EEPROM_PAGE)
     {
         // Erase the sector
         int sectorId = iapSectorOfAddress(FLASH_SECTOR_ADDRESS);
+        waitBusIdle();
         IAP_Status rc = iapEraseSector(sectorId);
         if (rc != IAP_SUCCESS) fatalError(); // erasing failed
 
@@ -91,23 +213,28 @@ void writeUserEeprom()
         page += USER_EEPROM_SIZE;
     else page = FLASH_SECTOR_ADDRESS;
 
-    userEepromData[USER_EEPROM_SIZE - 1] = 0; // mark the page as in use
-
     IAP_Status rc;
 
+    waitBusIdle();
 #if (USER_EEPROM_SIZE == 2048) || (USER_EEPROM_SIZE == 3072)
     rc = iapProgram(page, userEepromData, 1024);
     if (rc == IAP_SUCCESS)
+    {
+        waitBusIdle();
         rc = iapProgram(page + 1024, userEepromData + 1024, 1024);
+    }
 #if USER_EEPROM_SIZE == 3072
     if (rc == IAP_SUCCESS)
+    {
+        waitBusIdle();
         rc = iapProgram(page + 2048, userEepromData + 2048, 1024);
+    }
 #endif
 #else
     rc = iapProgram(page, userEepromData, USER_EEPROM_SIZE);
 #endif
     if (rc != IAP_SUCCESS) fatalError(); // flashing failed
 
-    interrupts();
     userEepromModified = 0;
+    userEepromDirtyPages = 0;
 }
@@ -0,0 +1,74 @@
+/*
+ *  event.cpp - Event flags connecting interrupt handlers to the main loop.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/event.h>
+
+#include <sblib/platform.h>
+#include <sblib/timer.h>
+
+// The pending event flags
+static volatile unsigned int eventFlags;
+
+
+void eventSet(unsigned int mask)
+{
+    // The read-modify-write must not be torn by a preempting handler
+    // that also posts an event
+    unsigned int primask = __get_PRIMASK();
+    __disable_irq();
+
+    eventFlags |= mask;
+
+    if (!primask)
+        __enable_irq();
+
+    // End a concurrent eventWait(), even one that did not reach its
+    // sleep instruction yet
+    __SEV();
+}
+
+unsigned int eventPending()
+{
+    return eventFlags;
+}
+
+unsigned int eventFetch(unsigned int mask)
+{
+    unsigned int primask = __get_PRIMASK();
+    __disable_irq();
+
+    unsigned int fetched = eventFlags & mask;
+    eventFlags &= ~fetched;
+
+    if (!primask)
+        __enable_irq();
+
+    return fetched;
+}
+
+unsigned int eventWait(unsigned int maxMs)
+{
+    unsigned int start = millis();
+    unsigned int flags, done;
+
+    while (!(flags = eventFetch()))
+    {
+        done = elapsed(start);
+        if (done >= maxMs)
+            break;
+
+        // The sleep ends early on any interrupt and on the event
+        // register that eventSet() pends with SEV, so a flag posted
+        // right before the sleep is not missed
+        microsSleep((maxMs - done) * 1000);
+    }
+
+    return flags;
+}
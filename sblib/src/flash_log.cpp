@@ -0,0 +1,188 @@
+/*
+ * flash_log.cpp - journaled append-log storage in flash
+ *
+ *  Copyright (c) 2015 Selfbus.org
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ */
+
+#include <sblib/platform.h>
+#include <sblib/internal/iap.h>
+#include <sblib/utils.h>
+#include <sblib/flash_log.h>
+#include <string.h>
+
+// The page header: the sequence number in byte 0, the rest reserved. The
+// header size keeps the record slots word aligned.
+#define LOG_HEADER_SIZE 4
+
+
+/*
+ * Get the sequence number that follows seq. The value 0xff is skipped, it
+ * marks a blank page.
+ */
+static byte nextSequence(byte seq)
+{
+    if (++seq == 0xff)
+        seq = 0;
+    return seq;
+}
+
+/*
+ * Test if the flash page is blank.
+ */
+static bool isBlankPage(const byte* page)
+{
+    for (int i = 0; i < FLASH_PAGE_SIZE; i++)
+    {
+        if (page[i] != 0xff)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+FlashLog::FlashLog(unsigned int flashBase, unsigned int flashSize, int recordSize) :
+        recordSize(recordSize)
+{
+    flashBasePage = flashBase / FLASH_PAGE_SIZE;
+    flashSizePages = flashSize / FLASH_PAGE_SIZE;
+    slotSize = recordSize + 1; // one marker byte per record
+    slotsPerPage = (FLASH_PAGE_SIZE - LOG_HEADER_SIZE) / slotSize;
+
+    currentPage = 0;
+    currentSlot = 0;
+    sequence = 0xff;
+    memset(pageBuf, 0xff, FLASH_PAGE_SIZE);
+
+    // Find any used page of the region
+    int page = 0;
+    for (unsigned int p = flashBasePage; p < flashBasePage + flashSizePages; p++)
+    {
+        if (*(byte*) (p << 8) != 0xff)
+        {
+            page = p;
+            break;
+        }
+    }
+    if (!page)
+    {
+        return; // the log is empty
+    }
+
+    // Follow the chain of consecutive sequence numbers to the newest page
+    byte seq = *(byte*) (page << 8);
+    for (unsigned int i = 1; i < flashSizePages; i++)
+    {
+        byte next = nextSequence(seq);
+        int found = 0;
+        for (unsigned int p = flashBasePage; p < flashBasePage + flashSizePages; p++)
+        {
+            if ((int) p != page && *(byte*) (p << 8) == next)
+            {
+                found = p;
+                break;
+            }
+        }
+        if (!found)
+        {
+            break;
+        }
+        page = found;
+        seq = next;
+    }
+
+    currentPage = page;
+    sequence = seq;
+    memcpy(pageBuf, (byte*) (page << 8), FLASH_PAGE_SIZE);
+
+    // Find the first free record slot of the newest page
+    currentSlot = slotsPerPage;
+    for (int slot = 0; slot < slotsPerPage; slot++)
+    {
+        if (pageBuf[LOG_HEADER_SIZE + slot * slotSize] == 0xff)
+        {
+            currentSlot = slot;
+            break;
+        }
+    }
+}
+
+int FlashLog::advancePage()
+{
+    int next;
+    if (currentPage == 0)
+    {
+        next = flashBasePage;
+    }
+    else
+    {
+        next = currentPage + 1;
+        if (next >= (int) (flashBasePage + flashSizePages))
+        {
+            next = flashBasePage; // recycle the oldest page
+        }
+    }
+
+    if (!isBlankPage((byte*) (next << 8)))
+    {
+        if (iapErasePage(next) != IAP_SUCCESS)
+        {
+            fatalError();
+        }
+    }
+
+    sequence = currentPage ? nextSequence(sequence) : 0;
+    memset(pageBuf, 0xff, FLASH_PAGE_SIZE);
+    pageBuf[0] = sequence;
+
+    currentPage = next;
+    currentSlot = 0;
+    return FLASH_LOG_SUCCESS;
+}
+
+int FlashLog::appendRecord(const byte* record)
+{
+    if (slotsPerPage < 1)
+    {
+        return FLASH_LOG_INVALID_RECORD;
+    }
+    if (currentPage == 0 || currentSlot >= slotsPerPage)
+    {
+        int ret = advancePage();
+        if (ret != FLASH_LOG_SUCCESS)
+        {
+            return ret;
+        }
+    }
+
+    int offset = LOG_HEADER_SIZE + currentSlot * slotSize;
+    pageBuf[offset] = 0; // mark the slot as used
+    memcpy(pageBuf + offset + 1, record, recordSize);
+
+    // The slots behind the new record are still 0xff in flash and in the
+    // buffer, so reprogramming the page only clears bits and needs no erase
+    if (iapProgram((byte*) (currentPage << 8), pageBuf, FLASH_PAGE_SIZE) != IAP_SUCCESS)
+    {
+        fatalError();
+    }
+
+    currentSlot++;
+    return FLASH_LOG_SUCCESS;
+}
+
+int FlashLog::latestRecord(byte* record) const
+{
+    if (isEmpty())
+    {
+        return FLASH_LOG_EMPTY;
+    }
+
+    int offset = LOG_HEADER_SIZE + (currentSlot - 1) * slotSize;
+    memcpy(record, pageBuf + offset + 1, recordSize);
+    return FLASH_LOG_SUCCESS;
+}
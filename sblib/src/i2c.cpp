@@ -12,6 +12,11 @@
 #include <sblib/interrupt.h>
 
 #include <sblib/i2c.h>
+#include <sblib/pool.h>
+
+// The I2C instance lives in a static pool slot instead of the heap, so
+// its RAM is accounted at link time and nothing is allocated at runtime.
+static ObjectPool<I2C, 1> i2cPool;
 
 static I2C * i2c_m_pInstance;
 I2C* I2C::m_pInstance = 0;
@@ -42,14 +47,20 @@ I2C::I2C()
 /*****************************************************************************
 ** Function name: I2CInit
 **
-** Descriptions:  Initialize I2C controller
+** Descriptions:  Initialize I2C controller. The SCL duty cycle registers
+**                are computed from SystemCoreClock for the requested bus
+**                speed: 50/50 in Standard mode, about 1/3 high and 2/3 low
+**                in Fast mode and Fast mode plus as the specification
+**                recommends. Fast mode plus also enables the high drive
+**                mode of the I2C pads.
 **
-** parameters:    I2c mode is either MASTER or SLAVE
+** parameters:    I2c mode is either MASTER or SLAVE, bus speed in Hz
+**                (e.g. I2C_SPEED_400K)
 ** Returned value:  true or false, return false if the I2C
 **                  interrupt handler was not installed correctly
 **
 *****************************************************************************/
-void  I2C::I2CInit( uint8_t I2cMode )
+void  I2C::I2CInit( uint8_t I2cMode, uint32_t I2cSpeed )
 {
   this->bI2CIsInitialized= true;
   this->RdIndex = 0;
@@ -62,6 +73,25 @@ void  I2C::I2CInit( uint8_t I2cMode )
   this->I2CMasterState = I2CSTATE_IDLE;
   this->I2CSlaveState = I2CSTATE_IDLE;
 
+  this->I2CDeviceAddr = 0;
+  this->I2CTxData = 0;
+  this->I2CRxData = 0;
+  this->transactionHandler = 0;
+
+  this->queueHead = 0;
+  this->queueTail = 0;
+  this->currentHandler = 0;
+
+  this->slaveRxBuffer = 0;
+  this->slaveRxSize = 0;
+  this->slaveRxIndex = 0;
+  this->slaveTxBuffer = 0;
+  this->slaveTxSize = 0;
+  this->slaveTxLen = 0;
+  this->slaveTxIndex = 0;
+  this->slaveRxHandler = 0;
+  this->slaveTxHandler = 0;
+
   LPC_SYSCON->PRESETCTRL |= (0x1<<1);
   LPC_SYSCON->SYSAHBCLKCTRL |= (1<<5);
 
@@ -73,16 +103,35 @@ void  I2C::I2CInit( uint8_t I2cMode )
   // --- Clear flags ---
   LPC_I2C->CONCLR = I2CONCLR_AAC | I2CONCLR_SIC | I2CONCLR_STAC | I2CONCLR_I2ENC;
 
-  // --- Reset registers ---
-#if FAST_MODE_PLUS
-  LPC_IOCON->PIO0_4 |= (0x1<<9);
-  LPC_IOCON->PIO0_5 |= (0x1<<9);
-  LPC_I2C->SCLL   = I2SCLL_HS_SCLL;
-  LPC_I2C->SCLH   = I2SCLH_HS_SCLH;
-#else
-  LPC_I2C->SCLL   = I2SCLL_SCLL;
-  LPC_I2C->SCLH   = I2SCLH_SCLH;
-#endif
+  // --- Set the SCL duty cycle for the requested bus speed ---
+  uint32_t divider = SystemCoreClock / I2cSpeed;
+  uint32_t sclh;
+
+  if ( I2cSpeed > I2C_SPEED_100K )
+  {
+    // Fast mode (plus) asks for an asymmetric duty cycle: SCL is low for
+    // about two thirds of the period
+    sclh = divider / 3;
+  }
+  else
+  {
+    sclh = divider / 2;
+  }
+  uint32_t scll = divider - sclh;
+
+  // 4 is the smallest value the duty cycle registers accept
+  if ( sclh < 4 ) sclh = 4;
+  if ( scll < 4 ) scll = 4;
+
+  if ( I2cSpeed > I2C_SPEED_400K )
+  {
+    // Enable the Fast mode plus high drive mode of the I2C pads
+    LPC_IOCON->PIO0_4 |= (0x1<<9);
+    LPC_IOCON->PIO0_5 |= (0x1<<9);
+  }
+
+  LPC_I2C->SCLL   = scll;
+  LPC_I2C->SCLH   = sclh;
 
   if ( I2cMode == I2CSLAVE )
   {
@@ -90,6 +139,7 @@ void  I2C::I2CInit( uint8_t I2cMode )
   }
 
   // --- Enable the I2C Interrupt ---
+  setInterruptPriority(I2C_IRQn, ISR_PRIO_PERIPHERAL);
   enableInterrupt(I2C_IRQn);
 
   LPC_I2C->CONSET = I2CONSET_I2EN;
@@ -107,7 +157,7 @@ void  I2C::I2CInit( uint8_t I2cMode )
 I2C* I2C::Instance()
 {
    if (!m_pInstance)
-      m_pInstance = new I2C;
+      m_pInstance = i2cPool.create();
    return m_pInstance;
 }
 
@@ -122,6 +172,16 @@ I2C* I2C::Instance()
 *****************************************************************************/
 extern "C" {
   volatile uint8_t StatValue = 0;
+
+  /* Notify the application that the transaction reached a terminal state
+   * and start the next queued transaction */
+  static void i2cTransactionDone(void)
+  {
+    if ( i2c_m_pInstance->transactionHandler )
+      i2c_m_pInstance->transactionHandler(i2c_m_pInstance->I2CMasterState);
+    i2c_m_pInstance->serviceQueue();
+  }
+
   void I2C_IRQHandler(void)
   {
 
@@ -132,12 +192,14 @@ extern "C" {
     case 0x08:
       /*
        * A START condition has been transmitted.
-       * We now send the slave address and initialize
-       * the write buffer
-       * (we always start with a write after START+SLA)
+       * We now send the slave address. A transaction that has nothing
+       * to write starts directly with SLA+R, all others with SLA+W.
        */
       i2c_m_pInstance->WrIndex = 0;
-      LPC_I2C->DAT = i2c_m_pInstance->I2CMasterBuffer[i2c_m_pInstance->WrIndex++];
+      if ( i2c_m_pInstance->I2CWriteLength == 0 && i2c_m_pInstance->I2CReadLength != 0 )
+        LPC_I2C->DAT = i2c_m_pInstance->I2CDeviceAddr | RD_BIT;
+      else
+        LPC_I2C->DAT = i2c_m_pInstance->I2CDeviceAddr;
       LPC_I2C->CONCLR = (I2CONCLR_SIC | I2CONCLR_STAC);
       i2c_m_pInstance->I2CMasterState = I2CSTATE_PENDING;
       break;
@@ -150,20 +212,10 @@ extern "C" {
        */
       i2c_m_pInstance->RdIndex = 0;
       /* Send SLA with R bit set, */
-      LPC_I2C->DAT = i2c_m_pInstance->I2CMasterBuffer[i2c_m_pInstance->WrIndex++];
+      LPC_I2C->DAT = i2c_m_pInstance->I2CDeviceAddr | RD_BIT;
       LPC_I2C->CONCLR = (I2CONCLR_SIC | I2CONCLR_STAC);
     break;
 
-    case 0x18:
-      /*
-       * SLA+W has been transmitted; ACK has been received.
-       * We now start writing bytes.
-       */
-      i2c_m_pInstance->I2CScan_State = I2CSCAN_FOUND;
-      LPC_I2C->DAT = i2c_m_pInstance->I2CMasterBuffer[i2c_m_pInstance->WrIndex++];
-      LPC_I2C->CONCLR = I2CONCLR_SIC;
-      break;
-
     case 0x20:
       /*
        * SLA+W has been transmitted; NOT ACK has been received.
@@ -173,8 +225,17 @@ extern "C" {
       LPC_I2C->CONSET = I2CONSET_STO;
       LPC_I2C->CONCLR = I2CONCLR_SIC;
       i2c_m_pInstance->I2CMasterState = I2CSTATE_SLA_NACK;
+      i2cTransactionDone();
       break;
 
+    case 0x18:
+      /*
+       * SLA+W has been transmitted; ACK has been received.
+       * Continue below like after a transmitted data byte.
+       */
+      i2c_m_pInstance->I2CScan_State = I2CSCAN_FOUND;
+      /* no break */
+
     case 0x28:
       /*
        * Data in I2DAT has been transmitted; ACK has been received.
@@ -184,7 +245,8 @@ extern "C" {
       if ( i2c_m_pInstance->WrIndex < i2c_m_pInstance->I2CWriteLength )
       {
         /* Keep writing as long as bytes avail */
-        LPC_I2C->DAT = i2c_m_pInstance->I2CMasterBuffer[i2c_m_pInstance->WrIndex++];
+        LPC_I2C->DAT = i2c_m_pInstance->I2CTxData[i2c_m_pInstance->WrIndex++];
+        LPC_I2C->CONCLR = I2CONCLR_SIC;
       }
       else
       {
@@ -193,14 +255,16 @@ extern "C" {
           /* Send a Repeated START to initialize a read transaction */
           /* (handled in state 0x10)                                */
           LPC_I2C->CONSET = I2CONSET_STA;  /* Set Repeated-start flag */
+          LPC_I2C->CONCLR = I2CONCLR_SIC;
         }
         else
         {
           i2c_m_pInstance->I2CMasterState = I2CSTATE_ACK;
           LPC_I2C->CONSET = I2CONSET_STO;      /* Set Stop flag */
+          LPC_I2C->CONCLR = I2CONCLR_SIC;
+          i2cTransactionDone();
         }
       }
-      LPC_I2C->CONCLR = I2CONCLR_SIC;
       break;
 
     case 0x30:
@@ -212,6 +276,7 @@ extern "C" {
       LPC_I2C->CONSET = I2CONSET_STO;
       LPC_I2C->CONCLR = I2CONCLR_SIC;
       i2c_m_pInstance->I2CMasterState = I2CSTATE_NACK;
+      i2cTransactionDone();
       break;
 
     case 0x38:
@@ -225,6 +290,7 @@ extern "C" {
       i2c_m_pInstance->I2CScan_State = I2CSCAN_ERROR;
       i2c_m_pInstance->I2CMasterState = I2CSTATE_ARB_LOSS;
       LPC_I2C->CONCLR = I2CONCLR_SIC;
+      i2cTransactionDone();
       break;
 
     case 0x40:
@@ -256,6 +322,7 @@ extern "C" {
       LPC_I2C->CONSET = I2CONSET_STO;
       LPC_I2C->CONCLR = I2CONCLR_SIC;
       i2c_m_pInstance->I2CMasterState = I2CSTATE_SLA_NACK;
+      i2cTransactionDone();
       break;
 
     case 0x50:
@@ -264,7 +331,7 @@ extern "C" {
        * Read the byte and check for more bytes to read.
        * Send a NOT ACK after the last byte is received
        */
-      i2c_m_pInstance->I2CSlaveBuffer[i2c_m_pInstance->RdIndex++] = LPC_I2C->DAT;
+      i2c_m_pInstance->I2CRxData[i2c_m_pInstance->RdIndex++] = LPC_I2C->DAT;
       if ( i2c_m_pInstance->RdIndex < (i2c_m_pInstance->I2CReadLength-1) )
       {
         /* lmore bytes to follow: send an ACK after data is received */
@@ -285,13 +352,99 @@ extern "C" {
        * Generate a STOP condition and flag the I2CEngine that the
        * transaction is finished.
        */
-      i2c_m_pInstance->I2CSlaveBuffer[i2c_m_pInstance->RdIndex++] = LPC_I2C->DAT;
+      i2c_m_pInstance->I2CRxData[i2c_m_pInstance->RdIndex++] = LPC_I2C->DAT;
       i2c_m_pInstance->I2CMasterState = I2CSTATE_ACK;
       LPC_I2C->CONSET = I2CONSET_STO;  /* Set Stop flag */
       LPC_I2C->CONCLR = I2CONCLR_SIC;  /* Clear SI flag */
+      i2cTransactionDone();
       break;
 
 
+    case 0x60:
+      /*
+       * Own SLA+W has been received; ACK has been returned.
+       * The master starts writing to us: initialize the receive buffer.
+       * 0x68 is the same after a lost arbitration of an own transaction.
+       */
+    case 0x68:
+      i2c_m_pInstance->slaveRxIndex = 0;
+      LPC_I2C->CONSET = I2CONSET_AA;
+      LPC_I2C->CONCLR = I2CONCLR_SIC;
+      break;
+
+    case 0x80:
+      /*
+       * Data has been received after own SLA+W; ACK has been returned.
+       * Store the byte and ACK the next one as long as the receive buffer
+       * has room, NACK when it is full. 0x88 is the byte after the NACK.
+       */
+    case 0x88:
+      if ( i2c_m_pInstance->slaveRxIndex < i2c_m_pInstance->slaveRxSize )
+        i2c_m_pInstance->slaveRxBuffer[i2c_m_pInstance->slaveRxIndex++] = LPC_I2C->DAT;
+      if ( i2c_m_pInstance->slaveRxIndex < i2c_m_pInstance->slaveRxSize )
+        LPC_I2C->CONSET = I2CONSET_AA;
+      else
+        LPC_I2C->CONCLR = I2CONCLR_AAC;
+      LPC_I2C->CONCLR = I2CONCLR_SIC;
+      break;
+
+    case 0xA0:
+      /*
+       * A STOP or repeated START has been received while addressed as
+       * slave: the master write is complete, hand the received bytes to
+       * the application and re-arm for the next addressing.
+       */
+      if ( i2c_m_pInstance->slaveRxHandler && i2c_m_pInstance->slaveRxIndex )
+        i2c_m_pInstance->slaveRxHandler(i2c_m_pInstance->slaveRxBuffer,
+            i2c_m_pInstance->slaveRxIndex);
+      i2c_m_pInstance->slaveRxIndex = 0;
+      LPC_I2C->CONSET = I2CONSET_AA;
+      LPC_I2C->CONCLR = I2CONCLR_SIC;
+      break;
+
+    case 0xA8:
+      /*
+       * Own SLA+R has been received; ACK has been returned.
+       * The master starts reading from us: let the application fill the
+       * transmit buffer. 0xB0 is the same after a lost arbitration.
+       */
+    case 0xB0:
+      i2c_m_pInstance->slaveTxIndex = 0;
+      i2c_m_pInstance->slaveTxLen = i2c_m_pInstance->slaveTxHandler
+          ? i2c_m_pInstance->slaveTxHandler(i2c_m_pInstance->slaveTxBuffer,
+              i2c_m_pInstance->slaveTxSize) : 0;
+      if ( i2c_m_pInstance->slaveTxLen > i2c_m_pInstance->slaveTxSize )
+        i2c_m_pInstance->slaveTxLen = i2c_m_pInstance->slaveTxSize;
+      /* no break: send the first byte */
+
+    case 0xB8:
+      /*
+       * A data byte has been transmitted; ACK has been received.
+       * Send the next byte; pad with 0xFF if the master reads more bytes
+       * than the application provided. ACK as long as more bytes follow.
+       */
+      if ( i2c_m_pInstance->slaveTxIndex < i2c_m_pInstance->slaveTxLen )
+        LPC_I2C->DAT = i2c_m_pInstance->slaveTxBuffer[i2c_m_pInstance->slaveTxIndex++];
+      else
+        LPC_I2C->DAT = 0xFF;
+      if ( i2c_m_pInstance->slaveTxIndex < i2c_m_pInstance->slaveTxLen )
+        LPC_I2C->CONSET = I2CONSET_AA;
+      else
+        LPC_I2C->CONCLR = I2CONCLR_AAC;
+      LPC_I2C->CONCLR = I2CONCLR_SIC;
+      break;
+
+    case 0xC0:
+      /*
+       * A data byte has been transmitted; NOT ACK has been received - the
+       * master has all it wants. 0xC8 is the last byte with an ACK.
+       * Re-arm for the next addressing.
+       */
+    case 0xC8:
+      LPC_I2C->CONSET = I2CONSET_AA;
+      LPC_I2C->CONCLR = I2CONCLR_SIC;
+      break;
+
     default:
       LPC_I2C->CONCLR = I2CONCLR_SIC;
     break;
@@ -299,6 +452,54 @@ extern "C" {
   }
 } // extern "C"
 
+/*****************************************************************************
+** Function name:  slaveBegin
+**
+** Descriptions:  Begin answering as an I2C slave. The slave side runs
+**                entirely in the interrupt handler; the registered
+**                handlers are called when the master finished writing to
+**                us and when the master addresses us for reading. Slave
+**                and master mode work at the same time.
+**
+** parameters:    Own slave address (8 bit form, R/W bit ignored), the
+**                receive buffer and its size, the transmit buffer and
+**                its size
+** Returned value: None
+**
+*****************************************************************************/
+void I2C::slaveBegin(uint8_t ownAddress, uint8_t* rxBuffer, uint16_t rxBufferSize,
+                     uint8_t* txBuffer, uint16_t txBufferSize)
+{
+  this->slaveRxBuffer = rxBuffer;
+  this->slaveRxSize = rxBufferSize;
+  this->slaveRxIndex = 0;
+  this->slaveTxBuffer = txBuffer;
+  this->slaveTxSize = txBufferSize;
+  this->slaveTxLen = 0;
+  this->slaveTxIndex = 0;
+
+  // The address lives in bits 7..1, bit 0 enables the general call
+  LPC_I2C->ADR0 = ownAddress & 0xFE;
+
+  // Assert acknowledge: answer when our address comes up on the bus
+  LPC_I2C->CONSET = I2CONSET_AA;
+}
+
+/*****************************************************************************
+** Function name:  slaveEnd
+**
+** Descriptions:  End answering as an I2C slave. Master mode is unaffected.
+**
+** parameters:    None
+** Returned value: None
+**
+*****************************************************************************/
+void I2C::slaveEnd()
+{
+  LPC_I2C->CONCLR = I2CONCLR_AAC;
+  LPC_I2C->ADR0 = 0;
+}
+
 /*****************************************************************************
 ** Function name:  I2CStart
 **
@@ -351,34 +552,200 @@ bool I2C::I2CStop( void )
 
 
 /*****************************************************************************
-** Function name:  I2CEngine
+** Function name: WriteRead
 **
-** Descriptions:  The routine to complete a I2C transaction from start to stop.
-**                All the intermitten steps are handled in the interrupt handler.
-**                Before this routine is called, the read length, write length
-**                and I2C master buffer need to be filled.
+** Descriptions:  Combined write-then-read transaction: the txData bytes
+**                (typically a register address) are written, then rxLen
+**                bytes are read after a repeated start. This is one bus
+**                transaction instead of a separate write and read with a
+**                stop/start and arbitration in between.
+**
+** parameters:    Device address, send data and length, receive buffer and length
+** Returned value: true on success, false on failure
 **
-** parameters:    None
-** Returned value: Any of the I2CSTATE_... values. See i2c.h
-** 
 *****************************************************************************/
-uint16_t I2C::I2CEngine( void )
+bool I2C::WriteRead(uint8_t uDeviceAddr, const uint8_t *txData, uint8_t txLen,
+                    uint8_t *rxData, uint8_t rxLen)
 {
-  this->I2CMasterState = I2CSTATE_IDLE;
+  return this->transaction(uDeviceAddr, txData, txLen, rxData, rxLen) == I2CSTATE_ACK;
+}
+
+/*****************************************************************************
+** Function name:  startTransaction
+**
+** Descriptions:  Start a transaction in the background. The transaction is
+**                completely handled in the interrupt handler: the txData
+**                bytes are sent, then rxLen bytes are read into rxData
+**                after a repeated start. The buffers must stay valid until
+**                the transaction is done, see transactionDone() and
+**                onTransactionComplete().
+**
+** parameters:    Device address, send data and length, receive buffer and length
+** Returned value: true or false, return false if a transaction is running
+**                 or the arguments are inconsistent
+**
+*****************************************************************************/
+bool I2C::startTransaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                           uint8_t *rxData, uint16_t rxLen)
+{
+  if ( this->I2CMasterState == I2CSTATE_PENDING )
+    return false;
+  if ( (txLen && !txData) || (rxLen && !rxData) )
+    return false;
+
+  this->I2CDeviceAddr  = uDeviceAddr & ~RD_BIT;
+  this->I2CTxData      = txData;
+  this->I2CRxData      = rxData;
+  this->I2CWriteLength = txLen;
+  this->I2CReadLength  = rxLen;
   this->RdIndex = 0;
   this->WrIndex = 0;
-  if ( this->I2CStart() != true )
+
+  this->I2CMasterState = I2CSTATE_PENDING;
+  LPC_I2C->CONSET = I2CONSET_STA;  // Set Start flag
+
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  queueTransaction
+**
+** Descriptions:  Queue a transaction. If the bus is idle the transaction
+**                starts right away, otherwise it is started from the I2C
+**                interrupt when the previous transaction is done, so the
+**                queued transactions run back-to-back without the
+**                application waiting in between.
+**
+** parameters:    Device address, send data and length, receive buffer and
+**                length, per-transaction completion handler (0 for none)
+** Returned value: true or false, return false if the queue is full or the
+**                 arguments are inconsistent
+**
+*****************************************************************************/
+bool I2C::queueTransaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                           uint8_t *rxData, uint16_t rxLen, I2cTransactionHandler handler)
+{
+  if ( (txLen && !txData) || (rxLen && !rxData) )
+    return false;
+
+  disableInterrupt(I2C_IRQn);
+
+  if ( this->I2CMasterState != I2CSTATE_PENDING && this->queueHead == this->queueTail )
   {
-    this->I2CStop();
-    return ( 0 /*FALSE*/ );
+    // the bus is idle and nothing is queued: start right away
+    this->currentHandler = handler;
+    this->startTransaction(uDeviceAddr, txData, txLen, rxData, rxLen);
+    enableInterrupt(I2C_IRQn);
+    return true;
+  }
+
+  uint8_t next = (this->queueTail + 1) & (I2C_QUEUE_SIZE - 1);
+  if ( next == this->queueHead )
+  {
+    enableInterrupt(I2C_IRQn);
+    return false;  // the queue is full
+  }
+
+  I2cTransaction& entry = this->queue[this->queueTail];
+  entry.deviceAddr = uDeviceAddr;
+  entry.txData = txData;
+  entry.txLen = txLen;
+  entry.rxData = rxData;
+  entry.rxLen = rxLen;
+  entry.handler = handler;
+  this->queueTail = next;
+
+  enableInterrupt(I2C_IRQn);
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  serviceQueue
+**
+** Descriptions:  Called from the I2C interrupt when a transaction reached
+**                a terminal state: calls the per-transaction handler and
+**                starts the next queued transaction.
+**
+** parameters:    None
+** Returned value: None
+**
+*****************************************************************************/
+void I2C::serviceQueue()
+{
+  I2cTransactionHandler handler = this->currentHandler;
+  this->currentHandler = 0;
+
+  if ( handler )
+    handler(this->I2CMasterState);
+
+  if ( this->queueHead != this->queueTail )
+  {
+    I2cTransaction& entry = this->queue[this->queueHead];
+    this->queueHead = (this->queueHead + 1) & (I2C_QUEUE_SIZE - 1);
+
+    this->currentHandler = entry.handler;
+    this->startTransaction(entry.deviceAddr, entry.txData, entry.txLen,
+        entry.rxData, entry.rxLen);
   }
+}
+
+/*****************************************************************************
+** Function name:  transaction
+**
+** Descriptions:  Run a transaction like startTransaction() and wait until
+**                it is done. The wait is bounded: a stuck bus (e.g. a slave
+**                stretching the clock forever) leads to a timeout instead
+**                of a hanging loop.
+**
+** parameters:    Device address, send data and length, receive buffer and length
+** Returned value: Any of the I2CSTATE_... values or 0 on timeout. See i2c.h
+**
+*****************************************************************************/
+uint16_t I2C::transaction(uint8_t uDeviceAddr, const uint8_t *txData, uint16_t txLen,
+                          uint8_t *rxData, uint16_t rxLen)
+{
+  uint32_t timeout = 0;
+
+  if ( !this->startTransaction(uDeviceAddr, txData, txLen, rxData, rxLen) )
+    return ( 0 /*FALSE*/ );
 
   // wait until the state is a terminal state
-  while (this->I2CMasterState < 0x100);
+  while ((this->I2CMasterState < 0x100) && (timeout < MAX_TIMEOUT))
+  {
+    timeout++;
+  }
+
+  if ( this->I2CMasterState < 0x100 )
+  {
+    this->I2CStop();
+    return ( 0 /*FALSE*/ );
+  }
 
   return ( this->I2CMasterState );
 }
 
+/*****************************************************************************
+** Function name:  I2CEngine
+**
+** Descriptions:  The routine to complete a I2C transaction from start to stop.
+**                All the intermitten steps are handled in the interrupt handler.
+**                Before this routine is called, the read length, write length
+**                and I2C master buffer need to be filled: the slave address
+**                is in I2CMasterBuffer[0], the data to send follows it and
+**                I2CWriteLength counts the address plus the data bytes.
+**
+** parameters:    None
+** Returned value: Any of the I2CSTATE_... values. See i2c.h
+**
+*****************************************************************************/
+uint16_t I2C::I2CEngine( void )
+{
+  uint16_t writeLength = this->I2CWriteLength ? this->I2CWriteLength - 1 : 0;
+
+  return this->transaction(this->I2CMasterBuffer[0], &this->I2CMasterBuffer[1],
+      writeLength, this->I2CSlaveBuffer, this->I2CReadLength);
+}
+
 /*****************************************************************************
 ** Function name:  I2CScan
 **
@@ -442,15 +809,10 @@ void I2C::ClearBuffer(bool bClearMaster, bool bClearSlave){
 *****************************************************************************/
 bool I2C::Write(uint8_t uDeviceAddr, const char *udata, uint8_t data_length)
 {
-  this->ClearBuffer(true, false); // clear MasterBuffer Only
-    this->I2CWriteLength     = 1 + data_length;
-    this->I2CReadLength      = 0;
-    this->I2CMasterBuffer[0] = uDeviceAddr;
-    for(uint8_t i=0; i < data_length; i++)
-    {
-      this->I2CMasterBuffer[i+1] = udata[i];
-    }
-  return (this->I2CEngine() == I2CSTATE_ACK) ? true:false;
+  // the data is sent directly from udata, without the detour through the
+  // master buffer (and its size limit)
+  return (this->transaction(uDeviceAddr, (const uint8_t*) udata, data_length,
+      0, 0) == I2CSTATE_ACK) ? true:false;
 }
 
 /*****************************************************************************
@@ -465,20 +827,10 @@ bool I2C::Write(uint8_t uDeviceAddr, const char *udata, uint8_t data_length)
 bool I2C::Read(uint8_t uDeviceAddr, char *udata, uint8_t data_read_length, uint16_t uDelayMS)
 {
   delay(uDelayMS);
-  bool bRet=false;
-  this->ClearBuffer(true, true); // clear MasterBuffer and SlaveBuffer
-    this->I2CWriteLength     = 2;
-    this->I2CReadLength      = data_read_length;
-    this->I2CMasterBuffer[0] = uDeviceAddr;
-    this->I2CMasterBuffer[1] = udata[0];    /* offset read address */
-    this->I2CMasterBuffer[2] = uDeviceAddr | RD_BIT;
-  if( this->I2CEngine() == I2CSTATE_ACK )
-  {
-    bRet= true;
-    for( uint8_t i=0; i < data_read_length; i++ )
-    {
-      udata[i]= this->I2CSlaveBuffer[i];
-    }
-  }
-  return bRet;
+  uint8_t offset = udata[0];    /* offset read address */
+
+  // write the offset, then read with a repeated start - directly into
+  // udata, without the detour through the slave buffer (and its size limit)
+  return this->transaction(uDeviceAddr, &offset, 1, (uint8_t*) udata,
+      data_read_length) == I2CSTATE_ACK;
 }
@@ -35,6 +35,8 @@ bool BH1750::BH1750Init()
 
   this->bBH1750InitState= false;
   this->uLuxCurrent= 0;
+  this->bBH1750Continuous= false;
+  this->uLuxMillis= 0;
 
   uint8_t uDataPowerOn[1]; uDataPowerOn[0] = BH1750_POWER_ON;
   uint8_t uDataReset[1]; uDataReset[0] = BH1750_RESET;
@@ -57,6 +59,7 @@ void BH1750::BH1750DeInit()
   this->uLuxCurrent= 0;
   this->PowerDownBH1750();
   this->bBH1750InitState= false;
+  this->bBH1750Continuous= false;
 }
 
 /*****************************************************************************
@@ -76,10 +79,75 @@ bool BH1750::PowerDownBH1750()
   return i2c_bh17->Write(BH17_ADDR, (const char*) uDataPowerOn, 1); // Send (Write): Power DOWN
 }
 
+/*****************************************************************************
+** Function name:  StartContinuous
+**
+** Descriptions:   Put the BH1750 into a continuous measurement mode. The
+**                 sensor then converts on its own and GetLux() only
+**                 fetches the latest result without waiting.
+**
+** parameters:     [in] uMode - e.g. BH1750_CONTINUOUS_HIGH_RES_MODE
+**
+** Returned value: true on success, false on failure
+**
+*****************************************************************************/
+bool BH1750::StartContinuous(uint8_t uMode)
+{
+  uint8_t uSendData[1];
+  uSendData[0] = uMode;
+  this->bBH1750Continuous= i2c_bh17->Write(BH17_ADDR, (const char*)uSendData, 1);
+  return this->bBH1750Continuous;
+}
+
+/*****************************************************************************
+** Function name:  ReadLux
+**
+** Descriptions:   Fetch the latest measurement result from the BH1750
+**                 into uLuxCurrent and time-stamp it.
+**
+** parameters:     none
+**
+** Returned value: true on success, false on failure
+**
+*****************************************************************************/
+bool BH1750::ReadLux()
+{
+  uint8_t uReadData[2];
+
+  // Read the lux value. The BH1750 has no register pointer, so this is a
+  // plain read transaction without an address write
+  if( i2c_bh17->WriteRead(BH17_ADDR, 0, 0, uReadData, 2) )
+  {
+    this->uLuxCurrent= ( ( uReadData[0] << 8) + uReadData[1] );// / 2;
+    this->uLuxMillis= millis();
+    return true;
+  }
+  return false;
+}
+
+/*****************************************************************************
+** Function name:  LuxAgeMs
+**
+** Descriptions:   The age of uLuxCurrent: the time since the last
+**                 successful fetch from the sensor.
+**
+** parameters:     none
+**
+** Returned value: age in milliseconds
+**
+*****************************************************************************/
+unsigned int BH1750::LuxAgeMs()
+{
+  return millis() - this->uLuxMillis;
+}
+
 /*****************************************************************************
 ** Function name:  GetLux
 **
-** Descriptions:   Read the LUX Value from BH1750
+** Descriptions:   Read the LUX Value from BH1750. In continuous mode (see
+**                 StartContinuous()) the latest result is fetched without
+**                 waiting, otherwise a one-shot measurement is triggered
+**                 and waited out.
 **
 ** parameters:     [out] Lux
 **
@@ -88,17 +156,15 @@ bool BH1750::PowerDownBH1750()
 *****************************************************************************/
 bool BH1750::GetLux()
 {
-  bool bRet= false;
-  uint8_t uSendData[2];
+  if( this->bBH1750Continuous )
+    return this->ReadLux();
+
+  uint8_t uSendData[1];
   uSendData[0] = BH17_CONFIG;
   if( i2c_bh17->Write(BH17_ADDR, (const char*)uSendData, 1) ) // Send (Write): Configure resolution_Mode register before reading
   {
-    uSendData[0] = 0x00;                                  // Start address to read the lux value
-    if(i2c_bh17->Read(BH17_ADDR, (char*)uSendData, 2, 200 ) )
-    {
-      this->uLuxCurrent= ( ( uSendData[0] << 8) + uSendData[1] );// / 2;
-      bRet=true;
-    }
+    delay(200);                                           // Wait for the measurement
+    return this->ReadLux();
   }
-  return bRet;
+  return false;
 }
@@ -11,11 +11,25 @@
 #include <sblib/core.h>
 #include <sblib/types.h>
 #include <sblib/i2c.h>
+#include <sblib/digital_pin.h>
 
 #include <sblib/i2c/ds3231.h>
 
 I2C *i2c_ds32;
 
+Ds3231* Ds3231::sqw_instance = 0;
+
+// The days of the months, for the cached time rollover
+static const uint8_t month_days[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+Ds3231::Ds3231()
+:sqw_pin(0)
+,cache_enabled(false)
+,resync_secs(0)
+,secs_since_sync(0)
+{
+}
+
 /*****************************************************************************
 ** Function name:  Ds3231Init
 **
@@ -107,8 +121,7 @@ bool Ds3231::GetTime(ds3231_time_t* time)
   uint8_t data[3];
 
   data[0] = SECONDS;
-  if( i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) data, 1) &&
-      i2c_ds32->Read(DS3231_I2C_ADRS, (char *)data, 3, 0) )
+  if( i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, 3) )
   {
     time->seconds = bcd_2_uchar(data[0]);
     time->minutes = bcd_2_uchar(data[1]);
@@ -177,8 +190,7 @@ bool Ds3231::GetCalendar(ds3231_calendar_t* calendar)
   uint8_t data[4];
 
   data[0] = DAY;
-  if( i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) data, 1) &&
-      i2c_ds32->Read(DS3231_I2C_ADRS, (char *)data, 4, 0) )
+  if( i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, 4) )
   {
     calendar->day = bcd_2_uchar(data[0]);
     calendar->date = bcd_2_uchar(data[1]);
@@ -190,6 +202,54 @@ bool Ds3231::GetCalendar(ds3231_calendar_t* calendar)
   } else return false;
 }
 
+/*****************************************************************************
+** Function name:  GetTimeDate
+**
+** Descriptions:   Burst read of the DS3231: time and calendar (and
+**                 optionally the temperature) are fetched with a single
+**                 sequential register read starting at SECONDS, instead
+**                 of one bus transaction per register group.
+**
+** parameters:     [in]  time - pointer to struct for storing time data
+**                 [in]  calendar - pointer to struct for storing calendar data
+**                 [in]  fTemperature - pointer for the temperature, 0 to
+**                       skip reading the temperature registers
+**                 [out] time, calendar, fTemperature - current rtc data
+**
+** Returned value: TRUE on success, FALSE on failure
+**
+*****************************************************************************/
+bool Ds3231::GetTimeDate(ds3231_time_t* time, ds3231_calendar_t* calendar,
+                         float* fTemperature)
+{
+  uint8_t data[LSB_TEMP + 1];
+
+  // read SECONDS..YEAR, or up to LSB_TEMP when the temperature is wanted
+  uint8_t count = fTemperature ? (LSB_TEMP + 1) : (YEAR + 1);
+
+  data[0] = SECONDS;
+  if( !i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, count) )
+    return false;
+
+  time->seconds = bcd_2_uchar(data[SECONDS]);
+  time->minutes = bcd_2_uchar(data[MINUTES]);
+  time->am_pm = (data[HOURS]&AM_PM);
+  time->mode = (data[HOURS]&MODE);
+
+  if(time->mode) time->hours = bcd_2_uchar((data[HOURS]&0x1F));
+  else time->hours = bcd_2_uchar((data[HOURS]&0x3F));
+
+  calendar->day = bcd_2_uchar(data[DAY]);
+  calendar->date = bcd_2_uchar(data[DATE]);
+  calendar->month = bcd_2_uchar((data[MONTH]&0x7F));
+  calendar->year = bcd_2_uchar(data[YEAR]);
+
+  if(fTemperature)
+    *fTemperature= (float)((data[MSB_TEMP]) + 0.25*(data[LSB_TEMP]>>6));
+
+  return true;
+}
+
 /*****************************************************************************
 ** Function name:  SetAlarm
 **
@@ -356,8 +416,7 @@ bool Ds3231::GetAlarm(ds3231_alrm_t* alarm, bool bAlarmNumber)
   if(bAlarmNumber)
   {
     data[0] = ALRM1_SECONDS;
-    if( (bRet = i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) data, 1)) &&
-        (bRet = i2c_ds32->Read(DS3231_I2C_ADRS, (char *)data, 4, 0)) )
+    if( (bRet = i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, 4)) )
     {
       alarm->seconds = bcd_2_uchar(data[0]&0x7F);
       alarm->am1 = (data[0]&ALRM_MASK);
@@ -382,8 +441,7 @@ bool Ds3231::GetAlarm(ds3231_alrm_t* alarm, bool bAlarmNumber)
   else
   {
     data[0] = ALRM2_MINUTES;
-    if( (bRet = i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) data, 1)) &&
-        (bRet = i2c_ds32->Read(DS3231_I2C_ADRS, (char *)data, 3, 0)) )
+    if( (bRet = i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, 3)) )
     {
       alarm->minutes = bcd_2_uchar(data[0]&0x7F);
       alarm->am2 = (data[0]&ALRM_MASK);
@@ -457,8 +515,7 @@ bool Ds3231::GetCtrlStatReg(ds3231_cntl_stat_t* data)
   local_data[1] = data->control;
   local_data[2] = data->status;
 
-  if( ( i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) local_data, 1)) &&
-      ( i2c_ds32->Read(DS3231_I2C_ADRS, (char *) local_data, 2, 0)) )
+  if( i2c_ds32->WriteRead(DS3231_I2C_ADRS, local_data, 1, local_data, 2) )
   {
     data->control = local_data[0];
     data->status = local_data[1];
@@ -487,7 +544,7 @@ time_t Ds3231::GetEpoch(void)
   ds3231_time_t         rtc_time = {0,0,0,0,0}; //RTC vars
   ds3231_calendar_t rtc_calendar = {0,0,0,0};
 
-  if( this->GetCalendar(&rtc_calendar) &&  this->GetTime(&rtc_time) )
+  if( this->GetTimeDate(&rtc_time, &rtc_calendar) )
   {
     sys_time.tm_wday = rtc_calendar.day - 1;
     sys_time.tm_mday = rtc_calendar.date;
@@ -622,8 +679,7 @@ float Ds3231::GetTemperature()
   float fRet=-999;
   uint8_t data[2];
   data[0] = MSB_TEMP;
-  if( i2c_ds32->Write(DS3231_I2C_ADRS, (const char*) data, 1) &&
-      i2c_ds32->Read(DS3231_I2C_ADRS, (char *)data, 4, 0) )
+  if( i2c_ds32->WriteRead(DS3231_I2C_ADRS, data, 1, data, 2) )
   {
     //iRet= int(data[0] << 8); iRet |= int(data[1]);  //HEX
     //iRet= int(data[0]+data[1]/256.0);                 //approx.
@@ -632,6 +688,180 @@ float Ds3231::GetTemperature()
   return fRet;
 }
 
+/*****************************************************************************
+** Function name:  EnableCachedTime
+**
+** Descriptions:   Enable the cached time mode: the SQW output of the
+**                 DS3231 is configured to 1Hz and its GPIO interrupt
+**                 increments a RAM copy of time and calendar, so
+**                 GetCachedTimeDate() is a RAM read. The cache is
+**                 resynced over I2C every resyncSeconds.
+**
+**                 The application must create the interrupt handler of
+**                 the SQW pin's GPIO port with PIN_INTERRUPT_HANDLER,
+**                 see digital_pin.h.
+**
+** parameters:     [in] sqwPin - the GPIO pin wired to the SQW output
+**                 [in] resyncSeconds - the seconds between two I2C
+**                      resyncs (default 3600)
+**
+** Returned value: TRUE on success, FALSE on failure
+**
+** Example: rtc.EnableCachedTime(PIO1_4);
+**          PIN_INTERRUPT_HANDLER(EINT1_IRQHandler, 1);
+**
+*****************************************************************************/
+bool Ds3231::EnableCachedTime(int sqwPin, uint32_t resyncSeconds)
+{
+  if( !this->GetTimeDate(&cached_time, &cached_calendar) )
+    return false;
+
+  // 1Hz square wave on SQW, also on battery
+  if( !this->EnableOscillator(true, true, RS_bit_SQW_1Hz) )
+    return false;
+
+  sqw_pin = sqwPin;
+  resync_secs = resyncSeconds;
+  secs_since_sync = 0;
+  cache_enabled = true;
+  sqw_instance = this;
+
+  pinMode(sqwPin, INPUT | PULL_UP);  // SQW is open drain
+  attachPinInterrupt(sqwPin, SqwIsr, INTERRUPT_EDGE_FALLING);
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  DisableCachedTime
+**
+** Descriptions:   Disable the cached time mode again.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void Ds3231::DisableCachedTime()
+{
+  if( !cache_enabled ) return;
+
+  detachPinInterrupt(sqw_pin);
+  cache_enabled = false;
+  if( sqw_instance == this ) sqw_instance = 0;
+}
+
+/*****************************************************************************
+** Function name:  GetCachedTimeDate
+**
+** Descriptions:   Get the cached time and calendar: a RAM read, no I2C
+**                 transaction. When the resync interval has elapsed the
+**                 cache is refreshed from the chip first, so the drift
+**                 of the interrupt driven copy stays bounded.
+**
+** parameters:     [in]  time - pointer to struct for storing time data
+**                 [in]  calendar - pointer to struct for storing calendar data
+**                 [out] time, calendar - current cached rtc data
+**
+** Returned value: TRUE on success, FALSE if the cached time mode is off
+**
+*****************************************************************************/
+bool Ds3231::GetCachedTimeDate(ds3231_time_t* time, ds3231_calendar_t* calendar)
+{
+  if( !cache_enabled ) return false;
+
+  if( secs_since_sync >= resync_secs )
+  {
+    ds3231_time_t t;
+    ds3231_calendar_t c;
+
+    if( this->GetTimeDate(&t, &c) )
+    {
+      pinDisableInterrupt(sqw_pin);
+      cached_time = t;
+      cached_calendar = c;
+      secs_since_sync = 0;
+      pinEnableInterrupt(sqw_pin);
+    }
+  }
+
+  pinDisableInterrupt(sqw_pin);
+  *time = cached_time;
+  *calendar = cached_calendar;
+  pinEnableInterrupt(sqw_pin);
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  SqwTick
+**
+** Descriptions:   Advance the cached time by one second. Called from the
+**                 SQW pin interrupt.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void Ds3231::SqwTick()
+{
+  TickTime();
+  ++secs_since_sync;
+}
+
+void Ds3231::SqwIsr()
+{
+  if( sqw_instance ) sqw_instance->SqwTick();
+}
+
+/*****************************************************************************
+** Function name:  TickTime
+**
+** Descriptions:   Private member fx, rolls the cached time and calendar
+**                 over by one second, honoring 12/24 hour mode, month
+**                 lengths and the leap years 2000-2099.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void Ds3231::TickTime()
+{
+  if( ++cached_time.seconds < 60 ) return;
+  cached_time.seconds = 0;
+  if( ++cached_time.minutes < 60 ) return;
+  cached_time.minutes = 0;
+
+  bool midnight = false;
+  if( cached_time.mode ) // 12 hour mode
+  {
+    if( ++cached_time.hours == 13 ) cached_time.hours = 1;
+    if( cached_time.hours == 12 )
+    {
+      cached_time.am_pm = !cached_time.am_pm;
+      midnight = !cached_time.am_pm;
+    }
+  }
+  else if( ++cached_time.hours == 24 ) // 24 hour mode
+  {
+    cached_time.hours = 0;
+    midnight = true;
+  }
+  if( !midnight ) return;
+
+  cached_calendar.day = (cached_calendar.day % 7) + 1;
+
+  uint8_t days = month_days[(cached_calendar.month - 1) % 12];
+  if( cached_calendar.month == 2 && !(cached_calendar.year & 3) )
+    ++days; // 2000-2099: every 4th year is a leap year
+
+  if( ++cached_calendar.date <= days ) return;
+  cached_calendar.date = 1;
+  if( ++cached_calendar.month <= 12 ) return;
+  cached_calendar.month = 1;
+  ++cached_calendar.year;
+}
+
 /*****************************************************************************
 ** Function name:  uchar_2_bcd
 **
@@ -10,6 +10,8 @@
 
 #include <sblib/interrupt.h>
 #include <sblib/platform.h>
+#include <sblib/timer.h>
+#include <sblib/flash_log.h>
 #include <string.h>
 
 // The maximum memory that is tested when searching for the flash size, in bytes
@@ -37,14 +39,16 @@ enum IAP_Command
 };
 
 /**
- * A container for the interface to the IAP function calls.
+ * A container for the interface to the IAP function calls. The fields
+ * are unsigned long: 32 bits on the device, and wide enough for the
+ * host's pointers in the IAP emulation of the tests.
  */
 struct IAP_Parameter
 {
-    unsigned int cmd;         //!< Command
-    unsigned int par[4];      //!< Parameters
-    unsigned int stat;        //!< Status
-    unsigned int res[4];      //!< Result
+    unsigned long cmd;        //!< Command
+    unsigned long par[4];     //!< Parameters
+    unsigned long stat;       //!< Status
+    unsigned long res[4];     //!< Result
 };
 
 // The size of the flash in bytes. Use iapFlashSize() to get the flash size.
@@ -55,7 +59,7 @@ int iapFlashBytes = 0;
  * IAP call function (DO NOT USE UNLESS YOU KNOW WHAT YOU ARE DOING!)
  * use instead: IAP_Call_InterruptSafe()
  */
-typedef void (*IAP_Func)(unsigned int * cmd, unsigned int * stat);
+typedef void (*IAP_Func)(unsigned long * cmd, unsigned long * stat);
 
 #ifndef IAP_EMULATION
 #  if defined(__LPC11XX__) || defined(__LPC11UXX__) || defined(__LPC13XX__) || defined(__LPC17XX__)
@@ -67,7 +71,7 @@ typedef void (*IAP_Func)(unsigned int * cmd, unsigned int * stat);
 #  endif
 #  define IAP_Call ((IAP_Func) IAP_LOCATION)
 #else
-   extern "C" void IAP_Call (unsigned int * cmd, unsigned int * stat);
+   extern "C" void IAP_Call (unsigned long * cmd, unsigned long * stat);
 #endif
 
 
@@ -81,72 +85,195 @@ typedef void (*IAP_Func)(unsigned int * cmd, unsigned int * stat);
  *         Vector Table is located in the Flash this will fail and raise a
  *         non-handled HardFault condition.
  */
-inline void IAP_Call_InterruptSafe(unsigned int *cmd, unsigned int *stat)
+inline void IAP_Call_InterruptSafe(unsigned long *cmd, unsigned long *stat)
 {
     noInterrupts();
     IAP_Call(cmd, stat);
     interrupts();
 }
 
-static IAP_Status _prepareSector(int sector)
+// The statistics of the flash operations, see iapStats in iap.h
+IapStats iapStats;
+
+// The timer that measures the flash call durations, 0 if none
+static Timer* statsTimer;
+
+void iapStatsEnable(Timer& timer)
+{
+    timer.begin();
+    timer.prescaler((SystemCoreClock / 1000000) - 1); // let the timer count microseconds
+    timer.start();
+    statsTimer = &timer;
+}
+
+int iapStatsSave(FlashLog& log)
+{
+    return log.appendRecord((const byte*) &iapStats);
+}
+
+int iapStatsRestore(FlashLog& log)
+{
+    return log.latestRecord((byte*) &iapStats);
+}
+
+/*
+ * Get the start time for a flash call duration measurement.
+ */
+static unsigned int statsTime()
+{
+    return statsTimer ? statsTimer->value() : 0;
+}
+
+/*
+ * Record the duration of a flash call that started at startTime.
+ */
+static void statsDuration(unsigned int startTime, unsigned int& min,
+    unsigned int& max, unsigned int& last)
+{
+    if (!statsTimer)
+        return;
+
+    unsigned int elapsed = statsTimer->value() - startTime;
+
+    last = elapsed;
+    if (elapsed > max) max = elapsed;
+    if (!min || elapsed < min) min = elapsed;
+}
+
+/*
+ * Count an erase of the sectors startSector..endSector and record the call
+ * duration.
+ */
+static void statsCountErase(int startSector, int endSector, unsigned int startTime)
+{
+    for (int s = startSector; s <= endSector && s < IAP_STATS_SECTORS; ++s)
+        ++iapStats.sector[s].erases;
+
+    statsDuration(startTime, iapStats.eraseMin, iapStats.eraseMax, iapStats.eraseLast);
+}
+
+/*
+ * Count a program operation of the sector and record the call duration.
+ */
+static void statsCountProgram(int sector, unsigned int startTime)
+{
+    if (sector < IAP_STATS_SECTORS)
+        ++iapStats.sector[sector].programs;
+
+    statsDuration(startTime, iapStats.programMin, iapStats.programMax, iapStats.programLast);
+}
+
+static IAP_Status _prepareSectorRange(int startSector, int endSector)
 {
     IAP_Parameter p;
 
     p.cmd = CMD_PREPARE;
-    p.par[0] = sector;
-    p.par[1] = sector;
+    p.par[0] = startSector;
+    p.par[1] = endSector;
     IAP_Call_InterruptSafe(&p.cmd, &p.stat);
 
     return (IAP_Status) p.stat;
 }
 
-IAP_Status iapEraseSector(int sector)
+static IAP_Status _prepareSector(int sector)
+{
+    return _prepareSectorRange(sector, sector);
+}
+
+static IAP_Status _erasePageRange(int startPage, int endPage)
 {
     IAP_Parameter p;
+    unsigned int startTime = statsTime();
 
-    p.stat = _prepareSector(sector);
+    p.stat = _prepareSectorRange(startPage / 16, endPage / 16); // 16 pages per sector
+
+    if (p.stat == IAP_SUCCESS)
+    {
+        p.cmd = CMD_ERASE_PAGE;
+        p.par[0] = startPage;
+        p.par[1] = endPage;
+        p.par[2] = SystemCoreClock / 1000;
+        IAP_Call_InterruptSafe(&p.cmd, &p.stat);
+    }
+    statsCountErase(startPage / 16, endPage / 16, startTime);
+    return (IAP_Status) p.stat;
+}
+
+static IAP_Status _eraseSectorRange(int startSector, int endSector)
+{
+    IAP_Parameter p;
+    unsigned int startTime = statsTime();
+
+    p.stat = _prepareSectorRange(startSector, endSector);
 
     if (p.stat == IAP_SUCCESS)
     {
         p.cmd = CMD_ERASE;
-        p.par[0] = sector;
-        p.par[1] = sector;
+        p.par[0] = startSector;
+        p.par[1] = endSector;
         p.par[2] = SystemCoreClock / 1000;
         IAP_Call_InterruptSafe(&p.cmd, &p.stat);
 
         if (p.stat == IAP_SUCCESS)
         {
             p.cmd = CMD_BLANK_CHECK;
-            p.par[0] = sector;
-            p.par[1] = sector;
+            p.par[0] = startSector;
+            p.par[1] = endSector;
             IAP_Call_InterruptSafe(&p.cmd, &p.stat);
         }
     }
+    statsCountErase(startSector, endSector, startTime);
     return (IAP_Status) p.stat;
 }
 
+IAP_Status iapEraseSector(int sector)
+{
+    return _eraseSectorRange(sector, sector);
+}
+
 IAP_Status iapErasePage(int pageNumber)
 {
-    unsigned int sector = pageNumber / 16; // each sector has 16 pages
-    IAP_Parameter p;
+    return _erasePageRange(pageNumber, pageNumber);
+}
 
-    p.stat = _prepareSector(sector);
+IAP_Status iapEraseRange(int startPage, int endPage)
+{
+    if (startPage > endPage)
+        return IAP_COUNT_ERROR;
 
-    if (p.stat == IAP_SUCCESS)
+    // The sectors that the range covers completely, 16 pages per sector
+    int firstFullSector = (startPage + 15) / 16;
+    int lastFullSector = (endPage + 1) / 16 - 1;
+
+    if (lastFullSector < firstFullSector)
+        return _erasePageRange(startPage, endPage); // no whole sector covered
+
+    IAP_Status rc;
+
+    // The partial sector before the full sectors, page by page
+    if (startPage < firstFullSector * 16)
     {
-        p.cmd = CMD_ERASE_PAGE;
-        p.par[0] = pageNumber;
-        p.par[1] = pageNumber;
-        p.par[2] = SystemCoreClock / 1000;
-        IAP_Call_InterruptSafe(&p.cmd, &p.stat);
+        rc = _erasePageRange(startPage, firstFullSector * 16 - 1);
+        if (rc != IAP_SUCCESS)
+            return rc;
     }
-    return (IAP_Status) p.stat;
+
+    rc = _eraseSectorRange(firstFullSector, lastFullSector);
+    if (rc != IAP_SUCCESS)
+        return rc;
+
+    // The partial sector after the full sectors, page by page
+    if (endPage >= (lastFullSector + 1) * 16)
+        rc = _erasePageRange((lastFullSector + 1) * 16, endPage);
+
+    return rc;
 }
 
 IAP_Status iapProgram(byte* rom, const byte* ram, unsigned int size)
 {
     IAP_Parameter p;
     int sector = iapSectorOfAddress(rom);
+    unsigned int startTime = statsTime();
 
     /* first we need to 'unlock' the sector */
     p.stat = _prepareSector(sector);
@@ -155,8 +282,8 @@ IAP_Status iapProgram(byte* rom, const byte* ram, unsigned int size)
     {
         /* then we can `copy` the RAM content to the FLASH */
         p.cmd = CMD_COPY_RAM2FLASH;
-        p.par[0] = (unsigned int) (unsigned long) rom;
-        p.par[1] = (unsigned int) (unsigned long) ram;
+        p.par[0] = (unsigned long) rom;
+        p.par[1] = (unsigned long) ram;
         p.par[2] = size;
         p.par[3] = SystemCoreClock / 1000;
         IAP_Call_InterruptSafe(&p.cmd, &p.stat);
@@ -164,15 +291,210 @@ IAP_Status iapProgram(byte* rom, const byte* ram, unsigned int size)
         if (p.stat == IAP_SUCCESS)
         {
             p.cmd = CMD_COMPARE;
-            p.par[0] = (unsigned int) (unsigned long) rom;
-            p.par[1] = (unsigned int) (unsigned long) ram;
+            p.par[0] = (unsigned long) rom;
+            p.par[1] = (unsigned long) ram;
             p.par[2] = size;
             IAP_Call_InterruptSafe(&p.cmd, &p.stat);
         }
     }
+    statsCountProgram(sector, startTime);
+    return (IAP_Status) p.stat;
+}
+
+IAP_Status iapProgramFast(byte* rom, const byte* ram, unsigned int size)
+{
+    IAP_Parameter p;
+
+    p.stat = _prepareSector(iapSectorOfAddress(rom));
+
+    if (p.stat == IAP_SUCCESS)
+    {
+        p.cmd = CMD_COPY_RAM2FLASH;
+        p.par[0] = (unsigned long) rom;
+        p.par[1] = (unsigned long) ram;
+        p.par[2] = size;
+        p.par[3] = SystemCoreClock / 1000;
+        IAP_Call_InterruptSafe(&p.cmd, &p.stat);
+    }
     return (IAP_Status) p.stat;
 }
 
+IAP_Status iapProgramScatter(const IapRegion* regions, int count)
+{
+    int i;
+
+    // Validate the whole batch before touching the flash
+    for (i = 0; i < count; ++i)
+    {
+        const IapRegion& region = regions[i];
+
+        if ((region.rom - FLASH_BASE_ADDRESS) & (FLASH_PAGE_SIZE - 1))
+            return IAP_DST_ADDR_ERROR;
+        if (!region.size || (region.size & (FLASH_PAGE_SIZE - 1)))
+            return IAP_COUNT_ERROR;
+        if (region.rom + region.size > FLASH_BASE_ADDRESS + iapFlashSize())
+            return IAP_DST_ADDR_NOT_MAPPED;
+    }
+
+    // Erase the pages of the batch, merging adjacent or overlapping regions
+    // into single erase calls
+    i = 0;
+    while (i < count)
+    {
+        int startPage = iapPageOfAddress(regions[i].rom);
+        int endPage = iapPageOfAddress(regions[i].rom + regions[i].size - 1);
+
+        while (i + 1 < count && iapPageOfAddress(regions[i + 1].rom) <= endPage + 1)
+        {
+            ++i;
+            int lastPage = iapPageOfAddress(regions[i].rom + regions[i].size - 1);
+            if (lastPage > endPage)
+                endPage = lastPage;
+        }
+
+        IAP_Status rc = iapEraseRange(startPage, endPage);
+        if (rc != IAP_SUCCESS)
+            return rc;
+        ++i;
+    }
+
+    // Program and verify the regions, in the largest chunks the IAP copy
+    // command accepts, without crossing a sector boundary in one call
+    for (i = 0; i < count; ++i)
+    {
+        byte* rom = regions[i].rom;
+        const byte* ram = regions[i].ram;
+        unsigned int remaining = regions[i].size;
+
+        while (remaining)
+        {
+            unsigned int toSectorEnd = FLASH_SECTOR_SIZE
+                - ((rom - FLASH_BASE_ADDRESS) & (FLASH_SECTOR_SIZE - 1));
+            unsigned int chunk = 256;
+
+            if (remaining >= 1024 && toSectorEnd >= 1024) chunk = 1024;
+            else if (remaining >= 512 && toSectorEnd >= 512) chunk = 512;
+
+            IAP_Status rc = iapProgram(rom, ram, chunk);
+            if (rc != IAP_SUCCESS)
+                return rc;
+
+            rom += chunk;
+            ram += chunk;
+            remaining -= chunk;
+        }
+    }
+
+    return IAP_SUCCESS;
+}
+
+//
+// Asynchronous flash engine: one job at a time, sequenced in single IAP
+// calls by iapAsyncStep(). Each step still blocks the interrupts for the
+// duration of one ROM call, but the caller controls when a step runs, so
+// the steps can be placed into bus idle gaps (see bcu.loop()).
+//
+
+enum IapAsyncState
+{
+    ASYNC_IDLE,     //!< No asynchronous operation pending
+    ASYNC_ERASE,    //!< A page erase is pending
+    ASYNC_PROGRAM,  //!< Programming is pending
+    ASYNC_COMPARE   //!< Programming is done, the verify is pending
+};
+
+static int asyncState = ASYNC_IDLE;
+static int asyncPage;             // the page to erase
+static byte* asyncRom;            // the flash address to program
+static const byte* asyncRam;      // the RAM buffer to program from
+static unsigned int asyncSize;    // the number of bytes to program
+static IapCallback asyncDone;     // the completion callback
+
+/*
+ * Finish the asynchronous operation and invoke the completion callback.
+ */
+static void asyncFinish(IAP_Status status)
+{
+    IapCallback done = asyncDone;
+
+    asyncState = ASYNC_IDLE;
+    asyncDone = 0;
+
+    if (done) done(status);
+}
+
+bool iapAsyncErasePage(int pageNumber, IapCallback done)
+{
+    if (asyncState != ASYNC_IDLE)
+        return false;
+
+    asyncPage = pageNumber;
+    asyncDone = done;
+    asyncState = ASYNC_ERASE;
+    return true;
+}
+
+bool iapAsyncProgram(byte* rom, const byte* ram, unsigned int size, IapCallback done)
+{
+    if (asyncState != ASYNC_IDLE)
+        return false;
+
+    asyncRom = rom;
+    asyncRam = ram;
+    asyncSize = size;
+    asyncDone = done;
+    asyncState = ASYNC_PROGRAM;
+    return true;
+}
+
+bool iapAsyncBusy()
+{
+    return asyncState != ASYNC_IDLE;
+}
+
+void iapAsyncStep()
+{
+    IAP_Parameter p;
+
+    switch (asyncState)
+    {
+    case ASYNC_ERASE:
+        asyncFinish(iapErasePage(asyncPage));
+        break;
+
+    case ASYNC_PROGRAM:
+    {
+        unsigned int startTime = statsTime();
+
+        p.stat = _prepareSector(iapSectorOfAddress(asyncRom));
+        if (p.stat == IAP_SUCCESS)
+        {
+            p.cmd = CMD_COPY_RAM2FLASH;
+            p.par[0] = (unsigned long) asyncRom;
+            p.par[1] = (unsigned long) asyncRam;
+            p.par[2] = asyncSize;
+            p.par[3] = SystemCoreClock / 1000;
+            IAP_Call_InterruptSafe(&p.cmd, &p.stat);
+        }
+        statsCountProgram(iapSectorOfAddress(asyncRom), startTime);
+
+        if (p.stat == IAP_SUCCESS)
+            asyncState = ASYNC_COMPARE;  // verify in the next step
+        else asyncFinish((IAP_Status) p.stat);
+        break;
+    }
+
+    case ASYNC_COMPARE:
+        p.cmd = CMD_COMPARE;
+        p.par[0] = (unsigned long) asyncRom;
+        p.par[1] = (unsigned long) asyncRam;
+        p.par[2] = asyncSize;
+        IAP_Call_InterruptSafe(&p.cmd, &p.stat);
+        asyncFinish((IAP_Status) p.stat);
+        break;
+    }
+}
+
 IAP_Status iapReadUID(byte* uid)
 {
     IAP_Parameter p;
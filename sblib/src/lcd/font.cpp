@@ -15,5 +15,26 @@ Font::Font(int firstChar, int numChars, int charWidth, const char* data)
 ,numChars(numChars)
 ,charWidth(charWidth)
 ,data(data)
+,widths(0)
+,offsets(0)
 {
 }
+
+Font::Font(int firstChar, int numChars, int charWidth, const char* data,
+    const unsigned char* widths, const unsigned short* offsets)
+:firstChar(firstChar)
+,numChars(numChars)
+,charWidth(charWidth)
+,data(data)
+,widths(widths)
+,offsets(offsets)
+{
+}
+
+int Font::textWidth(const char* text) const
+{
+    int width = 0;
+    for (; *text; ++text)
+        width += charWidthOf(*text);
+    return width;
+}
@@ -10,11 +10,342 @@
 
 #include <sblib/lcd/graphical.h>
 #include <sblib/lcd/font.h>
+#include <sblib/utils.h>
 
 
 LcdGraphical::LcdGraphical(const Font& fnt, int width, int height)
 :fnt(&fnt)
 ,width(width)
 ,height(height)
+,fb(0)
+,shadow(0)
+{
+    for (int page = 0; page < LCD_MAX_PAGES; ++page)
+    {
+        dirtyMin[page] = 255;
+        dirtyMax[page] = 0;
+    }
+}
+
+void LcdGraphical::frameBuffer(byte* buffer)
+{
+    fb = buffer;
+
+    byte* p = buffer;
+    for (int i = width * height; i > 0; --i)
+        *p++ = 0;
+
+    // Transfer the whole (cleared) framebuffer with the first flush
+    for (int page = 0; page < height; ++page)
+        markDirty(page, 0, width - 1);
+}
+
+void LcdGraphical::clear()
+{
+    if (!fb)
+        return;
+
+    byte* p = fb;
+    for (int i = width * height; i > 0; --i)
+        *p++ = 0;
+
+    for (int page = 0; page < height; ++page)
+        markDirty(page, 0, width - 1);
+}
+
+void LcdGraphical::drawString(int x, int page, const char* text)
+{
+    if (!fb || page < 0 || page >= height || !text)
+        return;
+
+    // Clip once: skip the glyphs that are completely left of the display
+    while (*text && x + fnt->charWidthOf(*text) <= 0)
+    {
+        x += fnt->charWidthOf(*text);
+        ++text;
+    }
+
+    const int startX = x < 0 ? 0 : x;
+    byte* row = fb + page * width;
+
+    for (; *text && x < width; ++text)
+    {
+        int idx = *text - fnt->firstChar;
+        if (idx < 0 || idx >= fnt->numChars)
+            continue;
+
+        int charWidth = fnt->widths ? fnt->widths[idx] : fnt->charWidth;
+        const byte* glyph = (const byte*) fnt->data + fnt->charOffset(idx);
+
+        if (x >= 0 && x + charWidth <= width)
+        {
+            // The common case: the glyph is completely visible
+            copyData(row + x, glyph, charWidth);
+        }
+        else
+        {
+            // A clipped glyph at the display border
+            for (int col = 0; col < charWidth; ++col)
+            {
+                if (x + col >= 0 && x + col < width)
+                    row[x + col] = glyph[col];
+            }
+        }
+
+        x += charWidth;
+    }
+
+    if (x > width)
+        x = width;
+    if (x > startX)
+        markDirty(page, startX, x - 1);
+}
+
+bool LcdGraphical::flushChunk(int maxBytes)
+{
+    if (!fb)
+        return false;
+
+    bool sent = false;
+
+    for (int page = 0; page < height; ++page)
+    {
+        if (dirtyMin[page] >= dirtyMax[page])
+            continue;
+        if (sent)
+            return true;  // the chunk of this call was already sent
+
+        int x = dirtyMin[page];
+        int end = dirtyMax[page];
+        byte* row = fb + page * width;
+
+        if (shadow)
+        {
+            byte* last = shadow + page * width;
+
+            while (x < end && row[x] == last[x])
+                ++x;
+            while (end > x && row[end - 1] == last[end - 1])
+                --end;
+
+            if (x >= end)
+            {
+                dirtyMin[page] = 255;
+                dirtyMax[page] = 0;
+                continue;
+            }
+        }
+
+        int count = end - x;
+        if (count > maxBytes)
+            count = maxBytes;
+
+        if (shadow)
+            copyData(shadow + page * width + x, row + x, count);
+
+        writePage(page, x, row + x, count);
+        sent = true;
+
+        if (x + count >= end)
+        {
+            dirtyMin[page] = 255;
+            dirtyMax[page] = 0;
+        }
+        else
+        {
+            dirtyMin[page] = x + count;
+            dirtyMax[page] = end;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void LcdGraphical::drawBitmap(int x, int page, const byte* data, int bmWidth,
+    int bmPages)
+{
+    if (!fb)
+        return;
+
+    for (int row = 0; row < bmPages; ++row, data += bmWidth)
+    {
+        int dstPage = page + row;
+        if (dstPage < 0 || dstPage >= height)
+            continue;
+
+        int col0 = x < 0 ? -x : 0;
+        int col1 = x + bmWidth > width ? width - x : bmWidth;
+        if (col0 >= col1)
+            continue;
+
+        copyData(fb + dstPage * width + x + col0, data + col0, col1 - col0);
+        markDirty(dstPage, x + col0, x + col1 - 1);
+    }
+}
+
+// The state of a streamed RLE decode, see lcdResourceDecode() for the format
+struct RleStream
+{
+    const byte* src;   //!< The encoded input
+    int remaining;     //!< The remaining bytes of the current block
+    byte value;        //!< The byte of the current run
+    bool run;          //!< If the current block is a run
+};
+
+/*
+ * Get the next decoded byte of an RLE stream.
+ */
+static byte rleNext(RleStream& s)
+{
+    if (!s.remaining)
+    {
+        int ctrl = *s.src++;
+        if (ctrl < 0x80)
+        {
+            s.remaining = ctrl + 1;
+            s.run = false;
+        }
+        else
+        {
+            s.remaining = ctrl - 0x80 + 2;
+            s.run = true;
+            s.value = *s.src++;
+        }
+    }
+
+    --s.remaining;
+    return s.run ? s.value : *s.src++;
+}
+
+void LcdGraphical::drawBitmapRLE(int x, int page, const byte* data, int bmWidth,
+    int bmPages)
+{
+    if (!fb)
+        return;
+
+    RleStream stream = { data, 0, 0, false };
+
+    for (int row = 0; row < bmPages; ++row)
+    {
+        int dstPage = page + row;
+        byte* dstRow = fb + dstPage * width;
+        bool visible = dstPage >= 0 && dstPage < height;
+
+        int col0 = bmWidth, col1 = -1;
+        for (int col = 0; col < bmWidth; ++col)
+        {
+            byte value = rleNext(stream);
+
+            if (visible && x + col >= 0 && x + col < width)
+            {
+                dstRow[x + col] = value;
+                if (col < col0)
+                    col0 = col;
+                col1 = col;
+            }
+        }
+
+        if (col1 >= col0)
+            markDirty(dstPage, x + col0, x + col1);
+    }
+}
+
+void LcdGraphical::fillPage(int page, int x, int count, byte pattern)
+{
+    if (!fb || page < 0 || page >= height)
+        return;
+
+    if (x < 0)
+    {
+        count += x;
+        x = 0;
+    }
+    if (x + count > width)
+        count = width - x;
+    if (count <= 0)
+        return;
+
+    byte* p = fb + page * width + x;
+    for (int i = count; i > 0; --i)
+        *p++ = pattern;
+
+    markDirty(page, x, x + count - 1);
+}
+
+void LcdGraphical::setPixel(int x, int y, bool set)
+{
+    if (!fb || x < 0 || x >= width || y < 0 || y >= (height << 3))
+        return;
+
+    byte* p = fb + (y >> 3) * width + x;
+    if (set)
+        *p |= 1 << (y & 7);
+    else *p &= ~(1 << (y & 7));
+
+    markDirty(y >> 3, x, x);
+}
+
+void LcdGraphical::shadowBuffer(byte* buffer)
+{
+    shadow = buffer;
+
+    // The display content is unknown: let the next flush transfer
+    // everything and prime the shadow frame
+    byte* p = buffer;
+    for (int i = width * height; i > 0; --i)
+        *p++ = 255;
+
+    for (int page = 0; page < height; ++page)
+        markDirty(page, 0, width - 1);
+}
+
+void LcdGraphical::flush()
+{
+    if (!fb)
+        return;
+
+    for (int page = 0; page < height; ++page)
+    {
+        if (dirtyMin[page] >= dirtyMax[page])
+            continue;
+
+        int x = dirtyMin[page];
+        int end = dirtyMax[page];
+        dirtyMin[page] = 255;
+        dirtyMax[page] = 0;
+
+        byte* row = fb + page * width;
+
+        if (shadow)
+        {
+            // Diff against the last transferred frame: shrink the span
+            // to the bytes that really changed
+            byte* last = shadow + page * width;
+
+            while (x < end && row[x] == last[x])
+                ++x;
+            while (end > x && row[end - 1] == last[end - 1])
+                --end;
+
+            if (x >= end)
+                continue;
+
+            copyData(last + x, row + x, end - x);
+        }
+
+        writePage(page, x, row + x, end - x);
+    }
+}
+
+void LcdGraphical::markDirty(int page, int x0, int x1)
+{
+    if (x0 < dirtyMin[page])
+        dirtyMin[page] = x0;
+    if (x1 >= dirtyMax[page])
+        dirtyMax[page] = x1 + 1;
+}
+
+void LcdGraphical::writePage(int page, int x, const byte* data, int count)
 {
 }
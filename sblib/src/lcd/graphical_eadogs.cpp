@@ -94,6 +94,8 @@ LcdGraphicalEADOGS::LcdGraphicalEADOGS(int spiPort, int pinData, int pinClock, i
 ,spi(spiPort)
 ,pinCD(pinCD)
 ,pinCS(pinCS)
+,cursorX(0)
+,cursorPage(0)
 {
     pinMode(pinData,  OUTPUT | SPI_MOSI);
     pinMode(pinClock, OUTPUT | SPI_CLOCK);
@@ -149,6 +151,12 @@ void LcdGraphicalEADOGS::inverse(bool enable)
 
 void LcdGraphicalEADOGS::pos(int x, int y)
 {
+    cursorX = x;
+    cursorPage = y;
+
+    if (fb)
+        return;
+
     digitalWrite(pinCD, 0);
     spi.transfer(CMD_COL_ADDR_LSB | (x & 15));
     spi.transfer(CMD_COL_ADDR_MSB | ((x >> 4) & 15));
@@ -161,27 +169,65 @@ int LcdGraphicalEADOGS::write(byte ch)
     if (idx < 0 || idx >= fnt->numChars)
         return 0;
 
-    idx *= fnt->charWidth;
+    int charWidth = fnt->widths ? fnt->widths[idx] : fnt->charWidth;
+    const byte* glyph = (const byte*) fnt->data + fnt->charOffset(idx);
+
+    if (fb)
+    {
+        // Draw into the framebuffer; flush() transfers the dirty columns
+        if (cursorX + charWidth > width)
+            return 0;
+
+        byte* p = fb + cursorPage * width + cursorX;
+        for (int i = charWidth; i > 0; --i)
+            *p++ = *glyph++;
+
+        markDirty(cursorPage, cursorX, cursorX + charWidth - 1);
+        cursorX += charWidth;
+        return 1;
+    }
 
     digitalWrite(pinCD, 1);
-    for (int i = fnt->charWidth; i > 0; --i, ++idx)
-        spi.transfer(fnt->data[idx]);
+    spi.transferBlock(glyph, 0, charWidth);
 
     return 1;
 }
 
+void LcdGraphicalEADOGS::writePage(int page, int x, const byte* data, int count)
+{
+    // One command setup and one continuous data stream per page: the
+    // controller auto-increments the column address within the page
+    const byte cmd[3] =
+    {
+        (byte) (CMD_COL_ADDR_LSB | (x & 15)),
+        (byte) (CMD_COL_ADDR_MSB | ((x >> 4) & 15)),
+        (byte) (CMD_PAGE_ADDR | (page & 7))
+    };
+
+    digitalWrite(pinCD, 0);
+    spi.transferBlock(cmd, 0, sizeof(cmd));
+
+    digitalWrite(pinCD, 1);
+    spi.transferBlock(data, 0, count);
+}
+
 void LcdGraphicalEADOGS::clear()
 {
     int x, y;
 
-    for (y = 0; y < DISPLAY_HEIGHT; ++y)
+    if (fb)
     {
-        pos(0, y);
-
-        digitalWrite(pinCD, 1);
-        for (x = 0; x < DISPLAY_WIDTH; ++x)
-            spi.transfer(0);
+        LcdGraphical::clear();
+        pos(0, 0);
+        return;
     }
 
+    byte zeros[DISPLAY_WIDTH];
+    for (x = 0; x < DISPLAY_WIDTH; ++x)
+        zeros[x] = 0;
+
+    for (y = 0; y < DISPLAY_HEIGHT; ++y)
+        writePage(y, 0, zeros, DISPLAY_WIDTH);
+
     pos(0, 0);
 }
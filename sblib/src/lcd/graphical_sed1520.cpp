@@ -10,23 +10,74 @@
  */
 
 #include <sblib/lcd/graphical_sed1520.h>
+#include <sblib/lcd/font.h>
 #include <sblib/digital_pin.h>
+#include <sblib/timer.h>
 
 #define DISPLAY_WIDTH 132
 #define DISPLAY_HEIGHT 4
 
+// The columns per display controller: the left controller drives the left
+// half of the display, the right controller the right half
+#define CHIP_WIDTH (DISPLAY_WIDTH / 2)
+
 #define DATA_PORT_PINMASK 255
 
 
+/*
+ * SED1520 programming commands
+ */
+
+// Set the column address: bits 0-6
+#define CMD_COL_ADDR    0x00
+
+// Set the page address: bits 0-1
+#define CMD_PAGE_ADDR   0xb8
+
+// Set the display start line: bits 0-4
+#define CMD_START_LINE  0xc0
+
+// Set normal column direction
+#define CMD_ADC_NORMAL  0xa0
+
+// Set mirrored column direction
+#define CMD_ADC_MIRROR  0xa1
+
+// Static drive off (normal operation)
+#define CMD_STATIC_OFF  0xa4
+
+// Static drive on (power save)
+#define CMD_STATIC_ON   0xa5
+
+// Select 1/16 duty
+#define CMD_DUTY_16     0xa8
+
+// Select 1/32 duty
+#define CMD_DUTY_32     0xa9
+
+// Disable the display (sleep mode)
+#define CMD_DISABLE     0xae
+
+// Enable the display (recover from sleep mode)
+#define CMD_ENABLE      0xaf
+
+// Reset the display
+#define CMD_RESET       0xe2
+
+
 LcdGraphicalSED1520::LcdGraphicalSED1520(int dataPort, int pinA0, int pinCS1, int pinCS2,
     int pinRD, int pinWR, const Font& fnt)
 :LcdGraphical(fnt, DISPLAY_WIDTH, DISPLAY_HEIGHT)
+,dataBus(dataPort, DATA_PORT_PINMASK)
+,wrStrobe(digitalPinToPort(pinWR), digitalPinToBitMask(pinWR))
 ,dataPort(dataPort)
 ,pinA0(pinA0)
 ,pinCS1(pinCS1)
 ,pinCS2(pinCS2)
 ,pinRD(pinRD)
 ,pinWR(pinWR)
+,cursorX(0)
+,cursorPage(0)
 {
     portMode(dataPort, DATA_PORT_PINMASK, INPUT);
     pinMode(pinA0, OUTPUT);
@@ -41,6 +92,137 @@ LcdGraphicalSED1520::LcdGraphicalSED1520(int dataPort, int pinA0, int pinCS1, in
     digitalWrite(pinWR, 1);
 }
 
+void LcdGraphicalSED1520::begin()
+{
+    portMode(dataPort, DATA_PORT_PINMASK, OUTPUT);
+
+    for (int chip = 0; chip < 2; ++chip)
+    {
+        writeCommand(chip, CMD_RESET);
+        writeCommand(chip, CMD_DUTY_32);
+        writeCommand(chip, CMD_ADC_NORMAL);
+        writeCommand(chip, CMD_STATIC_OFF);
+        writeCommand(chip, CMD_START_LINE | 0);
+        writeCommand(chip, CMD_ENABLE);
+    }
+}
+
+void LcdGraphicalSED1520::end()
+{
+    writeCommand(0, CMD_DISABLE);
+    writeCommand(1, CMD_DISABLE);
+}
+
+/*
+ * Strobe the byte on the data bus into the selected controller: one store
+ * for all 8 data lines, one store per WR edge. The timer based delay
+ * guarantees the write pulse width and cycle time of the controller
+ * independent of the CPU clock; at 1 usec per cycle the controller never
+ * needs busy polling.
+ */
+ALWAYS_INLINE void LcdGraphicalSED1520::strobeByte(byte value)
+{
+    dataBus.write(value);
+    wrStrobe.write(0);
+    delayMicroseconds(1);
+    wrStrobe.write(1);
+}
+
+void LcdGraphicalSED1520::writeCommand(int chip, byte cmd)
+{
+    digitalWrite(pinA0, 0);
+    digitalWrite(chip ? pinCS2 : pinCS1, 0);
+    strobeByte(cmd);
+    digitalWrite(chip ? pinCS2 : pinCS1, 1);
+}
+
+void LcdGraphicalSED1520::writeChipSpan(int chip, int page, int col, const byte* data, int count)
+{
+    writeCommand(chip, CMD_PAGE_ADDR | (page & 3));
+    writeCommand(chip, CMD_COL_ADDR | col);
+
+    // The controller auto-increments the column address, so the chip and
+    // data mode are selected once and only the byte strobes remain
+    digitalWrite(pinA0, 1);
+    digitalWrite(chip ? pinCS2 : pinCS1, 0);
+
+    while (count-- > 0)
+        strobeByte(*data++);
+
+    digitalWrite(chip ? pinCS2 : pinCS1, 1);
+}
+
+void LcdGraphicalSED1520::writePage(int page, int x, const byte* data, int count)
+{
+    if (x < CHIP_WIDTH)
+    {
+        int num = CHIP_WIDTH - x;
+        if (num > count) num = count;
+
+        writeChipSpan(0, page, x, data, num);
+        data += num;
+        x += num;
+        count -= num;
+    }
+
+    if (count > 0)
+        writeChipSpan(1, page, x - CHIP_WIDTH, data, count);
+}
+
+void LcdGraphicalSED1520::pos(int x, int y)
+{
+    cursorX = x;
+    cursorPage = y;
+}
+
+int LcdGraphicalSED1520::write(byte ch)
+{
+    int idx = ch - fnt->firstChar;
+    if (idx < 0 || idx >= fnt->numChars)
+        return 0;
+
+    int charWidth = fnt->widths ? fnt->widths[idx] : fnt->charWidth;
+    const byte* glyph = (const byte*) fnt->data + fnt->charOffset(idx);
+
+    if (cursorX + charWidth > width)
+        return 0;
+
+    if (fb)
+    {
+        // Draw into the framebuffer; flush() transfers the dirty columns
+        byte* p = fb + cursorPage * width + cursorX;
+        for (int i = charWidth; i > 0; --i)
+            *p++ = *glyph++;
+
+        markDirty(cursorPage, cursorX, cursorX + charWidth - 1);
+    }
+    else writePage(cursorPage, cursorX, glyph, charWidth);
+
+    cursorX += charWidth;
+    return 1;
+}
+
+void LcdGraphicalSED1520::clear()
+{
+    int x, y;
+
+    if (fb)
+    {
+        LcdGraphical::clear();
+        pos(0, 0);
+        return;
+    }
+
+    byte zeros[DISPLAY_WIDTH];
+    for (x = 0; x < DISPLAY_WIDTH; ++x)
+        zeros[x] = 0;
+
+    for (y = 0; y < DISPLAY_HEIGHT; ++y)
+        writePage(y, 0, zeros, DISPLAY_WIDTH);
+
+    pos(0, 0);
+}
+
 void LcdGraphicalSED1520::idle()
 {
 
@@ -0,0 +1,46 @@
+/*
+ *  resource.cpp - RLE compressed flash resources for LCD fonts and bitmaps.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/lcd/resource.h>
+
+
+const byte* lcdResourceDecode(const byte* src, byte* dst, int count)
+{
+    while (count > 0)
+    {
+        int ctrl = *src++;
+
+        if (ctrl < 0x80)
+        {
+            // A literal block of ctrl + 1 bytes
+            int num = ctrl + 1;
+            if (num > count)
+                num = count;
+            count -= num;
+
+            while (num-- > 0)
+                *dst++ = *src++;
+        }
+        else
+        {
+            // A run: the next byte, repeated ctrl - 0x80 + 2 times
+            int num = ctrl - 0x80 + 2;
+            if (num > count)
+                num = count;
+            count -= num;
+
+            byte value = *src++;
+            while (num-- > 0)
+                *dst++ = value;
+        }
+    }
+
+    return src;
+}
@@ -0,0 +1,65 @@
+/*
+ *  text_line.cpp - a cached text line widget for graphical LCD displays.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/lcd/text_line.h>
+
+
+LcdTextLine::LcdTextLine()
+: lcd(0)
+, x(0)
+, page(0)
+, regionWidth(0)
+, cache(0)
+, cacheSize(0)
+{
+}
+
+void LcdTextLine::begin(LcdGraphical& lcd, int x, int page, int width,
+    char* cache, int cacheSize)
+{
+    this->lcd = &lcd;
+    this->x = x;
+    this->page = page;
+    regionWidth = width;
+    this->cache = cache;
+    this->cacheSize = cacheSize;
+
+    invalidate();
+}
+
+void LcdTextLine::invalidate()
+{
+    if (cache)
+        cache[0] = 1;  // a string that no real content equals
+}
+
+bool LcdTextLine::show(const char* text)
+{
+    if (!lcd || !cache)
+        return false;
+
+    // The early-out: compare against the last drawn string
+    int i;
+    for (i = 0; i < cacheSize - 1 && text[i]; ++i)
+    {
+        if (cache[i] != text[i])
+            break;
+    }
+    if (cache[i] == text[i] || (i == cacheSize - 1 && cache[i] == 0))
+        return false;
+
+    for (i = 0; i < cacheSize - 1 && text[i]; ++i)
+        cache[i] = text[i];
+    cache[i] = 0;
+
+    lcd->fillPage(page, x, regionWidth);
+    lcd->drawString(x, page, cache);
+    return true;
+}
@@ -10,6 +10,7 @@
 #include <sblib/digital_pin.h>
 
 #include <sblib/arrays.h>
+#include <sblib/interrupt.h>
 #include <sblib/platform.h>
 #include <sblib/utils.h>
 
@@ -154,11 +155,47 @@ void pinInterruptMode(int pin, int mode)
     if (mode & 0x010) port->IBE |=  mask;
     else              port->IBE &= ~mask;
 
-    /* Set the edge/level type configuration */
-    if (mode & 0x100) port->IEV |=  mask;
+    /* Set the edge/level type configuration: rising edge or high level */
+    if (mode & 0x001) port->IEV |=  mask;
     else              port->IEV &= ~mask;
 
     /* Enable the ionterrupt for this pin */
     if (mode & 0x100) port->IE  |=  mask;
     else              port->IE  &= ~mask;
 }
+
+// The per-port handlers of the direct-dispatch pin interrupts
+PinInterruptHandler pinInterruptHandlers[4];
+
+void attachPinInterrupt(int pin, PinInterruptHandler handler, int mode)
+{
+    int portNum = digitalPinToPort(pin);
+    LPC_GPIO_TypeDef* port = gpioPorts[portNum];
+    unsigned short mask = digitalPinToBitMask(pin);
+
+    pinInterruptHandlers[portNum] = handler;
+
+    // Configure the pin as input and set the trigger
+    pinInterruptMode(pin, mode);
+
+    // Clear a stale interrupt flag and enable the pin's interrupt
+    port->IC = mask;
+    port->IE |= mask;
+
+    // The interrupt of GPIO port N is EINT<N>
+    setInterruptPriority((IRQn_Type) (EINT0_IRQn - portNum),
+        ISR_PRIO_TIME_CRITICAL);
+    enableInterrupt((IRQn_Type) (EINT0_IRQn - portNum));
+}
+
+void detachPinInterrupt(int pin)
+{
+    int portNum = digitalPinToPort(pin);
+    LPC_GPIO_TypeDef* port = gpioPorts[portNum];
+
+    port->IE &= ~digitalPinToBitMask(pin);
+
+    // Disable the port's interrupt when no pin of the port uses it
+    if (!(port->IE & 0xfff))
+        disableInterrupt((IRQn_Type) (EINT0_IRQn - portNum));
+}
@@ -0,0 +1,150 @@
+/*
+ *  edge_capture.cpp - Multi-channel edge timestamp capture engine.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#include <sblib/edge_capture.h>
+
+#include <sblib/digital_pin.h>
+#include <sblib/interrupt.h>
+#include <sblib/platform.h>
+
+
+EdgeCapture::EdgeCapture()
+: timer(0)
+, channelCount(0)
+, head(0)
+, tail(0)
+{
+}
+
+void EdgeCapture::begin(Timer& aTimer)
+{
+    timer = &aTimer;
+    channelCount = 0;
+    head = 0;
+    tail = 0;
+
+    timer->begin();
+    timer->prescaler((SystemCoreClock / 1000000) - 1);
+    timer->start();
+}
+
+int EdgeCapture::addChannel(int pin, int mode, int pinFlags)
+{
+    if (channelCount >= EDGE_CAPTURE_CHANNELS)
+        return -1;
+
+    Channel* chan = channels + channelCount;
+    chan->portNum = digitalPinToPort(pin);
+    chan->mask = digitalPinToBitMask(pin);
+    chan->overflows = 0;
+    chan->filterTime = 0;
+    chan->lastTime = 0;
+    chan->filtered = 0;
+
+    // Configures the pin as input and sets the edge selection. The
+    // interrupt of the pin is enabled in enableInterrupts().
+    pinInterruptMode(pin, mode);
+
+    // Apply the pull-up / pull-down / hysteresis configuration, which
+    // pinInterruptMode() resets to a plain input
+    if (pinFlags)
+        pinMode(pin, INPUT | pinFlags);
+
+    return channelCount++;
+}
+
+void EdgeCapture::setGlitchFilter(int channel, unsigned int usec)
+{
+    channels[channel].filterTime = usec;
+}
+
+void EdgeCapture::enableInterrupts()
+{
+    for (int idx = 0; idx < channelCount; ++idx)
+    {
+        const Channel* chan = channels + idx;
+        LPC_GPIO_TypeDef* port = gpioPorts[chan->portNum];
+
+        port->IC = chan->mask;
+        port->IE |= chan->mask;
+
+        // The interrupt of GPIO port N is EINT<N>
+        setInterruptPriority((IRQn_Type) (EINT0_IRQn - chan->portNum),
+            ISR_PRIO_TIME_CRITICAL);
+        enableInterrupt((IRQn_Type) (EINT0_IRQn - chan->portNum));
+    }
+}
+
+bool EdgeCapture::readEvent(EdgeCaptureEvent& event)
+{
+    if (head == tail)
+        return false;
+
+    event = ring[tail];
+    tail = (tail + 1) & (EDGE_CAPTURE_RING_SIZE - 1);
+    return true;
+}
+
+int EdgeCapture::pending() const
+{
+    return (head - tail) & (EDGE_CAPTURE_RING_SIZE - 1);
+}
+
+unsigned int EdgeCapture::overflowCount(int channel) const
+{
+    return channels[channel].overflows;
+}
+
+unsigned int EdgeCapture::filteredCount(int channel) const
+{
+    return channels[channel].filtered;
+}
+
+void EdgeCapture::portInterruptHandler(int portNum)
+{
+    LPC_GPIO_TypeDef* port = gpioPorts[portNum];
+    const unsigned int status = port->MIS;
+    const unsigned int time = timer->value();
+
+    for (int idx = 0; idx < channelCount; ++idx)
+    {
+        Channel* chan = channels + idx;
+        if (chan->portNum != portNum || !(status & chan->mask))
+            continue;
+
+        if (chan->filterTime)
+        {
+            // Discard edges that follow the previous edge too closely.
+            // Every edge arms the filter again, so a sustained noise
+            // burst yields at most its first edge as an event.
+            const unsigned int delta = time - chan->lastTime;
+            chan->lastTime = time;
+            if (delta < chan->filterTime)
+            {
+                ++chan->filtered;
+                continue;
+            }
+        }
+
+        byte nextHead = (head + 1) & (EDGE_CAPTURE_RING_SIZE - 1);
+        if (nextHead == tail)
+        {
+            ++chan->overflows;
+            continue;
+        }
+
+        EdgeCaptureEvent* event = ring + head;
+        event->channel = idx;
+        event->level = port->MASKED_ACCESS[chan->mask] != 0;
+        event->time = time;
+        head = nextHead;
+    }
+
+    port->IC = status;
+}
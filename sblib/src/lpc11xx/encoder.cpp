@@ -0,0 +1,93 @@
+/*
+ *  encoder.cpp - Quadrature decoder for rotary encoders.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#include <sblib/encoder.h>
+
+#include <sblib/digital_pin.h>
+#include <sblib/interrupt.h>
+#include <sblib/platform.h>
+
+// The step of a quadrature transition, indexed with oldState << 2 | newState.
+// Invalid transitions (both signals changed at once) count as 0.
+static const signed char quadratureSteps[16] =
+{
+    0, +1, -1,  0,
+   -1,  0,  0, +1,
+   +1,  0,  0, -1,
+    0, -1, +1,  0
+};
+
+
+RotaryEncoder::RotaryEncoder()
+: pinA(-1)
+, pinB(-1)
+, state(0)
+, delta(0)
+{
+}
+
+void RotaryEncoder::begin(int pinA, int pinB)
+{
+    this->pinA = pinA;
+    this->pinB = pinB;
+    delta = 0;
+
+    pinInterruptMode(pinA, INTERRUPT_EDGE_BOTH);
+    pinInterruptMode(pinB, INTERRUPT_EDGE_BOTH);
+
+    // Pull-ups and hysteresis for the open mechanical contacts
+    pinMode(pinA, INPUT | PULL_UP | HYSTERESIS);
+    pinMode(pinB, INPUT | PULL_UP | HYSTERESIS);
+
+    state = (digitalRead(pinA) << 1) | digitalRead(pinB);
+
+    for (int pin = 0; pin < 2; ++pin)
+    {
+        int portNum = digitalPinToPort(pin ? pinB : pinA);
+        LPC_GPIO_TypeDef* port = gpioPorts[portNum];
+        unsigned short mask = digitalPinToBitMask(pin ? pinB : pinA);
+
+        port->IC = mask;
+        port->IE |= mask;
+
+        // The interrupt of GPIO port N is EINT<N>
+        setInterruptPriority((IRQn_Type) (EINT0_IRQn - portNum),
+            ISR_PRIO_TIME_CRITICAL);
+        enableInterrupt((IRQn_Type) (EINT0_IRQn - portNum));
+    }
+}
+
+int RotaryEncoder::read()
+{
+    // delta is only shared with the pin interrupts of the two inputs
+    InterruptLock lockA((IRQn_Type) (EINT0_IRQn - digitalPinToPort(pinA)));
+    InterruptLock lockB((IRQn_Type) (EINT0_IRQn - digitalPinToPort(pinB)));
+
+    int steps = delta;
+    delta = 0;
+
+    return steps;
+}
+
+void RotaryEncoder::portInterruptHandler(int portNum)
+{
+    LPC_GPIO_TypeDef* port = gpioPorts[portNum];
+    unsigned int mask = 0;
+
+    if (digitalPinToPort(pinA) == portNum)
+        mask |= digitalPinToBitMask(pinA);
+    if (digitalPinToPort(pinB) == portNum)
+        mask |= digitalPinToBitMask(pinB);
+
+    byte newState = (digitalRead(pinA) << 1) | digitalRead(pinB);
+    delta += quadratureSteps[(state << 2) | newState];
+    state = newState;
+
+    port->IC = port->MIS & mask;
+}
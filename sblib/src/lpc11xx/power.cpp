@@ -0,0 +1,93 @@
+/*
+ *  power.cpp - Power management: deep-sleep with pin wakeup.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#include <sblib/power.h>
+
+#include <sblib/digital_pin.h>
+#include <sblib/interrupt.h>
+#include <sblib/platform.h>
+
+// Power-down configuration for deep-sleep: all analog blocks stopped.
+// The reserved bits must be written as ones, see the user manual.
+#define PDSLEEPCFG_ALL_OFF  0x000018ff
+
+// The main clock source: IRC oscillator
+#define MAINCLKSEL_IRC  0
+
+
+/*
+ * Get the start logic input of a pin: the start logic exists for
+ * PIO0_0 ... PIO0_11 (inputs 0..11) and PIO1_0 (input 12) only.
+ *
+ * @param pin - the pin, e.g. PIO0_3
+ * @return The start logic input 0..12, or -1 if the pin has none.
+ */
+static int wakeupInput(int pin)
+{
+    int port = digitalPinToPort(pin);
+    int num = pin & 31;
+
+    if (port == 0 && num <= 11)
+        return num;
+    if (port == 1 && num == 0)
+        return 12;
+    return -1;
+}
+
+bool deepSleep(int wakeupPin, WakeupEdge edge)
+{
+    const int input = wakeupInput(wakeupPin);
+    if (input < 0)
+        return false;
+    const unsigned int mask = 1 << input;
+
+    // Select the edge, reset the start logic and enable the input
+    if (edge == WAKEUP_EDGE_RISING)
+        LPC_SYSCON->STARTAPRP0 |= mask;
+    else LPC_SYSCON->STARTAPRP0 &= ~mask;
+    LPC_SYSCON->STARTRSRP0CLR = mask;
+    LPC_SYSCON->STARTERP0 |= mask;
+    enableInterrupt((IRQn_Type) (WAKEUP0_IRQn + input));
+
+    // Restore the analog blocks that run now after the wakeup, and stop
+    // them all while sleeping
+    LPC_SYSCON->PDAWAKECFG = LPC_SYSCON->PDRUNCFG;
+    LPC_SYSCON->PDSLEEPCFG = PDSLEEPCFG_ALL_OFF;
+
+    // The main clock must come from the IRC oscillator when entering
+    // deep-sleep; the previous selection is restored after the wakeup
+    const unsigned int mainClkSel = LPC_SYSCON->MAINCLKSEL;
+    LPC_SYSCON->MAINCLKSEL = MAINCLKSEL_IRC;
+    LPC_SYSCON->MAINCLKUEN = 0;
+    LPC_SYSCON->MAINCLKUEN = 1;
+
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __WFI();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+    LPC_SYSCON->MAINCLKSEL = mainClkSel;
+    LPC_SYSCON->MAINCLKUEN = 0;
+    LPC_SYSCON->MAINCLKUEN = 1;
+
+    // Disable the start logic input again
+    LPC_SYSCON->STARTERP0 &= ~mask;
+    disableInterrupt((IRQn_Type) (WAKEUP0_IRQn + input));
+
+    return true;
+}
+
+/*
+ * The interrupt handler of the wakeup start logic. The startup code maps
+ * the handlers of all 13 wakeup inputs to this name.
+ */
+extern "C" void WAKEUP_IRQHandler()
+{
+    // Reset the start logic inputs that caused the wakeup
+    LPC_SYSCON->STARTRSRP0CLR = LPC_SYSCON->STARTSRP0;
+}
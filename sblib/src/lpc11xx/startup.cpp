@@ -1,43 +1,35 @@
-//*****************************************************************************
-// LPC11xx Microcontroller Startup code for use with LPCXpresso IDE
-//
-// Version : 130808
-//*****************************************************************************
-//
-// Copyright(C) NXP Semiconductors, 2013
-// All rights reserved.
-//
-// Software that is described herein is for illustrative purposes only
-// which provides customers with programming information regarding the
-// LPC products.  This software is supplied "AS IS" without any warranties of
-// any kind, and NXP Semiconductors and its licensor disclaim any and
-// all warranties, express or implied, including all implied warranties of
-// merchantability, fitness for a particular purpose and non-infringement of
-// intellectual property rights.  NXP Semiconductors assumes no responsibility
-// or liability for the use of the software, conveys no license or rights under any
-// patent, copyright, mask work right, or any other intellectual property rights in
-// or to any products. NXP Semiconductors reserves the right to make changes
-// in the software without notification. NXP Semiconductors also makes no
-// representation or warranty that such application will be suitable for the
-// specified use without further testing or modification.
-//
-// Permission to use, copy, modify, and distribute this software and its
-// documentation is hereby granted, under NXP Semiconductors' and its
-// licensor's relevant copyrights in the software, without fee, provided that it
-// is used in conjunction with NXP Semiconductors microcontrollers.  This
-// copyright, permission, and disclaimer notice must appear in all copies of
-// this code.
-//*****************************************************************************
+/*
+ *  startup.cpp - The library-owned LPC11xx startup code.
+ *
+ *  Based on the LPCXpresso startup code,
+ *  Copyright (c) NXP Semiconductors, 2013.
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ *
+ *  One startup for all applications instead of a copy of
+ *  cr_startup_lpc11xx.cpp per project. The linker pulls it from the
+ *  library through the ENTRY(ResetISR) of the managed linker script; a
+ *  project-local startup file still takes precedence when present.
+ *
+ *  Differences to the LPCXpresso code, for a shorter reset-to-setup()
+ *  time - after a building-wide power restoration, hundreds of devices
+ *  race to rejoin the bus:
+ *
+ *  - SystemInit() runs first, so the data/bss init loops already run at
+ *    the full system clock instead of the 12 MHz IRC.
+ *  - The init loops copy/zero four words per iteration.
+ *  - Empty sections are skipped without calling the init functions.
+ */
+
+#ifndef IAP_EMULATION
 
 #if defined (__cplusplus)
 #ifdef __REDLIB__
 #error Redlib does not support C++
 #else
-//*****************************************************************************
-//
-// The entry point for the C++ library startup
-//
-//*****************************************************************************
 extern "C" {
     extern void __libc_init_array(void);
 }
@@ -47,24 +39,20 @@ extern "C" {
 #define WEAK __attribute__ ((weak))
 #define ALIAS(f) __attribute__ ((weak, alias (#f)))
 
-//*****************************************************************************
 #if defined (__cplusplus)
 extern "C" {
 #endif
 
-//*****************************************************************************
 #if defined (__USE_CMSIS) || defined (__USE_LPCOPEN)
-// Declaration of external SystemInit function
 extern void SystemInit(void);
+extern void SystemCoreClockUpdate(void);
 #endif
 
-//*****************************************************************************
 //
 // Forward declaration of the default handlers. These are aliased.
 // When the application defines a handler (with the same name), this will
 // automatically take precedence over these weak definitions
 //
-//*****************************************************************************
      void ResetISR(void);
 WEAK void NMI_Handler(void);
 WEAK void HardFault_Handler(void);
@@ -73,14 +61,12 @@ WEAK void PendSV_Handler(void);
 WEAK void SysTick_Handler(void);
 WEAK void IntDefaultHandler(void);
 
-//*****************************************************************************
 //
 // Forward declaration of the specific IRQ handlers. These are aliased
-// to the IntDefaultHandler, which is a 'forever' loop. When the application
-// defines a handler (with the same name), this will automatically take
-// precedence over these weak definitions
+// to the IntDefaultHandler, which is a 'forever' loop. When the
+// application defines a handler (with the same name), this will
+// automatically take precedence over these weak definitions
 //
-//*****************************************************************************
 void CAN_IRQHandler (void) ALIAS(IntDefaultHandler);
 void SSP1_IRQHandler (void) ALIAS(IntDefaultHandler);
 void I2C_IRQHandler (void) ALIAS(IntDefaultHandler);
@@ -99,35 +85,19 @@ void PIOINT1_IRQHandler (void) ALIAS(IntDefaultHandler);
 void PIOINT0_IRQHandler (void) ALIAS(IntDefaultHandler);
 void WAKEUP_IRQHandler  (void) ALIAS(IntDefaultHandler);
 
-//*****************************************************************************
-//
-// The entry point for the application.
-// __main() is the entry point for Redlib based applications
-// main() is the entry point for Newlib based applications
-//
-//*****************************************************************************
-#if defined (__REDLIB__)
-extern void __main(void);
-#else
 extern int main(void);
-#endif
-//*****************************************************************************
-//
-// External declaration for the pointer to the stack top from the Linker Script
-//
-//*****************************************************************************
+
+// The pointer to the stack top from the linker script
 extern void _vStackTop(void);
 
-//*****************************************************************************
 #if defined (__cplusplus)
 } // extern "C"
 #endif
-//*****************************************************************************
+
 //
-// The vector table.  Note that the proper constructs must be placed on this to
-// ensure that it ends up at physical address 0x0000.0000.
+// The vector table. Note that the proper constructs must be placed on
+// this to ensure that it ends up at physical address 0x0000.0000.
 //
-//*****************************************************************************
 extern void (* const g_pfnVectors[])(void);
 __attribute__ ((section(".isr_vector")))
 void (* const g_pfnVectors[])(void) = {
@@ -164,7 +134,7 @@ void (* const g_pfnVectors[])(void) = {
     WAKEUP_IRQHandler,                      // PIO0_10 Wakeup
     WAKEUP_IRQHandler,                      // PIO0_11 Wakeup
     WAKEUP_IRQHandler,                      // PIO1_0  Wakeup
-    
+
     CAN_IRQHandler,                         // C_CAN Interrupt
     SSP1_IRQHandler,                        // SPI/SSP1 Interrupt
     I2C_IRQHandler,                         // I2C0
@@ -188,150 +158,174 @@ void (* const g_pfnVectors[])(void) = {
     PIOINT0_IRQHandler,                     // PIO INT0
 };
 
-//*****************************************************************************
-// Functions to carry out the initialization of RW and BSS data sections. These
-// are written as separate functions rather than being inlined within the
-// ResetISR() function in order to cope with MCUs with multiple banks of
-// memory.
-//*****************************************************************************
+//
+// Initialization of the RW and BSS data sections. Four words per
+// iteration: the managed linker script aligns the sections to word
+// boundaries and rounds their length up to full words.
+//
 __attribute__ ((section(".after_vectors")))
-void data_init(unsigned int romstart, unsigned int start, unsigned int len) {
+static void data_init(unsigned int romstart, unsigned int start, unsigned int len)
+{
     unsigned int *pulDest = (unsigned int*) start;
     unsigned int *pulSrc = (unsigned int*) romstart;
     unsigned int loop;
-    for (loop = 0; loop < len; loop = loop + 4)
+
+    for (loop = len >> 4; loop; --loop)
+    {
+        *pulDest++ = *pulSrc++;
+        *pulDest++ = *pulSrc++;
+        *pulDest++ = *pulSrc++;
+        *pulDest++ = *pulSrc++;
+    }
+    for (loop = (len >> 2) & 3; loop; --loop)
         *pulDest++ = *pulSrc++;
 }
 
 __attribute__ ((section(".after_vectors")))
-void bss_init(unsigned int start, unsigned int len) {
+static void bss_init(unsigned int start, unsigned int len)
+{
     unsigned int *pulDest = (unsigned int*) start;
     unsigned int loop;
-    for (loop = 0; loop < len; loop = loop + 4)
+
+    for (loop = len >> 4; loop; --loop)
+    {
+        *pulDest++ = 0;
+        *pulDest++ = 0;
+        *pulDest++ = 0;
+        *pulDest++ = 0;
+    }
+    for (loop = (len >> 2) & 3; loop; --loop)
         *pulDest++ = 0;
 }
 
-//*****************************************************************************
+//
 // The following symbols are constructs generated by the linker, indicating
-// the location of various points in the "Global Section Table". This table is
-// created by the linker via the Code Red managed linker script mechanism. It
-// contains the load address, execution address and length of each RW data
-// section and the execution and length of each BSS (zero initialized) section.
-//*****************************************************************************
+// the location of various points in the "Global Section Table". This table
+// is created by the linker via the Code Red managed linker script
+// mechanism. It contains the load address, execution address and length of
+// each RW data section and the execution and length of each BSS (zero
+// initialized) section.
+//
 extern unsigned int __data_section_table;
 extern unsigned int __data_section_table_end;
 extern unsigned int __bss_section_table;
 extern unsigned int __bss_section_table_end;
 
-//*****************************************************************************
-// Reset entry point for your code.
-// Sets up a simple runtime environment and initializes the C/C++
-// library.
-//*****************************************************************************
+//
+// Reset entry point. Sets up a simple runtime environment, initializes
+// the C/C++ library and calls main().
+//
 __attribute__ ((section(".after_vectors")))
-void
-ResetISR(void) {
-
-    //
-    // Copy the data sections from flash to SRAM.
-    //
+void ResetISR(void)
+{
     unsigned int LoadAddr, ExeAddr, SectionLen;
     unsigned int *SectionTableAddr;
 
+#if defined (__USE_CMSIS) || defined (__USE_LPCOPEN)
+    // Switch to the full system clock before touching the RAM sections:
+    // SystemInit() only writes hardware registers and can run this
+    // early, and the init loops below run four times as fast on the PLL
+    // as on the 12 MHz IRC
+    SystemInit();
+#endif
+
     // Load base address of Global Section Table
     SectionTableAddr = &__data_section_table;
 
-    // Copy the data sections from flash to SRAM.
-    while (SectionTableAddr < &__data_section_table_end) {
+    // Copy the data sections from flash to SRAM
+    while (SectionTableAddr < &__data_section_table_end)
+    {
         LoadAddr = *SectionTableAddr++;
         ExeAddr = *SectionTableAddr++;
         SectionLen = *SectionTableAddr++;
-        data_init(LoadAddr, ExeAddr, SectionLen);
+        if (SectionLen)
+            data_init(LoadAddr, ExeAddr, SectionLen);
     }
+
     // At this point, SectionTableAddr = &__bss_section_table;
-    // Zero fill the bss segment
-    while (SectionTableAddr < &__bss_section_table_end) {
+    // Zero fill the bss segments
+    while (SectionTableAddr < &__bss_section_table_end)
+    {
         ExeAddr = *SectionTableAddr++;
         SectionLen = *SectionTableAddr++;
-        bss_init(ExeAddr, SectionLen);
+        if (SectionLen)
+            bss_init(ExeAddr, SectionLen);
     }
 
 #if defined (__USE_CMSIS) || defined (__USE_LPCOPEN)
-    SystemInit();
+    // SystemInit() ran before the data init: recompute SystemCoreClock,
+    // the variable was just overwritten with its load-time value
+    SystemCoreClockUpdate();
 #endif
 
 #if defined (__cplusplus)
-    //
     // Call C++ library initialisation
-    //
     __libc_init_array();
 #endif
 
-#if defined (__REDLIB__)
-    // Call the Redlib library, which in turn calls main()
-    __main() ;
-#else
     main();
-#endif
-    //
-    // main() shouldn't return, but if it does, we'll just enter an infinite loop
-    //
-    while (1) {
-        ;
+
+    // main() shouldn't return, but if it does, we'll just enter an
+    // infinite loop
+    while (1)
+    {
     }
 }
 
-//*****************************************************************************
+//
 // Default exception handlers. Override the ones here by defining your own
 // handler routines in your application code.
-//*****************************************************************************
+//
 __attribute__ ((section(".after_vectors")))
 void NMI_Handler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
+
 __attribute__ ((section(".after_vectors")))
 void HardFault_Handler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
+
 __attribute__ ((section(".after_vectors")))
 void SVC_Handler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
+
 __attribute__ ((section(".after_vectors")))
 void PendSV_Handler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
+
 __attribute__ ((section(".after_vectors")))
 void SysTick_Handler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
 
-//*****************************************************************************
 //
 // Processor ends up here if an unexpected interrupt occurs or a specific
-// handler is not present in the application code.
+// handler is not present in the application code
 //
-//*****************************************************************************
 __attribute__ ((section(".after_vectors")))
 void IntDefaultHandler(void)
 {
-    while(1)
+    while (1)
     {
     }
 }
 
+#endif /*IAP_EMULATION*/
@@ -12,6 +12,9 @@
 
 #include <sblib/eib.h>
 #include <sblib/interrupt.h>
+#include <sblib/mem_usage.h>
+#include <sblib/profiler.h>
+#include <sblib/tick.h>
 #include <sblib/timer.h>
 
 #include <sblib/internal/functions.h>
@@ -24,9 +27,21 @@
  */
 static inline void lib_setup()
 {
-    // Configure the system timer to call SysTick_Handler once every 1 msec
-    SysTick_Config(SystemCoreClock / 1000);
+    // Paint the unused stack so its high water mark can be queried later,
+    // see mem_usage.h
+    stackPaint();
+
+    // Start the microsecond clock that millis() and delay() are derived
+    // from - a free running 32 bit timer instead of a periodic SysTick
+    // interrupt, see micros.cpp. This claims timer32_1.
     systemTime = 0;
+    microsBegin(timer32_1);
+}
+
+void sleepIfIdle()
+{
+    if (bus.idle() && !objectTransmitPending())
+        waitForInterrupt();
 }
 
 #define WEAK __attribute__ ((weak))
@@ -36,6 +51,9 @@ WEAK void loop_test();
 
 void loop_test() {};
 
+// The interrupt handler of the clock timer, see lib_setup()
+MICROS_TIMER_INTERRUPT_HANDLER(TIMER32_1_IRQHandler)
+
 
 /**
  * The main of the library.
@@ -50,10 +68,20 @@ int main()
 
     while (1)
     {
+        PROFILE_BEGIN(PROF_BCU_LOOP);
         bcu.loop();
+        PROFILE_END(PROF_BCU_LOOP);
+
+        PROFILE_BEGIN(PROF_TICK);
+        tickCheck();
+        PROFILE_END(PROF_TICK);
 
         if (bcu.applicationRunning())
+        {
+            PROFILE_BEGIN(PROF_APP_LOOP);
             loop();
+            PROFILE_END(PROF_APP_LOOP);
+        }
         else if (bcu.applicationShouldRun())
             loop_test();
         else waitForInterrupt();
@@ -0,0 +1,135 @@
+/*
+ *  math.cpp - Mathematical functions.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+#include <sblib/math.h>
+
+// The first quarter wave of the sine: round(sin(deg) * 65536) for 0..90
+// degrees. The other quadrants are folded onto this table.
+static const unsigned short sineTab[91] =
+{
+        0,  1144,  2287,  3430,  4572,  5712,  6850,  7987,
+     9121, 10252, 11380, 12505, 13626, 14742, 15855, 16962,
+    18064, 19161, 20252, 21336, 22415, 23486, 24550, 25607,
+    26656, 27697, 28729, 29753, 30767, 31772, 32768, 33754,
+    34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+    42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930,
+    48703, 49461, 50203, 50931, 51643, 52339, 53020, 53684,
+    54332, 54963, 55578, 56175, 56756, 57319, 57865, 58393,
+    58903, 59396, 59870, 60326, 60764, 61183, 61584, 61966,
+    62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+    64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446,
+    65496, 65526, 65535
+};
+
+
+fixed fixMul(fixed a, fixed b)
+{
+    return (fixed) (((long long) a * b + 0x8000) >> 16);
+}
+
+fixed fixDiv(fixed a, fixed b)
+{
+    long long num = (long long) a << 16;
+
+    // Round towards the nearest value: add half of the divisor with
+    // the sign of the quotient
+    if ((num >= 0) == (b >= 0))
+        num += b / 2;
+    else num -= b / 2;
+
+    return (fixed) (num / b);
+}
+
+fixed fixSin(fixed angle)
+{
+    // Reduce the angle to 0..360 degrees
+    angle %= FIX(360);
+    if (angle < 0)
+        angle += FIX(360);
+
+    int negate = 0;
+    if (angle >= FIX(180))
+    {
+        angle -= FIX(180);
+        negate = 1;
+    }
+    if (angle > FIX(90))
+        angle = FIX(180) - angle;
+
+    // Linear interpolation between the table entries
+    int idx = angle >> 16;
+    int frac = angle & 0xffff;
+    int result = sineTab[idx];
+
+    if (frac)
+        result += ((sineTab[idx + 1] - result) * frac) >> 16;
+    if (idx == 90)
+        result = FIX_ONE;
+
+    return negate ? -result : result;
+}
+
+fixed fixCos(fixed angle)
+{
+    return fixSin(angle + FIX(90));
+}
+
+fixed fixSqrt(fixed x)
+{
+    if (x <= 0)
+        return 0;
+
+    // The square root of x * 2^16 is the fixed-point square root of x
+    unsigned long long value = (unsigned long long) x << 16;
+
+    // Seed the iteration with 2^ceil(bits/2), one power of two above the
+    // root. Found with a binary bit search, as the Cortex-M0 has no CLZ
+    // instruction.
+    int bits = 0;
+    unsigned int high = (unsigned int) (value >> 16);
+    if (high & 0xffff0000)
+    {
+        bits += 16;
+        high >>= 16;
+    }
+    if (high & 0xff00)
+    {
+        bits += 8;
+        high >>= 8;
+    }
+    if (high & 0xf0)
+    {
+        bits += 4;
+        high >>= 4;
+    }
+    if (high & 0xc)
+    {
+        bits += 2;
+        high >>= 2;
+    }
+    if (high & 2)
+        ++bits;
+
+    unsigned long long root = (unsigned long long) 2 << ((bits + 16) >> 1);
+
+    // Newton iteration, converges quadratically from the seed
+    unsigned long long next = (root + value / root) >> 1;
+    while (next < root)
+    {
+        root = next;
+        next = (root + value / root) >> 1;
+    }
+
+    return (fixed) root;
+}
+
+fixed fixLerp(fixed a, fixed b, fixed t)
+{
+    return a + fixMul(b - a, t);
+}
@@ -24,46 +24,54 @@ MemMapper::MemMapper(unsigned int flashBase, unsigned int flashSize, bool autoAd
     flashSizePages = flashSize / FLASH_PAGE_SIZE;
     flashBasePage = ((unsigned int) flashBase) / FLASH_PAGE_SIZE;
     lastAllocated = 0; // means: nothing allocated in this run
-    writePage = 0;
     allocTableModified = false;
-    flashMemModified = false;
+    useCounter = 0;
+    cachedVirtPage = -1;
+    cachedPagePtr = 0;
+    endianess = BIG_ENDIAN;
+    for (int i = 0; i < MEM_MAPPER_WRITE_BUFFERS; i++)
+    {
+        writePage[i] = 0;
+        bufModified[i] = false;
+        bufLastUsed[i] = 0;
+    }
     memcpy(allocTable, (byte *)flashBase, FLASH_PAGE_SIZE);
 }
 
-int MemMapper::doFlash(void) const
+int MemMapper::bufferIndexOf(int flashPageNum) const
 {
-    int ret = 0;
-    if (allocTableModified)
+    for (int i = 0; i < MEM_MAPPER_WRITE_BUFFERS; i++)
     {
-        if (iapErasePage(flashBasePage) != IAP_SUCCESS)
+        if (writePage[i] == flashPageNum)
         {
-            fatalError();
+            return i;
         }
-        if (iapProgram((byte *)flashBase, allocTable, FLASH_PAGE_SIZE) != IAP_SUCCESS)
-        {
-            fatalError();
-        }
-        allocTableModified = false;
-        ret |= 1;
     }
-    if (flashMemModified)
+    return -1;
+}
+
+int MemMapper::virtPageOf(int flashPageNum) const
+{
+    for (int i = 0; i < FLASH_PAGE_SIZE; i++)
     {
-        if (iapErasePage(writePage) != IAP_SUCCESS)
-        {
-            fatalError();
-        }
-        if (iapProgram((byte *) (writePage << 8), writeBuf, FLASH_PAGE_SIZE)
-                != IAP_SUCCESS)
+        if ((allocTable[i] ^ 0xff) == flashPageNum)
         {
-            fatalError();
+            return i;
         }
-        flashMemModified = false;
-        ret |= 2;
     }
-    return ret;
+    return -1;
 }
 
-int MemMapper::allocatePage(int virtPage)
+bool MemMapper::isFreePage(int flashPageNum) const
+{
+    if (bufferIndexOf(flashPageNum) >= 0)
+    {
+        return false;
+    }
+    return virtPageOf(flashPageNum) < 0;
+}
+
+int MemMapper::findFreePage() const
 {
     if (lastAllocated == 0)
     { // not yet found the highest used entry
@@ -76,22 +84,142 @@ int MemMapper::allocatePage(int virtPage)
             }
         }
     }
-    if (lastAllocated == (flashBasePage + flashSizePages - 1))
+
+    unsigned int firstPage = flashBasePage + 1; // flashBasePage holds the allocTable
+    unsigned int numPages = flashSizePages - 1;
+    unsigned int page = lastAllocated;
+    if (page < firstPage || page >= firstPage + numPages)
     {
-        return MEM_MAPPER_OUT_OF_MEMORY; // we are out of memory
+        page = firstPage + numPages - 1;
     }
-    if (lastAllocated == 0)
-    {  // no pages allocated yet.
-        writePage = flashBasePage + 1;
-    } else
+
+    for (unsigned int i = 0; i < numPages; i++)
     {
-        lastAllocated++;
-        writePage = lastAllocated;
+        if (++page >= firstPage + numPages)
+        {
+            page = firstPage;
+        }
+        if (isFreePage(page))
+        {
+            return page;
+        }
     }
-    memset(writeBuf, 0, FLASH_PAGE_SIZE);
+    return 0;
+}
 
-    allocTable[virtPage] = writePage ^ 0xff;
-    return MEM_MAPPER_SUCCESS;
+int MemMapper::flushBuffer(int index) const
+{
+    if (writePage[index] == 0 || !bufModified[index])
+    {
+        return 0;
+    }
+
+    // Wear leveling: move the page to a fresh physical page when one is free,
+    // so rewrites of a hot virtual page rotate over the whole region instead
+    // of cycling a single physical page. The previous physical page becomes
+    // stale and is recycled by a later allocation.
+    int newPage = findFreePage();
+    if (newPage != 0)
+    {
+        int virtPage = virtPageOf(writePage[index]);
+        if (virtPage >= 0)
+        {
+            allocTable[virtPage] = newPage ^ 0xff;
+            allocTableModified = true;
+            writePage[index] = newPage;
+            lastAllocated = newPage;
+            cachedVirtPage = -1; // the page moved to another flash address
+        }
+    }
+
+    if (iapErasePage(writePage[index]) != IAP_SUCCESS)
+    {
+        fatalError();
+    }
+    if (iapProgram((byte *) (writePage[index] << 8), writeBuf[index],
+            FLASH_PAGE_SIZE) != IAP_SUCCESS)
+    {
+        fatalError();
+    }
+    bufModified[index] = false;
+    return 2;
+}
+
+int MemMapper::evictBuffer() const
+{
+    int index = 0;
+    for (int i = 1; i < MEM_MAPPER_WRITE_BUFFERS; i++)
+    {
+        if (bufLastUsed[i] < bufLastUsed[index])
+        {
+            index = i;
+        }
+    }
+    flushBuffer(index);
+    cachedVirtPage = -1; // the buffer may hold another page afterwards
+    return index;
+}
+
+int MemMapper::loadPage(int flashPageNum) const
+{
+    int index = bufferIndexOf(flashPageNum);
+    if (index < 0)
+    {
+        index = evictBuffer();
+        writePage[index] = flashPageNum;
+        if (flashPageNum != 0)
+        { // swap flash page into write buffer
+            memcpy(writeBuf[index], (byte *)(flashPageNum << 8), FLASH_PAGE_SIZE);
+        }
+    }
+    bufLastUsed[index] = ++useCounter;
+    return index;
+}
+
+int MemMapper::doFlash(void) const
+{
+    int ret = 0;
+    // Flush the data pages first - a flush may remap a page, and the stored
+    // allocation table must match the data pages it points to
+    for (int i = 0; i < MEM_MAPPER_WRITE_BUFFERS; i++)
+    {
+        ret |= flushBuffer(i);
+    }
+    if (allocTableModified)
+    {
+        if (iapErasePage(flashBasePage) != IAP_SUCCESS)
+        {
+            fatalError();
+        }
+        if (iapProgram((byte *)flashBase, allocTable, FLASH_PAGE_SIZE) != IAP_SUCCESS)
+        {
+            fatalError();
+        }
+        allocTableModified = false;
+        ret |= 1;
+    }
+    return ret;
+}
+
+int MemMapper::allocatePage(int virtPage)
+{
+    // Evict first - flushing the evicted buffer may claim a free page for
+    // wear leveling, so the free page is searched afterwards
+    int index = evictBuffer();
+
+    int newPage = findFreePage();
+    if (newPage == 0)
+    {
+        return MEM_MAPPER_OUT_OF_MEMORY; // we are out of memory
+    }
+    lastAllocated = newPage;
+
+    writePage[index] = newPage;
+    bufLastUsed[index] = ++useCounter;
+    memset(writeBuf[index], 0, FLASH_PAGE_SIZE);
+
+    allocTable[virtPage] = newPage ^ 0xff;
+    return index;
 }
 
 int MemMapper::addRange(int virtAddress, int length)
@@ -115,12 +243,12 @@ int MemMapper::addRange(int virtAddress, int length)
         byte flashPageNum = allocTable[page] ^ 0xff;
         if (flashPageNum == 0)
         { // not yet allocated in flash memory
-            int result = allocatePage(page);
-            if (result != MEM_MAPPER_SUCCESS)
+            int index = allocatePage(page);
+            if (index < 0)
             {
-                return result;
+                return index;
             }
-            flashMemModified = true;
+            bufModified[index] = true;
             doFlash();
         }
     }
@@ -148,30 +276,25 @@ int MemMapper::writeMem(int virtAddress, byte data)
     {
         return flashPageNum;
     }
-    if (writePage != flashPageNum)
-    {
-        doFlash();
-        writePage = flashPageNum;
-        if (writePage != 0)
-        { // swap flash page into write buffer
-            memcpy(writeBuf, (byte *)(writePage << 8), FLASH_PAGE_SIZE);
-        }
-    }
 
-    if (flashPageNum == 0)
+    int index;
+    if (flashPageNum == 0 && autoAddPage)
     { // not yet allocated in flash memory
-        if (autoAddPage)
+        index = allocatePage(virtAddress >> 8);
+        if (index < 0)
         {
-            int result = allocatePage(virtAddress >> 8);
-            if (result != MEM_MAPPER_SUCCESS)
-            {
-                return result;
-            }
-            allocTableModified = true;
+            return index;
         }
+        allocTableModified = true;
+    }
+    else
+    {
+        index = loadPage(flashPageNum);
     }
-    writeBuf[(virtAddress & 0xff)] = data;
-    flashMemModified = true;
+
+    writeBuf[index][virtAddress & 0xff] = data;
+    bufModified[index] = true;
+    cachedVirtPage = -1; // the data of the page moved into the write buffer
 
     return MEM_MAPPER_SUCCESS;
 }
@@ -192,6 +315,13 @@ int MemMapper::writeMemPtr(int virtAddress, byte *data, int length)
 
 int MemMapper::readMem(int virtAddress, byte &data, bool forceFlash)
 {
+    // Fast path: the page was already resolved by a previous read
+    if ((virtAddress >> 8) == cachedVirtPage && !forceFlash)
+    {
+        data = cachedPagePtr[virtAddress & 0xff];
+        return MEM_MAPPER_SUCCESS;
+    }
+
     int flashPageNum = getFlashPageNum(virtAddress);
 
     if (flashPageNum < 0)
@@ -203,17 +333,20 @@ int MemMapper::readMem(int virtAddress, byte &data, bool forceFlash)
     {
         doFlash();
     }
+    int index = bufferIndexOf(flashPageNum);
     if (flashPageNum == 0)
     {
         data = 0x00;
         return MEM_MAPPER_NOT_MAPPED;
-    } else if ((flashPageNum == writePage) && !forceFlash)
+    } else if (index >= 0 && !forceFlash)
     {
-        data = writeBuf[virtAddress & 0xff];
+        cachedPagePtr = writeBuf[index];
     } else
     {
-        data = ((byte*) (flashPageNum << 8))[virtAddress & 0xff];
+        cachedPagePtr = (byte*) (flashPageNum << 8);
     }
+    cachedVirtPage = virtAddress >> 8;
+    data = cachedPagePtr[virtAddress & 0xff];
     return MEM_MAPPER_SUCCESS;
 }
 
@@ -249,16 +382,24 @@ byte* MemMapper::memoryPtr(int virtAddress, bool forceFlash) const
     {
         doFlash();
     }
+    int index = bufferIndexOf(flashPageNum);
     if (flashPageNum == 0)
     {
         return NULL;
-    } else if ((flashPageNum == writePage) && !forceFlash)
+    } else if (index >= 0 && !forceFlash)
     {
-        return writeBuf + (virtAddress & 0xff);
+        return writeBuf[index] + (virtAddress & 0xff);
     }
     return ((byte*) (flashPageNum << 8) + (virtAddress & 0xff));
 }
 
+const byte* MemMapper::readOnlyPtr(int virtAddress) const
+{
+    // memoryPtr without forceFlash serves buffered pages from the write
+    // buffer, so the read is coherent and nothing is flushed
+    return memoryPtr(virtAddress, false);
+}
+
  unsigned char MemMapper::getUInt8(int virtAddress)
 {
     byte ret;
@@ -268,7 +409,7 @@ byte* MemMapper::memoryPtr(int virtAddress, bool forceFlash) const
 
 unsigned char& MemMapper::operator[] (const int nIndex) const
 {
-    return memoryPtr(nIndex)[0];
+    return memoryPtr(nIndex, false)[0];
 }
 
 unsigned int MemMapper::getUIntX(int virtAddress, int length)
@@ -276,6 +417,36 @@ unsigned int MemMapper::getUIntX(int virtAddress, int length)
 	unsigned int ret = 0;
 	int address;
 
+	// Fast path for aligned 16/32 bit reads: resolve the page once and use
+	// a single word load, plus a byte swap for big endian values
+	if (!(virtAddress & (length - 1)) && (length == 2 || length == 4))
+	{
+		byte b;
+		if ((virtAddress >> 8) != cachedVirtPage)
+			readMem(virtAddress, b); // resolves and caches the page
+
+		if ((virtAddress >> 8) == cachedVirtPage)
+		{
+			const byte* ptr = cachedPagePtr + (virtAddress & 0xff);
+
+			if (length == 2)
+			{
+				unsigned short value = *(const unsigned short*) ptr;
+				if (endianess != LITTLE_ENDIAN)
+					value = (value >> 8) | (value << 8);
+				return value;
+			}
+
+			unsigned int value = *(const unsigned int*) ptr;
+			if (endianess != LITTLE_ENDIAN)
+			{
+				value = (value >> 24) | ((value >> 8) & 0xff00)
+				      | ((value << 8) & 0xff0000) | (value << 24);
+			}
+			return value;
+		}
+	}
+
 	for(int i = 0; i < length; i++)
 	{
 		byte b;
@@ -297,7 +468,7 @@ unsigned short MemMapper::getUInt16(int virtAddress)
 
 unsigned int MemMapper::getUInt32(int virtAddress)
 {
-	return (unsigned short)getUIntX(virtAddress, 4);
+	return getUIntX(virtAddress, 4);
 }
 
 int MemMapper::setUInt8(int virtAddress, byte data)
@@ -0,0 +1,99 @@
+/*
+ *  mem_usage.cpp - Stack and heap usage instrumentation.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/mem_usage.h>
+
+// The heap usage counters, updated by operator new / delete in new.cpp
+unsigned int _heapAllocCount;
+unsigned int _heapFreeCount;
+unsigned int _heapAllocBytes;
+
+
+void stackPaintRegion(unsigned int* start, unsigned int* end)
+{
+    while (start < end)
+        *start++ = STACK_PAINT_PATTERN;
+}
+
+unsigned int stackUntouchedRegion(const unsigned int* start, const unsigned int* end)
+{
+    const unsigned int* ptr = start;
+
+    while (ptr < end && *ptr == STACK_PAINT_PATTERN)
+        ++ptr;
+
+    return (ptr - start) * sizeof(unsigned int);
+}
+
+#ifndef IAP_EMULATION
+
+// The end of the static data, defined by the linker script. The area
+// between it and the stack pointer is the unused stack (and heap) room.
+extern "C" unsigned int _pvHeapStart;
+
+// The initial stack pointer, defined by the linker script
+extern "C" unsigned int _vStackTop;
+
+void stackPaint()
+{
+    // The address of a local variable approximates the stack pointer.
+    // Leave a safety margin below it: this function's own frame and the
+    // painting loop must not overwrite live stack.
+    unsigned int sp;
+    stackPaintRegion(&_pvHeapStart, &sp - 8);
+}
+
+unsigned int stackMaxUsed()
+{
+    unsigned int untouched = stackUntouchedRegion(&_pvHeapStart, &_vStackTop);
+    return ((unsigned int) (char*) &_vStackTop - (unsigned int) (char*) &_pvHeapStart)
+        - untouched;
+}
+
+unsigned int stackFree()
+{
+    return stackUntouchedRegion(&_pvHeapStart, &_vStackTop);
+}
+
+#else /*IAP_EMULATION*/
+
+// The host has no paintable stack area, the tests use the region
+// functions directly
+void stackPaint()
+{
+}
+
+unsigned int stackMaxUsed()
+{
+    return 0;
+}
+
+unsigned int stackFree()
+{
+    return 0;
+}
+
+#endif /*IAP_EMULATION*/
+
+
+unsigned int heapAllocCount()
+{
+    return _heapAllocCount;
+}
+
+unsigned int heapFreeCount()
+{
+    return _heapFreeCount;
+}
+
+unsigned int heapAllocBytes()
+{
+    return _heapAllocBytes;
+}
@@ -0,0 +1,137 @@
+/*
+ *  micros.cpp - The monotonic 64 bit microsecond clock.
+ *
+ *  Copyright (c) 2014 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/timer.h>
+
+#include <sblib/internal/variables.h>
+
+// The timer of the microsecond clock
+static Timer* microsTimer;
+
+// The upper 32 bits of the clock: the number of timer overflows
+static volatile unsigned int microsHigh;
+
+// The microsecond count at the last millis() update
+static unsigned long long millisLastMicros;
+
+
+void microsBegin(Timer& aTimer)
+{
+    microsTimer = &aTimer;
+    microsHigh = 0;
+
+    aTimer.begin();
+    aTimer.prescaler((SystemCoreClock / 1000000) - 1);
+
+    // Interrupt on the last timer value before the natural overflow to
+    // count the overflows. No RESET: the timer wraps to zero by itself.
+    aTimer.matchMode(MAT3, INTERRUPT);
+    aTimer.match(MAT3, 0xffffffff);
+
+    aTimer.interrupts();
+    aTimer.start();
+}
+
+unsigned long long micros64()
+{
+    unsigned int high, low;
+
+    // Until the clock timer runs - and in the host tests, which advance
+    // the system time themselves - the count is derived from the
+    // millisecond counter
+    if (!microsTimer)
+        return (unsigned long long) systemTime * 1000;
+
+    // Re-read when the overflow interrupt struck between reading the
+    // overflow count and the timer value
+    do
+    {
+        high = microsHigh;
+        low = microsTimer->value();
+    }
+    while (high != microsHigh);
+
+    // An overflow that is not serviced yet, e.g. when called with
+    // interrupts disabled: the flag is set at the last timer value, so a
+    // low value means the timer already wrapped
+    if (microsTimer->flag(MAT3) && !(low & 0x80000000))
+        ++high;
+
+    return ((unsigned long long) high << 32) | low;
+}
+
+unsigned long long elapsedMicros(unsigned long long since)
+{
+    return micros64() - since;
+}
+
+unsigned int millis()
+{
+    // Until the clock timer runs - and in the host tests, which advance
+    // the system time themselves - the plain counter is returned
+    if (!microsTimer)
+        return systemTime;
+
+    // Fold the full milliseconds that passed since the last update into
+    // the system time. Guarded against a concurrent update from an
+    // interrupt handler that also reads the clock.
+    unsigned int primask = __get_PRIMASK();
+    __disable_irq();
+
+    unsigned int delta = (unsigned int) (micros64() - millisLastMicros);
+    if (delta >= 1000)
+    {
+        unsigned int ticks = delta / 1000;
+        systemTime += ticks;
+        millisLastMicros += (unsigned long long) ticks * 1000;
+    }
+    unsigned int now = systemTime;
+
+    if (!primask)
+        __enable_irq();
+
+    return now;
+}
+
+void microsSleep(unsigned int usec)
+{
+    if (!microsTimer)
+        return;
+
+    // Wake through a match interrupt of the clock timer. Any other
+    // interrupt and a pended event (SEV, see eventSet()) end the sleep
+    // early, the callers re-check their time.
+    microsTimer->match(MAT2, microsTimer->value() + usec);
+    microsTimer->matchMode(MAT2, INTERRUPT);
+    __WFE();
+    microsTimer->matchMode(MAT2, DISABLE);
+}
+
+#ifndef IAP_EMULATION
+void delayMicroseconds(unsigned int usec)
+{
+    // The clock timer ticks at 1 MHz. One tick extra so the wait is at
+    // least usec, wherever within the current tick it starts.
+    unsigned int start = microsTimer->value();
+    ++usec;
+
+    while (microsTimer->value() - start < usec)
+        ;
+}
+#endif
+
+void microsTimerInterruptHandler()
+{
+    // Only the overflow match advances the upper half; MAT2 is the
+    // wakeup of microsSleep()
+    if (microsTimer->flag(MAT3))
+        ++microsHigh;
+    microsTimer->resetFlags();
+}
@@ -9,6 +9,53 @@
  */
 
 #include <sblib/utils.h>
+#include <sblib/mem_usage.h>
+
+#include <stdlib.h>
+
+#ifndef IAP_EMULATION
+
+// The heap usage counters, see mem_usage.h
+extern unsigned int _heapAllocCount;
+extern unsigned int _heapFreeCount;
+extern unsigned int _heapAllocBytes;
+
+/*
+ * The allocation operators count their calls and requested bytes, so the
+ * heap traffic of an application is measurable (see mem_usage.h). The
+ * library itself allocates from static pools only.
+ */
+void* operator new(size_t size)
+{
+    ++_heapAllocCount;
+    _heapAllocBytes += size;
+
+    void* ptr = malloc(size);
+    if (!ptr)
+        fatalError();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr)
+{
+    if (ptr)
+    {
+        ++_heapFreeCount;
+        free(ptr);
+    }
+}
+
+void operator delete[](void* ptr)
+{
+    operator delete(ptr);
+}
+
+#endif /*IAP_EMULATION*/
 
 /*
  * When this function gets called, an object was created that has a
@@ -11,9 +11,31 @@
 
 #include <sblib/core.h>
 #include <sblib/digital_pin.h>
+#include <sblib/hot_table.h>
+#include <sblib/timer.h>
 
 #include <sblib/onewire.h>
 
+// Slot timings of the supported speeds in microseconds, indexed by
+// OneWireSpeed. Overdrive values follow Maxim application note 126,
+// rounded to full microseconds.
+static const OneWireTiming owTimings[2] =
+{
+  { 480, 70, 410, 10, 55, 65, 5, 3, 10, 53 },  // ONEWIRE_SPEED_STANDARD
+  {  70,  9,  40,  1,  8,  8, 3, 1,  2,  7 }   // ONEWIRE_SPEED_OVERDRIVE
+};
+
+#if ONEWIRE_ASYNC
+// States of the timer driven engine
+#define OW_ASYNC_IDLE          0       // no transfer running
+#define OW_ASYNC_RESET_LOW     1       // the reset pulse is being driven low
+#define OW_ASYNC_RESET_SAMPLE  2       // bus released, sample the presence pulse next
+#define OW_ASYNC_RESET_RECOVER 3       // wait out the rest of the reset cycle
+#define OW_ASYNC_BIT_LOW       4       // a slot was started, the bus is driven low
+#define OW_ASYNC_BIT_SAMPLE    5       // read slot: sample the bus next
+#define OW_ASYNC_BIT_RECOVER   6       // wait out the rest of the slot
+#endif
+
 /*****************************************************************************
 ** Function name:  OneWireInit
 **
@@ -28,6 +50,14 @@ void OneWire::OneWireInit(int pin, bool bParasitePowerMode /* false */)
 {
   this->_pin = pin;
   this->m_bParasitePowerMode= bParasitePowerMode;
+  this->_pullupPin= -1;
+  this->_bPullupActive= false;
+  this->OneWireSetSpeed(ONEWIRE_SPEED_STANDARD);
+#if ONEWIRE_ASYNC
+  this->_timer= 0;
+  this->_uAsyncState= OW_ASYNC_IDLE;
+  this->_bAsyncPresence= false;
+#endif
   pinMode(this->_pin, INPUT |PULL_UP);
 #if ONEWIRE_SEARCH
   this->OneWireResetSearch();
@@ -54,6 +84,7 @@ bool OneWire::OneWireReset()
   uint8_t retries= 125;
 
   pinDisableInterrupt(this->_pin);
+    this->ReleaseStrongPullup();       // the reset must be able to pull the bus low
     pinMode(this->_pin, INPUT |PULL_UP);
 #if ONEWIRE_INTERNAL_PULLUP
     digitalWrite(this->_pin, 1);       // enable pull-up resistor
@@ -64,14 +95,14 @@ bool OneWire::OneWireReset()
     } while ( !digitalRead(this->_pin));
     pinMode(this->_pin,OUTPUT);         // drive output low
     digitalWrite(this->_pin, 0);
-    delayMicroseconds(480);
+    delayMicroseconds(this->_timing->resetLowTime);
     pinMode(this->_pin, INPUT |PULL_UP);// allow it to float
 #if ONEWIRE_INTERNAL_PULLUP
     digitalWrite(this->_pin, 1);       // enable pull-up resistor
 #endif
-    delayMicroseconds(70);
+    delayMicroseconds(this->_timing->presenceDelay);
     bRet= !digitalRead(this->_pin);
-    delayMicroseconds(410);
+    delayMicroseconds(this->_timing->resetRecover);
   pinEnableInterrupt(this->_pin);
   return bRet;
 }
@@ -94,15 +125,15 @@ void OneWire::OneWireWriteBit(uint8_t uValue)
   if(uValue & 1) {
     pinMode(this->_pin, OUTPUT);       // drive output low
     digitalWrite(this->_pin, 0);
-    delayMicroseconds(10);
+    delayMicroseconds(this->_timing->write1Low);
     digitalWrite(this->_pin, 1);       // drive output high
-    delayMicroseconds(55);
+    delayMicroseconds(this->_timing->write1High);
   } else {
     pinMode(this->_pin, OUTPUT);       // drive output low
     digitalWrite(this->_pin, 0);
-    delayMicroseconds(65);
+    delayMicroseconds(this->_timing->write0Low);
     digitalWrite(this->_pin, 1);       // drive output high
-    delayMicroseconds(5);
+    delayMicroseconds(this->_timing->write0High);
   }
   pinEnableInterrupt(this->_pin);
 }
@@ -125,14 +156,14 @@ uint8_t OneWire::OneWireReadBit()
   pinDisableInterrupt(this->_pin);
     pinMode(this->_pin, OUTPUT);
     digitalWrite(this->_pin, 0);
-    delayMicroseconds(3);
+    delayMicroseconds(this->_timing->readLow);
     pinMode(this->_pin, INPUT |PULL_UP);// let pin float, pull up will raise
 #if ONEWIRE_INTERNAL_PULLUP
     digitalWrite(this->_pin, 1);        // enable pull-up resistor
 #endif
-    delayMicroseconds(10);
+    delayMicroseconds(this->_timing->readSampleDelay);
     uRet = digitalRead(this->_pin);
-    delayMicroseconds(53);
+    delayMicroseconds(this->_timing->readRecover);
   pinEnableInterrupt(this->_pin);
   return uRet;
 }
@@ -254,7 +285,7 @@ void OneWire::OneWireReadBytes(uint8_t *buf, uint16_t count)
 *****************************************************************************/
 void OneWire::OneWireSelect(const uint8_t rom[8])
 {
-  this->OneWireWrite(0x55);            // Choose ROM
+  this->OneWireWrite(ONEWIRE_CMD_MATCH_ROM); // Choose ROM
   for( uint8_t i = 0; i < 8; i++)
   {
     this->OneWireWrite(rom[i]);
@@ -274,7 +305,166 @@ void OneWire::OneWireSelect(const uint8_t rom[8])
 *****************************************************************************/
 void OneWire::OneWireSkip()
 {
-  this->OneWireWrite(0xCC);            // Skip ROM
+  this->OneWireWrite(ONEWIRE_CMD_SKIP_ROM); // Skip ROM
+}
+
+/*****************************************************************************
+** Function name:  OneWireSetSpeed
+**
+** Descriptions:   Select the communication speed of the bus. All slot
+**                 timings are taken from the table of the selected speed.
+**                 The devices themselves only listen at overdrive speed
+**                 after an overdrive ROM command, see OneWireOverdriveSkip()
+**                 and OneWireOverdriveMatch(). A reset at standard speed
+**                 brings every device back to standard speed.
+**
+** parameters:     speed (ONEWIRE_SPEED_STANDARD or ONEWIRE_SPEED_OVERDRIVE)
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::OneWireSetSpeed(OneWireSpeed speed)
+{
+  this->_eSpeed= speed;
+  this->_timing= &owTimings[speed];
+}
+
+/*****************************************************************************
+** Function name:  OneWireOverdriveSkip
+**
+** Descriptions:   Switch all overdrive capable devices on the bus to
+**                 overdrive speed: reset at standard speed, issue the
+**                 Overdrive Skip ROM command and switch this bus instance
+**                 to overdrive. Like after OneWireSkip() all devices are
+**                 addressed; follow up with a reset (now at overdrive
+**                 speed) and a ROM select to talk to a single one.
+**
+** parameters:     none
+**
+** Returned value: true if a device responded to the standard speed reset
+**
+*****************************************************************************/
+bool OneWire::OneWireOverdriveSkip()
+{
+  this->OneWireSetSpeed(ONEWIRE_SPEED_STANDARD);
+  if(!this->OneWireReset()) return false;
+  this->OneWireWrite(ONEWIRE_CMD_OVERDRIVE_SKIP);
+  this->OneWireSetSpeed(ONEWIRE_SPEED_OVERDRIVE);
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  OneWireOverdriveMatch
+**
+** Descriptions:   Switch one overdrive capable device to overdrive speed
+**                 and select it: reset at standard speed, issue the
+**                 Overdrive Match ROM command, switch to overdrive and send
+**                 the ROM at overdrive speed (the device already listens at
+**                 overdrive after the command byte). Afterwards the device
+**                 is selected like after OneWireSelect().
+**
+** parameters:     ROM
+**
+** Returned value: true if a device responded to the standard speed reset
+**
+*****************************************************************************/
+bool OneWire::OneWireOverdriveMatch(const uint8_t rom[8])
+{
+  this->OneWireSetSpeed(ONEWIRE_SPEED_STANDARD);
+  if(!this->OneWireReset()) return false;
+  this->OneWireWrite(ONEWIRE_CMD_OVERDRIVE_MATCH);
+  this->OneWireSetSpeed(ONEWIRE_SPEED_OVERDRIVE);
+  for( uint8_t i = 0; i < 8; i++)
+  {
+    this->OneWireWrite(rom[i]);
+  }
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  OneWireSetStrongPullup
+**
+** Descriptions:   Assign a GPIO that switches an external strong pull-up
+**                 (e.g. a P-FET between VCC and the data line) for parasite
+**                 powered devices. OneWirePower() then switches the FET
+**                 instead of driving the data pin, which can supply the
+**                 higher conversion current of a whole sensor string. The
+**                 pin is configured as output and the pull-up starts
+**                 switched off.
+**
+** parameters:     pin, bActiveHigh: the level that switches the pull-up on
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::OneWireSetStrongPullup(int pin, bool bActiveHigh /* true */)
+{
+  this->_pullupPin= pin;
+  this->_bPullupActiveHigh= bActiveHigh;
+  this->_bPullupActive= false;
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, bActiveHigh ? 0 : 1); // start with the pull-up off
+}
+
+/*****************************************************************************
+** Function name:  OneWirePower
+**
+** Descriptions:   Apply the strong pull-up to the bus, e.g. during the
+**                 conversion of parasite powered DS18x20 sensors. With a
+**                 pull-up pin the external pull-up is switched on,
+**                 otherwise the data pin is driven high push-pull. The
+**                 pull-up is released automatically by the next
+**                 OneWireReset() and by OneWireDePower().
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::OneWirePower()
+{
+  pinDisableInterrupt(this->_pin);
+    if( this->_pullupPin >= 0 )
+    {
+      digitalWrite(this->_pullupPin, this->_bPullupActiveHigh ? 1 : 0);
+    }
+    else
+    {
+      pinMode(this->_pin, OUTPUT);     // drive the bus high push-pull
+      digitalWrite(this->_pin, 1);
+    }
+    this->_bPullupActive= true;
+  pinEnableInterrupt(this->_pin);
+}
+
+/*****************************************************************************
+** Function name:  ReleaseStrongPullup
+**
+** Descriptions:   Switch the strong pull-up off again, if it is active.
+**                 Called before the bus is pulled low (reset) and from
+**                 OneWireDePower().
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::ReleaseStrongPullup()
+{
+  if( !this->_bPullupActive ) return;
+
+  if( this->_pullupPin >= 0 )
+  {
+    digitalWrite(this->_pullupPin, this->_bPullupActiveHigh ? 0 : 1);
+  }
+  else
+  {
+    pinMode(this->_pin, INPUT |PULL_UP); // back to the passive pull-up
+#if ONEWIRE_INTERNAL_PULLUP
+    digitalWrite(this->_pin, 1);
+#endif
+  }
+  this->_bPullupActive= false;
 }
 
 /*****************************************************************************
@@ -294,11 +484,283 @@ void OneWire::OneWireSkip()
 void OneWire::OneWireDePower()
 {
   pinDisableInterrupt(this->_pin);
+    this->ReleaseStrongPullup();
     pinMode(this->_pin, INPUT);
     digitalWrite(this->_pin, 0);       // disable pull-up too
   pinEnableInterrupt(this->_pin);
 }
 
+#if ONEWIRE_ASYNC
+
+/*****************************************************************************
+** Function name:  OneWireSetTimer
+**
+** Descriptions:   Assign the timer that generates the 1-Wire time slots.
+**                 The timer runs with 1us resolution and stops at every
+**                 match on MAT0, so between the slot edges it is halted and
+**                 the CPU is free for other work.
+**
+** parameters:     timer (e.g. timer16_0)
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::OneWireSetTimer(Timer& timer)
+{
+  this->_timer= &timer;
+  timer.begin();
+  timer.prescaler(SystemCoreClock / 1000000 - 1);  // 1us resolution
+  timer.matchMode(MAT0, INTERRUPT | RESET | STOP);
+  timer.interrupts();
+}
+
+/*****************************************************************************
+** Function name:  AsyncSchedule
+**
+** Descriptions:   Let the timer fire the next interrupt in timeUs
+**                 microseconds.
+**
+** parameters:     timeUs
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::AsyncSchedule(unsigned int timeUs)
+{
+  this->_timer->match(MAT0, timeUs);
+  this->_timer->restart();
+}
+
+/*****************************************************************************
+** Function name:  AsyncStartReset
+**
+** Descriptions:   Start the reset pulse of a background transfer.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::AsyncStartReset()
+{
+  this->ReleaseStrongPullup();         // the reset must be able to pull the bus low
+  pinMode(this->_pin, OUTPUT);         // drive output low
+  digitalWrite(this->_pin, 0);
+  this->_uAsyncState= OW_ASYNC_RESET_LOW;
+  this->AsyncSchedule(this->_timing->resetLowTime);
+}
+
+/*****************************************************************************
+** Function name:  AsyncStartBit
+**
+** Descriptions:   Start the time slot of the current bit of a background
+**                 transfer. The slot is finished in timerInterruptHandler().
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::AsyncStartBit()
+{
+  pinMode(this->_pin, OUTPUT);         // drive output low
+  digitalWrite(this->_pin, 0);
+  this->_uAsyncState= OW_ASYNC_BIT_LOW;
+  if(this->_bAsyncRead)
+    this->AsyncSchedule(this->_timing->readLow);
+  else this->AsyncSchedule((this->_uAsyncByte & this->_uAsyncBitMask) ?
+                           this->_timing->write1Low : this->_timing->write0Low);
+}
+
+/*****************************************************************************
+** Function name:  AsyncNextBit
+**
+** Descriptions:   Advance the background transfer to the next bit. Stores a
+**                 completed byte and starts the next slot, or finishes the
+**                 transfer after the last byte.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::AsyncNextBit()
+{
+  this->_uAsyncBitMask <<= 1;
+  if(this->_uAsyncBitMask == 0)        // the current byte is complete
+  {
+    if(this->_bAsyncRead) *this->_pAsyncRxBuf++ = this->_uAsyncByte;
+    else this->_pAsyncTxBuf++;
+
+    if(--this->_uAsyncCount == 0)
+    {
+      this->AsyncFinish();
+      return;
+    }
+    this->_uAsyncBitMask= 0x01;
+    this->_uAsyncByte= this->_bAsyncRead ? 0 : *this->_pAsyncTxBuf;
+  }
+  this->AsyncStartBit();
+}
+
+/*****************************************************************************
+** Function name:  AsyncFinish
+**
+** Descriptions:   Finish a background transfer: release the bus the same
+**                 way as the blocking calls do and re-enable the pin
+**                 interrupt.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::AsyncFinish()
+{
+  if(!this->_bAsyncRead && !this->m_bParasitePowerMode)
+  {
+    pinMode(this->_pin, INPUT);
+#if !ONEWIRE_INTERNAL_PULLUP
+    digitalWrite(this->_pin, 0);
+#endif
+  }
+  this->_uAsyncState= OW_ASYNC_IDLE;
+  pinEnableInterrupt(this->_pin);
+}
+
+/*****************************************************************************
+** Function name:  OneWireStartWrite
+**
+** Descriptions:   Write bytes in the background, driven by the timer
+**                 interrupt. With bReset a reset cycle is generated first
+**                 and the presence answer is latched.
+**
+** parameters:     Value buffer, Counter, bReset (default: false)
+**
+** Returned value: true if started, false if no timer is set, a transfer
+**                 is still running or count is 0
+**
+*****************************************************************************/
+bool OneWire::OneWireStartWrite(const uint8_t *buf, uint16_t count, bool bReset /* false */)
+{
+  if(!this->_timer || this->_uAsyncState != OW_ASYNC_IDLE || !count) return false;
+
+  this->_bAsyncRead= false;
+  this->_pAsyncTxBuf= buf;
+  this->_uAsyncCount= count;
+  this->_uAsyncBitMask= 0x01;
+  this->_uAsyncByte= buf[0];
+
+  pinDisableInterrupt(this->_pin);
+  if(bReset)
+  {
+    this->_bAsyncPresence= false;
+    this->AsyncStartReset();
+  }
+  else this->AsyncStartBit();
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  OneWireStartRead
+**
+** Descriptions:   Read bytes in the background, driven by the timer
+**                 interrupt. The buffer is filled from the interrupt
+**                 handler and must stay valid until OneWireAsyncDone().
+**
+** parameters:     bytes buffer, read count
+**
+** Returned value: true if started, false if no timer is set, a transfer
+**                 is still running or count is 0
+**
+*****************************************************************************/
+bool OneWire::OneWireStartRead(uint8_t *buf, uint16_t count)
+{
+  if(!this->_timer || this->_uAsyncState != OW_ASYNC_IDLE || !count) return false;
+
+  this->_bAsyncRead= true;
+  this->_pAsyncRxBuf= buf;
+  this->_uAsyncCount= count;
+  this->_uAsyncBitMask= 0x01;
+  this->_uAsyncByte= 0;
+
+  pinDisableInterrupt(this->_pin);
+  this->AsyncStartBit();
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  timerInterruptHandler
+**
+** Descriptions:   The timer interrupt handler of the background engine.
+**                 Sequences the reset cycle and the time slots: every state
+**                 does its bus edge or sample and schedules the next match.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void OneWire::timerInterruptHandler()
+{
+  this->_timer->resetFlags();
+
+  switch(this->_uAsyncState)
+  {
+  case OW_ASYNC_RESET_LOW:
+    pinMode(this->_pin, INPUT |PULL_UP);// allow it to float
+#if ONEWIRE_INTERNAL_PULLUP
+    digitalWrite(this->_pin, 1);       // enable pull-up resistor
+#endif
+    this->_uAsyncState= OW_ASYNC_RESET_SAMPLE;
+    this->AsyncSchedule(this->_timing->presenceDelay);
+    break;
+
+  case OW_ASYNC_RESET_SAMPLE:
+    this->_bAsyncPresence= !digitalRead(this->_pin);
+    this->_uAsyncState= OW_ASYNC_RESET_RECOVER;
+    this->AsyncSchedule(this->_timing->resetRecover);
+    break;
+
+  case OW_ASYNC_RESET_RECOVER:
+    this->AsyncStartBit();
+    break;
+
+  case OW_ASYNC_BIT_LOW:
+    if(this->_bAsyncRead)
+    {
+      pinMode(this->_pin, INPUT |PULL_UP);// let pin float, pull up will raise
+#if ONEWIRE_INTERNAL_PULLUP
+      digitalWrite(this->_pin, 1);     // enable pull-up resistor
+#endif
+      this->_uAsyncState= OW_ASYNC_BIT_SAMPLE;
+      this->AsyncSchedule(this->_timing->readSampleDelay);
+    }
+    else
+    {
+      digitalWrite(this->_pin, 1);     // drive output high
+      this->_uAsyncState= OW_ASYNC_BIT_RECOVER;
+      this->AsyncSchedule((this->_uAsyncByte & this->_uAsyncBitMask) ?
+                          this->_timing->write1High : this->_timing->write0High);
+    }
+    break;
+
+  case OW_ASYNC_BIT_SAMPLE:
+    if(digitalRead(this->_pin)) this->_uAsyncByte |= this->_uAsyncBitMask;
+    this->_uAsyncState= OW_ASYNC_BIT_RECOVER;
+    this->AsyncSchedule(this->_timing->readRecover);
+    break;
+
+  case OW_ASYNC_BIT_RECOVER:
+    this->AsyncNextBit();
+    break;
+
+  default:
+    break;
+  }
+}
+#endif // #if ONEWIRE_ASYNC
+
 #if ONEWIRE_SEARCH
 
 /*****************************************************************************
@@ -393,7 +855,7 @@ bool OneWire::OneWireSearch(uint8_t *newAddr)
       uint8_t id_bit_number= 1, rom_byte_mask=1, last_zero=0, rom_byte_number=0;
       uint8_t search_direction, id_bit, cmp_id_bit;
 
-      this->OneWireWrite(0xF0);                            // issue the search command
+      this->OneWireWrite(ONEWIRE_CMD_SEARCH_ROM);          // issue the search command
 
       do {                                                 // loop to do the search
         id_bit= this->OneWireReadBit();                    // read a bit and its complement
@@ -450,14 +912,87 @@ bool OneWire::OneWireSearch(uint8_t *newAddr)
   }
   return bRet;
 }
+
+/*****************************************************************************
+** Function name:  OneWireVerify
+**
+** Descriptions:   Verify that the device with the given ROM is present on
+**                 the bus, without enumerating the whole bus: the search
+**                 algorithm is run once with the search state preloaded to
+**                 the given ROM, so only 64 bit slots are needed per device
+**                 instead of a full search. The regular search state is
+**                 preserved.
+**
+** parameters:     ROM
+**
+** Returned value: true, if the device answered
+**
+*****************************************************************************/
+bool OneWire::OneWireVerify(const uint8_t rom[8])
+{
+  uint8_t rom_backup[8], found[8];
+  uint8_t ld_backup, lfd_backup;
+  bool ldf_backup, bRet;
+
+  ld_backup= this->_LastDiscrepancy;   // keep a copy of the current search state
+  ldf_backup= this->_bLastDeviceFlag;
+  lfd_backup= this->_LastFamilyDiscrepancy;
+  for(uint8_t i = 0; i < 8; i++) rom_backup[i]= this->ROM_NO[i];
+
+  for(uint8_t i = 0; i < 8; i++) this->ROM_NO[i]= rom[i];
+  this->_LastDiscrepancy= 64;          // the search finds exactly this ROM, if present
+  this->_bLastDeviceFlag= false;
+
+  bRet= this->OneWireSearch(found);
+  if(bRet)
+  {
+    for(uint8_t i = 0; i < 8; i++)     // the device is verified if no other ROM was found
+    {
+      if(found[i] != rom[i]) { bRet= false; break; }
+    }
+  }
+
+  this->_LastDiscrepancy= ld_backup;   // restore the search state
+  this->_bLastDeviceFlag= ldf_backup;
+  this->_LastFamilyDiscrepancy= lfd_backup;
+  for(uint8_t i = 0; i < 8; i++) this->ROM_NO[i]= rom_backup[i];
+  return bRet;
+}
 #endif // #if ONEWIRE_SEARCH
 
 #if ONEWIRE_CRC
+#if ONEWIRE_CRC8_TABLE
+// Lookup table for the Dallas Semiconductor 8 bit CRC (polynomial X^8+X^5+X^4+1)
+static const uint8_t owCrc8Table[256] HOT_TABLE =
+{
+  0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+  0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+  0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+  0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+  0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+  0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+  0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+  0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+  0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+  0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+  0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+  0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+  0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+  0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+  0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+  0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+HOT_TABLE_BUDGET_CHECK(owCrc8Table);
+#endif
+
 /*****************************************************************************
 ** Function name:  OneWireCRC8
 **
-** Descriptions:   Compute a Dallas Semiconductor 8 bit CRC directly. this is
-**                 much slower, but much smaller, than a lookup table.
+** Descriptions:   Compute a Dallas Semiconductor 8 bit CRC over a block.
+**                 With ONEWIRE_CRC8_TABLE the CRC comes from a 256-entry
+**                 lookup table in flash (one lookup per byte), otherwise
+**                 the polynomial is run bit by bit: much slower, but much
+**                 smaller.
 **
 ** parameters:     addr and len
 **
@@ -468,6 +1003,12 @@ uint8_t OneWire::OneWireCRC8(const uint8_t *addr, uint8_t len)
 {
   uint8_t crc = 0;
 
+#if ONEWIRE_CRC8_TABLE
+  while(len--)
+  {
+    crc = owCrc8Table[crc ^ *addr++];
+  }
+#else
   while(len--)
   {
     uint8_t inbyte = *addr++;
@@ -479,9 +1020,28 @@ uint8_t OneWire::OneWireCRC8(const uint8_t *addr, uint8_t len)
       inbyte >>= 1;
     }
   }
+#endif
   return crc;
 }
 
+/*****************************************************************************
+** Function name:  OneWireCheckCRC8
+**
+** Descriptions:   Validate a received block (e.g. a ROM or a scratchpad)
+**                 whose last byte is the 8 bit CRC of the bytes before it.
+**
+** parameters:     [in] input - Array of bytes to check, CRC in the last byte.
+**                 [in] len - Length of the block including the CRC byte.
+**
+** Returned value: true, if the CRC matches.
+**
+*****************************************************************************/
+bool OneWire::OneWireCheckCRC8(const uint8_t* input, uint8_t len)
+{
+  if(!len) return false;
+  return OneWireCRC8(input, len - 1) == input[len - 1];
+}
+
 #if ONEWIRE_CRC16
 /*****************************************************************************
 ** Function name:  OneWireCheckCRC16
@@ -0,0 +1,172 @@
+/*
+ *  power_fail.cpp - Fast state save when the bus power fails.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/power_fail.h>
+
+#include <sblib/platform.h>
+#include <sblib/internal/iap.h>
+
+#include <string.h>
+
+/**
+ * The maximum number of regions that can be registered for the power
+ * fail save. Can be overridden in the project settings.
+ */
+#ifndef POWER_FAIL_REGIONS
+#define POWER_FAIL_REGIONS 8
+#endif
+
+/** The header of the power fail record, at the start of the page */
+struct PowerFailRecord
+{
+    unsigned int magic;       //!< POWER_FAIL_MAGIC when a record was saved
+    unsigned short length;    //!< The number of data bytes behind the header
+    unsigned short checksum;  //!< The 16 bit sum of the data bytes
+};
+
+/** A registered memory region and its slot in the record */
+struct SaveRegion
+{
+    byte* data;               //!< The start of the region
+    unsigned short offset;    //!< The offset of the region's slot in the page
+    unsigned short size;      //!< The size of the region in bytes
+};
+
+static byte* savePage;        // the reserved flash page, 0 if not set
+static SaveRegion regions[POWER_FAIL_REGIONS];
+static int regionCount;
+static unsigned int dataLength;  // the total size of the registered regions
+static volatile bool armed;   // the page is erased and the BOD save enabled
+
+// The record is staged here, so the save only copies the regions and
+// programs the page. The IAP copy-RAM-to-flash call requires a word
+// aligned RAM source.
+static byte staging[FLASH_PAGE_SIZE] __attribute__ ((aligned (4)));
+
+/*
+ * The 16 bit sum of count data bytes.
+ */
+static unsigned short dataChecksum(const byte* data, unsigned int count)
+{
+    unsigned short sum = 0;
+
+    while (count--)
+        sum += *data++;
+
+    return sum;
+}
+
+void powerFailBegin(byte* pageAddress)
+{
+    savePage = pageAddress;
+    regionCount = 0;
+    dataLength = 0;
+    armed = false;
+
+    // Preformat the staged record; the checksum is set when saving
+    memset(staging, 0xff, FLASH_PAGE_SIZE);
+    PowerFailRecord* rec = (PowerFailRecord*) staging;
+    rec->magic = POWER_FAIL_MAGIC;
+    rec->length = 0;
+}
+
+bool powerFailRegister(void* data, unsigned int size)
+{
+    if (regionCount >= POWER_FAIL_REGIONS
+        || sizeof(PowerFailRecord) + dataLength + size > FLASH_PAGE_SIZE)
+        return false;
+
+    regions[regionCount].data = (byte*) data;
+    regions[regionCount].offset = sizeof(PowerFailRecord) + dataLength;
+    regions[regionCount].size = size;
+    ++regionCount;
+
+    dataLength += size;
+    ((PowerFailRecord*) staging)->length = dataLength;
+
+    return true;
+}
+
+bool powerFailSaved()
+{
+    if (!savePage || !dataLength)
+        return false;
+
+    const PowerFailRecord* rec = (const PowerFailRecord*) savePage;
+
+    return rec->magic == POWER_FAIL_MAGIC && rec->length == dataLength
+        && rec->checksum == dataChecksum(savePage + sizeof(PowerFailRecord),
+            dataLength);
+}
+
+bool powerFailRestore()
+{
+    if (!powerFailSaved())
+        return false;
+
+    for (int idx = 0; idx < regionCount; ++idx)
+        memcpy(regions[idx].data, savePage + regions[idx].offset,
+            regions[idx].size);
+
+    return true;
+}
+
+bool powerFailArm()
+{
+    if (!savePage)
+        return false;
+
+    // Erase the reserved page now, during normal operation, so that only
+    // the program call is left when the power fails
+    for (int idx = 0; idx < FLASH_PAGE_SIZE; ++idx)
+    {
+        if (savePage[idx] != 0xff)
+        {
+            if (iapErasePage(iapPageOfAddress(savePage)) != IAP_SUCCESS)
+                return false;
+            break;
+        }
+    }
+
+    // Brown-out detect interrupt at the highest threshold, no BOD reset
+    LPC_SYSCON->BODCTRL = 0x3 << 2;
+    NVIC_EnableIRQ(BOD_IRQn);
+
+    armed = true;
+    return true;
+}
+
+void powerFailDisarm()
+{
+    NVIC_DisableIRQ(BOD_IRQn);
+    armed = false;
+}
+
+void powerFailSave()
+{
+    if (!armed)
+        return;
+    armed = false;  // the page is only pre-erased once
+
+    for (int idx = 0; idx < regionCount; ++idx)
+        memcpy(staging + regions[idx].offset, regions[idx].data,
+            regions[idx].size);
+
+    PowerFailRecord* rec = (PowerFailRecord*) staging;
+    rec->checksum = dataChecksum(staging + sizeof(PowerFailRecord),
+        dataLength);
+
+    iapProgramFast(savePage, staging, FLASH_PAGE_SIZE);
+}
+
+extern "C" void BOD_IRQHandler()
+{
+    powerFailSave();
+}
@@ -29,25 +29,144 @@ int Print::print(int value, Base base, int digits)
     return print((unsigned int) value, base, digits) + wlen;
 }
 
+/*
+ * Convert a number to digits, backwards from bufEnd.
+ *
+ * @param bufEnd - the end of a buffer of at least PRINTBUF_SIZE bytes
+ * @param value - the number to convert
+ * @param base - the base to convert to
+ * @param digits - the minimum number of digits, -1 for no minimum
+ * @return A pointer to the first digit.
+ */
+static byte* formatNumber(byte* bufEnd, unsigned int value, int base, int digits)
+{
+    byte ch;
+    byte* pos = bufEnd;
+
+    if (base == BIN || base == OCT || base == HEX)
+    {
+        // Power of two base: extract the digits with shift and mask
+        int shift = base == HEX ? 4 : (base == OCT ? 3 : 1);
+        byte mask = (1 << shift) - 1;
+
+        do
+        {
+            ch = value & mask;
+            *--pos = (ch < 10 ? '0' : 'A' - 10) + ch;
+
+            value >>= shift;
+        }
+        while (--digits > 0 || value);
+    }
+    else if (base == DEC)
+    {
+        // Division by the constant 10 lets the compiler use reciprocal
+        // multiplication instead of the software division routine - the
+        // Cortex-M0 has no divide instruction
+        do
+        {
+            unsigned int quot = value / 10;
+            ch = value - quot * 10;
+            *--pos = '0' + ch;
+
+            value = quot;
+        }
+        while (--digits > 0 || value);
+    }
+    else
+    {
+        short b = (short) base;
+        if (b < 2) b = 2;
+
+        do
+        {
+            ch = value % b;
+            *--pos = (ch < 10 ? '0' : 'A' - 10) + ch;
+
+            value /= b;
+        }
+        while (--digits > 0 || value);
+    }
+
+    return pos;
+}
+
 int Print::print(unsigned int value, Base base, int digits)
 {
     byte buf[PRINTBUF_SIZE]; // need the maximum size for binary printing
-    byte ch;
 
-    short b = (short) base;
-    if (b < 2) b = 2;
+    byte* pos = formatNumber(buf + PRINTBUF_SIZE, value, base, digits);
+    return write(pos, buf + PRINTBUF_SIZE - pos);
+}
+
+void Print::Collector::append(const char* str)
+{
+    while (*str)
+        append(*str++);
+}
 
-    byte* pos = buf + PRINTBUF_SIZE;
-    do
+void Print::Collector::append(int value)
+{
+    if (value < 0)
     {
-        ch = value % b;
-        *--pos = (ch < 10 ? '0' : 'A' - 10) + ch;
+        append('-');
+        value = -value;
+    }
+    append((unsigned int) value);
+}
 
-        value /= b;
+void Print::Collector::append(unsigned int value)
+{
+    byte buf[PRINTBUF_SIZE];
+
+    byte* p = formatNumber(buf + PRINTBUF_SIZE, value, DEC, -1);
+    while (p < buf + PRINTBUF_SIZE)
+        append((char) *p++);
+}
+
+void Print::Collector::append(const PrintFmt& fmt)
+{
+    byte buf[PRINTBUF_SIZE];
+
+    byte* p = formatNumber(buf + PRINTBUF_SIZE, fmt.value, fmt.base, fmt.digits);
+    while (p < buf + PRINTBUF_SIZE)
+        append((char) *p++);
+}
+
+int Print::printFixed(int value, int decimals)
+{
+    // One spare byte before the digits for the shifted integer part
+    byte buf[PRINTBUF_SIZE + 1];
+    byte* bufEnd = buf + sizeof(buf);
+    int wlen = 0;
+    unsigned int uval;
+
+    if (value < 0)
+    {
+        wlen += write('-');
+        uval = -value;
+    }
+    else uval = value;
+
+    // Format with at least decimals+1 digits so the integer part has at
+    // least one digit, then open a gap for the decimal point by moving
+    // the integer digits one position down
+    byte* pos = formatNumber(bufEnd, uval, DEC, decimals + 1);
+
+    if (decimals > 0)
+    {
+        byte* point = bufEnd - decimals - 1;
+        memmove(pos - 1, pos, point - pos + 1);
+        *point = '.';
+        --pos;
     }
-    while (--digits > 0 || value);
 
-    return write((byte*) pos, buf + PRINTBUF_SIZE - pos);
+    return wlen + write(pos, bufEnd - pos);
+}
+
+int Print::printlnFixed(int value, int decimals)
+{
+    return printFixed(value, decimals) + println();
 }
 
 int Print::println()
@@ -0,0 +1,95 @@
+/*
+ *  profiler.cpp - Compile-out timing of main loop sections.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/profiler.h>
+
+#ifdef SB_PROFILE
+
+#include <sblib/timer.h>
+
+// The accumulated timing per section
+static ProfileStats stats[PROF_SECTION_COUNT];
+
+// The start time of the running pass per section
+static unsigned long long startTime[PROF_SECTION_COUNT];
+
+// The time budget per section, 0 for no overrun detection
+static unsigned int budget[PROF_SECTION_COUNT];
+
+// The handler that is called on an overrun
+static ProfileOverrunHandler overrunHandler;
+
+// The section of the last overrun, -1 for none
+static int lastOverrun = -1;
+
+
+void profileBegin(int section)
+{
+    startTime[section] = micros64();
+}
+
+void profileEnd(int section)
+{
+    unsigned int duration = (unsigned int) (micros64() - startTime[section]);
+    ProfileStats& st = stats[section];
+
+    if (!st.count || duration < st.min)
+        st.min = duration;
+    if (duration > st.max)
+        st.max = duration;
+    ++st.count;
+    st.total += duration;
+
+    if (budget[section] && duration > budget[section])
+    {
+        ++st.overruns;
+        lastOverrun = section;
+
+        if (overrunHandler)
+            overrunHandler(section, duration);
+    }
+}
+
+void profileBudget(int section, unsigned int usec)
+{
+    budget[section] = usec;
+}
+
+void profileOverrunHandler(ProfileOverrunHandler handler)
+{
+    overrunHandler = handler;
+}
+
+const ProfileStats& profileStats(int section)
+{
+    return stats[section];
+}
+
+int profileLastOverrun()
+{
+    return lastOverrun;
+}
+
+void profileClear()
+{
+    for (int i = 0; i < PROF_SECTION_COUNT; ++i)
+    {
+        ProfileStats& st = stats[i];
+        st.count = 0;
+        st.min = 0;
+        st.max = 0;
+        st.total = 0;
+        st.overruns = 0;
+    }
+
+    lastOverrun = -1;
+}
+
+#endif /*SB_PROFILE*/
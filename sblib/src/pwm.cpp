@@ -0,0 +1,148 @@
+/*
+ *  pwm.cpp - Multi channel buffered PWM on a 16/32 bit timer.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/pwm.h>
+
+#include <sblib/digital_pin.h>
+
+// Pending match value that marks an unchanged channel
+#define PWM_UNCHANGED (~0u)
+
+/*
+ * The logarithmic dimming curve: CIE 1931 lightness, 256 steps scaled to
+ * 0..65535. The eye's brightness perception is roughly logarithmic, so a
+ * linear duty cycle ramp appears to jump at the dark end and crawl at the
+ * bright end. This table maps equal brightness steps to equal perceived
+ * steps.
+ */
+static const unsigned short dimCurve[256] =
+{
+        0,    28,    57,    85,   114,   142,   171,   199,
+      228,   256,   285,   313,   342,   370,   399,   427,
+      456,   484,   513,   541,   570,   598,   627,   658,
+      689,   721,   755,   789,   825,   861,   899,   937,
+      977,  1018,  1060,  1103,  1147,  1192,  1239,  1287,
+     1336,  1386,  1437,  1490,  1544,  1599,  1656,  1714,
+     1773,  1834,  1896,  1959,  2024,  2090,  2157,  2226,
+     2297,  2369,  2442,  2517,  2593,  2671,  2751,  2832,
+     2914,  2999,  3085,  3172,  3261,  3352,  3444,  3538,
+     3634,  3732,  3831,  3932,  4035,  4139,  4245,  4354,
+     4464,  4575,  4689,  4804,  4922,  5041,  5162,  5285,
+     5410,  5537,  5666,  5797,  5930,  6065,  6202,  6341,
+     6482,  6626,  6771,  6918,  7068,  7220,  7373,  7529,
+     7687,  7848,  8010,  8175,  8342,  8512,  8683,  8857,
+     9033,  9212,  9393,  9576,  9762,  9949, 10140, 10333,
+    10528, 10725, 10926, 11128, 11333, 11541, 11751, 11963,
+    12179, 12396, 12617, 12840, 13065, 13293, 13524, 13757,
+    13993, 14232, 14474, 14718, 14965, 15215, 15467, 15722,
+    15980, 16241, 16505, 16771, 17041, 17313, 17588, 17866,
+    18147, 18431, 18717, 19007, 19300, 19596, 19894, 20196,
+    20501, 20809, 21119, 21433, 21750, 22071, 22394, 22720,
+    23050, 23383, 23719, 24058, 24400, 24746, 25095, 25447,
+    25802, 26161, 26523, 26888, 27257, 27629, 28004, 28383,
+    28765, 29151, 29540, 29932, 30328, 30728, 31131, 31537,
+    31947, 32360, 32777, 33198, 33622, 34050, 34481, 34916,
+    35355, 35797, 36243, 36693, 37146, 37603, 38064, 38529,
+    38997, 39469, 39945, 40425, 40908, 41396, 41887, 42382,
+    42881, 43384, 43891, 44401, 44916, 45435, 45957, 46484,
+    47015, 47549, 48088, 48631, 49178, 49728, 50283, 50843,
+    51406, 51973, 52545, 53120, 53700, 54284, 54873, 55465,
+    56062, 56663, 57269, 57878, 58492, 59111, 59733, 60360,
+    60992, 61627, 62268, 62912, 63561, 64215, 64873, 65535
+};
+
+
+Pwm::Pwm(Timer& aTimer, TimerMatch aPeriodChannel)
+    : timer(aTimer)
+    , periodChannel(aPeriodChannel)
+    , period(0)
+{
+    for (int channel = 0; channel < 4; ++channel)
+        pending[channel] = PWM_UNCHANGED;
+}
+
+void Pwm::begin(unsigned int aPeriod, unsigned int prescaler)
+{
+    period = aPeriod;
+
+    timer.begin();
+    timer.prescaler(prescaler);
+
+    // The period channel resets the timer and generates the interrupt
+    // that latches the buffered duty cycles
+    timer.matchMode(periodChannel, RESET | INTERRUPT);
+    timer.match(periodChannel, period - 1);
+
+    timer.interrupts();
+    timer.restart();
+}
+
+void Pwm::end()
+{
+    timer.noInterrupts();
+    timer.stop();
+    timer.end();
+}
+
+void Pwm::addChannel(TimerMatch channel, int pin)
+{
+    pinMode(pin, OUTPUT_MATCH);
+
+    // The match output is low while the timer is below the match value,
+    // so a match value that is never reached keeps the output off
+    timer.match(channel, period);
+    timer.pwmEnable(channel);
+}
+
+void Pwm::dutyCycle(TimerMatch channel, unsigned int ticks)
+{
+    if (ticks > period)
+        ticks = period;
+
+    // The output is high from the match value to the period end, so the
+    // high time is the period minus the match value. A match value of 0
+    // keeps the output permanently high, the unreached value period
+    // permanently low.
+    pending[channel] = period - ticks;
+}
+
+void Pwm::dim(TimerMatch channel, int brightness)
+{
+    if (brightness <= 0)
+    {
+        dutyCycle(channel, 0);
+    }
+    else if (brightness >= 255)
+    {
+        dutyCycle(channel, period);
+    }
+    else
+    {
+        dutyCycle(channel,
+            (unsigned int) (((unsigned long long) period * dimCurve[brightness]) >> 16));
+    }
+}
+
+void Pwm::interruptHandler()
+{
+    // The timer just reset: the match registers are compared against the
+    // next period only, so writing them here cannot distort a running pulse
+    for (int channel = 0; channel < 4; ++channel)
+    {
+        unsigned int value = pending[channel];
+        if (value != PWM_UNCHANGED)
+        {
+            timer.match(channel, value);
+            pending[channel] = PWM_UNCHANGED;
+        }
+    }
+
+    timer.resetFlags();
+}
@@ -0,0 +1,106 @@
+/*
+ *  scheduler.cpp - Cooperative task scheduler for the main loop.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/scheduler.h>
+
+#include <sblib/timer.h>
+#include <sblib/utils.h>
+
+
+Scheduler::Scheduler()
+    : count(0), backgroundIdx(0)
+{
+}
+
+void Scheduler::add(SchedulerTask task, unsigned int period, unsigned int offset)
+{
+    if (count >= SCHEDULER_MAX_TASKS)
+        fatalError();
+
+    Entry& entry = table[count++];
+    entry.task = task;
+    entry.period = period;
+    entry.nextRun = millis() + period + offset;
+    entry.maxDuration = 0;
+}
+
+void Scheduler::run(Entry& entry)
+{
+    unsigned int start = millis();
+
+    entry.task();
+
+    unsigned int duration = millis() - start;
+    if (duration > entry.maxDuration)
+        entry.maxDuration = duration;
+
+    if (entry.period)
+    {
+        // Re-arm from the deadline to avoid drift. When the task fell
+        // behind by more than a period, shed the backlog instead of
+        // running it back to back until it caught up.
+        entry.nextRun += entry.period;
+        if ((int) (millis() - entry.nextRun) >= (int) entry.period)
+            entry.nextRun = millis() + entry.period;
+    }
+}
+
+bool Scheduler::runNext()
+{
+    unsigned int now = millis();
+    Entry* mostOverdue = 0;
+    int maxOverdue = -1;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Entry& entry = table[i];
+        if (!entry.period)
+            continue;
+
+        int overdue = now - entry.nextRun;
+        if (overdue >= 0 && overdue > maxOverdue)
+        {
+            maxOverdue = overdue;
+            mostOverdue = &entry;
+        }
+    }
+
+    if (mostOverdue)
+    {
+        run(*mostOverdue);
+        return true;
+    }
+
+    // No periodic task is due: run the next background task, round-robin
+    for (int i = 0; i < count; ++i)
+    {
+        Entry& entry = table[backgroundIdx];
+        if (++backgroundIdx >= count)
+            backgroundIdx = 0;
+
+        if (!entry.period)
+        {
+            run(entry);
+            break;
+        }
+    }
+
+    return false;
+}
+
+unsigned int Scheduler::maxDuration(SchedulerTask task) const
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (table[i].task == task)
+            return table[i].maxDuration;
+    }
+    return 0;
+}
@@ -14,6 +14,11 @@
 
 #include <sblib/sensors/dht.h>
 
+// States of the background reading
+#define DHT_ACQ_IDLE    0              // no reading running
+#define DHT_ACQ_START   1              // the start signal is being driven low
+#define DHT_ACQ_CAPTURE 2              // edge capture in progress
+
 /*****************************************************************************
 ** Function name:  DHTInit
 **
@@ -33,6 +38,9 @@ void DHT::DHTInit(int pin,int DHTtype)
   this->_lastHumidity=0;
   this->_lastTemperature=0;
   this->_maxcycles = microsecondsToClockCycles(1000);
+  this->_timer= 0;
+  this->_acqState= DHT_ACQ_IDLE;
+  this->_capCount= 0;
 
   pinMode(this->_pin, INPUT |PULL_UP); // set up the pins!
 }
@@ -91,24 +99,195 @@ bool DHT::readData(bool bForceRead)
       }
     }
     pinEnableInterrupt(_pin);                              // Turn on pin interrupts. Timing critical code is now complete.
-    if(this->_lastError == ERROR_NONE) {                   // Check we read 40 bits and that the checksum matches.
-      if(this->DHT_data[4] == ((this->DHT_data[0] + this->DHT_data[1] + this->DHT_data[2] + this->DHT_data[3]) & 0xFF))
-      {
-        _lastTemperature= (_DHTtype == DHT22) ? (this->DHT_data[2] & 0x80) ? (((0x7F & this->DHT_data[2])<<8) +
-                          this->DHT_data[3])*10 : ((this->DHT_data[2]<<8) + this->DHT_data[3])*10 :
-                          (this->DHT_data[2] & 0x80) ? ((0x7F & this->DHT_data[2]) *-100) : this->DHT_data[2]*100;
-        _lastHumidity= (_DHTtype ==  DHT22) ? ((this->DHT_data[0]<<8) + this->DHT_data[1])*10 : this->DHT_data[0]*100;
-
-        _lastTemperature= _lastTemperature/100;
-        _lastHumidity= _lastHumidity/100;
-
-        bRet= true;
-      } else this->_lastError = ERROR_CHECKSUM;
-    }
+    if(this->_lastError == ERROR_NONE) bRet= this->convertData(); // Check we read 40 bits and that the checksum matches.
   }
   return bRet;
 }
 
+/*****************************************************************************
+** Function name:  convertData
+**
+** Descriptions:   Check the checksum of the received 40 bits and convert
+**                 them to _lastTemperature and _lastHumidity.
+**
+** parameters:     none
+**
+** Returned value: true on success, false on a checksum error (_lastError
+**                 is set to ERROR_CHECKSUM)
+**
+*****************************************************************************/
+bool DHT::convertData()
+{
+  bool bRet= false;
+  if(this->DHT_data[4] == ((this->DHT_data[0] + this->DHT_data[1] + this->DHT_data[2] + this->DHT_data[3]) & 0xFF))
+  {
+    _lastTemperature= (_DHTtype == DHT22) ? (this->DHT_data[2] & 0x80) ? (((0x7F & this->DHT_data[2])<<8) +
+                      this->DHT_data[3])*10 : ((this->DHT_data[2]<<8) + this->DHT_data[3])*10 :
+                      (this->DHT_data[2] & 0x80) ? ((0x7F & this->DHT_data[2]) *-100) : this->DHT_data[2]*100;
+    _lastHumidity= (_DHTtype ==  DHT22) ? ((this->DHT_data[0]<<8) + this->DHT_data[1])*10 : this->DHT_data[0]*100;
+
+    _lastTemperature= _lastTemperature/100;
+    _lastHumidity= _lastHumidity/100;
+
+    bRet= true;
+  } else this->_lastError = ERROR_CHECKSUM;
+  return bRet;
+}
+
+/*****************************************************************************
+** Function name:  DHTSetTimer
+**
+** Descriptions:   Assign a timer capture channel to the sensor. The timer
+**                 runs free with 1us resolution and timestamps every
+**                 falling edge of the data pin in the interrupt handler,
+**                 so a reading no longer busy-waits with interrupts
+**                 disabled. The data pin must be a capture input of the
+**                 timer (e.g. PIO1_8 for CAP0 of timer16_1).
+**
+** parameters:     timer (e.g. timer16_1), captureChannel (CAP0, CAP1)
+**
+** Returned value: none
+**
+*****************************************************************************/
+void DHT::DHTSetTimer(Timer& timer, int captureChannel)
+{
+  this->_timer= &timer;
+  this->_captureChannel= captureChannel;
+  timer.begin();
+  timer.prescaler(SystemCoreClock / 1000000 - 1);  // 1us resolution
+  timer.captureMode(captureChannel, FALLING_EDGE | INTERRUPT);
+  timer.start();
+  timer.interrupts();
+}
+
+/*****************************************************************************
+** Function name:  startAcquisition
+**
+** Descriptions:   Start a sensor reading in the background: the start
+**                 signal and the response capture are sequenced by
+**                 pollAcquisition(), call it from the main loop until it
+**                 returns true. Requires DHTSetTimer().
+**
+** parameters:     bForceRead, to ignore the internal DHT TIMER
+**
+** Returned value: true if started. false on error, check _lastError
+**                 for reason.
+**
+*****************************************************************************/
+bool DHT::startAcquisition(bool bForceRead)
+{
+  if(!this->_timer || this->_acqState != DHT_ACQ_IDLE) return false;
+
+  this->_lastError= ERROR_NONE;
+  int currenttime = millis();
+  if (!bForceRead && ((currenttime - this->_lastReadTime) < 2000))
+  {
+    this->_lastError= ERROR_TIMER_NOT_REACHED;
+    return false;
+  }
+  this->_lastReadTime = currenttime;
+  pinMode(this->_pin, OUTPUT);         // Start signal: set data line low for 20 milliseconds.
+  digitalWrite(this->_pin, 0);
+  this->_acqStart= currenttime;
+  this->_acqState= DHT_ACQ_START;
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  pollAcquisition
+**
+** Descriptions:   Drive a reading started with startAcquisition(). Ends
+**                 the start signal after its 20ms low time, arms the
+**                 capture and decodes the edge timestamps when the
+**                 response is complete (all edges seen or 10ms passed).
+**
+** parameters:     none
+**
+** Returned value: true when a new reading is available. Check:
+**                 _lastHumidity and _lastTemperature
+**
+*****************************************************************************/
+bool DHT::pollAcquisition()
+{
+  if(this->_acqState == DHT_ACQ_START)
+  {
+    if(millis() - this->_acqStart >= 20)
+    {
+      this->_capCount= 0;
+      digitalWrite(this->_pin, 1);     // End the start signal by setting data line high for 40 microseconds.
+      delayMicroseconds(40);
+      this->_timer->restart();
+      pinMode(this->_pin, INPUT_CAPTURE | PULL_UP); // Every falling edge is now timestamped by the timer.
+      this->_acqStart= millis();
+      this->_acqState= DHT_ACQ_CAPTURE;
+    }
+  }
+  else if(this->_acqState == DHT_ACQ_CAPTURE)
+  {
+    if(this->_capCount >= DHT_CAPTURE_MIN_EDGES || millis() - this->_acqStart >= 10)
+    {
+      pinMode(this->_pin, INPUT |PULL_UP);
+      this->_acqState= DHT_ACQ_IDLE;
+      return this->decodeCapture();
+    }
+  }
+  return false;
+}
+
+/*****************************************************************************
+** Function name:  decodeCapture
+**
+** Descriptions:   Decode the captured edge timestamps into the 40 data
+**                 bits: the distance between two falling edges is the 50us
+**                 low time plus the high time of the bit (~26us for a '0',
+**                 ~70us for a '1').
+**
+** parameters:     none
+**
+** Returned value: true on success. Check: _lastHumidity and
+**                 _lastTemperature. false on error, check _lastError.
+**
+*****************************************************************************/
+bool DHT::decodeCapture()
+{
+  this->_lastError= ERROR_NONE;
+  if(this->_capCount < DHT_CAPTURE_MIN_EDGES)
+  {
+    this->_lastError= this->_capCount ? ERROR_DATA_TIMEOUT : ERROR_NOT_PRESENT;
+    return false;
+  }
+  this->DHT_data[0]=this->DHT_data[1]=this->DHT_data[2]=this->DHT_data[3]=this->DHT_data[4]=0;
+
+  uint8_t first= this->_capCount - 41; // the last 41 edges frame the 40 bits
+  for(uint8_t i=0; i<40; ++i)
+  {
+    uint16_t interval= (uint16_t)(this->_capTimes[first+i+1] - this->_capTimes[first+i]);
+    this->DHT_data[i/8] <<= 1;
+    if(interval > DHT_BIT_THRESHOLD) this->DHT_data[i/8] |= 1;
+  }
+  return this->convertData();
+}
+
+/*****************************************************************************
+** Function name:  timerInterruptHandler
+**
+** Descriptions:   The timer interrupt handler of the capture engine:
+**                 stores the timestamp of the falling edge in the ring.
+**                 Do not call this directly, use the macro
+**                 DHT_TIMER_INTERRUPT_HANDLER() instead.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void DHT::timerInterruptHandler()
+{
+  if(this->_capCount < DHT_CAPTURE_EDGES)
+    this->_capTimes[this->_capCount++]= (uint16_t) this->_timer->capture(this->_captureChannel);
+  this->_timer->resetFlags();
+}
+
 /*****************************************************************************
 ** Function name:  ConvertTemperature
 **
@@ -10,8 +10,13 @@
 
 #include <math.h>
 #include <sblib/core.h>
+#include <sblib/mem_mapper.h>
 
 #include <sblib/sensors/ds18x20.h>
+#include <sblib/pool.h>
+
+// The OneWire bus objects. Taken from a static pool, so no heap is needed.
+static ObjectPool<OneWire, DS18X20_POOL_SIZE> oneWirePool;
 
 
 /*****************************************************************************
@@ -28,8 +33,29 @@
 *****************************************************************************/
 void DS18x20::DS18x20Init(int pin, bool bParasiteMode)
 {
-  this->_OW_DS18x= new OneWire;
+  this->_OW_DS18x= oneWirePool.create();
   this->_OW_DS18x->OneWireInit(pin, bParasiteMode);
+  this->m_convStart= 0;
+  this->m_convDuration= 0;
+}
+
+/*****************************************************************************
+** Function name:  SetStrongPullup
+**
+** Descriptions:   Assign a GPIO that switches an external strong pull-up
+**                 for parasite powered sensors. The pull-up is applied
+**                 during the conversion windows of startConversion() /
+**                 startConversionAll(), so parasite powered strings
+**                 convert all sensors in parallel like powered ones.
+**
+** parameters:     pin, bActiveHigh: the level that switches the pull-up on
+**
+** Returned value: none
+**
+*****************************************************************************/
+void DS18x20::SetStrongPullup(int pin, bool bActiveHigh)
+{
+  this->_OW_DS18x->OneWireSetStrongPullup(pin, bActiveHigh);
 }
 
 /*****************************************************************************
@@ -44,7 +70,8 @@ void DS18x20::DS18x20Init(int pin, bool bParasiteMode)
 *****************************************************************************/
 void DS18x20::DS18x20DeInit()
 {
-  if(this->_OW_DS18x) delete _OW_DS18x;
+  oneWirePool.destroy(this->_OW_DS18x);
+  this->_OW_DS18x= 0;
 }
 #if DS18X20_SEARCH
 /*****************************************************************************
@@ -68,7 +95,7 @@ bool DS18x20::Search(uint8_t uMaxDeviceSearch)
   sDS18x20 sDevTmp;
   for(uint8_t j=0; this->_OW_DS18x->OneWireSearch(sDevTmp.addr) > 0 && j < uMaxDeviceSearch; j++)
   {
-    sDevTmp.crcOK= (OneWire::OneWireCRC8(sDevTmp.addr, 7) == sDevTmp.addr[7]);
+    sDevTmp.crcOK= OneWire::OneWireCheckCRC8(sDevTmp.addr, 8);
     if( sDevTmp.crcOK )
     {
       switch(sDevTmp.addr[0])
@@ -81,6 +108,7 @@ bool DS18x20::Search(uint8_t uMaxDeviceSearch)
       if( sDevTmp.type != DS_UNKNOWN)
       {
         sDevTmp.res_type= (sDevTmp.type == DS18S20)? 1: 0;
+        sDevTmp.resolution= 12;        // the power-on default
         this->m_dsDev[j]= sDevTmp;
         this->m_foundDevices++;
         bRet= true; // Found on or more devices! set bRet to true!
@@ -89,6 +117,118 @@ bool DS18x20::Search(uint8_t uMaxDeviceSearch)
   }
   return bRet;
 }
+
+/*****************************************************************************
+** Function name:  LoadDevices
+**
+** Descriptions:   Load the persisted device list from the given MemMapper
+**                 area and verify that every stored device is still present
+**                 on the bus (one Match-ROM pass per device instead of the
+**                 full binary search). m_dsDev / m_foundDevices are only
+**                 filled if the complete list verifies.
+**
+** parameters:     memMapper and the virtual address of the list inside it
+**
+** Returned value: true, if the stored list matches the bus
+**
+*****************************************************************************/
+bool DS18x20::LoadDevices(MemMapper& memMapper, int virtAddress)
+{
+  if( memMapper.getUInt8(virtAddress) != DS18X20_CACHE_MAGIC ) return false;
+
+  uint8_t count= memMapper.getUInt8(virtAddress + 1);
+  if( count < 1 || count > MAX_DS_DEVICES ) return false;
+
+  sDS18x20 sDevTmp;
+  for(uint8_t j=0; j < count; j++)
+  {
+    if( memMapper.readMemPtr(virtAddress + 2 + j * 8, sDevTmp.addr, 8) != MEM_MAPPER_SUCCESS )
+      return false;
+    sDevTmp.crcOK= OneWire::OneWireCheckCRC8(sDevTmp.addr, 8);
+    if( !sDevTmp.crcOK || !this->_OW_DS18x->OneWireVerify(sDevTmp.addr) )
+      return false;                    // a stored device is gone, do a full search
+
+    switch(sDevTmp.addr[0])
+    {
+      case DS18S20: sDevTmp.type= DS18S20; break;
+      case DS18B20: sDevTmp.type= DS18B20; break;
+      case DS1822 : sDevTmp.type= DS1822 ; break;
+      default: return false;
+    }
+    sDevTmp.res_type= (sDevTmp.type == DS18S20)? 1: 0;
+    sDevTmp.resolution= 12;            // the power-on default
+    this->m_dsDev[j]= sDevTmp;
+  }
+  this->m_foundDevices= count;
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  StoreDevices
+**
+** Descriptions:   Persist the current device list (m_dsDev) into the given
+**                 MemMapper area, to be reloaded with LoadDevices(). The
+**                 list is only written when it differs from the stored one
+**                 to avoid needless flash wear; doFlash() is left to the
+**                 caller.
+**
+** parameters:     memMapper and the virtual address of the list inside it
+**
+** Returned value: true on success, false on a MemMapper error
+**
+*****************************************************************************/
+bool DS18x20::StoreDevices(MemMapper& memMapper, int virtAddress)
+{
+  bool bDirty= memMapper.getUInt8(virtAddress) != DS18X20_CACHE_MAGIC ||
+               memMapper.getUInt8(virtAddress + 1) != this->m_foundDevices;
+
+  for(uint8_t j=0; !bDirty && j < this->m_foundDevices; j++)
+  {
+    for(uint8_t i = 0; i < 8; i++)
+    {
+      if( memMapper.getUInt8(virtAddress + 2 + j * 8 + i) != this->m_dsDev[j].addr[i] )
+      {
+        bDirty= true;
+        break;
+      }
+    }
+  }
+  if( !bDirty ) return true;           // the stored list is already up to date
+
+  if( memMapper.setUInt8(virtAddress, DS18X20_CACHE_MAGIC) != MEM_MAPPER_SUCCESS ||
+      memMapper.setUInt8(virtAddress + 1, this->m_foundDevices) != MEM_MAPPER_SUCCESS )
+    return false;
+  for(uint8_t j=0; j < this->m_foundDevices; j++)
+  {
+    if( memMapper.writeMemPtr(virtAddress + 2 + j * 8, this->m_dsDev[j].addr, 8) != MEM_MAPPER_SUCCESS )
+      return false;
+  }
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  SearchCached
+**
+** Descriptions:   Like Search(), but with a persisted device list: first
+**                 the stored ROMs are loaded and presence-verified, which
+**                 takes one Match-ROM pass per device. Only when the stored
+**                 set does not match the bus any more, the full binary ROM
+**                 search is performed and the new list is persisted.
+**
+** parameters:     memMapper and the virtual address of the list inside it,
+**                 uMaxDeviceSearch Maximal count of devices to find.
+**
+** Returned value: true, if one or more devices are found (see Search())
+**
+*****************************************************************************/
+bool DS18x20::SearchCached(MemMapper& memMapper, int virtAddress, uint8_t uMaxDeviceSearch)
+{
+  if( this->LoadDevices(memMapper, virtAddress) ) return true;
+
+  bool bRet= this->Search(uMaxDeviceSearch);
+  if( bRet ) this->StoreDevices(memMapper, virtAddress);
+  return bRet;
+}
 #endif
 
 /*****************************************************************************
@@ -106,57 +246,218 @@ bool DS18x20::Search(uint8_t uMaxDeviceSearch)
 **
 *****************************************************************************/
 bool DS18x20::readTemperature( sDS18x20 *sDev)
+{
+  bool bRet= false;
+  if( this->startConversion(sDev) )
+  {
+    delay(this->m_convDuration);       // the conversion time of the device's resolution. We might do a _OW_DS18x.OneWireDePower() here, but the reset will take care of it.
+    bRet= this->readScratchpad(sDev);
+  }
+  return bRet;
+}
+
+/*****************************************************************************
+** Function name:  SetResolution
+**
+** Descriptions:   Configure the conversion resolution of a DS18B20/DS1822
+**                 (the DS18S20 has a fixed resolution). The TH/TL alarm
+**                 registers are preserved by reading the scratchpad first.
+**                 Lower resolutions convert faster: 9 bit in 94ms instead
+**                 of 750ms at 12 bit; the conversion waits of this class
+**                 adapt automatically. With bSave the setting is copied to
+**                 the sensor EEPROM, otherwise it is lost on its power
+**                 cycle.
+**
+** parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+**                 DS18x20 device.(Is filled automatically by Search() function.)
+**                 uBits: resolution in bits (9..12)
+**                 bSave: also save to the sensor EEPROM (default: false)
+**
+** Returned value: true on success
+**
+*****************************************************************************/
+bool DS18x20::SetResolution(sDS18x20 *sDev, uint8_t uBits, bool bSave)
+{
+  if( sDev->res_type ) return false;   // the DS18S20 has no configuration register
+  if( uBits < 9 ) uBits= 9;
+  if( uBits > 12 ) uBits= 12;
+
+  if( !this->_OW_DS18x->OneWireReset() ) return false;
+  this->_OW_DS18x->OneWireSelect(sDev->addr);
+  this->_OW_DS18x->OneWireWrite(0xBE); // Read Scratchpad, to preserve TH/TL
+  for ( uint8_t i = 0; i < 9; i++)
+  {
+    sDev->data[i] = this->_OW_DS18x->OneWireRead();
+  }
+  if( !OneWire::OneWireCheckCRC8(sDev->data, 9) ) return false;
+
+  if( !this->_OW_DS18x->OneWireReset() ) return false;
+  this->_OW_DS18x->OneWireSelect(sDev->addr);
+  this->_OW_DS18x->OneWireWrite(0x4E); // Write Scratchpad: TH, TL, config
+  this->_OW_DS18x->OneWireWrite(sDev->data[2]);
+  this->_OW_DS18x->OneWireWrite(sDev->data[3]);
+  this->_OW_DS18x->OneWireWrite(((uBits - 9) << 5) | 0x1F);
+
+  if( bSave )
+  {
+    if( !this->_OW_DS18x->OneWireReset() ) return false;
+    this->_OW_DS18x->OneWireSelect(sDev->addr);
+    this->_OW_DS18x->OneWireWrite(0x48); // Copy Scratchpad to the sensor EEPROM
+    delay(10);                         // the copy takes up to 10ms
+  }
+  sDev->resolution= uBits;
+  return true;
+}
+
+/*****************************************************************************
+** Function name:  conversionTimeMs
+**
+** Descriptions:   The worst case conversion time of the given device at
+**                 its configured resolution.
+**
+** parameters:     sDS18x20 *sDev
+**
+** Returned value: the conversion time in milliseconds
+**
+*****************************************************************************/
+uint16_t DS18x20::conversionTimeMs(const sDS18x20 *sDev)
+{
+  static const uint16_t convTimes[4] = { 94, 188, 375, 750 }; // 9..12 bit
+  if( sDev->res_type ) return 750;     // the DS18S20 always converts in 750ms
+  return convTimes[sDev->resolution - 9];
+}
+
+/*****************************************************************************
+** Function name:  startConversion
+**
+** Descriptions:   Start a temperature conversion on the given device
+**                 without waiting for it. Read the result with
+**                 readScratchpad() after the conversion time (up to 750ms
+**                 at 12 bit resolution).
+**
+** parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+**                 DS18x20 device.(Is filled automatically by Search() function.)
+**
+** Returned value: true, if a device responded to the reset
+**
+*****************************************************************************/
+bool DS18x20::startConversion( sDS18x20 *sDev)
 {
   bool bRet= false;
   if( ( sDev->type != DS_UNKNOWN || sDev->addr[0] ) && this->_OW_DS18x->OneWireReset() )
   {
     this->_OW_DS18x->OneWireSelect( sDev->addr );
     this->_OW_DS18x->OneWireWrite(0x44);       // start conversion, with parasite power on at the end
+    if( this->_OW_DS18x->IsParasiteMode() )
+      this->_OW_DS18x->OneWirePower();         // strong pull-up during the conversion
+    this->m_convStart= millis();
+    this->m_convDuration= this->conversionTimeMs(sDev);
+    bRet= true;
+  }
+  return bRet;
+}
 
-    delay(750);                        // maybe 750ms is enough, maybe not. We might do a _OW_DS18x.OneWireDePower() here, but the reset will take care of it.
-    if(this->_OW_DS18x->OneWireReset())
+/*****************************************************************************
+** Function name:  startConversionAll
+**
+** Descriptions:   Start a temperature conversion on all devices at once
+**                 with a Skip ROM broadcast. All sensors convert
+**                 simultaneously, so one acquisition cycle takes a single
+**                 conversion window (up to 750ms) regardless of the
+**                 sensor count. In parasite power mode the bus is powered
+**                 during the window (see SetStrongPullup()), so this also
+**                 works for parasite powered strings. Read the results
+**                 with readScratchpad().
+**
+** parameters:     none
+**
+** Returned value: true, if a device responded to the reset
+**
+*****************************************************************************/
+bool DS18x20::startConversionAll()
+{
+  bool bRet= false;
+  if( this->_OW_DS18x->OneWireReset() )
+  {
+    this->_OW_DS18x->OneWireSkip();            // address all devices on the bus
+    this->_OW_DS18x->OneWireWrite(0x44);       // start conversion, with parasite power on at the end
+    if( this->_OW_DS18x->IsParasiteMode() )
+      this->_OW_DS18x->OneWirePower();         // strong pull-up: all sensors convert in parallel
+    this->m_convStart= millis();
+    this->m_convDuration= 750;                 // the slowest device on the bus decides
+    for(uint8_t j=0; j < this->m_foundDevices; j++)
     {
-      this->_OW_DS18x->OneWireSelect(sDev->addr);
-      this->_OW_DS18x->OneWireWrite(0xBE);     // Read Scratchpad
-      if( this->_OW_DS18x->IsParasiteMode() ) this->_OW_DS18x->OneWireDePower();
-      for ( uint8_t i = 0; i < 9; i++) // we need 9 bytes
-      {
-        sDev->data[i] = this->_OW_DS18x->OneWireRead();
-      }
+      uint16_t time= this->conversionTimeMs(&this->m_dsDev[j]);
+      if( j == 0 || time > this->m_convDuration ) this->m_convDuration= time;
+    }
+    bRet= true;
+  }
+  return bRet;
+}
 
-      // Convert the data to actual temperature because the result is a 16 bit signed integer, it should
-      // be stored to an "int16_t" type, which is always 16 bits even when compiled on a 32 bit processor.
-      int16_t raw = (sDev->data[1] << 8) | sDev->data[0];
-      if(sDev->res_type)
+/*****************************************************************************
+** Function name:  readScratchpad
+**
+** Descriptions:   Read the scratchpad of the given device and decode the
+**                 temperature of the last conversion, see
+**                 startConversion() / startConversionAll().
+**
+** parameters:     sDS18x20 *sDev: which must include the '.addr' of the
+**                 DS18x20 device.(Is filled automatically by Search() function.)
+**
+** Returned value: true, if the read was successful.
+**                 following global Parameter of sDS18x20 will be filled:
+**                 last_temperature - the current read temperature
+**                 lastReadOK       - will be set to true if read was successful
+**
+*****************************************************************************/
+bool DS18x20::readScratchpad( sDS18x20 *sDev)
+{
+  bool bRet= false;
+  if(this->_OW_DS18x->OneWireReset())
+  {
+    this->_OW_DS18x->OneWireSelect(sDev->addr);
+    this->_OW_DS18x->OneWireWrite(0xBE);     // Read Scratchpad
+    if( this->_OW_DS18x->IsParasiteMode() ) this->_OW_DS18x->OneWireDePower();
+    for ( uint8_t i = 0; i < 9; i++) // we need 9 bytes
+    {
+      sDev->data[i] = this->_OW_DS18x->OneWireRead();
+    }
+    sDev->crcOK= OneWire::OneWireCheckCRC8(sDev->data, 9); // the 9th byte is the CRC of the scratchpad
+
+    // Convert the data to actual temperature because the result is a 16 bit signed integer, it should
+    // be stored to an "int16_t" type, which is always 16 bits even when compiled on a 32 bit processor.
+    int16_t raw = (sDev->data[1] << 8) | sDev->data[0];
+    if(sDev->res_type)
+    {
+      raw = raw << 3;                // 9 bit resolution default
+      if (sDev->data[7] == 0x10)  // "count remain" gives full 12 bit resolution
       {
-        raw = raw << 3;                // 9 bit resolution default
-        if (sDev->data[7] == 0x10)  // "count remain" gives full 12 bit resolution
-        {
-          raw = (raw & 0xFFF0) + 12 - sDev->data[6];
-        }
-      } else {
-        byte cfg = (sDev->data[4] & 0x60);
-
-        // at lower res, the low bits are undefined, so let's zero them
-          if(cfg == 0x00) raw = raw & ~7;         // 9 bit resolution, 93.75 ms
-          else if (cfg == 0x20) raw = raw & ~3;   // 10 bit res, 187.5 ms
-          else if (cfg == 0x40) raw = raw & ~1;   // 11 bit res, 375 ms
-        // default is 12 bit resolution, 750 ms conversion time
+        raw = (raw & 0xFFF0) + 12 - sDev->data[6];
       }
-      sDev->current_temperature= (float)raw / 16.0;
-      sDev->lastReadOK= (sDev->current_temperature >=-55 && (sDev->current_temperature) <= 125);
-      if( sDev->lastReadOK ) sDev->last_temperature= sDev->current_temperature;
-      bRet= true;
-    } // if(_OW_DS18x.OneWireReset(...
-  } // if(sDev->type != DS_UNKNOWN...
+    } else {
+      byte cfg = (sDev->data[4] & 0x60);
+
+      // at lower res, the low bits are undefined, so let's zero them
+        if(cfg == 0x00) raw = raw & ~7;         // 9 bit resolution, 93.75 ms
+        else if (cfg == 0x20) raw = raw & ~3;   // 10 bit res, 187.5 ms
+        else if (cfg == 0x40) raw = raw & ~1;   // 11 bit res, 375 ms
+      // default is 12 bit resolution, 750 ms conversion time
+    }
+    sDev->current_temperature= (float)raw / 16.0;
+    sDev->lastReadOK= sDev->crcOK && (sDev->current_temperature >=-55 && (sDev->current_temperature) <= 125);
+    if( sDev->lastReadOK ) sDev->last_temperature= sDev->current_temperature;
+    bRet= true;
+  } // if(_OW_DS18x.OneWireReset(...
   return bRet;
 }
 
 /*****************************************************************************
 ** Function name:  readTemperatureAll
 **
-** Descriptions:   Iterates the the global m_dsDev object and calls
-**                 readTemperature() for each device.
+** Descriptions:   Starts the conversion on all found devices at once with
+**                 startConversionAll(), waits one conversion window and
+**                 then reads the scratchpad of each device.
 **
 ** parameters:    none
 **
@@ -170,12 +471,16 @@ bool DS18x20::readTemperatureAll()
 {
   bool bRet=false;
 
-  for(uint8_t j=0; this->m_foundDevices >= 1 && j < this->m_foundDevices; j++)
+  if( this->m_foundDevices >= 1 && this->startConversionAll() )
   {
-    if( this->readTemperature( &this->m_dsDev[j] ) )
+    delay(this->m_convDuration);       // all devices convert simultaneously, one window is enough
+    for(uint8_t j=0; j < this->m_foundDevices; j++)
     {
-      this->m_dsDev[j].last_temperature= this->m_dsDev[j].current_temperature;
-      bRet= true; // Read one or more was successful.
+      if( this->readScratchpad( &this->m_dsDev[j] ) )
+      {
+        this->m_dsDev[j].last_temperature= this->m_dsDev[j].current_temperature;
+        bRet= true; // Read one or more was successful.
+      }
     }
   }
   return bRet;
@@ -0,0 +1,222 @@
+/*
+ *  filter.cpp - Incremental filter primitives for sensor values
+ *
+ *  Copyright (c) 2015 Selfbus
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/core.h>
+#include <sblib/types.h>
+
+#include <sblib/sensors/filter.h>
+
+/*****************************************************************************
+** Function name:  FilterInit
+**
+** Descriptions:   Initialize the moving average filter with an empty window
+**
+** parameters:     buffer - window buffer of the caller, size - window size
+**
+** Returned value: none
+**
+*****************************************************************************/
+void MovingAverage::FilterInit(int* buffer, uint8_t size)
+{
+  this->m_buffer= buffer;
+  this->m_uSize= size;
+  this->m_uCount= 0;
+  this->m_uPos= 0;
+  this->m_sum= 0;
+}
+
+/*****************************************************************************
+** Function name:  Add
+**
+** Descriptions:   Add a sample to the window, dropping the oldest when the
+**                 window is full. The running sum is updated incrementally,
+**                 so the cost per sample is O(1).
+**
+** parameters:     value - the new sample
+**
+** Returned value: the average over the current window
+**
+*****************************************************************************/
+int MovingAverage::Add(int value)
+{
+  if( this->m_uCount < this->m_uSize ) this->m_uCount++;
+  else this->m_sum -= this->m_buffer[this->m_uPos]; // drop the oldest sample
+
+  this->m_sum += value;
+  this->m_buffer[this->m_uPos]= value;
+  if( ++this->m_uPos >= this->m_uSize ) this->m_uPos= 0;
+  return this->m_sum / this->m_uCount;
+}
+
+/*****************************************************************************
+** Function name:  Value
+**
+** Descriptions:   The average over the current window
+**
+** parameters:     none
+**
+** Returned value: the average, 0 if the window is empty
+**
+*****************************************************************************/
+int MovingAverage::Value()
+{
+  return this->m_uCount ? this->m_sum / this->m_uCount : 0;
+}
+
+/*****************************************************************************
+** Function name:  FilterInit
+**
+** Descriptions:   Initialize the median filter with an empty window
+**
+** parameters:     buffer - window ring of the caller,
+**                 sorted - sorted window buffer of the caller,
+**                 size - window size (odd sizes give the true median)
+**
+** Returned value: none
+**
+*****************************************************************************/
+void MedianFilter::FilterInit(int* buffer, int* sorted, uint8_t size)
+{
+  this->m_buffer= buffer;
+  this->m_sorted= sorted;
+  this->m_uSize= size;
+  this->m_uCount= 0;
+  this->m_uPos= 0;
+}
+
+/*****************************************************************************
+** Function name:  findPos
+**
+** Descriptions:   Binary search in the sorted window: the first position
+**                 whose value is >= the given value.
+**
+** parameters:     value, count - number of valid entries in m_sorted
+**
+** Returned value: the position (0..count)
+**
+*****************************************************************************/
+uint8_t MedianFilter::findPos(int value, uint8_t count)
+{
+  uint8_t lo= 0, hi= count;
+  while( lo < hi )
+  {
+    uint8_t mid= (lo + hi) >> 1;
+    if( this->m_sorted[mid] < value ) lo= mid + 1;
+    else hi= mid;
+  }
+  return lo;
+}
+
+/*****************************************************************************
+** Function name:  Add
+**
+** Descriptions:   Add a sample to the window, dropping the oldest when the
+**                 window is full. The sorted copy is updated by insertion:
+**                 one binary search to remove the oldest value and one to
+**                 insert the new one, instead of re-sorting the window.
+**
+** parameters:     value - the new sample
+**
+** Returned value: the median of the current window
+**
+*****************************************************************************/
+int MedianFilter::Add(int value)
+{
+  uint8_t pos;
+
+  if( this->m_uCount >= this->m_uSize )
+  {
+    int oldest= this->m_buffer[this->m_uPos]; // remove the oldest sample from the sorted copy
+    pos= this->findPos(oldest, this->m_uCount);
+    for( ; pos + 1 < this->m_uCount; pos++) this->m_sorted[pos]= this->m_sorted[pos + 1];
+    this->m_uCount--;
+  }
+
+  pos= this->findPos(value, this->m_uCount); // insert the new sample
+  for(uint8_t i= this->m_uCount; i > pos; i--) this->m_sorted[i]= this->m_sorted[i - 1];
+  this->m_sorted[pos]= value;
+  this->m_uCount++;
+
+  this->m_buffer[this->m_uPos]= value;
+  if( ++this->m_uPos >= this->m_uSize ) this->m_uPos= 0;
+  return this->m_sorted[this->m_uCount >> 1];
+}
+
+/*****************************************************************************
+** Function name:  Value
+**
+** Descriptions:   The median of the current window
+**
+** parameters:     none
+**
+** Returned value: the median, 0 if the window is empty
+**
+*****************************************************************************/
+int MedianFilter::Value()
+{
+  return this->m_uCount ? this->m_sorted[this->m_uCount >> 1] : 0;
+}
+
+/*****************************************************************************
+** Function name:  FilterInit
+**
+** Descriptions:   Initialize the exponential smoothing filter. The first
+**                 sample added initializes the state, so there is no
+**                 settling ramp from zero.
+**
+** parameters:     shift - smoothing factor 1/2^shift (1..14)
+**
+** Returned value: none
+**
+*****************************************************************************/
+void ExpSmooth::FilterInit(uint8_t shift)
+{
+  this->m_uShift= shift;
+  this->m_state= 0;
+  this->m_bPrimed= false;
+}
+
+/*****************************************************************************
+** Function name:  Add
+**
+** Descriptions:   Add a sample: out += (in - out) / 2^shift in fixed
+**                 point, with the state kept scaled by 2^shift so no
+**                 precision is lost to rounding.
+**
+** parameters:     value - the new sample
+**
+** Returned value: the smoothed value
+**
+*****************************************************************************/
+int ExpSmooth::Add(int value)
+{
+  if( !this->m_bPrimed )
+  {
+    this->m_state= value << this->m_uShift;
+    this->m_bPrimed= true;
+  }
+  else this->m_state += value - (this->m_state >> this->m_uShift);
+  return this->m_state >> this->m_uShift;
+}
+
+/*****************************************************************************
+** Function name:  Value
+**
+** Descriptions:   The current smoothed value
+**
+** parameters:     none
+**
+** Returned value: the smoothed value, 0 before the first sample
+**
+*****************************************************************************/
+int ExpSmooth::Value()
+{
+  return this->m_state >> this->m_uShift;
+}
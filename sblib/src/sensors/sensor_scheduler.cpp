@@ -0,0 +1,105 @@
+/*
+ *  sensor_scheduler.cpp - Non-blocking acquisition scheduler for sensors
+ *
+ *  Copyright (c) 2015 Selfbus
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/core.h>
+#include <sblib/types.h>
+
+#include <sblib/sensors/sensor_scheduler.h>
+
+/*****************************************************************************
+** Function name:  SchedulerInit
+**
+** Descriptions:   Initialize the scheduler (empty sensor table)
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void SensorScheduler::SchedulerInit()
+{
+  this->m_uCount= 0;
+}
+
+/*****************************************************************************
+** Function name:  AddSensor
+**
+** Descriptions:   Add a sensor to the schedule. The acquisition is
+**                 restarted every uIntervalMs milliseconds; uOffsetMs
+**                 delays the first start to stagger sensors that share
+**                 a bus.
+**
+** parameters:     device - opaque pointer, passed to all callbacks
+**                 start / poll - the driver's async state machine
+**                 complete - completion callback, may be 0
+**                 uIntervalMs - time between two acquisition starts
+**                 uOffsetMs - delay of the first start (default 0)
+**
+** Returned value: the sensor index, or -1 if the table is full
+**
+*****************************************************************************/
+int SensorScheduler::AddSensor(void* device, SensorStartFunc start,
+                               SensorPollFunc poll, SensorCompleteFunc complete,
+                               unsigned int uIntervalMs, unsigned int uOffsetMs)
+{
+  if( this->m_uCount >= SENSOR_SCHEDULER_MAX ) return -1;
+
+  sSensor* s= &this->m_sensors[this->m_uCount];
+  s->device= device;
+  s->start= start;
+  s->poll= poll;
+  s->complete= complete;
+  s->uIntervalMs= uIntervalMs;
+  s->uNextStart= millis() + uOffsetMs;
+  s->bRunning= false;
+  return this->m_uCount++;
+}
+
+/*****************************************************************************
+** Function name:  PollSensors
+**
+** Descriptions:   Drive the schedule, to be called from the main loop:
+**                 polls the running acquisitions, fires the completion
+**                 callbacks and starts sensors whose interval elapsed.
+**                 Acquisitions of different sensors overlap, so one full
+**                 cycle takes the longest conversion instead of the sum.
+**
+** parameters:     none
+**
+** Returned value: none
+**
+*****************************************************************************/
+void SensorScheduler::PollSensors()
+{
+  unsigned int now= millis();
+
+  for(uint8_t j=0; j < this->m_uCount; j++)
+  {
+    sSensor* s= &this->m_sensors[j];
+    if( s->bRunning )
+    {
+      int result= s->poll(s->device);
+      if( result != SENSOR_BUSY )
+      {
+        s->bRunning= false;
+        if( s->complete ) s->complete(s->device, result == SENSOR_DONE);
+      }
+    }
+    else if( (int) (now - s->uNextStart) >= 0 )
+    {
+      if( s->start(s->device) )
+      {
+        s->uNextStart= now + s->uIntervalMs;
+        s->bRunning= true;
+      }
+      // if the start failed (bus busy, ...) it is retried on the next pass
+    }
+  }
+}
@@ -11,9 +11,12 @@
 #include <sblib/serial.h>
 
 #include <sblib/digital_pin.h>
+#include <sblib/event.h>
 #include <sblib/interrupt.h>
 #include <sblib/platform.h>
 
+#include <string.h>
+
 
 // UART line status: receive data ready bit: RBR holds an unread character
 #define LSR_RDR  0x01
@@ -45,11 +48,50 @@
 // UART transmit-hold-register-empty interrupt
 #define UART_IE_THRE 0x02
 
+// The size of the UART hardware TX/RX FIFOs
+#define UART_FIFO_SIZE 16
+
+// RS-485 control: enable the hardware direction control
+#define RS485CTRL_DCTRL 0x10
+
+// RS-485 control: the direction pin is high while sending
+#define RS485CTRL_OINV  0x20
+
+// Flow control: pause the peer when the RX ring is this full
+#define FLOW_HIGH_WATER (3 * BufferedStream::BUFFER_SIZE / 4)
+
+// Flow control: release the peer when the RX ring drained to this level
+#define FLOW_LOW_WATER  (BufferedStream::BUFFER_SIZE / 4)
+
 
 Serial::Serial(int rxPin, int txPin)
 {
+	uart = LPC_UART;
+	irqn = UART_IRQn;
 	setRxPin(rxPin);
 	setTxPin(txPin);
+	txCompleteHandler = 0;
+	txBlock = 0;
+	txBlockCount = 0;
+	flowMode = FLOW_NONE;
+	rtsPin = -1;
+	flowPaused = false;
+	pendingFlow = 0;
+}
+
+Serial::Serial(LPC_UART_TypeDef* port, IRQn_Type irq, int rxPin, int txPin)
+{
+	uart = port;
+	irqn = irq;
+	setRxPin(rxPin);
+	setTxPin(txPin);
+	txCompleteHandler = 0;
+	txBlock = 0;
+	txBlockCount = 0;
+	flowMode = FLOW_NONE;
+	rtsPin = -1;
+	flowPaused = false;
+	pendingFlow = 0;
 }
 
 void Serial::setRxPin(int rxPin)
@@ -64,40 +106,51 @@ void Serial::setTxPin(int txPin)
 
 void Serial::begin(int baudRate, SerialConfig config)
 {
-    disableInterrupt(UART_IRQn);
+    disableInterrupt(irqn);
 
-    LPC_SYSCON->SYSAHBCLKCTRL |= 1 << 12; // Enable UART clock
-    LPC_SYSCON->UARTCLKDIV = 1;           // divided by 1
+    if (uart == LPC_UART)
+    {
+        // The clock of an additional USART must be enabled by the board
+        // support, the clock bits are part specific
+        LPC_SYSCON->SYSAHBCLKCTRL |= 1 << 12; // Enable UART clock
+        LPC_SYSCON->UARTCLKDIV = 1;           // divided by 1
+    }
 
-    LPC_UART->LCR = 0x80 | config;
+    uart->LCR = 0x80 | config;
 
     unsigned int val = SystemCoreClock * LPC_SYSCON->SYSAHBCLKDIV /
         LPC_SYSCON->UARTCLKDIV / 16 / baudRate;
 
-    LPC_UART->DLM  = val / 256;
-    LPC_UART->DLL  = val % 256;
+    uart->DLM  = val / 256;
+    uart->DLL  = val % 256;
 
-    LPC_UART->LCR = (int) config;  // Configure data bits, parity, stop bits
-    LPC_UART->FCR = 0x07;          // Enable and reset TX and RX FIFO.
-    LPC_UART->MCR = 0;             // Disable modem controls (DTR, DSR, RTS, CTS)
-    LPC_UART->IER |= UART_IE_RBR;  // Enable RX/TX interrupts
+    uart->LCR = (int) config;  // Configure data bits, parity, stop bits
+    // Enable and reset TX and RX FIFO, RX interrupt at 8 of 16 characters.
+    // The trigger level batches 8 received characters per interrupt; the
+    // character timeout interrupt delivers the rest of a burst that stops
+    // below the trigger level.
+    uart->FCR = 0x87;
+    uart->MCR = 0;             // Disable modem controls (DTR, DSR, RTS, CTS)
+    uart->IER |= UART_IE_RBR;  // Enable RX/TX interrupts
 
     // Ensure a clean start, no data in either TX or RX FIFO
     flush();
     clearBuffers();
 
     // Drop data from the RX FIFO
-    while (LPC_UART->LSR & LSR_RDR)
-        val = LPC_UART->RBR;
+    while (uart->LSR & LSR_RDR)
+        val = uart->RBR;
 
-    enableInterrupt(UART_IRQn);
+    setInterruptPriority(irqn, ISR_PRIO_PERIPHERAL);
+    enableInterrupt(irqn);
 }
 
 void Serial::end()
 {
     flush();
-    disableInterrupt(UART_IRQn);
-    LPC_SYSCON->SYSAHBCLKCTRL &= ~(1 << 12); // Disable UART clock
+    disableInterrupt(irqn);
+    if (uart == LPC_UART)
+        LPC_SYSCON->SYSAHBCLKCTRL &= ~(1 << 12); // Disable UART clock
 }
 
 int Serial::write(byte ch)
@@ -105,18 +158,18 @@ int Serial::write(byte ch)
 #ifdef SERIAL_WRITE_DIRECT
 
     // wait until the transmitter hold register is free
-   while (!(LPC_UART->LSR & LSR_THRE))
+   while (!(uart->LSR & LSR_THRE))
        ;
-   LPC_UART->THR = ch;
+   uart->THR = ch;
    return 1;
 
 #else
 
-    if (writeHead == writeTail && (LPC_UART->LSR & LSR_THRE))
+    if (writeHead == writeTail && (uart->LSR & LSR_THRE))
     {
         // Transmitter hold register and write buffer are empty -> directly send
-        LPC_UART->THR = ch;
-        LPC_UART->IER |= UART_IE_THRE;
+        uart->THR = ch;
+        uart->IER |= UART_IE_THRE;
         return 1;
     }
 
@@ -128,16 +181,154 @@ int Serial::write(byte ch)
 
     writeBuffer[writeTail] = ch;
     writeTail = writeTailNext;
-    LPC_UART->IER |= UART_IE_THRE;
+    uart->IER |= UART_IE_THRE;
 
     return 1;
 
 #endif
 }
 
+int Serial::write(const byte* data, int count)
+{
+#ifdef SERIAL_WRITE_DIRECT
+
+    return Print::write(data, count);
+
+#else
+
+    if (count <= 0)
+        return 0;
+
+    int written = count;
+
+    if (writeHead == writeTail && (uart->LSR & LSR_THRE))
+    {
+        // Transmitter hold register and write buffer are empty -> put the
+        // first bytes directly into the TX FIFO
+        for (int i = 0; i < UART_FIFO_SIZE && count > 0; ++i, --count)
+            uart->THR = *data++;
+
+        uart->IER |= UART_IE_THRE;
+    }
+
+    while (count > 0)
+    {
+        // Wait until the output buffer has space
+        int free;
+        do
+        {
+            free = (writeHead - writeTail - 1) & BufferedStream::BUFFER_SIZE_MASK;
+        }
+        while (!free);
+
+        // Copy into the ring, not past the buffer end - the rest follows
+        // in the next round from the buffer start
+        int chunk = count < free ? count : free;
+        int toEnd = BufferedStream::BUFFER_SIZE - writeTail;
+        if (chunk > toEnd) chunk = toEnd;
+
+        memcpy((void*) (writeBuffer + writeTail), data, chunk);
+        writeTail = (writeTail + chunk) & BufferedStream::BUFFER_SIZE_MASK;
+
+        data += chunk;
+        count -= chunk;
+
+        uart->IER |= UART_IE_THRE;
+    }
+
+    return written;
+
+#endif
+}
+
+bool Serial::transmitBlock(const byte* data, int count)
+{
+    if (txBlockCount || count <= 0)
+        return false; // a previous block transfer is still running
+
+    disableInterrupt(irqn);
+
+    txBlock = data;
+    txBlockCount = count;
+
+    if (writeHead == writeTail && (uart->LSR & LSR_THRE))
+    {
+        // The transmitter is idle: prime the TX FIFO now, the THRE
+        // interrupt continues the transfer
+        for (int i = 0; i < UART_FIFO_SIZE && txBlockCount; ++i, --txBlockCount)
+            uart->THR = *txBlock++;
+    }
+
+    uart->IER |= UART_IE_THRE;
+    enableInterrupt(irqn);
+
+    return true;
+}
+
+void Serial::enableDirectionControl(int dePin, int turnaround)
+{
+    pinMode(dePin, SERIAL_DIR);
+
+    // The UART drives the direction pin itself: asserted with the start
+    // bit, released the configured number of baud clocks after the last
+    // stop bit has left the shift register
+    uart->RS485DLY = turnaround;
+    uart->RS485CTRL = RS485CTRL_DCTRL | RS485CTRL_OINV;
+}
+
+void Serial::disableDirectionControl()
+{
+    uart->RS485CTRL = 0;
+}
+
+void Serial::enableFlowControl(int aRtsPin)
+{
+    rtsPin = aRtsPin;
+    pinMode(rtsPin, OUTPUT);
+    digitalWrite(rtsPin, 0);  // low: ready to receive
+
+    flowPaused = false;
+    flowMode = FLOW_RTS;
+}
+
+void Serial::enableFlowControlXonXoff()
+{
+    flowPaused = false;
+    pendingFlow = 0;
+    flowMode = FLOW_XON_XOFF;
+}
+
+void Serial::disableFlowControl()
+{
+    // Release a paused peer before giving up the control
+    if (flowPaused)
+    {
+        if (flowMode == FLOW_RTS)
+            digitalWrite(rtsPin, 0);
+        else if (flowMode == FLOW_XON_XOFF)
+            sendFlowChar(SERIAL_XON);
+        flowPaused = false;
+    }
+
+    flowMode = FLOW_NONE;
+}
+
+void Serial::sendFlowChar(byte ch)
+{
+    pendingFlow = ch;
+    uart->IER |= UART_IE_THRE;
+
+    if (uart->LSR & LSR_THRE)
+    {
+        // The TX FIFO is empty: send right away
+        pendingFlow = 0;
+        uart->THR = ch;
+    }
+}
+
 void Serial::flush()
 {
-    while ((LPC_UART->LSR & (LSR_THRE|LSR_TEMT)) != (LSR_THRE|LSR_TEMT))
+    while ((uart->LSR & (LSR_THRE|LSR_TEMT)) != (LSR_THRE|LSR_TEMT))
         ;
 }
 
@@ -146,11 +337,26 @@ int Serial::read()
     bool readFull = readBufferFull();
     int ch = BufferedStream::read();
 
-    if (readFull && (LPC_UART->LSR & LSR_RDR))
+    if (readFull && (uart->LSR & LSR_RDR))
     {
-        disableInterrupt(UART_IRQn);
+        disableInterrupt(irqn);
         interruptHandler();
-        enableInterrupt(UART_IRQn);
+        enableInterrupt(irqn);
+    }
+
+    // Release a paused peer when the ring has drained to the low watermark
+    if (flowPaused && available() <= FLOW_LOW_WATER)
+    {
+        disableInterrupt(irqn);
+        if (flowPaused)
+        {
+            flowPaused = false;
+            if (flowMode == FLOW_RTS)
+                digitalWrite(rtsPin, 0);
+            else if (flowMode == FLOW_XON_XOFF)
+                sendFlowChar(SERIAL_XON);
+        }
+        enableInterrupt(irqn);
     }
 
     return ch;
@@ -158,26 +364,68 @@ int Serial::read()
 
 void Serial::interruptHandler()
 {
-    if (LPC_UART->LSR & LSR_THRE)
+    if (uart->LSR & LSR_THRE)
     {
-        if (writeHead == writeTail)
+        // THRE means the TX FIFO is empty: refill it in one go instead of
+        // sending a single character per interrupt. Buffered output goes
+        // first, then a pending background block (see transmitBlock())
+        int space = UART_FIFO_SIZE;
+
+        // A pending XON/XOFF jumps the queue, the peer shall see it early
+        if (pendingFlow)
         {
-            LPC_UART->IER &= ~UART_IE_THRE;
+            uart->THR = pendingFlow;
+            pendingFlow = 0;
+            --space;
         }
-        else
+
+        while (space > 0 && writeHead != writeTail)
         {
-            LPC_UART->THR = writeBuffer[writeHead];
+            uart->THR = writeBuffer[writeHead];
 
             ++writeHead;
             writeHead &= BufferedStream::BUFFER_SIZE_MASK;
+            --space;
+        }
+
+        while (space > 0 && txBlockCount)
+        {
+            uart->THR = *txBlock++;
+            --txBlockCount;
+            --space;
+        }
+
+        // Nothing was sent in this pass: the output has fully drained
+        if (space == UART_FIFO_SIZE)
+        {
+            uart->IER &= ~UART_IE_THRE;
+
+            // The write buffer has drained and the TX FIFO is empty
+            if (txCompleteHandler)
+                txCompleteHandler();
+            eventSet(EVENT_SERIAL_TX);
         }
     }
 
-    while ((LPC_UART->LSR & LSR_RDR) && !readBufferFull())
+    if (uart->LSR & LSR_RDR)
+        eventSet(EVENT_SERIAL_RX);
+
+    while ((uart->LSR & LSR_RDR) && !readBufferFull())
     {
-        readBuffer[readTail] = LPC_UART->RBR;
+        readBuffer[readTail] = uart->RBR;
 
         ++readTail;
         readTail &= BufferedStream::BUFFER_SIZE_MASK;
     }
+
+    // Pause the peer when the ring filled to the high watermark
+    if (flowMode != FLOW_NONE && !flowPaused &&
+        ((readTail - readHead) & BufferedStream::BUFFER_SIZE_MASK) >= FLOW_HIGH_WATER)
+    {
+        flowPaused = true;
+        if (flowMode == FLOW_RTS)
+            digitalWrite(rtsPin, 1);
+        else
+            sendFlowChar(SERIAL_XOFF);
+    }
 }
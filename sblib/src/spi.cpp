@@ -9,6 +9,8 @@
  */
 
 #include <sblib/spi.h>
+#include <sblib/digital_pin.h>
+#include <sblib/interrupt.h>
 #include <sblib/timer.h>
 
 
@@ -51,23 +53,56 @@
 // ICR bit mask
 #define SSP_ICR_BITMASK  0x03
 
+// SPI interrupt mask: RX FIFO overrun
+#define SSP_IMSC_RORIM  (1<<0)
+// SPI interrupt mask: RX timeout (received frames linger below the trigger level)
+#define SSP_IMSC_RTIM   (1<<1)
+// SPI interrupt mask: RX FIFO at least half full
+#define SSP_IMSC_RXIM   (1<<2)
+// SPI interrupt mask: TX FIFO at least half empty
+#define SSP_IMSC_TXIM   (1<<3)
+
 // Convert SPI data size to bit offset
 #define SPI_DATA_SIZE_OFFS(x) ((x - 1)  & 15)
 
+// The depth of the SSP TX and RX FIFOs, in frames
+#define SSP_FIFO_SIZE 8
+
 
 // The SPI port registers
 static LPC_SSP_TypeDef* const ports[2] = { LPC_SSP0, LPC_SSP1 };
 
+// The SPI objects that use interrupt driven transfers, per port
+static SPI* instances[2];
+
 
 SPI::SPI(int portNum, int mode)
 :port(*ports[portNum])
 ,clockDiv(100)
 {
+    this->portNum = portNum;
+    irqn = portNum == 0 ? SSP0_IRQn : SSP1_IRQn;
+
+    txPtr = 0;
+    rxPtr = 0;
+    txRemaining = 0;
+    rxRemaining = 0;
+    wideFrames = false;
+    transferCompleteHandler = 0;
+    sselPin = -1;
+    sselHold = false;
+
+#ifdef SPI_BLOCK_TRANSFER
+    sndCount = 0;
+    recCount = 0;
+    finished = true;
+#endif
+
     // Enable AHB clock to the GPIO domain.
     LPC_SYSCON->SYSAHBCLKCTRL |= (1<<6);
 
-    // Disable reset of the SSP peripheral
-    LPC_SYSCON->PRESETCTRL |= portNum * 4;
+    // Disable reset of the SSP peripheral (SSP0: bit 0, SSP1: bit 2)
+    LPC_SYSCON->PRESETCTRL |= portNum == 0 ? 1 : 4;
 
     if (portNum == 0) // SPI port 0
     {
@@ -96,6 +131,17 @@ SPI::SPI(int portNum, int mode)
     port.CPSR = 2;
 }
 
+void SPI::setSlaveSelect(int pin)
+{
+    sselPin = pin;
+
+    if (pin >= 0)
+    {
+        digitalWrite(pin, true); // the slave select is active low
+        pinMode(pin, OUTPUT);
+    }
+}
+
 void SPI::setClockDivider(int div)
 {
     port.CR0 = (port.CR0 & ~0xff00) | (((div - 1) & 255) << 8);
@@ -108,6 +154,7 @@ void SPI::setDataSize(SpiDataSize dataSize)
 
 void SPI::begin()
 {
+    setInterruptPriority(irqn, ISR_PRIO_PERIPHERAL);
     port.CR1 |= SSP_CR1_ENABLED;
 }
 
@@ -125,6 +172,9 @@ int SPI::transfer(int val, SpiTransferMode transferMode)
     // Clear the interrupt status
     port.ICR = SSP_ICR_BITMASK;
 
+    if (sselPin >= 0)
+        digitalWrite(sselPin, false); // assert the slave select
+
     // Write value to the buffer
     port.DR = val;
 
@@ -132,13 +182,259 @@ int SPI::transfer(int val, SpiTransferMode transferMode)
     while (port.SR & SSP_SR_BSY)
         ;
 
+    if (sselPin >= 0 && transferMode == SPI_LAST)
+        digitalWrite(sselPin, true);
+
     // Return read value
     return port.DR;
 }
 
+int SPI::transferBlock(const byte* txData, byte* rxData, int count,
+    SpiTransferMode transferMode)
+{
+    if (count <= 0)
+        return 0;
+
+    // Clear all remaining data in the receive FIFO
+    while (port.SR & SSP_SR_RNE)
+        port.DR;  // reading is supported without assignment to a temporary variable
+
+    // Clear the interrupt status
+    port.ICR = SSP_ICR_BITMASK;
+
+    if (sselPin >= 0)
+        digitalWrite(sselPin, false); // assert the slave select
+
+    int sent = 0, received = 0;
+
+    while (received < count)
+    {
+        // Keep the TX FIFO topped up. At most SSP_FIFO_SIZE frames may be
+        // in flight, otherwise the RX FIFO could overflow and drop frames
+        while (sent < count && sent - received < SSP_FIFO_SIZE &&
+               (port.SR & SSP_SR_TNF))
+        {
+            port.DR = txData ? *txData++ : 0xff;
+            ++sent;
+        }
+
+        while (received < sent && (port.SR & SSP_SR_RNE))
+        {
+            int val = port.DR;
+            if (rxData) *rxData++ = val;
+            ++received;
+        }
+    }
+
+    if (sselPin >= 0 && transferMode == SPI_LAST)
+        digitalWrite(sselPin, true);
+
+    return count;
+}
+
+int SPI::transferBlock16(const uint16_t* txData, uint16_t* rxData, int count,
+    SpiTransferMode transferMode)
+{
+    if (count <= 0)
+        return 0;
+
+    // Clear all remaining data in the receive FIFO
+    while (port.SR & SSP_SR_RNE)
+        port.DR;  // reading is supported without assignment to a temporary variable
+
+    // Clear the interrupt status
+    port.ICR = SSP_ICR_BITMASK;
+
+    if (sselPin >= 0)
+        digitalWrite(sselPin, false); // assert the slave select
+
+    int sent = 0, received = 0;
+
+    while (received < count)
+    {
+        // Keep the TX FIFO topped up. At most SSP_FIFO_SIZE frames may be
+        // in flight, otherwise the RX FIFO could overflow and drop frames
+        while (sent < count && sent - received < SSP_FIFO_SIZE &&
+               (port.SR & SSP_SR_TNF))
+        {
+            port.DR = txData ? *txData++ : 0xffff;
+            ++sent;
+        }
+
+        while (received < sent && (port.SR & SSP_SR_RNE))
+        {
+            int val = port.DR;
+            if (rxData) *rxData++ = val;
+            ++received;
+        }
+    }
+
+    if (sselPin >= 0 && transferMode == SPI_LAST)
+        digitalWrite(sselPin, true);
+
+    return count;
+}
+
+bool SPI::startTransfer(const byte* txData, byte* rxData, int count,
+    SpiTransferMode transferMode)
+{
+    if (rxRemaining || count <= 0)
+        return false; // a previous transfer is still running
+
+    // Clear all remaining data in the receive FIFO
+    while (port.SR & SSP_SR_RNE)
+        port.DR;  // reading is supported without assignment to a temporary variable
+
+    // Clear the interrupt status
+    port.ICR = SSP_ICR_BITMASK;
+
+    if (sselPin >= 0)
+        digitalWrite(sselPin, false); // assert the slave select
+    sselHold = transferMode == SPI_CONTINUE;
+
+    txPtr = txData;
+    rxPtr = rxData;
+    rxRemaining = count;
+    txRemaining = count;
+    wideFrames = false;
+
+    instances[portNum] = this;
+
+    // Prime the TX FIFO, the SSP interrupt continues the transfer
+    while (txRemaining && rxRemaining - txRemaining < SSP_FIFO_SIZE)
+    {
+        port.DR = txPtr ? *txPtr++ : 0xff;
+        --txRemaining;
+    }
+
+    // Interrupt when the RX FIFO is half full and on receive timeout: the
+    // timeout delivers the tail of a transfer that ends below the trigger
+    // level
+    port.IMSC |= SSP_IMSC_RXIM | SSP_IMSC_RTIM;
+    enableInterrupt(irqn);
+
+    return true;
+}
+
+bool SPI::startTransfer16(const uint16_t* txData, uint16_t* rxData, int count,
+    SpiTransferMode transferMode)
+{
+    if (rxRemaining || count <= 0)
+        return false; // a previous transfer is still running
+
+    // Clear all remaining data in the receive FIFO
+    while (port.SR & SSP_SR_RNE)
+        port.DR;  // reading is supported without assignment to a temporary variable
+
+    // Clear the interrupt status
+    port.ICR = SSP_ICR_BITMASK;
+
+    if (sselPin >= 0)
+        digitalWrite(sselPin, false); // assert the slave select
+    sselHold = transferMode == SPI_CONTINUE;
+
+    // The frame pointers advance by two bytes per frame in the interrupt
+    txPtr = (const byte*) txData;
+    rxPtr = (byte*) rxData;
+    rxRemaining = count;
+    txRemaining = count;
+    wideFrames = true;
+
+    instances[portNum] = this;
+
+    // Prime the TX FIFO, the SSP interrupt continues the transfer
+    while (txRemaining && rxRemaining - txRemaining < SSP_FIFO_SIZE)
+    {
+        if (txPtr)
+        {
+            port.DR = *(const uint16_t*) txPtr;
+            txPtr += 2;
+        }
+        else port.DR = 0xffff;
+        --txRemaining;
+    }
+
+    // Interrupt when the RX FIFO is half full and on receive timeout: the
+    // timeout delivers the tail of a transfer that ends below the trigger
+    // level
+    port.IMSC |= SSP_IMSC_RXIM | SSP_IMSC_RTIM;
+    enableInterrupt(irqn);
+
+    return true;
+}
+
+void SPI::interruptHandler()
+{
 #ifdef SPI_BLOCK_TRANSFER
+    if (sndCount || recCount)
+    {
+        // A transfer that was started with transferBlock() is running
+        continueBlockTransfer();
+        return;
+    }
+#endif
 
-static SPI * instances[2];
+    // Drain the RX FIFO first, then refill the TX FIFO with the freed frames
+    while (rxRemaining && (port.SR & SSP_SR_RNE))
+    {
+        int val = port.DR;
+        if (rxPtr)
+        {
+            if (wideFrames)
+            {
+                *(uint16_t*) rxPtr = val;
+                rxPtr += 2;
+            }
+            else *rxPtr++ = val;
+        }
+        --rxRemaining;
+    }
+
+    while (txRemaining && rxRemaining - txRemaining < SSP_FIFO_SIZE &&
+           (port.SR & SSP_SR_TNF))
+    {
+        if (!txPtr)
+            port.DR = wideFrames ? 0xffff : 0xff;
+        else if (wideFrames)
+        {
+            port.DR = *(const uint16_t*) txPtr;
+            txPtr += 2;
+        }
+        else port.DR = *txPtr++;
+        --txRemaining;
+    }
+
+    // Clear the receive timeout interrupt
+    port.ICR = SSP_ICR_BITMASK;
+
+    if (!rxRemaining)
+    {
+        port.IMSC &= ~(SSP_IMSC_RXIM | SSP_IMSC_RTIM);
+
+        if (sselPin >= 0 && !sselHold)
+            digitalWrite(sselPin, true);
+
+        if (transferCompleteHandler)
+            transferCompleteHandler();
+    }
+}
+
+extern "C" {
+volatile uint32_t int_ssp_0 = 0;
+
+void SSP0_IRQHandler (void)
+{
+    int_ssp_0++;
+    instances[0]->interruptHandler();
+}
+void SSP1_IRQHandler (void)
+{
+    instances[1]->interruptHandler();
+}
+
+}
+
+#ifdef SPI_BLOCK_TRANSFER
 
 void SPI::transferBlock(uint16_t * sndData, int bytes, uint16_t * recData, bool asynchron)
 {
@@ -163,7 +459,7 @@ void SPI::transferBlock(uint16_t * sndData, int bytes, uint16_t * recData, bool
     {
         int no = & port == LPC_SSP0 ? 0 : 1;
         instances[no] = this;
-        port.IMSC    |= (1 << 3); // XXX
+        port.IMSC    |= SSP_IMSC_TXIM;
         if (! no)
         {
             NVIC_EnableIRQ(SSP0_IRQn);
@@ -189,7 +485,7 @@ void SPI::continueBlockTransfer(void)
             tmpVal = port.DR;
             if (recData) *recData++ = tmpVal;
         }
-        LPC_SSP0->DR = *sndData++;
+        port.DR = *sndData++;
         errors |= port.RIS;
        }
     while (recCount && (port.SR & SSP_SR_RNE))
@@ -211,7 +507,7 @@ void SPI::continueBlockTransfer(void)
             NVIC_DisableIRQ(SSP1_IRQn);
         }
         instances[no] = 0;
-        port.IMSC    &= ~(1 << 3); // XXX
+        port.IMSC    &= ~SSP_IMSC_TXIM;
         finished      = true;
     }
 }
@@ -221,19 +517,4 @@ void SPI::finalizeBlockTransfer(void)
     while (recCount)
         continueBlockTransfer();
 }
-
-extern "C" {
-volatile uint32_t int_ssp_0 = 0;
-
-void SSP0_IRQHandler (void)
-{
-    int_ssp_0++;
-    instances[0]->continueBlockTransfer();
-}
-void SSP1_IRQHandler (void)
-{
-    instances[1]->continueBlockTransfer();
-}
-
-}
 #endif
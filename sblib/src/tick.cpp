@@ -0,0 +1,80 @@
+/*
+ *  tick.cpp - The consolidated housekeeping tick of the library.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/tick.h>
+
+#include <sblib/timeout.h>
+#include <sblib/timer.h>
+
+// The attached handlers per tier, packed to the front
+static TickHandler handlers[2][TICK_MAX_HANDLERS];
+
+// The number of attached handlers per tier
+static short handlerCount[2];
+
+// The system time of the last serviced tick
+static unsigned int lastTick;
+
+// The system time of the next 100 Hz tick
+static unsigned int next100;
+
+
+bool tickAttach(TickHandler handler, TickRate rate)
+{
+    if (handlerCount[rate] == TICK_MAX_HANDLERS)
+        return false;
+
+    handlers[rate][handlerCount[rate]++] = handler;
+    return true;
+}
+
+void tickDetach(TickHandler handler)
+{
+    for (int rate = 0; rate < 2; ++rate)
+    {
+        for (int i = 0; i < handlerCount[rate]; ++i)
+        {
+            if (handlers[rate][i] != handler)
+                continue;
+
+            // Close the gap so the handlers stay packed
+            for (--handlerCount[rate]; i < handlerCount[rate]; ++i)
+                handlers[rate][i] = handlers[rate][i + 1];
+            return;
+        }
+    }
+}
+
+void tickCheck()
+{
+    unsigned int now = millis();
+    if (now == lastTick)
+        return;
+    lastTick = now;
+
+    // The 1 kHz tier: at most once per millisecond. After a stall the
+    // missed ticks are not caught up - periodic sampling work gains
+    // nothing from running several times back to back
+    ScheduledTimeout::checkNext();
+
+    for (int i = 0; i < handlerCount[TICK_1KHZ]; ++i)
+        handlers[TICK_1KHZ][i]();
+
+    // The 100 Hz tier, with the backlog shed after a stall
+    if ((int) (now - next100) >= 0)
+    {
+        next100 += 10;
+        if ((int) (now - next100) >= 0)
+            next100 = now + 10;
+
+        for (int i = 0; i < handlerCount[TICK_100HZ]; ++i)
+            handlers[TICK_100HZ][i]();
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ *  timeout.cpp - Scheduled timeouts with a deadline-sorted list.
+ *
+ *  Copyright (C) 2014-2015 Martin Glück <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/timeout.h>
+
+
+ScheduledTimeout* ScheduledTimeout::first;
+
+
+ScheduledTimeout::ScheduledTimeout(void)
+: timeout(0)
+, period(0)
+, cb(0)
+, cbParam(0)
+, next(0)
+, queued(false)
+{
+}
+
+void ScheduledTimeout::callback(TimeoutCallback cb, void* param)
+{
+	this->cb = cb;
+	cbParam = param;
+}
+
+void ScheduledTimeout::start(unsigned int ms)
+{
+	remove();
+
+	if (0 == ms)
+		return;
+
+	timeout = millis() + ms;
+	period = 0;
+	insert();
+}
+
+void ScheduledTimeout::startPeriodic(unsigned int ms)
+{
+	start(ms);
+	period = ms;
+}
+
+void ScheduledTimeout::stop(void)
+{
+	remove();
+	period = 0;
+}
+
+void ScheduledTimeout::checkNext(void)
+{
+	while (first && ((int) (millis() - first->timeout)) >= 0)
+	{
+		ScheduledTimeout* expired = first;
+		first = expired->next;
+		expired->queued = false;
+
+		if (expired->period)
+		{
+			// Advance from the deadline, not from now, to avoid drift
+			expired->timeout += expired->period;
+			expired->insert();
+		}
+
+		if (expired->cb)
+			expired->cb(expired->cbParam);
+	}
+}
+
+unsigned int ScheduledTimeout::nextDelay(void)
+{
+	if (!first)
+		return ~0u;
+
+	int delay = (int) (first->timeout - millis());
+	return delay <= 0 ? 0 : (unsigned int) delay;
+}
+
+void ScheduledTimeout::insert(void)
+{
+	ScheduledTimeout** link = &first;
+	while (*link && ((int) (timeout - (*link)->timeout)) >= 0)
+		link = &(*link)->next;
+
+	next = *link;
+	*link = this;
+	queued = true;
+}
+
+void ScheduledTimeout::remove(void)
+{
+	if (!queued)
+		return;
+
+	for (ScheduledTimeout** link = &first; *link; link = &(*link)->next)
+	{
+		if (*link == this)
+		{
+			*link = next;
+			break;
+		}
+	}
+	queued = false;
+}
@@ -22,46 +22,17 @@ static LPC_TMR_TypeDef* const timers[4] = { LPC_TMR16B0, LPC_TMR16B1, LPC_TMR32B
 
 void delay(unsigned int msec)
 {
-    unsigned int lastSystemTime = systemTime;
+    unsigned int start = millis();
+    unsigned int done;
 
-    while (msec)
+    while ((done = elapsed(start)) < msec)
     {
-        if (lastSystemTime == systemTime)
-        {
-            __WFI();
-        }
-        else
-        {
-            lastSystemTime = systemTime;
-            --msec;
-        }
+        // Sleep until the remaining time passed; any other interrupt
+        // ends the sleep early and the loop re-checks
+        microsSleep((msec - done) * 1000);
     }
 }
 
-#ifndef IAP_EMULATION
-void delayMicroseconds(unsigned int usec)
-{
-    unsigned int val, lastVal = SysTick->VAL;
-    int ticksToWait = (usec - 2) * (SystemCoreClock / 1000000);
-    int elapsed;
-
-    // SysTick is counting down and is reset to SysTick->LOAD when
-    // it reaches zero.
-
-    while (ticksToWait > 0)
-    {
-        val = SysTick->VAL;
-
-        elapsed = lastVal - val;
-        if (elapsed < 0)
-            elapsed += SysTick->LOAD;
-
-        ticksToWait -= elapsed;
-        lastVal = val;
-    }
-}
-#endif
-
 //----- Class Timer -----------------------------------------------------------
 
 Timer timer16_0(TIMER16_0);
@@ -169,11 +140,3 @@ void Timer::counterMode(int mode, int clearMode)
     timer->CTCR = config;
 }
 
-//
-// The original timer handler is used for performance reasons.
-// Use attachInterrupt() to override this handler.
-//
-extern "C" void SysTick_Handler()
-{
-    ++systemTime;
-}
@@ -0,0 +1,98 @@
+/*
+ *  trace.cpp - Compile-out event counters and tracepoints.
+ *
+ *  Copyright (c) 2015 Stefan Taferner <stefan.taferner@gmx.at>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <sblib/trace.h>
+
+#ifdef SB_TRACE
+
+#include <sblib/print.h>
+#include <sblib/timer.h>
+
+// One recorded trace event
+struct TraceEventEntry
+{
+    unsigned int time;     // the millisecond timestamp
+    unsigned short id;     // the trace point id
+    unsigned int value;    // the recorded value
+};
+
+static unsigned int traceCounters[TRACE_ID_COUNT];
+static TraceEventEntry traceEvents[TRACE_EVENT_RING];
+static unsigned int traceEventCount;
+
+
+void traceCount(int id)
+{
+    ++traceCounters[id];
+}
+
+void traceEvent(int id, unsigned int value)
+{
+    TraceEventEntry* entry = traceEvents + traceEventCount % TRACE_EVENT_RING;
+
+    ++traceCounters[id];
+    ++traceEventCount;
+
+    entry->time = millis();
+    entry->id = id;
+    entry->value = value;
+}
+
+unsigned int traceCounter(int id)
+{
+    return traceCounters[id];
+}
+
+void traceClear()
+{
+    for (int i = 0; i < TRACE_ID_COUNT; ++i)
+        traceCounters[i] = 0;
+    traceEventCount = 0;
+}
+
+// Write a little endian value to the sink
+static void traceWrite(Print& out, unsigned int value, int numBytes)
+{
+    for (int i = 0; i < numBytes; ++i)
+    {
+        out.write((byte) value);
+        value >>= 8;
+    }
+}
+
+void traceDrain(Print& out)
+{
+    unsigned int numEvents = traceEventCount;
+    if (numEvents > TRACE_EVENT_RING)
+        numEvents = TRACE_EVENT_RING;
+
+    out.write((const byte*) "SBTR", 4);
+    out.write((byte) 1);                // format version
+    out.write((byte) TRACE_ID_COUNT);
+    out.write((byte) numEvents);
+    out.write((byte) 0);                // reserved
+
+    for (int i = 0; i < TRACE_ID_COUNT; ++i)
+        traceWrite(out, traceCounters[i], 4);
+
+    // The ring is drained oldest first
+    unsigned int first = traceEventCount - numEvents;
+    for (unsigned int i = 0; i < numEvents; ++i)
+    {
+        const TraceEventEntry* entry =
+            traceEvents + (first + i) % TRACE_EVENT_RING;
+
+        traceWrite(out, entry->time, 4);
+        traceWrite(out, entry->id, 2);
+        traceWrite(out, entry->value, 4);
+    }
+}
+
+#endif /*SB_TRACE*/
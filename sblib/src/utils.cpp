@@ -16,6 +16,19 @@
 
 void reverseCopy(byte* dest, const byte* src, int len)
 {
+    // Copy a word at a time where the alignment allows it: a word load, a
+    // byte swap (a single REV instruction on Cortex-M0) and a word store
+    // replace 4 separate byte copies
+    while (len >= 4 && !((unsigned long) dest & 3) && !((unsigned long) (src + len - 4) & 3))
+    {
+        unsigned int word = *(const unsigned int*) (src + len - 4);
+        word = (word >> 24) | ((word >> 8) & 0xff00) | ((word << 8) & 0xff0000) | (word << 24);
+        *(unsigned int*) dest = word;
+
+        dest += 4;
+        len -= 4;
+    }
+
     src += len - 1;
     while (len > 0)
     {
@@ -24,6 +37,65 @@ void reverseCopy(byte* dest, const byte* src, int len)
     }
 }
 
+void copyData(byte* dest, const byte* src, int len)
+{
+    // When both pointers have the same misalignment, copy the unaligned
+    // head byte-wise and the bulk with word loads and stores
+    if ((((unsigned long) dest ^ (unsigned long) src) & 3) == 0)
+    {
+        while (((unsigned long) dest & 3) && len > 0)
+        {
+            *dest++ = *src++;
+            --len;
+        }
+
+        while (len >= 4)
+        {
+            *(unsigned int*) dest = *(const unsigned int*) src;
+            dest += 4;
+            src += 4;
+            len -= 4;
+        }
+    }
+
+    while (len > 0)
+    {
+        *dest++ = *src++;
+        --len;
+    }
+}
+
+bool equalData(const byte* a, const byte* b, int len)
+{
+    if ((((unsigned long) a ^ (unsigned long) b) & 3) == 0)
+    {
+        while (((unsigned long) a & 3) && len > 0)
+        {
+            if (*a++ != *b++)
+                return false;
+            --len;
+        }
+
+        while (len >= 4)
+        {
+            if (*(const unsigned int*) a != *(const unsigned int*) b)
+                return false;
+            a += 4;
+            b += 4;
+            len -= 4;
+        }
+    }
+
+    while (len > 0)
+    {
+        if (*a++ != *b++)
+            return false;
+        --len;
+    }
+
+    return true;
+}
+
 void fatalError()
 {
     // We use only low level functions here as a fatalError() could happen
@@ -0,0 +1,95 @@
+/*
+ *  com_object_flags.cpp - Tests for the word-parallel com-object flag
+ *  operations.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/user_memory.h"
+#include "sblib/internal/functions.h"
+#include "iap_emu.h"
+
+/*
+ * A config table with 10 objects, so the second group of 8 is partial.
+ * The status flags live in the userRam at 0x30.
+ */
+static void setupTables(void)
+{
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 10;
+    commsTab[1] = 0x30;          // status flags in userRam
+    for (int i = 0; i < 10; ++i)
+    {
+        commsTab[2 + 3 * i] = 0x60 + i;
+        commsTab[3 + 3 * i] = COMCONF_TRANS_COMM;
+        commsTab[4 + 3 * i] = BIT_1;
+    }
+
+    updateObjectCache();
+
+    // Start with a clean flags table and clean pending hints
+    byte* flagsTab = objectFlagsTable();
+    for (int i = 0; i < 5; ++i)
+        flagsTab[i] = 0;
+    clearTransmitFlags();
+    unsigned int drain[8];
+    snapshotUpdatedObjects(drain);
+}
+
+TEST_CASE("Word-parallel com-object flag operations", "[sblib][comflags]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    setupTables();
+
+    byte* flagsTab = objectFlagsTable();
+
+    // Adding flags to every second object of the first group sets the
+    // same nibbles as the per object call
+    addObjectFlagsMasked(0, 0x55, COMFLAG_TRANSREQ);
+    REQUIRE(flagsTab[0] == COMFLAG_TRANSREQ);
+    REQUIRE(flagsTab[1] == COMFLAG_TRANSREQ);
+    REQUIRE(flagsTab[2] == COMFLAG_TRANSREQ);
+    REQUIRE(flagsTab[3] == COMFLAG_TRANSREQ);
+    REQUIRE(objectTransmitPending());
+
+    REQUIRE(testObjectFlagsMasked(0, 0xff, COMFLAG_TRANSREQ) == 0x55);
+
+    // Clearing a subset leaves the other objects untouched
+    clearObjectFlagsMasked(0, 0x11, COMFLAG_TRANS_MASK);
+    REQUIRE(testObjectFlagsMasked(0, 0xff, COMFLAG_TRANSREQ) == 0x44);
+    REQUIRE(flagsTab[0] == 0);
+    REQUIRE(flagsTab[1] == COMFLAG_TRANSREQ);
+
+    // The bulk clear wipes the transmission status of all objects
+    clearTransmitFlags();
+    REQUIRE(testObjectFlagsMasked(0, 0xff, COMFLAG_TRANS_MASK) == 0);
+    REQUIRE(!objectTransmitPending());
+
+    // The partial second group: only the objects 8 and 9 exist
+    addObjectFlagsMasked(8, 0x03, COMFLAG_UPDATE);
+    addObjectFlags(3, COMFLAG_UPDATE);
+
+    unsigned int snapshot[8];
+    REQUIRE(snapshotUpdatedObjects(snapshot) == 1);
+    REQUIRE(snapshot[0] == 0x308);
+
+    // The snapshot cleared the update flags
+    REQUIRE(testObjectFlagsMasked(0, 0xff, COMFLAG_UPDATE) == 0);
+    REQUIRE(testObjectFlagsMasked(8, 0xff, COMFLAG_UPDATE) == 0);
+    REQUIRE(nextUpdatedObject() == -1);
+
+    // An empty snapshot still reports the word count
+    REQUIRE(snapshotUpdatedObjects(snapshot) == 1);
+    REQUIRE(snapshot[0] == 0);
+}
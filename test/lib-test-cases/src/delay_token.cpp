@@ -0,0 +1,44 @@
+/*
+ *  delay_token.cpp - Tests for the non-blocking microsecond delay.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/timer.h"
+
+extern volatile unsigned int systemTime;
+
+TEST_CASE("Non-blocking delay token", "[sblib][timer]")
+{
+    systemTime = 1000;
+
+    // A default constructed token is expired
+    DelayToken token;
+    REQUIRE(token.expired());
+    REQUIRE(token.remaining() == 0);
+
+    // 5 msec delay: not expired until the clock passed it
+    token.start(5000);
+    REQUIRE(!token.expired());
+    REQUIRE(token.remaining() > 4000);
+
+    systemTime = 1003;
+    REQUIRE(!token.expired());
+    REQUIRE(token.remaining() <= 3000);
+
+    systemTime = 1006;
+    REQUIRE(token.expired());
+    REQUIRE(token.remaining() == 0);
+
+    // The token can be restarted
+    token.start(2000);
+    REQUIRE(!token.expired());
+    systemTime = 1009;
+    REQUIRE(token.expired());
+}
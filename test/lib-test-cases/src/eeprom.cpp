@@ -107,6 +107,9 @@ TEST_CASE("Enhanced EEPROM tests","[EEPROM][SBLIB][ERASE]")
         {
             memcpy(iap_save, iap_calls, sizeof (iap_calls));
             bcu.begin(0, 0, 0);
+            // Change the content: a commit with an unchanged image writes
+            // no flash at all since the modified-page tracking
+            userEeprom[0x100] = i;
             userEeprom.modified();
             bcu.end();
             REQUIRE(iap_calls [I_PREPARE]     == (iap_save [I_PREPARE]     + 1));
@@ -117,6 +120,7 @@ TEST_CASE("Enhanced EEPROM tests","[EEPROM][SBLIB][ERASE]")
         }
         memcpy(iap_save, iap_calls, sizeof (iap_calls));
         bcu.begin(0, 0, 0);
+        userEeprom[0x100] = 0x55;
         userEeprom.modified();
         bcu.end();
         REQUIRE(iap_calls [I_PREPARE]     == (iap_save [I_PREPARE]     + 2));
@@ -0,0 +1,110 @@
+/*
+ *  event_flags.cpp - Tests for the event flags that connect interrupt
+ *  handlers to the main loop.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/event.h"
+#include "sblib/timeout.h"
+#include "bus_edge_gen.h"
+#include "iap_emu.h"
+
+extern volatile unsigned int systemTime;
+
+TEST_CASE("Event flags: set, peek, fetch", "[sblib][event]")
+{
+    eventFetch();  // drop flags left over from other tests
+    REQUIRE(eventPending() == 0);
+
+    // Setting accumulates, peeking does not clear
+    eventSet(EVENT_APP_FIRST);
+    eventSet(EVENT_SERIAL_RX);
+    REQUIRE(eventPending() == (EVENT_APP_FIRST | EVENT_SERIAL_RX));
+    REQUIRE(eventPending() == (EVENT_APP_FIRST | EVENT_SERIAL_RX));
+
+    // A masked fetch clears only the fetched flags
+    REQUIRE(eventFetch(EVENT_SERIAL_RX) == EVENT_SERIAL_RX);
+    REQUIRE(eventPending() == EVENT_APP_FIRST);
+    REQUIRE(eventFetch(EVENT_SERIAL_RX) == 0);
+
+    // The default fetch takes everything that is left
+    REQUIRE(eventFetch() == EVENT_APP_FIRST);
+    REQUIRE(eventPending() == 0);
+}
+
+TEST_CASE("Event flags: waiting", "[sblib][event]")
+{
+    systemTime = 1000;
+    eventFetch();
+
+    // A flag that was posted before the call ends the wait immediately
+    eventSet(EVENT_APP_FIRST << 1);
+    REQUIRE(eventWait(50) == (EVENT_APP_FIRST << 1));
+    REQUIRE(eventPending() == 0);
+
+    // Without a pending flag the wait runs into its timeout. On the host
+    // microsSleep() is a no-op and the test cannot advance the time from
+    // within the wait, so only the zero bound is checked
+    REQUIRE(eventWait(0) == 0);
+}
+
+TEST_CASE("Event flags: bounding the wait with the next timeout", "[sblib][event]")
+{
+    systemTime = 2000;
+
+    // No pending timeout: wait forever
+    REQUIRE(ScheduledTimeout::nextDelay() == ~0u);
+
+    ScheduledTimeout t;
+    t.start(30);
+    REQUIRE(ScheduledTimeout::nextDelay() == 30);
+
+    systemTime += 10;
+    REQUIRE(ScheduledTimeout::nextDelay() == 20);
+
+    // An expired deadline must not wait at all
+    systemTime += 25;
+    REQUIRE(ScheduledTimeout::nextDelay() == 0);
+
+    t.stop();
+    REQUIRE(ScheduledTimeout::nextDelay() == ~0u);
+}
+
+TEST_CASE("Event flags: posted by the bus", "[sblib][event]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+    busEdgeTimeout();
+    busEdgeTimeout();
+    eventFetch();
+
+    // A received telegram posts EVENT_BUS_RX from the bus handler
+    static const unsigned char tel[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+
+    busEdgeFeedTelegram(tel, sizeof(tel));
+    REQUIRE(bus.telegramReceived());
+    REQUIRE((eventFetch(EVENT_BUS_RX) & EVENT_BUS_RX) == EVENT_BUS_RX);
+    bus.discardReceivedTelegram();
+
+    // Draining the send queue posts EVENT_BUS_TX per finished telegram
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+    eventFetch();
+}
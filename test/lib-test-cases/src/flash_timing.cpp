@@ -0,0 +1,145 @@
+/*
+ *  flash_timing.cpp - Tests for the emulated flash timing model
+ *
+ *  The IAP emulation models the busy windows of erase and program
+ *  operations: the CPU cannot execute from flash while they run, so the
+ *  system time advances and interrupts are effectively blocked. These
+ *  tests check the busy time accounting and that telegram reception
+ *  recovers when a flash operation stalls the CPU mid-frame.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/internal/iap.h"
+#include "sblib/timer.h"
+#include "bus_edge_gen.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// A connection request to our own physical address 1.1.18
+static const unsigned char connectTel[] =
+    { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+
+// The busy time that the last flash operation reported
+static unsigned int lastBusyTime;
+
+static void busyHandler(unsigned int busyTime)
+{
+    lastBusyTime = busyTime;
+}
+
+TEST_CASE("Flash timing: busy time accounting","[sblib][flash]")
+{
+    IAP_Init_Flash(0xFF);
+    IAP_Set_Timing(100000, 2500, 1000);
+    IAP_Reset_Busy_Time();
+    IAP_Set_Busy_Handler(busyHandler);
+
+    unsigned int timeBefore = millis();
+
+    // A sector erase blocks for the full erase time
+    lastBusyTime = 0;
+    REQUIRE(iapEraseSector(6) == IAP_SUCCESS);
+    REQUIRE(IAP_Busy_Time() == 100000);
+    REQUIRE(lastBusyTime == 100000);
+
+    // A page erase is much shorter - this is why the MemMapper uses it
+    lastBusyTime = 0;
+    REQUIRE(iapErasePage(7 * 16) == IAP_SUCCESS);
+    REQUIRE(IAP_Busy_Time() == 102500);
+    REQUIRE(lastBusyTime == 2500);
+
+    // The busy windows advance the system time like the stalled CPU sees it
+    REQUIRE(millis() == timeBefore + 102);
+
+    IAP_Set_Busy_Handler(0);
+    IAP_Reset_Busy_Time();
+}
+
+TEST_CASE("Flash timing: reception survives a mid-frame stall","[sblib][flash]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+    IAP_Reset_Busy_Time();
+
+    unsigned int received = bus.stats.rxTelegrams;
+    unsigned int errors = bus.stats.checksumErrors;
+
+    // A frame before the flash activity is received normally
+    busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+    REQUIRE(bus.telegramReceived());
+    bus.discardReceivedTelegram();
+
+    // The next frame is interrupted: after three bytes a sector erase
+    // stalls the CPU for longer than the rest of the frame, the bus
+    // interrupts for the remaining edges are lost
+    busEdgeFeedBytes(connectTel, 3);
+    REQUIRE(iapEraseSector(6) == IAP_SUCCESS);
+    REQUIRE(IAP_Busy_Time() > 0);
+
+    // All the receiver sees after the stall is the line going quiet:
+    // the partial frame must be dropped, not delivered
+    busEdgeTimeout();
+    REQUIRE(!bus.telegramReceived());
+    REQUIRE(bus.stats.rxTelegrams == received + 1);
+    REQUIRE(bus.stats.checksumErrors == errors + 1);
+
+    // The remote repeats the frame, reception recovers cleanly
+    busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+    REQUIRE(bus.telegramReceived());
+    REQUIRE(memcmp(bus.telegram, connectTel, sizeof(connectTel)) == 0);
+    REQUIRE(bus.stats.rxTelegrams == received + 2);
+    bus.discardReceivedTelegram();
+}
+
+TEST_CASE("Flash erase planner: whole sectors use sector erase","[sblib][flash]")
+{
+    IAP_Init_Flash(0x00);
+    IAP_Set_Timing(100000, 2500, 1000);
+    IAP_Reset_Busy_Time();
+
+    int pageErases = iap_calls[I_ERASE_PAGE];
+    int sectorErases = iap_calls[I_ERASE];
+
+    // Pages 10..40 cover sector 1 completely: the edges (pages 10..15 and
+    // 32..40) are erased page by page, the middle with one sector erase
+    REQUIRE(iapEraseRange(10, 40) == IAP_SUCCESS);
+    REQUIRE(iap_calls[I_ERASE_PAGE] == pageErases + 2);
+    REQUIRE(iap_calls[I_ERASE] == sectorErases + 1);
+    REQUIRE(IAP_Busy_Time() == 15 * 2500 + 100000);
+
+    // The whole range is blank, the neighbors are untouched
+    REQUIRE(FLASH_BASE_ADDRESS[10 * 0x100] == 0xFF);
+    REQUIRE(FLASH_BASE_ADDRESS[41 * 0x100 - 1] == 0xFF);
+    REQUIRE(FLASH_BASE_ADDRESS[10 * 0x100 - 1] == 0x00);
+    REQUIRE(FLASH_BASE_ADDRESS[41 * 0x100] == 0x00);
+
+    // A range inside one sector stays page granular
+    IAP_Reset_Busy_Time();
+    REQUIRE(iapEraseRange(70, 75) == IAP_SUCCESS);
+    REQUIRE(IAP_Busy_Time() == 6 * 2500);
+
+    // A sector aligned range is a single sector erase call
+    IAP_Reset_Busy_Time();
+    sectorErases = iap_calls[I_ERASE];
+    REQUIRE(iapEraseRange(96, 127) == IAP_SUCCESS);
+    REQUIRE(iap_calls[I_ERASE] == sectorErases + 1);
+    REQUIRE(IAP_Busy_Time() == 2 * 100000);
+
+    IAP_Reset_Busy_Time();
+}
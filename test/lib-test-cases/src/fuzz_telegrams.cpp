@@ -0,0 +1,216 @@
+/*
+ *  fuzz_telegrams.cpp - Randomized telegram fuzzing with cost tracking
+ *
+ *  Feeds structurally valid but randomized telegrams - random senders,
+ *  group and physical destinations, APCIs, payload lengths - through
+ *  BCU::processTelegram() and tracks the distribution and the worst case
+ *  of the per-telegram processing cost. Malformed traffic must neither
+ *  crash the stack nor hit pathological slow paths that would break the
+ *  ACK timing on the device.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/internal/variables.h"
+#include "sblib/bits.h"
+#include "cycle_count.h"
+#include "perf_budgets.h"
+#include "iap_emu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The number of fuzzed telegrams
+#ifndef FUZZ_TELEGRAM_COUNT
+#define FUZZ_TELEGRAM_COUNT 20000
+#endif
+
+// The number of group addresses in the fuzzed configuration
+#define FUZZ_ADDR_COUNT 16
+
+static unsigned int fuzzRandState;
+
+// A deterministic random number, 0..range-1
+static unsigned int fuzzRand(unsigned int range)
+{
+    fuzzRandState = fuzzRandState * 1103515245 + 12345;
+    return (fuzzRandState >> 16) % range;
+}
+
+/*
+ * Build the same BCU1 configuration as the replay suite: FUZZ_ADDR_COUNT
+ * group addresses with one association and writable 1 byte com-objects.
+ */
+static void fuzzSetupTables(void)
+{
+    byte* tab = addrTable();
+
+    *tab = FUZZ_ADDR_COUNT;
+    storeBE16(tab + 1, 0x1112);                // entry 0: own physical address
+    for (int i = 1; i <= FUZZ_ADDR_COUNT; ++i)
+        storeBE16(tab + 1 + i * 2, 0x0800 + i - 1);
+
+    userEeprom.assocTabPtr = 0x55;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = FUZZ_ADDR_COUNT;
+    for (int i = 0; i < FUZZ_ADDR_COUNT; ++i)
+    {
+        assocTab[1 + i * 2] = i + 1;           // address table index
+        assocTab[2 + i * 2] = i;               // com-object number
+    }
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = FUZZ_ADDR_COUNT;
+    commsTab[1] = 0x30;                        // status flags in userRam
+    for (int i = 0; i < FUZZ_ADDR_COUNT; ++i)
+    {
+        commsTab[2 + i * 3] = i;               // value at userRam offset objno
+        commsTab[3 + i * 3] = COMCONF_WRITE_COMM | COMCONF_READ_COMM;
+        commsTab[4 + i * 3] = BIT_6;
+    }
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+}
+
+/*
+ * Generate one random telegram into bus.telegram. All frames have a valid
+ * structure, the addresses, APCIs and payloads are random. The restart
+ * APCI page is excluded: it is a valid command that resets the device.
+ */
+static void fuzzGenerate(void)
+{
+    byte* tel = bus.telegram;
+    int payload;
+
+    tel[0] = fuzzRand(4) ? 0xbc : 0xb0;        // random priority bits
+    storeBE16(tel + 1, fuzzRand(2) ? 0x1103 : fuzzRand(0x10000));
+
+    switch (fuzzRand(10))
+    {
+    case 0:  // connection control to us: connect, disconnect, ack
+        storeBE16(tel + 3, 0x1112);
+        tel[5] = 0x60;
+        tel[6] = fuzzRand(2) ? 0x80 : 0x81;
+        bus.telegramLen = 8;
+        break;
+
+    case 1:
+    case 2:  // direct data telegram to us, random APCI except restart
+        {
+            int apci;
+            do
+                apci = fuzzRand(0x400);
+            while ((apci >> 6) == 0xe);        // APCI_RESTART_PDU page
+
+            payload = fuzzRand(8);
+            storeBE16(tel + 3, 0x1112);
+            tel[5] = 0x60 | (payload + 1);
+            tel[6] = 0x40 | (fuzzRand(16) << 2) | (apci >> 8);
+            tel[7] = apci;
+            for (int i = 0; i < payload; ++i)
+                tel[8 + i] = fuzzRand(256);
+            bus.telegramLen = 9 + payload;
+        }
+        break;
+
+    case 3:  // a physical destination that is not ours
+        storeBE16(tel + 3, fuzzRand(0x10000));
+        tel[5] = 0x61;
+        tel[6] = 0x00;
+        tel[7] = fuzzRand(256);
+        bus.telegramLen = 9;
+        break;
+
+    default: // group telegram, half the addresses are absent from the table
+        storeBE16(tel + 3, 0x0800 + fuzzRand(2 * FUZZ_ADDR_COUNT));
+        payload = fuzzRand(8);
+        tel[5] = 0xe0 | (payload + 1);
+        tel[6] = 0x00;
+        tel[7] = fuzzRand(2) ? (0x80 | fuzzRand(0x40)) : 0x00;
+        for (int i = 0; i < payload; ++i)
+            tel[8 + i] = fuzzRand(256);
+        bus.telegramLen = 9 + payload;
+        break;
+    }
+}
+
+// Sorting predicate for the percentile calculation
+static int compareCycles(const void* a, const void* b)
+{
+    unsigned long long va = *(const unsigned long long*) a;
+    unsigned long long vb = *(const unsigned long long*) b;
+    return va < vb ? -1 : va > vb;
+}
+
+TEST_CASE("Fuzzed telegram processing cost","[sblib][perf]")
+{
+    static unsigned long long cycles[FUZZ_TELEGRAM_COUNT];
+
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    fuzzSetupTables();
+    fuzzRandState = 0xc0ffee;
+
+    for (int i = 0; i < FUZZ_TELEGRAM_COUNT; ++i)
+    {
+        fuzzGenerate();
+
+        unsigned long long start = cycleCount();
+        bcu.processTelegram();
+        cycles[i] = cycleCount() - start;
+
+        // Complete the queued responses like the ISR would, outside of
+        // the measurement - nothing drains the send queue on the host
+        while (bus.sendCurTelegram)
+            bus.sendNextTelegram();
+    }
+
+    // The fuzzed configuration must still be intact: a normal group write
+    // arrives in its com-object
+    byte* tel = bus.telegram;
+    tel[0] = 0xbc;
+    storeBE16(tel + 1, 0x1103);
+    storeBE16(tel + 3, 0x0800);
+    tel[5] = 0xe1;
+    tel[6] = 0x00;
+    tel[7] = 0x80 | 0x15;
+    bus.telegramLen = 8;
+    fuzzSetupTables();  // the fuzzed memory writes may have hit the tables
+    bcu.processTelegram();
+    REQUIRE(userRamData[0] == 0x15);
+
+    qsort(cycles, FUZZ_TELEGRAM_COUNT, sizeof(cycles[0]), compareCycles);
+
+    unsigned long long median = cycles[FUZZ_TELEGRAM_COUNT / 2];
+    unsigned long long p999 = cycles[FUZZ_TELEGRAM_COUNT / 1000 * 999];
+    unsigned long long worst = cycles[FUZZ_TELEGRAM_COUNT - 1];
+
+    printf("\nFuzzed telegrams, %d frames (host reference cycles):\n",
+        FUZZ_TELEGRAM_COUNT);
+    printf("%-44s %8llu cycles\n", "fuzz median", median);
+    printf("%-44s %8llu cycles\n", "fuzz 99.9th percentile", p999);
+    printf("%-44s %8llu cycles\n", "fuzz worst case", worst);
+
+    perfRecord("fuzz 99.9th percentile", p999);
+
+    // The regression gate uses the 99.9th percentile: the raw maximum is
+    // dominated by host scheduling noise and is only reported
+    REQUIRE(p999 <= BUDGET_FUZZ_P999);
+}
@@ -0,0 +1,97 @@
+/*
+ *  fw_update.cpp - Tests for the firmware update into an inactive bank.
+ *
+ *  The tests stream an image into the emulated flash in telegram-sized
+ *  chunks, including the retransmits that lost acknowledges cause, and
+ *  check the page batching, the CRC verification and the activation
+ *  descriptor.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/eib/fw_update.h"
+#include "sblib/internal/iap.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// The inactive bank: 8K at 16K of the emulated 32K flash
+#define BANK_OFFSET 0x4000
+#define BANK_SIZE   0x2000
+
+TEST_CASE("Firmware update: stream, verify, activate", "[sblib][fw]")
+{
+    IAP_Init_Flash(0xff);
+
+    byte* bank = FLASH_BASE_ADDRESS + BANK_OFFSET;
+    FirmwareUpdate fw(bank, BANK_SIZE);
+    REQUIRE(fw.state() == FW_IDLE);
+
+    // A test image larger than one flash page, with a recognizable pattern
+    byte image[600];
+    for (unsigned int i = 0; i < sizeof(image); ++i)
+        image[i] = i * 13 + (i >> 8);
+    unsigned int crc = FirmwareUpdate::crc32(image, sizeof(image));
+
+    // An image that does not fit the bank is rejected
+    REQUIRE(!fw.begin(BANK_SIZE));
+
+    REQUIRE(fw.begin(sizeof(image)));
+    REQUIRE(fw.state() == FW_RECEIVING);
+
+    // Stream the image in telegram sized chunks; repeat one chunk as a
+    // retransmit after a lost acknowledge would
+    for (unsigned int offset = 0; offset < sizeof(image); offset += 12)
+    {
+        unsigned int chunk = sizeof(image) - offset;
+        if (chunk > 12)
+            chunk = 12;
+
+        REQUIRE(fw.write(offset, image + offset, chunk));
+        if (offset == 240)
+            REQUIRE(fw.write(228, image + 228, 12));  // the retransmit
+    }
+    REQUIRE(fw.received() == sizeof(image));
+
+    // A gap in the stream would fail the update - but not a repeat
+    REQUIRE(fw.finish(crc));
+    REQUIRE(fw.state() == FW_VERIFIED);
+    REQUIRE(memcmp(bank, image, sizeof(image)) == 0);
+
+    // Not activated yet: the boot side must not switch
+    REQUIRE(!FirmwareUpdate::validImage(bank, BANK_SIZE));
+
+    REQUIRE(fw.activate());
+    REQUIRE(FirmwareUpdate::validImage(bank, BANK_SIZE));
+
+    // A corrupted image no longer passes the boot side check
+    bank[100] ^= 0x01;
+    REQUIRE(!FirmwareUpdate::validImage(bank, BANK_SIZE));
+}
+
+TEST_CASE("Firmware update: CRC mismatch fails the update", "[sblib][fw]")
+{
+    IAP_Init_Flash(0xff);
+
+    byte* bank = FLASH_BASE_ADDRESS + BANK_OFFSET;
+    FirmwareUpdate fw(bank, BANK_SIZE);
+
+    byte image[100];
+    memset(image, 0x5a, sizeof(image));
+
+    REQUIRE(fw.begin(sizeof(image)));
+    REQUIRE(fw.write(0, image, sizeof(image)));
+
+    REQUIRE(!fw.finish(FirmwareUpdate::crc32(image, sizeof(image)) ^ 1));
+    REQUIRE(fw.state() == FW_FAILED);
+
+    // A failed update cannot be activated
+    REQUIRE(!fw.activate());
+    REQUIRE(!FirmwareUpdate::validImage(bank, BANK_SIZE));
+}
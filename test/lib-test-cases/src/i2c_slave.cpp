@@ -0,0 +1,90 @@
+/*
+ *  i2c_slave.cpp - Tests for the I2C slave mode.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/i2c.h"
+
+extern "C" void I2C_IRQHandler(void);
+
+static uint8_t rxBuf[8];
+static uint8_t txBuf[8];
+
+static uint8_t received[8];
+static uint16_t receivedLen;
+
+static void slaveReceive(const uint8_t* data, uint16_t length)
+{
+    receivedLen = length;
+    for (uint16_t i = 0; i < length && i < sizeof(received); ++i)
+        received[i] = data[i];
+}
+
+static uint16_t slaveRequest(uint8_t* buffer, uint16_t maxLength)
+{
+    buffer[0] = 0x12;
+    buffer[1] = 0x34;
+    return 2;
+}
+
+// Feed a slave status code to the interrupt handler
+static void slaveEvent(uint32_t status)
+{
+    LPC_I2C->STAT = status;
+    I2C_IRQHandler();
+}
+
+TEST_CASE("I2C slave mode", "[sblib][i2c]")
+{
+    I2C* i2c = I2C::Instance();
+    i2c->I2CInit();
+    i2c->slaveBegin(0xA0, rxBuf, sizeof(rxBuf), txBuf, sizeof(txBuf));
+    i2c->onSlaveReceive(slaveReceive);
+    i2c->onSlaveRequest(slaveRequest);
+
+    REQUIRE(LPC_I2C->ADR0 == 0xA0);
+
+    SECTION("master writes to us")
+    {
+        receivedLen = 0;
+
+        slaveEvent(0x60);             // own SLA+W received
+
+        LPC_I2C->DAT = 0x55;
+        slaveEvent(0x80);             // data byte received
+        LPC_I2C->DAT = 0xAA;
+        slaveEvent(0x80);
+
+        REQUIRE(receivedLen == 0);    // nothing handed over yet
+
+        slaveEvent(0xA0);             // stop condition
+
+        REQUIRE(receivedLen == 2);
+        REQUIRE(received[0] == 0x55);
+        REQUIRE(received[1] == 0xAA);
+    }
+
+    SECTION("master reads from us")
+    {
+        slaveEvent(0xA8);             // own SLA+R received
+        REQUIRE(LPC_I2C->DAT == 0x12);
+
+        slaveEvent(0xB8);             // byte transmitted, ACK received
+        REQUIRE(LPC_I2C->DAT == 0x34);
+
+        slaveEvent(0xB8);             // master reads past the end
+        REQUIRE(LPC_I2C->DAT == 0xFF);
+
+        slaveEvent(0xC0);             // master is done
+    }
+
+    i2c->slaveEnd();
+    REQUIRE(LPC_I2C->ADR0 == 0);
+}
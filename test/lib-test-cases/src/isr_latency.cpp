@@ -0,0 +1,146 @@
+/*
+ *  isr_latency.cpp - Tests for the latency self measurements
+ *
+ *  The tests drive bus.timerInterruptHandler() with capture events whose
+ *  capture register and timer value differ by a known amount - exactly
+ *  what a delayed handler entry looks like on the device - and check the
+ *  RX dispatch latency of telegrams that sit in the receive ring.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "bus_edge_gen.h"
+#include "iap_emu.h"
+
+#ifdef BUS_ISR_LATENCY
+
+// Deliver a capture event that reached the handler late: the capture
+// register holds the event time, the timer has advanced by the latency
+static void lateCapture(unsigned int time, unsigned int latency)
+{
+    LPC_TMR16B1->CR0 = time;
+    LPC_TMR16B1->TC = time + latency;
+    LPC_TMR16B1->IR = 0x10;  // the capture channel interrupt flag
+    bus.timerInterruptHandler();
+}
+
+TEST_CASE("Bus ISR latency measurement","[sblib][bus-isr]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    bus.clearLatencyStatistics();
+
+    const BusIsrLatency& lat = bus.latencyStatistics();
+    REQUIRE(lat.samples == 0);
+    REQUIRE(lat.min == (unsigned int) ~0);
+    REQUIRE(lat.max == 0);
+
+    // A start bit that is serviced 12 usec late
+    lateCapture(30, 12);
+    REQUIRE(lat.samples == 1);
+    REQUIRE(lat.min == 12);
+    REQUIRE(lat.max == 12);
+    REQUIRE(lat.bins[3] == 1);  // 8..15 usec
+
+    // An immediately serviced edge and a very late one
+    lateCapture(134, 0);
+    lateCapture(238, 200);
+    REQUIRE(lat.samples == 3);
+    REQUIRE(lat.min == 0);
+    REQUIRE(lat.max == 200);
+    REQUIRE(lat.bins[0] == 1);  // 0..1 usec
+    REQUIRE(lat.bins[BUS_LATENCY_BINS - 1] == 1);  // the open ended bin
+
+    // Let the aborted reception time out, then a complete telegram:
+    // its edges are delivered without latency
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+    busEdgeTimeout();
+    busEdgeTimeout();
+
+    static const unsigned char tel[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+    unsigned int samplesBefore = lat.samples;
+
+    busEdgeFeedTelegram(tel, sizeof(tel));
+    REQUIRE(bus.telegramReceived());
+    bus.discardReceivedTelegram();
+
+    // Every capture event of the telegram was measured
+    REQUIRE(lat.samples > samplesBefore);
+    REQUIRE(lat.bins[0] == 1 + (lat.samples - samplesBefore));
+
+    bus.clearLatencyStatistics();
+    REQUIRE(lat.samples == 0);
+}
+
+#endif /*BUS_ISR_LATENCY*/
+
+#ifdef BUS_RX_LATENCY
+
+extern volatile unsigned int systemTime;
+
+TEST_CASE("Bus RX dispatch latency measurement","[sblib][bus-rx]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+    busEdgeTimeout();
+    busEdgeTimeout();
+
+    bus.clearRxLatencyStatistics();
+    const BusRxLatency& lat = bus.rxLatencyStatistics();
+    REQUIRE(lat.samples == 0);
+    REQUIRE(lat.min == (unsigned int) ~0);
+    REQUIRE(lat.max == 0);
+
+    // A telegram that sits in the ring for 3 msec before it is dispatched
+    static const unsigned char connect[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+    busEdgeFeedTelegram(connect, sizeof(connect));
+    REQUIRE(bus.telegramReceived());
+
+    systemTime += 3;
+    bcu.processTelegram();
+
+    REQUIRE(lat.samples == 1);
+    REQUIRE(lat.min == 3000);
+    REQUIRE(lat.max == 3000);
+    REQUIRE(lat.bins[BUS_LATENCY_BINS - 1] == 1);  // the open ended bin
+
+    // A telegram that is dispatched immediately
+    static const unsigned char disconnect[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x81 };
+    busEdgeFeedTelegram(disconnect, sizeof(disconnect));
+    bcu.processTelegram();
+
+    REQUIRE(lat.samples == 2);
+    REQUIRE(lat.min == 0);
+    REQUIRE(lat.max == 3000);
+    REQUIRE(lat.bins[0] == 1);
+
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+
+    bus.clearRxLatencyStatistics();
+    REQUIRE(lat.samples == 0);
+    REQUIRE(lat.min == (unsigned int) ~0);
+}
+
+#endif /*BUS_RX_LATENCY*/
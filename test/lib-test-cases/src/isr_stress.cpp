@@ -0,0 +1,139 @@
+/*
+ *  isr_stress.cpp - Bit level stress tests for the bus interrupt handler
+ *
+ *  Drives bus.timerInterruptHandler() with synthesized capture events and
+ *  timeouts from the virtual edge generator: clean frames, jittered edges,
+ *  corrupted bits and a colliding sender. See bus_edge_gen.h.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "bus_edge_gen.h"
+#include "cycle_count.h"
+#include "perf_budgets.h"
+#include "iap_emu.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A connection request to our own physical address 1.1.18
+static const unsigned char connectTel[] =
+    { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+
+static void stressSetup(void)
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+}
+
+TEST_CASE("Bus ISR: clean and jittered frames","[sblib][bus-isr]")
+{
+    stressSetup();
+    unsigned int received = bus.stats.rxTelegrams;
+
+    // A clean frame is received bit-exact
+    busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+    REQUIRE(bus.telegramReceived());
+    REQUIRE(bus.telegramLen == (int) sizeof(connectTel) + 1);
+    REQUIRE(memcmp(bus.telegram, connectTel, sizeof(connectTel)) == 0);
+    REQUIRE(bus.stats.rxTelegrams == received + 1);
+    bus.discardReceivedTelegram();
+
+    // The receiver must tolerate edge jitter well below the bit sampling
+    // window (BIT_WAIT_TIME is 69 usec after the previous bit time)
+    for (int jitter = 5; jitter <= 30; jitter += 5)
+    {
+        busEdgeSetJitter(jitter);
+        busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+        REQUIRE(bus.telegramReceived());
+        REQUIRE(memcmp(bus.telegram, connectTel, sizeof(connectTel)) == 0);
+        bus.discardReceivedTelegram();
+    }
+}
+
+TEST_CASE("Bus ISR: corrupted bits are rejected","[sblib][bus-isr]")
+{
+    stressSetup();
+    busEdgeSetCorruption(1000);  // every byte has one inverted bit
+
+    unsigned int received = bus.stats.rxTelegrams;
+    unsigned int errors = bus.stats.checksumErrors;
+    unsigned int filtered = bus.stats.rxFiltered;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+        if (bus.telegramReceived())
+            bus.discardReceivedTelegram();
+    }
+
+    // No corrupted frame may be delivered as a telegram. A corrupted
+    // destination byte makes the frame look like one for another device,
+    // so the early pre-filter drops part of them before the checksum
+    unsigned int rejected = (bus.stats.checksumErrors - errors)
+        + (bus.stats.rxFiltered - filtered);
+    REQUIRE(bus.stats.rxTelegrams == received);
+    REQUIRE(rejected == 100);
+    REQUIRE(bus.stats.checksumErrors > errors);
+}
+
+TEST_CASE("Bus ISR: colliding sender wins arbitration","[sblib][bus-isr]")
+{
+    stressSetup();
+
+    // Queue our own telegram and advance the sender to SEND_START_BIT
+    static unsigned char ownTel[10] = { 0xbc, 0, 0, 0x11, 0x33, 0x60, 0x81 };
+    bus.sendTelegram(ownTel, 7);
+    REQUIRE(bus.state == Bus::SEND_INIT);
+    busEdgeTimeout();
+    REQUIRE(bus.state == Bus::SEND_START_BIT);
+
+    // The other sender starts first: we back off and receive its frame
+    busEdgeCollide(connectTel, sizeof(connectTel));
+    REQUIRE(bus.telegramReceived());
+    REQUIRE(memcmp(bus.telegram, connectTel, sizeof(connectTel)) == 0);
+    bus.discardReceivedTelegram();
+
+    // Our telegram is still queued for sending
+    REQUIRE(bus.sendCurTelegram == ownTel);
+}
+
+TEST_CASE("Bus ISR: cycle cost at maximum line load","[sblib][perf]")
+{
+    stressSetup();
+
+    // Back-to-back frames, every interrupt's cost summed up
+    unsigned int interrupts = busEdgeInterruptCount();
+    unsigned long long start = cycleCount();
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        busEdgeFeedTelegram(connectTel, sizeof(connectTel));
+        if (bus.telegramReceived())
+            bus.discardReceivedTelegram();
+    }
+
+    unsigned long long perInterrupt = (cycleCount() - start)
+        / (busEdgeInterruptCount() - interrupts);
+
+    perfRecord("bus ISR (receive, per interrupt)", perInterrupt);
+    printf("\n%-44s %8llu cycles\n", "bus ISR (receive, per interrupt)",
+        (unsigned long long) perInterrupt);
+
+    // The regression gate: the ACK timing depends on the ISR staying fast
+    REQUIRE(perInterrupt <= BUDGET_BUS_ISR_RECEIVE);
+}
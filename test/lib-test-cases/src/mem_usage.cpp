@@ -0,0 +1,73 @@
+/*
+ *  mem_usage.cpp - Tests for the stack and pool usage instrumentation
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/mem_usage.h"
+#include "sblib/pool.h"
+
+TEST_CASE("Stack painting and high water mark","[sblib][mem]")
+{
+    unsigned int region[256];
+
+    // The host cannot paint its real stack, so the tests work on an
+    // explicit region like the device functions do on the stack area
+    stackPaintRegion(region, region + 256);
+    REQUIRE(stackUntouchedRegion(region, region + 256) == sizeof(region));
+
+    // The stack grows downwards: usage shows up at the end of the region
+    region[255] = 0xdeadbeef;
+    region[254] = 0;
+    REQUIRE(stackUntouchedRegion(region, region + 256) == 254 * sizeof(unsigned int));
+
+    // Deeper usage moves the mark, shallower usage does not
+    region[100] = 1;
+    REQUIRE(stackUntouchedRegion(region, region + 256) == 100 * sizeof(unsigned int));
+    region[101] = STACK_PAINT_PATTERN;
+    REQUIRE(stackUntouchedRegion(region, region + 256) == 100 * sizeof(unsigned int));
+
+    // A completely used region has no untouched bytes
+    region[0] = 0;
+    REQUIRE(stackUntouchedRegion(region, region + 256) == 0);
+}
+
+TEST_CASE("Object pool usage counters","[sblib][mem]")
+{
+    ObjectPool<int, 3> pool;
+
+    REQUIRE(pool.inUse() == 0);
+    REQUIRE(pool.maxInUse() == 0);
+
+    int* a = pool.create();
+    int* b = pool.create();
+    REQUIRE(pool.inUse() == 2);
+    REQUIRE(pool.maxInUse() == 2);
+
+    pool.destroy(a);
+    REQUIRE(pool.inUse() == 1);
+    REQUIRE(pool.maxInUse() == 2);
+
+    // The high water mark keeps growing with the peak usage
+    a = pool.create();
+    int* c = pool.create();
+    REQUIRE(pool.inUse() == 3);
+    REQUIRE(pool.maxInUse() == 3);
+
+    // Exhaustion does not count as usage
+    REQUIRE(pool.create() == 0);
+    REQUIRE(pool.inUse() == 3);
+    REQUIRE(pool.maxInUse() == 3);
+
+    pool.destroy(a);
+    pool.destroy(b);
+    pool.destroy(c);
+    REQUIRE(pool.inUse() == 0);
+    REQUIRE(pool.maxInUse() == 3);
+}
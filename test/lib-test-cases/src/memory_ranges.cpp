@@ -0,0 +1,121 @@
+/*
+ *  memory_ranges.cpp - Tests for the memory telegram dispatch table.
+ *
+ *  Memory read/write telegrams resolve their address through a sorted
+ *  table of registered address ranges instead of an if-chain. The tests
+ *  register an application range, drive it through memory telegrams and
+ *  check that the built-in ranges and the overlap rejection work.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/user_memory.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// The application range: a 16 byte diagnostic block at 0x4000
+static byte diagBlock[16];
+
+static void readDiagBlock(int address, byte* data, int count)
+{
+    memcpy(data, diagBlock + (address - 0x4000), count);
+}
+
+static void writeDiagBlock(int address, byte* data, int count)
+{
+    memcpy(diagBlock + (address - 0x4000), data, count);
+}
+
+// Inject a telegram into the receive buffer and let the BCU process it
+static void inject(const byte* tel, int len)
+{
+    memcpy(bus.telegram, tel, len);
+    bus.telegramLen = len;
+    bcu.processTelegram();
+}
+
+// Drain the send queue, keeping a copy of the last drained frame
+static void drainTx(byte* lastFrame)
+{
+    while (bus.sendCurTelegram)
+    {
+        const byte* tel = (const byte*) bus.sendCurTelegram;
+        memcpy(lastFrame, tel, telegramSize(tel));
+        bus.sendNextTelegram();
+    }
+}
+
+TEST_CASE("Memory telegrams: range dispatch table", "[sblib][memrange]")
+{
+    byte frame[24];
+
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    drainTx(frame);
+
+    // A range that overlaps a built-in one is rejected
+    REQUIRE(!bcu.addMemoryRange(USER_EEPROM_START + 8, USER_EEPROM_START + 15,
+        readDiagBlock, writeDiagBlock));
+    REQUIRE(!bcu.addMemoryRange(USER_RAM_END - 1, USER_EEPROM_START,
+        readDiagBlock, writeDiagBlock));
+
+    REQUIRE(bcu.addMemoryRange(0x4000, 0x400f, readDiagBlock, writeDiagBlock));
+
+    // Open a direct connection from 1.1.3
+    static const byte connect[] = { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+    inject(connect, sizeof(connect));
+    drainTx(frame);
+
+    // A memory write telegram into the registered range, sequence 0
+    static const byte diagWrite[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x65, 0x42, 0x82, 0x40, 0x04, 0xca, 0xfe };
+    inject(diagWrite, sizeof(diagWrite));
+    drainTx(frame);
+    REQUIRE(diagBlock[4] == 0xca);
+    REQUIRE(diagBlock[5] == 0xfe);
+
+    // A memory read telegram of the registered range, sequence 1
+    diagBlock[6] = 0x77;
+    static const byte diagRead[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x63, 0x46, 0x03, 0x40, 0x04 };
+    inject(diagRead, sizeof(diagRead));
+    drainTx(frame);
+    REQUIRE((frame[7] & 0xf0) == 0x40);  // a memory response
+    REQUIRE(frame[10] == 0xca);
+    REQUIRE(frame[11] == 0xfe);
+    REQUIRE(frame[12] == 0x77);
+
+    // The built-in EEPROM range still answers, sequence 2
+    userEeprom[0x10a] = 0x5a;
+    static const byte eepromRead[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x63, 0x4a, 0x01, 0x01, 0x0a };
+    inject(eepromRead, sizeof(eepromRead));
+    drainTx(frame);
+    REQUIRE(frame[10] == 0x5a);
+
+    // A read of an unregistered address answers, but touches no range
+    diagBlock[0] = 0x11;
+    static const byte voidRead[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x63, 0x4e, 0x01, 0x50, 0x00 };
+    inject(voidRead, sizeof(voidRead));
+    drainTx(frame);
+    REQUIRE((frame[7] & 0xf0) == 0x40);
+    REQUIRE(diagBlock[0] == 0x11);
+
+    // Close the connection
+    static const byte disconnect[] = { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x81 };
+    inject(disconnect, sizeof(disconnect));
+    drainTx(frame);
+}
@@ -0,0 +1,227 @@
+/*
+ *  perf_benchmarks.cpp - Cycle cost measurements for the library hot paths
+ *
+ *  The costs are measured with the host cycle counter (see cycle_count.h),
+ *  so the absolute numbers depend on the machine. They are meant for
+ *  comparing before/after an optimization and for the regression budgets,
+ *  not as Cortex-M0 cycle counts.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/eib/bus.h"
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/datapoint_types.h"
+#include "sblib/internal/functions.h"
+#include "sblib/internal/variables.h"
+#include "sblib/arrays.h"
+#include "sblib/crc.h"
+#include "sblib/math.h"
+#include "sblib/utils.h"
+#include "cycle_count.h"
+#include "perf_budgets.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// All benchmark work feeds this sink so the optimizer cannot remove it
+static volatile unsigned int sink;
+
+// A benchmark body: runs the measured operation count times
+typedef void (BenchFunction)(int count);
+
+// The number of measurement samples, the minimum of all samples is taken
+#define BENCH_SAMPLES 30
+
+/*
+ * Run a benchmark body, record the per-operation cost and check it
+ * against the budget from perf_budgets.h.
+ */
+static unsigned long long benchmark(const char* name, BenchFunction* fn, int count,
+    unsigned long long budget)
+{
+    unsigned long long best = ~0ull;
+
+    fn(count);  // warm up caches and branch predictors
+
+    for (int sample = 0; sample < BENCH_SAMPLES; ++sample)
+    {
+        unsigned long long start = cycleCount();
+        fn(count);
+        unsigned long long delta = cycleCount() - start;
+        if (delta < best)
+            best = delta;
+    }
+
+    best -= cycleOverhead();
+
+    unsigned long long perOp = best / count;
+    perfRecord(name, perOp);
+    printf("%-44s %8llu cycles (budget %llu)\n", name, perOp, budget);
+
+    INFO(name);
+    CHECK(perOp <= budget);
+    return perOp;
+}
+
+static void benchDptToFloat(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += dptToFloat(i * 37 - 100000);
+}
+
+static void benchDptFromFloat(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += dptFromFloat(i & 0x7ffe);
+}
+
+static byte benchData[256];
+
+static void benchCrc32(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += crc32(0xffffffff, benchData, sizeof(benchData));
+}
+
+static void benchCrc16(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += crc16Ccitt(0xffff, benchData, sizeof(benchData));
+}
+
+static byte benchDest[256];
+
+static void benchCopyTelegram(int count)
+{
+    for (int i = 0; i < count; ++i)
+        copyData(benchDest, benchData, 23);
+}
+
+static void benchReverseCopy(int count)
+{
+    for (int i = 0; i < count; ++i)
+        reverseCopy(benchDest, benchData, 23);
+}
+
+static void benchIndexOf(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += indexOf((byte) 0xfe, benchData, sizeof(benchData));
+}
+
+static void benchIndexOfAddr(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += indexOfAddr(0x0800 + (i & 31));
+}
+
+static void benchFixMul(int count)
+{
+    fixed a = FIX(1.5), b = FIX(2.25);
+    for (int i = 0; i < count; ++i)
+        sink += fixMul(a + i, b);
+}
+
+static void benchFixSin(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += fixSin(FIX_FROM_INT(i % 360));
+}
+
+static void benchFixSqrt(int count)
+{
+    for (int i = 0; i < count; ++i)
+        sink += fixSqrt(FIX_FROM_INT(i & 0xffff));
+}
+
+static void benchObjectWrite(int count)
+{
+    for (int i = 0; i < count; ++i)
+        objectWrite(i & 1, (unsigned int) (i & 0x3f));
+}
+
+static void benchBusInterruptIdle(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        LPC_TMR16B1->IR = 0;
+        bus.timerInterruptHandler();
+    }
+}
+
+/*
+ * Fill the address table with 32 group addresses and rebuild the indexes,
+ * so indexOfAddr() is measured on its binary search path.
+ */
+static void setupAddrTable(void)
+{
+    byte* tab = addrTable();
+
+    *tab = 32;
+    for (int i = 1; i <= 32; ++i)
+    {
+        tab[1 + i * 2] = 0x08;       // group addresses 0x0800..0x081f,
+        tab[2 + i * 2] = i - 1;      // entry 1 is the own address
+    }
+
+    // The 32 entry address table ends at offset 0x59, place the other
+    // tables behind it
+    userEeprom.assocTabPtr = 0x60;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = 0;
+
+    // Two 1 byte com-objects for the objectWrite() measurement
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 2;
+    commsTab[1] = 0x30;                        // status flags in userRam
+    for (int i = 0; i < 2; ++i)
+    {
+        commsTab[2 + i * 3] = i;               // value at userRam offset objno
+        commsTab[3 + i * 3] = COMCONF_TRANS_COMM;
+        commsTab[4 + i * 3] = BIT_6;
+    }
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+}
+
+TEST_CASE("Cycle costs of the library hot paths","[sblib][perf]")
+{
+    for (int i = 0; i < (int) sizeof(benchData); ++i)
+        benchData[i] = i;
+    benchData[200] = 0xfe;  // the byte that indexOf() searches
+    setupAddrTable();
+
+    printf("\nHot path cycle costs (host reference cycles):\n");
+
+    benchmark("dptToFloat", benchDptToFloat, 10000, BUDGET_DPT_TO_FLOAT);
+    benchmark("dptFromFloat", benchDptFromFloat, 10000, BUDGET_DPT_FROM_FLOAT);
+    benchmark("crc32 (256 bytes)", benchCrc32, 2000, BUDGET_CRC32);
+    benchmark("crc16Ccitt (256 bytes)", benchCrc16, 2000, BUDGET_CRC16);
+    benchmark("copyData (telegram, 23 bytes)", benchCopyTelegram, 10000, BUDGET_COPY_DATA);
+    benchmark("reverseCopy (telegram, 23 bytes)", benchReverseCopy, 10000, BUDGET_REVERSE_COPY);
+    benchmark("indexOf (256 bytes)", benchIndexOf, 10000, BUDGET_INDEX_OF);
+    benchmark("indexOfAddr (32 entries)", benchIndexOfAddr, 10000, BUDGET_INDEX_OF_ADDR);
+    benchmark("fixMul", benchFixMul, 10000, BUDGET_FIX_MUL);
+    benchmark("fixSin", benchFixSin, 10000, BUDGET_FIX_SIN);
+    benchmark("fixSqrt", benchFixSqrt, 10000, BUDGET_FIX_SQRT);
+    benchmark("objectWrite (1 byte object)", benchObjectWrite, 10000, BUDGET_OBJECT_WRITE);
+    benchmark("bus.timerInterruptHandler (idle)", benchBusInterruptIdle, 10000, BUDGET_BUS_ISR_IDLE);
+
+    // The measured values must be sane: the binary searched address lookup
+    // and the table driven CRC are the optimizations most easily lost
+    REQUIRE(indexOfAddr(0x081f) == 32);
+    REQUIRE(indexOfAddr(0x0900) == -1);
+    REQUIRE(crc16Ccitt(0xffff, (const byte*) "123456789", 9) == 0x29b1);
+}
@@ -0,0 +1,66 @@
+/*
+ *  perf_budgets.h - Cycle budgets for the performance regression gate
+ *
+ *  Every measurement that the performance tests record is checked against
+ *  the budget from this table at the point where it is taken, so a library
+ *  change that pushes a hot path over its limit fails the test run. The
+ *  budgets are host reference cycles (see cycle_count.h) with ample
+ *  headroom over the currently measured values - they catch an algorithmic
+ *  regression like a lost binary search, not a few cycles of noise.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef PERF_BUDGETS_H_
+#define PERF_BUDGETS_H_
+
+// Scale factor for all budgets, raise it on a slow CI machine
+#ifndef PERF_BUDGET_SCALE
+#define PERF_BUDGET_SCALE 1
+#endif
+
+#define PERF_BUDGET(limit) ((unsigned long long) (limit) * PERF_BUDGET_SCALE)
+
+// Datapoint type conversions
+#define BUDGET_DPT_TO_FLOAT        PERF_BUDGET(100)
+#define BUDGET_DPT_FROM_FLOAT      PERF_BUDGET(100)
+
+// Checksums, per 256 byte block
+#define BUDGET_CRC32               PERF_BUDGET(8000)
+#define BUDGET_CRC16               PERF_BUDGET(8000)
+
+// Byte array helpers, per 23 byte telegram
+#define BUDGET_COPY_DATA           PERF_BUDGET(150)
+#define BUDGET_REVERSE_COPY        PERF_BUDGET(300)
+#define BUDGET_INDEX_OF            PERF_BUDGET(800)
+
+// The group address lookup, 32 table entries
+#define BUDGET_INDEX_OF_ADDR       PERF_BUDGET(200)
+
+// Fixed point math
+#define BUDGET_FIX_MUL             PERF_BUDGET(100)
+#define BUDGET_FIX_SIN             PERF_BUDGET(200)
+#define BUDGET_FIX_SQRT            PERF_BUDGET(400)
+
+// Writing a communication object value, including the flags update
+#define BUDGET_OBJECT_WRITE        PERF_BUDGET(300)
+
+// One pass of the bus timer interrupt handler without pending events
+#define BUDGET_BUS_ISR_IDLE        PERF_BUDGET(100)
+
+// One receive interrupt of the bus ISR under full line load
+#define BUDGET_BUS_ISR_RECEIVE     PERF_BUDGET(300)
+
+// One group write telegram through BCU::processTelegram(), worst case
+// table size of the replay suite
+#define BUDGET_GROUP_WRITE         PERF_BUDGET(1000)
+
+// The 99.9th percentile of randomly fuzzed telegrams through
+// BCU::processTelegram(), including the slow direct telegram paths
+#define BUDGET_FUZZ_P999           PERF_BUDGET(20000)
+
+#endif /* PERF_BUDGETS_H_ */
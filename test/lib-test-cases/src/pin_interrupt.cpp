@@ -0,0 +1,44 @@
+/*
+ *  pin_interrupt.cpp - Tests for the direct-dispatch pin interrupts.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/digital_pin.h"
+#include "sblib/io_pin_names.h"
+
+static int pulses;
+
+static void countPulse() { ++pulses; }
+
+// The port 1 vector as an application would instantiate it
+PIN_INTERRUPT_HANDLER(testPioInt1Handler, 1)
+
+TEST_CASE("Direct-dispatch pin interrupts", "[sblib][digital-pin]")
+{
+    pulses = 0;
+
+    attachPinInterrupt(PIO1_4, countPulse, INTERRUPT_EDGE_RISING);
+
+    unsigned short mask = digitalPinToBitMask(PIO1_4);
+
+    // Rising edge trigger: edge sensitive, single edge, rising
+    REQUIRE((gpioPorts[1]->IS & mask) == 0);
+    REQUIRE((gpioPorts[1]->IBE & mask) == 0);
+    REQUIRE((gpioPorts[1]->IEV & mask) == mask);
+    REQUIRE((gpioPorts[1]->IE & mask) == mask);
+
+    // The vector dispatches straight to the handler
+    testPioInt1Handler();
+    testPioInt1Handler();
+    REQUIRE(pulses == 2);
+
+    detachPinInterrupt(PIO1_4);
+    REQUIRE((gpioPorts[1]->IE & mask) == 0);
+}
@@ -0,0 +1,117 @@
+/*
+ *  power_fail.cpp - Tests for the power fail fast state save.
+ *
+ *  The tests register state regions, trigger the save as the brown-out
+ *  interrupt would and check the flash traffic: one prepare and one
+ *  program call, no verify pass - the save must fit into the decaying
+ *  supply window.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/power_fail.h"
+#include "sblib/internal/iap.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// The reserved page: the last page of an emulated 28K flash
+#define SAVE_PAGE_OFFSET 0x6f00
+
+// The application state that must survive a power fail
+static short positions[4];
+static byte runState;
+
+TEST_CASE("Power fail: fast save and restore", "[sblib][powerfail]")
+{
+    int iap_save[6];
+
+    IAP_Init_Flash(0xFF);
+    iapFlashSize();
+
+    byte* page = FLASH_BASE_ADDRESS + SAVE_PAGE_OFFSET;
+
+    powerFailBegin(page);
+    REQUIRE(powerFailRegister(positions, sizeof(positions)));
+    REQUIRE(powerFailRegister(&runState, sizeof(runState)));
+
+    // A blank page holds no record, and arming it needs no erase
+    REQUIRE(!powerFailSaved());
+    memcpy(iap_save, iap_calls, sizeof(iap_calls));
+    REQUIRE(powerFailArm());
+    REQUIRE(iap_calls[I_ERASE_PAGE] == iap_save[I_ERASE_PAGE]);
+
+    positions[0] = 0x1234;
+    positions[3] = -7;
+    runState = 0x42;
+
+    // The save that the brown-out interrupt triggers: one prepare, one
+    // program, no verify pass
+    memcpy(iap_save, iap_calls, sizeof(iap_calls));
+    powerFailSave();
+    REQUIRE(iap_calls[I_PREPARE]   == iap_save[I_PREPARE] + 1);
+    REQUIRE(iap_calls[I_RAM2FLASH] == iap_save[I_RAM2FLASH] + 1);
+    REQUIRE(iap_calls[I_COMPARE]   == iap_save[I_COMPARE]);
+
+    // A second trigger must not program the once-erased page again
+    memcpy(iap_save, iap_calls, sizeof(iap_calls));
+    powerFailSave();
+    REQUIRE(iap_calls[I_RAM2FLASH] == iap_save[I_RAM2FLASH]);
+
+    // After the reboot: register the same regions, then restore
+    memset(positions, 0, sizeof(positions));
+    runState = 0;
+
+    powerFailBegin(page);
+    REQUIRE(powerFailRegister(positions, sizeof(positions)));
+    REQUIRE(powerFailRegister(&runState, sizeof(runState)));
+
+    REQUIRE(powerFailSaved());
+    REQUIRE(powerFailRestore());
+    REQUIRE(positions[0] == 0x1234);
+    REQUIRE(positions[3] == -7);
+    REQUIRE(runState == 0x42);
+
+    // Re-arming erases the used page, ready for the next power fail
+    memcpy(iap_save, iap_calls, sizeof(iap_calls));
+    REQUIRE(powerFailArm());
+    REQUIRE(iap_calls[I_ERASE_PAGE] == iap_save[I_ERASE_PAGE] + 1);
+    REQUIRE(!powerFailSaved());
+
+    powerFailDisarm();
+}
+
+TEST_CASE("Power fail: a corrupted record is rejected", "[sblib][powerfail]")
+{
+    IAP_Init_Flash(0xFF);
+    iapFlashSize();
+
+    byte* page = FLASH_BASE_ADDRESS + SAVE_PAGE_OFFSET;
+
+    powerFailBegin(page);
+    REQUIRE(powerFailRegister(positions, sizeof(positions)));
+
+    positions[0] = 0x55aa;
+    REQUIRE(powerFailArm());
+    powerFailSave();
+    REQUIRE(powerFailSaved());
+
+    // A flipped bit in the record fails the checksum
+    page[10] ^= 0x01;
+    REQUIRE(!powerFailSaved());
+    REQUIRE(!powerFailRestore());
+
+    // A record of a different region layout is rejected as well
+    page[10] ^= 0x01;
+    REQUIRE(powerFailSaved());
+    REQUIRE(powerFailRegister(&runState, sizeof(runState)));
+    REQUIRE(!powerFailSaved());
+
+    powerFailDisarm();
+}
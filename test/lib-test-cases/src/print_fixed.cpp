@@ -0,0 +1,70 @@
+/*
+ *  print_fixed.cpp - Tests for the fixed point decimal formatting.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/print.h"
+
+#include <string.h>
+
+/**
+ * A Print sink that captures the written bytes as a string.
+ */
+class StringSink: public Print
+{
+public:
+    StringSink() : count(0) { buffer[0] = 0; }
+
+    virtual int write(byte ch)
+    {
+        if (count + 1 < sizeof(buffer))
+        {
+            buffer[count++] = ch;
+            buffer[count] = 0;
+        }
+        return 1;
+    }
+
+    void clear() { count = 0; buffer[0] = 0; }
+
+    char buffer[64];
+    unsigned int count;
+};
+
+TEST_CASE("Fixed point decimal formatting", "[sblib][print]")
+{
+    StringSink out;
+
+    // A DPT9 temperature in 1/100 degrees
+    out.printFixed(2150, 2);
+    REQUIRE(strcmp(out.buffer, "21.50") == 0);
+
+    out.clear();
+    out.printFixed(-125, 2);
+    REQUIRE(strcmp(out.buffer, "-1.25") == 0);
+
+    // The integer part is zero padded to one digit
+    out.clear();
+    out.printFixed(7, 2);
+    REQUIRE(strcmp(out.buffer, "0.07") == 0);
+
+    out.clear();
+    out.printFixed(0, 2);
+    REQUIRE(strcmp(out.buffer, "0.00") == 0);
+
+    // No decimals prints the plain integer
+    out.clear();
+    out.printFixed(42, 0);
+    REQUIRE(strcmp(out.buffer, "42") == 0);
+
+    out.clear();
+    out.printlnFixed(305, 1);
+    REQUIRE(strcmp(out.buffer, "30.5\r\n") == 0);
+}
@@ -0,0 +1,110 @@
+/*
+ *  profiler.cpp - Tests for the main loop section profiler.
+ *
+ *  The host tests have no running microsecond timer: the clock is
+ *  derived from the system time that the tests advance themselves, so a
+ *  section duration is set in whole milliseconds.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/profiler.h"
+
+extern volatile unsigned int systemTime;
+
+static int overrunSection = -1;
+static unsigned int overrunUsec;
+
+static void recordOverrun(int section, unsigned int usec)
+{
+    overrunSection = section;
+    overrunUsec = usec;
+}
+
+TEST_CASE("Profiler section statistics", "[sblib][profiler]")
+{
+    systemTime = 1000;
+    profileClear();
+
+    const ProfileStats& st = profileStats(PROF_APP1);
+    REQUIRE(st.count == 0);
+    REQUIRE(st.average() == 0);
+
+    // A pass of 3 ms
+    PROFILE_BEGIN(PROF_APP1);
+    systemTime += 3;
+    PROFILE_END(PROF_APP1);
+
+    REQUIRE(st.count == 1);
+    REQUIRE(st.min == 3000);
+    REQUIRE(st.max == 3000);
+    REQUIRE(st.average() == 3000);
+
+    // A shorter and a longer pass
+    PROFILE_BEGIN(PROF_APP1);
+    systemTime += 1;
+    PROFILE_END(PROF_APP1);
+
+    PROFILE_BEGIN(PROF_APP1);
+    systemTime += 5;
+    PROFILE_END(PROF_APP1);
+
+    REQUIRE(st.count == 3);
+    REQUIRE(st.min == 1000);
+    REQUIRE(st.max == 5000);
+    REQUIRE(st.average() == 3000);
+
+    // Sections accumulate independently
+    REQUIRE(profileStats(PROF_APP2).count == 0);
+
+    profileClear();
+    REQUIRE(st.count == 0);
+    REQUIRE(st.max == 0);
+}
+
+TEST_CASE("Profiler overrun detection", "[sblib][profiler]")
+{
+    systemTime = 2000;
+    profileClear();
+    overrunSection = -1;
+
+    profileBudget(PROF_APP2, 2500);
+    profileOverrunHandler(recordOverrun);
+    REQUIRE(profileLastOverrun() == -1);
+
+    // A pass within the budget
+    PROFILE_BEGIN(PROF_APP2);
+    systemTime += 2;
+    PROFILE_END(PROF_APP2);
+
+    REQUIRE(profileStats(PROF_APP2).overruns == 0);
+    REQUIRE(profileLastOverrun() == -1);
+    REQUIRE(overrunSection == -1);
+
+    // A pass over the budget is recorded and reported
+    PROFILE_BEGIN(PROF_APP2);
+    systemTime += 4;
+    PROFILE_END(PROF_APP2);
+
+    REQUIRE(profileStats(PROF_APP2).overruns == 1);
+    REQUIRE(profileLastOverrun() == PROF_APP2);
+    REQUIRE(overrunSection == PROF_APP2);
+    REQUIRE(overrunUsec == 4000);
+
+    // A disabled budget stops the detection
+    profileBudget(PROF_APP2, 0);
+    PROFILE_BEGIN(PROF_APP2);
+    systemTime += 10;
+    PROFILE_END(PROF_APP2);
+    REQUIRE(profileStats(PROF_APP2).overruns == 1);
+
+    profileOverrunHandler(0);
+    profileClear();
+    REQUIRE(profileLastOverrun() == -1);
+}
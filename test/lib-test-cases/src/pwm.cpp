@@ -0,0 +1,71 @@
+/*
+ *  pwm.cpp - Tests for the multi channel buffered PWM engine.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/pwm.h"
+#include "sblib/ioports.h"
+
+TEST_CASE("Buffered PWM duty cycle updates", "[sblib][pwm]")
+{
+    Pwm pwm(timer16_0);
+
+    pwm.begin(1000);
+    pwm.addChannel(MAT0, PIO0_8);
+
+    // The period channel resets the timer at the period boundary
+    REQUIRE(LPC_TMR16B0->MR3 == 999);
+
+    // A new channel starts with duty cycle 0: the match value is never
+    // reached, the output stays low
+    REQUIRE(LPC_TMR16B0->MR0 == 1000);
+
+    // A duty cycle update is buffered, not written to the match register
+    pwm.dutyCycle(MAT0, 250);
+    REQUIRE(LPC_TMR16B0->MR0 == 1000);
+
+    // The period interrupt latches it: high for the last 250 ticks
+    pwm.interruptHandler();
+    REQUIRE(LPC_TMR16B0->MR0 == 750);
+
+    // Full duty cycle gives match value 0: permanently high
+    pwm.dutyCycle(MAT0, 1000);
+    pwm.interruptHandler();
+    REQUIRE(LPC_TMR16B0->MR0 == 0);
+
+    pwm.end();
+}
+
+TEST_CASE("PWM dimming curve", "[sblib][pwm]")
+{
+    Pwm pwm(timer16_0);
+
+    pwm.begin(1000);
+    pwm.addChannel(MAT1, PIO0_9);
+
+    // The endpoints map to fully off and fully on
+    pwm.dim(MAT1, 0);
+    pwm.interruptHandler();
+    REQUIRE(LPC_TMR16B0->MR1 == 1000);
+
+    pwm.dim(MAT1, 255);
+    pwm.interruptHandler();
+    REQUIRE(LPC_TMR16B0->MR1 == 0);
+
+    // Half brightness is well below half duty cycle on the logarithmic
+    // curve, but clearly above zero
+    pwm.dim(MAT1, 128);
+    pwm.interruptHandler();
+    unsigned int ticks = 1000 - LPC_TMR16B0->MR1;
+    REQUIRE(ticks > 100);
+    REQUIRE(ticks < 300);
+
+    pwm.end();
+}
@@ -0,0 +1,108 @@
+/*
+ *  response_cache.cpp - Tests for the transport layer response cache.
+ *
+ *  When our T_ACK or a response telegram is lost, the remote side repeats
+ *  the request with the already-answered sequence number. The BCU keeps a
+ *  copy of the last response telegram and answers such a retransmit from
+ *  the cache instead of processing the request a second time.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/user_memory.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// Inject a telegram into the receive buffer and let the BCU process it
+static void inject(const byte* tel, int len)
+{
+    memcpy(bus.telegram, tel, len);
+    bus.telegramLen = len;
+    bcu.processTelegram();
+}
+
+/*
+ * Drain the send queue, copying each queued frame into frames[].
+ *
+ * @return The number of drained frames.
+ */
+static int drainTx(byte frames[][24])
+{
+    int count = 0;
+    while (bus.sendCurTelegram)
+    {
+        const byte* tel = (const byte*) bus.sendCurTelegram;
+        memcpy(frames[count++], tel, telegramSize(tel));
+        bus.sendNextTelegram();
+    }
+    return count;
+}
+
+TEST_CASE("Transport layer: retransmits are served from the response cache", "[sblib][tl]")
+{
+    byte frames[8][24];
+
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    drainTx(frames);
+
+    // Open a direct connection from 1.1.3
+    static const byte connect[] = { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+    inject(connect, sizeof(connect));
+    drainTx(frames);
+
+    userEeprom[0x104] = 0x12;
+    userEeprom[0x105] = 0x34;
+
+    // A numbered memory read request, sequence 0: 2 bytes at 0x0104
+    static const byte memRead[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x63, 0x42, 0x02, 0x01, 0x04 };
+    inject(memRead, sizeof(memRead));
+
+    // The request is answered with a T_ACK and the memory response
+    REQUIRE(drainTx(frames) == 2);
+    byte response[24];
+    memcpy(response, frames[1], telegramSize(frames[1]));
+    REQUIRE((response[7] & 0xf0) == 0x40);  // a memory response
+    REQUIRE(response[10] == 0x12);
+    REQUIRE(response[11] == 0x34);
+
+    // Change the memory behind the response: a retransmit of the request
+    // must repeat the cached frame, not read the memory again
+    userEeprom[0x104] = 0xee;
+
+    inject(memRead, sizeof(memRead));
+    REQUIRE(drainTx(frames) == 2);
+    REQUIRE(memcmp(frames[1], response, telegramSize(response)) == 0);
+
+    // A numbered memory write, sequence 1: it produces no response and
+    // invalidates the cache
+    static const byte memWrite[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x65, 0x46, 0x82, 0x01, 0x08, 0xaa, 0x55 };
+    inject(memWrite, sizeof(memWrite));
+    REQUIRE(drainTx(frames) == 1);
+    REQUIRE(userEeprom[0x108] == 0xaa);
+
+    // A retransmit of the write is acknowledged again, but no stale
+    // response frame may be replayed for it
+    inject(memWrite, sizeof(memWrite));
+    REQUIRE(drainTx(frames) == 1);
+    REQUIRE((frames[0][6] & 0xc3) == 0xc2);  // the T_ACK
+
+    // Close the connection
+    static const byte disconnect[] = { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x81 };
+    inject(disconnect, sizeof(disconnect));
+    drainTx(frames);
+}
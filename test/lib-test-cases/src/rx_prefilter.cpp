@@ -0,0 +1,90 @@
+/*
+ *  rx_prefilter.cpp - Tests for the early destination pre-filter.
+ *
+ *  The tests feed telegrams through the bus interrupt handler and check
+ *  that frames for other devices are dropped as soon as the destination
+ *  address word is in, while our own unicasts and broadcasts still pass.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#define protected public
+#include "sblib/eib/bus.h"
+#undef protected
+#undef private
+#include "sblib/eib/bcu.h"
+#include "bus_edge_gen.h"
+#include "iap_emu.h"
+
+TEST_CASE("Early destination pre-filter", "[sblib][prefilter]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+
+    busEdgeSeed(4711);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+    busEdgeTimeout();
+    busEdgeTimeout();
+
+    bus.clearStatistics();
+    const BusStats& stats = bus.statistics();
+
+    // A unicast for another device is dropped without an ACK
+    static const unsigned char otherUnicast[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x13, 0x60, 0x80 };
+    busEdgeFeedTelegram(otherUnicast, sizeof(otherUnicast));
+
+    REQUIRE(!bus.telegramReceived());
+    REQUIRE(stats.rxFiltered == 1);
+    REQUIRE(stats.rxTelegrams == 0);
+    REQUIRE(stats.checksumErrors == 0);
+    REQUIRE(bus.sendAck == 0);
+
+    // A group telegram whose address is not in the filter is dropped too
+    static const unsigned char otherGroup[] =
+        { 0xbc, 0x11, 0x03, 0x08, 0x01, 0xe1, 0x00, 0x81 };
+    busEdgeFeedTelegram(otherGroup, sizeof(otherGroup));
+
+    REQUIRE(!bus.telegramReceived());
+    REQUIRE(stats.rxFiltered == 2);
+    REQUIRE(stats.rxTelegrams == 0);
+
+    // A unicast for us passes the filter
+    static const unsigned char ourUnicast[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x80 };
+    busEdgeFeedTelegram(ourUnicast, sizeof(ourUnicast));
+
+    REQUIRE(bus.telegramReceived());
+    REQUIRE(stats.rxFiltered == 2);
+    REQUIRE(stats.rxTelegrams == 1);
+    bcu.processTelegram();  // handle the T_CONNECT
+
+    // A broadcast passes the filter as well
+    static const unsigned char broadcast[] =
+        { 0xb0, 0x11, 0x03, 0x00, 0x00, 0xe1, 0x01, 0x00 };
+    busEdgeFeedTelegram(broadcast, sizeof(broadcast));
+
+    REQUIRE(bus.telegramReceived());
+    REQUIRE(stats.rxFiltered == 2);
+    REQUIRE(stats.rxTelegrams == 2);
+    bus.discardReceivedTelegram();
+
+    // Drop the connection again and drain what the BCU queued
+    static const unsigned char disconnect[] =
+        { 0xb0, 0x11, 0x03, 0x11, 0x12, 0x60, 0x81 };
+    busEdgeFeedTelegram(disconnect, sizeof(disconnect));
+    REQUIRE(bus.telegramReceived());
+    bcu.processTelegram();
+
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+}
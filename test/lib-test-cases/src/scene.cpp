@@ -0,0 +1,151 @@
+/*
+ *  scene.cpp - Tests for the ETS parameterized scene engine.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/scene.h"
+#include "sblib/eib/user_memory.h"
+#include "sblib/internal/functions.h"
+#include "iap_emu.h"
+
+extern byte userEepromModified;
+
+#define SCENE_TABLE 0x1b0
+
+/*
+ * A config table with 5 one byte objects: 0..3 are the scene targets,
+ * object 4 is the DPT18 scene control object.
+ */
+static void setupTables(void)
+{
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 5;
+    commsTab[1] = 0x30;          // status flags in userRam
+    for (int i = 0; i < 5; ++i)
+    {
+        commsTab[2 + 3 * i] = 0x60 + i;
+        commsTab[3 + 3 * i] = COMCONF_TRANS_COMM;
+        commsTab[4 + 3 * i] = BYTE_1;
+    }
+
+    updateObjectCache();
+
+    byte* flagsTab = objectFlagsTable();
+    for (int i = 0; i < 3; ++i)
+        flagsTab[i] = 0;
+    clearTransmitFlags();
+}
+
+/*
+ * A scene table with interleaved entries, so the recall index has to
+ * group them: scene 5 spreads over 4 entries with an unused entry and
+ * the scenes 1 and 63 in between.
+ */
+static void setupSceneTable(void)
+{
+    static const byte table[] =
+    {
+        7,                       // the number of entries
+        5,  0, 10,               // scene 5: object 0 = 10
+        1,  0, 99,               // scene 1: object 0 = 99
+        5,  1, 20,               // scene 5: object 1 = 20
+        0xff, 0, 0,              // an unused entry
+        63, 2, 7,                // scene 63: object 2 = 7
+        5,  2, 30,               // scene 5: object 2 = 30
+        5,  3, 40                // scene 5: object 3 = 40
+    };
+
+    for (unsigned int i = 0; i < sizeof(table); ++i)
+        userEeprom[SCENE_TABLE + i] = table[i];
+}
+
+TEST_CASE("Scene engine: recall fans out through the index", "[sblib][scene]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    setupTables();
+    setupSceneTable();
+
+    SceneEngine scenes;
+    scenes.begin(SCENE_TABLE);
+    REQUIRE(scenes.entryCount() == 6);   // the unused entry is skipped
+
+    // Recalling scene 5 writes all 4 of its objects, none of the others
+    REQUIRE(scenes.recall(5) == 4);
+    REQUIRE(objectRead(0) == 10);
+    REQUIRE(objectRead(1) == 20);
+    REQUIRE(objectRead(2) == 30);
+    REQUIRE(objectRead(3) == 40);
+    REQUIRE(objectTransmitPending());
+
+    // The single entry scenes play back independently
+    REQUIRE(scenes.recall(1) == 1);
+    REQUIRE(objectRead(0) == 99);
+    REQUIRE(scenes.recall(63) == 1);
+    REQUIRE(objectRead(2) == 7);
+
+    // Empty and out of range scenes write nothing
+    REQUIRE(scenes.recall(2) == 0);
+    REQUIRE(scenes.recall(-1) == 0);
+    REQUIRE(scenes.recall(64) == 0);
+}
+
+TEST_CASE("Scene engine: store and the DPT18 control object", "[sblib][scene]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    setupTables();
+    setupSceneTable();
+
+    SceneEngine scenes;
+    scenes.begin(SCENE_TABLE, 4);
+
+    // Other objects pass through untouched
+    REQUIRE(!scenes.processTelegram(3));
+
+    // A store control telegram captures the current object values into
+    // the entries of the scene
+    objectWrite(0, (unsigned int) 111);
+    objectWrite(1, (unsigned int) 112);
+    objectWrite(2, (unsigned int) 113);
+    objectWrite(3, (unsigned int) 114);
+    userEepromModified = 0;
+
+    objectWrite(4, (unsigned int) (0x80 | 5));
+    REQUIRE(scenes.processTelegram(4));
+    REQUIRE(userEeprom[SCENE_TABLE + 3] == 111);
+    REQUIRE(userEeprom[SCENE_TABLE + 9] == 112);
+    REQUIRE(userEeprom[SCENE_TABLE + 18] == 113);
+    REQUIRE(userEeprom[SCENE_TABLE + 21] == 114);
+    REQUIRE(userEepromModified);
+
+    // The other scenes keep their values
+    REQUIRE(userEeprom[SCENE_TABLE + 6] == 99);
+    REQUIRE(userEeprom[SCENE_TABLE + 15] == 7);
+
+    // Storing unchanged values does not mark the EEPROM modified again
+    userEepromModified = 0;
+    REQUIRE(scenes.store(5) == 4);
+    REQUIRE(!userEepromModified);
+
+    // A recall control telegram plays the stored values back
+    objectWrite(0, (unsigned int) 0);
+    objectWrite(1, (unsigned int) 0);
+    objectWrite(4, (unsigned int) 5);
+    REQUIRE(scenes.processTelegram(4));
+    REQUIRE(objectRead(0) == 111);
+    REQUIRE(objectRead(1) == 112);
+    REQUIRE(objectRead(2) == 113);
+    REQUIRE(objectRead(3) == 114);
+}
@@ -0,0 +1,154 @@
+/*
+ *  scheduler.cpp - Tests for the cooperative task scheduler
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/scheduler.h"
+#include "sblib/timer.h"
+
+extern volatile unsigned int systemTime;
+
+// The log of the task runs
+static char runLog[64];
+static int runCount;
+
+static void logRun(char id)
+{
+    if (runCount < (int) sizeof(runLog) - 1)
+        runLog[runCount++] = id;
+    runLog[runCount] = 0;
+}
+
+static void taskA() { logRun('A'); }
+static void taskB() { logRun('B'); }
+static void taskC() { logRun('C'); }
+
+// A task that takes 7 msec to run
+static void slowTask()
+{
+    logRun('S');
+    systemTime += 7;
+}
+
+static void clearLog()
+{
+    runCount = 0;
+    runLog[0] = 0;
+}
+
+TEST_CASE("Scheduler runs periodic tasks at their period","[sblib][scheduler]")
+{
+    Scheduler sched;
+
+    systemTime = 1000;
+    clearLog();
+
+    sched.add(taskA, 10);
+    sched.add(taskB, 5);
+
+    // Nothing is due before the first period elapsed
+    REQUIRE(sched.runNext() == false);
+    REQUIRE(runCount == 0);
+
+    // Over 20 msec: B is due every 5 msec, A every 10 msec. On a tie
+    // the table order decides, so A runs before B at the 10 msec marks
+    for (int t = 0; t < 20; ++t)
+    {
+        ++systemTime;
+        while (sched.runNext())
+            ;
+    }
+    REQUIRE(std::string(runLog) == "BABBAB");
+}
+
+TEST_CASE("Scheduler runs the most overdue task first","[sblib][scheduler]")
+{
+    Scheduler sched;
+
+    systemTime = 1000;
+    clearLog();
+
+    // A becomes due at 1010, B at 1012
+    sched.add(taskA, 10);
+    sched.add(taskB, 10, 2);
+
+    // Both are due now, A is more overdue and runs first
+    systemTime += 15;
+    REQUIRE(sched.runNext() == true);
+    REQUIRE(sched.runNext() == true);
+    REQUIRE(std::string(runLog) == "AB");
+}
+
+TEST_CASE("Scheduler background tasks fill the idle passes","[sblib][scheduler]")
+{
+    Scheduler sched;
+
+    systemTime = 1000;
+    clearLog();
+
+    sched.add(taskA, 10);
+    sched.add(taskB, 0);
+    sched.add(taskC, 0);
+
+    // No periodic task is due: the background tasks run round-robin,
+    // one per pass
+    REQUIRE(sched.runNext() == false);
+    REQUIRE(sched.runNext() == false);
+    REQUIRE(sched.runNext() == false);
+    REQUIRE(std::string(runLog) == "BCB");
+
+    // A due periodic task preempts the background rotation
+    systemTime += 10;
+    clearLog();
+    REQUIRE(sched.runNext() == true);
+    REQUIRE(sched.runNext() == false);
+    REQUIRE(std::string(runLog) == "AC");
+}
+
+TEST_CASE("Scheduler records the worst task duration","[sblib][scheduler]")
+{
+    Scheduler sched;
+
+    systemTime = 1000;
+    clearLog();
+
+    sched.add(slowTask, 10);
+    REQUIRE(sched.maxDuration(slowTask) == 0);
+
+    systemTime += 10;
+    REQUIRE(sched.runNext() == true);
+    REQUIRE(sched.maxDuration(slowTask) == 7);
+
+    // An unknown task has no duration
+    REQUIRE(sched.maxDuration(taskA) == 0);
+}
+
+TEST_CASE("Scheduler sheds backlog after falling behind","[sblib][scheduler]")
+{
+    Scheduler sched;
+
+    systemTime = 1000;
+    clearLog();
+
+    sched.add(taskA, 10);
+
+    // 50 msec pass without the scheduler running: the task runs once
+    // and the missed periods are dropped instead of being run back to
+    // back
+    systemTime += 50;
+    while (sched.runNext())
+        ;
+    REQUIRE(std::string(runLog) == "A");
+
+    // The period is kept from now on
+    systemTime += 10;
+    REQUIRE(sched.runNext() == true);
+    REQUIRE(std::string(runLog) == "AA");
+}
@@ -0,0 +1,73 @@
+/*
+ *  serial_flow.cpp - Tests for the serial flow control.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/serial.h"
+#include "sblib/digital_pin.h"
+#include "sblib/io_pin_names.h"
+
+#define LSR_RDR  0x01
+#define LSR_THRE 0x20
+#define LSR_TEMT 0x40
+
+TEST_CASE("Serial RTS flow control", "[sblib][serial]")
+{
+    serial.enableFlowControl(PIO0_7);
+
+    // Ready to receive: the RTS pin is low
+    REQUIRE(digitalRead(PIO0_7) == false);
+
+    // The peer bursts until the RX ring is full: the RX interrupt raises
+    // the RTS pin at the high watermark
+    LPC_UART->RBR = 0x42;
+    LPC_UART->LSR = LSR_RDR | LSR_THRE | LSR_TEMT;
+    serial.interruptHandler();
+    LPC_UART->LSR = LSR_THRE | LSR_TEMT;
+
+    REQUIRE(serial.available() > 0);
+    REQUIRE(digitalRead(PIO0_7) == true);
+
+    // Draining the ring below the low watermark drops the pin again
+    while (serial.available() > BufferedStream::BUFFER_SIZE / 4 + 1)
+        serial.read();
+    REQUIRE(digitalRead(PIO0_7) == true);
+
+    serial.read();
+    REQUIRE(digitalRead(PIO0_7) == false);
+
+    serial.disableFlowControl();
+}
+
+TEST_CASE("Serial XON/XOFF flow control", "[sblib][serial]")
+{
+    serial.enableFlowControlXonXoff();
+
+    // The peer bursts until the RX ring is full: an XOFF goes out at the
+    // high watermark
+    LPC_UART->THR = 0;
+    LPC_UART->RBR = 0x42;
+    LPC_UART->LSR = LSR_RDR | LSR_THRE | LSR_TEMT;
+    serial.interruptHandler();
+    LPC_UART->LSR = LSR_THRE | LSR_TEMT;
+
+    REQUIRE(LPC_UART->THR == SERIAL_XOFF);
+
+    // Draining the ring to the low watermark sends the XON
+    while (serial.available() > BufferedStream::BUFFER_SIZE / 4 - 1)
+        serial.read();
+    REQUIRE(LPC_UART->THR == SERIAL_XON);
+
+    serial.disableFlowControl();
+
+    // Drain the rest so the next test starts clean
+    while (serial.available())
+        serial.read();
+}
@@ -0,0 +1,28 @@
+/*
+ *  serial_rs485.cpp - Tests for the RS-485 direction control setup.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/serial.h"
+#include "sblib/digital_pin.h"
+#include "sblib/io_pin_names.h"
+
+TEST_CASE("Serial RS-485 direction control", "[sblib][serial]")
+{
+    // Driver enable on the RTS pin, released 2 bit times after the stop bit
+    serial.enableDirectionControl(PIO1_5, 2);
+
+    // Auto direction control enabled, pin high while sending
+    REQUIRE(LPC_UART->RS485CTRL == 0x30);
+    REQUIRE(LPC_UART->RS485DLY == 2);
+
+    serial.disableDirectionControl();
+    REQUIRE(LPC_UART->RS485CTRL == 0);
+}
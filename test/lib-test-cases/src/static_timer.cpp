@@ -0,0 +1,50 @@
+/*
+ *  static_timer.cpp - Tests for the compile time bound timer facade.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/static_timer.h"
+
+TEST_CASE("Static timer facade", "[sblib][timer]")
+{
+    typedef StaticTimer<TIMER16_0> T;
+
+    REQUIRE(T::regs() == LPC_TMR16B0);
+    REQUIRE(StaticTimer<TIMER32_1>::regs() == LPC_TMR32B1);
+
+    T::begin();
+    T::prescaler(47);
+    REQUIRE(LPC_TMR16B0->PR == 47);
+
+    T::match(MAT1, 800);
+    REQUIRE(LPC_TMR16B0->MR1 == 800);
+    REQUIRE(T::match(MAT1) == 800);
+
+    T::matchMode(MAT3, RESET | INTERRUPT);
+    REQUIRE((LPC_TMR16B0->MCR & (7 << 9)) == ((RESET | INTERRUPT) << 9));
+
+    LPC_TMR16B0->IR = 1 << MAT3;
+    REQUIRE(T::flag(MAT3));
+
+    // The IR register clears flags on writing a 1 bit. The host emu
+    // models the registers as plain memory, so only the access itself
+    // can be checked here: resetFlags() must write all flag bits of
+    // this timer's IR.
+    T::resetFlags();
+    REQUIRE(LPC_TMR16B0->IR == 0xff);
+    LPC_TMR16B0->IR = 0;
+    REQUIRE(!T::flag(MAT3));
+
+    // The facade and the dynamic class address the same registers
+    timer16_0.match(MAT2, 123);
+    REQUIRE(T::match(MAT2) == 123);
+
+    T::end();
+}
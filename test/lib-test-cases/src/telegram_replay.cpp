@@ -0,0 +1,175 @@
+/*
+ *  telegram_replay.cpp - Group telegram replay throughput measurements
+ *
+ *  Replays thousands of group write telegrams back-to-back through
+ *  BCU::processTelegram() against address/association tables of different
+ *  sizes, measuring the per-telegram cost and checking that telegram
+ *  processing does not allocate. The table sizes can be changed with the
+ *  REPLAY_* defines to get scaling curves for larger devices.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/eib/bus.h"
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/internal/variables.h"
+#include "sblib/bits.h"
+#include "cycle_count.h"
+#include "perf_budgets.h"
+#include "iap_emu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The number of telegrams that one replay run pushes through the BCU
+#ifndef REPLAY_TELEGRAM_COUNT
+#define REPLAY_TELEGRAM_COUNT 20000
+#endif
+
+// The number of communication objects, each is associated to one address
+#ifndef REPLAY_OBJECT_COUNT
+#define REPLAY_OBJECT_COUNT 16
+#endif
+
+// Count the heap allocations of the whole test binary: telegram processing
+// must not allocate, the replay checks that the counter stays unchanged
+static unsigned long allocCount;
+
+void* operator new(size_t size)
+{
+    ++allocCount;
+    return malloc(size);
+}
+
+void* operator new[](size_t size)
+{
+    ++allocCount;
+    return malloc(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    free(ptr);
+}
+
+/*
+ * Build a BCU1 configuration with numAddrs group addresses, one association
+ * per address and REPLAY_OBJECT_COUNT writable 1 byte com-objects, then
+ * rebuild the lookup indexes like the BCU does after a download.
+ */
+static void setupTables(int numAddrs)
+{
+    byte* tab = addrTable();
+
+    *tab = numAddrs;
+    storeBE16(tab + 1, 0x1112);                // entry 0: own physical address
+    for (int i = 1; i <= numAddrs; ++i)
+        storeBE16(tab + 1 + i * 2, 0x0800 + i - 1);
+
+    // The address table starts at 0x116 and grows with numAddrs, so the
+    // association and com-object tables sit at fixed offsets behind the
+    // largest address table. All three must fit into the 256 byte eeprom.
+    userEeprom.assocTabPtr = 0x55;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = numAddrs;
+    for (int i = 0; i < numAddrs; ++i)
+    {
+        assocTab[1 + i * 2] = i + 1;                     // address table index
+        assocTab[2 + i * 2] = i % REPLAY_OBJECT_COUNT;   // com-object number
+    }
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = REPLAY_OBJECT_COUNT;
+    commsTab[1] = 0x30;                        // status flags in userRam
+    for (int i = 0; i < REPLAY_OBJECT_COUNT; ++i)
+    {
+        commsTab[2 + i * 3] = i;               // value at userRam offset objno
+        commsTab[3 + i * 3] = COMCONF_WRITE_COMM;
+        commsTab[4 + i * 3] = BIT_6;
+    }
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+}
+
+/*
+ * Replay count group write telegrams, cycling through the group addresses,
+ * and return the per-telegram cost in host cycles.
+ */
+static unsigned long long replay(int numAddrs, int count)
+{
+    unsigned long long start = cycleCount();
+
+    for (int i = 0; i < count; ++i)
+    {
+        byte* tel = bus.telegram;
+        tel[0] = 0xbc;                         // L_Data.req, no repeat
+        storeBE16(tel + 1, 0x1103);            // sender 1.1.3
+        storeBE16(tel + 3, 0x0800 + i % numAddrs);
+        tel[5] = 0xe1;                         // group address, length 1
+        tel[6] = 0x00;
+        tel[7] = 0x80 | 0x2a;                  // group value write, value 0x2a
+        bus.telegramLen = 8;
+
+        bcu.processTelegram();
+    }
+
+    return (cycleCount() - start) / count;
+}
+
+TEST_CASE("Group telegram replay throughput","[sblib][perf]")
+{
+    static const int tableSizes[] = { 4, 16, 30 };
+
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);  // initializes the bus buffers
+    bcu.setOwnAddress(0x1112);
+
+    printf("\nGroup write replay, %d telegrams each (host reference cycles):\n",
+        REPLAY_TELEGRAM_COUNT);
+
+    for (int s = 0; s < (int) (sizeof(tableSizes) / sizeof(tableSizes[0])); ++s)
+    {
+        int numAddrs = tableSizes[s];
+        setupTables(numAddrs);
+
+        // Warm up, then measure with a clean allocation counter
+        replay(numAddrs, 100);
+        unsigned long allocsBefore = allocCount;
+        unsigned long long perTel = replay(numAddrs, REPLAY_TELEGRAM_COUNT);
+        unsigned long allocsAfter = allocCount;
+
+        // perfRecord() keeps the name pointer, so the names must stay around
+        static char names[sizeof(tableSizes) / sizeof(tableSizes[0])][40];
+        sprintf(names[s], "group write (%d addresses)", numAddrs);
+        perfRecord(names[s], perTel);
+        printf("%-44s %8llu cycles/telegram\n", names[s], perTel);
+
+        // Telegram processing runs in interrupt context on the device and
+        // must never touch the heap
+        REQUIRE(allocsAfter == allocsBefore);
+
+        // The regression gate: even the largest table must stay in budget
+        REQUIRE(perTel <= BUDGET_GROUP_WRITE);
+
+        // The written values must have arrived in the com-objects
+        for (int i = 0; i < REPLAY_OBJECT_COUNT && i < numAddrs; ++i)
+            REQUIRE(userRamData[i] == 0x2a);
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ *  tick.cpp - Tests for the consolidated housekeeping tick.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/tick.h"
+#include "sblib/timeout.h"
+
+extern volatile unsigned int systemTime;
+
+static int count1k, count100;
+static int timeoutFired;
+
+static void handler1k()  { ++count1k; }
+static void handler100() { ++count100; }
+static void timeoutCb(void*) { ++timeoutFired; }
+
+TEST_CASE("Housekeeping tick tiers", "[sblib][tick]")
+{
+    systemTime = 5000;
+    count1k = count100 = 0;
+
+    REQUIRE(tickAttach(handler1k));
+    REQUIRE(tickAttach(handler100, TICK_100HZ));
+
+    // Several loop passes within the same millisecond run nothing
+    tickCheck();
+    int base1k = count1k;
+    tickCheck();
+    tickCheck();
+    REQUIRE(count1k == base1k);
+
+    // The 1 kHz tier runs once per millisecond, the 100 Hz tier every
+    // 10 milliseconds
+    count1k = count100 = 0;
+    for (int ms = 0; ms < 20; ++ms)
+    {
+        ++systemTime;
+        tickCheck();
+        tickCheck();  // a second pass in the same millisecond is free
+    }
+    REQUIRE(count1k == 20);
+    REQUIRE(count100 == 2);
+
+    // A stall does not replay the backlog: one run per tier, then the
+    // regular cadence continues
+    count1k = count100 = 0;
+    systemTime += 100;
+    tickCheck();
+    REQUIRE(count1k == 1);
+    REQUIRE(count100 == 1);
+
+    systemTime += 10;
+    tickCheck();
+    REQUIRE(count1k == 2);
+    REQUIRE(count100 == 2);
+
+    // A detached handler no longer runs
+    tickDetach(handler1k);
+    tickDetach(handler100);
+    ++systemTime;
+    tickCheck();
+    REQUIRE(count1k == 2);
+    REQUIRE(count100 == 2);
+}
+
+TEST_CASE("Housekeeping tick services the scheduled timeouts", "[sblib][tick]")
+{
+    systemTime = 9000;
+    timeoutFired = 0;
+
+    ScheduledTimeout t;
+    t.callback(timeoutCb);
+    t.start(5);
+
+    tickCheck();
+    REQUIRE(timeoutFired == 0);
+
+    // No explicit ScheduledTimeout::checkNext() needed: the tick fires
+    // the expired timeouts from its 1 kHz tier
+    systemTime += 5;
+    tickCheck();
+    REQUIRE(timeoutFired == 1);
+}
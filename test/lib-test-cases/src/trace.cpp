@@ -0,0 +1,135 @@
+/*
+ *  trace.cpp - Tests for the compile-out event counter and tracepoint
+ *              framework
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#include "sblib/trace.h"
+
+#ifdef SB_TRACE
+
+#include "sblib/print.h"
+#include "sblib/timer.h"
+
+/**
+ * A Print sink that captures the written bytes into a buffer, for
+ * checking the binary output of traceDrain().
+ */
+class TraceSink: public Print
+{
+public:
+    TraceSink() : count(0) {}
+
+    virtual int write(byte ch)
+    {
+        if (count < sizeof(buffer))
+            buffer[count++] = ch;
+        return 1;
+    }
+
+    /**
+     * Read a little endian value from the captured bytes.
+     *
+     * @param offset - the byte offset to read at.
+     * @param numBytes - the number of bytes of the value.
+     * @return The value.
+     */
+    unsigned int valueAt(int offset, int numBytes)
+    {
+        unsigned int value = 0;
+        for (int i = numBytes; i > 0; --i)
+            value = (value << 8) | buffer[offset + i - 1];
+        return value;
+    }
+
+    byte buffer[512];
+    unsigned int count;
+};
+
+TEST_CASE("Trace counters","[sblib][trace]")
+{
+    traceClear();
+
+    for (int id = 0; id < TRACE_ID_COUNT; ++id)
+        REQUIRE(traceCounter(id) == 0);
+
+    TRACE_COUNT(TRACE_APP1);
+    TRACE_COUNT(TRACE_APP1);
+    TRACE_COUNT(TRACE_APP2);
+    REQUIRE(traceCounter(TRACE_APP1) == 2);
+    REQUIRE(traceCounter(TRACE_APP2) == 1);
+    REQUIRE(traceCounter(TRACE_APP3) == 0);
+
+    // Events count too
+    TRACE_EVENT(TRACE_APP3, 1234);
+    REQUIRE(traceCounter(TRACE_APP3) == 1);
+
+    traceClear();
+    REQUIRE(traceCounter(TRACE_APP1) == 0);
+    REQUIRE(traceCounter(TRACE_APP3) == 0);
+}
+
+TEST_CASE("Trace event drain","[sblib][trace]")
+{
+    TraceSink sink;
+
+    traceClear();
+    TRACE_COUNT(TRACE_APP1);
+    TRACE_EVENT(TRACE_APP2, 0x11223344);
+    TRACE_EVENT(TRACE_APP3, 0xcafe);
+
+    traceDrain(sink);
+
+    // The header: "SBTR", version, counters, events, reserved
+    REQUIRE(sink.buffer[0] == 'S');
+    REQUIRE(sink.buffer[1] == 'B');
+    REQUIRE(sink.buffer[2] == 'T');
+    REQUIRE(sink.buffer[3] == 'R');
+    REQUIRE(sink.buffer[4] == 1);
+    REQUIRE(sink.buffer[5] == TRACE_ID_COUNT);
+    REQUIRE(sink.buffer[6] == 2);
+    REQUIRE(sink.buffer[7] == 0);
+    REQUIRE(sink.count == 8 + TRACE_ID_COUNT * 4 + 2 * 10);
+
+    // The counters, 4 bytes each, little endian
+    REQUIRE(sink.valueAt(8 + TRACE_APP1 * 4, 4) == 1);
+    REQUIRE(sink.valueAt(8 + TRACE_APP2 * 4, 4) == 1);
+    REQUIRE(sink.valueAt(8 + TRACE_RX_TELEGRAM * 4, 4) == 0);
+
+    // The events, oldest first: 4 bytes time, 2 bytes id, 4 bytes value
+    int events = 8 + TRACE_ID_COUNT * 4;
+    REQUIRE(sink.valueAt(events, 4) == millis());
+    REQUIRE(sink.valueAt(events + 4, 2) == TRACE_APP2);
+    REQUIRE(sink.valueAt(events + 6, 4) == 0x11223344);
+    REQUIRE(sink.valueAt(events + 10 + 4, 2) == TRACE_APP3);
+    REQUIRE(sink.valueAt(events + 10 + 6, 4) == 0xcafe);
+}
+
+TEST_CASE("Trace event ring overwrite","[sblib][trace]")
+{
+    TraceSink sink;
+
+    traceClear();
+
+    // Overfill the ring: the oldest events are overwritten
+    for (unsigned int i = 0; i < TRACE_EVENT_RING + 5; ++i)
+        TRACE_EVENT(TRACE_APP4, i);
+
+    traceDrain(sink);
+    REQUIRE(sink.buffer[6] == TRACE_EVENT_RING);
+    REQUIRE(sink.valueAt(8 + TRACE_APP4 * 4, 4) == TRACE_EVENT_RING + 5);
+
+    // The drained events start at the oldest surviving value
+    int events = 8 + TRACE_ID_COUNT * 4;
+    for (int i = 0; i < TRACE_EVENT_RING; ++i)
+        REQUIRE(sink.valueAt(events + i * 10 + 6, 4) == 5 + i);
+}
+
+#endif /*SB_TRACE*/
@@ -0,0 +1,262 @@
+/*
+ *  two_node_sim.cpp - End-to-end tests on the two node bus simulator.
+ *
+ *  Two complete library stacks on a simulated line: device A performs an
+ *  objectWrite(), the frame travels with real bit timing, device B
+ *  acknowledges and processes it. The tests measure the end-to-end
+ *  latency and the sustained group write rate, and check the repeat and
+ *  arbitration behavior under line faults.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/user_memory.h"
+#include "sblib/internal/functions.h"
+#include "sblib/bits.h"
+#include "iap_emu.h"
+#include "bus_edge_gen.h"
+#include "bus_net_sim.h"
+
+extern volatile unsigned int systemTime;
+
+// What the receiving node saw: filled by the object update handler
+static unsigned int rxCount;
+static unsigned int rxValue;
+static unsigned int rxTime;
+
+static void recordUpdate(int objno)
+{
+    ++rxCount;
+    rxValue = objectRead(objno);
+    rxTime = netSimTime();
+}
+
+/*
+ * Configure the selected node: object 0 transmits to sendAddr, object 1
+ * receives from recvAddr.
+ */
+static void setupNode(int ownAddr, int sendAddr, int recvAddr)
+{
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(ownAddr);
+    bcu.progPin = 0;  // no simulated button shall toggle the prog mode
+
+    byte* tab = addrTable();
+    *tab = 3;
+    storeBE16(tab + 1, ownAddr);
+    storeBE16(tab + 3, sendAddr);
+    storeBE16(tab + 5, recvAddr);
+
+    userEeprom.assocTabPtr = 0x55;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = 2;
+    assocTab[1] = 1;  // sendAddr
+    assocTab[2] = 0;  // -> com-object 0
+    assocTab[3] = 2;  // recvAddr
+    assocTab[4] = 1;  // -> com-object 1
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 2;
+    commsTab[1] = 0x30;          // status flags in userRam
+    commsTab[2] = 0;             // object 0: value at userRam offset 0
+    commsTab[3] = COMCONF_TRANS_COMM;
+    commsTab[4] = BIT_6;
+    commsTab[5] = 1;             // object 1: value at userRam offset 1
+    commsTab[6] = COMCONF_WRITE_COMM;
+    commsTab[7] = BIT_6;
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+
+    // Start with a clean flags table and clean pending hints, earlier
+    // test cases leave transmit flags behind
+    byte* flagsTab = objectFlagsTable();
+    flagsTab[0] = 0;
+    clearTransmitFlags();
+    unsigned int drain[1];
+    snapshotUpdatedObjects(drain);
+}
+
+/*
+ * Two nodes: node 0 sends to 0x0800 and listens to 0x0801, node 1 sends
+ * to 0x0801 and listens to node1RecvAddr (0x0800 for the symmetric pair).
+ */
+static void setupNetwork(int node1RecvAddr)
+{
+    systemTime = 0;
+    IAP_Init_Flash(0xFF);
+    busEdgeSeed(1);
+    busEdgeSetJitter(0);
+    busEdgeSetCorruption(0);
+
+    netSimBegin();
+    netSimSelect(0);
+    setupNode(0x1101, 0x0800, 0x0801);
+    netSimSelect(1);
+    setupNode(0x1102, 0x0801, node1RecvAddr);
+
+    setObjectUpdateHandler(recordUpdate);
+    rxCount = 0;
+    rxValue = 0;
+    rxTime = 0;
+}
+
+TEST_CASE("Two node simulation: end-to-end group write", "[sblib][netsim]")
+{
+    setupNetwork(0x0800);
+
+    netSimSelect(0);
+    objectWrite(0, (unsigned int) 1);
+    unsigned int start = netSimTime();
+
+    netSimRun(100000);
+
+    REQUIRE(rxCount == 1);
+    REQUIRE(rxValue == 1);
+
+    // One exchange: the send pause, the 9 byte frame, the ACK window and
+    // the ACK byte - about 20 msec, plus one scheduling step
+    unsigned int latency = rxTime - start;
+    REQUIRE(latency >= 18000);
+    REQUIRE(latency <= 30000);
+
+    REQUIRE(netSimStatistics().frames == 1);
+    REQUIRE(netSimStatistics().ackedFrames == 1);
+
+    netSimSelect(0);
+    REQUIRE(bus.statistics().repeats == 0);
+    netSimSelect(1);
+    REQUIRE(bus.statistics().rxTelegrams == 1);
+}
+
+TEST_CASE("Two node simulation: repeats without a listener", "[sblib][netsim]")
+{
+    // Node 1 does not listen to 0x0800: the frame is never acknowledged
+    setupNetwork(0x0900);
+
+    netSimSelect(0);
+    objectWrite(0, (unsigned int) 1);
+
+    netSimRun(300000);
+
+    REQUIRE(rxCount == 0);
+
+    // sendTriesMax transmissions in total: the first and 3 repeats, all
+    // unacknowledged
+    netSimSelect(0);
+    REQUIRE(bus.statistics().repeats == 3);
+    REQUIRE(bus.sendCurTelegram == 0);
+    REQUIRE(netSimStatistics().frames == 4);
+    REQUIRE(netSimStatistics().unackedFrames == 4);
+
+    netSimSelect(1);
+    REQUIRE(bus.statistics().rxFiltered == 4);
+}
+
+TEST_CASE("Two node simulation: corrupted line recovers", "[sblib][netsim]")
+{
+    setupNetwork(0x0800);
+
+    // Every byte on the wire gets one bit inverted: the receiver answers
+    // every frame with NACK and the sender gives up after its repeats
+    busEdgeSetCorruption(1000);
+
+    netSimSelect(0);
+    objectWrite(0, (unsigned int) 1);
+
+    netSimRun(300000);
+
+    REQUIRE(rxCount == 0);
+    REQUIRE(netSimStatistics().frames == 4);
+
+    // A corrupted address byte can make the receiver drop the frame
+    // silently instead of answering NACK, so both outcomes count
+    REQUIRE(netSimStatistics().ackedFrames == 0);
+    unsigned int failed = netSimStatistics().nackedFrames
+        + netSimStatistics().unackedFrames;
+    REQUIRE(failed == 4);
+
+    netSimSelect(1);
+    REQUIRE(bus.statistics().rxTelegrams == 0);
+    unsigned int dropped = bus.statistics().checksumErrors
+        + bus.statistics().rxFiltered;
+    REQUIRE(dropped == 4);
+
+    // A clean line again: the next write goes through
+    busEdgeSetCorruption(0);
+
+    netSimSelect(0);
+    objectWrite(0, (unsigned int) 2);
+
+    netSimRun(100000);
+
+    REQUIRE(rxCount == 1);
+    REQUIRE(rxValue == 2);
+}
+
+TEST_CASE("Two node simulation: simultaneous senders", "[sblib][netsim]")
+{
+    setupNetwork(0x0800);
+
+    // Both nodes queue a group write in the same scheduling step: one
+    // wins the start bit arbitration, the other backs off, receives the
+    // winner's frame and sends its own telegram afterwards
+    netSimSelect(0);
+    objectWrite(0, (unsigned int) 5);
+    netSimSelect(1);
+    objectWrite(0, (unsigned int) 7);
+
+    netSimRun(200000);
+
+    REQUIRE(rxCount == 2);
+    REQUIRE(netSimStatistics().frames == 2);
+    REQUIRE(netSimStatistics().ackedFrames == 2);
+    REQUIRE(netSimStatistics().backoffs >= 1);
+
+    netSimSelect(0);
+    REQUIRE(bus.statistics().repeats == 0);
+    REQUIRE(objectRead(1) == 7);
+    netSimSelect(1);
+    REQUIRE(objectRead(1) == 5);
+}
+
+TEST_CASE("Two node simulation: sustained group write rate", "[sblib][netsim]")
+{
+    setupNetwork(0x0800);
+
+    // Saturate the line: node 0 refreshes its object faster than the
+    // wire can carry, for two simulated seconds
+    unsigned int value = 0;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        netSimSelect(0);
+        objectWrite(0, ++value & 0x3f);
+        netSimRun(20000);
+    }
+
+    netSimSelect(0);
+    REQUIRE(bus.statistics().repeats == 0);
+
+    // A 9 byte frame with pause, ACK window and ACK byte is ~20.3 msec
+    // on the wire: the saturated line carries ~49 telegrams per second
+    unsigned int rate = (unsigned int)
+        ((unsigned long long) rxCount * 1000000 / netSimTime());
+    REQUIRE(rxCount >= 90);
+    REQUIRE(rate >= 40);
+    REQUIRE(rate <= 55);
+}
@@ -0,0 +1,110 @@
+/*
+ *  tx_stagger.cpp - Tests for the staggered startup transmissions.
+ *
+ *  After bus voltage recovery every device of the line restarts at the
+ *  same moment. The tests check that the queued group telegrams are held
+ *  back for the address-seeded hold-off window and released afterwards.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/user_memory.h"
+#include "sblib/internal/functions.h"
+#include "sblib/bits.h"
+#include "iap_emu.h"
+
+extern volatile unsigned int systemTime;
+
+/*
+ * One group address 0x0800, associated to a single transmitting 1 bit
+ * com-object.
+ */
+static void setupTables(void)
+{
+    byte* tab = addrTable();
+    *tab = 2;
+    storeBE16(tab + 1, 0x1112);  // entry 0: own physical address
+    storeBE16(tab + 3, 0x0800);
+
+    userEeprom.assocTabPtr = 0x55;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = 1;
+    assocTab[1] = 1;  // address table index
+    assocTab[2] = 0;  // com-object number
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 1;
+    commsTab[1] = 0x30;          // status flags in userRam
+    commsTab[2] = 0;             // value at userRam offset 0
+    commsTab[3] = COMCONF_TRANS_COMM;
+    commsTab[4] = BIT_6;
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+}
+
+TEST_CASE("Staggered startup transmissions", "[sblib][stagger]")
+{
+    systemTime = 1000;
+
+    IAP_Init_Flash(0xFF);
+    bcu.setTransmitStagger(512);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    setupTables();
+
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+
+    // The initial status transmission of the application
+    objectWrite(0, (unsigned int) 1);
+
+    // Inside the hold-off window the queued telegram is not released,
+    // no matter how often the loop runs
+    for (int i = 0; i < 20; ++i)
+        bcu.loop();
+    REQUIRE(bus.sendCurTelegram == 0);
+
+    // Past the window the telegram goes out
+    systemTime += 512;
+    for (int i = 0; i < 5 && !bus.sendCurTelegram; ++i)
+    {
+        bcu.loop();
+        systemTime += 17;  // step over the gaps of the ramped release
+    }
+    REQUIRE(bus.sendCurTelegram != 0);
+    REQUIRE((loadBE16((const byte*) bus.sendCurTelegram + 3)) == 0x0800);
+
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+
+    // Without the stagger the next restart transmits immediately
+    bcu.setTransmitStagger(0);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    setupTables();
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+
+    objectWrite(0, (unsigned int) 1);
+    bcu.loop();  // wraps the round robin scan of the transmit objects
+    bcu.loop();
+    REQUIRE(bus.sendCurTelegram != 0);
+
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+}
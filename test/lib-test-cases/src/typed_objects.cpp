@@ -0,0 +1,121 @@
+/*
+ *  typed_objects.cpp - Tests for the compile time com-object accessors.
+ *
+ *  The tests declare a small object layout with COM_OBJECT() and check
+ *  that the typed accessors see the same values and trigger the same
+ *  telegrams as the runtime table based API.
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "catch.hpp"
+
+#define private public
+#include "sblib/eib/bus.h"
+#undef private
+#include "sblib/eib/bcu.h"
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects_static.h"
+#include "sblib/eib/user_memory.h"
+#include "sblib/internal/functions.h"
+#include "sblib/bits.h"
+#include "iap_emu.h"
+
+// The fixed object layout: a 1 bit switch object and a 2 byte value
+// object, values in the user RAM behind the RAM flags table
+COM_OBJECT(0, BIT_1, 0x60)
+COM_OBJECT(1, BYTE_2, 0x61)
+
+/*
+ * The matching runtime tables: group address 0x0800 for object 0,
+ * 0x0801 for object 1.
+ */
+static void setupTables(void)
+{
+    byte* tab = addrTable();
+    *tab = 3;
+    storeBE16(tab + 1, 0x1112);  // entry 0: own physical address
+    storeBE16(tab + 3, 0x0800);
+    storeBE16(tab + 5, 0x0801);
+
+    userEeprom.assocTabPtr = 0x55;
+    userEeprom.commsTabPtr = 0x92;
+
+    byte* assocTab = assocTable();
+    *assocTab = 2;
+    assocTab[1] = 1;  // group 0x0800 -> object 0
+    assocTab[2] = 0;
+    assocTab[3] = 2;  // group 0x0801 -> object 1
+    assocTab[4] = 1;
+
+    byte* commsTab = objectConfigTable();
+    commsTab[0] = 2;
+    commsTab[1] = 0x30;          // status flags in userRam
+    commsTab[2] = 0x60;
+    commsTab[3] = COMCONF_TRANS_COMM;
+    commsTab[4] = BIT_1;
+    commsTab[5] = 0x61;
+    commsTab[6] = COMCONF_TRANS_COMM;
+    commsTab[7] = BYTE_2;
+
+    updateGroupAddrFilter();
+    updateObjectCache();
+
+    // Start with a clean flags table and clean pending hints, earlier
+    // test cases leave transmit flags behind
+    byte* flagsTab = objectFlagsTable();
+    flagsTab[0] = 0;
+    clearTransmitFlags();
+    unsigned int drain[1];
+    snapshotUpdatedObjects(drain);
+}
+
+static void drainTx(void)
+{
+    while (bus.sendCurTelegram)
+        bus.sendNextTelegram();
+}
+
+TEST_CASE("Typed com-object accessors", "[sblib][typedobj]")
+{
+    IAP_Init_Flash(0xFF);
+    bcu.begin(0x0004, 0x2060, 0x01);
+    bcu.setOwnAddress(0x1112);
+    setupTables();
+    drainTx();
+
+    // The compile time constants resolve to the declared layout
+    REQUIRE((int) TypedComObject<0>::size == 1);
+    REQUIRE((int) TypedComObject<1>::size == 2);
+    REQUIRE(obj<0>().valuePtr() == objectValuePtr(0));
+    REQUIRE(obj<1>().valuePtr() == objectValuePtr(1));
+
+    // A typed write is seen by the runtime API and queues a group telegram
+    obj<1>().write(0x1234);
+    REQUIRE(objectRead(1) == 0x1234);
+    REQUIRE(objectTransmitPending());
+
+    sendNextGroupTelegram();
+    if (!bus.sendCurTelegram)
+        sendNextGroupTelegram();  // wrap of the round robin scan
+    REQUIRE(bus.sendCurTelegram != 0);
+    REQUIRE(loadBE16((const byte*) bus.sendCurTelegram + 3) == 0x0801);
+    REQUIRE(bus.sendCurTelegram[8] == 0x12);
+    REQUIRE(bus.sendCurTelegram[9] == 0x34);
+    drainTx();
+
+    // An update stores the value but does not transmit
+    obj<0>().update(1);
+    REQUIRE(objectRead(0) == 1);
+    REQUIRE(!objectTransmitPending());
+
+    // A typed read sees a value written through the runtime API
+    objectSetValue(1, 0xbeef);
+    REQUIRE(obj<1>().read() == 0xbeef);
+
+    drainTx();
+}
@@ -0,0 +1,181 @@
+/*
+ *  bus_edge_gen.cpp - Virtual bus edge generator for ISR stress tests
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "bus_edge_gen.h"
+
+#include "sblib/eib/bus.h"
+
+// The bit timing of the wire, must match the values in bus.cpp
+#define GEN_BIT_TIME 104
+#define GEN_SEND_WAIT_TIME 5200
+
+// The interrupt flag bits of the emulated timer 16 #1: capture channel
+// CAP0 and the bus timeout channel MAT2 (the pwm channel MAT0 plus 2,
+// see the Bus constructor)
+#define GEN_CAPTURE_FLAG 0x10
+#define GEN_TIMEOUT_FLAG 0x04
+
+static unsigned int randState = 1;
+static int jitterUsec = 0;
+static int corruptPerMille = 0;
+static unsigned int interruptCount = 0;
+
+
+void busEdgeSeed(unsigned int seed)
+{
+    randState = seed ? seed : 1;
+}
+
+void busEdgeSetJitter(int usec)
+{
+    jitterUsec = usec;
+}
+
+void busEdgeSetCorruption(int perMille)
+{
+    corruptPerMille = perMille;
+}
+
+unsigned int busEdgeInterruptCount(void)
+{
+    return interruptCount;
+}
+
+// A deterministic random number, 0..range-1
+static unsigned int genRand(unsigned int range)
+{
+    randState = randState * 1103515245 + 12345;
+    return (randState >> 16) % range;
+}
+
+// Deliver one capture event: the falling edge of a zero bit at the given
+// time, in usec relative to the byte's start bit
+static void deliverCapture(unsigned int time)
+{
+    LPC_TMR16B1->CR0 = time;
+    LPC_TMR16B1->TC = time;
+    LPC_TMR16B1->IR = GEN_CAPTURE_FLAG;
+    bus.timerInterruptHandler();
+    ++interruptCount;
+}
+
+// Deliver a timeout event on the bus timeout match channel
+static void deliverTimeout(void)
+{
+    LPC_TMR16B1->IR = GEN_TIMEOUT_FLAG;
+    bus.timerInterruptHandler();
+    ++interruptCount;
+}
+
+void busEdgeTimeout(void)
+{
+    deliverTimeout();
+}
+
+/*
+ * Send the bits of one byte: an edge for every zero bit of the 9 bit
+ * word (8 data bits and the odd parity bit), then the byte timeout.
+ * The start bit edge must already have been delivered.
+ */
+static void sendWireBits(int data)
+{
+    int parity = data;
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+
+    int wire = data | ((parity & 1) << 8);
+
+    if (corruptPerMille && (int) genRand(1000) < corruptPerMille)
+        wire ^= 1 << genRand(9);  // invert one wire bit: a parity error
+
+    for (int bit = 0; bit < 9; ++bit)
+    {
+        if (wire & (1 << bit))
+            continue;  // a one bit has no edge
+
+        int time = (bit + 1) * GEN_BIT_TIME;
+        if (jitterUsec)
+            time += (int) genRand(2 * jitterUsec + 1) - jitterUsec;
+
+        deliverCapture(time);
+    }
+
+    deliverTimeout();
+}
+
+/*
+ * Send one byte as it appears on the wire: the start bit edge, then the
+ * bits. The start edge's capture time only matters when the bus is in
+ * the ACK window, where early edges are ignored.
+ */
+static void sendWireByte(int data)
+{
+    deliverCapture(GEN_SEND_WAIT_TIME);
+    sendWireBits(data);
+}
+
+void busEdgeFeedTelegram(const unsigned char* telegram, int length)
+{
+    unsigned char checksum = 0xff;
+
+    for (int i = 0; i < length; ++i)
+    {
+        sendWireByte(telegram[i]);
+        checksum ^= telegram[i];
+    }
+    sendWireByte(checksum);
+
+    // No further start bit: the receiver sees the end of the telegram
+    deliverTimeout();
+}
+
+void busEdgeFeedRawTelegram(const unsigned char* data, int length)
+{
+    for (int i = 0; i < length; ++i)
+        sendWireByte(data[i]);
+
+    // No further start bit: the receiver sees the end of the frame
+    deliverTimeout();
+}
+
+void busEdgeFeedBytes(const unsigned char* telegram, int length)
+{
+    for (int i = 0; i < length; ++i)
+        sendWireByte(telegram[i]);
+}
+
+void busEdgeCollide(const unsigned char* telegram, int length)
+{
+    unsigned char checksum = 0xff;
+
+    // The other sender's start bit, well before our own start bit match:
+    // the send start bit handler backs off into receive mode and treats
+    // this edge as the start bit of the incoming frame
+    LPC_TMR16B1->CR0 = 30;
+    LPC_TMR16B1->TC = 30;
+    LPC_TMR16B1->IR = GEN_CAPTURE_FLAG;
+    bus.timerInterruptHandler();
+    ++interruptCount;
+
+    // The start bit of the first byte was just consumed by the
+    // arbitration, so only the bits follow here
+    sendWireBits(telegram[0]);
+    checksum ^= telegram[0];
+
+    for (int i = 1; i < length; ++i)
+    {
+        sendWireByte(telegram[i]);
+        checksum ^= telegram[i];
+    }
+    sendWireByte(checksum);
+
+    deliverTimeout();
+}
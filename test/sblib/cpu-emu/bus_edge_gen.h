@@ -0,0 +1,101 @@
+/*
+ *  bus_edge_gen.h - Virtual bus edge generator for ISR stress tests
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef BUS_EDGE_GEN_H_
+#define BUS_EDGE_GEN_H_
+
+/*
+ * Synthesizes the capture events and timer matches that the bus hardware
+ * would generate for a KNX frame on the wire and drives them through
+ * bus.timerInterruptHandler(), one interrupt per falling edge or timeout.
+ * This exercises the bit level receive paths of the ISR - jittered edges,
+ * corrupted bits, a second sender colliding with our transmission - fully
+ * deterministically on the host.
+ */
+
+/*
+ * Seed the generator's random source. The generator is deterministic:
+ * the same seed produces the same jitter and corruption decisions.
+ *
+ * @param seed - the random seed.
+ */
+void busEdgeSeed(unsigned int seed);
+
+/*
+ * Set the timing jitter that is added to every synthesized edge.
+ *
+ * @param usec - the maximum deviation in usec, edges move by -usec..+usec.
+ */
+void busEdgeSetJitter(int usec);
+
+/*
+ * Set the bit corruption rate. A corrupted byte has one of its bits
+ * inverted on the wire, which the receiver detects as a parity error.
+ *
+ * @param perMille - corrupted bytes per 1000 bytes, 0 to disable.
+ */
+void busEdgeSetCorruption(int perMille);
+
+/*
+ * Feed one telegram to the bus interrupt handler, edge by edge. The
+ * checksum byte is calculated and appended like a real sender does.
+ *
+ * @param telegram - the telegram bytes, without the checksum.
+ * @param length - the number of telegram bytes, without the checksum.
+ */
+void busEdgeFeedTelegram(const unsigned char* telegram, int length);
+
+/*
+ * Feed a complete frame exactly as given, without appending a checksum:
+ * the bytes must already contain the checksum and, for repeats, the
+ * toggled repeat flag. Used by the network simulator to carry a frame
+ * that another node's sender produced.
+ *
+ * @param data - the raw frame bytes, including the checksum.
+ * @param length - the number of frame bytes.
+ */
+void busEdgeFeedRawTelegram(const unsigned char* data, int length);
+
+/*
+ * Feed the first bytes of a telegram without finishing it: no checksum
+ * and no end of telegram timeout. Use busEdgeTimeout() to let the
+ * receiver see the line going quiet, e.g. after a simulated stall that
+ * made it miss the rest of the frame.
+ *
+ * @param telegram - the telegram bytes to feed.
+ * @param length - the number of bytes to feed.
+ */
+void busEdgeFeedBytes(const unsigned char* telegram, int length);
+
+/*
+ * Synthesize a second sender that starts transmitting its telegram while
+ * our bus is about to send the start bit, making our sender back off and
+ * receive the other sender's frame. The bus must be in the
+ * SEND_START_BIT state when this is called.
+ *
+ * @param telegram - the other sender's telegram bytes, without checksum.
+ * @param length - the number of telegram bytes, without the checksum.
+ */
+void busEdgeCollide(const unsigned char* telegram, int length);
+
+/*
+ * Deliver one timeout event on the bus timeout match channel. Advances
+ * the send state machine when no capture event is pending, e.g. from
+ * SEND_INIT to SEND_START_BIT.
+ */
+void busEdgeTimeout(void);
+
+/*
+ * The number of interrupts that busEdgeFeedTelegram() generated so far.
+ * Allows per-interrupt cost calculations in the timing tests.
+ */
+unsigned int busEdgeInterruptCount(void);
+
+#endif /* BUS_EDGE_GEN_H_ */
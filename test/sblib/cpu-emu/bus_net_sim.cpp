@@ -0,0 +1,354 @@
+/*
+ *  bus_net_sim.cpp - Two node bus network simulator
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "bus_net_sim.h"
+#include "bus_edge_gen.h"
+
+#define private public
+#define protected public
+#include "sblib/eib/bus.h"
+#include "sblib/eib/bcu.h"
+#undef private
+#undef protected
+
+#include "sblib/eib/addr_tables.h"
+#include "sblib/eib/com_objects.h"
+#include "sblib/eib/user_memory.h"
+#include "iap_emu.h"
+
+#include <string.h>
+
+// The bit timing of the wire, must match the values in bus.cpp
+#define SIM_BIT_TIME 104
+#define SIM_BYTE_TIME (13 * SIM_BIT_TIME)  // start, 9 bits, stop, 2 bits pause
+#define SIM_PRE_SEND_TIME 104
+#define SIM_SEND_WAIT_TIME 5200
+#define SIM_ACK_WAIT_TIME 1177
+
+// The interrupt flag bits of the emulated timer 16 #1, see bus_edge_gen.cpp
+#define SIM_CAPTURE_FLAG 0x10
+#define SIM_TIMEOUT_FLAG 0x04
+
+// Queue rank per KNX priority field value, like busPrioRank in bus.cpp
+static const unsigned char simPrioRank[4] = { 0, 2, 1, 3 };
+
+// Library state that lives outside of the bus and BCU objects
+extern volatile unsigned int systemTime;
+extern byte userEepromModified;
+extern unsigned int writeUserEepromTime;
+extern unsigned int userEepromDirtyPages;
+extern int sndStartIdx;
+extern unsigned int transPendingMask[];
+extern unsigned int updatePendingMask[];
+
+// Must match OBJ_PENDING_WORDS in com_objects.cpp
+#define SIM_PENDING_WORDS 8
+
+/*
+ * The complete state of one node: everything the library mutates at
+ * runtime, so that swapping a node in and out is transparent to it. The
+ * blocks are restored to their original addresses, which keeps all
+ * pointers between them (receive ring, send queue, table pointers) valid.
+ * The sorted table indexes and the com-object caches are not saved; they
+ * are rebuilt from the restored tables on every swap.
+ */
+struct NetSimNode
+{
+    unsigned char busState[sizeof(Bus)];
+    unsigned char bcuState[sizeof(BCU)];
+    byte ram[USER_RAM_SIZE + USER_RAM_SHADOW_SIZE];
+    byte eeprom[USER_EEPROM_SIZE];
+    unsigned char flash[FLASH_SIZE];
+    LPC_TMR_TypeDef timerRegs;
+    byte eepromModified;
+    unsigned int eepromWriteTime;
+    unsigned int eepromDirtyPages;
+    int sndStart;
+    unsigned int transPending[SIM_PENDING_WORDS];
+    unsigned int updatePending[SIM_PENDING_WORDS];
+};
+
+static NetSimNode nodes[NET_SIM_NODES];
+static int activeNode;
+static int lastSender;
+static unsigned int lineTime;
+static NetSimStats simStats;
+
+
+static void saveNode(NetSimNode* node)
+{
+    memcpy(node->busState, (const void*) &bus, sizeof(Bus));
+    memcpy(node->bcuState, (const void*) &bcu, sizeof(BCU));
+    memcpy(node->ram, userRamData, sizeof(node->ram));
+    memcpy(node->eeprom, userEepromData, sizeof(node->eeprom));
+    memcpy(node->flash, FLASH_BASE_ADDRESS, sizeof(node->flash));
+    memcpy(&node->timerRegs, (const void*) LPC_TMR16B1, sizeof(node->timerRegs));
+
+    node->eepromModified = userEepromModified;
+    node->eepromWriteTime = writeUserEepromTime;
+    node->eepromDirtyPages = userEepromDirtyPages;
+    node->sndStart = sndStartIdx;
+    memcpy(node->transPending, transPendingMask, sizeof(node->transPending));
+    memcpy(node->updatePending, updatePendingMask, sizeof(node->updatePending));
+}
+
+static void restoreNode(const NetSimNode* node)
+{
+    memcpy((void*) &bus, node->busState, sizeof(Bus));
+    memcpy((void*) &bcu, node->bcuState, sizeof(BCU));
+    memcpy(userRamData, node->ram, sizeof(node->ram));
+    memcpy(userEepromData, node->eeprom, sizeof(node->eeprom));
+    memcpy(FLASH_BASE_ADDRESS, node->flash, sizeof(node->flash));
+    memcpy((void*) LPC_TMR16B1, &node->timerRegs, sizeof(node->timerRegs));
+
+    userEepromModified = node->eepromModified;
+    writeUserEepromTime = node->eepromWriteTime;
+    userEepromDirtyPages = node->eepromDirtyPages;
+    sndStartIdx = node->sndStart;
+    memcpy(transPendingMask, node->transPending, sizeof(node->transPending));
+    memcpy(updatePendingMask, node->updatePending, sizeof(node->updatePending));
+
+    // Rebuild the derived indexes and caches from the restored tables
+    if (bcu.enabled)
+    {
+        updateGroupAddrFilter();
+        updateObjectCache();
+    }
+}
+
+void netSimBegin(void)
+{
+    lineTime = 0;
+    activeNode = 0;
+    lastSender = NET_SIM_NODES - 1;
+    memset(&simStats, 0, sizeof(simStats));
+
+    // Every node starts from the current (unconfigured) library state
+    for (int i = 0; i < NET_SIM_NODES; ++i)
+        saveNode(nodes + i);
+}
+
+void netSimSelect(int node)
+{
+    if (node == activeNode)
+        return;
+
+    saveNode(nodes + activeNode);
+    restoreNode(nodes + node);
+    activeNode = node;
+}
+
+int netSimActiveNode(void)
+{
+    return activeNode;
+}
+
+unsigned int netSimTime(void)
+{
+    return lineTime;
+}
+
+const NetSimStats& netSimStatistics(void)
+{
+    return simStats;
+}
+
+// Advance the shared millisecond clock to the line time
+static void syncClock(void)
+{
+    systemTime = lineTime / 1000;
+}
+
+// Deliver a timeout event on the bus timeout match channel
+static void deliverTimeout(void)
+{
+    LPC_TMR16B1->IR = SIM_TIMEOUT_FLAG;
+    bus.timerInterruptHandler();
+}
+
+// Deliver the echo of the node's own transmitted edge: the capture time
+// is exactly the armed PWM match, as the real line reflects it
+static void deliverEcho(void)
+{
+    LPC_TMR16B1->CR0 = LPC_TMR16B1->MR0;
+    LPC_TMR16B1->TC = LPC_TMR16B1->MR0;
+    LPC_TMR16B1->IR = SIM_CAPTURE_FLAG;
+    bus.timerInterruptHandler();
+}
+
+/*
+ * Drive the active node's sender through one complete frame, one
+ * interrupt per bit event, echoing its own edges back like the real
+ * line does. Also sends a pending acknowledge byte the same way.
+ *
+ * @param frame - the frame bytes are copied here, including the checksum.
+ * @return The number of frame bytes, 0 if nothing was sent (e.g. only
+ *         an acknowledge byte, or an empty send queue).
+ */
+static int driveSender(unsigned char* frame)
+{
+    int length = 0;
+    bool sending = false;
+
+    // ~13 events per byte; the guard only breaks runaway state loops
+    for (int guard = 0; guard < 1000; ++guard)
+    {
+        switch (bus.state)
+        {
+        case Bus::SEND_INIT:
+            deliverTimeout();
+            break;
+
+        case Bus::SEND_START_BIT:
+            if (!sending && bus.sendTelegramLen > 0)
+            {
+                length = bus.sendTelegramLen;
+                memcpy(frame, (const void*) bus.sendCurTelegram, length);
+            }
+            sending = true;
+            deliverEcho();
+            break;
+
+        case Bus::SEND_BIT_0:
+        case Bus::SEND_BIT:
+        case Bus::SEND_END:
+            deliverTimeout();
+            break;
+
+        case Bus::SEND_BIT_WAIT:
+            deliverEcho();  // our own zero bit: no collision
+            break;
+
+        case Bus::SEND_WAIT:
+            if (sending)
+                return length;
+            deliverTimeout();  // a parked sender: advance into SEND_INIT
+            break;
+
+        default:  // IDLE or a receive state: nothing (left) to send
+            return sending ? length : 0;
+        }
+    }
+    return length;
+}
+
+/*
+ * Carry one frame of the sending node over the line: drive the sender
+ * through the frame, deliver the bytes to every other node, and bring
+ * the (first) acknowledge byte back to the sender. Without an ACK the
+ * sender's repeat logic takes over, exactly as on the real line.
+ */
+static void carryFrame(int sender)
+{
+    unsigned char frame[Bus::TELEGRAM_SIZE + 1];
+    unsigned char scratch[Bus::TELEGRAM_SIZE + 1];
+    unsigned char ack = 0;
+
+    netSimSelect(sender);
+
+    int length = driveSender(frame);
+    if (length <= 0)
+        return;
+
+    ++simStats.frames;
+
+    // The pause before the frame and the frame itself on the wire
+    lineTime += SIM_SEND_WAIT_TIME + SIM_PRE_SEND_TIME
+        + ((frame[0] >> 2) & 3) * SIM_BIT_TIME + length * SIM_BYTE_TIME;
+    syncClock();
+
+    for (int node = 0; node < NET_SIM_NODES; ++node)
+    {
+        if (node == sender)
+            continue;
+
+        netSimSelect(node);
+
+        if (bus.sendCurTelegram)
+            ++simStats.backoffs;  // the node loses the arbitration
+
+        busEdgeFeedRawTelegram(frame, length);
+
+        if (bus.sendAck)
+        {
+            ack = bus.sendAck;
+            driveSender(scratch);  // transmit the acknowledge byte
+        }
+    }
+
+    lineTime += SIM_ACK_WAIT_TIME;
+    if (ack)
+        lineTime += SIM_BYTE_TIME;
+    syncClock();
+
+    netSimSelect(sender);
+
+    if (ack)
+    {
+        busEdgeFeedRawTelegram(&ack, 1);
+
+        if (ack == SB_BUS_ACK)
+            ++simStats.ackedFrames;
+        else
+            ++simStats.nackedFrames;
+    }
+    else
+    {
+        ++simStats.unackedFrames;
+        deliverTimeout();  // the ACK window passes in silence
+    }
+}
+
+void netSimRun(unsigned int usec)
+{
+    unsigned int end = lineTime + usec;
+
+    while ((int) (end - lineTime) > 0)
+    {
+        // The application pass of every node
+        for (int node = 0; node < NET_SIM_NODES; ++node)
+        {
+            netSimSelect(node);
+            bcu.loop();
+            bcu.loop();
+        }
+
+        // Line arbitration: the pending frame with the best KNX priority
+        // wins, equal priorities alternate between the nodes
+        int sender = -1;
+        int senderRank = 4;
+
+        for (int i = 0; i < NET_SIM_NODES; ++i)
+        {
+            int node = (lastSender + 1 + i) % NET_SIM_NODES;
+
+            netSimSelect(node);
+            if (!bus.sendCurTelegram)
+                continue;
+
+            int rank = simPrioRank[(bus.sendCurTelegram[0] >> 2) & 3];
+            if (rank < senderRank)
+            {
+                sender = node;
+                senderRank = rank;
+            }
+        }
+
+        if (sender < 0)
+        {
+            lineTime += NET_SIM_IDLE_STEP;  // the line is quiet
+            syncClock();
+            continue;
+        }
+
+        lastSender = sender;
+        carryFrame(sender);
+    }
+}
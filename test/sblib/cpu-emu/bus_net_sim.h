@@ -0,0 +1,98 @@
+/*
+ *  bus_net_sim.h - Two node bus network simulator
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef BUS_NET_SIM_H_
+#define BUS_NET_SIM_H_
+
+/*
+ * Simulates a bus line with several complete library stacks attached, for
+ * end-to-end measurements on the host: telegram latency from objectWrite()
+ * on one node to the update handler of another, sustained group write
+ * rates, repeats and backoff behavior.
+ *
+ * The library's bus and BCU are singletons, so the nodes cannot exist
+ * side by side in one process. Instead the simulator time-multiplexes
+ * them: the complete per-node state - the bus and BCU objects, user RAM
+ * and EEPROM, the emulated flash and bus timer, and the com-object
+ * bookkeeping - is swapped in and out around every line event. Each node
+ * runs the real, unmodified stack; only one of them is live at a time.
+ *
+ * The line itself is carried at frame granularity with the real bit
+ * timing: the sender's interrupt handler is driven through the whole
+ * frame by echoing its own edges back, the frame bytes then arrive at the
+ * other nodes edge by edge through the bus edge generator, and the
+ * acknowledge byte travels the same way in the opposite direction. The
+ * edge generator's jitter and corruption settings apply, so a noisy line
+ * exercises the real NACK and repeat paths. Two nodes that queue at the
+ * same time resolve by start bit arbitration: the loser receives the
+ * winner's frame and backs off, keeping its own telegram queued.
+ */
+
+/** The number of simulated nodes on the line */
+#define NET_SIM_NODES 2
+
+/** The time the line advances per idle scheduling step, in usec */
+#define NET_SIM_IDLE_STEP 1000
+
+/**
+ * Counters of the simulated line, accumulated over all nodes.
+ */
+struct NetSimStats
+{
+    unsigned int frames;        //!< Frames carried over the line, including repeats
+    unsigned int ackedFrames;   //!< Frames that a receiver answered with ACK
+    unsigned int nackedFrames;  //!< Frames that a receiver answered with NACK or BUSY
+    unsigned int unackedFrames; //!< Frames that no receiver acknowledged
+    unsigned int backoffs;      //!< A node postponed its own pending frame for a received one
+};
+
+/*
+ * Initialize the simulator: reset the line time and the statistics, and
+ * snapshot the current library state as the starting point of every node.
+ * Call after IAP_Init_Flash(), then select and configure each node.
+ */
+void netSimBegin(void);
+
+/*
+ * Make the given node's library state the live one. The state of the
+ * previously selected node is saved first. Call this before configuring
+ * a node (bcu.begin(), tables) and before inspecting its bus statistics
+ * or com-objects from a test.
+ *
+ * @param node - the node to select, 0..NET_SIM_NODES-1.
+ */
+void netSimSelect(int node);
+
+/*
+ * @return The currently selected node.
+ */
+int netSimActiveNode(void);
+
+/*
+ * @return The simulated line time in usec.
+ */
+unsigned int netSimTime(void);
+
+/*
+ * Advance the simulated line. Every node's bcu.loop() runs, pending
+ * frames are carried to the other nodes with the real bit timing, and
+ * the system time follows the line time. Frames are carried whole, so
+ * the line time can overshoot the requested window by up to one frame.
+ *
+ * @param usec - the time to advance the line by, in usec.
+ */
+void netSimRun(unsigned int usec);
+
+/*
+ * @return The line statistics counters.
+ */
+const NetSimStats& netSimStatistics(void);
+
+#endif /* BUS_NET_SIM_H_ */
@@ -0,0 +1,102 @@
+/*
+ *  cycle_count.c - Cycle accounting for the host based tests
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#include "cycle_count.h"
+
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#else
+#include <time.h>
+#endif
+
+// The measured overhead of a cycleCount() pair, 0 until calibrated
+static unsigned long long overhead;
+static int calibrated = 0;
+
+// The recorded measurements
+#define MAX_PERF_RESULTS 64
+static const char* resultNames[MAX_PERF_RESULTS];
+static unsigned long long resultCycles[MAX_PERF_RESULTS];
+static int resultCount = 0;
+
+
+unsigned long long cycleCount(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    unsigned int lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long) hi << 32) | lo;
+#else
+    // No cycle counter available: fall back to the monotonic clock in
+    // nanoseconds, which is close enough for relative comparisons
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+void cycleCalibrate(void)
+{
+    unsigned long long best = ~0ull;
+    int i;
+
+    for (i = 0; i < 1000; ++i)
+    {
+        unsigned long long start = cycleCount();
+        unsigned long long delta = cycleCount() - start;
+        if (delta < best)
+            best = delta;
+    }
+
+    overhead = best;
+    calibrated = 1;
+}
+
+unsigned long long cycleOverhead(void)
+{
+    if (!calibrated)
+        cycleCalibrate();
+    return overhead;
+}
+
+void perfRecord(const char* name, unsigned long long cycles)
+{
+    int i;
+
+    // Re-running a benchmark overwrites its previous result
+    for (i = 0; i < resultCount; ++i)
+    {
+        if (strcmp(resultNames[i], name) == 0)
+        {
+            resultCycles[i] = cycles;
+            return;
+        }
+    }
+
+    if (resultCount < MAX_PERF_RESULTS)
+    {
+        resultNames[resultCount] = name;
+        resultCycles[resultCount] = cycles;
+        ++resultCount;
+    }
+}
+
+int perfResultCount(void)
+{
+    return resultCount;
+}
+
+unsigned long long perfResult(int idx, const char** name)
+{
+    if (name)
+        *name = resultNames[idx];
+    return resultCycles[idx];
+}
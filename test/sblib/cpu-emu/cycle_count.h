@@ -0,0 +1,52 @@
+/*
+ *  cycle_count.h - Cycle accounting for the host based tests
+ *
+ *  Copyright (c) 2015 Martin Glueck <martin@mangari.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 3 as
+ *  published by the Free Software Foundation.
+ */
+
+#ifndef CYCLE_COUNT_H_
+#define CYCLE_COUNT_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * The emulation layer models the LPC11xx registers, not the Cortex-M0
+ * instruction set, so true M0 cycle counts cannot be derived here. What we
+ * can measure is the host processor's cycle counter around a library call.
+ * Those numbers are only meaningful relative to each other and to earlier
+ * runs on the same machine, but that is exactly what optimization work and
+ * regression checks need: a measurement taken with the minimum of many
+ * repetitions is stable to a few percent.
+ */
+
+// Read the host cycle counter
+unsigned long long cycleCount(void);
+
+// Measure the overhead of cycleCount() itself. Called once by the first
+// cycleOverhead(), can be called again to re-calibrate.
+void cycleCalibrate(void);
+
+// The overhead of a cycleCount() pair, subtracted from measurements
+unsigned long long cycleOverhead(void);
+
+// Record a named measurement for the report and the budget check
+void perfRecord(const char* name, unsigned long long cycles);
+
+// The number of recorded measurements
+int perfResultCount(void);
+
+// Get a recorded measurement, idx is 0..perfResultCount()-1
+unsigned long long perfResult(int idx, const char** name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CYCLE_COUNT_H_ */
@@ -22,12 +22,37 @@ enum IAP_Function
     I_ERASE = 1,
     I_BLANK_CHECK = 2,
     I_RAM2FLASH = 3,
-    I_COMPARE = 4
+    I_COMPARE = 4,
+    I_ERASE_PAGE = 5
 };
 
-extern int iap_calls[5];
+extern int iap_calls[6];
 void IAP_Init_Flash(unsigned char value);
 
+/*
+ * Flash timing emulation. On the real chip the flash is unreadable while
+ * an erase or program operation is in progress, so the CPU stalls and
+ * interrupts are blocked for the duration. The emulation models this as
+ * a busy window per operation: the system time advances by the busy time
+ * and the busy handler is called so a test can inject the events that
+ * the stalled CPU would have missed.
+ */
+
+// A handler that is called after each busy window, with its length in usec
+typedef void (*IAP_BusyHandler)(unsigned int busyTime);
+
+// Set the busy times in usec: per sector erase, per page erase, per
+// ram-to-flash copy. The defaults match the datasheet's order of magnitude.
+void IAP_Set_Timing(unsigned int sectorErase, unsigned int pageErase,
+    unsigned int program);
+
+// Set or clear (0) the handler that is called after each busy window
+void IAP_Set_Busy_Handler(IAP_BusyHandler handler);
+
+// The accumulated busy time in usec since the last reset
+unsigned int IAP_Busy_Time(void);
+void IAP_Reset_Busy_Time(void);
+
 
 // Size of a flash sector: 4k
 #define SECTOR_SIZE  0x1000
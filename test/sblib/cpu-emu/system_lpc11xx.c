@@ -65,19 +65,68 @@ typedef enum
     BUSY
 } IAP_Status;
 
-int iap_calls [5] = {0, 0, 0, 0, 0};
+int iap_calls [6] = {0, 0, 0, 0, 0, 0};
+
+// Size of a flash page: 256 bytes
+#define IAP_PAGE_SIZE 0x100
+
+// Busy times per operation in usec, see IAP_Set_Timing()
+static unsigned int flashSectorEraseTime = 100000;
+static unsigned int flashPageEraseTime = 2500;
+static unsigned int flashProgramTime = 1000;
+
+static unsigned int flashBusyTotal = 0;
+static IAP_BusyHandler flashBusyHandler = 0;
+
+extern unsigned int systemTime;
+
+void IAP_Set_Timing(unsigned int sectorErase, unsigned int pageErase,
+    unsigned int program)
+{
+    flashSectorEraseTime = sectorErase;
+    flashPageEraseTime = pageErase;
+    flashProgramTime = program;
+}
+
+void IAP_Set_Busy_Handler(IAP_BusyHandler handler)
+{
+    flashBusyHandler = handler;
+}
+
+unsigned int IAP_Busy_Time(void)
+{
+    return flashBusyTotal;
+}
+
+void IAP_Reset_Busy_Time(void)
+{
+    flashBusyTotal = 0;
+}
+
+// The flash is busy for the given time in usec: the stalled CPU misses
+// its interrupts, the system time advances
+static void flashBusy(unsigned int busyTime)
+{
+    flashBusyTotal += busyTime;
+    systemTime += busyTime / 1000;
+
+    if (flashBusyHandler)
+        flashBusyHandler(busyTime);
+}
 
 void IAP_Init_Flash(unsigned char value)
 {
     memset(FLASH, value, FLASH_SIZE);
 }
 
-void IAP_Call (unsigned int * cmd, unsigned int * stat)
+// The parameters are unsigned long: 32 bits on the device, wide enough
+// for the host's pointers in the emulation
+void IAP_Call (unsigned long * cmd, unsigned long * stat)
 {
-    unsigned int i;
-    unsigned int end;
-    unsigned int * rom;
-    unsigned int * ram;
+    unsigned long i;
+    unsigned long end;
+    unsigned char * rom;
+    unsigned char * ram;
 
     * stat = CMD_SUCCESS;
     switch (* cmd)
@@ -93,6 +142,17 @@ void IAP_Call (unsigned int * cmd, unsigned int * stat)
         {
             FLASH [i] = 0xFF;
         }
+        flashBusy ((* (cmd + 2) - * (cmd + 1) + 1) * flashSectorEraseTime);
+        break;
+    case IAP_ERASE_PAGE :
+        iap_calls [I_ERASE_PAGE]++;
+        i    =  * (cmd + 1)      * IAP_PAGE_SIZE;
+        end  = (* (cmd + 2) + 1) * IAP_PAGE_SIZE;
+        for (; i < end; i++)
+        {
+            FLASH [i] = 0xFF;
+        }
+        flashBusy ((* (cmd + 2) - * (cmd + 1) + 1) * flashPageEraseTime);
         break;
     case IAP_BLANK_CHECK :
         iap_calls [I_BLANK_CHECK]++;
@@ -114,15 +174,16 @@ void IAP_Call (unsigned int * cmd, unsigned int * stat)
         break;
     case IAP_COPY_RAM2FLASH :
         iap_calls [I_RAM2FLASH]++;
-        rom = (unsigned int *) (int) (* (cmd + 1));
-        ram = (unsigned int *) (* (cmd + 2));
+        rom = (unsigned char *) (* (cmd + 1));
+        ram = (unsigned char *) (* (cmd + 2));
         i   = * (cmd + 3);
         memcpy (rom, ram, i);
+        flashBusy (flashProgramTime);
         break;
     case IAP_COMPARE :
         iap_calls [I_COMPARE]++;
-        rom = (unsigned int *) (* (cmd + 1));
-        ram = (unsigned int *) (* (cmd + 2));
+        rom = (unsigned char *) (* (cmd + 1));
+        ram = (unsigned char *) (* (cmd + 2));
         i   = * (cmd + 3);
         if (memcmp (rom, ram, i) != 0)
         {
@@ -24,7 +24,7 @@ static void _handleRx(Test_Case * tc, Telegram * tel, unsigned int tn)
 	/*
     unsigned int s = 0;
 	if (bus.sendCurTelegram) s++;
-	if (bus.sendNextTel) s++;
+	s += bus.sendQueueCount;
 	REQUIRE(s == tel->variable);
 	*/
 	REQUIRE(bus.telegramLen == 0);
@@ -71,14 +71,14 @@ static void _handleTx(Test_Case * tc, Telegram * tel, unsigned int tn)
     bus.currentByte = SB_BUS_ACK;
     bus.nextByteIndex = 1;
     bus.handleTelegram(true);
-    REQUIRE(bus.sendNextTel == NULL);
+    REQUIRE(bus.sendQueueCount == 0);
 }
 
 static void _handleCheckTx(Test_Case * tc, Telegram * tel, unsigned int tn)
 {
     unsigned int s = 0;
     if (bus.sendCurTelegram) s++;
-    if (bus.sendNextTel) s++;
+    s += bus.sendQueueCount;
     INFO("Check if additional telegrams should be sent");
     REQUIRE(s == tel->variable);
 }
@@ -87,7 +87,7 @@ static void _handleTime(Test_Case * tc, Telegram * tel, unsigned int tn)
 {
 	unsigned int s = 0;
     if (bus.sendCurTelegram) s++;
-    if (bus.sendNextTel) s++;
+    s += bus.sendQueueCount;
     //INFO("Ensure that no outgoing telegram is in the queue");
     if (s)
     {
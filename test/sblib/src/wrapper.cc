@@ -28,7 +28,7 @@ extern "C"
     {
         * busTelgramLen = bus.telegramLen;
         * sendCurTelegram = (bus.sendCurTelegram != NULL);
-        * sendNextTel     = (bus.sendNextTel     != NULL);
+        * sendNextTel     = (bus.sendQueueCount  != 0);
         * time            = systemTime;
     }
 
@@ -0,0 +1,94 @@
+#!/usr/bin/env python
+#
+#  lcd-rle.py - Compress LCD font / bitmap data for sblib.
+#
+#  Encodes a binary file with the byte RLE that sblib/lcd/resource.h
+#  decodes, and writes the result as a C array. The format is a sequence
+#  of blocks, each starting with a control byte c:
+#
+#    c < 0x80:  literal block, the c + 1 following bytes are copied
+#    c >= 0x80: run, the one following byte is repeated c - 0x80 + 2 times
+#
+#  Usage: lcd-rle.py <input.bin> <arrayName>
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License version 3 as
+#  published by the Free Software Foundation.
+#
+import sys
+
+
+def encode(data):
+    out = bytearray()
+    literal = bytearray()
+    i = 0
+
+    while i < len(data):
+        # Measure the run at the current position
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 129:
+            run += 1
+
+        if run >= 2:
+            while literal:
+                chunk = literal[:128]
+                del literal[:128]
+                out.append(len(chunk) - 1)
+                out += chunk
+            out.append(0x80 + run - 2)
+            out.append(data[i])
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+
+    while literal:
+        chunk = literal[:128]
+        del literal[:128]
+        out.append(len(chunk) - 1)
+        out += chunk
+
+    return out
+
+
+def decode(data, count):
+    out = bytearray()
+    i = 0
+    while len(out) < count:
+        ctrl = data[i]
+        i += 1
+        if ctrl < 0x80:
+            out += data[i:i + ctrl + 1]
+            i += ctrl + 1
+        else:
+            out += bytearray([data[i]]) * (ctrl - 0x80 + 2)
+            i += 1
+    return out
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write('usage: lcd-rle.py <input.bin> <arrayName>\n')
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        data = bytearray(f.read())
+
+    out = encode(data)
+    if decode(out, len(data)) != data:
+        sys.stderr.write('internal error: decode mismatch\n')
+        sys.exit(1)
+
+    name = sys.argv[2]
+    print('// %s: %d bytes compressed to %d bytes' %
+          (sys.argv[1], len(data), len(out)))
+    print('static const byte %s[%d] =' % (name, len(out)))
+    print('{')
+    for i in range(0, len(out), 12):
+        line = ', '.join('0x%02x' % b for b in out[i:i + 12])
+        print('    %s,' % line)
+    print('};')
+
+
+if __name__ == '__main__':
+    main()